@@ -23,18 +23,25 @@
 #define TAG_CACHE_DATA 'DcaC'
 #define TAG_CACHE_BLOCK 'BcaC'
 
+#define CACHE_HASH_TABLE_SIZE   256     // Number of hash buckets, must be a power of two
+#define CACHE_READ_AHEAD_BLOCKS 8       // Blocks read past the end of a request, if they fit in DiskReadBuffer
+#define CACHE_BLOCKS_PER_READ   8       // Blocks that must fit in DiskReadBuffer together, so that reads coalesce
+
+#define CacheHashBlockNumber(BlockNumber)   ((BlockNumber) & (CACHE_HASH_TABLE_SIZE - 1))
+
 ///////////////////////////////////////////////////////////////////////////////////////
 //
 // This structure describes a cached block element. The disk is divided up into
-// cache blocks. For disks which LBA is not supported each block is the size of
-// one track. This will force the cache manager to make track sized reads, and
-// therefore maximizes throughput. For disks which support LBA the block size
-// is 64k because they have no cylinder, head, or sector boundaries.
+// cache blocks. For disks which LBA is not supported each block is at most the
+// size of one track, for disks which support LBA at most 32k. Blocks are made
+// small enough for CACHE_BLOCKS_PER_READ of them to fit in DiskReadBuffer, so
+// that the cache manager can read runs of blocks with a single disk read.
 //
 ///////////////////////////////////////////////////////////////////////////////////////
 typedef struct
 {
     LIST_ENTRY    ListEntry;                    // Doubly linked list synchronization member
+    LIST_ENTRY    HashListEntry;                // Links the block into its hash bucket
 
     ULONG            BlockNumber;                // Track index for CHS, 64k block index for LBA
     BOOLEAN        LockedInCache;                // Indicates that this block is locked in cache memory
@@ -57,10 +64,28 @@ typedef struct
     ULONG            BytesPerSector;
 
     ULONG            BlockSize;            // Block size (in sectors)
-    LIST_ENTRY        CacheBlockHead;            // Contains CACHE_BLOCK structures
+    LIST_ENTRY        CacheBlockHead;            // Contains CACHE_BLOCK structures, most recently used first
+    LIST_ENTRY        CacheBlockHashTable[CACHE_HASH_TABLE_SIZE];    // Same blocks, hashed by block number
 
 } CACHE_DRIVE, *PCACHE_DRIVE;
 
+#if DBG
+///////////////////////////////////////////////////////////////////////////////////////
+//
+// Cache statistics for the whole boot, dumped to the debug port
+//
+///////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+    ULONG            BlockLookups;        // Blocks requested from the cache
+    ULONG            CacheHits;            // Blocks that were already cached
+    ULONG            BlocksRead;            // Blocks read from the disk, including read-ahead
+    ULONG            DiskReads;            // Calls to MachDiskReadLogicalSectors()
+    ULONGLONG        DiskReadTime;        // Time spent in MachDiskReadLogicalSectors(), in TSC ticks
+
+} CACHE_STATISTICS, *PCACHE_STATISTICS;
+#endif
+
 
 ///////////////////////////////////////////////////////////////////////////////////////
 //
@@ -72,15 +97,18 @@ extern    BOOLEAN            CacheManagerInitialized;
 extern    ULONG                CacheBlockCount;
 extern    SIZE_T                CacheSizeLimit;
 extern    SIZE_T                CacheSizeCurrent;
+#if DBG
+extern    CACHE_STATISTICS    CacheStatistics;
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////////////
 //
 // Internal functions
 //
 ///////////////////////////////////////////////////////////////////////////////////////
-PCACHE_BLOCK    CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                // Returns a pointer to a CACHE_BLOCK structure given a block number
-PCACHE_BLOCK    CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                    // Searches the block list for a particular block
-PCACHE_BLOCK    CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                // Adds a block to the cache's block list
+PCACHE_BLOCK    CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNumber, ULONG ReadAheadCount);    // Returns a pointer to a CACHE_BLOCK structure given a block number
+PCACHE_BLOCK    CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                    // Searches the block hash table for a particular block
+PCACHE_BLOCK    CacheInternalAddBlocksToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber, ULONG BlockCount);    // Reads a run of blocks with one disk read and adds them to the cache's block list
 BOOLEAN            CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive);                                    // Removes a block from the cache's block list & frees the memory
 VOID            CacheInternalCheckCacheSizeLimits(PCACHE_DRIVE CacheDrive);                            // Checks the cache size limits to see if we can add a new block, if not calls CacheInternalFreeBlock()
 VOID            CacheInternalDumpBlockList(PCACHE_DRIVE CacheDrive);                                // Dumps the list of cached blocks to the debug output port
@@ -92,3 +120,6 @@ VOID    CacheInvalidateCacheData(VOID);
 BOOLEAN    CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG SectorCount, PVOID Buffer);
 BOOLEAN    CacheForceDiskSectorsIntoCache(UCHAR DiskNumber, ULONGLONG StartSector, ULONG SectorCount);
 BOOLEAN    CacheReleaseMemory(ULONG MinimumAmountToRelease);
+#if DBG
+VOID    CacheDumpStatistics(VOID);
+#endif
@@ -22,27 +22,85 @@
 #include <debug.h>
 DBG_DEFAULT_CHANNEL(CACHE);
 
+static PCACHE_BLOCK CacheInternalLookupBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
+{
+    PLIST_ENTRY        BucketHead;
+    PLIST_ENTRY        Entry;
+    PCACHE_BLOCK    CacheBlock;
+
+    BucketHead = &CacheDrive->CacheBlockHashTable[CacheHashBlockNumber(BlockNumber)];
+
+    for (Entry = BucketHead->Flink; Entry != BucketHead; Entry = Entry->Flink)
+    {
+        CacheBlock = CONTAINING_RECORD(Entry, CACHE_BLOCK, HashListEntry);
+        if (CacheBlock->BlockNumber == BlockNumber)
+        {
+            return CacheBlock;
+        }
+    }
+
+    return NULL;
+}
+
 // Returns a pointer to a CACHE_BLOCK structure
 // Adds the block to the cache manager block list
-// in cache memory if it isn't already there
-PCACHE_BLOCK CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
+// in cache memory if it isn't already there.
+// On a miss up to ReadAheadCount blocks following
+// the requested one are read in with the same disk read.
+PCACHE_BLOCK CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNumber, ULONG ReadAheadCount)
 {
     PCACHE_BLOCK    CacheBlock = NULL;
+    ULONG            MaxBlockCount;
+    ULONG            BlockCount;
 
     TRACE("CacheInternalGetBlockPointer() BlockNumber = %d\n", BlockNumber);
 
+#if DBG
+    CacheStatistics.BlockLookups++;
+#endif
+
     CacheBlock = CacheInternalFindBlock(CacheDrive, BlockNumber);
 
     if (CacheBlock != NULL)
     {
         TRACE("Cache hit! BlockNumber: %d CacheBlock->BlockNumber: %d\n", BlockNumber, CacheBlock->BlockNumber);
 
+#if DBG
+        CacheStatistics.CacheHits++;
+#endif
+
+        // Keep the block list in LRU order
+        CacheInternalOptimizeBlockList(CacheDrive, CacheBlock);
+
         return CacheBlock;
     }
 
     TRACE("Cache miss! BlockNumber: %d\n", BlockNumber);
 
-    CacheBlock = CacheInternalAddBlockToCache(CacheDrive, BlockNumber);
+    // Extend the read over the following blocks that are not
+    // cached yet, as far as the disk read buffer allows
+    MaxBlockCount = (ULONG)(DiskReadBufferSize / (CacheDrive->BlockSize * CacheDrive->BytesPerSector));
+    BlockCount = 1;
+    while ((BlockCount <= ReadAheadCount) &&
+           (BlockCount < MaxBlockCount) &&
+           (CacheInternalLookupBlock(CacheDrive, BlockNumber + BlockCount) == NULL))
+    {
+        BlockCount++;
+    }
+
+    CacheBlock = CacheInternalAddBlocksToCache(CacheDrive, BlockNumber, BlockCount);
+
+    // The read-ahead may have run past the end of the disk,
+    // so retry with just the block that was asked for
+    if (CacheBlock == NULL && BlockCount > 1)
+    {
+        CacheBlock = CacheInternalAddBlocksToCache(CacheDrive, BlockNumber, 1);
+    }
+
+    if (CacheBlock == NULL)
+    {
+        return NULL;
+    }
 
     // Optimize the block list so it has a LRU structure
     CacheInternalOptimizeBlockList(CacheDrive, CacheBlock);
@@ -52,91 +110,105 @@ PCACHE_BLOCK CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNu
 
 PCACHE_BLOCK CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
 {
-    PCACHE_BLOCK    CacheBlock = NULL;
+    PCACHE_BLOCK    CacheBlock;
 
     TRACE("CacheInternalFindBlock() BlockNumber = %d\n", BlockNumber);
 
+    CacheBlock = CacheInternalLookupBlock(CacheDrive, BlockNumber);
+
     //
-    // Make sure the block list has entries before I start searching it.
+    // Increment the blocks access count
     //
-    if (!IsListEmpty(&CacheDrive->CacheBlockHead))
+    if (CacheBlock != NULL)
     {
-        //
-        // Search the list and find the BIOS drive number
-        //
-        CacheBlock = CONTAINING_RECORD(CacheDrive->CacheBlockHead.Flink, CACHE_BLOCK, ListEntry);
-
-        while (&CacheBlock->ListEntry != &CacheDrive->CacheBlockHead)
-        {
-            //
-            // We found the block, so return it
-            //
-            if (CacheBlock->BlockNumber == BlockNumber)
-            {
-                //
-                // Increment the blocks access count
-                //
-                CacheBlock->AccessCount++;
-
-                return CacheBlock;
-            }
-
-            CacheBlock = CONTAINING_RECORD(CacheBlock->ListEntry.Flink, CACHE_BLOCK, ListEntry);
-        }
+        CacheBlock->AccessCount++;
     }
 
-    return NULL;
+    return CacheBlock;
 }
 
-PCACHE_BLOCK CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
+PCACHE_BLOCK CacheInternalAddBlocksToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber, ULONG BlockCount)
 {
-    PCACHE_BLOCK    CacheBlock = NULL;
-
-    TRACE("CacheInternalAddBlockToCache() BlockNumber = %d\n", BlockNumber);
-
-    // Check the size of the cache so we don't exceed our limits
-    CacheInternalCheckCacheSizeLimits(CacheDrive);
-
-    // We will need to add the block to the
-    // drive's list of cached blocks. So allocate
-    // the block memory.
-    CacheBlock = FrLdrTempAlloc(sizeof(CACHE_BLOCK), TAG_CACHE_BLOCK);
-    if (CacheBlock == NULL)
+    PCACHE_BLOCK    FirstCacheBlock = NULL;
+    PCACHE_BLOCK    CacheBlock;
+    ULONG            BlockBytes;
+    ULONG            Idx;
+#if DBG && !defined(_M_ARM)
+    ULONGLONG        Time;
+#endif
+
+    TRACE("CacheInternalAddBlocksToCache() BlockNumber = %d BlockCount = %d\n", BlockNumber, BlockCount);
+
+    BlockBytes = CacheDrive->BlockSize * CacheDrive->BytesPerSector;
+
+    // Read the whole run in first. The allocations below
+    // don't touch the disk read buffer.
+#if DBG && !defined(_M_ARM)
+    Time = __rdtsc();
+#endif
+    if (!MachDiskReadLogicalSectors(CacheDrive->DriveNumber,
+                                    ((ULONGLONG)BlockNumber * CacheDrive->BlockSize),
+                                    BlockCount * CacheDrive->BlockSize,
+                                    DiskReadBuffer))
     {
         return NULL;
     }
-
-    // Now initialize the structure and
-    // allocate room for the block data
-    RtlZeroMemory(CacheBlock, sizeof(CACHE_BLOCK));
-    CacheBlock->BlockNumber = BlockNumber;
-    CacheBlock->BlockData = FrLdrTempAlloc(CacheDrive->BlockSize * CacheDrive->BytesPerSector,
-                                           TAG_CACHE_DATA);
-    if (CacheBlock->BlockData ==NULL)
+#if DBG
+#if !defined(_M_ARM)
+    CacheStatistics.DiskReadTime += (__rdtsc() - Time);
+#endif
+    CacheStatistics.DiskReads++;
+    CacheStatistics.BlocksRead += BlockCount;
+#endif
+
+    // Add the blocks last to first, so that the block that was asked
+    // for ends up most recently used and can't be thrown out to make
+    // room for its own read-ahead
+    for (Idx = BlockCount; Idx-- > 0; )
     {
-        FrLdrTempFree(CacheBlock, TAG_CACHE_BLOCK);
-        return NULL;
-    }
+        // Check the size of the cache so we don't exceed our limits
+        CacheInternalCheckCacheSizeLimits(CacheDrive);
+
+        // We will need to add the block to the
+        // drive's list of cached blocks. So allocate
+        // the block memory.
+        CacheBlock = FrLdrTempAlloc(sizeof(CACHE_BLOCK), TAG_CACHE_BLOCK);
+        if (CacheBlock == NULL)
+        {
+            continue;
+        }
 
-    // Now try to read in the block
-    if (!MachDiskReadLogicalSectors(CacheDrive->DriveNumber, (BlockNumber * CacheDrive->BlockSize), CacheDrive->BlockSize, DiskReadBuffer))
-    {
-        FrLdrTempFree(CacheBlock->BlockData, TAG_CACHE_DATA);
-        FrLdrTempFree(CacheBlock, TAG_CACHE_BLOCK);
-        return NULL;
-    }
-    RtlCopyMemory(CacheBlock->BlockData, DiskReadBuffer, CacheDrive->BlockSize * CacheDrive->BytesPerSector);
+        // Now initialize the structure and
+        // allocate room for the block data
+        RtlZeroMemory(CacheBlock, sizeof(CACHE_BLOCK));
+        CacheBlock->BlockNumber = BlockNumber + Idx;
+        CacheBlock->BlockData = FrLdrTempAlloc(BlockBytes, TAG_CACHE_DATA);
+        if (CacheBlock->BlockData == NULL)
+        {
+            FrLdrTempFree(CacheBlock, TAG_CACHE_BLOCK);
+            continue;
+        }
 
-    // Add it to our list of blocks managed by the cache
-    InsertTailList(&CacheDrive->CacheBlockHead, &CacheBlock->ListEntry);
+        RtlCopyMemory(CacheBlock->BlockData, (PUCHAR)DiskReadBuffer + (Idx * BlockBytes), BlockBytes);
 
-    // Update the cache data
-    CacheBlockCount++;
-    CacheSizeCurrent = CacheBlockCount * (CacheDrive->BlockSize * CacheDrive->BytesPerSector);
+        // Add it to our list of blocks managed by the cache
+        InsertHeadList(&CacheDrive->CacheBlockHead, &CacheBlock->ListEntry);
+        InsertHeadList(&CacheDrive->CacheBlockHashTable[CacheHashBlockNumber(CacheBlock->BlockNumber)],
+                       &CacheBlock->HashListEntry);
+
+        // Update the cache data
+        CacheBlockCount++;
+        CacheSizeCurrent = CacheBlockCount * BlockBytes;
+
+        if (Idx == 0)
+        {
+            FirstCacheBlock = CacheBlock;
+        }
+    }
 
     CacheInternalDumpBlockList(CacheDrive);
 
-    return CacheBlock;
+    return FirstCacheBlock;
 }
 
 BOOLEAN CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive)
@@ -156,12 +228,13 @@ BOOLEAN CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive)
 
     // No blocks left in cache that can be freed
     // so just return
-    if (IsListEmpty(&CacheDrive->CacheBlockHead))
+    if (&CacheBlockToFree->ListEntry == &CacheDrive->CacheBlockHead)
     {
         return FALSE;
     }
 
     RemoveEntryList(&CacheBlockToFree->ListEntry);
+    RemoveEntryList(&CacheBlockToFree->HashListEntry);
 
     // Free the block memory and the block structure
     FrLdrTempFree(CacheBlockToFree->BlockData, TAG_CACHE_DATA);
@@ -193,6 +266,7 @@ VOID CacheInternalCheckCacheSizeLimits(PCACHE_DRIVE CacheDrive)
 
 VOID CacheInternalDumpBlockList(PCACHE_DRIVE CacheDrive)
 {
+#if DBG
     PCACHE_BLOCK    CacheBlock;
 
     TRACE("Dumping block list for BIOS drive 0x%x.\n", CacheDrive->DriveNumber);
@@ -218,6 +292,7 @@ VOID CacheInternalDumpBlockList(PCACHE_DRIVE CacheDrive)
 
         CacheBlock = CONTAINING_RECORD(CacheBlock->ListEntry.Flink, CACHE_BLOCK, ListEntry);
     }
+#endif
 }
 
 VOID CacheInternalOptimizeBlockList(PCACHE_DRIVE CacheDrive, PCACHE_BLOCK CacheBlock)
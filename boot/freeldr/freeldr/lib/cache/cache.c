@@ -33,11 +33,15 @@ BOOLEAN            CacheManagerDataInvalid = FALSE;
 ULONG            CacheBlockCount = 0;
 SIZE_T            CacheSizeLimit = 0;
 SIZE_T            CacheSizeCurrent = 0;
+#if DBG
+CACHE_STATISTICS    CacheStatistics;
+#endif
 
 BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
 {
     PCACHE_BLOCK    NextCacheBlock;
     GEOMETRY    DriveGeometry;
+    ULONG        Idx;
 
     // If we already have a cache for this drive then
     // by all means lets keep it, unless it is a removable
@@ -63,6 +67,9 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
         TRACE("CacheBlockCount: %d\n", CacheBlockCount);
         TRACE("CacheSizeLimit: %d\n", CacheSizeLimit);
         TRACE("CacheSizeCurrent: %d\n", CacheSizeCurrent);
+#if DBG
+        CacheDumpStatistics();
+#endif
         //
         // Loop through and free the cache blocks
         //
@@ -80,6 +87,10 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
     // Initialize the structure
     RtlZeroMemory(&CacheManagerDrive, sizeof(CACHE_DRIVE));
     InitializeListHead(&CacheManagerDrive.CacheBlockHead);
+    for (Idx = 0; Idx < CACHE_HASH_TABLE_SIZE; Idx++)
+    {
+        InitializeListHead(&CacheManagerDrive.CacheBlockHashTable[Idx]);
+    }
     CacheManagerDrive.DriveNumber = DriveNumber;
     if (!MachDiskGetDriveGeometry(DriveNumber, &DriveGeometry))
     {
@@ -87,8 +98,12 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
     }
     CacheManagerDrive.BytesPerSector = DriveGeometry.BytesPerSector;
 
-    // Get the number of sectors in each cache block
+    // Get the number of sectors in each cache block. Blocks are only read
+    // through DiskReadBuffer (it is the only buffer the BIOS can read into
+    // on PC), so keep them small enough for runs of them to fit in it.
     CacheManagerDrive.BlockSize = MachDiskGetCacheableBlockCount(DriveNumber);
+    CacheManagerDrive.BlockSize = min(CacheManagerDrive.BlockSize,
+                                      max((ULONG)(DiskReadBufferSize / CacheManagerDrive.BytesPerSector) / CACHE_BLOCKS_PER_READ, 1));
 
     CacheBlockCount = 0;
     CacheSizeCurrent = 0;
@@ -148,7 +163,7 @@ BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG Sect
         //
         // Get cache block pointer (this forces the disk sectors into the cache memory)
         //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, StartBlock);
+        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, StartBlock, (EndBlock - StartBlock) + CACHE_READ_AHEAD_BLOCKS);
         if (CacheBlock == NULL)
         {
             return FALSE;
@@ -181,7 +196,7 @@ BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG Sect
         //
         // Get cache block pointer (this forces the disk sectors into the cache memory)
         //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, Idx);
+        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, Idx, (EndBlock - Idx) + CACHE_READ_AHEAD_BLOCKS);
         if (CacheBlock == NULL)
         {
             return FALSE;
@@ -214,7 +229,7 @@ BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG Sect
         //
         // Get cache block pointer (this forces the disk sectors into the cache memory)
         //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, EndBlock);
+        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, EndBlock, CACHE_READ_AHEAD_BLOCKS);
         if (CacheBlock == NULL)
         {
             return FALSE;
@@ -274,7 +289,7 @@ BOOLEAN CacheForceDiskSectorsIntoCache(UCHAR DiskNumber, ULONGLONG StartSector,
         //
         // Get cache block pointer (this forces the disk sectors into the cache memory)
         //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, Idx);
+        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, Idx, 0);
         if (CacheBlock == NULL)
         {
             return FALSE;
@@ -319,3 +334,16 @@ BOOLEAN CacheReleaseMemory(ULONG MinimumAmountToRelease)
     // Return status
     return (AmountReleased >= MinimumAmountToRelease);
 }
+
+#if DBG
+VOID CacheDumpStatistics(VOID)
+{
+    DbgPrint("Disk cache statistics:\n"
+             "BlockLookups=%lu, CacheHits=%lu, BlocksRead=%lu, DiskReads=%lu\n",
+             CacheStatistics.BlockLookups, CacheStatistics.CacheHits,
+             CacheStatistics.BlocksRead, CacheStatistics.DiskReads);
+#if !defined(_M_ARM)
+    DbgPrint("DiskReadTime = %I64d\n", CacheStatistics.DiskReadTime);
+#endif
+}
+#endif
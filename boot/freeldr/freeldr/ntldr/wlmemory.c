@@ -180,6 +180,11 @@ WinLdrSetupMemoryLayout(IN OUT PLOADER_PARAMETER_BLOCK LoaderBlock)
     //PKTSS Tss;
     BOOLEAN Status;
 
+#if DBG
+    /* The disk cache lives in the temp heap, report on it before it goes */
+    CacheDumpStatistics();
+#endif
+
     /* Cleanup heap */
     FrLdrHeapCleanupAll();
 
@@ -492,7 +492,7 @@
 @ stdcall NtReleaseSemaphore(long long ptr)
 @ stdcall -stub -version=0x600+ NtReleaseWorkerFactoryWorker(ptr)
 @ stdcall NtRemoveIoCompletion(ptr ptr ptr ptr ptr)
-@ stdcall -stub -version=0x600+ NtRemoveIoCompletionEx(ptr ptr long ptr ptr long)
+@ stdcall -version=0x600+ NtRemoveIoCompletionEx(ptr ptr long ptr ptr long)
 @ stdcall NtRemoveProcessDebug(ptr ptr)
 @ stdcall NtRenameKey(ptr ptr)
 @ stdcall -stub -version=0x600+ NtRenameTransactionManager(ptr ptr)
@@ -1262,6 +1262,9 @@
 @ stdcall RtlValidateUnicodeString(long ptr)
 @ stdcall RtlVerifyVersionInfo(ptr long double)
 @ stdcall -arch=x86_64 RtlVirtualUnwind(long long long ptr ptr ptr ptr ptr)
+@ stdcall -version=0x602+ RtlWaitOnAddress(ptr ptr long ptr)
+@ stdcall -version=0x602+ RtlWakeAddressAll(ptr)
+@ stdcall -version=0x602+ RtlWakeAddressSingle(ptr)
 @ stdcall -version=0x600+ RtlWakeAllConditionVariable(ptr)
 @ stdcall -version=0x600+ RtlWakeConditionVariable(ptr)
 @ stdcall RtlWalkFrameChain(ptr long long)
@@ -1654,7 +1657,7 @@
 @ stdcall ZwReleaseSemaphore(long long ptr)
 @ stdcall -stub -version=0x600+ ZwReleaseWorkerFactoryWorker(ptr)
 @ stdcall ZwRemoveIoCompletion(ptr ptr ptr ptr ptr)
-@ stdcall -stub -version=0x600+ ZwRemoveIoCompletionEx(ptr ptr long ptr ptr long)
+@ stdcall -version=0x600+ ZwRemoveIoCompletionEx(ptr ptr long ptr ptr long)
 @ stdcall ZwRemoveProcessDebug(ptr ptr)
 @ stdcall ZwRenameKey(ptr ptr)
 @ stdcall -stub -version=0x600+ ZwRenameTransactionManager(wstr ptr)
@@ -41,6 +41,47 @@ typedef struct _LDRP_TEB_LIST_ENTRY
     PTEB Teb;
 } LDRP_TEB_LIST_ENTRY, *PLDRP_TEB_LIST_ENTRY;
 
+/* Export name hash tables */
+#define LDRP_EXPORT_HASH_MIN_NAMES      64
+#define LDRP_EXPORT_HASH_MAX_NAMES      0x100000
+#define LDRP_EXPORT_HASH_MIN_LOOKUPS    8
+
+typedef struct _LDRP_EXPORT_HASH
+{
+    LIST_ENTRY Links;
+    PVOID DllBase;
+    ULONG Lookups;
+    ULONG Mask;
+    PULONG Buckets;
+} LDRP_EXPORT_HASH, *PLDRP_EXPORT_HASH;
+
+/* Loader worker threads */
+#define LDRP_DEFAULT_LOADER_THREADS         4
+#define LDRP_MAX_LOADER_THREADS             16
+#define LDRP_LOADER_WORKER_IDLE_TIMEOUT     10000
+
+typedef enum _LDRP_LOAD_WORK_STATE
+{
+    LdrpLoadWorkQueued,
+    LdrpLoadWorkRunning,
+    LdrpLoadWorkDone
+} LDRP_LOAD_WORK_STATE;
+
+typedef struct _LDRP_LOAD_WORK
+{
+    LIST_ENTRY Links;
+    volatile LONG State;
+    UNICODE_STRING DllName;
+    PWSTR SearchPath;
+    UNICODE_STRING FullDllName;
+    UNICODE_STRING BaseDllName;
+    HANDLE SectionHandle;
+    PVOID ViewBase;
+    SIZE_T ViewSize;
+    NTSTATUS MapStatus;
+    BOOLEAN Relocated;
+} LDRP_LOAD_WORK, *PLDRP_LOAD_WORK;
+
 typedef
 NTSTATUS
 (NTAPI* PLDR_APP_COMPAT_DLL_REDIRECTION_CALLBACK_FUNCTION)(
@@ -78,6 +119,7 @@ extern PVOID g_pfnSE_DllUnloaded;
 extern PVOID g_pfnSE_InstallBeforeInit;
 extern PVOID g_pfnSE_InstallAfterInit;
 extern PVOID g_pfnSE_ProcessDying;
+extern ULONG LdrpMaxLoaderThreads;
 
 /* ldrinit.c */
 NTSTATUS NTAPI LdrpRunInitializeRoutines(IN PCONTEXT Context OPTIONAL);
@@ -108,6 +150,9 @@ NTSTATUS NTAPI
 LdrpWalkImportDescriptor(IN LPWSTR DllPath OPTIONAL,
                          IN PLDR_DATA_TABLE_ENTRY LdrEntry);
 
+VOID NTAPI
+LdrpFreeExportHash(IN PVOID DllBase);
+
 /* libsupp.c */
 NTSYSAPI
 NTSTATUS
@@ -156,6 +201,10 @@ NTAPI
 LdrpSetProtection(PVOID ViewBase,
                   BOOLEAN Restore);
 
+NTSTATUS NTAPI
+LdrpCodeAuthzCheckDllAllowed(IN PUNICODE_STRING FullName,
+                             IN HANDLE DllHandle);
+
 BOOLEAN
 NTAPI
 LdrpCheckForLoadedDllHandle(IN PVOID Base,
@@ -177,6 +226,12 @@ LdrpMapDll(IN PWSTR SearchPath OPTIONAL,
            IN BOOLEAN Redirect,
            OUT PLDR_DATA_TABLE_ENTRY *DataTableEntry);
 
+BOOLEAN NTAPI
+LdrpResolveDllName(PWSTR DllPath,
+                   PWSTR DllName,
+                   PUNICODE_STRING FullDllName,
+                   PUNICODE_STRING BaseDllName);
+
 PVOID NTAPI
 LdrpFetchAddressOfEntryPoint(PVOID ImageBase);
 
@@ -198,6 +253,30 @@ LdrpLoadShimEngine(IN PWSTR ImageName,
 VOID NTAPI
 LdrpUnloadShimEngine(VOID);
 
+/* ldrwork.c */
+BOOLEAN NTAPI
+LdrpIsLoaderWorkerThread(VOID);
+
+VOID NTAPI
+LdrpQueueLoadWork(IN PWSTR DllPath OPTIONAL,
+                  IN PLDR_DATA_TABLE_ENTRY LdrEntry,
+                  IN PIMAGE_BOUND_IMPORT_DESCRIPTOR BoundEntry OPTIONAL,
+                  IN PIMAGE_IMPORT_DESCRIPTOR ImportEntry OPTIONAL);
+
+BOOLEAN NTAPI
+LdrpTakeLoadWork(IN PWSTR SearchPath OPTIONAL,
+                 IN PWSTR DllName,
+                 OUT PUNICODE_STRING FullDllName,
+                 OUT PUNICODE_STRING BaseDllName,
+                 OUT PHANDLE SectionHandle,
+                 OUT PVOID *ViewBase,
+                 OUT PSIZE_T ViewSize,
+                 OUT PNTSTATUS MapStatus,
+                 OUT PBOOLEAN Relocated);
+
+VOID NTAPI
+LdrpEndLoadWork(VOID);
+
 /* verifier.c */
 
 NTSTATUS NTAPI
@@ -1610,6 +1610,13 @@ LdrpInitializeExecutionOptions(PUNICODE_STRING ImagePathName, PPEB Peb, PHANDLE
                                    sizeof(RtlpShutdownProcessFlags),
                                    NULL);
 
+        LdrQueryImageFileKeyOption(KeyHandle,
+                                   L"MaxLoaderThreads",
+                                   REG_DWORD,
+                                   &LdrpMaxLoaderThreads,
+                                   sizeof(LdrpMaxLoaderThreads),
+                                   NULL);
+
         LdrQueryImageFileKeyOption(KeyHandle,
                                    L"MinimumStackCommitInBytes",
                                    REG_DWORD,
@@ -2076,6 +2083,10 @@ LdrpInitializeProcess(IN PCONTEXT Context,
     /* Initialize Critical Section Data */
     RtlpInitDeferredCriticalSection();
 
+    /* Create the keyed event for RtlWaitOnAddress (SRW locks, condition
+       variables) before the loader workers or any other thread can wait */
+    RtlpInitializeKeyedEvent();
+
     /* Initialize VEH Call lists */
     RtlpInitializeVectoredExceptionHandling();
 
@@ -2533,9 +2544,7 @@ LdrpInitializeProcess(IN PCONTEXT Context,
     /* Check whether all static imports were properly loaded and return here */
     if (!NT_SUCCESS(ImportStatus)) return ImportStatus;
 
-    /* Following two calls are for Vista+ support, required for winesync */
-    /* Initialize the keyed event for condition variables */
-    RtlpInitializeKeyedEvent();
+    /* Following call is for Vista+ support, required for winesync */
     RtlpInitializeThreadPooling();
 
     /* Initialize Active TEB List */
@@ -2734,6 +2743,9 @@ LdrpInit(PCONTEXT Context,
         Teb->DeallocationStack = MemoryBasicInfo.AllocationBase;
     }
 
+    /* Loader workers only map DLLs for the thread that is loading them */
+    if (LdrpIsLoaderWorkerThread()) return;
+
     /* Now check if the process is already being initialized */
     while (_InterlockedCompareExchange(&LdrpProcessInitialized,
                                       1,
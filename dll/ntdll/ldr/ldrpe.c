@@ -18,8 +18,137 @@
 PLDR_MANIFEST_PROBER_ROUTINE LdrpManifestProberRoutine;
 ULONG LdrpNormalSnap;
 
+/* Export name hash tables, protected by the loader lock */
+LIST_ENTRY LdrpExportHashList = { &LdrpExportHashList, &LdrpExportHashList };
+PLDRP_EXPORT_HASH LdrpExportHashCache;
+
 /* FUNCTIONS *****************************************************************/
 
+static
+ULONG
+LdrpHashExportName(IN PCSTR Name)
+{
+    ULONG Hash = 2166136261UL;
+
+    /* FNV-1a */
+    while (*Name)
+    {
+        Hash ^= (UCHAR)*Name++;
+        Hash *= 16777619UL;
+    }
+
+    return Hash;
+}
+
+static
+VOID
+LdrpBuildExportHash(IN PLDRP_EXPORT_HASH ExportHash,
+                    IN ULONG NumberOfNames,
+                    IN PVOID ExportBase,
+                    IN PULONG NameTable)
+{
+    ULONG BucketCount, Slot, i;
+    PULONG Buckets;
+
+    /* Keep the table at most half full, so that probing stays short */
+    BucketCount = 1;
+    while (BucketCount < NumberOfNames * 2) BucketCount <<= 1;
+
+    Buckets = RtlAllocateHeap(LdrpHeap, HEAP_ZERO_MEMORY, BucketCount * sizeof(ULONG));
+    if (!Buckets) return;
+
+    /* Buckets hold the name index plus one, zero marks a free bucket */
+    for (i = 0; i < NumberOfNames; i++)
+    {
+        Slot = LdrpHashExportName((PCHAR)((ULONG_PTR)ExportBase + NameTable[i]));
+        Slot &= BucketCount - 1;
+        while (Buckets[Slot]) Slot = (Slot + 1) & (BucketCount - 1);
+
+        Buckets[Slot] = i + 1;
+    }
+
+    ExportHash->Mask = BucketCount - 1;
+    ExportHash->Buckets = Buckets;
+}
+
+static
+PLDRP_EXPORT_HASH
+LdrpGetExportHash(IN PVOID ExportBase,
+                  IN ULONG NumberOfNames,
+                  IN PULONG NameTable)
+{
+    PLDRP_EXPORT_HASH ExportHash;
+    PLIST_ENTRY ListHead, Next;
+
+    /* Small export tables are searched quickly enough */
+    if ((NumberOfNames < LDRP_EXPORT_HASH_MIN_NAMES) ||
+        (NumberOfNames > LDRP_EXPORT_HASH_MAX_NAMES))
+    {
+        return NULL;
+    }
+
+    /* Imports are snapped one module at a time, so check the last one first */
+    ExportHash = LdrpExportHashCache;
+    if (!ExportHash || ExportHash->DllBase != ExportBase)
+    {
+        ExportHash = NULL;
+
+        ListHead = &LdrpExportHashList;
+        for (Next = ListHead->Flink; Next != ListHead; Next = Next->Flink)
+        {
+            if (CONTAINING_RECORD(Next, LDRP_EXPORT_HASH, Links)->DllBase == ExportBase)
+            {
+                ExportHash = CONTAINING_RECORD(Next, LDRP_EXPORT_HASH, Links);
+                break;
+            }
+        }
+
+        if (!ExportHash)
+        {
+            /* First lookup in this module, start counting */
+            ExportHash = RtlAllocateHeap(LdrpHeap, HEAP_ZERO_MEMORY, sizeof(*ExportHash));
+            if (!ExportHash) return NULL;
+
+            ExportHash->DllBase = ExportBase;
+            InsertTailList(&LdrpExportHashList, &ExportHash->Links);
+        }
+
+        LdrpExportHashCache = ExportHash;
+    }
+
+    /* Only hash the whole table once the module turns out to be looked up a lot */
+    if (!ExportHash->Buckets &&
+        ++ExportHash->Lookups >= LDRP_EXPORT_HASH_MIN_LOOKUPS)
+    {
+        LdrpBuildExportHash(ExportHash, NumberOfNames, ExportBase, NameTable);
+    }
+
+    return ExportHash;
+}
+
+VOID
+NTAPI
+LdrpFreeExportHash(IN PVOID DllBase)
+{
+    PLDRP_EXPORT_HASH ExportHash;
+    PLIST_ENTRY ListHead, Next;
+
+    ListHead = &LdrpExportHashList;
+    for (Next = ListHead->Flink; Next != ListHead; Next = Next->Flink)
+    {
+        ExportHash = CONTAINING_RECORD(Next, LDRP_EXPORT_HASH, Links);
+        if (ExportHash->DllBase != DllBase) continue;
+
+        /* The address can be reused by the next module, forget it */
+        if (LdrpExportHashCache == ExportHash) LdrpExportHashCache = NULL;
+
+        RemoveEntryList(&ExportHash->Links);
+        if (ExportHash->Buckets) RtlFreeHeap(LdrpHeap, 0, ExportHash->Buckets);
+        RtlFreeHeap(LdrpHeap, 0, ExportHash);
+        return;
+    }
+}
+
 
 NTSTATUS
 NTAPI
@@ -631,7 +760,27 @@ LdrpNameToOrdinal(IN LPSTR ImportName,
                   IN PULONG NameTable,
                   IN PUSHORT OrdinalTable)
 {
+    PLDRP_EXPORT_HASH ExportHash;
     LONG Start, End, Next, CmpResult;
+    ULONG Slot, Index;
+
+    /* Use the export hash of the module if it has one */
+    ExportHash = LdrpGetExportHash(ExportBase, NumberOfNames, NameTable);
+    if (ExportHash && ExportHash->Buckets)
+    {
+        Slot = LdrpHashExportName(ImportName) & ExportHash->Mask;
+        while ((Index = ExportHash->Buckets[Slot]))
+        {
+            /* Buckets hold the name index plus one */
+            if (!strcmp(ImportName, (PCHAR)((ULONG_PTR)ExportBase + NameTable[Index - 1])))
+                return OrdinalTable[Index - 1];
+
+            Slot = (Slot + 1) & ExportHash->Mask;
+        }
+
+        /* Reached a free bucket, the name is not exported */
+        return -1;
+    }
 
     /* Use classical binary search to find the ordinal */
     Start = Next = 0;
@@ -750,6 +899,9 @@ LdrpWalkImportDescriptor(IN LPWSTR DllPath OPTIONAL,
     /* Check if we got at least one */
     if ((BoundEntry) || (ImportEntry))
     {
+        /* Let the loader workers start mapping what we are about to load */
+        LdrpQueueLoadWork(DllPath, LdrEntry, BoundEntry, ImportEntry);
+
         /* Do we have a Bound IAT */
         if (BoundEntry)
         {
@@ -792,6 +944,9 @@ LdrpWalkImportDescriptor(IN LPWSTR DllPath OPTIONAL,
             /* Just to be safe */
             Status = STATUS_SUCCESS;
         }
+
+        /* Drop what the workers mapped for nothing once the outermost walk is done */
+        LdrpEndLoadWork();
     }
 
     /* Release the activation context */
@@ -1028,6 +1028,7 @@ LdrpMapDll(IN PWSTR SearchPath OPTIONAL,
     UNICODE_STRING IllegalDll;
     PVOID RelocData;
     ULONG RelocDataSize = 0;
+    BOOLEAN Relocated = FALSE;
 
     // FIXME: AppCompat stuff is missing
 
@@ -1077,6 +1078,28 @@ SkipCheck:
     /* Check if the Known DLL Check returned something */
     if (!SectionHandle)
     {
+        /* It didn't, check if a loader worker already mapped it */
+        if (!Redirect && !DllCharacteristics &&
+            LdrpTakeLoadWork(SearchPath,
+                             DllName,
+                             &FullDllName,
+                             &BaseDllName,
+                             &SectionHandle,
+                             &ViewBase,
+                             &ViewSize,
+                             &Status,
+                             &Relocated))
+        {
+            if (ShowSnaps)
+            {
+                DPRINT1("LDR: Loading (%s) %wZ, mapped by a loader worker\n",
+                        Static ? "STATIC" : "DYNAMIC",
+                        &FullDllName);
+            }
+
+            goto Mapped;
+        }
+
         /* It didn't, so try to resolve the name now */
         if (LdrpResolveDllName(SearchPath,
                                DllName,
@@ -1187,6 +1210,7 @@ SkipCheck:
         return Status;
     }
 
+Mapped:
     /* Get the NT Header */
     if (!(NtHeaders = RtlImageNtHeader(ViewBase)))
     {
@@ -1417,6 +1441,13 @@ SkipCheck:
                 goto FailRelocate;
             }
 
+            /* The loader worker may have applied the fixups already */
+            if (Relocated)
+            {
+                Status = STATUS_SUCCESS;
+                goto FailRelocate;
+            }
+
             /* Change the protection to prepare for relocation */
             Status = LdrpSetProtection(ViewBase, FALSE);
 
@@ -1591,6 +1622,9 @@ LdrpFinalizeAndDeallocateDataTableEntry(IN PLDR_DATA_TABLE_ENTRY Entry)
     /* Release the full dll name string */
     if (Entry->FullDllName.Buffer) LdrpFreeUnicodeString(&Entry->FullDllName);
 
+    /* Drop the export hash, the address may be reused by another module */
+    LdrpFreeExportHash(Entry->DllBase);
+
     /* Finally free the entry's memory */
     RtlFreeHeap(LdrpHeap, 0, Entry);
 }
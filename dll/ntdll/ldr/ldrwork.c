@@ -0,0 +1,656 @@
+/*
+ * PROJECT:     ReactOS NT User Mode Library
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Loader worker threads mapping imported DLLs in parallel
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+/*
+ * When the loader walks the import table of a module, the DLLs it names are
+ * handed to a few worker threads which resolve their paths, create and map
+ * their sections and apply the fixups while the loader is busy with the
+ * previous imports. LdrpMapDll then picks up the finished view instead of
+ * doing that work itself. Everything else (the module lists, snapping,
+ * initializer ordering, error reporting) stays on the loading thread, so a
+ * worker that fails simply drops its result and the serial path does the
+ * work again and reports the failure as before.
+ *
+ * The work list is only ever linked and unlinked by the thread holding the
+ * loader lock, under LdrpLoadWorkLock. Workers take queued items and flip
+ * their state under the same lock.
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <ntdll.h>
+
+#define NDEBUG
+#include <debug.h>
+
+/* GLOBALS *******************************************************************/
+
+/* Loader threads including the loading one, 0 or 1 keeps the loader serial */
+ULONG LdrpMaxLoaderThreads = LDRP_DEFAULT_LOADER_THREADS;
+
+static RTL_SRWLOCK LdrpLoadWorkLock = RTL_SRWLOCK_INIT;
+static LIST_ENTRY LdrpLoadWorkList = { &LdrpLoadWorkList, &LdrpLoadWorkList };
+static volatile LONG LdrpLoadWorkSequence;
+static ULONG LdrpLoadWorkDepth;
+static ULONG LdrpLoaderWorkerCount;
+static HANDLE LdrpLoaderWorkerIds[LDRP_MAX_LOADER_THREADS];
+
+/* FUNCTIONS *****************************************************************/
+
+static
+BOOLEAN
+LdrpSearchPathEqual(IN PWSTR SearchPath1 OPTIONAL,
+                    IN PWSTR SearchPath2 OPTIONAL)
+{
+    if (!SearchPath1 || !SearchPath2) return SearchPath1 == SearchPath2;
+    return wcscmp(SearchPath1, SearchPath2) == 0;
+}
+
+static
+PLDRP_LOAD_WORK
+LdrpFindLoadWork(IN PWSTR SearchPath OPTIONAL,
+                 IN PUNICODE_STRING DllName)
+{
+    PLIST_ENTRY ListEntry;
+    PLDRP_LOAD_WORK Work;
+
+    for (ListEntry = LdrpLoadWorkList.Flink;
+         ListEntry != &LdrpLoadWorkList;
+         ListEntry = ListEntry->Flink)
+    {
+        Work = CONTAINING_RECORD(ListEntry, LDRP_LOAD_WORK, Links);
+
+        if (RtlEqualUnicodeString(&Work->DllName, DllName, TRUE) &&
+            LdrpSearchPathEqual(Work->SearchPath, SearchPath))
+        {
+            return Work;
+        }
+    }
+
+    return NULL;
+}
+
+static
+VOID
+LdrpWaitForLoadWork(IN PLDRP_LOAD_WORK Work)
+{
+    LONG State = LdrpLoadWorkRunning;
+
+    /* Called with the lock held, which the worker needs to finish */
+    RtlReleaseSRWLockExclusive(&LdrpLoadWorkLock);
+
+    while (Work->State == LdrpLoadWorkRunning)
+    {
+        RtlWaitOnAddress(&Work->State, &State, sizeof(State), NULL);
+    }
+
+    RtlAcquireSRWLockExclusive(&LdrpLoadWorkLock);
+}
+
+static
+VOID
+LdrpFreeLoadWork(IN PLDRP_LOAD_WORK Work)
+{
+    /* Throw away a result nobody asked for */
+    if (Work->ViewBase) NtUnmapViewOfSection(NtCurrentProcess(), Work->ViewBase);
+    if (Work->SectionHandle) NtClose(Work->SectionHandle);
+    LdrpFreeUnicodeString(&Work->FullDllName);
+    LdrpFreeUnicodeString(&Work->BaseDllName);
+
+    RtlFreeHeap(LdrpHeap, 0, Work);
+}
+
+static
+NTSTATUS
+LdrpCreateLoadWorkSection(IN PUNICODE_STRING NtPathName,
+                          OUT PHANDLE SectionHandle)
+{
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK IoStatusBlock;
+    SECTION_IMAGE_INFORMATION SectionImageInfo;
+    HANDLE FileHandle;
+    NTSTATUS Status;
+
+    /* Same as LdrpCreateDllSection, minus the hard errors */
+    InitializeObjectAttributes(&ObjectAttributes,
+                               NtPathName,
+                               OBJ_CASE_INSENSITIVE,
+                               NULL,
+                               NULL);
+
+    Status = NtOpenFile(&FileHandle,
+                        SYNCHRONIZE | FILE_EXECUTE | FILE_READ_DATA,
+                        &ObjectAttributes,
+                        &IoStatusBlock,
+                        FILE_SHARE_READ | FILE_SHARE_DELETE,
+                        FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT);
+    if (!NT_SUCCESS(Status))
+    {
+        Status = NtOpenFile(&FileHandle,
+                            SYNCHRONIZE | FILE_EXECUTE,
+                            &ObjectAttributes,
+                            &IoStatusBlock,
+                            FILE_SHARE_READ | FILE_SHARE_DELETE,
+                            FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT);
+        if (!NT_SUCCESS(Status)) return Status;
+    }
+
+    Status = NtCreateSection(SectionHandle,
+                             SECTION_MAP_READ | SECTION_MAP_EXECUTE |
+                             SECTION_MAP_WRITE | SECTION_QUERY,
+                             NULL,
+                             NULL,
+                             PAGE_EXECUTE,
+                             SEC_IMAGE,
+                             FileHandle);
+    NtClose(FileHandle);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    /* Check with Safer, unless this is a .NET image */
+    Status = ZwQuerySection(*SectionHandle,
+                            SectionImageInformation,
+                            &SectionImageInfo,
+                            sizeof(SECTION_IMAGE_INFORMATION),
+                            NULL);
+    if (NT_SUCCESS(Status) &&
+        !(SectionImageInfo.LoaderFlags & IMAGE_LOADER_FLAGS_COMPLUS))
+    {
+        Status = LdrpCodeAuthzCheckDllAllowed(NtPathName, NULL);
+    }
+
+    if (!NT_SUCCESS(Status))
+    {
+        NtClose(*SectionHandle);
+        *SectionHandle = NULL;
+    }
+
+    return Status;
+}
+
+static
+VOID
+LdrpRunLoadWork(IN PLDRP_LOAD_WORK Work)
+{
+    PTEB Teb = NtCurrentTeb();
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    UNICODE_STRING NtPathName;
+    PIMAGE_NT_HEADERS NtHeaders;
+    HANDLE SectionHandle;
+    PVOID ArbitraryUserPointer, RelocData;
+    ULONG RelocDataSize = 0;
+    NTSTATUS Status;
+
+    /* Known DLLs come from their own section, leave them to LdrpMapDll */
+    if (LdrpKnownDllObjectDirectory)
+    {
+        InitializeObjectAttributes(&ObjectAttributes,
+                                   &Work->DllName,
+                                   OBJ_CASE_INSENSITIVE,
+                                   LdrpKnownDllObjectDirectory,
+                                   NULL);
+
+        Status = NtOpenSection(&SectionHandle, SECTION_MAP_READ, &ObjectAttributes);
+        if (NT_SUCCESS(Status))
+        {
+            NtClose(SectionHandle);
+            goto Done;
+        }
+    }
+
+    if (!LdrpResolveDllName(Work->SearchPath,
+                            Work->DllName.Buffer,
+                            &Work->FullDllName,
+                            &Work->BaseDllName))
+    {
+        RtlInitEmptyUnicodeString(&Work->FullDllName, NULL, 0);
+        RtlInitEmptyUnicodeString(&Work->BaseDllName, NULL, 0);
+        goto Done;
+    }
+
+    if (!RtlDosPathNameToNtPathName_U(Work->FullDllName.Buffer,
+                                      &NtPathName,
+                                      NULL,
+                                      NULL))
+    {
+        goto Done;
+    }
+
+    Status = LdrpCreateLoadWorkSection(&NtPathName, &Work->SectionHandle);
+    RtlFreeHeap(RtlGetProcessHeap(), 0, NtPathName.Buffer);
+    if (!NT_SUCCESS(Status)) goto Done;
+
+    /* Stuff the image name in the TIB, for the debugger */
+    ArbitraryUserPointer = Teb->NtTib.ArbitraryUserPointer;
+    Teb->NtTib.ArbitraryUserPointer = Work->FullDllName.Buffer;
+
+    Status = NtMapViewOfSection(Work->SectionHandle,
+                                NtCurrentProcess(),
+                                &Work->ViewBase,
+                                0,
+                                0,
+                                NULL,
+                                &Work->ViewSize,
+                                ViewShare,
+                                0,
+                                PAGE_READWRITE);
+
+    Teb->NtTib.ArbitraryUserPointer = ArbitraryUserPointer;
+
+    if (!NT_SUCCESS(Status))
+    {
+        Work->ViewBase = NULL;
+        goto Done;
+    }
+
+    Work->MapStatus = Status;
+
+    NtHeaders = RtlImageNtHeader(Work->ViewBase);
+    if (!NtHeaders)
+    {
+        /* LdrpMapDll reports this one */
+        NtUnmapViewOfSection(NtCurrentProcess(), Work->ViewBase);
+        Work->ViewBase = NULL;
+        goto Done;
+    }
+
+    /* Only apply the fixups LdrpMapDll would apply without asking anyone */
+    if ((Status == STATUS_IMAGE_NOT_AT_BASE) &&
+        (NtHeaders->FileHeader.Characteristics & IMAGE_FILE_DLL) &&
+        !(NtHeaders->FileHeader.Characteristics & IMAGE_FILE_RELOCS_STRIPPED))
+    {
+        RelocData = RtlImageDirectoryEntryToData(Work->ViewBase,
+                                                 TRUE,
+                                                 IMAGE_DIRECTORY_ENTRY_BASERELOC,
+                                                 &RelocDataSize);
+        if (RelocData && RelocDataSize)
+        {
+            Status = LdrpSetProtection(Work->ViewBase, FALSE);
+            if (NT_SUCCESS(Status))
+            {
+                Status = LdrRelocateImageWithBias(Work->ViewBase, 0LL, NULL, STATUS_SUCCESS,
+                    STATUS_CONFLICTING_ADDRESSES, STATUS_INVALID_IMAGE_FORMAT);
+
+                if (NT_SUCCESS(Status))
+                    Status = LdrpSetProtection(Work->ViewBase, TRUE);
+            }
+
+            if (!NT_SUCCESS(Status))
+            {
+                /* Let LdrpMapDll fail it with the right status */
+                NtUnmapViewOfSection(NtCurrentProcess(), Work->ViewBase);
+                Work->ViewBase = NULL;
+                goto Done;
+            }
+
+            Work->Relocated = TRUE;
+        }
+    }
+
+Done:
+    /* Anything but a mapped view means LdrpMapDll starts from scratch */
+    if (!Work->ViewBase && Work->SectionHandle)
+    {
+        NtClose(Work->SectionHandle);
+        Work->SectionHandle = NULL;
+    }
+
+    InterlockedExchange(&Work->State, LdrpLoadWorkDone);
+    RtlWakeAddressAll((PVOID)&Work->State);
+}
+
+static
+ULONG
+NTAPI
+LdrpLoaderWorkerThread(IN PVOID Parameter)
+{
+    PLIST_ENTRY ListEntry;
+    PLDRP_LOAD_WORK Work;
+    LARGE_INTEGER Timeout;
+    BOOLEAN TimedOut = FALSE;
+    LONG Sequence;
+    NTSTATUS Status;
+    ULONG i;
+
+    UNREFERENCED_PARAMETER(Parameter);
+
+    /* Idle workers go away after a while */
+    Timeout.QuadPart = Int32x32To64(LDRP_LOADER_WORKER_IDLE_TIMEOUT, -10000);
+
+    RtlAcquireSRWLockExclusive(&LdrpLoadWorkLock);
+
+    for (;;)
+    {
+        /* Take the oldest queued item */
+        Work = NULL;
+        for (ListEntry = LdrpLoadWorkList.Flink;
+             ListEntry != &LdrpLoadWorkList;
+             ListEntry = ListEntry->Flink)
+        {
+            Work = CONTAINING_RECORD(ListEntry, LDRP_LOAD_WORK, Links);
+            if (Work->State == LdrpLoadWorkQueued) break;
+            Work = NULL;
+        }
+
+        if (Work)
+        {
+            Work->State = LdrpLoadWorkRunning;
+            RtlReleaseSRWLockExclusive(&LdrpLoadWorkLock);
+
+            LdrpRunLoadWork(Work);
+
+            TimedOut = FALSE;
+            RtlAcquireSRWLockExclusive(&LdrpLoadWorkLock);
+            continue;
+        }
+
+        if (TimedOut) break;
+
+        Sequence = LdrpLoadWorkSequence;
+        RtlReleaseSRWLockExclusive(&LdrpLoadWorkLock);
+
+        Status = RtlWaitOnAddress(&LdrpLoadWorkSequence, &Sequence, sizeof(Sequence), &Timeout);
+        TimedOut = (Status == STATUS_TIMEOUT);
+
+        RtlAcquireSRWLockExclusive(&LdrpLoadWorkLock);
+    }
+
+    /* Nothing is queued and we hold the lock, so nobody is counting on us */
+    for (i = 0; i < LDRP_MAX_LOADER_THREADS; i++)
+    {
+        if (LdrpLoaderWorkerIds[i] == NtCurrentTeb()->ClientId.UniqueThread)
+        {
+            LdrpLoaderWorkerIds[i] = NULL;
+            break;
+        }
+    }
+    LdrpLoaderWorkerCount--;
+
+    RtlReleaseSRWLockExclusive(&LdrpLoadWorkLock);
+
+    /* We never went through LdrpInitializeThread, so don't call LdrShutdownThread */
+    NtCurrentTeb()->FreeStackOnTermination = TRUE;
+    NtTerminateThread(NtCurrentThread(), STATUS_SUCCESS);
+    return 0;
+}
+
+static
+VOID
+LdrpCreateLoaderWorker(VOID)
+{
+    CLIENT_ID ClientId;
+    HANDLE ThreadHandle;
+    NTSTATUS Status;
+    ULONG i;
+
+    /* The workers sleep in RtlWaitOnAddress. Its keyed event was created
+       before the first import walk, so they and their wakers agree on it */
+
+    /* Find a free slot, the count says there is one */
+    for (i = 0; i < LDRP_MAX_LOADER_THREADS; i++)
+    {
+        if (!LdrpLoaderWorkerIds[i]) break;
+    }
+    ASSERT(i < LDRP_MAX_LOADER_THREADS);
+
+    Status = RtlCreateUserThread(NtCurrentProcess(),
+                                 NULL,
+                                 TRUE,
+                                 0,
+                                 0,
+                                 0,
+                                 LdrpLoaderWorkerThread,
+                                 NULL,
+                                 &ThreadHandle,
+                                 &ClientId);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("LDR: Failed to create a loader worker, Status 0x%08lx\n", Status);
+        return;
+    }
+
+    /* LdrpInit looks for the thread here before it runs */
+    LdrpLoaderWorkerIds[i] = ClientId.UniqueThread;
+    LdrpLoaderWorkerCount++;
+
+    NtResumeThread(ThreadHandle, NULL);
+    NtClose(ThreadHandle);
+}
+
+static
+BOOLEAN
+LdrpQueueOneLoadWork(IN PWSTR DllPath OPTIONAL,
+                     IN LPSTR ImportName)
+{
+    PLDRP_LOAD_WORK Work;
+    PLDR_DATA_TABLE_ENTRY LdrEntry;
+    UNICODE_STRING DllName;
+    ANSI_STRING AnsiString;
+    WCHAR NameBuffer[MAX_PATH];
+    SIZE_T PathSize = 0, Size;
+    PWCHAR p;
+    BOOLEAN GotExtension = FALSE;
+
+    /* Build the name the same way LdrpLoadImportModule does */
+    RtlInitEmptyUnicodeString(&DllName, NameBuffer, sizeof(NameBuffer));
+    RtlInitAnsiString(&AnsiString, ImportName);
+    if (!NT_SUCCESS(RtlAnsiStringToUnicodeString(&DllName, &AnsiString, FALSE)))
+        return FALSE;
+
+    for (p = DllName.Buffer; p < DllName.Buffer + DllName.Length / sizeof(WCHAR); p++)
+    {
+        /* Names with a path don't go through the search path, skip them */
+        if (*p == L'\\' || *p == L'/') return FALSE;
+        if (*p == L'.') GotExtension = TRUE;
+    }
+
+    if (!GotExtension &&
+        !NT_SUCCESS(RtlAppendUnicodeStringToString(&DllName, &LdrApiDefaultExtension)))
+    {
+        return FALSE;
+    }
+
+    /* Skip what is already loaded or queued */
+    if (LdrpCheckForLoadedDll(DllPath, &DllName, TRUE, FALSE, &LdrEntry)) return FALSE;
+    if (LdrpFindLoadWork(DllPath, &DllName)) return FALSE;
+
+    /* One allocation for the item, the name and a copy of the search path */
+    if (DllPath) PathSize = (wcslen(DllPath) + 1) * sizeof(WCHAR);
+    Size = sizeof(LDRP_LOAD_WORK) + DllName.Length + sizeof(UNICODE_NULL) + PathSize;
+
+    Work = RtlAllocateHeap(LdrpHeap, HEAP_ZERO_MEMORY, Size);
+    if (!Work) return FALSE;
+
+    Work->State = LdrpLoadWorkQueued;
+    Work->DllName.Buffer = (PWSTR)(Work + 1);
+    Work->DllName.Length = DllName.Length;
+    Work->DllName.MaximumLength = DllName.Length + sizeof(UNICODE_NULL);
+    RtlCopyMemory(Work->DllName.Buffer, DllName.Buffer, DllName.Length);
+
+    if (DllPath)
+    {
+        Work->SearchPath = (PWSTR)((ULONG_PTR)Work->DllName.Buffer + Work->DllName.MaximumLength);
+        RtlCopyMemory(Work->SearchPath, DllPath, PathSize);
+    }
+
+    RtlAcquireSRWLockExclusive(&LdrpLoadWorkLock);
+    InsertTailList(&LdrpLoadWorkList, &Work->Links);
+    RtlReleaseSRWLockExclusive(&LdrpLoadWorkLock);
+
+    if (ShowSnaps)
+    {
+        DPRINT1("LDR: Queued %wZ for a loader worker\n", &Work->DllName);
+    }
+
+    return TRUE;
+}
+
+BOOLEAN
+NTAPI
+LdrpIsLoaderWorkerThread(VOID)
+{
+    HANDLE ThreadId = NtCurrentTeb()->ClientId.UniqueThread;
+    ULONG i;
+
+    for (i = 0; i < LDRP_MAX_LOADER_THREADS; i++)
+    {
+        if (LdrpLoaderWorkerIds[i] == ThreadId) return TRUE;
+    }
+
+    return FALSE;
+}
+
+VOID
+NTAPI
+LdrpQueueLoadWork(IN PWSTR DllPath OPTIONAL,
+                  IN PLDR_DATA_TABLE_ENTRY LdrEntry,
+                  IN PIMAGE_BOUND_IMPORT_DESCRIPTOR BoundEntry OPTIONAL,
+                  IN PIMAGE_IMPORT_DESCRIPTOR ImportEntry OPTIONAL)
+{
+    PIMAGE_BOUND_IMPORT_DESCRIPTOR FirstEntry = BoundEntry;
+    PIMAGE_THUNK_DATA FirstThunk;
+    ULONG Queued = 0, Workers, Count;
+
+    /* Paired with LdrpEndLoadWork, even when nothing gets queued */
+    LdrpEnsureLoaderLockIsHeld();
+    LdrpLoadWorkDepth++;
+
+    if ((LdrpMaxLoaderThreads <= 1) || (LdrpNumberOfProcessors <= 1)) return;
+
+    if (BoundEntry)
+    {
+        while (BoundEntry->OffsetModuleName)
+        {
+            if (LdrpQueueOneLoadWork(DllPath, (LPSTR)FirstEntry + BoundEntry->OffsetModuleName))
+                Queued++;
+
+            /* The forwarder references follow the descriptor */
+            BoundEntry = (PIMAGE_BOUND_IMPORT_DESCRIPTOR)((PIMAGE_BOUND_FORWARDER_REF)(BoundEntry + 1) +
+                                                          BoundEntry->NumberOfModuleForwarderRefs);
+        }
+    }
+    else if (ImportEntry)
+    {
+        while ((ImportEntry->Name) && (ImportEntry->FirstThunk))
+        {
+            /* Same check as LdrpHandleOneOldFormatImportDescriptor */
+            FirstThunk = (PIMAGE_THUNK_DATA)((ULONG_PTR)LdrEntry->DllBase + ImportEntry->FirstThunk);
+            if ((FirstThunk->u1.Function) &&
+                LdrpQueueOneLoadWork(DllPath, (LPSTR)((ULONG_PTR)LdrEntry->DllBase + ImportEntry->Name)))
+            {
+                Queued++;
+            }
+
+            ImportEntry++;
+        }
+    }
+
+    /* The loading thread takes the first one itself, nothing to hand out */
+    if (Queued < 2) return;
+
+    Workers = LdrpMaxLoaderThreads - 1;
+    if (Workers > LDRP_MAX_LOADER_THREADS) Workers = LDRP_MAX_LOADER_THREADS;
+    if (Workers > Queued - 1) Workers = Queued - 1;
+
+    RtlAcquireSRWLockExclusive(&LdrpLoadWorkLock);
+
+    LdrpLoadWorkSequence++;
+    while (LdrpLoaderWorkerCount < Workers)
+    {
+        Count = LdrpLoaderWorkerCount;
+        LdrpCreateLoaderWorker();
+        if (LdrpLoaderWorkerCount == Count) break;
+    }
+
+    RtlReleaseSRWLockExclusive(&LdrpLoadWorkLock);
+
+    /* Wake the idle ones */
+    RtlWakeAddressAll((PVOID)&LdrpLoadWorkSequence);
+}
+
+BOOLEAN
+NTAPI
+LdrpTakeLoadWork(IN PWSTR SearchPath OPTIONAL,
+                 IN PWSTR DllName,
+                 OUT PUNICODE_STRING FullDllName,
+                 OUT PUNICODE_STRING BaseDllName,
+                 OUT PHANDLE SectionHandle,
+                 OUT PVOID *ViewBase,
+                 OUT PSIZE_T ViewSize,
+                 OUT PNTSTATUS MapStatus,
+                 OUT PBOOLEAN Relocated)
+{
+    PLDRP_LOAD_WORK Work;
+    UNICODE_STRING DllNameString;
+    BOOLEAN Found = FALSE;
+
+    /* Only the thread holding the loader lock links and unlinks items */
+    if (IsListEmpty(&LdrpLoadWorkList)) return FALSE;
+
+    RtlInitUnicodeString(&DllNameString, DllName);
+
+    RtlAcquireSRWLockExclusive(&LdrpLoadWorkLock);
+
+    Work = LdrpFindLoadWork(SearchPath, &DllNameString);
+    if (Work)
+    {
+        /* If nobody started it yet, doing it here beats waiting for it */
+        if (Work->State == LdrpLoadWorkRunning) LdrpWaitForLoadWork(Work);
+        RemoveEntryList(&Work->Links);
+
+        if (Work->State == LdrpLoadWorkDone && Work->ViewBase)
+        {
+            /* Hand the strings, the section and the view over */
+            *FullDllName = Work->FullDllName;
+            *BaseDllName = Work->BaseDllName;
+            *SectionHandle = Work->SectionHandle;
+            *ViewBase = Work->ViewBase;
+            *ViewSize = Work->ViewSize;
+            *MapStatus = Work->MapStatus;
+            *Relocated = Work->Relocated;
+
+            RtlInitEmptyUnicodeString(&Work->FullDllName, NULL, 0);
+            RtlInitEmptyUnicodeString(&Work->BaseDllName, NULL, 0);
+            Work->SectionHandle = NULL;
+            Work->ViewBase = NULL;
+            Found = TRUE;
+        }
+    }
+
+    RtlReleaseSRWLockExclusive(&LdrpLoadWorkLock);
+
+    if (Work) LdrpFreeLoadWork(Work);
+    return Found;
+}
+
+VOID
+NTAPI
+LdrpEndLoadWork(VOID)
+{
+    PLDRP_LOAD_WORK Work;
+
+    ASSERT(LdrpLoadWorkDepth > 0);
+    if (--LdrpLoadWorkDepth) return;
+
+    /* The outermost walk is done, whatever is left was not needed */
+    RtlAcquireSRWLockExclusive(&LdrpLoadWorkLock);
+
+    while (!IsListEmpty(&LdrpLoadWorkList))
+    {
+        Work = CONTAINING_RECORD(LdrpLoadWorkList.Flink, LDRP_LOAD_WORK, Links);
+
+        if (Work->State == LdrpLoadWorkRunning) LdrpWaitForLoadWork(Work);
+        RemoveEntryList(&Work->Links);
+
+        RtlReleaseSRWLockExclusive(&LdrpLoadWorkLock);
+        LdrpFreeLoadWork(Work);
+        RtlAcquireSRWLockExclusive(&LdrpLoadWorkLock);
+    }
+
+    RtlReleaseSRWLockExclusive(&LdrpLoadWorkLock);
+}
+
+/* EOF */
@@ -19,6 +19,10 @@
 @ stdcall WakeAllConditionVariable(ptr)
 @ stdcall WakeConditionVariable(ptr)
 
+@ stdcall WaitOnAddress(ptr ptr long long)
+@ stdcall WakeByAddressAll(ptr)
+@ stdcall WakeByAddressSingle(ptr)
+
 @ stdcall InitializeCriticalSectionEx(ptr long long)
 
 @ stdcall GetFirmwareEnvironmentVariableExA(str str ptr long long)
@@ -100,6 +100,40 @@ WakeConditionVariable(PCONDITION_VARIABLE ConditionVariable)
     RtlWakeConditionVariable((PRTL_CONDITION_VARIABLE)ConditionVariable);
 }
 
+BOOL
+WINAPI
+WaitOnAddress(volatile VOID *Address, PVOID CompareAddress, SIZE_T AddressSize, DWORD dwMilliseconds)
+{
+    NTSTATUS Status;
+    LARGE_INTEGER Time;
+
+    Status = RtlWaitOnAddress(Address, CompareAddress, AddressSize, GetNtTimeout(&Time, dwMilliseconds));
+    if (Status == STATUS_TIMEOUT)
+    {
+        SetLastError(ERROR_TIMEOUT);
+        return FALSE;
+    }
+    if (!NT_SUCCESS(Status))
+    {
+        SetLastError(RtlNtStatusToDosError(Status));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+VOID
+WINAPI
+WakeByAddressSingle(PVOID Address)
+{
+    RtlWakeAddressSingle(Address);
+}
+
+VOID
+WINAPI
+WakeByAddressAll(PVOID Address)
+{
+    RtlWakeAddressAll(Address);
+}
 
 /*
 * @implemented
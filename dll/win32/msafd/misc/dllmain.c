@@ -2490,6 +2490,8 @@ WSPIoctl(IN  SOCKET Handle,
                 GUID ConnectExGUID = WSAID_CONNECTEX;
                 GUID DisconnectExGUID = WSAID_DISCONNECTEX;
                 GUID GetAcceptExSockaddrsGUID = WSAID_GETACCEPTEXSOCKADDRS;
+                GUID TransmitFileGUID = WSAID_TRANSMITFILE;
+                GUID TransmitPacketsGUID = WSAID_TRANSMITPACKETS;
 
                 if (IsEqualGUID(&AcceptExGUID, lpvInBuffer))
                 {
@@ -2512,6 +2514,20 @@ WSPIoctl(IN  SOCKET Handle,
                     Errno = NO_ERROR;
                     Ret = NO_ERROR;
                 }
+                else if (IsEqualGUID(&TransmitFileGUID, lpvInBuffer))
+                {
+                    *((PVOID *)lpvOutBuffer) = WSPTransmitFile;
+                    cbRet = sizeof(PVOID);
+                    Errno = NO_ERROR;
+                    Ret = NO_ERROR;
+                }
+                else if (IsEqualGUID(&TransmitPacketsGUID, lpvInBuffer))
+                {
+                    *((PVOID *)lpvOutBuffer) = WSPTransmitPackets;
+                    cbRet = sizeof(PVOID);
+                    Errno = NO_ERROR;
+                    Ret = NO_ERROR;
+                }
                 else if (IsEqualGUID(&GetAcceptExSockaddrsGUID, lpvInBuffer))
                 {
                     *((PVOID *)lpvOutBuffer) = WSPGetAcceptExSockaddrs;
@@ -2792,6 +2808,7 @@ WSPSetSockOpt(
 {
     PSOCKET_INFORMATION Socket;
     INT Errno;
+    ULONG ReceiveWindow;
 
     /* Get the Socket Structure associate to this Socket*/
     Socket = GetSocketStructure(s);
@@ -2899,6 +2916,9 @@ WSPSetSockOpt(
                   return SOCKET_ERROR;
               }
 
+              /* The transport gets the window the application asked for */
+              ReceiveWindow = *(PULONG)optval;
+
               /* FIXME: We should not have to limit the packet receive buffer size like this. workaround for CORE-15804 */
               if (*(PULONG)optval > 0x2000)
                   *(PULONG)optval = 0x2000;
@@ -2918,6 +2938,16 @@ WSPSetSockOpt(
                                    NULL,
                                    NULL);
 
+              /* Let the helper size the transport receive window too, this is best effort */
+              Socket->HelperData->WSHSetSocketInformation(Socket->HelperContext,
+                                                          s,
+                                                          Socket->TdiAddressHandle,
+                                                          Socket->TdiConnectionHandle,
+                                                          level,
+                                                          optname,
+                                                          (PCHAR)&ReceiveWindow,
+                                                          sizeof(ReceiveWindow));
+
               return NO_ERROR;
 
            case SO_ERROR:
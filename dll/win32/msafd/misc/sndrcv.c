@@ -933,6 +933,180 @@ WSPRecvDisconnect(IN  SOCKET s,
 
 
 
+C_ASSERT(sizeof(AFD_TRANSMIT_ELEMENT) == sizeof(TRANSMIT_PACKETS_ELEMENT));
+C_ASSERT(FIELD_OFFSET(AFD_TRANSMIT_ELEMENT, Buffer) == FIELD_OFFSET(TRANSMIT_PACKETS_ELEMENT, pBuffer));
+
+/* Issues a transmit request, the extension functions report errors through WSASetLastError */
+static
+BOOL
+MsafdTransmit(SOCKET Handle,
+              ULONG IoControlCode,
+              PVOID TransmitInfo,
+              ULONG TransmitInfoLength,
+              LPOVERLAPPED lpOverlapped)
+{
+    PIO_STATUS_BLOCK        IOSB;
+    IO_STATUS_BLOCK         DummyIOSB;
+    NTSTATUS                Status;
+    PVOID                   APCContext;
+    HANDLE                  Event;
+    HANDLE                  SockEvent;
+    PSOCKET_INFORMATION     Socket;
+    INT                     Errno;
+
+    /* Get the Socket Structure associate to this Socket*/
+    Socket = GetSocketStructure(Handle);
+    if (!Socket)
+    {
+        WSASetLastError(WSAENOTSOCK);
+        return FALSE;
+    }
+
+    Status = NtCreateEvent(&SockEvent, EVENT_ALL_ACCESS,
+                           NULL, SynchronizationEvent, FALSE);
+    if (!NT_SUCCESS(Status))
+    {
+        WSASetLastError(TranslateNtStatusError(Status));
+        return FALSE;
+    }
+
+    if (lpOverlapped == NULL)
+    {
+        /* Not using Overlapped structure, so use normal blocking on event */
+        APCContext = NULL;
+        Event = SockEvent;
+        IOSB = &DummyIOSB;
+    }
+    else
+    {
+        APCContext = lpOverlapped;
+        Event = lpOverlapped->hEvent;
+        IOSB = (PIO_STATUS_BLOCK)&lpOverlapped->Internal;
+    }
+
+    IOSB->Status = STATUS_PENDING;
+
+    /* The driver captures the request before the call returns */
+    Status = NtDeviceIoControlFile((HANDLE)Handle,
+                                   Event,
+                                   NULL,
+                                   APCContext,
+                                   IOSB,
+                                   IoControlCode,
+                                   TransmitInfo,
+                                   TransmitInfoLength,
+                                   NULL,
+                                   0);
+
+    /* Wait for completion of not overlapped */
+    if (Status == STATUS_PENDING && lpOverlapped == NULL)
+    {
+        WaitForSingleObject(SockEvent, INFINITE);
+        Status = IOSB->Status;
+    }
+
+    NtClose(SockEvent);
+
+    if (Status != STATUS_PENDING)
+    {
+        /* Re-enable Async Event */
+        SockReenableAsyncSelectEvent(Socket, FD_WRITE);
+    }
+
+    TRACE("Leaving (0x%x, %d)\n", Status, IOSB->Information);
+
+    Errno = TranslateNtStatusError(Status);
+    if (Errno != NO_ERROR)
+    {
+        WSASetLastError(Errno);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL
+WSPAPI
+WSPTransmitFile(
+    IN SOCKET hSocket,
+    IN HANDLE hFile,
+    IN DWORD nNumberOfBytesToWrite,
+    IN DWORD nNumberOfBytesPerSend,
+    IN OUT LPOVERLAPPED lpOverlapped,
+    IN LPTRANSMIT_FILE_BUFFERS lpTransmitBuffers,
+    IN DWORD dwFlags)
+{
+    AFD_TRANSMIT_FILE_INFO TransmitInfo;
+
+    TRACE("Called (%x, %p, %lu)\n", hSocket, hFile, nNumberOfBytesToWrite);
+
+    RtlZeroMemory(&TransmitInfo, sizeof(TransmitInfo));
+    TransmitInfo.FileHandle = hFile;
+    TransmitInfo.Length = nNumberOfBytesToWrite;
+    TransmitInfo.SendSize = nNumberOfBytesPerSend;
+
+    /* Overlapped requests say where to start, the others start at the file pointer */
+    if (lpOverlapped)
+    {
+        TransmitInfo.Offset.u.LowPart = lpOverlapped->Offset;
+        TransmitInfo.Offset.u.HighPart = lpOverlapped->OffsetHigh;
+    }
+    else
+    {
+        TransmitInfo.Offset.QuadPart = AFD_TRANSMIT_CURRENT_OFFSET;
+    }
+
+    if (lpTransmitBuffers)
+    {
+        TransmitInfo.Head = lpTransmitBuffers->Head;
+        TransmitInfo.HeadLength = lpTransmitBuffers->HeadLength;
+        TransmitInfo.Tail = lpTransmitBuffers->Tail;
+        TransmitInfo.TailLength = lpTransmitBuffers->TailLength;
+    }
+
+    if (dwFlags & TF_DISCONNECT)
+        TransmitInfo.Flags |= AFD_TF_DISCONNECT;
+    if (dwFlags & TF_REUSE_SOCKET)
+        TransmitInfo.Flags |= AFD_TF_REUSE_SOCKET;
+
+    return MsafdTransmit(hSocket,
+                         IOCTL_AFD_TRANSMIT_FILE,
+                         &TransmitInfo,
+                         sizeof(TransmitInfo),
+                         lpOverlapped);
+}
+
+BOOL
+WSPAPI
+WSPTransmitPackets(
+    IN SOCKET hSocket,
+    IN LPTRANSMIT_PACKETS_ELEMENT lpPacketArray,
+    IN DWORD nElementCount,
+    IN DWORD nSendSize,
+    IN OUT LPOVERLAPPED lpOverlapped,
+    IN DWORD dwFlags)
+{
+    AFD_TRANSMIT_PACKETS_INFO TransmitInfo;
+
+    TRACE("Called (%x, %p, %lu)\n", hSocket, lpPacketArray, nElementCount);
+
+    RtlZeroMemory(&TransmitInfo, sizeof(TransmitInfo));
+    TransmitInfo.ElementArray = (PAFD_TRANSMIT_ELEMENT)lpPacketArray;
+    TransmitInfo.ElementCount = nElementCount;
+    TransmitInfo.SendSize = nSendSize;
+
+    if (dwFlags & TP_DISCONNECT)
+        TransmitInfo.Flags |= AFD_TF_DISCONNECT;
+    if (dwFlags & TP_REUSE_SOCKET)
+        TransmitInfo.Flags |= AFD_TF_REUSE_SOCKET;
+
+    return MsafdTransmit(hSocket,
+                         IOCTL_AFD_TRANSMIT_PACKETS,
+                         &TransmitInfo,
+                         sizeof(TransmitInfo),
+                         lpOverlapped);
+}
+
 INT
 WSPAPI
 WSPSendDisconnect(IN  SOCKET s,
@@ -174,6 +174,10 @@ GetTdiTypeId(
                 /* FIXME: Return proper option */
                 ASSERT(FALSE);
                 break;
+             case SO_RCVBUF:
+                *TdiType = INFO_TYPE_CONNECTION;
+                *TdiId = TCP_SOCKET_WINDOW;
+                return;
              default:
                 break;
           }
@@ -694,6 +698,18 @@ WSHSetSocketInformation(
                     DPRINT1("Set: SO_KEEPALIVE not yet supported\n");
                     return 0;
 
+                case SO_RCVBUF:
+                    if (OptionLength < sizeof(ULONG))
+                    {
+                        return WSAEFAULT;
+                    }
+                    /* Only TCP has a receive window, send it to TCPIP */
+                    if (Context->SocketType != SOCK_STREAM)
+                    {
+                        return 0;
+                    }
+                    break;
+
                 default:
                     /* Invalid option */
                     DPRINT1("Set: Received unexpected SOL_SOCKET option %d\n", OptionName);
@@ -181,6 +181,9 @@ FdoEnumerateDevices(
                               &PciConfig,
                               sizeof(PCI_COMMON_CONFIG));
 
+                Device->MsiCapability = PciFindCapability(Device, PCI_CAPABILITY_ID_MSI);
+                Device->MsixCapability = PciFindCapability(Device, PCI_CAPABILITY_ID_MSIX);
+
                 ExInterlockedInsertTailList(
                     &DeviceExtension->DeviceListHead,
                     &Device->ListEntry,
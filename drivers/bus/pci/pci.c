@@ -755,4 +755,60 @@ PciDuplicateUnicodeString(
     return STATUS_SUCCESS;
 }
 
+UCHAR
+PciFindCapability(
+    IN PPCI_DEVICE Device,
+    IN UCHAR CapabilityId)
+{
+    PCI_CAPABILITIES_HEADER Header;
+    ULONG Count;
+    UCHAR Offset;
+
+    if (!(Device->PciConfig.Status & PCI_STATUS_CAPABILITIES_LIST))
+        return 0;
+
+    switch (PCI_CONFIGURATION_TYPE(&Device->PciConfig))
+    {
+        case PCI_DEVICE_TYPE:
+            Offset = Device->PciConfig.u.type0.CapabilitiesPtr;
+            break;
+
+        case PCI_BRIDGE_TYPE:
+            Offset = Device->PciConfig.u.type1.CapabilitiesPtr;
+            break;
+
+        case PCI_CARDBUS_BRIDGE_TYPE:
+            Offset = Device->PciConfig.u.type2.CapabilitiesPtr;
+            break;
+
+        default:
+            return 0;
+    }
+
+    /* Bound the walk, a broken device could have a loop in its list */
+    for (Count = 0; Offset != 0 && Count < 48; Count++)
+    {
+        Offset &= ~3;
+        if (Offset < PCI_COMMON_HDR_LENGTH)
+            break;
+
+        if (HalGetBusDataByOffset(PCIConfiguration,
+                                  Device->BusNumber,
+                                  Device->SlotNumber.u.AsULONG,
+                                  &Header,
+                                  Offset,
+                                  sizeof(Header)) != sizeof(Header))
+        {
+            break;
+        }
+
+        if (Header.CapabilityID == CapabilityId)
+            return Offset;
+
+        Offset = Header.Next;
+    }
+
+    return 0;
+}
+
 /* EOF */
@@ -7,6 +7,34 @@
 
 #define TAG_PCI '0ICP'
 
+/* MSI capability registers */
+#define PCI_MSI_MESSAGE_CONTROL         0x02
+#define  PCI_MSI_CONTROL_ENABLE         0x0001
+#define  PCI_MSI_CONTROL_MME_MASK       0x0070
+#define  PCI_MSI_CONTROL_64BIT          0x0080
+#define PCI_MSI_MESSAGE_ADDRESS         0x04
+#define PCI_MSI_MESSAGE_UPPER_ADDRESS   0x08
+#define PCI_MSI_MESSAGE_DATA_32         0x08
+#define PCI_MSI_MESSAGE_DATA_64         0x0C
+
+/* MSI-X capability registers */
+#define PCI_MSIX_MESSAGE_CONTROL        0x02
+#define  PCI_MSIX_CONTROL_TABLE_SIZE    0x07FF
+#define  PCI_MSIX_CONTROL_FUNCTION_MASK 0x4000
+#define  PCI_MSIX_CONTROL_ENABLE        0x8000
+#define PCI_MSIX_TABLE_OFFSET           0x04
+#define  PCI_MSIX_TABLE_BIR_MASK        0x00000007
+
+/* MSI-X table entries */
+#define PCI_MSIX_ENTRY_SIZE             16
+#define PCI_MSIX_ENTRY_ADDRESS          0x00
+#define PCI_MSIX_ENTRY_UPPER_ADDRESS    0x04
+#define PCI_MSIX_ENTRY_DATA             0x08
+#define PCI_MSIX_ENTRY_CONTROL          0x0C
+#define  PCI_MSIX_ENTRY_MASKED          0x00000001
+
+NTHALAPI NTSTATUS NTAPI HalGetMessageRoutingInfo(ULONG, KAFFINITY, PPHYSICAL_ADDRESS, PULONG);
+
 typedef struct _PCI_DEVICE
 {
     // Entry on device list
@@ -27,6 +55,12 @@ typedef struct _PCI_DEVICE
     BOOLEAN EnableBusMaster;
     // Whether the device is owned by the KD
     BOOLEAN IsDebuggingDevice;
+    // Offset of the MSI capability, 0 if there is none
+    UCHAR MsiCapability;
+    // Offset of the MSI-X capability, 0 if there is none
+    UCHAR MsixCapability;
+    // Number of messages enabled on the device
+    ULONG MessageCount;
 } PCI_DEVICE, *PPCI_DEVICE;
 
 
@@ -180,6 +214,11 @@ PciDuplicateUnicodeString(
     IN PCUNICODE_STRING SourceString,
     OUT PUNICODE_STRING DestinationString);
 
+UCHAR
+PciFindCapability(
+    IN PPCI_DEVICE Device,
+    IN UCHAR CapabilityId);
+
 /* pdo.c */
 
 NTSTATUS
@@ -1316,6 +1316,438 @@ PdoQueryInterface(
     return Status;
 }
 
+static VOID
+PdoReadDeviceConfig(
+    IN PPCI_DEVICE Device,
+    OUT PVOID Buffer,
+    IN ULONG Offset,
+    IN ULONG Length)
+{
+    HalGetBusDataByOffset(PCIConfiguration,
+                          Device->BusNumber,
+                          Device->SlotNumber.u.AsULONG,
+                          Buffer,
+                          Offset,
+                          Length);
+}
+
+static VOID
+PdoWriteDeviceConfig(
+    IN PPCI_DEVICE Device,
+    IN PVOID Buffer,
+    IN ULONG Offset,
+    IN ULONG Length)
+{
+    HalSetBusDataByOffset(PCIConfiguration,
+                          Device->BusNumber,
+                          Device->SlotNumber.u.AsULONG,
+                          Buffer,
+                          Offset,
+                          Length);
+}
+
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+static BOOLEAN
+PdoIsMessageSignaledInterruptSupported(
+    IN PDEVICE_OBJECT DeviceObject,
+    OUT PULONG MessageNumberLimit)
+{
+    UNICODE_STRING KeyName = RTL_CONSTANT_STRING(L"Interrupt Management\\MessageSignaledInterruptProperties");
+    RTL_QUERY_REGISTRY_TABLE QueryTable[3];
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    HANDLE DeviceKey, KeyHandle;
+    ULONG Supported = 0, Limit = 0;
+    NTSTATUS Status;
+
+    /* Function drivers opt in from their INF, in the device parameters key */
+    Status = IoOpenDeviceRegistryKey(DeviceObject,
+                                     PLUGPLAY_REGKEY_DEVICE,
+                                     KEY_READ,
+                                     &DeviceKey);
+    if (!NT_SUCCESS(Status))
+        return FALSE;
+
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &KeyName,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               DeviceKey,
+                               NULL);
+    Status = ZwOpenKey(&KeyHandle, KEY_READ, &ObjectAttributes);
+    ZwClose(DeviceKey);
+    if (!NT_SUCCESS(Status))
+        return FALSE;
+
+    RtlZeroMemory(QueryTable, sizeof(QueryTable));
+    QueryTable[0].Flags = RTL_QUERY_REGISTRY_DIRECT | RTL_QUERY_REGISTRY_REQUIRED;
+    QueryTable[0].Name = L"MSISupported";
+    QueryTable[0].EntryContext = &Supported;
+    QueryTable[1].Flags = RTL_QUERY_REGISTRY_DIRECT;
+    QueryTable[1].Name = L"MessageNumberLimit";
+    QueryTable[1].EntryContext = &Limit;
+
+    Status = RtlQueryRegistryValues(RTL_REGISTRY_HANDLE,
+                                    (PCWSTR)KeyHandle,
+                                    QueryTable,
+                                    NULL,
+                                    NULL);
+    ZwClose(KeyHandle);
+    if (!NT_SUCCESS(Status))
+        return FALSE;
+
+    *MessageNumberLimit = Limit;
+    return (Supported != 0);
+}
+
+static NTSTATUS
+PdoFilterResourceRequirements(
+    IN PDEVICE_OBJECT DeviceObject,
+    IN PIRP Irp,
+    PIO_STACK_LOCATION IrpSp)
+{
+    PPDO_DEVICE_EXTENSION DeviceExtension = DeviceObject->DeviceExtension;
+    PPCI_DEVICE Device = DeviceExtension->PciDevice;
+    PIO_RESOURCE_REQUIREMENTS_LIST OldList, NewList;
+    PIO_RESOURCE_LIST LineList, MessageList;
+    PIO_RESOURCE_DESCRIPTOR Descriptor;
+    ULONG MessageCount, MessageLimit, DescriptorCount, ListSize, i;
+    USHORT Control;
+
+    UNREFERENCED_PARAMETER(IrpSp);
+
+    OldList = (PIO_RESOURCE_REQUIREMENTS_LIST)Irp->IoStatus.Information;
+    if (!OldList || OldList->AlternativeLists != 1)
+        return Irp->IoStatus.Status;
+
+    if (!Device->MsiCapability && !Device->MsixCapability)
+        return Irp->IoStatus.Status;
+
+    if (!PdoIsMessageSignaledInterruptSupported(DeviceObject, &MessageLimit))
+        return Irp->IoStatus.Status;
+
+    /* Nothing to do if the messages were already added */
+    LineList = &OldList->List[0];
+    DescriptorCount = 0;
+    for (i = 0; i < LineList->Count; i++)
+    {
+        if (LineList->Descriptors[i].Type != CmResourceTypeInterrupt)
+            DescriptorCount++;
+        else if (LineList->Descriptors[i].Flags & CM_RESOURCE_INTERRUPT_MESSAGE)
+            return Irp->IoStatus.Status;
+    }
+
+    if (Device->MsixCapability)
+    {
+        /* One message per processor, so completions can be spread out */
+        PdoReadDeviceConfig(Device,
+                            &Control,
+                            Device->MsixCapability + PCI_MSIX_MESSAGE_CONTROL,
+                            sizeof(Control));
+        MessageCount = min((Control & PCI_MSIX_CONTROL_TABLE_SIZE) + 1, (ULONG)KeNumberProcessors);
+    }
+    else
+    {
+        /* Multiple MSI messages need a block of contiguous vectors, which the HAL doesn't hand out */
+        MessageCount = 1;
+    }
+
+    if (MessageLimit != 0)
+        MessageCount = min(MessageCount, MessageLimit);
+
+    /* The message based list comes first, the original one is the fallback */
+    ListSize = FIELD_OFFSET(IO_RESOURCE_REQUIREMENTS_LIST, List) +
+               FIELD_OFFSET(IO_RESOURCE_LIST, Descriptors[DescriptorCount + MessageCount]) +
+               FIELD_OFFSET(IO_RESOURCE_LIST, Descriptors[LineList->Count]);
+
+    NewList = ExAllocatePoolWithTag(PagedPool, ListSize, TAG_PCI);
+    if (!NewList)
+        return Irp->IoStatus.Status;
+
+    RtlZeroMemory(NewList, ListSize);
+    NewList->ListSize = ListSize;
+    NewList->InterfaceType = OldList->InterfaceType;
+    NewList->BusNumber = OldList->BusNumber;
+    NewList->SlotNumber = OldList->SlotNumber;
+    NewList->AlternativeLists = 2;
+
+    MessageList = &NewList->List[0];
+    MessageList->Version = LineList->Version;
+    MessageList->Revision = LineList->Revision;
+    MessageList->Count = DescriptorCount + MessageCount;
+
+    Descriptor = &MessageList->Descriptors[0];
+    for (i = 0; i < LineList->Count; i++)
+    {
+        if (LineList->Descriptors[i].Type != CmResourceTypeInterrupt)
+            *Descriptor++ = LineList->Descriptors[i];
+    }
+
+    for (i = 0; i < MessageCount; i++, Descriptor++)
+    {
+        Descriptor->Option = 0; /* Required */
+        Descriptor->Type = CmResourceTypeInterrupt;
+        Descriptor->ShareDisposition = CmResourceShareDeviceExclusive;
+        Descriptor->Flags = CM_RESOURCE_INTERRUPT_LATCHED | CM_RESOURCE_INTERRUPT_MESSAGE;
+
+        Descriptor->u.Interrupt.MinimumVector = CM_RESOURCE_INTERRUPT_MESSAGE_TOKEN;
+        Descriptor->u.Interrupt.MaximumVector = CM_RESOURCE_INTERRUPT_MESSAGE_TOKEN;
+    }
+
+    RtlCopyMemory(Descriptor,
+                  LineList,
+                  FIELD_OFFSET(IO_RESOURCE_LIST, Descriptors[LineList->Count]));
+
+    DPRINT("Requesting %lu message(s) for PCI device 0x%x on bus 0x%x\n",
+           MessageCount,
+           Device->SlotNumber.u.AsULONG,
+           Device->BusNumber);
+
+    ExFreePool(OldList);
+    Irp->IoStatus.Information = (ULONG_PTR)NewList;
+
+    return STATUS_SUCCESS;
+}
+#endif
+
+static PCM_PARTIAL_RESOURCE_DESCRIPTOR
+PdoGetMessageDescriptor(
+    IN PCM_RESOURCE_LIST ResourceList,
+    IN ULONG Index)
+{
+    PCM_FULL_RESOURCE_DESCRIPTOR FullDesc;
+    PCM_PARTIAL_RESOURCE_DESCRIPTOR PartialDesc;
+    ULONG i, ii;
+
+    FullDesc = &ResourceList->List[0];
+    for (i = 0; i < ResourceList->Count; i++, FullDesc = CmiGetNextResourceDescriptor(FullDesc))
+    {
+        for (ii = 0; ii < FullDesc->PartialResourceList.Count; ii++)
+        {
+            PartialDesc = &FullDesc->PartialResourceList.PartialDescriptors[ii];
+
+            if (PartialDesc->Type == CmResourceTypeInterrupt &&
+                (PartialDesc->Flags & CM_RESOURCE_INTERRUPT_MESSAGE))
+            {
+                if (Index == 0)
+                    return PartialDesc;
+
+                Index--;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static NTSTATUS
+PdoGetMessageRouting(
+    IN PCM_RESOURCE_LIST TranslatedList,
+    IN ULONG MessageId,
+    OUT PPHYSICAL_ADDRESS MessageAddress,
+    OUT PULONG MessageData)
+{
+    PCM_PARTIAL_RESOURCE_DESCRIPTOR Descriptor;
+
+    Descriptor = PdoGetMessageDescriptor(TranslatedList, MessageId);
+    if (!Descriptor)
+        return STATUS_NOT_FOUND;
+
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+    return HalGetMessageRoutingInfo(Descriptor->u.MessageInterrupt.Translated.Vector,
+                                    Descriptor->u.MessageInterrupt.Translated.Affinity,
+                                    MessageAddress,
+                                    MessageData);
+#else
+    /* No messages are requested, see PdoPnpControl */
+    UNREFERENCED_PARAMETER(MessageAddress);
+    UNREFERENCED_PARAMETER(MessageData);
+    return STATUS_NOT_SUPPORTED;
+#endif
+}
+
+static NTSTATUS
+PdoEnableMsi(
+    IN PPCI_DEVICE Device,
+    IN PCM_RESOURCE_LIST TranslatedList)
+{
+    PHYSICAL_ADDRESS MessageAddress;
+    ULONG MessageData;
+    USHORT Control, Data;
+    NTSTATUS Status;
+
+    Status = PdoGetMessageRouting(TranslatedList, 0, &MessageAddress, &MessageData);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    PdoReadDeviceConfig(Device,
+                        &Control,
+                        Device->MsiCapability + PCI_MSI_MESSAGE_CONTROL,
+                        sizeof(Control));
+
+    PdoWriteDeviceConfig(Device,
+                         &MessageAddress.LowPart,
+                         Device->MsiCapability + PCI_MSI_MESSAGE_ADDRESS,
+                         sizeof(ULONG));
+
+    Data = (USHORT)MessageData;
+    if (Control & PCI_MSI_CONTROL_64BIT)
+    {
+        PdoWriteDeviceConfig(Device,
+                             &MessageAddress.HighPart,
+                             Device->MsiCapability + PCI_MSI_MESSAGE_UPPER_ADDRESS,
+                             sizeof(ULONG));
+        PdoWriteDeviceConfig(Device,
+                             &Data,
+                             Device->MsiCapability + PCI_MSI_MESSAGE_DATA_64,
+                             sizeof(Data));
+    }
+    else
+    {
+        PdoWriteDeviceConfig(Device,
+                             &Data,
+                             Device->MsiCapability + PCI_MSI_MESSAGE_DATA_32,
+                             sizeof(Data));
+    }
+
+    /* A single message */
+    Control &= ~PCI_MSI_CONTROL_MME_MASK;
+    Control |= PCI_MSI_CONTROL_ENABLE;
+    PdoWriteDeviceConfig(Device,
+                         &Control,
+                         Device->MsiCapability + PCI_MSI_MESSAGE_CONTROL,
+                         sizeof(Control));
+
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS
+PdoEnableMsix(
+    IN PPCI_DEVICE Device,
+    IN PCM_RESOURCE_LIST TranslatedList,
+    IN ULONG MessageCount)
+{
+    PHYSICAL_ADDRESS TableAddress, MessageAddress;
+    ULONG Table, TableSize, Bar, BarIndex, MessageData, i;
+    PUCHAR Entries, Entry;
+    USHORT Control;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    PdoReadDeviceConfig(Device,
+                        &Control,
+                        Device->MsixCapability + PCI_MSIX_MESSAGE_CONTROL,
+                        sizeof(Control));
+    PdoReadDeviceConfig(Device,
+                        &Table,
+                        Device->MsixCapability + PCI_MSIX_TABLE_OFFSET,
+                        sizeof(Table));
+
+    TableSize = (Control & PCI_MSIX_CONTROL_TABLE_SIZE) + 1;
+    if (MessageCount > TableSize)
+        return STATUS_INVALID_PARAMETER;
+
+    /* The table lives in one of the memory BARs */
+    BarIndex = Table & PCI_MSIX_TABLE_BIR_MASK;
+    if (BarIndex >= PCI_TYPE0_ADDRESSES)
+        return STATUS_DEVICE_CONFIGURATION_ERROR;
+
+    PdoReadDeviceConfig(Device,
+                        &Bar,
+                        FIELD_OFFSET(PCI_COMMON_CONFIG, u.type0.BaseAddresses[BarIndex]),
+                        sizeof(Bar));
+    if (Bar & PCI_ADDRESS_IO_SPACE)
+        return STATUS_DEVICE_CONFIGURATION_ERROR;
+
+    TableAddress.QuadPart = Bar & PCI_ADDRESS_MEMORY_ADDRESS_MASK;
+    if ((Bar & PCI_ADDRESS_MEMORY_TYPE_MASK) == PCI_TYPE_64BIT && BarIndex + 1 < PCI_TYPE0_ADDRESSES)
+    {
+        PdoReadDeviceConfig(Device,
+                            &TableAddress.HighPart,
+                            FIELD_OFFSET(PCI_COMMON_CONFIG, u.type0.BaseAddresses[BarIndex + 1]),
+                            sizeof(ULONG));
+    }
+    TableAddress.QuadPart += Table & ~PCI_MSIX_TABLE_BIR_MASK;
+
+    Entries = MmMapIoSpace(TableAddress, TableSize * PCI_MSIX_ENTRY_SIZE, MmNonCached);
+    if (!Entries)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    /* Keep the whole function masked while the table is written */
+    Control |= PCI_MSIX_CONTROL_ENABLE | PCI_MSIX_CONTROL_FUNCTION_MASK;
+    PdoWriteDeviceConfig(Device,
+                         &Control,
+                         Device->MsixCapability + PCI_MSIX_MESSAGE_CONTROL,
+                         sizeof(Control));
+
+    for (i = 0; i < TableSize; i++)
+    {
+        Entry = Entries + i * PCI_MSIX_ENTRY_SIZE;
+
+        /* Entries without a message stay masked */
+        if (i >= MessageCount)
+        {
+            WRITE_REGISTER_ULONG((PULONG)(Entry + PCI_MSIX_ENTRY_CONTROL), PCI_MSIX_ENTRY_MASKED);
+            continue;
+        }
+
+        Status = PdoGetMessageRouting(TranslatedList, i, &MessageAddress, &MessageData);
+        if (!NT_SUCCESS(Status))
+            break;
+
+        WRITE_REGISTER_ULONG((PULONG)(Entry + PCI_MSIX_ENTRY_ADDRESS), MessageAddress.LowPart);
+        WRITE_REGISTER_ULONG((PULONG)(Entry + PCI_MSIX_ENTRY_UPPER_ADDRESS), MessageAddress.HighPart);
+        WRITE_REGISTER_ULONG((PULONG)(Entry + PCI_MSIX_ENTRY_DATA), MessageData);
+        WRITE_REGISTER_ULONG((PULONG)(Entry + PCI_MSIX_ENTRY_CONTROL), 0);
+    }
+
+    MmUnmapIoSpace(Entries, TableSize * PCI_MSIX_ENTRY_SIZE);
+
+    if (!NT_SUCCESS(Status))
+        Control &= ~PCI_MSIX_CONTROL_ENABLE;
+    Control &= ~PCI_MSIX_CONTROL_FUNCTION_MASK;
+    PdoWriteDeviceConfig(Device,
+                         &Control,
+                         Device->MsixCapability + PCI_MSIX_MESSAGE_CONTROL,
+                         sizeof(Control));
+
+    return Status;
+}
+
+static VOID
+PdoDisableMessageInterrupts(
+    IN PPCI_DEVICE Device)
+{
+    USHORT Control;
+
+    if (Device->MessageCount == 0)
+        return;
+
+    if (Device->MsixCapability)
+    {
+        PdoReadDeviceConfig(Device,
+                            &Control,
+                            Device->MsixCapability + PCI_MSIX_MESSAGE_CONTROL,
+                            sizeof(Control));
+        Control &= ~PCI_MSIX_CONTROL_ENABLE;
+        PdoWriteDeviceConfig(Device,
+                             &Control,
+                             Device->MsixCapability + PCI_MSIX_MESSAGE_CONTROL,
+                             sizeof(Control));
+    }
+    else
+    {
+        PdoReadDeviceConfig(Device,
+                            &Control,
+                            Device->MsiCapability + PCI_MSI_MESSAGE_CONTROL,
+                            sizeof(Control));
+        Control &= ~PCI_MSI_CONTROL_ENABLE;
+        PdoWriteDeviceConfig(Device,
+                             &Control,
+                             Device->MsiCapability + PCI_MSI_MESSAGE_CONTROL,
+                             sizeof(Control));
+    }
+
+    Device->MessageCount = 0;
+}
+
 static NTSTATUS
 PdoStartDevice(
     IN PDEVICE_OBJECT DeviceObject,
@@ -1323,12 +1755,15 @@ PdoStartDevice(
     PIO_STACK_LOCATION IrpSp)
 {
     PCM_RESOURCE_LIST RawResList = IrpSp->Parameters.StartDevice.AllocatedResources;
+    PCM_RESOURCE_LIST TranslatedResList = IrpSp->Parameters.StartDevice.AllocatedResourcesTranslated;
     PCM_FULL_RESOURCE_DESCRIPTOR RawFullDesc;
     PCM_PARTIAL_RESOURCE_DESCRIPTOR RawPartialDesc;
     ULONG i, ii;
     PPDO_DEVICE_EXTENSION DeviceExtension = DeviceObject->DeviceExtension;
+    ULONG MessageCount = 0;
     UCHAR Irq;
     USHORT Command;
+    NTSTATUS Status;
 
     UNREFERENCED_PARAMETER(Irp);
 
@@ -1346,7 +1781,13 @@ PdoStartDevice(
                but only one is allowed and it must be the last one in the list! */
             RawPartialDesc = &RawFullDesc->PartialResourceList.PartialDescriptors[ii];
 
-            if (RawPartialDesc->Type == CmResourceTypeInterrupt)
+            if (RawPartialDesc->Type == CmResourceTypeInterrupt &&
+                (RawPartialDesc->Flags & CM_RESOURCE_INTERRUPT_MESSAGE))
+            {
+                /* Messages are programmed once the device decodes memory */
+                MessageCount++;
+            }
+            else if (RawPartialDesc->Type == CmResourceTypeInterrupt)
             {
                 DPRINT("Assigning IRQ %u to PCI device 0x%x on bus 0x%x\n",
                         RawPartialDesc->u.Interrupt.Vector,
@@ -1387,6 +1828,14 @@ PdoStartDevice(
         DBGPRINT("[I/O space enable] ");
     }
 
+    if (MessageCount != 0 && TranslatedResList)
+    {
+        /* The MSI-X table is in memory space */
+        if (DeviceExtension->PciDevice->MsixCapability)
+            Command |= PCI_ENABLE_MEMORY_SPACE;
+        DBGPRINT("[%lu message(s)] ", MessageCount);
+    }
+
     if (Command != 0)
     {
         DBGPRINT("\n");
@@ -1406,6 +1855,33 @@ PdoStartDevice(
         DBGPRINT("None\n");
     }
 
+    if (MessageCount != 0 && TranslatedResList)
+    {
+        if (DeviceExtension->PciDevice->MsixCapability)
+            Status = PdoEnableMsix(DeviceExtension->PciDevice, TranslatedResList, MessageCount);
+        else if (DeviceExtension->PciDevice->MsiCapability)
+            Status = PdoEnableMsi(DeviceExtension->PciDevice, TranslatedResList);
+        else
+            Status = STATUS_DEVICE_CONFIGURATION_ERROR;
+
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("Failed to enable message signaled interrupts: 0x%lx\n", Status);
+            return Status;
+        }
+
+        DeviceExtension->PciDevice->MessageCount = MessageCount;
+
+        /* The device must not assert its line interrupt anymore */
+        Command |= DeviceExtension->PciDevice->PciConfig.Command | PCI_DISABLE_LEVEL_INTERRUPT;
+        HalSetBusDataByOffset(PCIConfiguration,
+                              DeviceExtension->PciDevice->BusNumber,
+                              DeviceExtension->PciDevice->SlotNumber.u.AsULONG,
+                              &Command,
+                              FIELD_OFFSET(PCI_COMMON_CONFIG, Command),
+                              sizeof(USHORT));
+    }
+
     return STATUS_SUCCESS;
 }
 
@@ -1574,13 +2050,18 @@ PdoPnpControl(
             Status = PdoStartDevice(DeviceObject, Irp, IrpSp);
             break;
 
+        case IRP_MN_STOP_DEVICE:
+        case IRP_MN_REMOVE_DEVICE:
+        case IRP_MN_SURPRISE_REMOVAL:
+            /* Stop the messages, the PnP manager gives their vectors back to the HAL afterwards */
+            PdoDisableMessageInterrupts(((PPDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension)->PciDevice);
+            Status = STATUS_SUCCESS;
+            break;
+
         case IRP_MN_QUERY_STOP_DEVICE:
         case IRP_MN_CANCEL_STOP_DEVICE:
-        case IRP_MN_STOP_DEVICE:
         case IRP_MN_QUERY_REMOVE_DEVICE:
         case IRP_MN_CANCEL_REMOVE_DEVICE:
-        case IRP_MN_REMOVE_DEVICE:
-        case IRP_MN_SURPRISE_REMOVAL:
             Status = STATUS_SUCCESS;
             break;
 
@@ -1601,8 +2082,12 @@ PdoPnpControl(
 
         case IRP_MN_FILTER_RESOURCE_REQUIREMENTS:
             DPRINT("IRP_MN_FILTER_RESOURCE_REQUIREMENTS received\n");
-            /* Nothing to do */
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+            Status = PdoFilterResourceRequirements(DeviceObject, Irp, IrpSp);
+#else
+            /* Nothing to do, message descriptors only exist from NTDDI_VISTA on */
             Irp->IoStatus.Status = Status;
+#endif
             break;
 
         default:
@@ -636,6 +636,9 @@ AddRun(PNTFS_VCB Vcb,
     }
     _SEH2_END;
 
+    // The decoded runs are stale now, ReadAttribute() will rebuild them
+    InvalidateAttributeRunList(Vcb, AttrContext);
+
     RunBuffer = ExAllocatePoolWithTag(NonPagedPool, Vcb->NtfsInfo.BytesPerFileRecord, TAG_NTFS);
     if (!RunBuffer)
     {
@@ -962,50 +965,6 @@ ConvertLargeMCBToDataRuns(PLARGE_MCB DataRunsMCB,
     return Status;
 }
 
-PUCHAR
-DecodeRun(PUCHAR DataRun,
-          LONGLONG *DataRunOffset,
-          ULONGLONG *DataRunLength)
-{
-    UCHAR DataRunOffsetSize;
-    UCHAR DataRunLengthSize;
-    CHAR i;
-
-    DataRunOffsetSize = (*DataRun >> 4) & 0xF;
-    DataRunLengthSize = *DataRun & 0xF;
-    *DataRunOffset = 0;
-    *DataRunLength = 0;
-    DataRun++;
-    for (i = 0; i < DataRunLengthSize; i++)
-    {
-        *DataRunLength += ((ULONG64)*DataRun) << (i * 8);
-        DataRun++;
-    }
-
-    /* NTFS 3+ sparse files */
-    if (DataRunOffsetSize == 0)
-    {
-        *DataRunOffset = -1;
-    }
-    else
-    {
-        for (i = 0; i < DataRunOffsetSize - 1; i++)
-        {
-            *DataRunOffset += ((ULONG64)*DataRun) << (i * 8);
-            DataRun++;
-        }
-        /* The last byte contains sign so we must process it different way. */
-        *DataRunOffset = ((LONG64)(CHAR)(*(DataRun++)) << (i * 8)) + *DataRunOffset;
-    }
-
-    DPRINT("DataRunOffsetSize: %x\n", DataRunOffsetSize);
-    DPRINT("DataRunLengthSize: %x\n", DataRunLengthSize);
-    DPRINT("DataRunOffset: %x\n", *DataRunOffset);
-    DPRINT("DataRunLength: %x\n", *DataRunLength);
-
-    return DataRun;
-}
-
 BOOLEAN
 FindRun(PNTFS_ATTR_RECORD NresAttr,
         ULONGLONG vcn,
@@ -1148,6 +1107,8 @@ FreeClusters(PNTFS_VCB Vcb,
         ClustersLeftToFree--;
     }
 
+    InvalidateAttributeRunList(Vcb, AttrContext);
+
     // update $BITMAP file on disk
     Status = WriteAttribute(Vcb, DataContext, 0, BitmapData, (ULONG)BitmapDataSize, &LengthWritten, FileRecord);
     if (!NT_SUCCESS(Status))
@@ -112,6 +112,8 @@ NtfsCreateFCB(PCWSTR FileName,
 
     Fcb->RFCB.Resource = &(Fcb->MainResource);
 
+    NtfsInitializeUnitCache(&Fcb->UnitCache);
+
     return Fcb;
 }
 
@@ -124,6 +126,8 @@ NtfsDestroyFCB(PNTFS_FCB Fcb)
 
     ExDeleteResourceLite(&Fcb->MainResource);
 
+    NtfsFreeUnitCache(&Fcb->UnitCache);
+
     ExFreeToNPagedLookasideList(&NtfsGlobalData->FcbLookasideList, Fcb);
 }
 
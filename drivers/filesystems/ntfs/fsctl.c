@@ -537,6 +537,7 @@ NtfsMountVolume(PDEVICE_OBJECT DeviceObject,
     ExInitializeResourceLite(&Vcb->DirResource);
 
     KeInitializeSpinLock(&Vcb->FcbListLock);
+    KeInitializeSpinLock(&Vcb->RunListLock);
 
     /* Get serial number */
     NewDeviceObject->Vpb->SerialNumber = Vcb->NtfsInfo.SerialNumber;
@@ -60,32 +60,14 @@ PrepareAttributeContext(PNTFS_ATTR_RECORD AttrRecord)
 
     // Copy the attribute
     RtlCopyMemory(Context->pRecord, AttrRecord, AttrRecord->Length);
+    Context->RunList = NULL;
+    Context->RunListGeneration = 0;
 
     if (AttrRecord->IsNonResident)
     {
-        LONGLONG DataRunOffset;
-        ULONGLONG DataRunLength;
         ULONGLONG NextVBN = 0;
         PUCHAR DataRun = (PUCHAR)((ULONG_PTR)Context->pRecord + Context->pRecord->NonResident.MappingPairsOffset);
 
-        Context->CacheRun = DataRun;
-        Context->CacheRunOffset = 0;
-        Context->CacheRun = DecodeRun(Context->CacheRun, &DataRunOffset, &DataRunLength);
-        Context->CacheRunLength = DataRunLength;
-        if (DataRunOffset != -1)
-        {
-            /* Normal run. */
-            Context->CacheRunStartLCN =
-            Context->CacheRunLastLCN = DataRunOffset;
-        }
-        else
-        {
-            /* Sparse run. */
-            Context->CacheRunStartLCN = -1;
-            Context->CacheRunLastLCN = 0;
-        }
-        Context->CacheRunCurrentOffset = 0;
-
         // Convert the data runs to a map control block
         if (!NT_SUCCESS(ConvertDataRunsToLargeMCB(DataRun, &Context->DataRunsMCB, &NextVBN)))
         {
@@ -94,6 +76,10 @@ PrepareAttributeContext(PNTFS_ATTR_RECORD AttrRecord)
             ExFreeToNPagedLookasideList(&NtfsGlobalData->AttrCtxtLookasideList, Context);
             return NULL;
         }
+
+        // Decode the runs for ReadAttribute() while we have them at hand.
+        // On failure, the first read will retry from the MCB.
+        NtfsCreateRunList(DataRun, &Context->RunList);
     }
 
     return Context;
@@ -103,6 +89,11 @@ PrepareAttributeContext(PNTFS_ATTR_RECORD AttrRecord)
 VOID
 ReleaseAttributeContext(PNTFS_ATTR_CONTEXT Context)
 {
+    if (Context->RunList)
+    {
+        NtfsDereferenceRunList(Context->RunList);
+    }
+
     if (Context->pRecord)
     {
         if (Context->pRecord->IsNonResident)
@@ -1061,6 +1052,91 @@ SetResidentAttributeDataLength(PDEVICE_EXTENSION Vcb,
     return STATUS_SUCCESS;
 }
 
+/*
+ * The run list is dropped whenever the MCB changes and rebuilt on the next
+ * read. The context may be shared with concurrent readers (e.g. the MFT
+ * context), so the pointer is only swapped under Vcb->RunListLock and every
+ * reader holds a reference for as long as it uses the list.
+ */
+static
+PNTFS_RUN_LIST
+GetAttributeRunList(PDEVICE_EXTENSION Vcb,
+                    PNTFS_ATTR_CONTEXT Context)
+{
+    PNTFS_RUN_LIST RunList, NewList;
+    ULONG Generation;
+    NTSTATUS Status;
+    KIRQL OldIrql;
+
+    for (;;)
+    {
+        KeAcquireSpinLock(&Vcb->RunListLock, &OldIrql);
+        RunList = Context->RunList;
+        if (RunList != NULL)
+        {
+            NtfsReferenceRunList(RunList);
+        }
+        Generation = Context->RunListGeneration;
+        KeReleaseSpinLock(&Vcb->RunListLock, OldIrql);
+
+        if (RunList != NULL)
+        {
+            return RunList;
+        }
+
+        Status = NtfsCreateRunListFromMcb(&Context->DataRunsMCB, &NewList);
+        if (Status == STATUS_RETRY)
+        {
+            continue;
+        }
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("Unable to build the run list: 0x%lx\n", Status);
+            return NULL;
+        }
+
+        // Publish it, unless the MCB changed while we were reading it
+        KeAcquireSpinLock(&Vcb->RunListLock, &OldIrql);
+        if (Context->RunList == NULL && Context->RunListGeneration == Generation)
+        {
+            NtfsReferenceRunList(NewList);
+            Context->RunList = NewList;
+            KeReleaseSpinLock(&Vcb->RunListLock, OldIrql);
+            return NewList;
+        }
+        KeReleaseSpinLock(&Vcb->RunListLock, OldIrql);
+
+        NtfsFreeRunList(NewList);
+    }
+}
+
+/**
+* @name InvalidateAttributeRunList
+* @implemented
+*
+* Drops the decoded runs of a context whose MCB was just changed. Readers still
+* using the old list keep it alive until they are done with it.
+*
+*/
+VOID
+InvalidateAttributeRunList(PDEVICE_EXTENSION Vcb,
+                           PNTFS_ATTR_CONTEXT Context)
+{
+    PNTFS_RUN_LIST RunList;
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock(&Vcb->RunListLock, &OldIrql);
+    RunList = Context->RunList;
+    Context->RunList = NULL;
+    Context->RunListGeneration++;
+    KeReleaseSpinLock(&Vcb->RunListLock, OldIrql);
+
+    if (RunList != NULL)
+    {
+        NtfsDereferenceRunList(RunList);
+    }
+}
+
 ULONG
 ReadAttribute(PDEVICE_EXTENSION Vcb,
               PNTFS_ATTR_CONTEXT Context,
@@ -1068,18 +1144,7 @@ ReadAttribute(PDEVICE_EXTENSION Vcb,
               PCHAR Buffer,
               ULONG Length)
 {
-    ULONGLONG LastLCN;
-    PUCHAR DataRun;
-    LONGLONG DataRunOffset;
-    ULONGLONG DataRunLength;
-    LONGLONG DataRunStartLCN;
-    ULONGLONG CurrentOffset;
-    ULONG ReadLength;
-    ULONG AlreadyRead;
-    NTSTATUS Status;
-
-    //TEMPTEMP
-    PUCHAR TempBuffer;
+    PNTFS_RUN_LIST RunList;
 
     if (!Context->pRecord->IsNonResident)
     {
@@ -1101,172 +1166,73 @@ ReadAttribute(PDEVICE_EXTENSION Vcb,
      * Non-resident attribute
      */
 
-    /*
-     * I. Find the corresponding start data run.
-     */
-
-    AlreadyRead = 0;
-
-    // FIXME: Cache seems to be non-working. Disable it for now
-    //if(Context->CacheRunOffset <= Offset && Offset < Context->CacheRunOffset + Context->CacheRunLength * Volume->ClusterSize)
-    if (0)
-    {
-        DataRun = Context->CacheRun;
-        LastLCN = Context->CacheRunLastLCN;
-        DataRunStartLCN = Context->CacheRunStartLCN;
-        DataRunLength = Context->CacheRunLength;
-        CurrentOffset = Context->CacheRunCurrentOffset;
-    }
-    else
+    RunList = GetAttributeRunList(Vcb, Context);
+    if (RunList == NULL)
     {
-        //TEMPTEMP
-        ULONG UsedBufferSize;
-        TempBuffer = ExAllocatePoolWithTag(NonPagedPool, Vcb->NtfsInfo.BytesPerFileRecord, TAG_NTFS);
-        if (TempBuffer == NULL)
-        {
-            return STATUS_INSUFFICIENT_RESOURCES;
-        }
-
-        LastLCN = 0;
-        CurrentOffset = 0;
-
-        // This will be rewritten in the next iteration to just use the DataRuns MCB directly
-        ConvertLargeMCBToDataRuns(&Context->DataRunsMCB,
-                                  TempBuffer,
-                                  Vcb->NtfsInfo.BytesPerFileRecord,
-                                  &UsedBufferSize);
-
-        DataRun = TempBuffer;
-
-        while (1)
-        {
-            DataRun = DecodeRun(DataRun, &DataRunOffset, &DataRunLength);
-            if (DataRunOffset != -1)
-            {
-                /* Normal data run. */
-                DataRunStartLCN = LastLCN + DataRunOffset;
-                LastLCN = DataRunStartLCN;
-            }
-            else
-            {
-                /* Sparse data run. */
-                DataRunStartLCN = -1;
-            }
-
-            if (Offset >= CurrentOffset &&
-                Offset < CurrentOffset + (DataRunLength * Vcb->NtfsInfo.BytesPerCluster))
-            {
-                break;
-            }
-
-            if (*DataRun == 0)
-            {
-                ExFreePoolWithTag(TempBuffer, TAG_NTFS);
-                return AlreadyRead;
-            }
-
-            CurrentOffset += DataRunLength * Vcb->NtfsInfo.BytesPerCluster;
-        }
+        return 0;
     }
 
-    /*
-     * II. Go through the run list and read the data
-     */
-
-    ReadLength = (ULONG)min(DataRunLength * Vcb->NtfsInfo.BytesPerCluster - (Offset - CurrentOffset), Length);
-    if (DataRunStartLCN == -1)
+    if (AttributeIsCompressed(Context->pRecord))
     {
-        RtlZeroMemory(Buffer, ReadLength);
-        Status = STATUS_SUCCESS;
+        Length = NtfsReadCompressedRunList(Vcb,
+                                           RunList,
+                                           Context->pRecord->NonResident.CompressionUnit,
+                                           NULL,
+                                           Offset,
+                                           Buffer,
+                                           Length);
     }
     else
     {
-        Status = NtfsReadDisk(Vcb->StorageDevice,
-                              DataRunStartLCN * Vcb->NtfsInfo.BytesPerCluster + Offset - CurrentOffset,
-                              ReadLength,
-                              Vcb->NtfsInfo.BytesPerSector,
-                              (PVOID)Buffer,
-                              FALSE);
+        Length = NtfsReadRunList(Vcb, RunList, Offset, Buffer, Length);
     }
-    if (NT_SUCCESS(Status))
-    {
-        Length -= ReadLength;
-        Buffer += ReadLength;
-        AlreadyRead += ReadLength;
-
-        if (ReadLength == DataRunLength * Vcb->NtfsInfo.BytesPerCluster - (Offset - CurrentOffset))
-        {
-            CurrentOffset += DataRunLength * Vcb->NtfsInfo.BytesPerCluster;
-            DataRun = DecodeRun(DataRun, &DataRunOffset, &DataRunLength);
-            if (DataRunOffset != (ULONGLONG)-1)
-            {
-                DataRunStartLCN = LastLCN + DataRunOffset;
-                LastLCN = DataRunStartLCN;
-            }
-            else
-                DataRunStartLCN = -1;
-        }
 
-        while (Length > 0)
-        {
-            ReadLength = (ULONG)min(DataRunLength * Vcb->NtfsInfo.BytesPerCluster, Length);
-            if (DataRunStartLCN == -1)
-                RtlZeroMemory(Buffer, ReadLength);
-            else
-            {
-                Status = NtfsReadDisk(Vcb->StorageDevice,
-                                      DataRunStartLCN * Vcb->NtfsInfo.BytesPerCluster,
-                                      ReadLength,
-                                      Vcb->NtfsInfo.BytesPerSector,
-                                      (PVOID)Buffer,
-                                      FALSE);
-                if (!NT_SUCCESS(Status))
-                    break;
-            }
-
-            Length -= ReadLength;
-            Buffer += ReadLength;
-            AlreadyRead += ReadLength;
-
-            /* We finished this request, but there still data in this data run. */
-            if (Length == 0 && ReadLength != DataRunLength * Vcb->NtfsInfo.BytesPerCluster)
-                break;
-
-            /*
-             * Go to next run in the list.
-             */
+    NtfsDereferenceRunList(RunList);
+    return Length;
+}
 
-            if (*DataRun == 0)
-                break;
-            CurrentOffset += DataRunLength * Vcb->NtfsInfo.BytesPerCluster;
-            DataRun = DecodeRun(DataRun, &DataRunOffset, &DataRunLength);
-            if (DataRunOffset != -1)
-            {
-                /* Normal data run. */
-                DataRunStartLCN = LastLCN + DataRunOffset;
-                LastLCN = DataRunStartLCN;
-            }
-            else
-            {
-                /* Sparse data run. */
-                DataRunStartLCN = -1;
-            }
-        } /* while */
+/**
+* @name ReadCompressedAttribute
+* @implemented
+*
+* Reads a compressed non-resident attribute, going through the stream's cache of
+* decompressed units.
+*
+* @param Cache
+* Pointer to the unit cache of the stream the attribute belongs to.
+*
+* @return
+* The number of bytes read.
+*
+*/
+ULONG
+ReadCompressedAttribute(PDEVICE_EXTENSION Vcb,
+                        PNTFS_ATTR_CONTEXT Context,
+                        PNTFS_UNIT_CACHE Cache,
+                        ULONGLONG Offset,
+                        PCHAR Buffer,
+                        ULONG Length)
+{
+    PNTFS_RUN_LIST RunList;
 
-    } /* if Disk */
+    ASSERT(AttributeIsCompressed(Context->pRecord));
 
-    // TEMPTEMP
-    if (Context->pRecord->IsNonResident)
-        ExFreePoolWithTag(TempBuffer, TAG_NTFS);
+    RunList = GetAttributeRunList(Vcb, Context);
+    if (RunList == NULL)
+    {
+        return 0;
+    }
 
-    Context->CacheRun = DataRun;
-    Context->CacheRunOffset = Offset + AlreadyRead;
-    Context->CacheRunStartLCN = DataRunStartLCN;
-    Context->CacheRunLength = DataRunLength;
-    Context->CacheRunLastLCN = LastLCN;
-    Context->CacheRunCurrentOffset = CurrentOffset;
+    Length = NtfsReadCompressedRunList(Vcb,
+                                       RunList,
+                                       Context->pRecord->NonResident.CompressionUnit,
+                                       Cache,
+                                       Offset,
+                                       Buffer,
+                                       Length);
 
-    return AlreadyRead;
+    NtfsDereferenceRunList(RunList);
+    return Length;
 }
 
 
@@ -1425,17 +1391,6 @@ WriteAttribute(PDEVICE_EXTENSION Vcb,
 
     // I. Find the corresponding start data run.
 
-    // FIXME: Cache seems to be non-working. Disable it for now
-    //if(Context->CacheRunOffset <= Offset && Offset < Context->CacheRunOffset + Context->CacheRunLength * Volume->ClusterSize)
-    /*if (0)
-    {
-    DataRun = Context->CacheRun;
-    LastLCN = Context->CacheRunLastLCN;
-    DataRunStartLCN = Context->CacheRunStartLCN;
-    DataRunLength = Context->CacheRunLength;
-    CurrentOffset = Context->CacheRunCurrentOffset;
-    }
-    else*/
     {
         ULONG UsedBufferSize;
         LastLCN = 0;
@@ -1517,13 +1472,6 @@ WriteAttribute(PDEVICE_EXTENSION Vcb,
     // Did the write fail?
     if (!NT_SUCCESS(Status))
     {
-        Context->CacheRun = DataRun;
-        Context->CacheRunOffset = Offset;
-        Context->CacheRunStartLCN = DataRunStartLCN;
-        Context->CacheRunLength = DataRunLength;
-        Context->CacheRunLastLCN = LastLCN;
-        Context->CacheRunCurrentOffset = CurrentOffset;
-
         goto Cleanup;
     }
 
@@ -1612,13 +1560,6 @@ WriteAttribute(PDEVICE_EXTENSION Vcb,
         }
     } // end while (Length > 0) [more data to write]
 
-    Context->CacheRun = DataRun;
-    Context->CacheRunOffset = Offset + *RealLengthWritten;
-    Context->CacheRunStartLCN = DataRunStartLCN;
-    Context->CacheRunLength = DataRunLength;
-    Context->CacheRunLastLCN = LastLCN;
-    Context->CacheRunCurrentOffset = CurrentOffset;
-
 Cleanup:
     // TEMPTEMP
     if (Context->pRecord->IsNonResident)
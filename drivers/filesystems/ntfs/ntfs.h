@@ -106,6 +106,8 @@ typedef struct
     KSPIN_LOCK FcbListLock;
     LIST_ENTRY FcbListHead;
 
+    KSPIN_LOCK RunListLock;     /* Guards NTFS_ATTR_CONTEXT::RunList */
+
     PVPB Vpb;
     PDEVICE_OBJECT StorageDevice;
     PFILE_OBJECT StreamFileObject;
@@ -304,6 +306,15 @@ typedef struct
     };
 } NTFS_ATTR_RECORD, *PNTFS_ATTR_RECORD;
 
+#define ATTR_IS_COMPRESSED  0x0001
+#define ATTR_IS_ENCRYPTED   0x4000
+#define ATTR_IS_SPARSE      0x8000
+
+#define AttributeIsCompressed(pRecord) \
+    ((pRecord)->IsNonResident && \
+     ((pRecord)->Flags & ATTR_IS_COMPRESSED) && \
+     (pRecord)->NonResident.CompressionUnit != 0)
+
 typedef struct
 {
     ULONG Type;
@@ -491,14 +502,12 @@ typedef struct
     CCHAR PriorityBoost;
 } NTFS_IRP_CONTEXT, *PNTFS_IRP_CONTEXT;
 
+#include "runlist.h"
+
 typedef struct _NTFS_ATTR_CONTEXT
 {
-    PUCHAR            CacheRun;
-    ULONGLONG            CacheRunOffset;
-    LONGLONG            CacheRunStartLCN;
-    ULONGLONG            CacheRunLength;
-    LONGLONG            CacheRunLastLCN;
-    ULONGLONG            CacheRunCurrentOffset;
+    PNTFS_RUN_LIST      RunList;    /* Decoded DataRunsMCB, built on first read */
+    ULONG               RunListGeneration; /* Bumped each time RunList is invalidated */
     LARGE_MCB           DataRunsMCB;
     ULONGLONG           FileMFTIndex;
     ULONGLONG           FileOwnerMFTIndex; /* If attribute list attribute, reference the original file */
@@ -541,6 +550,8 @@ typedef struct _FCB
 
     FILENAME_ATTRIBUTE Entry;
 
+    NTFS_UNIT_CACHE UnitCache;
+
 } NTFS_FCB, *PNTFS_FCB;
 
 typedef struct _FIND_ATTR_CONTXT
@@ -639,11 +650,6 @@ ConvertLargeMCBToDataRuns(PLARGE_MCB DataRunsMCB,
                           ULONG MaxBufferSize,
                           PULONG UsedBufferSize);
 
-PUCHAR
-DecodeRun(PUCHAR DataRun,
-          LONGLONG *DataRunOffset,
-          ULONGLONG *DataRunLength);
-
 ULONG GetFileNameAttributeLength(PFILENAME_ATTRIBUTE FileNameAttribute);
 
 VOID
@@ -1042,6 +1048,10 @@ PrepareAttributeContext(PNTFS_ATTR_RECORD AttrRecord);
 VOID
 ReleaseAttributeContext(PNTFS_ATTR_CONTEXT Context);
 
+VOID
+InvalidateAttributeRunList(PDEVICE_EXTENSION Vcb,
+                           PNTFS_ATTR_CONTEXT Context);
+
 ULONG
 ReadAttribute(PDEVICE_EXTENSION Vcb,
               PNTFS_ATTR_CONTEXT Context,
@@ -1049,6 +1059,14 @@ ReadAttribute(PDEVICE_EXTENSION Vcb,
               PCHAR Buffer,
               ULONG Length);
 
+ULONG
+ReadCompressedAttribute(PDEVICE_EXTENSION Vcb,
+                        PNTFS_ATTR_CONTEXT Context,
+                        PNTFS_UNIT_CACHE Cache,
+                        ULONGLONG Offset,
+                        PCHAR Buffer,
+                        ULONG Length);
+
 NTSTATUS
 WriteAttribute(PDEVICE_EXTENSION Vcb,
                PNTFS_ATTR_CONTEXT Context,
@@ -0,0 +1,624 @@
+/*
+ * PROJECT:     ReactOS NTFS filesystem driver
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Decoded data run lists
+ */
+
+/* INCLUDES *****************************************************************/
+
+#ifndef UNIT_TEST
+
+#include "ntfs.h"
+
+#define NDEBUG
+#include <debug.h>
+
+#endif /* UNIT_TEST */
+
+/* FUNCTIONS ****************************************************************/
+
+PUCHAR
+DecodeRun(PUCHAR DataRun,
+          LONGLONG *DataRunOffset,
+          ULONGLONG *DataRunLength)
+{
+    UCHAR DataRunOffsetSize;
+    UCHAR DataRunLengthSize;
+    CHAR i;
+
+    DataRunOffsetSize = (*DataRun >> 4) & 0xF;
+    DataRunLengthSize = *DataRun & 0xF;
+    *DataRunOffset = 0;
+    *DataRunLength = 0;
+    DataRun++;
+    for (i = 0; i < DataRunLengthSize; i++)
+    {
+        *DataRunLength += ((ULONG64)*DataRun) << (i * 8);
+        DataRun++;
+    }
+
+    /* NTFS 3+ sparse files */
+    if (DataRunOffsetSize == 0)
+    {
+        *DataRunOffset = -1;
+    }
+    else
+    {
+        for (i = 0; i < DataRunOffsetSize - 1; i++)
+        {
+            *DataRunOffset += ((ULONG64)*DataRun) << (i * 8);
+            DataRun++;
+        }
+        /* The last byte contains sign so we must process it different way. */
+        *DataRunOffset = ((LONG64)(CHAR)(*(DataRun++)) << (i * 8)) + *DataRunOffset;
+    }
+
+    DPRINT("DataRunOffsetSize: %x\n", DataRunOffsetSize);
+    DPRINT("DataRunLengthSize: %x\n", DataRunLengthSize);
+    DPRINT("DataRunOffset: %x\n", *DataRunOffset);
+    DPRINT("DataRunLength: %x\n", *DataRunLength);
+
+    return DataRun;
+}
+
+static
+PNTFS_RUN_LIST
+AllocateRunList(ULONG RunCount)
+{
+    PNTFS_RUN_LIST RunList;
+
+    RunList = ExAllocatePoolWithTag(NonPagedPool,
+                                    FIELD_OFFSET(NTFS_RUN_LIST, Runs[RunCount]),
+                                    TAG_NTFS);
+    if (RunList != NULL)
+    {
+        RunList->RefCount = 1;
+        RunList->RunCount = RunCount;
+    }
+
+    return RunList;
+}
+
+/**
+* @name NtfsCreateRunList
+* @implemented
+*
+* Decodes mapping pairs into a run list.
+*
+* @param DataRun
+* Pointer to the encoded data runs, terminated by a zero byte.
+*
+* @param RunList
+* Pointer to a PNTFS_RUN_LIST that will receive the run list. Free it with NtfsFreeRunList().
+*
+* @return
+* STATUS_SUCCESS on success, STATUS_INSUFFICIENT_RESOURCES if the list can't be allocated.
+*
+* @remarks
+* Like ConvertDataRunsToLargeMCB(), the first run starts at VCN 0.
+*
+*/
+NTSTATUS
+NtfsCreateRunList(PUCHAR DataRun,
+                  PNTFS_RUN_LIST *RunList)
+{
+    PNTFS_RUN_LIST NewList;
+    PUCHAR CurrentRun;
+    LONGLONG DataRunOffset;
+    ULONGLONG DataRunLength;
+    ULONGLONG NextVcn = 0;
+    LONGLONG LastLCN = 0;
+    ULONG RunCount = 0;
+    ULONG i;
+
+    // Count the runs first, so that we allocate only once
+    for (CurrentRun = DataRun; *CurrentRun != 0; RunCount++)
+    {
+        CurrentRun = DecodeRun(CurrentRun, &DataRunOffset, &DataRunLength);
+    }
+
+    NewList = AllocateRunList(RunCount);
+    if (NewList == NULL)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    for (i = 0, CurrentRun = DataRun; i < RunCount; i++)
+    {
+        CurrentRun = DecodeRun(CurrentRun, &DataRunOffset, &DataRunLength);
+
+        NewList->Runs[i].Vcn = NextVcn;
+        NewList->Runs[i].Length = DataRunLength;
+        if (DataRunOffset != -1)
+        {
+            // Normal data run, its LCN is relative to the previous one
+            LastLCN += DataRunOffset;
+            NewList->Runs[i].Lcn = LastLCN;
+        }
+        else
+        {
+            // Sparse data run
+            NewList->Runs[i].Lcn = -1;
+        }
+
+        NextVcn += DataRunLength;
+    }
+
+    *RunList = NewList;
+    return STATUS_SUCCESS;
+}
+
+/**
+* @name NtfsCreateRunListFromMcb
+* @implemented
+*
+* Builds a run list from a map control block. Holes in the MCB become sparse runs.
+*
+* @param DataRunsMCB
+* Pointer to the LARGE_MCB describing the attribute's clusters.
+*
+* @param RunList
+* Pointer to a PNTFS_RUN_LIST that will receive the run list. Free it with NtfsFreeRunList().
+*
+* @return
+* STATUS_SUCCESS on success, STATUS_INSUFFICIENT_RESOURCES if the list can't be allocated.
+*
+*/
+NTSTATUS
+NtfsCreateRunListFromMcb(PLARGE_MCB DataRunsMCB,
+                         PNTFS_RUN_LIST *RunList)
+{
+    PNTFS_RUN_LIST NewList;
+    LONGLONG Vbn, Lbn, Count;
+    ULONG RunCount;
+    ULONG i;
+
+    for (RunCount = 0; FsRtlGetNextLargeMcbEntry(DataRunsMCB, RunCount, &Vbn, &Lbn, &Count); RunCount++);
+
+    NewList = AllocateRunList(RunCount);
+    if (NewList == NULL)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    for (i = 0; i < RunCount; i++)
+    {
+        if (!FsRtlGetNextLargeMcbEntry(DataRunsMCB, i, &Vbn, &Lbn, &Count))
+        {
+            // A writer shrank the MCB while we were copying it
+            NtfsFreeRunList(NewList);
+            return STATUS_RETRY;
+        }
+
+        NewList->Runs[i].Vcn = Vbn;
+        NewList->Runs[i].Lcn = Lbn;
+        NewList->Runs[i].Length = Count;
+    }
+
+    *RunList = NewList;
+    return STATUS_SUCCESS;
+}
+
+VOID
+NtfsFreeRunList(PNTFS_RUN_LIST RunList)
+{
+    ExFreePoolWithTag(RunList, TAG_NTFS);
+}
+
+VOID
+NtfsReferenceRunList(PNTFS_RUN_LIST RunList)
+{
+    InterlockedIncrement(&RunList->RefCount);
+}
+
+/* Frees the run list once the context and every reader have let go of it */
+VOID
+NtfsDereferenceRunList(PNTFS_RUN_LIST RunList)
+{
+    if (InterlockedDecrement(&RunList->RefCount) == 0)
+    {
+        NtfsFreeRunList(RunList);
+    }
+}
+
+/**
+* @name NtfsLookupRun
+* @implemented
+*
+* Finds the run containing a given VCN, with a binary search.
+*
+* @return
+* Pointer to the run, or NULL if Vcn is past the last run.
+*
+*/
+PNTFS_RUN
+NtfsLookupRun(PNTFS_RUN_LIST RunList,
+              ULONGLONG Vcn)
+{
+    ULONG Low = 0;
+    ULONG High = RunList->RunCount;
+    ULONG Middle;
+    PNTFS_RUN Run;
+
+    while (Low < High)
+    {
+        Middle = Low + (High - Low) / 2;
+        Run = &RunList->Runs[Middle];
+
+        if (Vcn < Run->Vcn)
+            High = Middle;
+        else if (Vcn >= Run->Vcn + Run->Length)
+            Low = Middle + 1;
+        else
+            return Run;
+    }
+
+    return NULL;
+}
+
+/**
+* @name NtfsReadRunList
+* @implemented
+*
+* Reads the part of a non-resident attribute described by a run list. Sparse runs read as zeroes.
+*
+* @param Offset
+* Offset, in bytes, from the beginning of the attribute.
+*
+* @return
+* The number of bytes read. This is less than Length if the read goes past the last run
+* or if the disk read fails.
+*
+* @remarks
+* Physically adjacent runs are read with a single request.
+*
+*/
+ULONG
+NtfsReadRunList(PDEVICE_EXTENSION Vcb,
+                PNTFS_RUN_LIST RunList,
+                ULONGLONG Offset,
+                PCHAR Buffer,
+                ULONG Length)
+{
+    ULONG BytesPerCluster = Vcb->NtfsInfo.BytesPerCluster;
+    PNTFS_RUN Run, NextRun, LastRun;
+    ULONGLONG RunOffset;
+    ULONGLONG RunBytes;
+    ULONG ReadLength;
+    ULONG AlreadyRead = 0;
+    NTSTATUS Status;
+
+    Run = NtfsLookupRun(RunList, Offset / BytesPerCluster);
+    if (Run == NULL)
+    {
+        return 0;
+    }
+
+    LastRun = &RunList->Runs[RunList->RunCount];
+    RunOffset = Offset - Run->Vcn * BytesPerCluster;
+
+    while (Length > 0 && Run < LastRun)
+    {
+        // Merge the following runs that continue this one on the disk
+        RunBytes = Run->Length * BytesPerCluster;
+        for (NextRun = Run + 1;
+             NextRun < LastRun && RunOffset + Length > RunBytes;
+             NextRun++)
+        {
+            if (Run->Lcn == -1)
+            {
+                if (NextRun->Lcn != -1)
+                    break;
+            }
+            else if (NextRun->Lcn != Run->Lcn + (LONGLONG)(NextRun->Vcn - Run->Vcn))
+            {
+                break;
+            }
+
+            RunBytes += NextRun->Length * BytesPerCluster;
+        }
+
+        ReadLength = (ULONG)min(RunBytes - RunOffset, Length);
+        if (Run->Lcn == -1)
+        {
+            RtlZeroMemory(Buffer, ReadLength);
+        }
+        else
+        {
+            Status = NtfsReadDisk(Vcb->StorageDevice,
+                                  Run->Lcn * BytesPerCluster + RunOffset,
+                                  ReadLength,
+                                  Vcb->NtfsInfo.BytesPerSector,
+                                  (PVOID)Buffer,
+                                  FALSE);
+            if (!NT_SUCCESS(Status))
+            {
+                DPRINT1("Failed to read run at LCN %I64d: 0x%lx\n", Run->Lcn, Status);
+                break;
+            }
+        }
+
+        Length -= ReadLength;
+        Buffer += ReadLength;
+        AlreadyRead += ReadLength;
+
+        Run = NextRun;
+        RunOffset = 0;
+    }
+
+    return AlreadyRead;
+}
+
+VOID
+NtfsInitializeUnitCache(PNTFS_UNIT_CACHE Cache)
+{
+    ExInitializeFastMutex(&Cache->Lock);
+    Cache->Vcn = 0;
+    Cache->Buffer = NULL;
+}
+
+VOID
+NtfsFreeUnitCache(PNTFS_UNIT_CACHE Cache)
+{
+    if (Cache->Buffer != NULL)
+    {
+        ExFreePoolWithTag(Cache->Buffer, TAG_NTFS);
+        Cache->Buffer = NULL;
+    }
+}
+
+/*
+ * Counts the clusters of a compression unit that are allocated on the disk.
+ * Returns FALSE if the unit starts past the last run.
+ */
+static
+BOOLEAN
+GetUnitAllocation(PNTFS_RUN_LIST RunList,
+                  ULONGLONG UnitVcn,
+                  ULONG UnitClusters,
+                  PULONG Allocated)
+{
+    PNTFS_RUN Run, LastRun;
+    ULONGLONG UnitEnd = UnitVcn + UnitClusters;
+    ULONGLONG Start, End;
+
+    Run = NtfsLookupRun(RunList, UnitVcn);
+    if (Run == NULL)
+    {
+        return FALSE;
+    }
+
+    *Allocated = 0;
+    LastRun = &RunList->Runs[RunList->RunCount];
+    for (; Run < LastRun && Run->Vcn < UnitEnd; Run++)
+    {
+        if (Run->Lcn == -1)
+            continue;
+
+        Start = max(Run->Vcn, UnitVcn);
+        End = min(Run->Vcn + Run->Length, UnitEnd);
+        *Allocated += (ULONG)(End - Start);
+    }
+
+    return TRUE;
+}
+
+static
+NTSTATUS
+ReadCompressedUnit(PDEVICE_EXTENSION Vcb,
+                   PNTFS_RUN_LIST RunList,
+                   PNTFS_UNIT_CACHE Cache,
+                   ULONGLONG UnitVcn,
+                   ULONG UnitSize,
+                   ULONG CompressedSize,
+                   ULONG UnitOffset,
+                   PCHAR Buffer,
+                   ULONG Length)
+{
+    PUCHAR CompressedData;
+    PUCHAR UnitData = NULL;
+    PUCHAR OldData;
+    PVOID WorkSpace;
+    ULONG WorkSpaceSize, FragmentWorkSpaceSize;
+    ULONG FinalSize;
+    NTSTATUS Status;
+
+    // Sequential readers usually come back for the rest of the unit
+    if (Cache != NULL)
+    {
+        ExAcquireFastMutex(&Cache->Lock);
+        if (Cache->Buffer != NULL && Cache->Vcn == UnitVcn)
+        {
+            RtlCopyMemory(Buffer, Cache->Buffer + UnitOffset, Length);
+            ExReleaseFastMutex(&Cache->Lock);
+            return STATUS_SUCCESS;
+        }
+        ExReleaseFastMutex(&Cache->Lock);
+    }
+
+    // The compressed data is at the start of the unit, the rest is a hole
+    CompressedData = ExAllocatePoolWithTag(NonPagedPool, CompressedSize, TAG_NTFS);
+    if (CompressedData == NULL)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    if (NtfsReadRunList(Vcb, RunList, UnitVcn * Vcb->NtfsInfo.BytesPerCluster, (PCHAR)CompressedData, CompressedSize) != CompressedSize)
+    {
+        ExFreePoolWithTag(CompressedData, TAG_NTFS);
+        return STATUS_UNEXPECTED_IO_ERROR;
+    }
+
+    if (Length == UnitSize)
+    {
+        // The caller wants the whole unit, there is nothing to keep
+        Status = RtlDecompressBuffer(COMPRESSION_FORMAT_LZNT1,
+                                     (PUCHAR)Buffer,
+                                     Length,
+                                     CompressedData,
+                                     CompressedSize,
+                                     &FinalSize);
+    }
+    else
+    {
+        if (Cache != NULL)
+        {
+            UnitData = ExAllocatePoolWithTag(NonPagedPool, UnitSize, TAG_NTFS);
+        }
+
+        if (UnitData != NULL)
+        {
+            Status = RtlDecompressBuffer(COMPRESSION_FORMAT_LZNT1,
+                                         UnitData,
+                                         UnitSize,
+                                         CompressedData,
+                                         CompressedSize,
+                                         &FinalSize);
+            if (NT_SUCCESS(Status))
+            {
+                RtlZeroMemory(UnitData + FinalSize, UnitSize - FinalSize);
+                RtlCopyMemory(Buffer, UnitData + UnitOffset, Length);
+                FinalSize = Length;
+
+                ExAcquireFastMutex(&Cache->Lock);
+                OldData = Cache->Buffer;
+                Cache->Buffer = UnitData;
+                Cache->Vcn = UnitVcn;
+                ExReleaseFastMutex(&Cache->Lock);
+
+                UnitData = OldData;
+            }
+
+            if (UnitData != NULL)
+            {
+                ExFreePoolWithTag(UnitData, TAG_NTFS);
+            }
+        }
+        else
+        {
+            // Nowhere to keep the unit, only decompress the part that was asked for
+            Status = RtlGetCompressionWorkSpaceSize(COMPRESSION_FORMAT_LZNT1, &WorkSpaceSize, &FragmentWorkSpaceSize);
+            if (NT_SUCCESS(Status))
+            {
+                WorkSpace = ExAllocatePoolWithTag(NonPagedPool, max(FragmentWorkSpaceSize, 1), TAG_NTFS);
+                if (WorkSpace == NULL)
+                {
+                    Status = STATUS_INSUFFICIENT_RESOURCES;
+                }
+                else
+                {
+                    Status = RtlDecompressFragment(COMPRESSION_FORMAT_LZNT1,
+                                                   (PUCHAR)Buffer,
+                                                   Length,
+                                                   CompressedData,
+                                                   CompressedSize,
+                                                   UnitOffset,
+                                                   &FinalSize,
+                                                   WorkSpace);
+                    ExFreePoolWithTag(WorkSpace, TAG_NTFS);
+                }
+            }
+        }
+    }
+
+    ExFreePoolWithTag(CompressedData, TAG_NTFS);
+
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Failed to decompress the unit at VCN %I64u: 0x%lx\n", UnitVcn, Status);
+        return Status;
+    }
+
+    // Whatever wasn't in the compressed data reads as zeroes
+    if (FinalSize < Length)
+    {
+        RtlZeroMemory(Buffer + FinalSize, Length - FinalSize);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/**
+* @name NtfsReadCompressedRunList
+* @implemented
+*
+* Reads the part of a compressed non-resident attribute described by a run list.
+*
+* @param CompressionUnit
+* Log2 of the number of clusters in a compression unit, from the attribute record.
+*
+* @param Cache
+* Optional pointer to the stream's decompressed unit cache.
+*
+* @return
+* The number of bytes read. This is less than Length if the read goes past the last run
+* or if a unit can't be read.
+*
+* @remarks
+* Each compression unit is either a hole, stored as is, or LZNT1 data followed by
+* a hole. Holes are returned as zeroes without reading the disk.
+*
+*/
+ULONG
+NtfsReadCompressedRunList(PDEVICE_EXTENSION Vcb,
+                          PNTFS_RUN_LIST RunList,
+                          ULONG CompressionUnit,
+                          PNTFS_UNIT_CACHE Cache,
+                          ULONGLONG Offset,
+                          PCHAR Buffer,
+                          ULONG Length)
+{
+    ULONG BytesPerCluster = Vcb->NtfsInfo.BytesPerCluster;
+    ULONG UnitClusters = 1 << CompressionUnit;
+    ULONG UnitSize = UnitClusters * BytesPerCluster;
+    ULONGLONG UnitVcn;
+    ULONG UnitOffset;
+    ULONG ReadLength;
+    ULONG Allocated;
+    ULONG AlreadyRead = 0;
+    NTSTATUS Status;
+
+    while (Length > 0)
+    {
+        UnitVcn = (Offset / BytesPerCluster) & ~((ULONGLONG)UnitClusters - 1);
+        UnitOffset = (ULONG)(Offset - UnitVcn * BytesPerCluster);
+        ReadLength = min(UnitSize - UnitOffset, Length);
+
+        if (!GetUnitAllocation(RunList, UnitVcn, UnitClusters, &Allocated))
+        {
+            break;
+        }
+
+        if (Allocated == 0)
+        {
+            RtlZeroMemory(Buffer, ReadLength);
+        }
+        else if (Allocated == UnitClusters)
+        {
+            // This unit didn't compress, it is stored as is
+            if (NtfsReadRunList(Vcb, RunList, Offset, Buffer, ReadLength) != ReadLength)
+                break;
+        }
+        else
+        {
+            Status = ReadCompressedUnit(Vcb,
+                                        RunList,
+                                        Cache,
+                                        UnitVcn,
+                                        UnitSize,
+                                        Allocated * BytesPerCluster,
+                                        UnitOffset,
+                                        Buffer,
+                                        ReadLength);
+            if (!NT_SUCCESS(Status))
+                break;
+        }
+
+        Offset += ReadLength;
+        Buffer += ReadLength;
+        Length -= ReadLength;
+        AlreadyRead += ReadLength;
+    }
+
+    return AlreadyRead;
+}
@@ -0,0 +1,84 @@
+/*
+ * PROJECT:     ReactOS NTFS filesystem driver
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Decoded data run lists
+ */
+
+#pragma once
+
+/*
+ * A non-resident attribute's mapping pairs, decoded once into an array
+ * sorted by VCN. Runs are contiguous: each one starts where the previous
+ * one ends, holes included.
+ */
+typedef struct _NTFS_RUN
+{
+    ULONGLONG Vcn;
+    LONGLONG Lcn;       /* -1 for a sparse run */
+    ULONGLONG Length;   /* In clusters */
+} NTFS_RUN, *PNTFS_RUN;
+
+typedef struct _NTFS_RUN_LIST
+{
+    volatile LONG RefCount;     /* Readers of a shared context hold one each */
+    ULONG RunCount;
+    NTFS_RUN Runs[ANYSIZE_ARRAY];
+} NTFS_RUN_LIST, *PNTFS_RUN_LIST;
+
+/* The last decompressed compression unit of a stream */
+typedef struct _NTFS_UNIT_CACHE
+{
+    FAST_MUTEX Lock;
+    ULONGLONG Vcn;      /* First VCN of the cached unit */
+    PUCHAR Buffer;      /* NULL when nothing is cached */
+} NTFS_UNIT_CACHE, *PNTFS_UNIT_CACHE;
+
+/* runlist.c */
+
+PUCHAR
+DecodeRun(PUCHAR DataRun,
+          LONGLONG *DataRunOffset,
+          ULONGLONG *DataRunLength);
+
+NTSTATUS
+NtfsCreateRunList(PUCHAR DataRun,
+                  PNTFS_RUN_LIST *RunList);
+
+NTSTATUS
+NtfsCreateRunListFromMcb(PLARGE_MCB DataRunsMCB,
+                         PNTFS_RUN_LIST *RunList);
+
+VOID
+NtfsFreeRunList(PNTFS_RUN_LIST RunList);
+
+VOID
+NtfsReferenceRunList(PNTFS_RUN_LIST RunList);
+
+VOID
+NtfsDereferenceRunList(PNTFS_RUN_LIST RunList);
+
+PNTFS_RUN
+NtfsLookupRun(PNTFS_RUN_LIST RunList,
+              ULONGLONG Vcn);
+
+ULONG
+NtfsReadRunList(PDEVICE_EXTENSION Vcb,
+                PNTFS_RUN_LIST RunList,
+                ULONGLONG Offset,
+                PCHAR Buffer,
+                ULONG Length);
+
+ULONG
+NtfsReadCompressedRunList(PDEVICE_EXTENSION Vcb,
+                          PNTFS_RUN_LIST RunList,
+                          ULONG CompressionUnit,
+                          PNTFS_UNIT_CACHE Cache,
+                          ULONGLONG Offset,
+                          PCHAR Buffer,
+                          ULONG Length);
+
+VOID
+NtfsInitializeUnitCache(PNTFS_UNIT_CACHE Cache);
+
+VOID
+NtfsFreeUnitCache(PNTFS_UNIT_CACHE Cache);
@@ -72,13 +72,6 @@ NtfsReadFile(PDEVICE_EXTENSION DeviceExt,
 
     Fcb = (PNTFS_FCB)FileObject->FsContext;
 
-    if (NtfsFCBIsCompressed(Fcb))
-    {
-        DPRINT1("Compressed file!\n");
-        UNIMPLEMENTED;
-        return STATUS_NOT_IMPLEMENTED;
-    }
-
     if (NtfsFCBIsEncrypted(Fcb))
     {
         DPRINT1("Encrypted file!\n");
@@ -173,7 +166,10 @@ NtfsReadFile(PDEVICE_EXTENSION DeviceExt,
     }
 
     DPRINT("Effective read: %lu at %lu for stream '%S'\n", RealLength, RealReadOffset, Fcb->Stream);
-    RealLengthRead = ReadAttribute(DeviceExt, DataContext, RealReadOffset, (PCHAR)ReadBuffer, RealLength);
+    if (AttributeIsCompressed(DataContext->pRecord))
+        RealLengthRead = ReadCompressedAttribute(DeviceExt, DataContext, &Fcb->UnitCache, RealReadOffset, (PCHAR)ReadBuffer, RealLength);
+    else
+        RealLengthRead = ReadAttribute(DeviceExt, DataContext, RealReadOffset, (PCHAR)ReadBuffer, RealLength);
     if (RealLengthRead == 0)
     {
         DPRINT1("Read failure!\n");
@@ -417,6 +417,8 @@ FAT12CountAvailableClusters(
 
         if (Entry == 0)
             ulCount++;
+        else if (DeviceExt->FreeClusterBitmap.Buffer != NULL)
+            RtlSetBit(&DeviceExt->FreeClusterBitmap, i);
     }
 
     CcUnpinData(Context);
@@ -468,6 +470,8 @@ FAT16CountAvailableClusters(
         {
             if (*Block == 0)
                 ulCount++;
+            else if (DeviceExt->FreeClusterBitmap.Buffer != NULL)
+                RtlSetBit(&DeviceExt->FreeClusterBitmap, i);
             Block++;
             i++;
         }
@@ -524,6 +528,8 @@ FAT32CountAvailableClusters(
         {
             if ((*Block & 0x0fffffff) == 0)
                 ulCount++;
+            else if (DeviceExt->FreeClusterBitmap.Buffer != NULL)
+                RtlSetBit(&DeviceExt->FreeClusterBitmap, i);
             Block++;
             i++;
         }
@@ -537,6 +543,49 @@ FAT32CountAvailableClusters(
     return STATUS_SUCCESS;
 }
 
+/*
+ * FUNCTION: Allocates the free cluster bitmap, for the count of the free
+ *           clusters to fill in. Allocation then falls back to scanning the
+ *           FAT if there is no memory for it.
+ */
+static
+VOID
+AllocateFreeClusterBitmap(
+    PDEVICE_EXTENSION DeviceExt)
+{
+    ULONG Clusters;
+    PULONG Buffer;
+
+    if (DeviceExt->FreeClusterBitmap.Buffer != NULL)
+        return;
+
+    /* It's used with the FAT resource held, and paging file I/O needs that
+     * resource too: it can't be paged */
+    Clusters = DeviceExt->FatInfo.NumberOfClusters + 2;
+    Buffer = ExAllocatePoolWithTag(NonPagedPool, ROUND_UP(Clusters, 32) / 8, TAG_BITMAP);
+    if (Buffer == NULL)
+    {
+        DPRINT1("No memory for the free cluster bitmap (%u clusters)\n", Clusters);
+        return;
+    }
+
+    RtlInitializeBitMap(&DeviceExt->FreeClusterBitmap, Buffer, Clusters);
+    RtlClearAllBits(&DeviceExt->FreeClusterBitmap);
+    /* The first two FAT entries aren't clusters */
+    RtlSetBits(&DeviceExt->FreeClusterBitmap, 0, 2);
+}
+
+VOID
+DeleteFreeClusterBitmap(
+    PDEVICE_EXTENSION DeviceExt)
+{
+    if (DeviceExt->FreeClusterBitmap.Buffer != NULL)
+    {
+        ExFreePoolWithTag(DeviceExt->FreeClusterBitmap.Buffer, TAG_BITMAP);
+        DeviceExt->FreeClusterBitmap.Buffer = NULL;
+    }
+}
+
 NTSTATUS
 CountAvailableClusters(
     PDEVICE_EXTENSION DeviceExt,
@@ -546,12 +595,18 @@ CountAvailableClusters(
     ExAcquireResourceExclusiveLite (&DeviceExt->FatResource, TRUE);
     if (!DeviceExt->AvailableClustersValid)
     {
+        AllocateFreeClusterBitmap(DeviceExt);
+
         if (DeviceExt->FatInfo.FatType == FAT12)
             Status = FAT12CountAvailableClusters(DeviceExt);
         else if (DeviceExt->FatInfo.FatType == FAT16 || DeviceExt->FatInfo.FatType == FATX16)
             Status = FAT16CountAvailableClusters(DeviceExt);
         else
             Status = FAT32CountAvailableClusters(DeviceExt);
+
+        /* A partly filled bitmap would hand out clusters in use */
+        if (!NT_SUCCESS(Status))
+            DeleteFreeClusterBitmap(DeviceExt);
     }
     if (Clusters != NULL)
     {
@@ -719,10 +774,79 @@ WriteCluster(
         else if (OldValue == 0 && NewValue)
             InterlockedDecrement((PLONG)&DeviceExt->AvailableClusters);
     }
+    if (NT_SUCCESS(Status) && DeviceExt->FreeClusterBitmap.Buffer != NULL &&
+        ClusterToWrite < DeviceExt->FreeClusterBitmap.SizeOfBitMap)
+    {
+        if (NewValue == 0)
+            RtlClearBit(&DeviceExt->FreeClusterBitmap, ClusterToWrite);
+        else
+            RtlSetBit(&DeviceExt->FreeClusterBitmap, ClusterToWrite);
+    }
     ExReleaseResourceLite(&DeviceExt->FatResource);
     return Status;
 }
 
+/*
+ * FUNCTION: Finds up to ClusterCount free clusters that follow each other on
+ *           the disk, chains them together and marks the last one as end of
+ *           chain. Without the free cluster bitmap, it's a single cluster
+ *           found by scanning the FAT. The FAT resource must be held
+ *           exclusively.
+ */
+static
+NTSTATUS
+FindAndMarkAvailableClusters(
+    PDEVICE_EXTENSION DeviceExt,
+    ULONG ClusterCount,
+    PULONG Cluster,
+    PULONG Count)
+{
+    PRTL_BITMAP Bitmap = &DeviceExt->FreeClusterBitmap;
+    ULONG StartCluster;
+    ULONG i;
+    NTSTATUS Status;
+
+    ASSERT(ClusterCount > 0);
+
+    if (Bitmap->Buffer == NULL)
+    {
+        *Count = 1;
+        return DeviceExt->FindAndMarkAvailableCluster(DeviceExt, Cluster);
+    }
+
+    /* The first run long enough from the last allocation on, or else the
+     * longest run there is */
+    StartCluster = RtlFindClearBits(Bitmap, ClusterCount, DeviceExt->LastAvailableCluster);
+    if (StartCluster == MAXULONG)
+    {
+        ClusterCount = RtlFindLongestRunClear(Bitmap, &StartCluster);
+        if (ClusterCount == 0)
+        {
+            return STATUS_DISK_FULL;
+        }
+    }
+
+    for (i = 0; i < ClusterCount; i++)
+    {
+        Status = WriteCluster(DeviceExt, StartCluster + i,
+                              i + 1 < ClusterCount ? StartCluster + i + 1 : 0xffffffff);
+        if (!NT_SUCCESS(Status))
+        {
+            while (i-- > 0)
+            {
+                WriteCluster(DeviceExt, StartCluster + i, 0);
+            }
+            return Status;
+        }
+    }
+
+    DPRINT("Found available clusters 0x%x-0x%x\n", StartCluster, StartCluster + ClusterCount - 1);
+    DeviceExt->LastAvailableCluster = StartCluster + ClusterCount - 1;
+    *Cluster = StartCluster;
+    *Count = ClusterCount;
+    return STATUS_SUCCESS;
+}
+
 /*
  * FUNCTION: Converts the cluster number to a sector number for this physical
  *           device
@@ -776,6 +900,7 @@ GetNextClusterExtend(
     PULONG NextCluster)
 {
     ULONG NewCluster;
+    ULONG Count;
     NTSTATUS Status;
 
     DPRINT("GetNextClusterExtend(DeviceExt %p, CurrentCluster %x)\n",
@@ -788,7 +913,7 @@ GetNextClusterExtend(
      */
     if (CurrentCluster == 0)
     {
-        Status = DeviceExt->FindAndMarkAvailableCluster(DeviceExt, &NewCluster);
+        Status = FindAndMarkAvailableClusters(DeviceExt, 1, &NewCluster, &Count);
         if (!NT_SUCCESS(Status))
         {
             ExReleaseResourceLite(&DeviceExt->FatResource);
@@ -807,7 +932,7 @@ GetNextClusterExtend(
         /* We are after last existing cluster, we must add one to file */
         /* Firstly, find the next available open allocation unit and
            mark it as end of file */
-        Status = DeviceExt->FindAndMarkAvailableCluster(DeviceExt, &NewCluster);
+        Status = FindAndMarkAvailableClusters(DeviceExt, 1, &NewCluster, &Count);
         if (!NT_SUCCESS(Status))
         {
             ExReleaseResourceLite(&DeviceExt->FatResource);
@@ -824,6 +949,98 @@ GetNextClusterExtend(
     return Status;
 }
 
+/*
+ * FUNCTION: Frees the clusters of a chain. The FAT resource must be held
+ *           exclusively.
+ */
+static
+VOID
+FreeClusterChain(
+    PDEVICE_EXTENSION DeviceExt,
+    ULONG Cluster)
+{
+    ULONG NextCluster;
+
+    while (Cluster > 1 && Cluster != 0xffffffff)
+    {
+        if (!NT_SUCCESS(DeviceExt->GetNextCluster(DeviceExt, Cluster, &NextCluster)))
+            break;
+        WriteCluster(DeviceExt, Cluster, 0);
+        Cluster = NextCluster;
+    }
+}
+
+/*
+ * FUNCTION: Appends ClusterCount clusters to the chain ending at LastCluster,
+ *           or makes a new chain if LastCluster is 0, in as few extents as
+ *           the free space allows. On failure the chain is left as it was.
+ */
+NTSTATUS
+ExtendClusterChain(
+    PDEVICE_EXTENSION DeviceExt,
+    ULONG LastCluster,
+    ULONG ClusterCount,
+    PULONG FirstNewCluster)
+{
+    ULONG PreviousCluster = 0;
+    ULONG NewCluster;
+    ULONG Count;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    DPRINT("ExtendClusterChain(DeviceExt %p, LastCluster %x, ClusterCount %u)\n",
+           DeviceExt, LastCluster, ClusterCount);
+
+    ASSERT(ClusterCount > 0);
+    *FirstNewCluster = 0;
+
+    ExAcquireResourceExclusiveLite(&DeviceExt->FatResource, TRUE);
+
+    if (DeviceExt->AvailableClustersValid && DeviceExt->AvailableClusters < ClusterCount)
+    {
+        ExReleaseResourceLite(&DeviceExt->FatResource);
+        return STATUS_DISK_FULL;
+    }
+
+    while (ClusterCount > 0)
+    {
+        Status = FindAndMarkAvailableClusters(DeviceExt, ClusterCount, &NewCluster, &Count);
+        if (!NT_SUCCESS(Status))
+            break;
+
+        if (PreviousCluster == 0)
+        {
+            *FirstNewCluster = NewCluster;
+        }
+        else
+        {
+            Status = WriteCluster(DeviceExt, PreviousCluster, NewCluster);
+            if (!NT_SUCCESS(Status))
+            {
+                FreeClusterChain(DeviceExt, NewCluster);
+                break;
+            }
+        }
+
+        PreviousCluster = NewCluster + Count - 1;
+        ClusterCount -= Count;
+    }
+
+    /* Only link the new clusters once they are all there */
+    if (NT_SUCCESS(Status) && LastCluster != 0)
+    {
+        Status = WriteCluster(DeviceExt, LastCluster, *FirstNewCluster);
+    }
+
+    if (!NT_SUCCESS(Status))
+    {
+        FreeClusterChain(DeviceExt, *FirstNewCluster);
+        *FirstNewCluster = 0;
+    }
+
+    ExReleaseResourceLite(&DeviceExt->FatResource);
+    return Status;
+}
+
 /*
  * FUNCTION: Retrieve the dirty status
  */
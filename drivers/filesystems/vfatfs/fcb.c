@@ -150,7 +150,8 @@ vfatNewFCB(
     ExInitializeResourceLite(&rcFCB->PagingIoResource);
     ExInitializeResourceLite(&rcFCB->MainResource);
     FsRtlInitializeFileLock(&rcFCB->FileLock, NULL, NULL);
-    ExInitializeFastMutex(&rcFCB->LastMutex);
+    ExInitializeResourceLite(&rcFCB->ExtentResource);
+    FsRtlInitializeLargeMcb(&rcFCB->ExtentMap, NonPagedPool);
     rcFCB->RFCB.PagingIoResource = &rcFCB->PagingIoResource;
     rcFCB->RFCB.Resource = &rcFCB->MainResource;
     rcFCB->RFCB.IsFastIoPossible = FastIoIsNotPossible;
@@ -283,6 +284,8 @@ vfatDestroyFCB(
         RemoveEntryList(&pFCB->ParentListEntry);
     }
     ExFreePool(pFCB->PathNameBuffer);
+    FsRtlUninitializeLargeMcb(&pFCB->ExtentMap);
+    ExDeleteResourceLite(&pFCB->ExtentResource);
     ExDeleteResourceLite(&pFCB->PagingIoResource);
     ExDeleteResourceLite(&pFCB->MainResource);
     ASSERT(IsListEmpty(&pFCB->ParentListHead));
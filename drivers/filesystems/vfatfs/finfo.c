@@ -1248,35 +1248,38 @@ VfatSetAllocationSizeInformation(
         AllocSizeChanged = TRUE;
         if (FirstCluster == 0)
         {
-            Fcb->LastCluster = Fcb->LastOffset = 0;
-            Status = NextCluster(DeviceExt, FirstCluster, &FirstCluster, TRUE);
+            Cluster = 0;
+        }
+        else
+        {
+            /* The new clusters go after the last one of the chain */
+            Status = OffsetToCluster(DeviceExt, Fcb,
+                                     Fcb->RFCB.AllocationSize.u.LowPart - ClusterSize, 1,
+                                     &Cluster, NULL);
             if (!NT_SUCCESS(Status))
             {
-                DPRINT1("NextCluster failed. Status = %x\n", Status);
                 return Status;
             }
 
-            if (FirstCluster == 0xffffffff)
+            if (Cluster == 0xffffffff)
             {
-                return STATUS_DISK_FULL;
+                return STATUS_FILE_CORRUPT_ERROR;
             }
+        }
 
-            Status = OffsetToCluster(DeviceExt, FirstCluster,
-                                     ROUND_DOWN(NewSize - 1, ClusterSize),
-                                     &NCluster, TRUE);
-            if (NCluster == 0xffffffff || !NT_SUCCESS(Status))
-            {
-                /* disk is full */
-                NCluster = Cluster = FirstCluster;
-                Status = STATUS_SUCCESS;
-                while (NT_SUCCESS(Status) && Cluster != 0xffffffff && Cluster > 1)
-                {
-                    Status = NextCluster(DeviceExt, FirstCluster, &NCluster, FALSE);
-                    WriteCluster(DeviceExt, Cluster, 0);
-                    Cluster = NCluster;
-                }
-                return STATUS_DISK_FULL;
-            }
+        /* Allocate them all at once, as contiguous as the free space allows */
+        Status = ExtendClusterChain(DeviceExt, Cluster,
+                                    (ROUND_DOWN(NewSize - 1, ClusterSize) - Fcb->RFCB.AllocationSize.u.LowPart) / ClusterSize + 1,
+                                    &NCluster);
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("ExtendClusterChain failed. Status = %x\n", Status);
+            return Status;
+        }
+
+        if (FirstCluster == 0)
+        {
+            FirstCluster = NCluster;
 
             if (IsFatX)
             {
@@ -1296,58 +1299,6 @@ VfatSetAllocationSizeInformation(
                 }
             }
         }
-        else
-        {
-            if (Fcb->LastCluster > 0)
-            {
-                if (Fcb->RFCB.AllocationSize.u.LowPart - ClusterSize == Fcb->LastOffset)
-                {
-                    Cluster = Fcb->LastCluster;
-                    Status = STATUS_SUCCESS;
-                }
-                else
-                {
-                    Status = OffsetToCluster(DeviceExt, Fcb->LastCluster,
-                                             Fcb->RFCB.AllocationSize.u.LowPart - ClusterSize - Fcb->LastOffset,
-                                             &Cluster, FALSE);
-                }
-            }
-            else
-            {
-                Status = OffsetToCluster(DeviceExt, FirstCluster,
-                                         Fcb->RFCB.AllocationSize.u.LowPart - ClusterSize,
-                                         &Cluster, FALSE);
-            }
-
-            if (!NT_SUCCESS(Status))
-            {
-                return Status;
-            }
-
-            Fcb->LastCluster = Cluster;
-            Fcb->LastOffset = Fcb->RFCB.AllocationSize.u.LowPart - ClusterSize;
-
-            /* FIXME: Check status */
-            /* Cluster points now to the last cluster within the chain */
-            Status = OffsetToCluster(DeviceExt, Cluster,
-                                     ROUND_DOWN(NewSize - 1, ClusterSize) - Fcb->LastOffset,
-                                     &NCluster, TRUE);
-            if (NCluster == 0xffffffff || !NT_SUCCESS(Status))
-            {
-                /* disk is full */
-                NCluster = Cluster;
-                Status = NextCluster(DeviceExt, FirstCluster, &NCluster, FALSE);
-                WriteCluster(DeviceExt, Cluster, 0xffffffff);
-                Cluster = NCluster;
-                while (NT_SUCCESS(Status) && Cluster != 0xffffffff && Cluster > 1)
-                {
-                    Status = NextCluster(DeviceExt, FirstCluster, &NCluster, FALSE);
-                    WriteCluster(DeviceExt, Cluster, 0);
-                    Cluster = NCluster;
-                }
-                return STATUS_DISK_FULL;
-            }
-        }
         UpdateFileSize(FileObject, Fcb, NewSize, ClusterSize, vfatVolumeIsFatX(DeviceExt));
     }
     else if (NewSize + ClusterSize <= Fcb->RFCB.AllocationSize.u.LowPart)
@@ -1362,19 +1313,20 @@ VfatSetAllocationSizeInformation(
         DPRINT("Can set file size\n");
 
         AllocSizeChanged = TRUE;
-        /* FIXME: Use the cached cluster/offset better way. */
-        Fcb->LastCluster = Fcb->LastOffset = 0;
         UpdateFileSize(FileObject, Fcb, NewSize, ClusterSize, vfatVolumeIsFatX(DeviceExt));
         if (NewSize > 0)
         {
-            Status = OffsetToCluster(DeviceExt, FirstCluster,
-                                     ROUND_DOWN(NewSize - 1, ClusterSize),
-                                     &Cluster, FALSE);
-
-            NCluster = Cluster;
-            Status = NextCluster(DeviceExt, FirstCluster, &NCluster, FALSE);
-            WriteCluster(DeviceExt, Cluster, 0xffffffff);
-            Cluster = NCluster;
+            Status = OffsetToCluster(DeviceExt, Fcb,
+                                     ROUND_DOWN(NewSize - 1, ClusterSize), 1,
+                                     &Cluster, NULL);
+            if (NT_SUCCESS(Status) && Cluster != 0xffffffff)
+            {
+                NCluster = Cluster;
+                Status = NextCluster(DeviceExt, FirstCluster, &NCluster, FALSE);
+                WriteCluster(DeviceExt, Cluster, 0xffffffff);
+                Cluster = NCluster;
+            }
+            TruncateExtentMap(Fcb, ROUND_DOWN(NewSize - 1, ClusterSize) / ClusterSize + 1);
         }
         else
         {
@@ -1394,6 +1346,7 @@ VfatSetAllocationSizeInformation(
                     Fcb->entry.Fat.FirstCluster = 0;
                 }
             }
+            TruncateExtentMap(Fcb, 0);
 
             NCluster = Cluster = FirstCluster;
             Status = STATUS_SUCCESS;
@@ -813,6 +813,8 @@ ByeBye:
             ExFreePoolWithTag(DeviceExt->SpareVPB, TAG_VPB);
         if (DeviceExt && DeviceExt->Statistics)
             ExFreePoolWithTag(DeviceExt->Statistics, TAG_STATS);
+        if (DeviceExt)
+            DeleteFreeClusterBitmap(DeviceExt);
         if (DeviceObject)
             IoDeleteDevice(DeviceObject);
     }
@@ -940,9 +942,9 @@ VfatGetRetrievalPointers(
     ULONG MaxExtentCount;
     PVFATFCB Fcb;
     PDEVICE_EXTENSION DeviceExt;
-    ULONG FirstCluster;
     ULONG CurrentCluster;
-    ULONG LastCluster;
+    ULONG ClusterCount;
+    ULONG AllocatedClusters;
     NTSTATUS Status;
 
     DPRINT("VfatGetRetrievalPointers(IrpContext %p)\n", IrpContext);
@@ -971,46 +973,38 @@ VfatGetRetrievalPointers(
 
     MaxExtentCount = ((Stack->Parameters.DeviceIoControl.OutputBufferLength - sizeof(RetrievalPointers->ExtentCount) - sizeof(RetrievalPointers->StartingVcn)) / sizeof(RetrievalPointers->Extents[0]));
 
-    if (Vcn.QuadPart >= Fcb->RFCB.AllocationSize.QuadPart / DeviceExt->FatInfo.BytesPerCluster)
+    AllocatedClusters = (ULONG)(Fcb->RFCB.AllocationSize.QuadPart / DeviceExt->FatInfo.BytesPerCluster);
+    if (Vcn.QuadPart < 0 || Vcn.QuadPart >= AllocatedClusters)
     {
         Status = STATUS_INVALID_PARAMETER;
         goto ByeBye;
     }
 
-    CurrentCluster = FirstCluster = vfatDirEntryGetFirstCluster(DeviceExt, &Fcb->entry);
-    Status = OffsetToCluster(DeviceExt, FirstCluster,
-                             Vcn.u.LowPart * DeviceExt->FatInfo.BytesPerCluster,
-                             &CurrentCluster, FALSE);
-    if (!NT_SUCCESS(Status))
-    {
-        goto ByeBye;
-    }
-
     RetrievalPointers->StartingVcn = Vcn;
     RetrievalPointers->ExtentCount = 0;
-    RetrievalPointers->Extents[0].Lcn.u.HighPart = 0;
-    RetrievalPointers->Extents[0].Lcn.u.LowPart = CurrentCluster - 2;
-    LastCluster = 0;
-    while (CurrentCluster != 0xffffffff && RetrievalPointers->ExtentCount < MaxExtentCount)
+
+    /* The runs of the extent map are the extents */
+    while (Vcn.u.LowPart < AllocatedClusters && RetrievalPointers->ExtentCount < MaxExtentCount)
     {
-        LastCluster = CurrentCluster;
-        Status = NextCluster(DeviceExt, CurrentCluster, &CurrentCluster, FALSE);
-        Vcn.QuadPart++;
+        Status = OffsetToCluster(DeviceExt, Fcb,
+                                 Vcn.u.LowPart * DeviceExt->FatInfo.BytesPerCluster,
+                                 (AllocatedClusters - Vcn.u.LowPart) * DeviceExt->FatInfo.BytesPerCluster,
+                                 &CurrentCluster, &ClusterCount);
         if (!NT_SUCCESS(Status))
         {
             goto ByeBye;
         }
 
-        if (LastCluster + 1 != CurrentCluster)
+        if (CurrentCluster == 0xffffffff)
         {
-            RetrievalPointers->Extents[RetrievalPointers->ExtentCount].NextVcn = Vcn;
-            RetrievalPointers->ExtentCount++;
-            if (RetrievalPointers->ExtentCount < MaxExtentCount)
-            {
-                RetrievalPointers->Extents[RetrievalPointers->ExtentCount].Lcn.u.HighPart = 0;
-                RetrievalPointers->Extents[RetrievalPointers->ExtentCount].Lcn.u.LowPart = CurrentCluster - 2;
-            }
+            break;
         }
+
+        Vcn.QuadPart += ClusterCount;
+        RetrievalPointers->Extents[RetrievalPointers->ExtentCount].Lcn.u.HighPart = 0;
+        RetrievalPointers->Extents[RetrievalPointers->ExtentCount].Lcn.u.LowPart = CurrentCluster - 2;
+        RetrievalPointers->Extents[RetrievalPointers->ExtentCount].NextVcn = Vcn;
+        RetrievalPointers->ExtentCount++;
     }
 
     IrpContext->Irp->IoStatus.Information = sizeof(RETRIEVAL_POINTERS_BUFFER) + (sizeof(RetrievalPointers->Extents[0]) * (RetrievalPointers->ExtentCount - 1));
@@ -13,15 +13,6 @@
 #define NDEBUG
 #include <debug.h>
 
-/*
- * Uncomment to enable strict verification of cluster/offset pair
- * caching. If this option is enabled you lose all the benefits of
- * the caching and the read/write operations will actually be
- * slower. It's meant only for debugging!!!
- * - Filip Navara, 26/07/2004
- */
-/* #define DEBUG_VERIFY_OFFSET_CACHING */
-
 /* Arbitrary, taken from MS FastFAT, should be
  * refined given what we experience in common
  * out of stack operations
@@ -55,60 +46,187 @@ NextCluster(
     }
 }
 
+/*
+ * Fill the extent map of the FCB from the FAT until it holds the first
+ * ClusterCount clusters of the file, or the whole chain if it is shorter.
+ * The extent resource of the FCB must be held exclusively.
+ */
+static
+NTSTATUS
+LoadExtentMap(
+    PDEVICE_EXTENSION DeviceExt,
+    PVFATFCB Fcb,
+    ULONG ClusterCount)
+{
+    LONGLONG Lbn;
+    ULONG Cluster, RunVcn, RunLbn = 0, RunLength;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    if (Fcb->ExtentClusters >= ClusterCount)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    ExAcquireResourceSharedLite(&DeviceExt->FatResource, TRUE);
+
+    if (Fcb->ExtentClusters == 0)
+    {
+        Cluster = vfatDirEntryGetFirstCluster(DeviceExt, &Fcb->entry);
+        if (Cluster == 0)
+        {
+            /* Nothing allocated */
+            Cluster = 0xffffffff;
+        }
+    }
+    else
+    {
+        /* Carry on from the last cluster in the map */
+        FsRtlLookupLargeMcbEntry(&Fcb->ExtentMap, Fcb->ExtentClusters - 1, &Lbn, NULL, NULL, NULL, NULL);
+        Status = DeviceExt->GetNextCluster(DeviceExt, (ULONG)Lbn, &Cluster);
+    }
+
+    /* Collect contiguous clusters, and add them to the map one run at a time */
+    RunVcn = Fcb->ExtentClusters;
+    RunLength = 0;
+
+    while (NT_SUCCESS(Status) && Cluster != 0xffffffff)
+    {
+        if (Cluster < 2 || Cluster >= DeviceExt->FatInfo.NumberOfClusters + 2)
+        {
+            DPRINT1("WARNING: File system corruption detected. You may need to run a disk repair utility.\n");
+            if (VfatGlobalData->Flags & VFAT_BREAK_ON_CORRUPTION)
+                ASSERT(FALSE);
+            Status = STATUS_FILE_CORRUPT_ERROR;
+            break;
+        }
+
+        if (RunLength != 0 && Cluster != RunLbn + RunLength)
+        {
+            if (!FsRtlAddLargeMcbEntry(&Fcb->ExtentMap, RunVcn, RunLbn, RunLength))
+            {
+                RunLength = 0;
+                Status = STATUS_INSUFFICIENT_RESOURCES;
+                break;
+            }
+
+            Fcb->ExtentClusters += RunLength;
+            RunVcn += RunLength;
+            RunLength = 0;
+        }
+
+        if (RunLength == 0)
+        {
+            RunLbn = Cluster;
+        }
+        RunLength++;
+
+        if (RunVcn + RunLength >= ClusterCount)
+        {
+            break;
+        }
+
+        Status = DeviceExt->GetNextCluster(DeviceExt, Cluster, &Cluster);
+    }
+
+    /* Whatever was read of the chain is still good, even if we failed later */
+    if (RunLength != 0)
+    {
+        if (FsRtlAddLargeMcbEntry(&Fcb->ExtentMap, RunVcn, RunLbn, RunLength))
+            Fcb->ExtentClusters += RunLength;
+        else if (NT_SUCCESS(Status))
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    ExReleaseResourceLite(&DeviceExt->FatResource);
+
+    return Status;
+}
+
+/*
+ * Return the cluster of the file at FileOffset and, if RunLength is given,
+ * how many clusters of the file follow it on the disk within the Length bytes
+ * from FileOffset. *Cluster is 0xffffffff if the chain ends before FileOffset.
+ */
 NTSTATUS
 OffsetToCluster(
     PDEVICE_EXTENSION DeviceExt,
-    ULONG FirstCluster,
+    PVFATFCB Fcb,
     ULONG FileOffset,
+    ULONG Length,
     PULONG Cluster,
-    BOOLEAN Extend)
+    PULONG RunLength)
 {
-    ULONG CurrentCluster;
-    ULONG i;
+    ULONG BytesPerCluster = DeviceExt->FatInfo.BytesPerCluster;
+    ULONG Vcn, ClusterCount;
+    LONGLONG Lbn, ClustersFromLbn;
     NTSTATUS Status;
-/*
-    DPRINT("OffsetToCluster(DeviceExt %x, Fcb %x, FirstCluster %x,"
-           " FileOffset %x, Cluster %x, Extend %d)\n", DeviceExt,
-           Fcb, FirstCluster, FileOffset, Cluster, Extend);
-*/
-    if (FirstCluster == 0)
-    {
-        DbgPrint("OffsetToCluster is called with FirstCluster = 0!\n");
-        ASSERT(FALSE);
-    }
 
-    if (FirstCluster == 1)
+    ASSERT(Length > 0);
+
+    Vcn = FileOffset / BytesPerCluster;
+    ClusterCount = (ULONG)(((ULONGLONG)FileOffset + Length - 1) / BytesPerCluster) - Vcn + 1;
+
+    if (vfatDirEntryGetFirstCluster(DeviceExt, &Fcb->entry) == 1)
     {
         /* root of FAT16 or FAT12 */
-        *Cluster = DeviceExt->FatInfo.rootStart + FileOffset
-            / (DeviceExt->FatInfo.BytesPerCluster) * DeviceExt->FatInfo.SectorsPerCluster;
+        *Cluster = DeviceExt->FatInfo.rootStart + Vcn * DeviceExt->FatInfo.SectorsPerCluster;
+        if (RunLength != NULL)
+            *RunLength = ClusterCount;
         return STATUS_SUCCESS;
     }
+
+    /* Only walk the FAT, exclusively, if the map doesn't cover the range yet */
+    ExAcquireResourceSharedLite(&Fcb->ExtentResource, TRUE);
+    if (Fcb->ExtentClusters < Vcn + ClusterCount)
+    {
+        ExReleaseResourceLite(&Fcb->ExtentResource);
+        ExAcquireResourceExclusiveLite(&Fcb->ExtentResource, TRUE);
+        Status = LoadExtentMap(DeviceExt, Fcb, Vcn + ClusterCount);
+    }
     else
     {
-        CurrentCluster = FirstCluster;
-        if (Extend)
+        Status = STATUS_SUCCESS;
+    }
+
+    if (NT_SUCCESS(Status))
+    {
+        if (Vcn < Fcb->ExtentClusters &&
+            FsRtlLookupLargeMcbEntry(&Fcb->ExtentMap, Vcn, &Lbn, &ClustersFromLbn, NULL, NULL, NULL) &&
+            Lbn != -1)
         {
-            for (i = 0; i < FileOffset / DeviceExt->FatInfo.BytesPerCluster; i++)
-            {
-                Status = GetNextClusterExtend (DeviceExt, CurrentCluster, &CurrentCluster);
-                if (!NT_SUCCESS(Status))
-                    return Status;
-            }
-            *Cluster = CurrentCluster;
+            *Cluster = (ULONG)Lbn;
+            if (RunLength != NULL)
+                *RunLength = (ULONG)min(ClustersFromLbn, ClusterCount);
         }
         else
         {
-            for (i = 0; i < FileOffset / DeviceExt->FatInfo.BytesPerCluster; i++)
-            {
-                Status = GetNextCluster (DeviceExt, CurrentCluster, &CurrentCluster);
-                if (!NT_SUCCESS(Status))
-                    return Status;
-            }
-            *Cluster = CurrentCluster;
-       }
-       return STATUS_SUCCESS;
-   }
+            *Cluster = 0xffffffff;
+            if (RunLength != NULL)
+                *RunLength = 0;
+        }
+    }
+
+    ExReleaseResourceLite(&Fcb->ExtentResource);
+
+    return Status;
+}
+
+/*
+ * Forget the clusters of the extent map from ClusterCount on, once the chain
+ * has been cut there, or freed for 0
+ */
+VOID
+TruncateExtentMap(
+    PVFATFCB Fcb,
+    ULONG ClusterCount)
+{
+    ExAcquireResourceExclusiveLite(&Fcb->ExtentResource, TRUE);
+    if (Fcb->ExtentClusters > ClusterCount)
+    {
+        FsRtlTruncateLargeMcb(&Fcb->ExtentMap, ClusterCount);
+        Fcb->ExtentClusters = ClusterCount;
+    }
+    ExReleaseResourceLite(&Fcb->ExtentResource);
 }
 
 /*
@@ -122,20 +240,16 @@ VfatReadFileData(
     LARGE_INTEGER ReadOffset,
     PULONG LengthRead)
 {
-    ULONG CurrentCluster;
     ULONG FirstCluster;
     ULONG StartCluster;
     ULONG ClusterCount;
     LARGE_INTEGER StartOffset;
     PDEVICE_EXTENSION DeviceExt;
-    BOOLEAN First = TRUE;
     PVFATFCB Fcb;
-    NTSTATUS Status;
+    NTSTATUS Status = STATUS_SUCCESS;
     ULONG BytesDone;
     ULONG BytesPerSector;
     ULONG BytesPerCluster;
-    ULONG LastCluster;
-    ULONG LastOffset;
 
     /* PRECONDITION */
     ASSERT(IrpContext);
@@ -192,8 +306,7 @@ VfatReadFileData(
     }
 
     /* Find the first cluster */
-    FirstCluster =
-    CurrentCluster = vfatDirEntryGetFirstCluster (DeviceExt, &Fcb->entry);
+    FirstCluster = vfatDirEntryGetFirstCluster (DeviceExt, &Fcb->entry);
 
     if (FirstCluster == 1)
     {
@@ -213,87 +326,24 @@ VfatReadFileData(
         return Status;
     }
 
-    ExAcquireFastMutex(&Fcb->LastMutex);
-    LastCluster = Fcb->LastCluster;
-    LastOffset = Fcb->LastOffset;
-    ExReleaseFastMutex(&Fcb->LastMutex);
-
-    /* Find the cluster to start the read from */
-    if (LastCluster > 0 && ReadOffset.u.LowPart >= LastOffset)
-    {
-        Status = OffsetToCluster(DeviceExt, LastCluster,
-                                 ROUND_DOWN(ReadOffset.u.LowPart, BytesPerCluster) -
-                                 LastOffset,
-                                 &CurrentCluster, FALSE);
-#ifdef DEBUG_VERIFY_OFFSET_CACHING
-        /* DEBUG VERIFICATION */
-        {
-            ULONG CorrectCluster;
-            OffsetToCluster(DeviceExt, FirstCluster,
-                            ROUND_DOWN(ReadOffset.u.LowPart, BytesPerCluster),
-                            &CorrectCluster, FALSE);
-            if (CorrectCluster != CurrentCluster)
-                KeBugCheck(FAT_FILE_SYSTEM);
-        }
-#endif
-    }
-    else
-    {
-        Status = OffsetToCluster(DeviceExt, FirstCluster,
-                                 ROUND_DOWN(ReadOffset.u.LowPart, BytesPerCluster),
-                                 &CurrentCluster, FALSE);
-    }
-
-    if (!NT_SUCCESS(Status))
-    {
-        return Status;
-    }
-
-    ExAcquireFastMutex(&Fcb->LastMutex);
-    Fcb->LastCluster = CurrentCluster;
-    Fcb->LastOffset = ROUND_DOWN (ReadOffset.u.LowPart, BytesPerCluster);
-    ExReleaseFastMutex(&Fcb->LastMutex);
-
     KeInitializeEvent(&IrpContext->Event, NotificationEvent, FALSE);
     IrpContext->RefCount = 1;
 
-    while (Length > 0 && CurrentCluster != 0xffffffff)
+    while (Length > 0)
     {
-        StartCluster = CurrentCluster;
-        StartOffset.QuadPart = ClusterToSector(DeviceExt, StartCluster) * BytesPerSector;
-        BytesDone = 0;
-        ClusterCount = 0;
-
-        do
+        /* Find the extent to read from */
+        Status = OffsetToCluster(DeviceExt, Fcb, ReadOffset.u.LowPart, Length,
+                                 &StartCluster, &ClusterCount);
+        if (!NT_SUCCESS(Status) || StartCluster == 0xffffffff)
         {
-            ClusterCount++;
-            if (First)
-            {
-                BytesDone =  min (Length, BytesPerCluster - (ReadOffset.u.LowPart % BytesPerCluster));
-                StartOffset.QuadPart += ReadOffset.u.LowPart % BytesPerCluster;
-                First = FALSE;
-            }
-            else
-            {
-                if (Length - BytesDone > BytesPerCluster)
-                {
-                    BytesDone += BytesPerCluster;
-                }
-                else
-                {
-                    BytesDone = Length;
-                }
-            }
-            Status = NextCluster(DeviceExt, FirstCluster, &CurrentCluster, FALSE);
+            break;
         }
-        while (StartCluster + ClusterCount == CurrentCluster && NT_SUCCESS(Status) && Length > BytesDone);
-        DPRINT("start %08x, next %08x, count %u\n",
-               StartCluster, CurrentCluster, ClusterCount);
 
-        ExAcquireFastMutex(&Fcb->LastMutex);
-        Fcb->LastCluster = StartCluster + (ClusterCount - 1);
-        Fcb->LastOffset = ROUND_DOWN(ReadOffset.u.LowPart, BytesPerCluster) + (ClusterCount - 1) * BytesPerCluster;
-        ExReleaseFastMutex(&Fcb->LastMutex);
+        StartOffset.QuadPart = ClusterToSector(DeviceExt, StartCluster) * BytesPerSector +
+                               ReadOffset.u.LowPart % BytesPerCluster;
+        BytesDone = (ULONG)min((ULONGLONG)Length,
+                               (ULONGLONG)ClusterCount * BytesPerCluster - ReadOffset.u.LowPart % BytesPerCluster);
+        DPRINT("start %08x, count %u\n", StartCluster, ClusterCount);
 
         /* Fire up the read command */
         Status = VfatReadDiskPartial (IrpContext, &StartOffset, BytesDone, *LengthRead, FALSE);
@@ -337,18 +387,14 @@ VfatWriteFileData(
     PVFATFCB Fcb;
     ULONG Count;
     ULONG FirstCluster;
-    ULONG CurrentCluster;
     ULONG BytesDone;
     ULONG StartCluster;
     ULONG ClusterCount;
     NTSTATUS Status = STATUS_SUCCESS;
-    BOOLEAN First = TRUE;
     ULONG BytesPerSector;
     ULONG BytesPerCluster;
     LARGE_INTEGER StartOffset;
     ULONG BufferOffset;
-    ULONG LastCluster;
-    ULONG LastOffset;
 
     /* PRECONDITION */
     ASSERT(IrpContext);
@@ -413,8 +459,7 @@ VfatWriteFileData(
     /*
      * Find the first cluster
      */
-    FirstCluster =
-    CurrentCluster = vfatDirEntryGetFirstCluster (DeviceExt, &Fcb->entry);
+    FirstCluster = vfatDirEntryGetFirstCluster (DeviceExt, &Fcb->entry);
 
     if (FirstCluster == 1)
     {
@@ -426,89 +471,26 @@ VfatWriteFileData(
         return Status;
     }
 
-    ExAcquireFastMutex(&Fcb->LastMutex);
-    LastCluster = Fcb->LastCluster;
-    LastOffset = Fcb->LastOffset;
-    ExReleaseFastMutex(&Fcb->LastMutex);
-
-    /*
-     * Find the cluster to start the write from
-     */
-    if (LastCluster > 0 && WriteOffset.u.LowPart >= LastOffset)
-    {
-        Status = OffsetToCluster(DeviceExt, LastCluster,
-                                 ROUND_DOWN(WriteOffset.u.LowPart, BytesPerCluster) -
-                                 LastOffset,
-                                 &CurrentCluster, FALSE);
-#ifdef DEBUG_VERIFY_OFFSET_CACHING
-        /* DEBUG VERIFICATION */
-        {
-            ULONG CorrectCluster;
-            OffsetToCluster(DeviceExt, FirstCluster,
-                            ROUND_DOWN(WriteOffset.u.LowPart, BytesPerCluster),
-                            &CorrectCluster, FALSE);
-            if (CorrectCluster != CurrentCluster)
-                KeBugCheck(FAT_FILE_SYSTEM);
-        }
-#endif
-    }
-    else
-    {
-        Status = OffsetToCluster(DeviceExt, FirstCluster,
-                                 ROUND_DOWN(WriteOffset.u.LowPart, BytesPerCluster),
-                                 &CurrentCluster, FALSE);
-    }
-
-    if (!NT_SUCCESS(Status))
-    {
-        return Status;
-    }
-
-    ExAcquireFastMutex(&Fcb->LastMutex);
-    Fcb->LastCluster = CurrentCluster;
-    Fcb->LastOffset = ROUND_DOWN (WriteOffset.u.LowPart, BytesPerCluster);
-    ExReleaseFastMutex(&Fcb->LastMutex);
-
     IrpContext->RefCount = 1;
     BufferOffset = 0;
 
-    while (Length > 0 && CurrentCluster != 0xffffffff)
+    while (Length > 0)
     {
-        StartCluster = CurrentCluster;
-        StartOffset.QuadPart = ClusterToSector(DeviceExt, StartCluster) * BytesPerSector;
-        BytesDone = 0;
-        ClusterCount = 0;
-
-        do
+        /*
+         * Find the extent to write to
+         */
+        Status = OffsetToCluster(DeviceExt, Fcb, WriteOffset.u.LowPart, Length,
+                                 &StartCluster, &ClusterCount);
+        if (!NT_SUCCESS(Status) || StartCluster == 0xffffffff)
         {
-            ClusterCount++;
-            if (First)
-            {
-                BytesDone =  min (Length, BytesPerCluster - (WriteOffset.u.LowPart % BytesPerCluster));
-                StartOffset.QuadPart += WriteOffset.u.LowPart % BytesPerCluster;
-                First = FALSE;
-            }
-            else
-            {
-                if (Length - BytesDone > BytesPerCluster)
-                {
-                    BytesDone += BytesPerCluster;
-                }
-                else
-                {
-                    BytesDone = Length;
-                }
-            }
-            Status = NextCluster(DeviceExt, FirstCluster, &CurrentCluster, FALSE);
+            break;
         }
-        while (StartCluster + ClusterCount == CurrentCluster && NT_SUCCESS(Status) && Length > BytesDone);
-        DPRINT("start %08x, next %08x, count %u\n",
-               StartCluster, CurrentCluster, ClusterCount);
-
-        ExAcquireFastMutex(&Fcb->LastMutex);
-        Fcb->LastCluster = StartCluster + (ClusterCount - 1);
-        Fcb->LastOffset = ROUND_DOWN(WriteOffset.u.LowPart, BytesPerCluster) + (ClusterCount - 1) * BytesPerCluster;
-        ExReleaseFastMutex(&Fcb->LastMutex);
+
+        StartOffset.QuadPart = ClusterToSector(DeviceExt, StartCluster) * BytesPerSector +
+                               WriteOffset.u.LowPart % BytesPerCluster;
+        BytesDone = (ULONG)min((ULONGLONG)Length,
+                               (ULONGLONG)ClusterCount * BytesPerCluster - WriteOffset.u.LowPart % BytesPerCluster);
+        DPRINT("start %08x, count %u\n", StartCluster, ClusterCount);
 
         // Fire up the write command
         Status = VfatWriteDiskPartial (IrpContext, &StartOffset, BytesDone, BufferOffset, FALSE);
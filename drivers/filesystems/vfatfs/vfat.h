@@ -325,6 +325,8 @@ typedef struct DEVICE_EXTENSION
     ULONG LastAvailableCluster;
     ULONG AvailableClusters;
     BOOLEAN AvailableClustersValid;
+    /* Clear bits are free clusters. No buffer if it couldn't be allocated */
+    RTL_BITMAP FreeClusterBitmap;
     ULONG Flags;
     struct _VFATFCB *VolumeFcb;
     struct _VFATFCB *RootFcb;
@@ -520,13 +522,16 @@ typedef struct _VFATFCB
     FILE_LOCK FileLock;
 
     /*
-     * Optimization: caching of last read/write cluster+offset pair. Can't
-     * be in VFATCCB because it must be reset everytime the allocated clusters
+     * Optimization: caching of the cluster chain, read from the FAT as far as
+     * it is needed. The VBNs are the clusters of the file and the LBNs the
+     * clusters of the volume, so each run is a contiguous extent. Can't be in
+     * VFATCCB because it must be reset everytime the allocated clusters
      * change.
      */
-    FAST_MUTEX LastMutex;
-    ULONG LastCluster;
-    ULONG LastOffset;
+    ERESOURCE ExtentResource;
+    LARGE_MCB ExtentMap;
+    /* Number of clusters at the start of the chain that are in ExtentMap */
+    ULONG ExtentClusters;
 
     struct _VFAT_CLOSE_CONTEXT * CloseContext;
 } VFATFCB, *PVFATFCB;
@@ -553,6 +558,7 @@ typedef struct _VFATCCB
 #define TAG_NAME 'ntaF'
 #define TAG_SEARCH 'LtaF'
 #define TAG_DIRENT 'DtaF'
+#define TAG_BITMAP 'BtaF'
 
 #define ENTRIES_PER_SECTOR (BLOCKSIZE / sizeof(FATDirEntry))
 
@@ -899,10 +905,16 @@ FAT32WriteCluster(
 NTSTATUS
 OffsetToCluster(
     PDEVICE_EXTENSION DeviceExt,
-    ULONG FirstCluster,
+    PVFATFCB Fcb,
     ULONG FileOffset,
+    ULONG Length,
     PULONG Cluster,
-    BOOLEAN Extend);
+    PULONG RunLength);
+
+VOID
+TruncateExtentMap(
+    PVFATFCB Fcb,
+    ULONG ClusterCount);
 
 ULONGLONG
 ClusterToSector(
@@ -921,11 +933,22 @@ GetNextClusterExtend(
     ULONG CurrentCluster,
     PULONG NextCluster);
 
+NTSTATUS
+ExtendClusterChain(
+    PDEVICE_EXTENSION DeviceExt,
+    ULONG LastCluster,
+    ULONG ClusterCount,
+    PULONG FirstNewCluster);
+
 NTSTATUS
 CountAvailableClusters(
     PDEVICE_EXTENSION DeviceExt,
     PLARGE_INTEGER Clusters);
 
+VOID
+DeleteFreeClusterBitmap(
+    PDEVICE_EXTENSION DeviceExt);
+
 NTSTATUS
 WriteCluster(
     PDEVICE_EXTENSION DeviceExt,
@@ -480,6 +480,7 @@ AfdCloseSocket(PDEVICE_OBJECT DeviceObject, PIRP Irp,
     InFlightRequest[2] = &FCB->SendIrp;
     InFlightRequest[3] = &FCB->ConnectIrp;
     InFlightRequest[4] = &FCB->DisconnectIrp;
+    InFlightRequest[5] = &FCB->TransmitIrp;
 
     /* Cancel our pending requests */
     for( i = 0; i < IN_FLIGHT_REQUESTS; i++ ) {
@@ -497,6 +498,7 @@ AfdCloseSocket(PDEVICE_OBJECT DeviceObject, PIRP Irp,
     ASSERT(IsListEmpty(&FCB->PendingIrpList[FUNCTION_RECV]));
     ASSERT(IsListEmpty(&FCB->PendingIrpList[FUNCTION_PREACCEPT]));
     ASSERT(IsListEmpty(&FCB->PendingIrpList[FUNCTION_DISCONNECT]));
+    ASSERT(IsListEmpty(&FCB->PendingIrpList[FUNCTION_TRANSMIT]));
 
     while (!IsListEmpty(&FCB->PendingConnections))
     {
@@ -704,7 +706,8 @@ RetryDisconnectCompletion(PAFD_FCB FCB)
 {
     ASSERT(FCB->RemoteAddress);
 
-    if (IsListEmpty(&FCB->PendingIrpList[FUNCTION_SEND]) && !FCB->SendIrp.InFlightRequest && FCB->DisconnectPending)
+    if (IsListEmpty(&FCB->PendingIrpList[FUNCTION_SEND]) && !FCB->SendIrp.InFlightRequest &&
+        IsListEmpty(&FCB->PendingIrpList[FUNCTION_TRANSMIT]) && FCB->DisconnectPending)
     {
         /* Sends are done; fire off a TDI_DISCONNECT request */
         DoDisconnect(FCB);
@@ -811,7 +814,8 @@ AfdDisconnect(PDEVICE_OBJECT DeviceObject, PIRP Irp,
         Status = QueueUserModeIrp(FCB, Irp, FUNCTION_DISCONNECT);
         if (Status == STATUS_PENDING)
         {
-            if ((IsListEmpty(&FCB->PendingIrpList[FUNCTION_SEND]) && !FCB->SendIrp.InFlightRequest) ||
+            if ((IsListEmpty(&FCB->PendingIrpList[FUNCTION_SEND]) && !FCB->SendIrp.InFlightRequest &&
+                 IsListEmpty(&FCB->PendingIrpList[FUNCTION_TRANSMIT])) ||
                 (FCB->DisconnectFlags & TDI_DISCONNECT_ABORT))
             {
                 /* Go ahead and execute the disconnect because we're ready for it */
@@ -1051,6 +1055,10 @@ AfdDispatch(PDEVICE_OBJECT DeviceObject, PIRP Irp)
             DbgPrint("IOCTL_AFD_DEFER_ACCEPT is UNIMPLEMENTED!\n");
             break;
 
+        case IOCTL_AFD_TRANSMIT_FILE:
+        case IOCTL_AFD_TRANSMIT_PACKETS:
+            return AfdTransmit(DeviceObject, Irp, IrpSp);
+
         case IOCTL_AFD_GET_PENDING_CONNECT_DATA:
             DbgPrint("IOCTL_AFD_GET_PENDING_CONNECT_DATA is UNIMPLEMENTED!\n");
             break;
@@ -1268,6 +1276,13 @@ AfdCancelHandler(PDEVICE_OBJECT DeviceObject,
             Function = FUNCTION_DISCONNECT;
             break;
 
+        case IOCTL_AFD_TRANSMIT_FILE:
+        case IOCTL_AFD_TRANSMIT_PACKETS:
+            /* The active request has to stop sending first */
+            AfdCancelTransmit(FCB, Irp);
+            SocketStateUnlock(FCB);
+            return;
+
         default:
             ASSERT(FALSE);
             UnlockAndMaybeComplete(FCB, STATUS_CANCELLED, Irp, 0);
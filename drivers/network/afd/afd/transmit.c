@@ -0,0 +1,778 @@
+/*
+ * PROJECT:     ReactOS Ancillary Function Driver
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     TransmitFile and TransmitPackets
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+/*
+ * A transmit request sends a list of elements, each a piece of user memory
+ * or a range of a file, over a connection without going through the send
+ * window. User memory is locked when the request is made and handed to the
+ * transport as it is. Files are read through the cache manager's MDL
+ * interface, so the transport gets the cache pages themselves; files whose
+ * file system cannot do that are read into a buffer of our own.
+ *
+ * The requests of a socket run one at a time, after the sends queued before
+ * them, and sends made while requests are queued are held back until all of
+ * them are done. Reading files needs PASSIVE_LEVEL and may block, so each
+ * step of a request runs from a work item, and files are read without the
+ * socket lock held.
+ */
+
+#include "afd.h"
+
+/* Bytes read from a file at once, and sent at once unless asked otherwise */
+#define AFD_TRANSMIT_READ_SIZE      (64 * 1024)
+
+/* The most elements a TransmitPackets request may have */
+#define AFD_TRANSMIT_MAX_ELEMENTS   4096
+
+/* Remaining bytes of a file element that is sent up to the end of the file */
+#define AFD_TRANSMIT_TO_END         MAXULONGLONG
+
+typedef struct _AFD_TRANSMIT_ITEM {
+    PFILE_OBJECT FileObject;        /* NULL for user memory */
+    PMDL Mdl;                       /* The user memory */
+    LARGE_INTEGER Offset;           /* Next byte of the file to read */
+    ULONGLONG Remaining;            /* Bytes left to read or send */
+} AFD_TRANSMIT_ITEM, *PAFD_TRANSMIT_ITEM;
+
+typedef struct _AFD_TRANSMIT {
+    PAFD_FCB FCB;
+    PIRP Irp;
+    PIO_WORKITEM WorkItem;
+    ULONG Flags;
+    ULONG SendSize;
+    BOOLEAN Cancelled;
+    NTSTATUS Status;                /* Of the last TDI_SEND */
+    ULONG_PTR Information;          /* Bytes the last TDI_SEND sent */
+    ULONG_PTR BytesSent;
+    PMDL Source;                    /* What is being sent */
+    ULONG SourceOffset;             /* Next byte of Source to send */
+    ULONG SourceLength;             /* Bytes of Source to send */
+    PMDL SendMdl;                   /* Part of Source the transport has */
+    PMDL ReadChain;                 /* From FsRtlMdlRead, Source walks it */
+    PFILE_OBJECT ReadFileObject;    /* The file ReadChain belongs to */
+    PVOID Buffer;                   /* For files read without the cache */
+    PMDL BufferMdl;
+    ULONG CurrentItem;
+    ULONG ItemCount;
+    AFD_TRANSMIT_ITEM Items[ANYSIZE_ARRAY];
+} AFD_TRANSMIT, *PAFD_TRANSMIT;
+
+static IO_WORKITEM_ROUTINE AfdTransmitWorker;
+
+/* Gives the pages of a file read back to the cache manager */
+static VOID
+AfdReleaseReadChain(PAFD_TRANSMIT Transmit)
+{
+    if (Transmit->ReadChain)
+    {
+        CcMdlReadComplete(Transmit->ReadFileObject, Transmit->ReadChain);
+        Transmit->ReadChain = NULL;
+        Transmit->ReadFileObject = NULL;
+    }
+}
+
+VOID
+AfdFreeTransmit(PIRP Irp)
+{
+    PAFD_TRANSMIT Transmit = Irp->Tail.Overlay.DriverContext[0];
+    PAFD_TRANSMIT_ITEM Item;
+    ULONG i;
+
+    if (!Transmit)
+        return;
+
+    Irp->Tail.Overlay.DriverContext[0] = NULL;
+
+    ASSERT(!Transmit->SendMdl);
+    AfdReleaseReadChain(Transmit);
+
+    for (i = 0; i < Transmit->ItemCount; i++)
+    {
+        Item = &Transmit->Items[i];
+
+        if (Item->FileObject)
+            ObDereferenceObject(Item->FileObject);
+
+        if (Item->Mdl)
+        {
+            if (Item->Mdl->MdlFlags & MDL_PAGES_LOCKED)
+                MmUnlockPages(Item->Mdl);
+            IoFreeMdl(Item->Mdl);
+        }
+    }
+
+    if (Transmit->BufferMdl)
+        IoFreeMdl(Transmit->BufferMdl);
+    if (Transmit->Buffer)
+        ExFreePoolWithTag(Transmit->Buffer, TAG_AFD_TRANSMIT);
+    if (Transmit->WorkItem)
+        IoFreeWorkItem(Transmit->WorkItem);
+
+    ExFreePoolWithTag(Transmit, TAG_AFD_TRANSMIT);
+}
+
+static NTSTATUS
+AfdCaptureElement(PAFD_TRANSMIT Transmit,
+                  PAFD_TRANSMIT_ELEMENT Element,
+                  KPROCESSOR_MODE RequestorMode)
+{
+    PAFD_TRANSMIT_ITEM Item = &Transmit->Items[Transmit->ItemCount];
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    switch (Element->Flags & (AFD_TP_ELEMENT_MEMORY | AFD_TP_ELEMENT_FILE))
+    {
+        case AFD_TP_ELEMENT_FILE:
+            Status = ObReferenceObjectByHandle(Element->FileHandle,
+                                               FILE_READ_DATA,
+                                               *IoFileObjectType,
+                                               RequestorMode,
+                                               (PVOID*)&Item->FileObject,
+                                               NULL);
+            if (!NT_SUCCESS(Status))
+                return Status;
+
+            Transmit->ItemCount++;
+
+            Item->Offset = Element->FileOffset;
+            if (Item->Offset.QuadPart == AFD_TRANSMIT_CURRENT_OFFSET)
+                Item->Offset = Item->FileObject->CurrentByteOffset;
+            else if (Item->Offset.QuadPart < 0)
+                return STATUS_INVALID_PARAMETER;
+
+            /* A length of 0 sends the rest of the file */
+            Item->Remaining = Element->Length ? Element->Length : AFD_TRANSMIT_TO_END;
+            break;
+
+        case AFD_TP_ELEMENT_MEMORY:
+            if (!Element->Length)
+                break;
+
+            Item->Mdl = IoAllocateMdl(Element->Buffer, Element->Length, FALSE, FALSE, NULL);
+            if (!Item->Mdl)
+                return STATUS_INSUFFICIENT_RESOURCES;
+
+            Transmit->ItemCount++;
+
+            _SEH2_TRY {
+                MmProbeAndLockPages(Item->Mdl, RequestorMode, IoReadAccess);
+            } _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER) {
+                AFD_DbgPrint(MIN_TRACE, ("MmProbeAndLockPages() failed.\n"));
+                Status = _SEH2_GetExceptionCode();
+            } _SEH2_END;
+
+            Item->Remaining = Element->Length;
+            break;
+
+        default:
+            return STATUS_INVALID_PARAMETER;
+    }
+
+    return Status;
+}
+
+/* Builds the transmit context of a request, the caller frees it on failure */
+static NTSTATUS
+AfdCaptureTransmit(PDEVICE_OBJECT DeviceObject, PIRP Irp,
+                   PIO_STACK_LOCATION IrpSp)
+{
+    PVOID Input = IrpSp->Parameters.DeviceIoControl.Type3InputBuffer;
+    ULONG InputLength = IrpSp->Parameters.DeviceIoControl.InputBufferLength;
+    BOOLEAN IsTransmitFile = IrpSp->Parameters.DeviceIoControl.IoControlCode == IOCTL_AFD_TRANSMIT_FILE;
+    AFD_TRANSMIT_FILE_INFO FileInfo;
+    AFD_TRANSMIT_PACKETS_INFO PacketsInfo;
+    AFD_TRANSMIT_ELEMENT FileElements[3], Element;
+    PAFD_TRANSMIT Transmit;
+    ULONG ElementCount = 0, SendSize, Flags, i;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    Irp->Tail.Overlay.DriverContext[0] = NULL;
+    RtlZeroMemory(&FileInfo, sizeof(FileInfo));
+    RtlZeroMemory(&PacketsInfo, sizeof(PacketsInfo));
+
+    _SEH2_TRY {
+        if (IsTransmitFile)
+        {
+            if (InputLength < sizeof(FileInfo))
+                _SEH2_YIELD(return STATUS_INVALID_PARAMETER);
+
+            if (Irp->RequestorMode != KernelMode)
+                ProbeForRead(Input, sizeof(FileInfo), sizeof(ULONG));
+
+            FileInfo = *(PAFD_TRANSMIT_FILE_INFO)Input;
+        }
+        else
+        {
+            if (InputLength < sizeof(PacketsInfo))
+                _SEH2_YIELD(return STATUS_INVALID_PARAMETER);
+
+            if (Irp->RequestorMode != KernelMode)
+                ProbeForRead(Input, sizeof(PacketsInfo), sizeof(ULONG));
+
+            PacketsInfo = *(PAFD_TRANSMIT_PACKETS_INFO)Input;
+
+            if (PacketsInfo.ElementCount > AFD_TRANSMIT_MAX_ELEMENTS)
+                _SEH2_YIELD(return STATUS_INVALID_PARAMETER);
+
+            if (Irp->RequestorMode != KernelMode)
+            {
+                ProbeForRead(PacketsInfo.ElementArray,
+                             PacketsInfo.ElementCount * sizeof(AFD_TRANSMIT_ELEMENT),
+                             sizeof(ULONG));
+            }
+        }
+    } _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER) {
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    } _SEH2_END;
+
+    if (IsTransmitFile)
+    {
+        /* TransmitFile is the head, the file and the tail */
+        RtlZeroMemory(FileElements, sizeof(FileElements));
+
+        if (FileInfo.HeadLength)
+        {
+            FileElements[ElementCount].Flags = AFD_TP_ELEMENT_MEMORY;
+            FileElements[ElementCount].Length = FileInfo.HeadLength;
+            FileElements[ElementCount++].Buffer = FileInfo.Head;
+        }
+
+        if (FileInfo.FileHandle)
+        {
+            FileElements[ElementCount].Flags = AFD_TP_ELEMENT_FILE;
+            FileElements[ElementCount].Length = FileInfo.Length;
+            FileElements[ElementCount].FileOffset = FileInfo.Offset;
+            FileElements[ElementCount++].FileHandle = FileInfo.FileHandle;
+        }
+
+        if (FileInfo.TailLength)
+        {
+            FileElements[ElementCount].Flags = AFD_TP_ELEMENT_MEMORY;
+            FileElements[ElementCount].Length = FileInfo.TailLength;
+            FileElements[ElementCount++].Buffer = FileInfo.Tail;
+        }
+
+        SendSize = FileInfo.SendSize;
+        Flags = FileInfo.Flags;
+    }
+    else
+    {
+        ElementCount = PacketsInfo.ElementCount;
+        SendSize = PacketsInfo.SendSize;
+        Flags = PacketsInfo.Flags;
+    }
+
+    Transmit = ExAllocatePoolWithTag(NonPagedPool,
+                                     FIELD_OFFSET(AFD_TRANSMIT, Items) +
+                                     ElementCount * sizeof(AFD_TRANSMIT_ITEM),
+                                     TAG_AFD_TRANSMIT);
+    if (!Transmit)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    RtlZeroMemory(Transmit, FIELD_OFFSET(AFD_TRANSMIT, Items) +
+                            ElementCount * sizeof(AFD_TRANSMIT_ITEM));
+    Transmit->FCB = IrpSp->FileObject->FsContext;
+    Transmit->Irp = Irp;
+    Transmit->Flags = Flags;
+    Transmit->SendSize = SendSize ? SendSize : AFD_TRANSMIT_READ_SIZE;
+    Irp->Tail.Overlay.DriverContext[0] = Transmit;
+
+    Transmit->WorkItem = IoAllocateWorkItem(DeviceObject);
+    if (!Transmit->WorkItem)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    for (i = 0; i < ElementCount && NT_SUCCESS(Status); i++)
+    {
+        if (IsTransmitFile)
+        {
+            Element = FileElements[i];
+        }
+        else
+        {
+            _SEH2_TRY {
+                Element = PacketsInfo.ElementArray[i];
+            } _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER) {
+                Status = _SEH2_GetExceptionCode();
+            } _SEH2_END;
+
+            if (!NT_SUCCESS(Status))
+                break;
+        }
+
+        Status = AfdCaptureElement(Transmit, &Element, Irp->RequestorMode);
+    }
+
+    return Status;
+}
+
+/* Reads the next part of a file into our own buffer */
+static NTSTATUS
+AfdTransmitReadBuffer(PAFD_TRANSMIT Transmit, PAFD_TRANSMIT_ITEM Item,
+                      ULONG Length, PIO_STATUS_BLOCK IoStatus)
+{
+    PDEVICE_OBJECT DeviceObject = IoGetRelatedDeviceObject(Item->FileObject);
+    KEVENT Event;
+    PIRP Irp;
+    NTSTATUS Status;
+
+    if (!Transmit->Buffer)
+    {
+        Transmit->Buffer = ExAllocatePoolWithTag(NonPagedPool,
+                                                 AFD_TRANSMIT_READ_SIZE,
+                                                 TAG_AFD_TRANSMIT);
+        if (!Transmit->Buffer)
+            return STATUS_INSUFFICIENT_RESOURCES;
+
+        Transmit->BufferMdl = IoAllocateMdl(Transmit->Buffer,
+                                            AFD_TRANSMIT_READ_SIZE,
+                                            FALSE,
+                                            FALSE,
+                                            NULL);
+        if (!Transmit->BufferMdl)
+            return STATUS_INSUFFICIENT_RESOURCES;
+
+        MmBuildMdlForNonPagedPool(Transmit->BufferMdl);
+    }
+
+    KeInitializeEvent(&Event, NotificationEvent, FALSE);
+
+    Irp = IoBuildSynchronousFsdRequest(IRP_MJ_READ,
+                                       DeviceObject,
+                                       Transmit->Buffer,
+                                       Length,
+                                       &Item->Offset,
+                                       &Event,
+                                       IoStatus);
+    if (!Irp)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    IoGetNextIrpStackLocation(Irp)->FileObject = Item->FileObject;
+
+    Status = IoCallDriver(DeviceObject, Irp);
+    if (Status == STATUS_PENDING)
+    {
+        KeWaitForSingleObject(&Event, Executive, KernelMode, FALSE, NULL);
+        Status = IoStatus->Status;
+    }
+
+    return Status;
+}
+
+/* Reads the next part of a file, straight from the cache when possible */
+static NTSTATUS
+AfdTransmitReadFile(PAFD_TRANSMIT Transmit, PAFD_TRANSMIT_ITEM Item)
+{
+    ULONG Length = (ULONG)min(Item->Remaining, AFD_TRANSMIT_READ_SIZE);
+    IO_STATUS_BLOCK IoStatus;
+    PMDL Chain = NULL;
+    NTSTATUS Status;
+
+    ASSERT(!Transmit->ReadChain);
+
+    if (FsRtlMdlRead(Item->FileObject, &Item->Offset, Length, 0, &Chain, &IoStatus))
+    {
+        Status = IoStatus.Status;
+        if (Chain)
+        {
+            Transmit->ReadChain = Chain;
+            Transmit->ReadFileObject = Item->FileObject;
+            Transmit->Source = Chain;
+            Transmit->SourceOffset = 0;
+            Transmit->SourceLength = MmGetMdlByteCount(Chain);
+        }
+    }
+    else
+    {
+        /* Not cached yet, or the file system has no MDL reads. Reading
+         * it once also makes the file system set up caching for it. */
+        Status = AfdTransmitReadBuffer(Transmit, Item, Length, &IoStatus);
+        if (NT_SUCCESS(Status) && IoStatus.Information)
+        {
+            Transmit->Source = Transmit->BufferMdl;
+            Transmit->SourceOffset = 0;
+            Transmit->SourceLength = (ULONG)IoStatus.Information;
+        }
+    }
+
+    if (Status == STATUS_END_OF_FILE || (NT_SUCCESS(Status) && !IoStatus.Information))
+    {
+        Item->Remaining = 0;
+        return STATUS_SUCCESS;
+    }
+
+    if (!NT_SUCCESS(Status))
+    {
+        AFD_DbgPrint(MIN_TRACE, ("Reading the file failed (0x%x)\n", Status));
+        Transmit->Source = NULL;
+        AfdReleaseReadChain(Transmit);
+        return Status;
+    }
+
+    Item->Offset.QuadPart += IoStatus.Information;
+    if (Item->Remaining != AFD_TRANSMIT_TO_END)
+        Item->Remaining -= IoStatus.Information;
+
+    return STATUS_SUCCESS;
+}
+
+/*
+ * Finds the data to send next and returns how many bytes of it go in the
+ * next TDI_SEND, 0 when everything has been sent.
+ */
+static NTSTATUS
+AfdTransmitNextChunk(PAFD_TRANSMIT Transmit, PULONG Length)
+{
+    PAFD_TRANSMIT_ITEM Item;
+    NTSTATUS Status;
+
+    for (;;)
+    {
+        if (Transmit->Source)
+        {
+            if (Transmit->SourceOffset < Transmit->SourceLength)
+            {
+                *Length = min(Transmit->SourceLength - Transmit->SourceOffset,
+                              Transmit->SendSize);
+                return STATUS_SUCCESS;
+            }
+
+            /* Move on to the next MDL of a file read */
+            if (Transmit->ReadChain && Transmit->Source->Next)
+            {
+                Transmit->Source = Transmit->Source->Next;
+                Transmit->SourceOffset = 0;
+                Transmit->SourceLength = MmGetMdlByteCount(Transmit->Source);
+                continue;
+            }
+
+            Transmit->Source = NULL;
+            AfdReleaseReadChain(Transmit);
+        }
+
+        if (Transmit->CurrentItem == Transmit->ItemCount)
+        {
+            *Length = 0;
+            return STATUS_SUCCESS;
+        }
+
+        Item = &Transmit->Items[Transmit->CurrentItem];
+
+        if (!Item->Remaining)
+        {
+            Transmit->CurrentItem++;
+        }
+        else if (!Item->FileObject)
+        {
+            /* User memory goes out as it is */
+            Transmit->Source = Item->Mdl;
+            Transmit->SourceOffset = 0;
+            Transmit->SourceLength = MmGetMdlByteCount(Item->Mdl);
+            Item->Remaining = 0;
+        }
+        else
+        {
+            Status = AfdTransmitReadFile(Transmit, Item);
+            if (!NT_SUCCESS(Status))
+                return Status;
+        }
+    }
+}
+
+static IO_COMPLETION_ROUTINE AfdTransmitSendComplete;
+static NTSTATUS NTAPI
+AfdTransmitSendComplete(PDEVICE_OBJECT DeviceObject,
+                        PIRP Irp,
+                        PVOID Context)
+{
+    PAFD_TRANSMIT Transmit = Context;
+    PAFD_FCB FCB = Transmit->FCB;
+
+    UNREFERENCED_PARAMETER(DeviceObject);
+
+    /* The MDL is ours, don't let the I/O manager unlock and free it */
+    Irp->MdlAddress = NULL;
+
+    if (!SocketAcquireStateLock(FCB))
+        return STATUS_FILE_CLOSED;
+
+    ASSERT(FCB->TransmitIrp.InFlightRequest == Irp);
+    FCB->TransmitIrp.InFlightRequest = NULL;
+
+    AFD_DbgPrint(MID_TRACE, ("Transmit send done: 0x%x %lu\n",
+                             Irp->IoStatus.Status,
+                             (ULONG)Irp->IoStatus.Information));
+
+    Transmit->Status = Irp->IoStatus.Status;
+    Transmit->Information = Irp->IoStatus.Information;
+
+    /* Reading the next part of a file needs PASSIVE_LEVEL */
+    IoQueueWorkItem(Transmit->WorkItem, AfdTransmitWorker, DelayedWorkQueue, Transmit);
+
+    SocketStateUnlock(FCB);
+
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS
+AfdTransmitSend(PAFD_TRANSMIT Transmit, ULONG Length)
+{
+    PAFD_FCB FCB = Transmit->FCB;
+    PCHAR Address = (PCHAR)MmGetMdlVirtualAddress(Transmit->Source) + Transmit->SourceOffset;
+    NTSTATUS Status;
+
+    /* The transport only takes one MDL, so describe the part that is sent
+     * with a partial MDL over the locked pages instead of copying it */
+    Transmit->SendMdl = IoAllocateMdl(Address, Length, FALSE, FALSE, NULL);
+    if (!Transmit->SendMdl)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    IoBuildPartialMdl(Transmit->Source, Transmit->SendMdl, Address, Length);
+
+    Status = TdiSendMdl(&FCB->TransmitIrp.InFlightRequest,
+                        FCB->Connection.Object,
+                        0,
+                        Transmit->SendMdl,
+                        Length,
+                        AfdTransmitSendComplete,
+                        Transmit);
+    if (Status != STATUS_PENDING)
+    {
+        IoFreeMdl(Transmit->SendMdl);
+        Transmit->SendMdl = NULL;
+    }
+
+    return Status;
+}
+
+/* Completes the active request and lets whatever waits for it go */
+static VOID
+AfdFinishTransmit(PAFD_TRANSMIT Transmit, NTSTATUS Status)
+{
+    PAFD_FCB FCB = Transmit->FCB;
+    PIRP Irp = Transmit->Irp;
+    ULONG_PTR BytesSent = Transmit->BytesSent;
+    ULONG Flags = Transmit->Flags;
+
+    AFD_DbgPrint(MID_TRACE, ("Transmit done: 0x%x %lu\n", Status, (ULONG)BytesSent));
+
+    ASSERT(FCB->Transmit == Transmit);
+    FCB->Transmit = NULL;
+
+    RemoveEntryList(&Irp->Tail.Overlay.ListEntry);
+    (void)IoSetCancelRoutine(Irp, NULL);
+    AfdFreeTransmit(Irp);
+
+    Irp->IoStatus.Status = Status;
+    Irp->IoStatus.Information = BytesSent;
+    IoCompleteRequest(Irp, IO_NETWORK_INCREMENT);
+
+    /* The socket can't be reused for another connection here, so
+     * TF_REUSE_SOCKET just disconnects like TF_DISCONNECT */
+    if (NT_SUCCESS(Status) && (Flags & (AFD_TF_DISCONNECT | AFD_TF_REUSE_SOCKET)) &&
+        FCB->ConnectCallInfo && !FCB->DisconnectPending && !FCB->SendClosed)
+    {
+        FCB->DisconnectFlags = TDI_DISCONNECT_RELEASE;
+        FCB->DisconnectTimeout.QuadPart = -1000000; /* As WSPShutdown passes */
+        FCB->DisconnectPending = TRUE;
+        FCB->SendClosed = TRUE;
+        FCB->PollState &= ~AFD_EVENT_SEND;
+    }
+
+    if (!IsListEmpty(&FCB->PendingIrpList[FUNCTION_TRANSMIT]))
+    {
+        AfdStartNextTransmit(FCB);
+    }
+    else
+    {
+        AfdReleaseHeldSends(FCB);
+        RetryDisconnectCompletion(FCB);
+    }
+}
+
+static VOID NTAPI
+AfdTransmitWorker(PDEVICE_OBJECT DeviceObject, PVOID Context)
+{
+    PAFD_TRANSMIT Transmit = Context;
+    PAFD_FCB FCB = Transmit->FCB;
+    NTSTATUS Status = Transmit->Status;
+    ULONG Length = 0;
+
+    UNREFERENCED_PARAMETER(DeviceObject);
+
+    /* Account for the send that just completed, a short one is resent
+     * from where the transport stopped */
+    if (Transmit->SendMdl)
+    {
+        MmPrepareMdlForReuse(Transmit->SendMdl);
+        IoFreeMdl(Transmit->SendMdl);
+        Transmit->SendMdl = NULL;
+
+        if (NT_SUCCESS(Status))
+        {
+            Transmit->SourceOffset += (ULONG)Transmit->Information;
+            Transmit->BytesSent += Transmit->Information;
+        }
+    }
+
+    if (NT_SUCCESS(Status) && !Transmit->Cancelled)
+        Status = AfdTransmitNextChunk(Transmit, &Length);
+
+    if (!SocketAcquireStateLock(FCB))
+        return;
+
+    if (NT_SUCCESS(Status) && Transmit->Cancelled)
+        Status = STATUS_CANCELLED;
+
+    if (NT_SUCCESS(Status) && Length)
+    {
+        Status = AfdTransmitSend(Transmit, Length);
+        if (Status == STATUS_PENDING)
+        {
+            SocketStateUnlock(FCB);
+            return;
+        }
+    }
+
+    AfdFinishTransmit(Transmit, Status);
+
+    SocketStateUnlock(FCB);
+}
+
+/*
+ * Starts the first queued request once the sends queued before it are
+ * out. Called with the socket state lock held.
+ */
+VOID
+AfdStartNextTransmit(PAFD_FCB FCB)
+{
+    PIRP Irp;
+    PAFD_TRANSMIT Transmit;
+
+    if (FCB->Transmit || IsListEmpty(&FCB->PendingIrpList[FUNCTION_TRANSMIT]))
+        return;
+
+    if (FCB->SendIrp.InFlightRequest || FCB->Send.BytesUsed)
+        return;
+
+    if (!IsListEmpty(&FCB->PendingIrpList[FUNCTION_SEND]))
+    {
+        Irp = CONTAINING_RECORD(FCB->PendingIrpList[FUNCTION_SEND].Flink,
+                                IRP, Tail.Overlay.ListEntry);
+        if (!AFD_SEND_IS_HELD(Irp))
+            return;
+    }
+
+    Irp = CONTAINING_RECORD(FCB->PendingIrpList[FUNCTION_TRANSMIT].Flink,
+                            IRP, Tail.Overlay.ListEntry);
+    Transmit = Irp->Tail.Overlay.DriverContext[0];
+
+    AFD_DbgPrint(MID_TRACE, ("Starting transmit %p\n", Irp));
+
+    FCB->Transmit = Transmit;
+    Transmit->Status = STATUS_SUCCESS;
+    IoQueueWorkItem(Transmit->WorkItem, AfdTransmitWorker, DelayedWorkQueue, Transmit);
+}
+
+/*
+ * Cancels a request. A queued one is completed right away, the active one
+ * stops at its next step. Called with the socket state lock held.
+ */
+VOID
+AfdCancelTransmit(PAFD_FCB FCB, PIRP Irp)
+{
+    PLIST_ENTRY CurrentEntry;
+
+    if (FCB->Transmit && FCB->Transmit->Irp == Irp)
+    {
+        FCB->Transmit->Cancelled = TRUE;
+        if (FCB->TransmitIrp.InFlightRequest)
+            IoCancelIrp(FCB->TransmitIrp.InFlightRequest);
+        return;
+    }
+
+    for (CurrentEntry = FCB->PendingIrpList[FUNCTION_TRANSMIT].Flink;
+         CurrentEntry != &FCB->PendingIrpList[FUNCTION_TRANSMIT];
+         CurrentEntry = CurrentEntry->Flink)
+    {
+        if (CurrentEntry == &Irp->Tail.Overlay.ListEntry)
+            break;
+    }
+
+    if (CurrentEntry == &FCB->PendingIrpList[FUNCTION_TRANSMIT])
+    {
+        DbgPrint("WARNING!!! IRP cancellation race could lead to a process hang! (Transmit)\n");
+        return;
+    }
+
+    RemoveEntryList(&Irp->Tail.Overlay.ListEntry);
+    AfdFreeTransmit(Irp);
+
+    Irp->IoStatus.Status = STATUS_CANCELLED;
+    Irp->IoStatus.Information = 0;
+    IoCompleteRequest(Irp, IO_NETWORK_INCREMENT);
+
+    if (IsListEmpty(&FCB->PendingIrpList[FUNCTION_TRANSMIT]))
+    {
+        AfdReleaseHeldSends(FCB);
+        RetryDisconnectCompletion(FCB);
+    }
+}
+
+NTSTATUS NTAPI
+AfdTransmit(PDEVICE_OBJECT DeviceObject, PIRP Irp,
+            PIO_STACK_LOCATION IrpSp)
+{
+    PFILE_OBJECT FileObject = IrpSp->FileObject;
+    PAFD_FCB FCB = FileObject->FsContext;
+    NTSTATUS Status;
+
+    AFD_DbgPrint(MID_TRACE, ("Called on %p\n", FCB));
+
+    if (!SocketAcquireStateLock(FCB)) return LostSocket(Irp);
+
+    FCB->EventSelectDisabled &= ~AFD_EVENT_SEND;
+
+    if (FCB->Flags & AFD_ENDPOINT_CONNECTIONLESS)
+    {
+        AFD_DbgPrint(MIN_TRACE, ("Transmit on a connectionless socket\n"));
+        return UnlockAndMaybeComplete(FCB, STATUS_INVALID_PARAMETER, Irp, 0);
+    }
+
+    if (FCB->State != SOCKET_STATE_CONNECTED)
+    {
+        AFD_DbgPrint(MIN_TRACE, ("Socket not connected\n"));
+        return UnlockAndMaybeComplete(FCB, STATUS_INVALID_CONNECTION, Irp, 0);
+    }
+
+    if (FCB->PollState & (AFD_EVENT_CLOSE | AFD_EVENT_ABORT))
+    {
+        AFD_DbgPrint(MIN_TRACE, ("Connection closed\n"));
+        return UnlockAndMaybeComplete(FCB, FCB->PollStatus[FD_CLOSE_BIT], Irp, 0);
+    }
+
+    if (FCB->SendClosed)
+    {
+        AFD_DbgPrint(MIN_TRACE, ("No more sends\n"));
+        return UnlockAndMaybeComplete(FCB, STATUS_FILE_CLOSED, Irp, 0);
+    }
+
+    Status = AfdCaptureTransmit(DeviceObject, Irp, IrpSp);
+    if (!NT_SUCCESS(Status))
+    {
+        AfdFreeTransmit(Irp);
+        return UnlockAndMaybeComplete(FCB, Status, Irp, 0);
+    }
+
+    Status = QueueUserModeIrp(FCB, Irp, FUNCTION_TRANSMIT);
+    if (Status == STATUS_PENDING)
+        AfdStartNextTransmit(FCB);
+
+    SocketStateUnlock(FCB);
+
+    return Status;
+}
+
+/* EOF */
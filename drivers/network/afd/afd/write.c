@@ -10,6 +10,92 @@
 
 #include "afd.h"
 
+/*
+ * Copies as much of the first send that is waiting for window space as
+ * fits into the send window.
+ */
+static VOID CopyWaitingSend(PAFD_FCB FCB) {
+    PLIST_ENTRY NextIrpEntry;
+    PIRP NextIrp;
+    PIO_STACK_LOCATION NextIrpSp;
+    PAFD_SEND_INFO SendReq;
+    PAFD_MAPBUF Map;
+    SIZE_T TotalBytesCopied, SpaceAvail, i;
+    UINT SendLength, BytesCopied;
+
+    if (IsListEmpty(&FCB->PendingIrpList[FUNCTION_SEND]))
+        return;
+
+    NextIrpEntry = FCB->PendingIrpList[FUNCTION_SEND].Flink;
+    NextIrp = CONTAINING_RECORD(NextIrpEntry, IRP, Tail.Overlay.ListEntry);
+
+    /* Sends held back behind a transmit request wait for it to finish */
+    if (AFD_SEND_IS_HELD(NextIrp))
+        return;
+
+    NextIrpSp = IoGetCurrentIrpStackLocation( NextIrp );
+    SendReq = GetLockedData(NextIrp, NextIrpSp);
+    Map = (PAFD_MAPBUF)(SendReq->BufferArray + SendReq->BufferCount);
+
+    AFD_DbgPrint(MID_TRACE,("SendReq @ %p\n", SendReq));
+
+    SpaceAvail = FCB->Send.Size - FCB->Send.BytesUsed;
+    TotalBytesCopied = 0;
+
+    /* Count the total transfer size */
+    SendLength = 0;
+    for (i = 0; i < SendReq->BufferCount; i++)
+    {
+        SendLength += SendReq->BufferArray[i].len;
+    }
+
+    /* Make sure we've got the space */
+    if (SendLength > SpaceAvail)
+    {
+       /* Blocking sockets have to wait here */
+       if (SendLength <= FCB->Send.Size && !((SendReq->AfdFlags & AFD_IMMEDIATE) || (FCB->NonBlocking)))
+       {
+           FCB->PollState &= ~AFD_EVENT_SEND;
+
+           NextIrp = NULL;
+       }
+
+       /* Check if we can send anything */
+       if (SpaceAvail == 0)
+       {
+           FCB->PollState &= ~AFD_EVENT_SEND;
+
+           /* We should never be non-overlapped and get to this point */
+           ASSERT(SendReq->AfdFlags & AFD_OVERLAPPED);
+
+           NextIrp = NULL;
+       }
+    }
+
+    if (NextIrp != NULL)
+    {
+        for( i = 0; i < SendReq->BufferCount; i++ ) {
+            BytesCopied = MIN(SendReq->BufferArray[i].len, SpaceAvail);
+
+            Map[i].BufferAddress =
+               MmMapLockedPages( Map[i].Mdl, KernelMode );
+
+            RtlCopyMemory( FCB->Send.Window + FCB->Send.BytesUsed,
+                           Map[i].BufferAddress,
+                           BytesCopied );
+
+            MmUnmapLockedPages( Map[i].BufferAddress, Map[i].Mdl );
+
+            TotalBytesCopied += BytesCopied;
+            SpaceAvail -= BytesCopied;
+            FCB->Send.BytesUsed += BytesCopied;
+        }
+
+        NextIrp->IoStatus.Information = TotalBytesCopied;
+        NextIrp->Tail.Overlay.DriverContext[3] = (PVOID)NextIrp->IoStatus.Information;
+    }
+}
+
 static IO_COMPLETION_ROUTINE SendComplete;
 static NTSTATUS NTAPI SendComplete
 ( PDEVICE_OBJECT DeviceObject,
@@ -22,8 +108,8 @@ static NTSTATUS NTAPI SendComplete
     PIO_STACK_LOCATION NextIrpSp;
     PAFD_SEND_INFO SendReq = NULL;
     PAFD_MAPBUF Map;
-    SIZE_T TotalBytesCopied = 0, TotalBytesProcessed = 0, SpaceAvail, i;
-    UINT SendLength, BytesCopied;
+    SIZE_T TotalBytesCopied = 0, TotalBytesProcessed = 0;
+    UINT SendLength;
     BOOLEAN HaltSendQueue;
 
     UNREFERENCED_PARAMETER(DeviceObject);
@@ -92,6 +178,7 @@ static NTSTATUS NTAPI SendComplete
             IoCompleteRequest( NextIrp, IO_NETWORK_INCREMENT );
         }
 
+        AfdStartNextTransmit(FCB);
         RetryDisconnectCompletion(FCB);
 
         SocketStateUnlock( FCB );
@@ -156,71 +243,8 @@ static NTSTATUS NTAPI SendComplete
 
     ASSERT(SendLength == 0);
 
-   if ( !HaltSendQueue && !IsListEmpty( &FCB->PendingIrpList[FUNCTION_SEND] ) ) {
-        NextIrpEntry = FCB->PendingIrpList[FUNCTION_SEND].Flink;
-        NextIrp = CONTAINING_RECORD(NextIrpEntry, IRP, Tail.Overlay.ListEntry);
-        NextIrpSp = IoGetCurrentIrpStackLocation( NextIrp );
-        SendReq = GetLockedData(NextIrp, NextIrpSp);
-        Map = (PAFD_MAPBUF)(SendReq->BufferArray + SendReq->BufferCount);
-
-        AFD_DbgPrint(MID_TRACE,("SendReq @ %p\n", SendReq));
-
-        SpaceAvail = FCB->Send.Size - FCB->Send.BytesUsed;
-        TotalBytesCopied = 0;
-
-        /* Count the total transfer size */
-        SendLength = 0;
-        for (i = 0; i < SendReq->BufferCount; i++)
-        {
-            SendLength += SendReq->BufferArray[i].len;
-        }
-
-        /* Make sure we've got the space */
-        if (SendLength > SpaceAvail)
-        {
-           /* Blocking sockets have to wait here */
-           if (SendLength <= FCB->Send.Size && !((SendReq->AfdFlags & AFD_IMMEDIATE) || (FCB->NonBlocking)))
-           {
-               FCB->PollState &= ~AFD_EVENT_SEND;
-
-               NextIrp = NULL;
-           }
-
-           /* Check if we can send anything */
-           if (SpaceAvail == 0)
-           {
-               FCB->PollState &= ~AFD_EVENT_SEND;
-
-               /* We should never be non-overlapped and get to this point */
-               ASSERT(SendReq->AfdFlags & AFD_OVERLAPPED);
-
-               NextIrp = NULL;
-           }
-        }
-
-        if (NextIrp != NULL)
-        {
-            for( i = 0; i < SendReq->BufferCount; i++ ) {
-                BytesCopied = MIN(SendReq->BufferArray[i].len, SpaceAvail);
-
-                Map[i].BufferAddress =
-                   MmMapLockedPages( Map[i].Mdl, KernelMode );
-
-                RtlCopyMemory( FCB->Send.Window + FCB->Send.BytesUsed,
-                               Map[i].BufferAddress,
-                               BytesCopied );
-
-                MmUnmapLockedPages( Map[i].BufferAddress, Map[i].Mdl );
-
-                TotalBytesCopied += BytesCopied;
-                SpaceAvail -= BytesCopied;
-                FCB->Send.BytesUsed += BytesCopied;
-            }
-
-            NextIrp->IoStatus.Information = TotalBytesCopied;
-            NextIrp->Tail.Overlay.DriverContext[3] = (PVOID)NextIrp->IoStatus.Information;
-        }
-    }
+    if (!HaltSendQueue)
+        CopyWaitingSend(FCB);
 
     if (FCB->Send.Size - FCB->Send.BytesUsed != 0 && !FCB->SendClosed &&
         IsListEmpty(&FCB->PendingIrpList[FUNCTION_SEND]))
@@ -248,7 +272,9 @@ static NTSTATUS NTAPI SendComplete
     }
     else
     {
-        /* Nothing is waiting so try to complete a pending disconnect */
+        /* Nothing is waiting so let a queued transmit request go, or
+         * try to complete a pending disconnect */
+        AfdStartNextTransmit(FCB);
         RetryDisconnectCompletion(FCB);
     }
 
@@ -257,6 +283,47 @@ static NTSTATUS NTAPI SendComplete
     return STATUS_SUCCESS;
 }
 
+/*
+ * Lets the sends that were held back behind a transmit request go once no
+ * transmit request is left. Called with the socket state lock held.
+ */
+VOID AfdReleaseHeldSends(PAFD_FCB FCB) {
+    PLIST_ENTRY CurrentEntry;
+    PIRP CurrentIrp;
+
+    ASSERT(IsListEmpty(&FCB->PendingIrpList[FUNCTION_TRANSMIT]));
+
+    for (CurrentEntry = FCB->PendingIrpList[FUNCTION_SEND].Flink;
+         CurrentEntry != &FCB->PendingIrpList[FUNCTION_SEND];
+         CurrentEntry = CurrentEntry->Flink)
+    {
+        CurrentIrp = CONTAINING_RECORD(CurrentEntry, IRP, Tail.Overlay.ListEntry);
+        SET_AFD_SEND_HELD(CurrentIrp, FALSE);
+    }
+
+    if (FCB->SendIrp.InFlightRequest || FCB->State == SOCKET_STATE_CLOSED)
+        return;
+
+    CopyWaitingSend(FCB);
+
+    if (FCB->Send.BytesUsed)
+    {
+        TdiSend(&FCB->SendIrp.InFlightRequest,
+                FCB->Connection.Object,
+                0,
+                FCB->Send.Window,
+                FCB->Send.BytesUsed,
+                SendComplete,
+                FCB);
+    }
+    else if (IsListEmpty(&FCB->PendingIrpList[FUNCTION_SEND]) && !FCB->SendClosed)
+    {
+        FCB->PollState |= AFD_EVENT_SEND;
+        FCB->PollStatus[FD_WRITE_BIT] = STATUS_SUCCESS;
+        PollReeval(FCB->DeviceExt, FCB->FileObject);
+    }
+}
+
 static IO_COMPLETION_ROUTINE PacketSocketSendComplete;
 static NTSTATUS NTAPI PacketSocketSendComplete
 ( PDEVICE_OBJECT DeviceObject,
@@ -457,6 +524,14 @@ AfdConnectedSocketWriteData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
         return UnlockAndMaybeComplete( FCB, STATUS_INVALID_CONNECTION, Irp, 0 );
     }
 
+    /* Data sent after a transmit request must not overtake it */
+    SET_AFD_SEND_HELD(Irp, !IsListEmpty(&FCB->PendingIrpList[FUNCTION_TRANSMIT]));
+    if (AFD_SEND_IS_HELD(Irp))
+    {
+        AFD_DbgPrint(MID_TRACE,("Holding the send back behind a transmit\n"));
+        return LeaveIrpUntilLater(FCB, Irp, FUNCTION_SEND);
+    }
+
     AFD_DbgPrint(MID_TRACE,("FCB->Send.BytesUsed = %u\n",
                             FCB->Send.BytesUsed));
 
@@ -52,6 +52,7 @@
 #define TAG_AFD_SNMP_ADDRESS_INFO          'asfA'
 #define TAG_AFD_TDI_CONNECTION_INFORMATION 'cTfA'
 #define TAG_AFD_WSA_BUFFER                 'bWfA'
+#define TAG_AFD_TRANSMIT                   'fTfA'
 
 typedef struct IPADDR_ENTRY {
 	ULONG  Addr;
@@ -88,9 +89,10 @@ typedef struct IPADDR_ENTRY {
 #define FUNCTION_ACCEPT                 4
 #define FUNCTION_DISCONNECT             5
 #define FUNCTION_CLOSE                  6
-#define MAX_FUNCTIONS                   7
+#define FUNCTION_TRANSMIT               7
+#define MAX_FUNCTIONS                   8
 
-#define IN_FLIGHT_REQUESTS              5
+#define IN_FLIGHT_REQUESTS              6
 
 #define EXTRA_LOCK_BUFFERS              2 /* Number of extra buffers needed
 					   * for ancillary data on packet
@@ -102,6 +104,10 @@ typedef struct IPADDR_ENTRY {
 #define AFD_HANDLES(x) ((PAFD_HANDLE)(x)->Exclusive)
 #define SET_AFD_HANDLES(x,y) (((x)->Exclusive) = (ULONG_PTR)(y))
 
+/* Marks a send IRP that waits for the transmit requests queued before it */
+#define AFD_SEND_IS_HELD(x) ((x)->Tail.Overlay.DriverContext[2] != NULL)
+#define SET_AFD_SEND_HELD(x,y) ((x)->Tail.Overlay.DriverContext[2] = (PVOID)(ULONG_PTR)(y))
+
 typedef struct _AFD_MAPBUF {
     PVOID BufferAddress;
     PMDL  Mdl;
@@ -174,7 +180,8 @@ typedef struct _AFD_FCB {
     PTRANSPORT_ADDRESS LocalAddress, RemoteAddress;
     PTDI_CONNECTION_INFORMATION AddressFrom, ConnectCallInfo, ConnectReturnInfo;
     AFD_TDI_OBJECT AddressFile, Connection;
-    AFD_IN_FLIGHT_REQUEST ConnectIrp, ListenIrp, ReceiveIrp, SendIrp, DisconnectIrp;
+    AFD_IN_FLIGHT_REQUEST ConnectIrp, ListenIrp, ReceiveIrp, SendIrp, DisconnectIrp, TransmitIrp;
+    struct _AFD_TRANSMIT *Transmit;
     AFD_DATA_WINDOW Send, Recv;
     KMUTEX Mutex;
     PKEVENT EventSelect;
@@ -379,6 +386,15 @@ NTSTATUS TdiSend
   PIO_COMPLETION_ROUTINE  CompletionRoutine,
   PVOID CompletionContext);
 
+NTSTATUS TdiSendMdl
+( PIRP *Irp,
+  PFILE_OBJECT ConnectionObject,
+  USHORT Flags,
+  PMDL Mdl,
+  UINT BufferLength,
+  PIO_COMPLETION_ROUTINE  CompletionRoutine,
+  PVOID CompletionContext);
+
 NTSTATUS TdiReceiveDatagram(
     PIRP *Irp,
     PFILE_OBJECT TransportObject,
@@ -402,6 +418,15 @@ NTSTATUS TdiQueryMaxDatagramLength(
         PFILE_OBJECT FileObject,
         PUINT MaxDatagramLength);
 
+/* transmit.c */
+
+NTSTATUS NTAPI
+AfdTransmit(PDEVICE_OBJECT DeviceObject, PIRP Irp,
+            PIO_STACK_LOCATION IrpSp);
+VOID AfdStartNextTransmit(PAFD_FCB FCB);
+VOID AfdCancelTransmit(PAFD_FCB FCB, PIRP Irp);
+VOID AfdFreeTransmit(PIRP Irp);
+
 /* write.c */
 
 NTSTATUS NTAPI
@@ -410,5 +435,6 @@ AfdConnectedSocketWriteData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
 NTSTATUS NTAPI
 AfdPacketSocketWriteData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
 			 PIO_STACK_LOCATION IrpSp);
+VOID AfdReleaseHeldSends(PAFD_FCB FCB);
 
 #endif /* _AFD_H */
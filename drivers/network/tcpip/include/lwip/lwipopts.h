@@ -45,16 +45,29 @@
  * add support for other transport mediums */
 #define TCP_MSS                         1460
 
-#define TCP_WND                         0xFFFF
+/* RFC 7323 window scaling, so a connection can keep more than 64 KB
+ * in flight. TCP_WND must not exceed 0xFFFF << TCP_RCV_SCALE. The window
+ * of a single connection can be lowered with SO_RCVBUF or TcpWindowSize */
+#define LWIP_WND_SCALE                  1
 
-#define TCP_SND_BUF                     TCP_WND
+#define TCP_RCV_SCALE                   3
+
+#define TCP_WND                         (256 * 1024)
+
+/* Only the receive window scales. tcp_sndbuf() and tcp_write() are 16-bit,
+ * and TCP_SNDLOWAT must stay 4 * TCP_MSS below 0xFFFF */
+#define TCP_SND_BUF                     0xFFFF
 
 #define TCP_MAXRTX                      8
 
 #define TCP_SYNMAXRTX                   4
 
+/* Enforce the listen backlog (half-open connections per listener).
+ * lwIP stores it in a u8_t, TCPListen() clamps it to TcpMaxListenBacklog */
 #define TCP_LISTEN_BACKLOG              1
 
+#define TCP_DEFAULT_LISTEN_BACKLOG      0xFF
+
 #define LWIP_TCP_TIMESTAMPS             1
 
 #define LWIP_SOCKET                     0
@@ -95,6 +95,8 @@ typedef struct _CLIENT_DATA {
 
 extern LONG TCP_IPIdentification;
 extern CLIENT_DATA ClientInfo;
+extern ULONG TCPDefaultReceiveWindow;
+extern ULONG TCPMaxListenBacklog;
 
 /* accept.c */
 NTSTATUS TCPCheckPeerForAccept(PVOID Context,
@@ -188,6 +190,8 @@ BOOLEAN TCPRemoveIRP( PCONNECTION_ENDPOINT Connection, PIRP Irp );
 
 NTSTATUS TCPSetNoDelay(PCONNECTION_ENDPOINT Connection, BOOLEAN Set);
 
+NTSTATUS TCPSetReceiveWindow(PCONNECTION_ENDPOINT Connection, ULONG Size);
+
 VOID
 TCPUpdateInterfaceLinkStatus(PIP_INTERFACE IF);
 
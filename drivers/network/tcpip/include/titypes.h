@@ -255,6 +255,11 @@ typedef struct _CONNECTION_ENDPOINT {
 
     LIST_ENTRY PacketQueue;    /* Queued received packets waiting to be processed */
 
+    /* Receive window */
+    ULONG ReceiveWindow;       /* Requested receive window (0 = lwIP maximum) */
+    LONG ReceiveCredit;        /* Bytes taken from PacketQueue, not yet returned to lwIP */
+    ULONG ReceiveWithheld;     /* Credit held back to honour ReceiveWindow (tcpip thread only) */
+
     /* Disconnect Timer */
     KTIMER DisconnectTimer;
     KDPC DisconnectDpc;
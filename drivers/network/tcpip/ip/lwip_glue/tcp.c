@@ -157,6 +157,9 @@ NTSTATUS LibTCPGetDataFromConnectionQueue(PCONNECTION_ENDPOINT Connection, PUCHA
             if (!RecvLen)
                 break;
         }
+
+        /* The data is out of the queue, so lwIP may open the window again */
+        InterlockedExchangeAdd(&Connection->ReceiveCredit, (LONG)(*Received));
     }
     else
     {
@@ -168,9 +171,71 @@ NTSTATUS LibTCPGetDataFromConnectionQueue(PCONNECTION_ENDPOINT Connection, PUCHA
 
     UnlockObject(Connection);
 
+    if (*Received)
+        LibTCPUpdateReceiveWindow(Connection);
+
     return Status;
 }
 
+/* Received data is only acknowledged to lwIP (tcp_recved) once it has been
+ * taken out of the packet queue, so the advertised window shrinks while data
+ * waits for a receive. A connection with a smaller ReceiveWindow than the lwIP
+ * window keeps the difference withheld, which caps the data it has in flight. */
+static
+void
+LibTCPReturnReceiveCredit(PCONNECTION_ENDPOINT Connection, PTCP_PCB pcb)
+{
+    ULONG Window, MaxWindow, Withhold, Credit, Length;
+
+    /* A listening PCB has no window */
+    if (pcb->state == LISTEN)
+        return;
+
+    MaxWindow = TCP_WND_MAX(pcb);
+    Window = Connection->ReceiveWindow;
+    if (Window == 0 || Window > MaxWindow)
+        Window = MaxWindow;
+    else if (Window < 2 * TCP_MSS)
+        Window = 2 * TCP_MSS;
+    Withhold = MaxWindow - Window;
+
+    Credit = (ULONG)InterlockedExchange(&Connection->ReceiveCredit, 0);
+    Credit += Connection->ReceiveWithheld;
+
+    Connection->ReceiveWithheld = MIN(Credit, Withhold);
+    Credit -= Connection->ReceiveWithheld;
+
+    while (Credit != 0)
+    {
+        Length = MIN(Credit, 0xFFFF);
+        tcp_recved(pcb, (u16_t)Length);
+        Credit -= Length;
+    }
+}
+
+static
+void
+LibTCPUpdateReceiveWindowCallback(void *arg)
+{
+    PCONNECTION_ENDPOINT Connection = arg;
+
+    ASSERT(Connection);
+
+    if (Connection->SocketContext)
+        LibTCPReturnReceiveCredit(Connection, Connection->SocketContext);
+
+    DereferenceObject(Connection);
+}
+
+void
+LibTCPUpdateReceiveWindow(PCONNECTION_ENDPOINT Connection)
+{
+    /* This does not wait, the poll callback picks up the credit if we cannot queue it */
+    ReferenceObject(Connection);
+    if (tcpip_callback_with_block(LibTCPUpdateReceiveWindowCallback, Connection, 0) != ERR_OK)
+        DereferenceObject(Connection);
+}
+
 static
 BOOLEAN
 WaitForEventSafely(PRKEVENT Event)
@@ -225,10 +290,9 @@ InternalRecvEventHandler(void *arg, PTCP_PCB pcb, struct pbuf *p, const err_t er
 
     if (p)
     {
+        /* The window is opened again in LibTCPReturnReceiveCredit, once the data is consumed */
         LibTCPEnqueuePacket(Connection, p);
 
-        tcp_recved(pcb, p->tot_len);
-
         TCPRecvEventHandler(arg);
     }
     else if (err == ERR_OK)
@@ -260,6 +324,22 @@ InternalRecvEventHandler(void *arg, PTCP_PCB pcb, struct pbuf *p, const err_t er
     return ERR_OK;
 }
 
+static
+err_t
+InternalPollEventHandler(void *arg, PTCP_PCB pcb)
+{
+    PCONNECTION_ENDPOINT Connection = arg;
+
+    /* Make sure the socket didn't get closed */
+    if (!arg || Connection->SocketContext != pcb)
+        return ERR_OK;
+
+    /* Return any receive credit a failed LibTCPUpdateReceiveWindow left behind */
+    LibTCPReturnReceiveCredit(Connection, pcb);
+
+    return ERR_OK;
+}
+
 /* This function MUST return an error value that is not ERR_ABRT or ERR_OK if the connection
  * is not accepted to avoid leaking the new PCB */
 static
@@ -607,6 +687,7 @@ LibTCPConnectCallback(void *arg)
 
     tcp_recv((PTCP_PCB)msg->Input.Connect.Connection->SocketContext, InternalRecvEventHandler);
     tcp_sent((PTCP_PCB)msg->Input.Connect.Connection->SocketContext, InternalSendEventHandler);
+    tcp_poll((PTCP_PCB)msg->Input.Connect.Connection->SocketContext, InternalPollEventHandler, 4);
 
     Error = tcp_connect((PTCP_PCB)msg->Input.Connect.Connection->SocketContext,
                         msg->Input.Connect.IpAddress, lwip_ntohs(msg->Input.Connect.Port),
@@ -834,6 +915,7 @@ LibTCPAccept(PTCP_PCB pcb, struct tcp_pcb *listen_pcb, void *arg)
     tcp_arg(pcb, NULL);
     tcp_recv(pcb, InternalRecvEventHandler);
     tcp_sent(pcb, InternalSendEventHandler);
+    tcp_poll(pcb, InternalPollEventHandler, 4);
     tcp_err(pcb, InternalErrorEventHandler);
     tcp_arg(pcb, arg);
 
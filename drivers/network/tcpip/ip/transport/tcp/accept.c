@@ -92,7 +92,7 @@ NTSTATUS TCPListen(PCONNECTION_ENDPOINT Connection, UINT Backlog)
 
     if (NT_SUCCESS(Status))
     {
-        Connection->SocketContext = LibTCPListen(Connection, Backlog);
+        Connection->SocketContext = LibTCPListen(Connection, (u8_t)MIN(Backlog, TCPMaxListenBacklog));
         if (!Connection->SocketContext)
             Status = STATUS_UNSUCCESSFUL;
     }
@@ -25,6 +25,10 @@ PORT_SET TCPPorts;
 
 NPAGED_LOOKASIDE_LIST TdiBucketLookasideList;
 
+/* Tcpip\Parameters */
+ULONG TCPDefaultReceiveWindow = 0; /* TcpWindowSize, 0 = lwIP maximum */
+ULONG TCPMaxListenBacklog = TCP_DEFAULT_LISTEN_BACKLOG; /* TcpMaxListenBacklog */
+
 static
 IO_WORKITEM_ROUTINE
 DisconnectWorker;
@@ -139,6 +143,8 @@ PCONNECTION_ENDPOINT TCPAllocateConnectionEndpoint( PVOID ClientContext )
     /* Save client context pointer */
     Connection->ClientContext = ClientContext;
 
+    Connection->ReceiveWindow = TCPDefaultReceiveWindow;
+
     Connection->RefCount = 1;
     Connection->Free = ConnectionFree;
 
@@ -213,6 +219,7 @@ NTSTATUS TCPStartup(VOID)
  */
 {
     NTSTATUS Status;
+    RTL_QUERY_REGISTRY_TABLE QueryTable[3];
 
     Status = PortsStartup(&TCPPorts, 1, 0xffff);
     if (!NT_SUCCESS(Status))
@@ -228,6 +235,27 @@ NTSTATUS TCPStartup(VOID)
                                     TDI_BUCKET_TAG,
                                     0);
 
+    /* Read the optional TCP parameters, keeping the defaults if they are absent */
+    RtlZeroMemory(QueryTable, sizeof(QueryTable));
+
+    QueryTable[0].Flags = RTL_QUERY_REGISTRY_DIRECT;
+    QueryTable[0].Name = L"TcpWindowSize";
+    QueryTable[0].EntryContext = &TCPDefaultReceiveWindow;
+
+    QueryTable[1].Flags = RTL_QUERY_REGISTRY_DIRECT;
+    QueryTable[1].Name = L"TcpMaxListenBacklog";
+    QueryTable[1].EntryContext = &TCPMaxListenBacklog;
+
+    RtlQueryRegistryValues(RTL_REGISTRY_SERVICES,
+                           L"Tcpip\\Parameters",
+                           QueryTable,
+                           NULL,
+                           NULL);
+
+    /* lwIP keeps the backlog in a u8_t */
+    if (TCPMaxListenBacklog == 0 || TCPMaxListenBacklog > TCP_DEFAULT_LISTEN_BACKLOG)
+        TCPMaxListenBacklog = TCP_DEFAULT_LISTEN_BACKLOG;
+
     /* Initialize our IP library */
     LibIPInitialize();
 
@@ -745,6 +773,23 @@ TCPSetNoDelay(
     return STATUS_SUCCESS;
 }
 
+NTSTATUS
+TCPSetReceiveWindow(
+    PCONNECTION_ENDPOINT Connection,
+    ULONG Size)
+{
+    if (!Connection)
+        return STATUS_UNSUCCESSFUL;
+
+    Connection->ReceiveWindow = Size;
+
+    /* Release withheld credit right away if the window grew */
+    if (Connection->SocketContext != NULL)
+        LibTCPUpdateReceiveWindow(Connection);
+
+    return STATUS_SUCCESS;
+}
+
 NTSTATUS
 TCPGetSocketStatus(
     PCONNECTION_ENDPOINT Connection,
@@ -582,6 +582,7 @@ AhciCompleteIssuedSrb (
         if (((1 << i) & CommandsToComplete) != 0)
         {
             Srb = PortExtension->Slot[i];
+            PortExtension->Slot[i] = NULL;
 
             if (Srb == NULL)
             {
@@ -697,6 +698,10 @@ AhciInterruptHandler (
     {
         AhciCompleteIssuedSrb(PortExtension, (PortExtension->CommandIssuedSlots & (~outstanding)));
         PortExtension->CommandIssuedSlots &= outstanding;
+        PortExtension->NcqSlots &= outstanding;
+
+        // slots were freed, feed the pending Srbs to the port
+        AhciIssueQueuedSrbs(PortExtension);
     }
 
     return;
@@ -1403,6 +1408,13 @@ AhciProcessSrb (
     NT_ASSERT(SlotIndex < AHCI_Global_Port_CAP_NCS(AdapterExtension->CAP));
     SrbExtension->SlotIndex = SlotIndex;
 
+    if (SrbExtension->Flags & ATA_FLAGS_NCQ)
+    {
+        // ACS-3 7.23 -- the queue tag goes into Count(7:3), we use the slot number
+        SrbExtension->SectorCountLow = (UCHAR)(SlotIndex << 3);
+        PortExtension->NcqSlots |= 1UL << SlotIndex;
+    }
+
     // program the CFIS in the CommandTable
     CommandHeader = &PortExtension->CommandList[SlotIndex];
 
@@ -1481,18 +1493,13 @@ AhciProcessSrb (
  *
  */
 
-#ifdef _MSC_VER     // avoid MSVC C4700
-    #pragma warning(push)
-    #pragma warning(disable: 4700)
-#endif
-
 VOID
 AhciActivatePort (
     __in PAHCI_PORT_EXTENSION PortExtension
     )
 {
     AHCI_PORT_CMD cmd;
-    ULONG QueueSlots, slotToActivate, tmp;
+    ULONG QueueSlots, ncqSlots;
     PAHCI_ADAPTER_EXTENSION AdapterExtension;
 
     AhciDebugPrint("AhciActivatePort()\n");
@@ -1514,30 +1521,82 @@ AhciActivatePort (
         return;
     }
 
-    // get the lowest set bit
-    tmp = QueueSlots & (QueueSlots - 1);
-
-    if (tmp == 0)
-        slotToActivate = QueueSlots;
-    else
-        slotToActivate = (QueueSlots & (~tmp));
-
-    // mark that bit off in QueueSlots
-    // so we can know we it is really needed to activate port or not
-    PortExtension->QueueSlots &= ~slotToActivate;
+    // issue every prepared slot at once, the HBA works through them on its own
+    PortExtension->QueueSlots = 0;
     // mark this CommandIssuedSlots
     // to validate in completeIssuedCommand
-    PortExtension->CommandIssuedSlots |= slotToActivate;
+    PortExtension->CommandIssuedSlots |= QueueSlots;
+
+    // 5.3.2.x -- for native queued commands software sets PxSACT before PxCI
+    ncqSlots = QueueSlots & PortExtension->NcqSlots;
+    if (ncqSlots != 0)
+    {
+        StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->SACT, ncqSlots);
+    }
 
-    // tell the HBA to issue this Command Slot to the given port
-    StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->CI, slotToActivate);
+    // tell the HBA to issue these Command Slots to the given port
+    StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->CI, QueueSlots);
 
     return;
 }// -- AhciActivatePort();
 
-#ifdef _MSC_VER     // avoid MSVC C4700
-    #pragma warning(pop)
-#endif
+/**
+ * @name AhciIssueQueuedSrbs
+ * @implemented
+ *
+ * Populate free command slots with pending Srbs and program the port.
+ * Native queued and non-queued commands are never outstanding at the same time.
+ * Must be called with the interrupt lock held.
+ *
+ * @param PortExtension
+ *
+ */
+VOID
+AhciIssueQueuedSrbs (
+    __in PAHCI_PORT_EXTENSION PortExtension
+    )
+{
+    BOOLEAN isNcq;
+    PSCSI_REQUEST_BLOCK Srb;
+    PAHCI_SRB_EXTENSION SrbExtension;
+    ULONG freeSlots, occupiedSlots, slotIndex, NCS;
+
+    AhciDebugPrint("AhciIssueQueuedSrbs()\n");
+
+    NCS = AHCI_Global_Port_CAP_NCS(PortExtension->AdapterExtension->CAP);
+
+    while ((Srb = PeekQueue(&PortExtension->SrbQueue)) != NULL)
+    {
+        SrbExtension = GetSrbExtension(Srb);
+        isNcq = ((SrbExtension->Flags & ATA_FLAGS_NCQ) != 0);
+        occupiedSlots = (PortExtension->QueueSlots | PortExtension->CommandIssuedSlots); // Busy command slots for given port
+
+        // wait for the outstanding commands to drain before switching between queued and non-queued ones
+        if ((occupiedSlots != 0) && (isNcq != (PortExtension->NcqSlots != 0)))
+        {
+            break;
+        }
+
+        // queue tags must stay below the device queue depth, storport doesn't enforce it for us
+        freeSlots = AHCI_SLOT_MASK(isNcq ? PortExtension->MaxPortQueueDepth : NCS) & ~occupiedSlots;
+        if (freeSlots == 0)
+        {
+            break;
+        }
+
+        // find first free slot
+        for (slotIndex = 0; (freeSlots & (1UL << slotIndex)) == 0; slotIndex++);
+
+        RemoveQueue(&PortExtension->SrbQueue);
+        NT_ASSERT(Srb->PathId == PortExtension->PortNumber);
+        AhciProcessSrb(PortExtension, Srb, slotIndex);
+    }
+
+    // program HBA port
+    AhciActivatePort(PortExtension);
+
+    return;
+}// -- AhciIssueQueuedSrbs();
 
 /**
  * @name AhciProcessIO
@@ -1558,10 +1617,8 @@ AhciProcessIO (
     __in PSCSI_REQUEST_BLOCK Srb
     )
 {
-    PSCSI_REQUEST_BLOCK tmpSrb;
     STOR_LOCK_HANDLE lockhandle = {0};
     PAHCI_PORT_EXTENSION PortExtension;
-    ULONG commandSlotMask, occupiedSlots, slotIndex, NCS;
 
     AhciDebugPrint("AhciProcessIO()\n");
     AhciDebugPrint("\tPathId: %d\n", PathId);
@@ -1583,39 +1640,7 @@ AhciProcessIO (
         return; // we should wait for device to get active
     }
 
-    occupiedSlots = (PortExtension->QueueSlots | PortExtension->CommandIssuedSlots); // Busy command slots for given port
-    NCS = AHCI_Global_Port_CAP_NCS(AdapterExtension->CAP);
-    commandSlotMask = (1 << NCS) - 1; // available slots mask
-
-    commandSlotMask = (commandSlotMask & ~occupiedSlots);
-    if(commandSlotMask != 0)
-    {
-        // iterate over HBA port slots
-        for (slotIndex = 0; slotIndex < NCS; slotIndex++)
-        {
-            // find first free slot
-            if ((commandSlotMask & (1 << slotIndex)) != 0)
-            {
-                tmpSrb = RemoveQueue(&PortExtension->SrbQueue);
-                if (tmpSrb != NULL)
-                {
-                    NT_ASSERT(tmpSrb->PathId == PathId);
-                    AhciProcessSrb(PortExtension, tmpSrb, slotIndex);
-                }
-                else
-                {
-                    break;
-                }
-            }
-            else
-            {
-                break;
-            }
-        }
-    }
-
-    // program HBA port
-    AhciActivatePort(PortExtension);
+    AhciIssueQueuedSrbs(PortExtension);
 
     // Release Lock
     StorPortReleaseSpinLock(AdapterExtension, &lockhandle);
@@ -1660,7 +1685,7 @@ AtapiInquiryCompletion (
                                          Srb->PathId,
                                          Srb->TargetId,
                                          Srb->Lun,
-                                         AHCI_Global_Port_CAP_NCS(AdapterExtension->CAP));
+                                         PortExtension->MaxPortQueueDepth);
 
     NT_ASSERT(status == TRUE);
     return;
@@ -1737,6 +1762,20 @@ InquiryCompletion (
 
         PortExtension->DeviceParams.AccessType = DIRECT_ACCESS_DEVICE;
 
+        // Native Command Queuing needs HBA (CAP.SNCQ) and device (word 76) support,
+        // word 75 holds the 0's based device queue depth
+        PortExtension->DeviceParams.NativeCommandQueuing = 0;
+        if ((AdapterExtension->CAP & AHCI_Global_HBA_CAP_SNCQ) &&
+            PortExtension->DeviceParams.Lba48BitMode &&
+            (IdentifyDeviceData->ReservedWords76[0] != 0xFFFF) &&
+            (IdentifyDeviceData->ReservedWords76[0] & IDENTIFY_SATA_CAPABILITIES_NCQ))
+        {
+            PortExtension->DeviceParams.NativeCommandQueuing = 1;
+            PortExtension->MaxPortQueueDepth = min(AHCI_Global_Port_CAP_NCS(AdapterExtension->CAP),
+                                                   (ULONG)IdentifyDeviceData->QueueDepth + 1);
+            AhciDebugPrint("\tNCQ depth: %d\n", PortExtension->MaxPortQueueDepth);
+        }
+
         /* Device max address lba */
         if (PortExtension->DeviceParams.Lba48BitMode)
         {
@@ -1798,7 +1837,7 @@ InquiryCompletion (
     // prepare data to send
     InquiryData->Versions = 2;
     InquiryData->Wide32Bit = 1;
-    InquiryData->CommandQueue = 0; // NCQ not supported
+    InquiryData->CommandQueue = PortExtension->DeviceParams.NativeCommandQueuing;
     InquiryData->ResponseDataFormat = 0x2;
     InquiryData->DeviceTypeModifier = 0;
     InquiryData->DeviceTypeQualifier = DEVICE_CONNECTED;
@@ -1820,7 +1859,7 @@ InquiryCompletion (
                                          Srb->PathId,
                                          Srb->TargetId,
                                          Srb->Lun,
-                                         AHCI_Global_Port_CAP_NCS(AdapterExtension->CAP));
+                                         PortExtension->MaxPortQueueDepth);
 
     NT_ASSERT(status == TRUE);
     return;
@@ -2027,7 +2066,7 @@ DeviceRequestReadWrite (
     NT_ASSERT(SectorCount > 0);
 
     SrbExtension->AtaFunction = ATA_FUNCTION_ATA_READ;
-    SrbExtension->Flags |= ATA_FLAGS_USE_DMA;
+    SrbExtension->Flags = ATA_FLAGS_USE_DMA;
     SrbExtension->CompletionRoutine = NULL;
 
     if (IsReading)
@@ -2070,11 +2109,26 @@ DeviceRequestReadWrite (
         NT_ASSERT(FALSE);
     }
 
-    SrbExtension->FeaturesHigh = 0;
-    SrbExtension->SectorCountLow = (SectorCount >> 0) & 0xFF;
-    SrbExtension->SectorCountHigh = (SectorCount >> 8) & 0xFF;
+    if (PortExtension->DeviceParams.NativeCommandQueuing)
+    {
+        // READ/WRITE FPDMA QUEUED carry the sector count in the features registers,
+        // the tag is filled in once the command gets its slot
+        SrbExtension->Flags |= ATA_FLAGS_NCQ;
+        SrbExtension->CommandReg = IsReading ? IDE_COMMAND_READ_FPDMA_QUEUED : IDE_COMMAND_WRITE_FPDMA_QUEUED;
+        SrbExtension->Device = IDE_LBA_MODE;
+        SrbExtension->FeaturesLow = (SectorCount >> 0) & 0xFF;
+        SrbExtension->FeaturesHigh = (SectorCount >> 8) & 0xFF;
+        SrbExtension->SectorCountLow = 0;
+        SrbExtension->SectorCountHigh = 0; // normal priority
+    }
+    else
+    {
+        SrbExtension->FeaturesHigh = 0;
+        SrbExtension->SectorCountLow = (SectorCount >> 0) & 0xFF;
+        SrbExtension->SectorCountHigh = (SectorCount >> 8) & 0xFF;
+    }
 
-    NT_ASSERT(SectorCount < 0x100);
+    NT_ASSERT(SectorCount <= 0x100);
 
     SrbExtension->pSgl = (PLOCAL_SCATTER_GATHER_LIST)StorPortGetScatterGatherList(AdapterExtension, Srb);
 
@@ -2547,6 +2601,33 @@ RemoveQueue (
     return Srb;
 }// -- RemoveQueue();
 
+/**
+ * @name PeekQueue
+ * @implemented
+ *
+ * Return the Srb at the head of Queue without removing it
+ *
+ * @param Queue
+ *
+ * @return
+ * return Srb
+ *
+ */
+FORCEINLINE
+PVOID
+PeekQueue (
+    __in PAHCI_QUEUE Queue
+    )
+{
+    NT_ASSERT(Queue->Head < MAXIMUM_QUEUE_BUFFER_SIZE);
+    NT_ASSERT(Queue->Tail < MAXIMUM_QUEUE_BUFFER_SIZE);
+
+    if (Queue->Head == Queue->Tail)
+        return NULL;
+
+    return Queue->Buffer[Queue->Tail];
+}// -- PeekQueue();
+
 /**
  * @name GetSrbExtension
  * @implemented
@@ -0,0 +1,1064 @@
+/*
+ * PROJECT:     ReactOS Storport NVMe Miniport Driver
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     NVMe controller initialization, I/O queues and SCSI translation
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+/* INCLUDES *******************************************************************/
+
+#include "stornvme.h"
+
+#define NDEBUG
+#include <debug.h>
+
+/* Not in storport.h */
+#define MODE_DSP_FUA_SUPPORTED          0x10
+#define SERVICE_ACTION_READ_CAPACITY16  0x10
+
+/* FUNCTIONS ******************************************************************/
+
+static
+ULONG
+NvmeReadRegister(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ ULONG Offset)
+{
+    return StorPortReadRegisterUlong(Adapter, (PULONG)(Adapter->Registers + Offset));
+}
+
+static
+VOID
+NvmeWriteRegister(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ ULONG Offset,
+    _In_ ULONG Value)
+{
+    StorPortWriteRegisterUlong(Adapter, (PULONG)(Adapter->Registers + Offset), Value);
+}
+
+static
+BOOLEAN
+NvmeWaitForReady(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ BOOLEAN Ready)
+{
+    ULONG Status = 0, Waited;
+
+    for (Waited = 0; Waited < Adapter->TimeoutMs; Waited++)
+    {
+        Status = NvmeReadRegister(Adapter, NVME_REG_CSTS);
+
+        /* The device is gone */
+        if (Status == 0xFFFFFFFF)
+            return FALSE;
+
+        if (((Status & NVME_CSTS_RDY) != 0) == Ready)
+            return TRUE;
+
+        StorPortStallExecution(1000);
+    }
+
+    DPRINT1("Controller did not become %s, CSTS 0x%lx\n", Ready ? "ready" : "idle", Status);
+    return FALSE;
+}
+
+static
+VOID
+NvmeInitializeQueue(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _Out_ PNVME_QUEUE Queue,
+    _In_ USHORT QueueId,
+    _In_ USHORT Entries,
+    _In_ PVOID SubmissionQueue,
+    _In_ PVOID CompletionQueue)
+{
+    ULONG Length;
+
+    RtlZeroMemory(Queue, sizeof(*Queue));
+
+    Queue->SubmissionQueue = SubmissionQueue;
+    Queue->CompletionQueue = CompletionQueue;
+    Queue->SubmissionQueuePhysical = StorPortGetPhysicalAddress(Adapter, NULL, SubmissionQueue, &Length);
+    Queue->CompletionQueuePhysical = StorPortGetPhysicalAddress(Adapter, NULL, CompletionQueue, &Length);
+
+    Queue->SubmissionDoorbell = (PULONG)(Adapter->Registers + NVME_REG_DOORBELL +
+                                         (2 * QueueId) * Adapter->DoorbellStride);
+    Queue->CompletionDoorbell = (PULONG)(Adapter->Registers + NVME_REG_DOORBELL +
+                                         (2 * QueueId + 1) * Adapter->DoorbellStride);
+
+    Queue->QueueId = QueueId;
+    Queue->Entries = Entries;
+    Queue->Phase = NVME_CQE_PHASE_BIT;
+    KeInitializeSpinLock(&Queue->SubmissionLock);
+}
+
+static
+VOID
+NvmeSubmitCommand(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _Inout_ PNVME_QUEUE Queue,
+    _In_ PNVME_COMMAND Command)
+{
+    RtlCopyMemory(&Queue->SubmissionQueue[Queue->SubmissionTail], Command, sizeof(*Command));
+
+    Queue->SubmissionTail++;
+    if (Queue->SubmissionTail == Queue->Entries)
+        Queue->SubmissionTail = 0;
+
+    /* The entry must be visible before the controller fetches it */
+    KeMemoryBarrier();
+    StorPortWriteRegisterUlong(Adapter, Queue->SubmissionDoorbell, Queue->SubmissionTail);
+}
+
+static
+BOOLEAN
+NvmeNextCompletion(
+    _Inout_ PNVME_QUEUE Queue,
+    _Out_ PULONG Status,
+    _Out_opt_ PULONG Result)
+{
+    PNVME_COMPLETION Completion;
+
+    Completion = &Queue->CompletionQueue[Queue->CompletionHead];
+    *Status = *(volatile ULONG *)&Completion->Status;
+
+    /* The controller flips the phase bit every time it wraps around */
+    if (NVME_CQE_PHASE(*Status) != Queue->Phase)
+        return FALSE;
+
+    if (Result)
+        *Result = Completion->Result;
+
+    Queue->CompletionHead++;
+    if (Queue->CompletionHead == Queue->Entries)
+    {
+        Queue->CompletionHead = 0;
+        Queue->Phase ^= NVME_CQE_PHASE_BIT;
+    }
+
+    return TRUE;
+}
+
+static
+BOOLEAN
+NvmeExecuteAdminCommand(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _Inout_ PNVME_COMMAND Command,
+    _Out_opt_ PULONG Result)
+{
+    PNVME_QUEUE Queue = &Adapter->AdminQueue;
+    ULONG Status, Waited;
+
+    Command->CommandId = Adapter->AdminCommandId++;
+    NvmeSubmitCommand(Adapter, Queue, Command);
+
+    /* Interrupts are masked during initialization, so poll for the completion */
+    for (Waited = 0; Waited < NVME_ADMIN_TIMEOUT_MS * 100; Waited++)
+    {
+        if (NvmeNextCompletion(Queue, &Status, Result))
+        {
+            StorPortWriteRegisterUlong(Adapter, Queue->CompletionDoorbell, Queue->CompletionHead);
+
+            if (NVME_CQE_COMMAND_ID(Status) != Command->CommandId || NVME_CQE_STATUS(Status) != 0)
+            {
+                DPRINT1("Admin command 0x%x failed, status 0x%lx\n", Command->Opcode, Status);
+                return FALSE;
+            }
+
+            return TRUE;
+        }
+
+        StorPortStallExecution(10);
+    }
+
+    DPRINT1("Admin command 0x%x timed out\n", Command->Opcode);
+    return FALSE;
+}
+
+static
+BOOLEAN
+NvmeIdentify(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ ULONG Type,
+    _In_ ULONG NamespaceId)
+{
+    NVME_COMMAND Command;
+
+    RtlZeroMemory(&Command, sizeof(Command));
+    Command.Opcode = NVME_ADMIN_IDENTIFY;
+    Command.NamespaceId = NamespaceId;
+    Command.Prp1 = Adapter->IdentifyBufferPhysical.QuadPart;
+    Command.Cdw10 = Type;
+
+    return NvmeExecuteAdminCommand(Adapter, &Command, NULL);
+}
+
+static
+BOOLEAN
+NvmeSetFeature(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ ULONG Feature,
+    _In_ ULONG Value,
+    _Out_opt_ PULONG Result)
+{
+    NVME_COMMAND Command;
+
+    RtlZeroMemory(&Command, sizeof(Command));
+    Command.Opcode = NVME_ADMIN_SET_FEATURES;
+    Command.Cdw10 = Feature;
+    Command.Cdw11 = Value;
+
+    return NvmeExecuteAdminCommand(Adapter, &Command, Result);
+}
+
+static
+BOOLEAN
+NvmeCreateIoQueue(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ PNVME_QUEUE Queue)
+{
+    NVME_COMMAND Command;
+
+    /* The completion queue goes first, the submission queue refers to it */
+    RtlZeroMemory(&Command, sizeof(Command));
+    Command.Opcode = NVME_ADMIN_CREATE_CQ;
+    Command.Prp1 = Queue->CompletionQueuePhysical.QuadPart;
+    Command.Cdw10 = Queue->QueueId | ((ULONG)(Queue->Entries - 1) << 16);
+    Command.Cdw11 = NVME_QUEUE_PHYS_CONTIGUOUS | NVME_CQ_IRQ_ENABLED;
+    if (!NvmeExecuteAdminCommand(Adapter, &Command, NULL))
+        return FALSE;
+
+    RtlZeroMemory(&Command, sizeof(Command));
+    Command.Opcode = NVME_ADMIN_CREATE_SQ;
+    Command.Prp1 = Queue->SubmissionQueuePhysical.QuadPart;
+    Command.Cdw10 = Queue->QueueId | ((ULONG)(Queue->Entries - 1) << 16);
+    Command.Cdw11 = NVME_QUEUE_PHYS_CONTIGUOUS | ((ULONG)Queue->QueueId << 16);
+    return NvmeExecuteAdminCommand(Adapter, &Command, NULL);
+}
+
+static
+BOOLEAN
+NvmeHwPassiveInitialize(
+    _In_ PVOID DeviceExtension)
+{
+    PNVME_ADAPTER_EXTENSION Adapter = DeviceExtension;
+    PNVME_IDENTIFY_CONTROLLER_DATA Controller;
+    PNVME_IDENTIFY_NAMESPACE_DATA Namespace;
+    PNVME_QUEUE AdminQueue = &Adapter->AdminQueue;
+    ULONG Config, Result, Allocated, i;
+
+    /* Disable the controller to get it into a known state */
+    Config = NvmeReadRegister(Adapter, NVME_REG_CC);
+    if (Config & NVME_CC_ENABLE)
+        NvmeWriteRegister(Adapter, NVME_REG_CC, Config & ~NVME_CC_ENABLE);
+
+    if (!NvmeWaitForReady(Adapter, FALSE))
+        return FALSE;
+
+    NvmeWriteRegister(Adapter, NVME_REG_INTMS, 0xFFFFFFFF);
+
+    /* Set up the admin queue pair and enable the controller */
+    NvmeWriteRegister(Adapter, NVME_REG_AQA, NVME_AQA(AdminQueue->Entries, AdminQueue->Entries));
+    NvmeWriteRegister(Adapter, NVME_REG_ASQ, AdminQueue->SubmissionQueuePhysical.LowPart);
+    NvmeWriteRegister(Adapter, NVME_REG_ASQ + 4, AdminQueue->SubmissionQueuePhysical.HighPart);
+    NvmeWriteRegister(Adapter, NVME_REG_ACQ, AdminQueue->CompletionQueuePhysical.LowPart);
+    NvmeWriteRegister(Adapter, NVME_REG_ACQ + 4, AdminQueue->CompletionQueuePhysical.HighPart);
+
+    Config = NVME_CC_ENABLE |
+             NVME_CC_CSS_NVM |
+             NVME_CC_MPS(PAGE_SHIFT) |
+             NVME_CC_AMS_RR |
+             NVME_CC_IOSQES(NVME_SQ_ENTRY_SHIFT) |
+             NVME_CC_IOCQES(NVME_CQ_ENTRY_SHIFT);
+    NvmeWriteRegister(Adapter, NVME_REG_CC, Config);
+
+    if (!NvmeWaitForReady(Adapter, TRUE))
+        return FALSE;
+
+    /* Identify the controller */
+    if (!NvmeIdentify(Adapter, NVME_IDENTIFY_CONTROLLER, 0))
+        return FALSE;
+
+    Controller = Adapter->IdentifyBuffer;
+    RtlCopyMemory(Adapter->ModelNumber, Controller->ModelNumber, sizeof(Adapter->ModelNumber));
+    RtlCopyMemory(Adapter->FirmwareRevision, Controller->FirmwareRevision, sizeof(Adapter->FirmwareRevision));
+    Adapter->VolatileWriteCache = (Controller->VolatileWriteCache & 1) != 0;
+
+    if (Controller->NumberOfNamespaces == 0)
+    {
+        DPRINT1("No namespaces\n");
+        return FALSE;
+    }
+
+    /* Only the first namespace is exposed */
+    if (!NvmeIdentify(Adapter, NVME_IDENTIFY_NAMESPACE, 1))
+        return FALSE;
+
+    Namespace = Adapter->IdentifyBuffer;
+    Adapter->BlockCount = Namespace->Size;
+    Adapter->BlockShift = Namespace->LbaFormat[Namespace->FormattedLbaSize & 0xF].DataSizeShift;
+    if (Adapter->BlockCount == 0 || Adapter->BlockShift < 9 || Adapter->BlockShift > PAGE_SHIFT)
+    {
+        DPRINT1("Unusable namespace, %I64u blocks of 2^%lu bytes\n", Adapter->BlockCount, Adapter->BlockShift);
+        return FALSE;
+    }
+
+    /* Ask for one queue pair per processor and take what the controller gives us */
+    if (!NvmeSetFeature(Adapter,
+                        NVME_FEATURE_NUMBER_OF_QUEUES,
+                        (Adapter->IoQueueCount - 1) | ((Adapter->IoQueueCount - 1) << 16),
+                        &Result))
+    {
+        return FALSE;
+    }
+
+    Allocated = min((Result & 0xFFFF), (Result >> 16)) + 1;
+    Adapter->IoQueueCount = min(Adapter->IoQueueCount, Allocated);
+
+    for (i = 0; i < Adapter->IoQueueCount; i++)
+    {
+        if (!NvmeCreateIoQueue(Adapter, &Adapter->IoQueues[i]))
+        {
+            if (i == 0)
+                return FALSE;
+
+            Adapter->IoQueueCount = i;
+            break;
+        }
+    }
+
+    /* Fewer interrupts at high queue depths, optional for the controller */
+    if (!NvmeSetFeature(Adapter,
+                        NVME_FEATURE_INTERRUPT_COALESCING,
+                        (NVME_COALESCING_THRESHOLD - 1) | (NVME_COALESCING_TIME << 8),
+                        NULL))
+    {
+        DPRINT1("Interrupt coalescing is not supported\n");
+    }
+
+    DPRINT1("NVMe %.40s: %I64u blocks of %lu bytes, %lu I/O queues of %u entries\n",
+            Adapter->ModelNumber, Adapter->BlockCount, 1UL << Adapter->BlockShift,
+            Adapter->IoQueueCount, Adapter->IoQueueEntries);
+
+    Adapter->Ready = TRUE;
+    NvmeWriteRegister(Adapter, NVME_REG_INTMC, 0xFFFFFFFF);
+
+    return TRUE;
+}
+
+static
+BOOLEAN
+NTAPI
+NvmeHwInitialize(
+    _In_ PVOID DeviceExtension)
+{
+    /* Bringing up the controller may take seconds, don't do it at DIRQL */
+    return StorPortEnablePassiveInitialization(DeviceExtension, NvmeHwPassiveInitialize);
+}
+
+static
+BOOLEAN
+NvmeProcessCompletions(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _Inout_ PNVME_QUEUE Queue)
+{
+    PSCSI_REQUEST_BLOCK Srb;
+    ULONG Status;
+    USHORT CommandId;
+    BOOLEAN Processed = FALSE;
+
+    while (NvmeNextCompletion(Queue, &Status, NULL))
+    {
+        Processed = TRUE;
+
+        CommandId = NVME_CQE_COMMAND_ID(Status);
+        if (CommandId >= Queue->Entries)
+        {
+            DPRINT1("Queue %u: invalid command id %u\n", Queue->QueueId, CommandId);
+            continue;
+        }
+
+        Srb = InterlockedExchangePointer((PVOID *)&Queue->Requests[CommandId], NULL);
+        if (!Srb)
+        {
+            DPRINT1("Queue %u: spurious completion for command id %u\n", Queue->QueueId, CommandId);
+            continue;
+        }
+
+        InterlockedDecrement(&Queue->Outstanding);
+
+        if (NVME_CQE_STATUS(Status) == 0)
+        {
+            Srb->SrbStatus = SRB_STATUS_SUCCESS;
+        }
+        else
+        {
+            DPRINT1("Queue %u: command %u failed, status 0x%lx\n", Queue->QueueId, CommandId, NVME_CQE_STATUS(Status));
+            Srb->SrbStatus = SRB_STATUS_ERROR;
+        }
+
+        StorPortNotification(RequestComplete, Adapter, Srb);
+    }
+
+    /* Give all the consumed entries back at once */
+    if (Processed)
+        StorPortWriteRegisterUlong(Adapter, Queue->CompletionDoorbell, Queue->CompletionHead);
+
+    return Processed;
+}
+
+static
+BOOLEAN
+NTAPI
+NvmeHwInterrupt(
+    _In_ PVOID DeviceExtension)
+{
+    PNVME_ADAPTER_EXTENSION Adapter = DeviceExtension;
+    BOOLEAN Handled = FALSE;
+    ULONG i;
+
+    /* Admin commands are polled, and the I/O queues don't exist yet */
+    if (!Adapter->Ready)
+        return FALSE;
+
+    /* All the queues share the line interrupt */
+    for (i = 0; i < Adapter->IoQueueCount; i++)
+    {
+        if (NvmeProcessCompletions(Adapter, &Adapter->IoQueues[i]))
+            Handled = TRUE;
+    }
+
+    return Handled;
+}
+
+static
+UCHAR
+NvmeSubmitIo(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb,
+    _Inout_ PNVME_COMMAND Command)
+{
+    KLOCK_QUEUE_HANDLE LockHandle;
+    PNVME_QUEUE Queue;
+    USHORT CommandId;
+
+    /* Every processor submits to its own queue, so the locks are hardly ever contended */
+    Queue = &Adapter->IoQueues[KeGetCurrentProcessorNumber() % Adapter->IoQueueCount];
+
+    KeAcquireInStackQueuedSpinLock(&Queue->SubmissionLock, &LockHandle);
+
+    /* One entry always stays free, so the submission queue can't overflow either */
+    if (Queue->Outstanding >= Queue->Entries - 1)
+    {
+        KeReleaseInStackQueuedSpinLock(&LockHandle);
+        return SRB_STATUS_BUSY;
+    }
+
+    /* The interrupt handler only ever clears slots, so this finds a free one */
+    CommandId = Queue->NextCommandId;
+    while (Queue->Requests[CommandId] != NULL)
+    {
+        CommandId = (CommandId + 1) % Queue->Entries;
+    }
+
+    Queue->NextCommandId = (CommandId + 1) % Queue->Entries;
+    Queue->Requests[CommandId] = Srb;
+    InterlockedIncrement(&Queue->Outstanding);
+
+    Command->CommandId = CommandId;
+    NvmeSubmitCommand(Adapter, Queue, Command);
+
+    KeReleaseInStackQueuedSpinLock(&LockHandle);
+
+    return SRB_STATUS_PENDING;
+}
+
+static
+PULONGLONG
+NvmeGetPrpList(
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    /* Aligned on its own size, the list can't cross a page boundary */
+    return (PULONGLONG)ALIGN_UP_POINTER_BY(Srb->SrbExtension, NVME_PRP_LIST_SIZE);
+}
+
+static
+BOOLEAN
+NvmeBuildPrp(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb,
+    _Inout_ PNVME_COMMAND Command)
+{
+    PSTOR_SCATTER_GATHER_LIST SgList;
+    PULONGLONG PrpList;
+    ULONGLONG Address, End;
+    ULONG Length, Chunk, Entries, i;
+    BOOLEAN First;
+
+    SgList = StorPortGetScatterGatherList(Adapter, Srb);
+    if (!SgList || SgList->NumberOfElements == 0)
+        return FALSE;
+
+    PrpList = NvmeGetPrpList(Srb);
+    Entries = 0;
+    End = 0;
+    First = TRUE;
+
+    /*
+     * The controller reads straight from the scatter/gather elements, one PRP
+     * entry per page. Only the first entry may have an offset into its page.
+     */
+    for (i = 0; i < SgList->NumberOfElements; i++)
+    {
+        Address = SgList->List[i].PhysicalAddress.QuadPart;
+        Length = SgList->List[i].Length;
+
+        while (Length != 0)
+        {
+            Chunk = min(Length, PAGE_SIZE - (ULONG)(Address & (PAGE_SIZE - 1)));
+
+            if (First)
+            {
+                Command->Prp1 = Address;
+                First = FALSE;
+            }
+            else
+            {
+                if ((Address & (PAGE_SIZE - 1)) != 0 || (End & (PAGE_SIZE - 1)) != 0)
+                {
+                    DPRINT1("Unaligned scatter/gather element %lu\n", i);
+                    return FALSE;
+                }
+
+                if (Entries == NVME_MAX_PRP_ENTRIES)
+                    return FALSE;
+
+                PrpList[Entries++] = Address;
+            }
+
+            Address += Chunk;
+            Length -= Chunk;
+            End = Address;
+        }
+    }
+
+    if (Entries == 1)
+    {
+        Command->Prp2 = PrpList[0];
+    }
+    else if (Entries > 1)
+    {
+        Command->Prp2 = StorPortGetPhysicalAddress(Adapter, Srb, PrpList, &Length).QuadPart;
+    }
+
+    return TRUE;
+}
+
+static
+UCHAR
+NvmeReadWrite(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb,
+    _In_ PCDB Cdb)
+{
+    NVME_COMMAND Command;
+    ULONGLONG Lba;
+    ULONG Blocks;
+    BOOLEAN Write, Fua;
+
+    switch (Cdb->CDB10.OperationCode)
+    {
+        case SCSIOP_READ6:
+        case SCSIOP_WRITE6:
+            Lba = ((ULONG)Cdb->CDB6READWRITE.LogicalBlockMsb1 << 16) |
+                  ((ULONG)Cdb->CDB6READWRITE.LogicalBlockMsb0 << 8) |
+                  Cdb->CDB6READWRITE.LogicalBlockLsb;
+            Blocks = Cdb->CDB6READWRITE.TransferBlocks ? Cdb->CDB6READWRITE.TransferBlocks : 256;
+            Write = (Cdb->CDB10.OperationCode == SCSIOP_WRITE6);
+            Fua = FALSE;
+            break;
+
+        case SCSIOP_READ:
+        case SCSIOP_WRITE:
+            Lba = ((ULONG)Cdb->CDB10.LogicalBlockByte0 << 24) |
+                  ((ULONG)Cdb->CDB10.LogicalBlockByte1 << 16) |
+                  ((ULONG)Cdb->CDB10.LogicalBlockByte2 << 8) |
+                  Cdb->CDB10.LogicalBlockByte3;
+            Blocks = ((ULONG)Cdb->CDB10.TransferBlocksMsb << 8) | Cdb->CDB10.TransferBlocksLsb;
+            Write = (Cdb->CDB10.OperationCode == SCSIOP_WRITE);
+            Fua = Cdb->CDB10.ForceUnitAccess;
+            break;
+
+        default:
+            REVERSE_BYTES_QUAD(&Lba, Cdb->CDB16.LogicalBlock);
+            REVERSE_BYTES(&Blocks, Cdb->CDB16.TransferLength);
+            Write = (Cdb->CDB16.OperationCode == SCSIOP_WRITE16);
+            Fua = Cdb->CDB16.ForceUnitAccess;
+            break;
+    }
+
+    if (Blocks == 0)
+        return SRB_STATUS_SUCCESS;
+
+    if (Lba >= Adapter->BlockCount || Blocks > Adapter->BlockCount - Lba)
+        return SRB_STATUS_INVALID_REQUEST;
+
+    if (Srb->DataTransferLength > NVME_MAX_TRANSFER_LENGTH ||
+        ((ULONGLONG)Blocks << Adapter->BlockShift) != Srb->DataTransferLength)
+    {
+        return SRB_STATUS_INVALID_REQUEST;
+    }
+
+    RtlZeroMemory(&Command, sizeof(Command));
+    Command.Opcode = Write ? NVME_CMD_WRITE : NVME_CMD_READ;
+    Command.NamespaceId = 1;
+    Command.Cdw10 = (ULONG)Lba;
+    Command.Cdw11 = (ULONG)(Lba >> 32);
+    Command.Cdw12 = (Blocks - 1) | (Fua ? NVME_RW_FUA : 0);
+
+    if (!NvmeBuildPrp(Adapter, Srb, &Command))
+        return SRB_STATUS_INVALID_REQUEST;
+
+    return NvmeSubmitIo(Adapter, Srb, &Command);
+}
+
+static
+UCHAR
+NvmeFlush(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    NVME_COMMAND Command;
+
+    /* Nothing to do without a volatile write cache */
+    if (!Adapter->VolatileWriteCache)
+        return SRB_STATUS_SUCCESS;
+
+    RtlZeroMemory(&Command, sizeof(Command));
+    Command.Opcode = NVME_CMD_FLUSH;
+    Command.NamespaceId = 1;
+
+    return NvmeSubmitIo(Adapter, Srb, &Command);
+}
+
+static
+VOID
+NvmeCopyResponse(
+    _Inout_ PSCSI_REQUEST_BLOCK Srb,
+    _In_reads_bytes_(Length) PVOID Data,
+    _In_ ULONG Length)
+{
+    Length = min(Length, Srb->DataTransferLength);
+    RtlCopyMemory(Srb->DataBuffer, Data, Length);
+    Srb->DataTransferLength = Length;
+}
+
+static
+UCHAR
+NvmeInquiry(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb,
+    _In_ PCDB Cdb)
+{
+    INQUIRYDATA InquiryData;
+    UCHAR SupportedPages[sizeof(VPD_SUPPORTED_PAGES_PAGE) + 1];
+    PVPD_SUPPORTED_PAGES_PAGE Pages;
+
+    if (Cdb->CDB6INQUIRY3.EnableVitalProductData)
+    {
+        if (Cdb->CDB6INQUIRY3.PageCode != VPD_SUPPORTED_PAGES)
+            return SRB_STATUS_INVALID_REQUEST;
+
+        RtlZeroMemory(SupportedPages, sizeof(SupportedPages));
+        Pages = (PVPD_SUPPORTED_PAGES_PAGE)SupportedPages;
+        Pages->DeviceType = DIRECT_ACCESS_DEVICE;
+        Pages->PageCode = VPD_SUPPORTED_PAGES;
+        Pages->PageLength = 1;
+        Pages->SupportedPageList[0] = VPD_SUPPORTED_PAGES;
+
+        NvmeCopyResponse(Srb, SupportedPages, sizeof(SupportedPages));
+        return SRB_STATUS_SUCCESS;
+    }
+
+    RtlZeroMemory(&InquiryData, sizeof(InquiryData));
+    InquiryData.DeviceType = DIRECT_ACCESS_DEVICE;
+    InquiryData.Versions = 5;
+    InquiryData.ResponseDataFormat = 2;
+    InquiryData.AdditionalLength = INQUIRYDATABUFFERSIZE - 5;
+    InquiryData.CommandQueue = 1;
+
+    /* The identify strings are space padded ASCII already */
+    RtlCopyMemory(InquiryData.VendorId, "NVMe    ", sizeof(InquiryData.VendorId));
+    RtlCopyMemory(InquiryData.ProductId, Adapter->ModelNumber, sizeof(InquiryData.ProductId));
+    RtlCopyMemory(InquiryData.ProductRevisionLevel, Adapter->FirmwareRevision, sizeof(InquiryData.ProductRevisionLevel));
+
+    NvmeCopyResponse(Srb, &InquiryData, INQUIRYDATABUFFERSIZE);
+    return SRB_STATUS_SUCCESS;
+}
+
+static
+UCHAR
+NvmeReadCapacity(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb,
+    _In_ PCDB Cdb)
+{
+    READ_CAPACITY_DATA Capacity;
+    READ_CAPACITY_DATA_EX CapacityEx;
+    ULONGLONG LastLba;
+    ULONG LastLba32, BlockSize;
+
+    LastLba = Adapter->BlockCount - 1;
+    BlockSize = 1UL << Adapter->BlockShift;
+
+    if (Cdb->CDB10.OperationCode == SCSIOP_READ_CAPACITY)
+    {
+        /* Too large for 32 bits, the class driver retries with READ CAPACITY (16) */
+        LastLba32 = (LastLba > MAXULONG) ? MAXULONG : (ULONG)LastLba;
+
+        REVERSE_BYTES(&Capacity.LogicalBlockAddress, &LastLba32);
+        REVERSE_BYTES(&Capacity.BytesPerBlock, &BlockSize);
+        NvmeCopyResponse(Srb, &Capacity, sizeof(Capacity));
+    }
+    else
+    {
+        if ((Cdb->AsByte[1] & 0x1F) != SERVICE_ACTION_READ_CAPACITY16)
+            return SRB_STATUS_INVALID_REQUEST;
+
+        /* The rest of the parameter data is reserved or zero for us */
+        RtlZeroMemory(Srb->DataBuffer, Srb->DataTransferLength);
+        REVERSE_BYTES_QUAD(&CapacityEx.LogicalBlockAddress, &LastLba);
+        REVERSE_BYTES(&CapacityEx.BytesPerBlock, &BlockSize);
+        NvmeCopyResponse(Srb, &CapacityEx, sizeof(CapacityEx));
+    }
+
+    return SRB_STATUS_SUCCESS;
+}
+
+static
+UCHAR
+NvmeModeSense(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb,
+    _In_ PCDB Cdb)
+{
+    MODE_PARAMETER_HEADER Header;
+    MODE_PARAMETER_HEADER10 Header10;
+
+    UNREFERENCED_PARAMETER(Adapter);
+
+    /* No mode pages, just report FUA support */
+    if (Cdb->CDB10.OperationCode == SCSIOP_MODE_SENSE)
+    {
+        RtlZeroMemory(&Header, sizeof(Header));
+        Header.ModeDataLength = sizeof(Header) - 1;
+        Header.DeviceSpecificParameter = MODE_DSP_FUA_SUPPORTED;
+        NvmeCopyResponse(Srb, &Header, sizeof(Header));
+    }
+    else
+    {
+        RtlZeroMemory(&Header10, sizeof(Header10));
+        Header10.ModeDataLength[1] = sizeof(Header10) - 2;
+        Header10.DeviceSpecificParameter = MODE_DSP_FUA_SUPPORTED;
+        NvmeCopyResponse(Srb, &Header10, sizeof(Header10));
+    }
+
+    return SRB_STATUS_SUCCESS;
+}
+
+static
+UCHAR
+NvmeReportLuns(
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    UCHAR Data[sizeof(LUN_LIST) + 8];
+    PLUN_LIST LunList = (PLUN_LIST)Data;
+
+    /* A single LUN 0 */
+    RtlZeroMemory(Data, sizeof(Data));
+    LunList->LunListLength[3] = 8;
+
+    NvmeCopyResponse(Srb, Data, sizeof(Data));
+    return SRB_STATUS_SUCCESS;
+}
+
+static
+UCHAR
+NvmeExecuteScsi(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    PCDB Cdb = (PCDB)Srb->Cdb;
+
+    switch (Cdb->CDB10.OperationCode)
+    {
+        case SCSIOP_READ6:
+        case SCSIOP_WRITE6:
+        case SCSIOP_READ:
+        case SCSIOP_WRITE:
+        case SCSIOP_READ16:
+        case SCSIOP_WRITE16:
+            return NvmeReadWrite(Adapter, Srb, Cdb);
+
+        case SCSIOP_SYNCHRONIZE_CACHE:
+        case SCSIOP_SYNCHRONIZE_CACHE16:
+            return NvmeFlush(Adapter, Srb);
+
+        case SCSIOP_INQUIRY:
+            return NvmeInquiry(Adapter, Srb, Cdb);
+
+        case SCSIOP_READ_CAPACITY:
+        case SCSIOP_READ_CAPACITY16:
+            return NvmeReadCapacity(Adapter, Srb, Cdb);
+
+        case SCSIOP_MODE_SENSE:
+        case SCSIOP_MODE_SENSE10:
+            return NvmeModeSense(Adapter, Srb, Cdb);
+
+        case SCSIOP_REPORT_LUNS:
+            return NvmeReportLuns(Srb);
+
+        case SCSIOP_TEST_UNIT_READY:
+        case SCSIOP_START_STOP_UNIT:
+            return SRB_STATUS_SUCCESS;
+
+        default:
+            DPRINT("Unsupported SCSI operation 0x%x\n", Cdb->CDB10.OperationCode);
+            return SRB_STATUS_INVALID_REQUEST;
+    }
+}
+
+static
+BOOLEAN
+NTAPI
+NvmeHwStartIo(
+    _In_ PVOID DeviceExtension,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    PNVME_ADAPTER_EXTENSION Adapter = DeviceExtension;
+    UCHAR SrbStatus;
+
+    if (!Adapter->Ready || Srb->PathId != 0 || Srb->TargetId != 0 || Srb->Lun != 0)
+    {
+        SrbStatus = SRB_STATUS_NO_DEVICE;
+    }
+    else
+    {
+        switch (Srb->Function)
+        {
+            case SRB_FUNCTION_EXECUTE_SCSI:
+                SrbStatus = NvmeExecuteScsi(Adapter, Srb);
+                break;
+
+            case SRB_FUNCTION_FLUSH:
+            case SRB_FUNCTION_SHUTDOWN:
+                SrbStatus = NvmeFlush(Adapter, Srb);
+                break;
+
+            case SRB_FUNCTION_RESET_BUS:
+            case SRB_FUNCTION_RESET_DEVICE:
+            case SRB_FUNCTION_RESET_LOGICAL_UNIT:
+                SrbStatus = SRB_STATUS_SUCCESS;
+                break;
+
+            default:
+                SrbStatus = SRB_STATUS_INVALID_REQUEST;
+                break;
+        }
+    }
+
+    /* Requests sent to the controller are completed by the interrupt handler */
+    if (SrbStatus != SRB_STATUS_PENDING)
+    {
+        Srb->SrbStatus = SrbStatus;
+        StorPortNotification(RequestComplete, Adapter, Srb);
+    }
+
+    return TRUE;
+}
+
+static
+BOOLEAN
+NTAPI
+NvmeHwResetBus(
+    _In_ PVOID DeviceExtension,
+    _In_ ULONG PathId)
+{
+    UNREFERENCED_PARAMETER(DeviceExtension);
+    UNREFERENCED_PARAMETER(PathId);
+
+    /* Commands in flight can't be aborted, they complete on their own */
+    return TRUE;
+}
+
+static
+BOOLEAN
+NvmeAllocateQueues(
+    _In_ PNVME_ADAPTER_EXTENSION Adapter,
+    _In_ PPORT_CONFIGURATION_INFORMATION ConfigInfo)
+{
+    ULONG SubmissionSize, CompletionSize, AdminEntries, i;
+    PUCHAR Buffer;
+
+    AdminEntries = min(NVME_ADMIN_QUEUE_ENTRIES, NVME_CAP_MQES(Adapter->Capabilities) + 1);
+    SubmissionSize = ROUND_TO_PAGES(Adapter->IoQueueEntries * sizeof(NVME_COMMAND));
+    CompletionSize = ROUND_TO_PAGES(Adapter->IoQueueEntries * sizeof(NVME_COMPLETION));
+
+    /* Admin queue pair and identify buffer, then the I/O queue pairs, all page aligned */
+    Adapter->UncachedExtensionSize = 3 * PAGE_SIZE + Adapter->IoQueueCount * (SubmissionSize + CompletionSize);
+    Adapter->UncachedExtension = StorPortGetUncachedExtension(Adapter, ConfigInfo, Adapter->UncachedExtensionSize);
+    if (!Adapter->UncachedExtension)
+    {
+        DPRINT1("Failed to allocate %lu bytes for the queues\n", Adapter->UncachedExtensionSize);
+        return FALSE;
+    }
+
+    if (((ULONG_PTR)Adapter->UncachedExtension & (PAGE_SIZE - 1)) != 0)
+    {
+        DPRINT1("Queue memory %p is not page aligned\n", Adapter->UncachedExtension);
+        return FALSE;
+    }
+
+    Buffer = Adapter->UncachedExtension;
+    RtlZeroMemory(Buffer, Adapter->UncachedExtensionSize);
+
+    NvmeInitializeQueue(Adapter, &Adapter->AdminQueue, 0, (USHORT)AdminEntries, Buffer, Buffer + PAGE_SIZE);
+    Buffer += 2 * PAGE_SIZE;
+
+    Adapter->IdentifyBuffer = Buffer;
+    Adapter->IdentifyBufferPhysical = StorPortGetPhysicalAddress(Adapter, NULL, Buffer, &i);
+    Buffer += PAGE_SIZE;
+
+    for (i = 0; i < Adapter->IoQueueCount; i++)
+    {
+        NvmeInitializeQueue(Adapter,
+                            &Adapter->IoQueues[i],
+                            (USHORT)(i + 1),
+                            Adapter->IoQueueEntries,
+                            Buffer,
+                            Buffer + SubmissionSize);
+        Buffer += SubmissionSize + CompletionSize;
+    }
+
+    return TRUE;
+}
+
+static
+ULONG
+NTAPI
+NvmeHwFindAdapter(
+    _In_ PVOID DeviceExtension,
+    _In_ PVOID HwContext,
+    _In_ PVOID BusInformation,
+    _In_ PCHAR ArgumentString,
+    _Inout_ PPORT_CONFIGURATION_INFORMATION ConfigInfo,
+    _Out_ PBOOLEAN Again)
+{
+    PNVME_ADAPTER_EXTENSION Adapter = DeviceExtension;
+    PACCESS_RANGE AccessRange;
+    ULONG MaxQueues, i;
+
+    UNREFERENCED_PARAMETER(HwContext);
+    UNREFERENCED_PARAMETER(BusInformation);
+    UNREFERENCED_PARAMETER(ArgumentString);
+    UNREFERENCED_PARAMETER(Again);
+
+    /* The registers are in the first memory BAR */
+    for (i = 0; i < ConfigInfo->NumberOfAccessRanges; i++)
+    {
+        AccessRange = &(*ConfigInfo->AccessRanges)[i];
+        if (AccessRange->RangeInMemory && AccessRange->RangeLength > NVME_REG_DOORBELL)
+        {
+            Adapter->Registers = StorPortGetDeviceBase(Adapter,
+                                                       ConfigInfo->AdapterInterfaceType,
+                                                       ConfigInfo->SystemIoBusNumber,
+                                                       AccessRange->RangeStart,
+                                                       AccessRange->RangeLength,
+                                                       FALSE);
+            Adapter->RegistersLength = AccessRange->RangeLength;
+            break;
+        }
+    }
+
+    if (!Adapter->Registers)
+    {
+        DPRINT1("No register space\n");
+        return SP_RETURN_NOT_FOUND;
+    }
+
+    Adapter->Capabilities = NvmeReadRegister(Adapter, NVME_REG_CAP) |
+                            ((ULONGLONG)NvmeReadRegister(Adapter, NVME_REG_CAP + 4) << 32);
+
+    DPRINT1("NVMe version 0x%lx, capabilities 0x%I64x\n",
+            NvmeReadRegister(Adapter, NVME_REG_VS), Adapter->Capabilities);
+
+    /* The queues are made of system pages */
+    if (NVME_CAP_MPSMIN(Adapter->Capabilities) > PAGE_SHIFT - 12)
+    {
+        DPRINT1("Page size not supported\n");
+        return SP_RETURN_NOT_FOUND;
+    }
+
+    Adapter->DoorbellStride = 4 << NVME_CAP_DSTRD(Adapter->Capabilities);
+    Adapter->TimeoutMs = max(NVME_CAP_TO(Adapter->Capabilities), 1) * 500;
+
+    /* One queue pair per processor, as far as the doorbells go */
+    MaxQueues = (Adapter->RegistersLength - NVME_REG_DOORBELL) / (2 * Adapter->DoorbellStride);
+    if (MaxQueues < 2)
+        return SP_RETURN_NOT_FOUND;
+
+    Adapter->IoQueueCount = min((ULONG)KeNumberProcessors, min(MaxQueues - 1, NVME_MAX_IO_QUEUES));
+    Adapter->IoQueueEntries = (USHORT)min(NVME_IO_QUEUE_ENTRIES, NVME_CAP_MQES(Adapter->Capabilities) + 1);
+
+    ConfigInfo->Master = TRUE;
+    ConfigInfo->AlignmentMask = 0x3;
+    ConfigInfo->ScatterGather = TRUE;
+    ConfigInfo->Dma32BitAddresses = TRUE;
+    ConfigInfo->Dma64BitAddresses = TRUE;
+    ConfigInfo->WmiDataProvider = FALSE;
+    ConfigInfo->NumberOfBuses = 1;
+    ConfigInfo->MaximumNumberOfTargets = 1;
+    ConfigInfo->MaximumNumberOfLogicalUnits = 1;
+    ConfigInfo->MaximumTransferLength = NVME_MAX_TRANSFER_LENGTH;
+    ConfigInfo->NumberOfPhysicalBreaks = NVME_MAX_PRP_ENTRIES + 1;
+    ConfigInfo->SynchronizationModel = StorSynchronizeFullDuplex;
+
+    if (!NvmeAllocateQueues(Adapter, ConfigInfo))
+        return SP_RETURN_ERROR;
+
+    return SP_RETURN_FOUND;
+}
+
+ULONG
+NTAPI
+DriverEntry(
+    _In_ PVOID DriverObject,
+    _In_ PVOID RegistryPath)
+{
+    HW_INITIALIZATION_DATA InitData;
+
+    RtlZeroMemory(&InitData, sizeof(InitData));
+    InitData.HwInitializationDataSize = sizeof(HW_INITIALIZATION_DATA);
+
+    InitData.HwInitialize = NvmeHwInitialize;
+    InitData.HwStartIo = NvmeHwStartIo;
+    InitData.HwInterrupt = NvmeHwInterrupt;
+    InitData.HwFindAdapter = NvmeHwFindAdapter;
+    InitData.HwResetBus = NvmeHwResetBus;
+
+    InitData.AdapterInterfaceType = PCIBus;
+    InitData.NumberOfAccessRanges = 6;
+    InitData.MapBuffers = STOR_MAP_NON_READ_WRITE_BUFFERS;
+    InitData.TaggedQueuing = TRUE;
+    InitData.AutoRequestSense = TRUE;
+    InitData.MultipleRequestPerLu = TRUE;
+    InitData.NeedPhysicalAddresses = TRUE;
+
+    InitData.DeviceExtensionSize = sizeof(NVME_ADAPTER_EXTENSION);
+    InitData.SrbExtensionSize = sizeof(NVME_SRB_EXTENSION);
+
+    return StorPortInitialize(DriverObject, RegistryPath, &InitData, NULL);
+}
+
+/* EOF */
@@ -0,0 +1,235 @@
+/*
+ * PROJECT:     ReactOS Storport NVMe Miniport Driver
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     NVMe controller definitions
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#pragma once
+
+#include <ntddk.h>
+#include <storport.h>
+
+#if defined(_MSC_VER)
+#pragma warning(disable:4201) // nameless struct/union
+#endif
+
+/* Driver limits */
+#define NVME_MAX_IO_QUEUES              16
+#define NVME_ADMIN_QUEUE_ENTRIES        32
+#define NVME_IO_QUEUE_ENTRIES           256
+#define NVME_MAX_TRANSFER_LENGTH        (128 * 1024)
+#define NVME_MAX_PRP_ENTRIES            (NVME_MAX_TRANSFER_LENGTH / PAGE_SIZE)
+#define NVME_ADMIN_TIMEOUT_MS           5000
+
+/* Interrupt coalescing: up to 8 completions or 100 us, whichever comes first */
+#define NVME_COALESCING_THRESHOLD       8
+#define NVME_COALESCING_TIME            1
+
+/* Controller registers */
+#define NVME_REG_CAP                    0x00
+#define NVME_REG_VS                     0x08
+#define NVME_REG_INTMS                  0x0C
+#define NVME_REG_INTMC                  0x10
+#define NVME_REG_CC                     0x14
+#define NVME_REG_CSTS                   0x1C
+#define NVME_REG_AQA                    0x24
+#define NVME_REG_ASQ                    0x28
+#define NVME_REG_ACQ                    0x30
+#define NVME_REG_DOORBELL               0x1000
+
+#define NVME_CAP_MQES(Cap)              ((ULONG)((Cap) & 0xFFFF))
+#define NVME_CAP_TO(Cap)                ((ULONG)(((Cap) >> 24) & 0xFF))
+#define NVME_CAP_DSTRD(Cap)             ((ULONG)(((Cap) >> 32) & 0xF))
+#define NVME_CAP_MPSMIN(Cap)            ((ULONG)(((Cap) >> 48) & 0xF))
+
+#define NVME_CC_ENABLE                  (1 << 0)
+#define NVME_CC_CSS_NVM                 (0 << 4)
+#define NVME_CC_MPS(Shift)              (((Shift) - 12) << 7)
+#define NVME_CC_AMS_RR                  (0 << 11)
+#define NVME_CC_SHN_NORMAL              (1 << 14)
+#define NVME_CC_SHN_MASK                (3 << 14)
+#define NVME_CC_IOSQES(Shift)           ((Shift) << 16)
+#define NVME_CC_IOCQES(Shift)           ((Shift) << 20)
+
+#define NVME_CSTS_RDY                   (1 << 0)
+#define NVME_CSTS_CFS                   (1 << 1)
+
+#define NVME_AQA(SqEntries, CqEntries)  (((SqEntries) - 1) | (((CqEntries) - 1) << 16))
+
+/* Admin commands */
+#define NVME_ADMIN_CREATE_SQ            0x01
+#define NVME_ADMIN_CREATE_CQ            0x05
+#define NVME_ADMIN_IDENTIFY             0x06
+#define NVME_ADMIN_SET_FEATURES         0x09
+
+/* NVM commands */
+#define NVME_CMD_FLUSH                  0x00
+#define NVME_CMD_WRITE                  0x01
+#define NVME_CMD_READ                   0x02
+
+#define NVME_IDENTIFY_NAMESPACE         0
+#define NVME_IDENTIFY_CONTROLLER        1
+
+#define NVME_FEATURE_NUMBER_OF_QUEUES   0x07
+#define NVME_FEATURE_INTERRUPT_COALESCING 0x08
+
+#define NVME_QUEUE_PHYS_CONTIGUOUS      (1 << 0)
+#define NVME_CQ_IRQ_ENABLED             (1 << 1)
+
+#define NVME_RW_FUA                     (1 << 30)
+
+/* Completion queue entry status field */
+#define NVME_CQE_PHASE_BIT              0x10000
+#define NVME_CQE_PHASE(Dw3)             ((Dw3) & NVME_CQE_PHASE_BIT)
+#define NVME_CQE_STATUS(Dw3)            (((Dw3) >> 17) & 0x7FFF)
+#define NVME_CQE_COMMAND_ID(Dw3)        ((USHORT)((Dw3) & 0xFFFF))
+
+#define NVME_SQ_ENTRY_SHIFT             6
+#define NVME_CQ_ENTRY_SHIFT             4
+
+#include <pshpack1.h>
+
+typedef struct _NVME_COMMAND
+{
+    UCHAR Opcode;
+    UCHAR Flags;
+    USHORT CommandId;
+    ULONG NamespaceId;
+    ULONG Reserved[2];
+    ULONGLONG MetadataPointer;
+    ULONGLONG Prp1;
+    ULONGLONG Prp2;
+    ULONG Cdw10;
+    ULONG Cdw11;
+    ULONG Cdw12;
+    ULONG Cdw13;
+    ULONG Cdw14;
+    ULONG Cdw15;
+} NVME_COMMAND, *PNVME_COMMAND;
+C_ASSERT(sizeof(NVME_COMMAND) == (1 << NVME_SQ_ENTRY_SHIFT));
+
+typedef struct _NVME_COMPLETION
+{
+    ULONG Result;
+    ULONG Reserved;
+    USHORT SubmissionQueueHead;
+    USHORT SubmissionQueueId;
+    ULONG Status;
+} NVME_COMPLETION, *PNVME_COMPLETION;
+C_ASSERT(sizeof(NVME_COMPLETION) == (1 << NVME_CQ_ENTRY_SHIFT));
+
+typedef struct _NVME_LBA_FORMAT
+{
+    USHORT MetadataSize;
+    UCHAR DataSizeShift;
+    UCHAR RelativePerformance;
+} NVME_LBA_FORMAT, *PNVME_LBA_FORMAT;
+
+typedef struct _NVME_IDENTIFY_CONTROLLER_DATA
+{
+    USHORT VendorId;
+    USHORT SubsystemVendorId;
+    UCHAR SerialNumber[20];
+    UCHAR ModelNumber[40];
+    UCHAR FirmwareRevision[8];
+    UCHAR ArbitrationBurst;
+    UCHAR IeeeOui[3];
+    UCHAR Cmic;
+    UCHAR MaximumTransferSize;
+    USHORT ControllerId;
+    UCHAR Reserved1[436];
+    ULONG NumberOfNamespaces;
+    USHORT OptionalCommands;
+    USHORT FusedOperations;
+    UCHAR FormatAttributes;
+    UCHAR VolatileWriteCache;
+    UCHAR Reserved2[3570];
+} NVME_IDENTIFY_CONTROLLER_DATA, *PNVME_IDENTIFY_CONTROLLER_DATA;
+C_ASSERT(FIELD_OFFSET(NVME_IDENTIFY_CONTROLLER_DATA, ModelNumber) == 24);
+C_ASSERT(FIELD_OFFSET(NVME_IDENTIFY_CONTROLLER_DATA, MaximumTransferSize) == 77);
+C_ASSERT(FIELD_OFFSET(NVME_IDENTIFY_CONTROLLER_DATA, NumberOfNamespaces) == 516);
+C_ASSERT(FIELD_OFFSET(NVME_IDENTIFY_CONTROLLER_DATA, VolatileWriteCache) == 525);
+C_ASSERT(sizeof(NVME_IDENTIFY_CONTROLLER_DATA) == PAGE_SIZE);
+
+typedef struct _NVME_IDENTIFY_NAMESPACE_DATA
+{
+    ULONGLONG Size;
+    ULONGLONG Capacity;
+    ULONGLONG Utilization;
+    UCHAR Features;
+    UCHAR NumberOfLbaFormats;
+    UCHAR FormattedLbaSize;
+    UCHAR Reserved1[101];
+    NVME_LBA_FORMAT LbaFormat[16];
+    UCHAR Reserved2[3904];
+} NVME_IDENTIFY_NAMESPACE_DATA, *PNVME_IDENTIFY_NAMESPACE_DATA;
+C_ASSERT(FIELD_OFFSET(NVME_IDENTIFY_NAMESPACE_DATA, FormattedLbaSize) == 26);
+C_ASSERT(FIELD_OFFSET(NVME_IDENTIFY_NAMESPACE_DATA, LbaFormat) == 128);
+C_ASSERT(sizeof(NVME_IDENTIFY_NAMESPACE_DATA) == PAGE_SIZE);
+
+#include <poppack.h>
+
+/* A submission/completion queue pair */
+typedef struct _NVME_QUEUE
+{
+    PNVME_COMMAND SubmissionQueue;
+    PNVME_COMPLETION CompletionQueue;
+    STOR_PHYSICAL_ADDRESS SubmissionQueuePhysical;
+    STOR_PHYSICAL_ADDRESS CompletionQueuePhysical;
+    PULONG SubmissionDoorbell;
+    PULONG CompletionDoorbell;
+    USHORT QueueId;
+    USHORT Entries;
+    USHORT SubmissionTail;
+    USHORT CompletionHead;
+    ULONG Phase; /* NVME_CQE_PHASE_BIT or 0 */
+
+    /* Protects SubmissionTail and the command id allocation */
+    KSPIN_LOCK SubmissionLock;
+    USHORT NextCommandId;
+    LONG Outstanding;
+
+    /* Requests in flight, indexed by command id */
+    PSCSI_REQUEST_BLOCK Requests[NVME_IO_QUEUE_ENTRIES];
+} NVME_QUEUE, *PNVME_QUEUE;
+
+typedef struct _NVME_ADAPTER_EXTENSION
+{
+    PUCHAR Registers;
+    ULONG RegistersLength;
+    ULONGLONG Capabilities;
+    ULONG DoorbellStride;
+    ULONG TimeoutMs;
+    volatile BOOLEAN Ready;
+
+    PVOID UncachedExtension;
+    ULONG UncachedExtensionSize;
+
+    /* Shared by the identify commands during initialization */
+    PVOID IdentifyBuffer;
+    STOR_PHYSICAL_ADDRESS IdentifyBufferPhysical;
+
+    UCHAR ModelNumber[40];
+    UCHAR FirmwareRevision[8];
+    BOOLEAN VolatileWriteCache;
+
+    /* Namespace 1 */
+    ULONGLONG BlockCount;
+    ULONG BlockShift;
+
+    NVME_QUEUE AdminQueue;
+    USHORT AdminCommandId;
+
+    ULONG IoQueueCount;
+    USHORT IoQueueEntries;
+    NVME_QUEUE IoQueues[NVME_MAX_IO_QUEUES];
+} NVME_ADAPTER_EXTENSION, *PNVME_ADAPTER_EXTENSION;
+
+/* The PRP list must not cross a page, so it is kept aligned on its own size */
+#define NVME_PRP_LIST_SIZE (NVME_MAX_PRP_ENTRIES * sizeof(ULONGLONG))
+
+typedef struct _NVME_SRB_EXTENSION
+{
+    UCHAR Buffer[NVME_PRP_LIST_SIZE * 2];
+} NVME_SRB_EXTENSION, *PNVME_SRB_EXTENSION;
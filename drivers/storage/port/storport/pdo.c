@@ -69,6 +69,7 @@ PortCreatePdo(
     DeviceExtension->Bus = Bus;
     DeviceExtension->Target = Target;
     DeviceExtension->Lun = Lun;
+    DeviceExtension->QueueDepth = 1;
 
 
     // FIXME: More initialization
@@ -115,6 +116,40 @@ PortDeletePdo(
 }
 
 
+PPDO_DEVICE_EXTENSION
+PortFindPdo(
+    _In_ PFDO_DEVICE_EXTENSION FdoExtension,
+    _In_ ULONG Bus,
+    _In_ ULONG Target,
+    _In_ ULONG Lun)
+{
+    PPDO_DEVICE_EXTENSION PdoExtension, Found = NULL;
+    KLOCK_QUEUE_HANDLE LockHandle;
+    PLIST_ENTRY Entry;
+
+    KeAcquireInStackQueuedSpinLock(&FdoExtension->PdoListLock,
+                                   &LockHandle);
+
+    for (Entry = FdoExtension->PdoListHead.Flink;
+         Entry != &FdoExtension->PdoListHead;
+         Entry = Entry->Flink)
+    {
+        PdoExtension = CONTAINING_RECORD(Entry, PDO_DEVICE_EXTENSION, PdoListEntry);
+        if (PdoExtension->Bus == Bus &&
+            PdoExtension->Target == Target &&
+            PdoExtension->Lun == Lun)
+        {
+            Found = PdoExtension;
+            break;
+        }
+    }
+
+    KeReleaseInStackQueuedSpinLock(&LockHandle);
+
+    return Found;
+}
+
+
 NTSTATUS
 NTAPI
 PortPdoScsi(
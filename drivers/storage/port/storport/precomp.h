@@ -131,6 +131,7 @@ typedef struct _PDO_DEVICE_EXTENSION
     ULONG Target;
     ULONG Lun;
     PINQUIRYDATA InquiryBuffer;
+    ULONG QueueDepth;   /* From StorPortSetDeviceQueueDepth(), not enforced yet */
 
 
 } PDO_DEVICE_EXTENSION, *PPDO_DEVICE_EXTENSION;
@@ -243,6 +244,13 @@ NTSTATUS
 PortDeletePdo(
     _In_ PPDO_DEVICE_EXTENSION PdoExtension);
 
+PPDO_DEVICE_EXTENSION
+PortFindPdo(
+    _In_ PFDO_DEVICE_EXTENSION FdoExtension,
+    _In_ ULONG Bus,
+    _In_ ULONG Target,
+    _In_ ULONG Lun);
+
 NTSTATUS
 NTAPI
 PortPdoScsi(
@@ -1102,6 +1102,8 @@ StorPortNotification(
     PBOOLEAN Result;
     PSTOR_DPC Dpc;
     PHW_DPC_ROUTINE HwDpcRoutine;
+    PVOID SystemArgument1, SystemArgument2;
+    PLONG DpcResult;
     va_list ap;
 
     STOR_SPINLOCK SpinLock;
@@ -1169,12 +1171,26 @@ StorPortNotification(
             HwDpcRoutine = (PHW_DPC_ROUTINE)va_arg(ap, PHW_DPC_ROUTINE);
             DPRINT1("HwDpcRoutine %p\n", HwDpcRoutine);
 
+            /* The miniport routine gets its own extension as the context */
             KeInitializeDpc((PRKDPC)&Dpc->Dpc,
                             (PKDEFERRED_ROUTINE)HwDpcRoutine,
-                            (PVOID)DeviceExtension);
+                            HwDeviceExtension);
             KeInitializeSpinLock(&Dpc->Lock);
             break;
 
+        case IssueDpc:
+            DPRINT1("IssueDpc\n");
+            Dpc = (PSTOR_DPC)va_arg(ap, PSTOR_DPC);
+            SystemArgument1 = (PVOID)va_arg(ap, PVOID);
+            SystemArgument2 = (PVOID)va_arg(ap, PVOID);
+            DpcResult = (PLONG)va_arg(ap, PLONG);
+            DPRINT1("Dpc %p\n", Dpc);
+
+            *DpcResult = KeInsertQueueDpc((PRKDPC)&Dpc->Dpc,
+                                          SystemArgument1,
+                                          SystemArgument2);
+            break;
+
         case AcquireSpinLock:
             DPRINT1("AcquireSpinLock\n");
             SpinLock = (STOR_SPINLOCK)va_arg(ap, STOR_SPINLOCK);
@@ -1390,7 +1406,7 @@ StorPortSetBusDataByOffset(
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 BOOLEAN
@@ -1402,9 +1418,35 @@ StorPortSetDeviceQueueDepth(
     _In_ UCHAR Lun,
     _In_ ULONG Depth)
 {
-    DPRINT1("StorPortSetDeviceQueueDepth()\n");
-    UNIMPLEMENTED;
-    return FALSE;
+    PMINIPORT_DEVICE_EXTENSION MiniportExtension;
+    PPDO_DEVICE_EXTENSION PdoExtension;
+
+    DPRINT1("StorPortSetDeviceQueueDepth(%p %u %u %u %lu)\n",
+            HwDeviceExtension, PathId, TargetId, Lun, Depth);
+
+    if (Depth == 0)
+        return FALSE;
+
+    MiniportExtension = CONTAINING_RECORD(HwDeviceExtension,
+                                          MINIPORT_DEVICE_EXTENSION,
+                                          HwDeviceExtension);
+
+    PdoExtension = PortFindPdo(MiniportExtension->Miniport->DeviceExtension,
+                               PathId,
+                               TargetId,
+                               Lun);
+    if (PdoExtension == NULL)
+        return FALSE;
+
+    /*
+     * Number of requests the unit accepts at the same time. It is only
+     * recorded: PortPdoScsi() doesn't pass requests to the miniport yet,
+     * so there is no per-unit queue to enforce it on. Miniports have to
+     * keep to their own limit (storahci does, through its free slot mask).
+     */
+    PdoExtension->QueueDepth = Depth;
+
+    return TRUE;
 }
 
 
@@ -0,0 +1,796 @@
+/*
+ * PROJECT:     ReactOS VirtIO Block Storport Miniport Driver
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     virtio-blk queues and SCSI translation
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+/* INCLUDES *******************************************************************/
+
+#include "viostor.h"
+
+#define NDEBUG
+#include <debug.h>
+
+/* Not in storport.h */
+#define MODE_DSP_WRITE_PROTECT          0x80
+#define MODE_DSP_FUA_SUPPORTED          0x10
+#define SERVICE_ACTION_READ_CAPACITY16  0x10
+
+/*
+ * FIXME: storport doesn't pass SRBs down yet (PortPdoScsi is a stub), so
+ * HwStartIo is never reached and the driver is untested on ReactOS.
+ */
+
+/* FUNCTIONS ******************************************************************/
+
+static
+PVIOSTOR_REQUEST
+VioStorGetRequest(
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    /* Aligned on its own size, the request can't cross a page boundary */
+    return (PVIOSTOR_REQUEST)ALIGN_UP_POINTER_BY(Srb->SrbExtension, VIOSTOR_REQUEST_ALIGNMENT);
+}
+
+static
+UCHAR
+VioStorSubmitRequest(
+    _In_ PVIOSTOR_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb,
+    _In_ ULONG Type,
+    _In_ ULONGLONG Sector)
+{
+    struct VirtIOBufferDescriptor Sg[VIOSTOR_MAX_SG + 2];
+    PSTOR_SCATTER_GATHER_LIST SgList = NULL;
+    PVIOSTOR_REQUEST Request;
+    KLOCK_QUEUE_HANDLE LockHandle;
+    struct virtqueue *VirtQueue;
+    ULONG Queue, Elements, Length, i;
+    PVOID Indirect;
+    BOOLEAN Notify;
+    int Result;
+
+    Request = VioStorGetRequest(Srb);
+    Request->Srb = Srb;
+    Request->Status = VIRTIO_BLK_S_IOERR;
+    Request->Header.Type = Type;
+    Request->Header.IoPriority = 0;
+    Request->Header.Sector = Sector;
+
+    Elements = 0;
+    if (Type != VIRTIO_BLK_T_FLUSH)
+    {
+        SgList = StorPortGetScatterGatherList(Adapter, Srb);
+        if (!SgList || SgList->NumberOfElements == 0 || SgList->NumberOfElements > Adapter->MaxSegments)
+            return SRB_STATUS_INVALID_REQUEST;
+
+        Elements = SgList->NumberOfElements;
+    }
+
+    /* Header first, then the data, and the status byte the device writes last */
+    Sg[0].physAddr = StorPortGetPhysicalAddress(Adapter, Srb, &Request->Header, &Length);
+    Sg[0].length = sizeof(Request->Header);
+
+    for (i = 0; i < Elements; i++)
+    {
+        Sg[i + 1].physAddr = SgList->List[i].PhysicalAddress;
+        Sg[i + 1].length = SgList->List[i].Length;
+    }
+
+    Sg[Elements + 1].physAddr = StorPortGetPhysicalAddress(Adapter, Srb, &Request->Status, &Length);
+    Sg[Elements + 1].length = sizeof(Request->Status);
+
+    /* A whole request takes a single ring slot with indirect descriptors */
+    Indirect = NULL;
+    if (virtio_is_feature_enabled(Adapter->Features, VIRTIO_RING_F_INDIRECT_DESC))
+        Indirect = Request->IndirectTable;
+
+    /* Every processor submits to its own queue */
+    Queue = KeGetCurrentProcessorNumber() % Adapter->QueueCount;
+    VirtQueue = Adapter->VirtQueues[Queue];
+
+    KeAcquireInStackQueuedSpinLock(&Adapter->QueueLocks[Queue], &LockHandle);
+
+    if (Type == VIRTIO_BLK_T_OUT)
+    {
+        Result = virtqueue_add_buf(VirtQueue, Sg, Elements + 1, 1, Request, Indirect,
+                                   Indirect ? StorPortGetPhysicalAddress(Adapter, Srb, Indirect, &Length).QuadPart : 0);
+    }
+    else
+    {
+        Result = virtqueue_add_buf(VirtQueue, Sg, 1, Elements + 1, Request, Indirect,
+                                   Indirect ? StorPortGetPhysicalAddress(Adapter, Srb, Indirect, &Length).QuadPart : 0);
+    }
+
+    /* With event indexes, the device tells us whether it still needs a kick */
+    Notify = (Result == 0) && virtqueue_kick_prepare(VirtQueue);
+
+    KeReleaseInStackQueuedSpinLock(&LockHandle);
+
+    if (Result != 0)
+        return SRB_STATUS_BUSY;
+
+    if (Notify)
+        virtqueue_notify(VirtQueue);
+
+    return SRB_STATUS_PENDING;
+}
+
+static
+VOID
+VioStorProcessQueue(
+    _In_ PVIOSTOR_ADAPTER_EXTENSION Adapter,
+    _In_ ULONG Queue)
+{
+    struct virtqueue *VirtQueue = Adapter->VirtQueues[Queue];
+    PVIOSTOR_REQUEST Request, Completed = NULL;
+    KLOCK_QUEUE_HANDLE LockHandle;
+    unsigned int Length;
+
+    KeAcquireInStackQueuedSpinLock(&Adapter->QueueLocks[Queue], &LockHandle);
+
+    /* Keep interrupts off while draining, and recheck for a race when turning them back on */
+    do
+    {
+        virtqueue_disable_cb(VirtQueue);
+
+        while ((Request = virtqueue_get_buf(VirtQueue, &Length)) != NULL)
+        {
+            Request->NextCompleted = Completed;
+            Completed = Request;
+        }
+    } while (!virtqueue_enable_cb(VirtQueue));
+
+    KeReleaseInStackQueuedSpinLock(&LockHandle);
+
+    while (Completed)
+    {
+        Request = Completed;
+        Completed = Request->NextCompleted;
+
+        switch (Request->Status)
+        {
+            case VIRTIO_BLK_S_OK:
+                Request->Srb->SrbStatus = SRB_STATUS_SUCCESS;
+                break;
+
+            case VIRTIO_BLK_S_UNSUPP:
+                Request->Srb->SrbStatus = SRB_STATUS_INVALID_REQUEST;
+                break;
+
+            default:
+                DPRINT1("Request %p failed with status %u\n", Request, Request->Status);
+                Request->Srb->SrbStatus = SRB_STATUS_ERROR;
+                break;
+        }
+
+        StorPortNotification(RequestComplete, Adapter, Request->Srb);
+    }
+}
+
+static
+VOID
+VioStorCompletionDpc(
+    _In_ PSTOR_DPC Dpc,
+    _In_ PVOID HwDeviceExtension,
+    _In_ PVOID SystemArgument1,
+    _In_ PVOID SystemArgument2)
+{
+    PVIOSTOR_ADAPTER_EXTENSION Adapter = HwDeviceExtension;
+    ULONG i;
+
+    UNREFERENCED_PARAMETER(Dpc);
+    UNREFERENCED_PARAMETER(SystemArgument1);
+    UNREFERENCED_PARAMETER(SystemArgument2);
+
+    for (i = 0; i < Adapter->QueueCount; i++)
+    {
+        VioStorProcessQueue(Adapter, i);
+    }
+}
+
+static
+BOOLEAN
+NTAPI
+VioStorHwInterrupt(
+    _In_ PVOID DeviceExtension)
+{
+    PVIOSTOR_ADAPTER_EXTENSION Adapter = DeviceExtension;
+    UCHAR IsrStatus;
+
+    if (!Adapter->Ready)
+        return FALSE;
+
+    /* Reading the ISR status acknowledges the interrupt */
+    IsrStatus = virtio_read_isr_status(&Adapter->VirtIoDevice);
+    if (IsrStatus == 0)
+        return FALSE;
+
+    if (IsrStatus & VIRTIO_PCI_ISR_CONFIG)
+        DPRINT1("Configuration change\n");
+
+    /* The rings are shared with the submission path, so drain them outside of DIRQL */
+    StorPortIssueDpc(Adapter, &Adapter->CompletionDpc, NULL, NULL);
+
+    return TRUE;
+}
+
+static
+BOOLEAN
+NTAPI
+VioStorHwInitialize(
+    _In_ PVOID DeviceExtension)
+{
+    PVIOSTOR_ADAPTER_EXTENSION Adapter = DeviceExtension;
+    NTSTATUS Status;
+    ULONG i;
+
+    Status = virtio_find_queues(&Adapter->VirtIoDevice, Adapter->QueueCount, Adapter->VirtQueues);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("virtio_find_queues failed with 0x%lx\n", Status);
+        virtio_add_status(&Adapter->VirtIoDevice, VIRTIO_CONFIG_S_FAILED);
+        return FALSE;
+    }
+
+    for (i = 0; i < Adapter->QueueCount; i++)
+    {
+        KeInitializeSpinLock(&Adapter->QueueLocks[i]);
+    }
+
+    StorPortInitializeDpc(Adapter, &Adapter->CompletionDpc, VioStorCompletionDpc);
+
+    virtio_device_ready(&Adapter->VirtIoDevice);
+    Adapter->Ready = TRUE;
+
+    return TRUE;
+}
+
+static
+UCHAR
+VioStorReadWrite(
+    _In_ PVIOSTOR_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb,
+    _In_ PCDB Cdb)
+{
+    ULONGLONG Lba, BlockCount;
+    ULONG Blocks;
+    BOOLEAN Write;
+
+    switch (Cdb->CDB10.OperationCode)
+    {
+        case SCSIOP_READ6:
+        case SCSIOP_WRITE6:
+            Lba = ((ULONG)Cdb->CDB6READWRITE.LogicalBlockMsb1 << 16) |
+                  ((ULONG)Cdb->CDB6READWRITE.LogicalBlockMsb0 << 8) |
+                  Cdb->CDB6READWRITE.LogicalBlockLsb;
+            Blocks = Cdb->CDB6READWRITE.TransferBlocks ? Cdb->CDB6READWRITE.TransferBlocks : 256;
+            Write = (Cdb->CDB10.OperationCode == SCSIOP_WRITE6);
+            break;
+
+        case SCSIOP_READ:
+        case SCSIOP_WRITE:
+            Lba = ((ULONG)Cdb->CDB10.LogicalBlockByte0 << 24) |
+                  ((ULONG)Cdb->CDB10.LogicalBlockByte1 << 16) |
+                  ((ULONG)Cdb->CDB10.LogicalBlockByte2 << 8) |
+                  Cdb->CDB10.LogicalBlockByte3;
+            Blocks = ((ULONG)Cdb->CDB10.TransferBlocksMsb << 8) | Cdb->CDB10.TransferBlocksLsb;
+            Write = (Cdb->CDB10.OperationCode == SCSIOP_WRITE);
+            break;
+
+        default:
+            REVERSE_BYTES_QUAD(&Lba, Cdb->CDB16.LogicalBlock);
+            REVERSE_BYTES(&Blocks, Cdb->CDB16.TransferLength);
+            Write = (Cdb->CDB16.OperationCode == SCSIOP_WRITE16);
+            break;
+    }
+
+    if (Blocks == 0)
+        return SRB_STATUS_SUCCESS;
+
+    if (Write && Adapter->ReadOnly)
+        return SRB_STATUS_ERROR;
+
+    BlockCount = Adapter->Capacity / (Adapter->BlockSize >> VIOSTOR_SECTOR_SHIFT);
+    if (Lba >= BlockCount || Blocks > BlockCount - Lba)
+        return SRB_STATUS_INVALID_REQUEST;
+
+    if ((ULONGLONG)Blocks * Adapter->BlockSize != Srb->DataTransferLength)
+        return SRB_STATUS_INVALID_REQUEST;
+
+    /* The device always counts in 512 byte sectors */
+    return VioStorSubmitRequest(Adapter,
+                                Srb,
+                                Write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN,
+                                Lba * (Adapter->BlockSize >> VIOSTOR_SECTOR_SHIFT));
+}
+
+static
+UCHAR
+VioStorFlush(
+    _In_ PVIOSTOR_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    /* Without the flush feature, writes are durable once completed */
+    if (!virtio_is_feature_enabled(Adapter->Features, VIRTIO_BLK_F_FLUSH))
+        return SRB_STATUS_SUCCESS;
+
+    return VioStorSubmitRequest(Adapter, Srb, VIRTIO_BLK_T_FLUSH, 0);
+}
+
+static
+VOID
+VioStorCopyResponse(
+    _Inout_ PSCSI_REQUEST_BLOCK Srb,
+    _In_reads_bytes_(Length) PVOID Data,
+    _In_ ULONG Length)
+{
+    Length = min(Length, Srb->DataTransferLength);
+    RtlCopyMemory(Srb->DataBuffer, Data, Length);
+    Srb->DataTransferLength = Length;
+}
+
+static
+UCHAR
+VioStorInquiry(
+    _In_ PVIOSTOR_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb,
+    _In_ PCDB Cdb)
+{
+    INQUIRYDATA InquiryData;
+    UCHAR SupportedPages[sizeof(VPD_SUPPORTED_PAGES_PAGE) + 1];
+    PVPD_SUPPORTED_PAGES_PAGE Pages;
+
+    UNREFERENCED_PARAMETER(Adapter);
+
+    if (Cdb->CDB6INQUIRY3.EnableVitalProductData)
+    {
+        if (Cdb->CDB6INQUIRY3.PageCode != VPD_SUPPORTED_PAGES)
+            return SRB_STATUS_INVALID_REQUEST;
+
+        RtlZeroMemory(SupportedPages, sizeof(SupportedPages));
+        Pages = (PVPD_SUPPORTED_PAGES_PAGE)SupportedPages;
+        Pages->DeviceType = DIRECT_ACCESS_DEVICE;
+        Pages->PageCode = VPD_SUPPORTED_PAGES;
+        Pages->PageLength = 1;
+        Pages->SupportedPageList[0] = VPD_SUPPORTED_PAGES;
+
+        VioStorCopyResponse(Srb, SupportedPages, sizeof(SupportedPages));
+        return SRB_STATUS_SUCCESS;
+    }
+
+    RtlZeroMemory(&InquiryData, sizeof(InquiryData));
+    InquiryData.DeviceType = DIRECT_ACCESS_DEVICE;
+    InquiryData.Versions = 5;
+    InquiryData.ResponseDataFormat = 2;
+    InquiryData.AdditionalLength = INQUIRYDATABUFFERSIZE - 5;
+    InquiryData.CommandQueue = 1;
+    RtlCopyMemory(InquiryData.VendorId, "VirtIO  ", sizeof(InquiryData.VendorId));
+    RtlCopyMemory(InquiryData.ProductId, "Block Device    ", sizeof(InquiryData.ProductId));
+    RtlCopyMemory(InquiryData.ProductRevisionLevel, "1.0 ", sizeof(InquiryData.ProductRevisionLevel));
+
+    VioStorCopyResponse(Srb, &InquiryData, INQUIRYDATABUFFERSIZE);
+    return SRB_STATUS_SUCCESS;
+}
+
+static
+UCHAR
+VioStorReadCapacity(
+    _In_ PVIOSTOR_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb,
+    _In_ PCDB Cdb)
+{
+    READ_CAPACITY_DATA Capacity;
+    READ_CAPACITY_DATA_EX CapacityEx;
+    ULONGLONG LastLba;
+    ULONG LastLba32;
+
+    LastLba = Adapter->Capacity / (Adapter->BlockSize >> VIOSTOR_SECTOR_SHIFT) - 1;
+
+    if (Cdb->CDB10.OperationCode == SCSIOP_READ_CAPACITY)
+    {
+        /* Too large for 32 bits, the class driver retries with READ CAPACITY (16) */
+        LastLba32 = (LastLba > MAXULONG) ? MAXULONG : (ULONG)LastLba;
+
+        REVERSE_BYTES(&Capacity.LogicalBlockAddress, &LastLba32);
+        REVERSE_BYTES(&Capacity.BytesPerBlock, &Adapter->BlockSize);
+        VioStorCopyResponse(Srb, &Capacity, sizeof(Capacity));
+    }
+    else
+    {
+        if ((Cdb->AsByte[1] & 0x1F) != SERVICE_ACTION_READ_CAPACITY16)
+            return SRB_STATUS_INVALID_REQUEST;
+
+        RtlZeroMemory(Srb->DataBuffer, Srb->DataTransferLength);
+        REVERSE_BYTES_QUAD(&CapacityEx.LogicalBlockAddress, &LastLba);
+        REVERSE_BYTES(&CapacityEx.BytesPerBlock, &Adapter->BlockSize);
+        VioStorCopyResponse(Srb, &CapacityEx, sizeof(CapacityEx));
+    }
+
+    return SRB_STATUS_SUCCESS;
+}
+
+static
+UCHAR
+VioStorModeSense(
+    _In_ PVIOSTOR_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb,
+    _In_ PCDB Cdb)
+{
+    MODE_PARAMETER_HEADER Header;
+    MODE_PARAMETER_HEADER10 Header10;
+    UCHAR DeviceSpecific;
+
+    DeviceSpecific = Adapter->ReadOnly ? MODE_DSP_WRITE_PROTECT : 0;
+
+    /* No mode pages, only the write protection */
+    if (Cdb->CDB10.OperationCode == SCSIOP_MODE_SENSE)
+    {
+        RtlZeroMemory(&Header, sizeof(Header));
+        Header.ModeDataLength = sizeof(Header) - 1;
+        Header.DeviceSpecificParameter = DeviceSpecific;
+        VioStorCopyResponse(Srb, &Header, sizeof(Header));
+    }
+    else
+    {
+        RtlZeroMemory(&Header10, sizeof(Header10));
+        Header10.ModeDataLength[1] = sizeof(Header10) - 2;
+        Header10.DeviceSpecificParameter = DeviceSpecific;
+        VioStorCopyResponse(Srb, &Header10, sizeof(Header10));
+    }
+
+    return SRB_STATUS_SUCCESS;
+}
+
+static
+UCHAR
+VioStorReportLuns(
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    UCHAR Data[sizeof(LUN_LIST) + 8];
+    PLUN_LIST LunList = (PLUN_LIST)Data;
+
+    /* A single LUN 0 */
+    RtlZeroMemory(Data, sizeof(Data));
+    LunList->LunListLength[3] = 8;
+
+    VioStorCopyResponse(Srb, Data, sizeof(Data));
+    return SRB_STATUS_SUCCESS;
+}
+
+static
+UCHAR
+VioStorExecuteScsi(
+    _In_ PVIOSTOR_ADAPTER_EXTENSION Adapter,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    PCDB Cdb = (PCDB)Srb->Cdb;
+
+    switch (Cdb->CDB10.OperationCode)
+    {
+        case SCSIOP_READ6:
+        case SCSIOP_WRITE6:
+        case SCSIOP_READ:
+        case SCSIOP_WRITE:
+        case SCSIOP_READ16:
+        case SCSIOP_WRITE16:
+            return VioStorReadWrite(Adapter, Srb, Cdb);
+
+        case SCSIOP_SYNCHRONIZE_CACHE:
+        case SCSIOP_SYNCHRONIZE_CACHE16:
+            return VioStorFlush(Adapter, Srb);
+
+        case SCSIOP_INQUIRY:
+            return VioStorInquiry(Adapter, Srb, Cdb);
+
+        case SCSIOP_READ_CAPACITY:
+        case SCSIOP_READ_CAPACITY16:
+            return VioStorReadCapacity(Adapter, Srb, Cdb);
+
+        case SCSIOP_MODE_SENSE:
+        case SCSIOP_MODE_SENSE10:
+            return VioStorModeSense(Adapter, Srb, Cdb);
+
+        case SCSIOP_REPORT_LUNS:
+            return VioStorReportLuns(Srb);
+
+        case SCSIOP_TEST_UNIT_READY:
+        case SCSIOP_START_STOP_UNIT:
+            return SRB_STATUS_SUCCESS;
+
+        default:
+            DPRINT("Unsupported SCSI operation 0x%x\n", Cdb->CDB10.OperationCode);
+            return SRB_STATUS_INVALID_REQUEST;
+    }
+}
+
+static
+BOOLEAN
+NTAPI
+VioStorHwStartIo(
+    _In_ PVOID DeviceExtension,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    PVIOSTOR_ADAPTER_EXTENSION Adapter = DeviceExtension;
+    UCHAR SrbStatus;
+
+    if (!Adapter->Ready || Srb->PathId != 0 || Srb->TargetId != 0 || Srb->Lun != 0)
+    {
+        SrbStatus = SRB_STATUS_NO_DEVICE;
+    }
+    else
+    {
+        switch (Srb->Function)
+        {
+            case SRB_FUNCTION_EXECUTE_SCSI:
+                SrbStatus = VioStorExecuteScsi(Adapter, Srb);
+                break;
+
+            case SRB_FUNCTION_FLUSH:
+            case SRB_FUNCTION_SHUTDOWN:
+                SrbStatus = VioStorFlush(Adapter, Srb);
+                break;
+
+            case SRB_FUNCTION_RESET_BUS:
+            case SRB_FUNCTION_RESET_DEVICE:
+            case SRB_FUNCTION_RESET_LOGICAL_UNIT:
+                SrbStatus = SRB_STATUS_SUCCESS;
+                break;
+
+            default:
+                SrbStatus = SRB_STATUS_INVALID_REQUEST;
+                break;
+        }
+    }
+
+    /* Requests handed to the device are completed by the DPC */
+    if (SrbStatus != SRB_STATUS_PENDING)
+    {
+        Srb->SrbStatus = SrbStatus;
+        StorPortNotification(RequestComplete, Adapter, Srb);
+    }
+
+    return TRUE;
+}
+
+static
+BOOLEAN
+NTAPI
+VioStorHwResetBus(
+    _In_ PVOID DeviceExtension,
+    _In_ ULONG PathId)
+{
+    UNREFERENCED_PARAMETER(DeviceExtension);
+    UNREFERENCED_PARAMETER(PathId);
+
+    /* Requests in flight can't be cancelled, they complete on their own */
+    return TRUE;
+}
+
+static
+BOOLEAN
+VioStorMapResources(
+    _In_ PVIOSTOR_ADAPTER_EXTENSION Adapter,
+    _In_ PPORT_CONFIGURATION_INFORMATION ConfigInfo)
+{
+    PACCESS_RANGE AccessRange;
+    PVIOSTOR_BAR Bar;
+    ULONG Length, i;
+    int Index;
+
+    Length = StorPortGetBusData(Adapter,
+                                PCIConfiguration,
+                                ConfigInfo->SystemIoBusNumber,
+                                ConfigInfo->SlotNumber,
+                                Adapter->PciConfig,
+                                sizeof(Adapter->PciConfig));
+    if (Length != sizeof(Adapter->PciConfig))
+    {
+        DPRINT1("Cannot read the PCI configuration, %lu bytes\n", Length);
+        return FALSE;
+    }
+
+    /* The library looks the BARs up by index */
+    for (i = 0; i < ConfigInfo->NumberOfAccessRanges; i++)
+    {
+        AccessRange = &(*ConfigInfo->AccessRanges)[i];
+        if (AccessRange->RangeLength == 0)
+            continue;
+
+        Index = virtio_get_bar_index((PPCI_COMMON_HEADER)Adapter->PciConfig, AccessRange->RangeStart);
+        if (Index < 0)
+            continue;
+
+        Bar = &Adapter->Bars[Index];
+        Bar->BasePA = AccessRange->RangeStart;
+        Bar->Length = AccessRange->RangeLength;
+        Bar->PortSpace = !AccessRange->RangeInMemory;
+        Bar->Base = StorPortGetDeviceBase(Adapter,
+                                          ConfigInfo->AdapterInterfaceType,
+                                          ConfigInfo->SystemIoBusNumber,
+                                          AccessRange->RangeStart,
+                                          AccessRange->RangeLength,
+                                          Bar->PortSpace);
+    }
+
+    return TRUE;
+}
+
+static
+ULONG
+NTAPI
+VioStorHwFindAdapter(
+    _In_ PVOID DeviceExtension,
+    _In_ PVOID HwContext,
+    _In_ PVOID BusInformation,
+    _In_ PCHAR ArgumentString,
+    _Inout_ PPORT_CONFIGURATION_INFORMATION ConfigInfo,
+    _Out_ PBOOLEAN Again)
+{
+    PVIOSTOR_ADAPTER_EXTENSION Adapter = DeviceExtension;
+    PVirtIODevice VirtIoDevice = &Adapter->VirtIoDevice;
+    ULONGLONG HostFeatures;
+    USHORT NumQueues, QueueEntries;
+    ULONG SegMax, BlockSize;
+    unsigned long RingSize, HeapSize;
+    NTSTATUS Status;
+    ULONG i;
+
+    UNREFERENCED_PARAMETER(HwContext);
+    UNREFERENCED_PARAMETER(BusInformation);
+    UNREFERENCED_PARAMETER(ArgumentString);
+    UNREFERENCED_PARAMETER(Again);
+
+    if (!VioStorMapResources(Adapter, ConfigInfo))
+        return SP_RETURN_ERROR;
+
+    Status = virtio_device_initialize(VirtIoDevice, &VioStorSystemOps, Adapter, FALSE);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("virtio_device_initialize failed with 0x%lx\n", Status);
+        return SP_RETURN_NOT_FOUND;
+    }
+
+    /* Negotiate the features we make use of */
+    HostFeatures = virtio_get_features(VirtIoDevice);
+    Adapter->Features = 0;
+
+#define ACCEPT_FEATURE(Feature) \
+    if (virtio_is_feature_enabled(HostFeatures, Feature)) \
+        virtio_feature_enable(Adapter->Features, Feature)
+
+    ACCEPT_FEATURE(VIRTIO_F_VERSION_1);
+    ACCEPT_FEATURE(VIRTIO_F_ANY_LAYOUT);
+    ACCEPT_FEATURE(VIRTIO_RING_F_INDIRECT_DESC);
+    ACCEPT_FEATURE(VIRTIO_RING_F_EVENT_IDX);
+    ACCEPT_FEATURE(VIRTIO_BLK_F_SEG_MAX);
+    ACCEPT_FEATURE(VIRTIO_BLK_F_BLK_SIZE);
+    ACCEPT_FEATURE(VIRTIO_BLK_F_RO);
+    ACCEPT_FEATURE(VIRTIO_BLK_F_FLUSH);
+    ACCEPT_FEATURE(VIRTIO_BLK_F_MQ);
+
+#undef ACCEPT_FEATURE
+
+    Status = virtio_set_features(VirtIoDevice, Adapter->Features);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("virtio_set_features failed with 0x%lx\n", Status);
+        virtio_add_status(VirtIoDevice, VIRTIO_CONFIG_S_FAILED);
+        return SP_RETURN_ERROR;
+    }
+
+    /* Read the disk geometry */
+    virtio_get_config(VirtIoDevice, FIELD_OFFSET(VIRTIO_BLK_CONFIG, Capacity),
+                      &Adapter->Capacity, sizeof(Adapter->Capacity));
+
+    BlockSize = 1 << VIOSTOR_SECTOR_SHIFT;
+    if (virtio_is_feature_enabled(Adapter->Features, VIRTIO_BLK_F_BLK_SIZE))
+    {
+        virtio_get_config(VirtIoDevice, FIELD_OFFSET(VIRTIO_BLK_CONFIG, BlockSize),
+                          &BlockSize, sizeof(BlockSize));
+        if (BlockSize < (1 << VIOSTOR_SECTOR_SHIFT) || BlockSize > PAGE_SIZE || (BlockSize & (BlockSize - 1)))
+            BlockSize = 1 << VIOSTOR_SECTOR_SHIFT;
+    }
+    Adapter->BlockSize = BlockSize;
+
+    SegMax = VIOSTOR_MAX_SG;
+    if (virtio_is_feature_enabled(Adapter->Features, VIRTIO_BLK_F_SEG_MAX))
+    {
+        virtio_get_config(VirtIoDevice, FIELD_OFFSET(VIRTIO_BLK_CONFIG, SegMax),
+                          &SegMax, sizeof(SegMax));
+        SegMax = max(min(SegMax, VIOSTOR_MAX_SG), 2);
+    }
+    Adapter->MaxSegments = SegMax;
+
+    Adapter->ReadOnly = virtio_is_feature_enabled(Adapter->Features, VIRTIO_BLK_F_RO);
+
+    /* One queue per processor, as far as the device goes */
+    NumQueues = 1;
+    if (virtio_is_feature_enabled(Adapter->Features, VIRTIO_BLK_F_MQ))
+    {
+        virtio_get_config(VirtIoDevice, FIELD_OFFSET(VIRTIO_BLK_CONFIG, NumQueues),
+                          &NumQueues, sizeof(NumQueues));
+        NumQueues = max(NumQueues, 1);
+    }
+    Adapter->QueueCount = min((ULONG)KeNumberProcessors, min((ULONG)NumQueues, VIOSTOR_MAX_QUEUES));
+
+    /* The rings are set up in HwInitialize, but their memory has to be reserved now */
+    Adapter->PoolSize = 0;
+    for (i = 0; i < Adapter->QueueCount; i++)
+    {
+        Status = virtio_query_queue_allocation(VirtIoDevice, i, &QueueEntries, &RingSize, &HeapSize);
+        if (!NT_SUCCESS(Status) || QueueEntries == 0)
+        {
+            DPRINT1("Queue %lu is not available, 0x%lx\n", i, Status);
+            if (i == 0)
+                return SP_RETURN_ERROR;
+
+            Adapter->QueueCount = i;
+            break;
+        }
+
+        Adapter->PoolSize += ROUND_TO_PAGES(RingSize) + ALIGN_UP_BY(HeapSize, SMP_CACHE_BYTES);
+    }
+
+    ConfigInfo->Master = TRUE;
+    ConfigInfo->AlignmentMask = 0x3;
+    ConfigInfo->ScatterGather = TRUE;
+    ConfigInfo->Dma32BitAddresses = TRUE;
+    ConfigInfo->Dma64BitAddresses = TRUE;
+    ConfigInfo->WmiDataProvider = FALSE;
+    ConfigInfo->NumberOfBuses = 1;
+    ConfigInfo->MaximumNumberOfTargets = 1;
+    ConfigInfo->MaximumNumberOfLogicalUnits = 1;
+    ConfigInfo->NumberOfPhysicalBreaks = Adapter->MaxSegments;
+    ConfigInfo->MaximumTransferLength = (Adapter->MaxSegments - 1) * PAGE_SIZE;
+    ConfigInfo->SynchronizationModel = StorSynchronizeFullDuplex;
+
+    Adapter->Pool = StorPortGetUncachedExtension(Adapter, ConfigInfo, Adapter->PoolSize);
+    if (!Adapter->Pool || ((ULONG_PTR)Adapter->Pool & (PAGE_SIZE - 1)) != 0)
+    {
+        DPRINT1("Failed to allocate %lu bytes for the rings\n", Adapter->PoolSize);
+        return SP_RETURN_ERROR;
+    }
+
+    RtlZeroMemory(Adapter->Pool, Adapter->PoolSize);
+    Adapter->PoolUsed = 0;
+
+    DPRINT1("virtio-blk: %I64u sectors, %lu byte blocks, %lu queues, features 0x%I64x\n",
+            Adapter->Capacity, Adapter->BlockSize, Adapter->QueueCount, Adapter->Features);
+
+    return SP_RETURN_FOUND;
+}
+
+ULONG
+NTAPI
+DriverEntry(
+    _In_ PVOID DriverObject,
+    _In_ PVOID RegistryPath)
+{
+    HW_INITIALIZATION_DATA InitData;
+
+    RtlZeroMemory(&InitData, sizeof(InitData));
+    InitData.HwInitializationDataSize = sizeof(HW_INITIALIZATION_DATA);
+
+    InitData.HwInitialize = VioStorHwInitialize;
+    InitData.HwStartIo = VioStorHwStartIo;
+    InitData.HwInterrupt = VioStorHwInterrupt;
+    InitData.HwFindAdapter = VioStorHwFindAdapter;
+    InitData.HwResetBus = VioStorHwResetBus;
+
+    InitData.AdapterInterfaceType = PCIBus;
+    InitData.NumberOfAccessRanges = PCI_TYPE0_ADDRESSES;
+    InitData.MapBuffers = STOR_MAP_NON_READ_WRITE_BUFFERS;
+    InitData.TaggedQueuing = TRUE;
+    InitData.AutoRequestSense = TRUE;
+    InitData.MultipleRequestPerLu = TRUE;
+    InitData.NeedPhysicalAddresses = TRUE;
+
+    InitData.DeviceExtensionSize = sizeof(VIOSTOR_ADAPTER_EXTENSION);
+    InitData.SrbExtensionSize = sizeof(VIOSTOR_SRB_EXTENSION);
+
+    return StorPortInitialize(DriverObject, RegistryPath, &InitData, NULL);
+}
+
+/* EOF */
@@ -0,0 +1,134 @@
+/*
+ * PROJECT:     ReactOS VirtIO Block Storport Miniport Driver
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     virtio-blk definitions
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#pragma once
+
+#include <ntddk.h>
+#include <storport.h>
+
+#include "osdep.h"
+#include "virtio_pci.h"
+#include "VirtIO.h"
+
+/* Driver limits */
+#define VIOSTOR_MAX_QUEUES              MAX_QUEUES_PER_DEVICE_DEFAULT
+#define VIOSTOR_MAX_SG                  33
+#define VIOSTOR_SECTOR_SHIFT            9
+
+/* Feature bits */
+#define VIRTIO_BLK_F_SIZE_MAX           1
+#define VIRTIO_BLK_F_SEG_MAX            2
+#define VIRTIO_BLK_F_RO                 5
+#define VIRTIO_BLK_F_BLK_SIZE           6
+#define VIRTIO_BLK_F_FLUSH              9
+#define VIRTIO_BLK_F_MQ                 12
+
+/* Request types */
+#define VIRTIO_BLK_T_IN                 0
+#define VIRTIO_BLK_T_OUT                1
+#define VIRTIO_BLK_T_FLUSH              4
+
+/* Request status */
+#define VIRTIO_BLK_S_OK                 0
+#define VIRTIO_BLK_S_IOERR              1
+#define VIRTIO_BLK_S_UNSUPP             2
+
+#include <pshpack1.h>
+
+typedef struct _VIRTIO_BLK_CONFIG
+{
+    ULONGLONG Capacity;
+    ULONG SizeMax;
+    ULONG SegMax;
+    USHORT Cylinders;
+    UCHAR Heads;
+    UCHAR Sectors;
+    ULONG BlockSize;
+    UCHAR PhysicalBlockExponent;
+    UCHAR AlignmentOffset;
+    USHORT MinIoSize;
+    ULONG OptIoSize;
+    UCHAR Writeback;
+    UCHAR Unused;
+    USHORT NumQueues;
+} VIRTIO_BLK_CONFIG, *PVIRTIO_BLK_CONFIG;
+C_ASSERT(FIELD_OFFSET(VIRTIO_BLK_CONFIG, BlockSize) == 20);
+C_ASSERT(FIELD_OFFSET(VIRTIO_BLK_CONFIG, NumQueues) == 34);
+
+typedef struct _VIRTIO_BLK_OUTHDR
+{
+    ULONG Type;
+    ULONG IoPriority;
+    ULONGLONG Sector;
+} VIRTIO_BLK_OUTHDR, *PVIRTIO_BLK_OUTHDR;
+
+#include <poppack.h>
+
+/*
+ * Everything the device reads or writes besides the data itself. It lives
+ * in the SRB extension, aligned so that it never crosses a page.
+ */
+typedef struct _VIOSTOR_REQUEST
+{
+    UCHAR IndirectTable[(VIOSTOR_MAX_SG + 2) * SIZE_OF_SINGLE_INDIRECT_DESC];
+    VIRTIO_BLK_OUTHDR Header;
+    UCHAR Status;
+    PSCSI_REQUEST_BLOCK Srb;
+    struct _VIOSTOR_REQUEST *NextCompleted;
+} VIOSTOR_REQUEST, *PVIOSTOR_REQUEST;
+
+#define VIOSTOR_REQUEST_ALIGNMENT 1024
+C_ASSERT(sizeof(VIOSTOR_REQUEST) <= VIOSTOR_REQUEST_ALIGNMENT);
+
+typedef struct _VIOSTOR_SRB_EXTENSION
+{
+    UCHAR Buffer[VIOSTOR_REQUEST_ALIGNMENT * 2];
+} VIOSTOR_SRB_EXTENSION, *PVIOSTOR_SRB_EXTENSION;
+
+typedef struct _VIOSTOR_BAR
+{
+    PHYSICAL_ADDRESS BasePA;
+    ULONG Length;
+    PVOID Base;
+    BOOLEAN PortSpace;
+} VIOSTOR_BAR, *PVIOSTOR_BAR;
+
+typedef struct _VIOSTOR_ADAPTER_EXTENSION
+{
+    VirtIODevice VirtIoDevice;
+    UCHAR PciConfig[256];
+    VIOSTOR_BAR Bars[PCI_TYPE0_ADDRESSES];
+
+    /* Ring memory, handed out by the library's allocation callbacks */
+    PUCHAR Pool;
+    ULONG PoolSize;
+    ULONG PoolUsed;
+
+    ULONGLONG Features;
+    ULONGLONG Capacity;
+    ULONG BlockSize;
+    ULONG MaxSegments;
+    BOOLEAN ReadOnly;
+    BOOLEAN Ready;
+
+    STOR_DPC CompletionDpc;
+
+    /* One queue per processor, each with its own lock */
+    ULONG QueueCount;
+    struct virtqueue *VirtQueues[VIOSTOR_MAX_QUEUES];
+    KSPIN_LOCK QueueLocks[VIOSTOR_MAX_QUEUES];
+} VIOSTOR_ADAPTER_EXTENSION, *PVIOSTOR_ADAPTER_EXTENSION;
+
+/* virtio.c */
+
+extern VirtIOSystemOps VioStorSystemOps;
+
+PVOID
+VioStorPoolAllocate(
+    _In_ PVIOSTOR_ADAPTER_EXTENSION Adapter,
+    _In_ SIZE_T Size,
+    _In_ ULONG Alignment);
@@ -0,0 +1,247 @@
+/*
+ * PROJECT:     ReactOS VirtIO Block Storport Miniport Driver
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Storport implementation of the virtio library system callbacks
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+/* INCLUDES *******************************************************************/
+
+#include "viostor.h"
+#include "kdebugprint.h"
+
+#define NDEBUG
+#include <debug.h>
+
+/* GLOBALS ********************************************************************/
+
+static void VioStorDebugPrint(const char *Format, ...);
+
+int virtioDebugLevel = 1;
+#if DBG
+int bDebugPrint = 1;
+#else
+int bDebugPrint = 0;
+#endif
+tDebugPrintFunc VirtioDebugPrintProc = VioStorDebugPrint;
+
+/*
+ * The lower 64k of the address space is never mapped, so port I/O and memory
+ * mapped registers can be told apart by the address alone.
+ */
+#define PORT_MASK 0xFFFF
+
+/* FUNCTIONS ******************************************************************/
+
+static
+void
+VioStorDebugPrint(
+    const char *Format,
+    ...)
+{
+    va_list Args;
+
+    va_start(Args, Format);
+    vDbgPrintEx(DPFLTR_DEFAULT_ID, DPFLTR_ERROR_LEVEL, Format, Args);
+    va_end(Args);
+}
+
+PVOID
+VioStorPoolAllocate(
+    _In_ PVIOSTOR_ADAPTER_EXTENSION Adapter,
+    _In_ SIZE_T Size,
+    _In_ ULONG Alignment)
+{
+    ULONG Offset;
+
+    /* The pool is page aligned, so aligning the offset aligns the address */
+    Offset = ALIGN_UP_BY(Adapter->PoolUsed, Alignment);
+    if (Offset > Adapter->PoolSize || Size > Adapter->PoolSize - Offset)
+    {
+        DPRINT1("Pool exhausted, %Iu bytes requested\n", Size);
+        return NULL;
+    }
+
+    Adapter->PoolUsed = Offset + (ULONG)Size;
+    return Adapter->Pool + Offset;
+}
+
+static u8 ReadVirtIODeviceByte(ULONG_PTR ulRegister)
+{
+    if (ulRegister & ~PORT_MASK)
+        return READ_REGISTER_UCHAR((PUCHAR)ulRegister);
+    else
+        return READ_PORT_UCHAR((PUCHAR)ulRegister);
+}
+
+static u16 ReadVirtIODeviceWord(ULONG_PTR ulRegister)
+{
+    if (ulRegister & ~PORT_MASK)
+        return READ_REGISTER_USHORT((PUSHORT)ulRegister);
+    else
+        return READ_PORT_USHORT((PUSHORT)ulRegister);
+}
+
+static u32 ReadVirtIODeviceRegister(ULONG_PTR ulRegister)
+{
+    if (ulRegister & ~PORT_MASK)
+        return READ_REGISTER_ULONG((PULONG)ulRegister);
+    else
+        return READ_PORT_ULONG((PULONG)ulRegister);
+}
+
+static void WriteVirtIODeviceByte(ULONG_PTR ulRegister, u8 bValue)
+{
+    if (ulRegister & ~PORT_MASK)
+        WRITE_REGISTER_UCHAR((PUCHAR)ulRegister, bValue);
+    else
+        WRITE_PORT_UCHAR((PUCHAR)ulRegister, bValue);
+}
+
+static void WriteVirtIODeviceWord(ULONG_PTR ulRegister, u16 wValue)
+{
+    if (ulRegister & ~PORT_MASK)
+        WRITE_REGISTER_USHORT((PUSHORT)ulRegister, wValue);
+    else
+        WRITE_PORT_USHORT((PUSHORT)ulRegister, wValue);
+}
+
+static void WriteVirtIODeviceRegister(ULONG_PTR ulRegister, u32 ulValue)
+{
+    if (ulRegister & ~PORT_MASK)
+        WRITE_REGISTER_ULONG((PULONG)ulRegister, ulValue);
+    else
+        WRITE_PORT_ULONG((PULONG)ulRegister, ulValue);
+}
+
+static void *mem_alloc_contiguous_pages(void *context, size_t size)
+{
+    /* Rings come from the uncached extension, which is physically contiguous */
+    return VioStorPoolAllocate(context, size, PAGE_SIZE);
+}
+
+static void mem_free_contiguous_pages(void *context, void *virt)
+{
+    /* The pool goes away with the adapter */
+    UNREFERENCED_PARAMETER(context);
+    UNREFERENCED_PARAMETER(virt);
+}
+
+static ULONGLONG mem_get_physical_address(void *context, void *virt)
+{
+    ULONG Length;
+
+    return StorPortGetPhysicalAddress(context, NULL, virt, &Length).QuadPart;
+}
+
+static void *mem_alloc_nonpaged_block(void *context, size_t size)
+{
+    return VioStorPoolAllocate(context, size, SMP_CACHE_BYTES);
+}
+
+static void mem_free_nonpaged_block(void *context, void *addr)
+{
+    UNREFERENCED_PARAMETER(context);
+    UNREFERENCED_PARAMETER(addr);
+}
+
+static int PCIReadConfig(PVIOSTOR_ADAPTER_EXTENSION Adapter,
+                         int where,
+                         void *buffer,
+                         size_t length)
+{
+    /* The configuration space was read once when the adapter was found */
+    if (where < 0 || where + length > sizeof(Adapter->PciConfig))
+        return -1;
+
+    RtlCopyMemory(buffer, &Adapter->PciConfig[where], length);
+    return 0;
+}
+
+static int pci_read_config_byte(void *context, int where, u8 *bVal)
+{
+    return PCIReadConfig(context, where, bVal, sizeof(*bVal));
+}
+
+static int pci_read_config_word(void *context, int where, u16 *wVal)
+{
+    return PCIReadConfig(context, where, wVal, sizeof(*wVal));
+}
+
+static int pci_read_config_dword(void *context, int where, u32 *dwVal)
+{
+    return PCIReadConfig(context, where, dwVal, sizeof(*dwVal));
+}
+
+static size_t pci_get_resource_len(void *context, int bar)
+{
+    PVIOSTOR_ADAPTER_EXTENSION Adapter = context;
+
+    if (bar < 0 || bar >= PCI_TYPE0_ADDRESSES)
+        return 0;
+
+    return Adapter->Bars[bar].Length;
+}
+
+static void *pci_map_address_range(void *context, int bar, size_t offset, size_t maxlen)
+{
+    PVIOSTOR_ADAPTER_EXTENSION Adapter = context;
+    PVIOSTOR_BAR Bar;
+
+    UNREFERENCED_PARAMETER(maxlen);
+
+    if (bar < 0 || bar >= PCI_TYPE0_ADDRESSES)
+        return NULL;
+
+    /* All the BARs were mapped when the adapter was found */
+    Bar = &Adapter->Bars[bar];
+    if (!Bar->Base || offset >= Bar->Length)
+    {
+        DPRINT1("Cannot map BAR %d offset 0x%Ix\n", bar, offset);
+        return NULL;
+    }
+
+    return (PUCHAR)Bar->Base + offset;
+}
+
+static u16 vdev_get_msix_vector(void *context, int queue)
+{
+    UNREFERENCED_PARAMETER(context);
+    UNREFERENCED_PARAMETER(queue);
+
+    /* Storport only connects the line interrupt */
+    return VIRTIO_MSI_NO_VECTOR;
+}
+
+static void vdev_sleep(void *context, unsigned int msecs)
+{
+    UNREFERENCED_PARAMETER(context);
+
+    while (msecs--)
+    {
+        StorPortStallExecution(1000);
+    }
+}
+
+VirtIOSystemOps VioStorSystemOps = {
+    /* .vdev_read_byte = */ ReadVirtIODeviceByte,
+    /* .vdev_read_word = */ ReadVirtIODeviceWord,
+    /* .vdev_read_dword = */ ReadVirtIODeviceRegister,
+    /* .vdev_write_byte = */ WriteVirtIODeviceByte,
+    /* .vdev_write_word = */ WriteVirtIODeviceWord,
+    /* .vdev_write_dword = */ WriteVirtIODeviceRegister,
+    /* .mem_alloc_contiguous_pages = */ mem_alloc_contiguous_pages,
+    /* .mem_free_contiguous_pages = */ mem_free_contiguous_pages,
+    /* .mem_get_physical_address = */ mem_get_physical_address,
+    /* .mem_alloc_nonpaged_block = */ mem_alloc_nonpaged_block,
+    /* .mem_free_nonpaged_block = */ mem_free_nonpaged_block,
+    /* .pci_read_config_byte = */ pci_read_config_byte,
+    /* .pci_read_config_word = */ pci_read_config_word,
+    /* .pci_read_config_dword = */ pci_read_config_dword,
+    /* .pci_get_resource_len = */ pci_get_resource_len,
+    /* .pci_map_address_range = */ pci_map_address_range,
+    /* .vdev_get_msix_vector = */ vdev_get_msix_vector,
+    /* .vdev_sleep = */ vdev_sleep,
+};
+
+/* EOF */
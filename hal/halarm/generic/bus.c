@@ -99,6 +99,20 @@ HalGetInterruptVector(IN INTERFACE_TYPE InterfaceType,
     return 0;
 }
 
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+HalGetMessageRoutingInfo(IN ULONG Vector,
+                         IN KAFFINITY Affinity,
+                         OUT PPHYSICAL_ADDRESS MessageAddress,
+                         OUT PULONG MessageData)
+{
+    /* No message signaled interrupts on this platform */
+    return STATUS_NOT_SUPPORTED;
+}
+
 /*
  * @unimplemented
  */
@@ -395,6 +395,36 @@ HalpAllocateSystemInterrupt(
     return Vector;
 }
 
+static
+UCHAR
+HalpFindFreeVector(
+    _Out_ PKIRQL OutIrql)
+{
+    ULONG Offset;
+    UCHAR Vector;
+    KIRQL Irql;
+
+    /* Outer loop to find alternative slots, when all IRQLs are in use */
+    for (Offset = 0; Offset < 15; Offset++)
+    {
+        /* Loop allowed IRQL range */
+        for (Irql = CLOCK_LEVEL - 1; Irql >= CMCI_LEVEL; Irql--)
+        {
+            /* Calculate the vector */
+            Vector = IrqlToTpr(Irql) + Offset;
+
+            /* Check if the vector is free */
+            if (HalpVectorToIrq(Vector) == APIC_FREE_VECTOR)
+            {
+                *OutIrql = Irql;
+                return Vector;
+            }
+        }
+    }
+
+    return 0;
+}
+
 ULONG
 NTAPI
 HalpGetRootInterruptVector(
@@ -418,42 +448,70 @@ HalpGetRootInterruptVector(
     }
     else
     {
-        ULONG Offset;
-
-        /* Outer loop to find alternative slots, when all IRQLs are in use */
-        for (Offset = 0; Offset < 15; Offset++)
+        /* Find a free vector */
+        Vector = HalpFindFreeVector(&Irql);
+        if (Vector == 0)
         {
-            /* Loop allowed IRQL range */
-            for (Irql = CLOCK_LEVEL - 1; Irql >= CMCI_LEVEL; Irql--)
-            {
-                /* Calculate the vactor */
-                Vector = IrqlToTpr(Irql) + Offset;
-
-                /* Check if the vector is free */
-                if (HalpVectorToIrq(Vector) == APIC_FREE_VECTOR)
-                {
-                    /* Found one, allocate the interrupt */
-                    Vector = HalpAllocateSystemInterrupt(BusInterruptLevel, Vector);
-                    *OutIrql = Irql;
-                    goto Exit;
-                }
-            }
+            DPRINT1("Failed to get an interrupt vector for IRQ %lu\n", BusInterruptLevel);
+            *OutAffinity = 0;
+            *OutIrql = 0;
+            return 0;
         }
 
-        DPRINT1("Failed to get an interrupt vector for IRQ %lu\n", BusInterruptLevel);
-        *OutAffinity = 0;
-        *OutIrql = 0;
-        return 0;
+        /* Found one, allocate the interrupt */
+        Vector = HalpAllocateSystemInterrupt(BusInterruptLevel, Vector);
+        *OutIrql = Irql;
     }
 
-Exit:
-
     *OutAffinity = HalpDefaultInterruptAffinity;
     ASSERT(HalpDefaultInterruptAffinity);
 
     return Vector;
 }
 
+UCHAR
+NTAPI
+HalpAllocateMessageVector(
+    _Out_ PKIRQL OutIrql)
+{
+    UCHAR Vector;
+
+    /* Message signaled interrupts bypass the I/O APIC, so only the vector is needed */
+    Vector = HalpFindFreeVector(OutIrql);
+    if (Vector == 0)
+    {
+        DPRINT1("Failed to get an interrupt vector for a message\n");
+        return 0;
+    }
+
+    HalpVectorToIndex[Vector] = APIC_MSI_VECTOR;
+    return Vector;
+}
+
+VOID
+NTAPI
+HalpFreeMessageVector(
+    _In_ ULONG Vector)
+{
+    /* Only give back what HalpAllocateMessageVector handed out */
+    if (!HalpIsMessageVector(Vector))
+    {
+        DPRINT1("Vector 0x%lx is not a message vector\n", Vector);
+        return;
+    }
+
+    HalpVectorToIndex[Vector] = APIC_FREE_VECTOR;
+}
+
+BOOLEAN
+NTAPI
+HalpIsMessageVector(
+    _In_ ULONG Vector)
+{
+    return (Vector < RTL_NUMBER_OF(HalpVectorToIndex)) &&
+           (HalpVectorToIndex[Vector] == APIC_MSI_VECTOR);
+}
+
 VOID
 NTAPI
 ApicInitializeIOApic(VOID)
@@ -689,6 +747,12 @@ HalEnableSystemInterrupt(
         return FALSE;
     }
 
+    /* Messages are sent straight to the local APIC, the device masks them */
+    if (Index == APIC_MSI_VECTOR)
+    {
+        return TRUE;
+    }
+
     /* Read the redirection entry */
     ReDirReg = ApicReadIORedirectionEntry(Index);
 
@@ -733,6 +797,12 @@ HalDisableSystemInterrupt(
 
     Index = HalpVectorToIndex[Vector];
 
+    /* Messages don't go through the I/O APIC */
+    if (Index == APIC_MSI_VECTOR)
+    {
+        return;
+    }
+
     /* Read lower dword of redirection entry */
     ReDirReg.Long0 = IOApicRead(IOAPIC_REDTBL + 2 * Index);
 
@@ -785,8 +855,8 @@ HalBeginSystemInterrupt(
        }
        else
        {
-            /* This should be a reserved vector! */
-            ASSERT(Index == APIC_RESERVED_VECTOR);
+            /* This should be a reserved or message vector! */
+            ASSERT(Index == APIC_RESERVED_VECTOR || Index == APIC_MSI_VECTOR);
 
             /* Re-request the interrupt to be handled later */
             ApicRequestSelfInterrupt(Vector, APIC_TGM_Edge);
@@ -59,6 +59,14 @@
 #define APIC_MAX_IRQ 24
 #define APIC_FREE_VECTOR 0xFF
 #define APIC_RESERVED_VECTOR 0xFE
+#define APIC_MSI_VECTOR 0xFD
+
+/* Message signaled interrupt address and data layout */
+#define APIC_MSI_ADDRESS_BASE        0xFEE00000
+#define APIC_MSI_ADDRESS_DEST_SHIFT  12
+#define APIC_MSI_ADDRESS_RH          0x00000008
+#define APIC_MSI_ADDRESS_DM_LOGICAL  0x00000004
+#define APIC_MSI_DATA_MT_SHIFT       8
 
 /* The IMCR is supported by two read/writable or write-only I/O ports,
    22h and 23h, which receive address and data respectively.
@@ -337,4 +345,32 @@ VOID
 NTAPI
 HalpInitApicInfo(IN PLOADER_PARAMETER_BLOCK KeLoaderBlock);
 
+UCHAR
+NTAPI
+HalpAllocateMessageVector(
+    _Out_ PKIRQL OutIrql);
+
+VOID
+NTAPI
+HalpFreeMessageVector(
+    _In_ ULONG Vector);
+
+BOOLEAN
+NTAPI
+HalpIsMessageVector(
+    _In_ ULONG Vector);
+
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+NTSTATUS
+NTAPI
+HalpGetInterruptTranslator(
+    _In_ INTERFACE_TYPE ParentInterfaceType,
+    _In_ ULONG ParentBusNumber,
+    _In_ INTERFACE_TYPE BridgeInterfaceType,
+    _In_ USHORT Size,
+    _In_ USHORT Version,
+    _Out_ PTRANSLATOR_INTERFACE Translator,
+    _Out_ PULONG BridgeBusNumber);
+#endif
+
 VOID __cdecl ApicSpuriousService(VOID);
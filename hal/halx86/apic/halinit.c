@@ -51,6 +51,11 @@ HalpInitPhase0(IN PLOADER_PARAMETER_BLOCK LoaderBlock)
 
     HalpPrintApicTables();
 
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+    /* Message signaled interrupts need vectors from the local APIC */
+    HalGetInterruptTranslator = HalpGetInterruptTranslator;
+#endif
+
     /* Enable clock interrupt handler */
     HalpEnableInterruptHandler(IDT_INTERNAL,
                                0,
@@ -0,0 +1,242 @@
+/*
+ * PROJECT:     ReactOS Hardware Abstraction Layer
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Message signaled interrupt vector allocation and routing
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <hal.h>
+#include "apicp.h"
+#define NDEBUG
+#include <debug.h>
+
+/* GLOBALS ******************************************************************/
+
+/* Flat logical destinations can only address the first 8 processors */
+#define MSI_MAX_TARGETS 8
+
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+static ULONG HalpNextMessageTarget;
+#endif
+
+/* PRIVATE FUNCTIONS ********************************************************/
+
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+
+static
+KAFFINITY
+HalpGetMessageTarget(VOID)
+{
+    KAFFINITY Targets;
+    ULONG i, Processor;
+
+    Targets = HalpDefaultInterruptAffinity & (((KAFFINITY)1 << MSI_MAX_TARGETS) - 1);
+    ASSERT(Targets);
+
+    /* Spread the messages over the processors, one at a time */
+    for (i = 0; i < MSI_MAX_TARGETS; i++)
+    {
+        Processor = InterlockedIncrement((PLONG)&HalpNextMessageTarget) % MSI_MAX_TARGETS;
+        if (Targets & ((KAFFINITY)1 << Processor))
+            return (KAFFINITY)1 << Processor;
+    }
+
+    /* Unreachable, processor 0 is always a target */
+    return 1;
+}
+
+static
+VOID
+NTAPI
+HalpTranslatorReference(
+    _In_ PVOID Context)
+{
+    /* Nothing to do, the translator is static */
+    UNREFERENCED_PARAMETER(Context);
+}
+
+static
+NTSTATUS
+NTAPI
+HalpTranslateInterruptResource(
+    _Inout_opt_ PVOID Context,
+    _In_ PCM_PARTIAL_RESOURCE_DESCRIPTOR Source,
+    _In_ RESOURCE_TRANSLATION_DIRECTION Direction,
+    _In_opt_ ULONG AlternativesCount,
+    _In_reads_opt_(AlternativesCount) IO_RESOURCE_DESCRIPTOR Alternatives[],
+    _In_ PDEVICE_OBJECT PhysicalDeviceObject,
+    _Out_ PCM_PARTIAL_RESOURCE_DESCRIPTOR Target)
+{
+    KIRQL Irql;
+    KAFFINITY Affinity;
+    UCHAR Vector;
+
+    PAGED_CODE();
+
+    ASSERT(Source->Type == CmResourceTypeInterrupt);
+
+    /* Copy common information */
+    RtlCopyMemory(Target, Source, sizeof(CM_PARTIAL_RESOURCE_DESCRIPTOR));
+
+    if (Direction != TranslateChildToParent)
+    {
+        /* Translating a message back gives its vector up */
+        if (Source->Flags & CM_RESOURCE_INTERRUPT_MESSAGE)
+        {
+            HalpFreeMessageVector(Source->u.MessageInterrupt.Translated.Vector);
+
+            Target->u.MessageInterrupt.Raw.Reserved = 0;
+            Target->u.MessageInterrupt.Raw.MessageCount = 1;
+            Target->u.MessageInterrupt.Raw.Vector = CM_RESOURCE_INTERRUPT_MESSAGE_TOKEN;
+            Target->u.MessageInterrupt.Raw.Affinity = (KAFFINITY)-1;
+        }
+
+        return STATUS_TRANSLATION_COMPLETE;
+    }
+
+    if (!(Source->Flags & CM_RESOURCE_INTERRUPT_MESSAGE))
+    {
+        /* Line based interrupts go through the bus handlers */
+        Target->u.Interrupt.Vector = HalGetInterruptVector((INTERFACE_TYPE)Context, 0,
+                                                           Source->u.Interrupt.Level,
+                                                           Source->u.Interrupt.Vector,
+                                                           &Irql, &Affinity);
+        Target->u.Interrupt.Level = Irql;
+        Target->u.Interrupt.Affinity = Affinity;
+        return STATUS_TRANSLATION_COMPLETE;
+    }
+
+    /* Each message gets its own vector, so the PnP manager asks for them one by one */
+    if (Source->u.MessageInterrupt.Raw.MessageCount != 1)
+    {
+        DPRINT1("%u messages in a single descriptor\n", Source->u.MessageInterrupt.Raw.MessageCount);
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    Vector = HalpAllocateMessageVector(&Irql);
+    if (Vector == 0)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    Target->u.MessageInterrupt.Translated.Level = Irql;
+    Target->u.MessageInterrupt.Translated.Vector = Vector;
+    Target->u.MessageInterrupt.Translated.Affinity = HalpGetMessageTarget();
+
+    DPRINT("Message vector 0x%x IRQL %u affinity 0x%Ix\n",
+           Vector, Irql, Target->u.MessageInterrupt.Translated.Affinity);
+
+    return STATUS_TRANSLATION_COMPLETE;
+}
+
+static
+NTSTATUS
+NTAPI
+HalpTranslateInterruptRequirement(
+    _Inout_opt_ PVOID Context,
+    _In_ PIO_RESOURCE_DESCRIPTOR Source,
+    _In_ PDEVICE_OBJECT PhysicalDeviceObject,
+    _Out_ PULONG TargetCount,
+    _Out_writes_(*TargetCount) PIO_RESOURCE_DESCRIPTOR *Target)
+{
+    PAGED_CODE();
+
+    ASSERT(Source->Type == CmResourceTypeInterrupt);
+
+    *Target = ExAllocatePoolWithTag(PagedPool, sizeof(IO_RESOURCE_DESCRIPTOR), TAG_HAL);
+    if (!*Target)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    /* Vectors are only assigned when the resources are translated */
+    RtlCopyMemory(*Target, Source, sizeof(IO_RESOURCE_DESCRIPTOR));
+    *TargetCount = 1;
+
+    return STATUS_TRANSLATION_COMPLETE;
+}
+
+/* FUNCTIONS ****************************************************************/
+
+NTSTATUS
+NTAPI
+HalpGetInterruptTranslator(
+    _In_ INTERFACE_TYPE ParentInterfaceType,
+    _In_ ULONG ParentBusNumber,
+    _In_ INTERFACE_TYPE BridgeInterfaceType,
+    _In_ USHORT Size,
+    _In_ USHORT Version,
+    _Out_ PTRANSLATOR_INTERFACE Translator,
+    _Out_ PULONG BridgeBusNumber)
+{
+    PAGED_CODE();
+
+    ASSERT(Version == HAL_IRQ_TRANSLATOR_VERSION);
+    ASSERT(Size >= sizeof(TRANSLATOR_INTERFACE));
+
+    if (BridgeInterfaceType == Internal || BridgeInterfaceType >= MaximumInterfaceType)
+    {
+        return STATUS_NOT_IMPLEMENTED;
+    }
+
+    Translator->Size = sizeof(TRANSLATOR_INTERFACE);
+    Translator->Version = HAL_IRQ_TRANSLATOR_VERSION;
+    Translator->Context = UlongToPtr((BridgeInterfaceType == InterfaceTypeUndefined) ? Isa : BridgeInterfaceType);
+    Translator->InterfaceReference = HalpTranslatorReference;
+    Translator->InterfaceDereference = HalpTranslatorReference;
+    Translator->TranslateResources = HalpTranslateInterruptResource;
+    Translator->TranslateResourceRequirements = HalpTranslateInterruptRequirement;
+
+    return STATUS_SUCCESS;
+}
+
+#endif /* NTDDI_VERSION >= NTDDI_VISTA */
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+HalGetMessageRoutingInfo(
+    _In_ ULONG Vector,
+    _In_ KAFFINITY Affinity,
+    _Out_ PPHYSICAL_ADDRESS MessageAddress,
+    _Out_ PULONG MessageData)
+{
+    ULONG Processor, Destination, MessageType;
+
+    if (!HalpIsMessageVector(Vector))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Build the logical destination, like the I/O APIC redirection entries */
+    Destination = 0;
+    for (Processor = 0; Processor < MSI_MAX_TARGETS; Processor++)
+    {
+        if (Affinity & ((KAFFINITY)1 << Processor))
+            Destination |= ApicLogicalId(Processor);
+    }
+
+    if (Destination == 0)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* A single processor gets the message directly, otherwise let the APICs arbitrate */
+    MessageType = (Destination & (Destination - 1)) ? APIC_MT_LowestPriority : APIC_MT_Fixed;
+
+    MessageAddress->QuadPart = APIC_MSI_ADDRESS_BASE |
+                               (Destination << APIC_MSI_ADDRESS_DEST_SHIFT) |
+                               APIC_MSI_ADDRESS_RH |
+                               APIC_MSI_ADDRESS_DM_LOGICAL;
+
+    /* Edge triggered */
+    *MessageData = Vector | (MessageType << APIC_MSI_DATA_MT_SHIFT);
+
+    return STATUS_SUCCESS;
+}
+
+/* EOF */
@@ -1262,6 +1262,21 @@ HalpGetRootInterruptVector(IN ULONG BusInterruptLevel,
     return SystemVector;
 }
 
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+HalGetMessageRoutingInfo(
+    _In_ ULONG Vector,
+    _In_ KAFFINITY Affinity,
+    _Out_ PPHYSICAL_ADDRESS MessageAddress,
+    _Out_ PULONG MessageData)
+{
+    /* The 8259 has no message signaled interrupts */
+    return STATUS_NOT_SUPPORTED;
+}
+
 #else /* _MINIHAL_ */
 
 KIRQL
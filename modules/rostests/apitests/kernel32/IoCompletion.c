@@ -0,0 +1,209 @@
+/*
+ * PROJECT:     ReactOS API tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Tests for GetQueuedCompletionStatusEx and completion notification modes
+ */
+
+#include "precomp.h"
+
+#ifndef FILE_SKIP_COMPLETION_PORT_ON_SUCCESS
+#define FILE_SKIP_COMPLETION_PORT_ON_SUCCESS 0x1
+#define FILE_SKIP_SET_EVENT_ON_HANDLE        0x2
+#endif
+
+typedef
+BOOL
+WINAPI
+FN_GetQueuedCompletionStatusEx(
+    _In_ HANDLE CompletionPort,
+    _Out_writes_to_(ulCount, *ulNumEntriesRemoved) LPOVERLAPPED_ENTRY lpCompletionPortEntries,
+    _In_ ULONG ulCount,
+    _Out_ PULONG ulNumEntriesRemoved,
+    _In_ DWORD dwMilliseconds,
+    _In_ BOOL fAlertable);
+
+typedef
+BOOL
+WINAPI
+FN_SetFileCompletionNotificationModes(
+    _In_ HANDLE FileHandle,
+    _In_ UCHAR Flags);
+
+static FN_GetQueuedCompletionStatusEx *pGetQueuedCompletionStatusEx;
+static FN_SetFileCompletionNotificationModes *pSetFileCompletionNotificationModes;
+
+static ULONG ApcCount;
+
+static
+VOID
+NTAPI
+ApcRoutine(ULONG_PTR Parameter)
+{
+    ApcCount++;
+}
+
+static
+VOID
+TestBatchedRemoval(VOID)
+{
+    OVERLAPPED_ENTRY Entries[8];
+    ULONG Removed, i;
+    HANDLE Port;
+    BOOL ret;
+
+    Port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0);
+    ok(Port != NULL, "CreateIoCompletionPort failed: %lu\n", GetLastError());
+    if (!Port)
+        return;
+
+    /* All the queued packets come back in one call, in order */
+    for (i = 0; i < 5; i++)
+    {
+        ret = PostQueuedCompletionStatus(Port, 100 + i, 10 + i, (LPOVERLAPPED)(ULONG_PTR)(20 + i));
+        ok(ret, "PostQueuedCompletionStatus failed: %lu\n", GetLastError());
+    }
+
+    Removed = 0xdeadbeef;
+    ret = pGetQueuedCompletionStatusEx(Port, Entries, ARRAYSIZE(Entries), &Removed, 0, FALSE);
+    ok(ret, "GetQueuedCompletionStatusEx failed: %lu\n", GetLastError());
+    ok(Removed == 5, "Removed = %lu\n", Removed);
+    for (i = 0; i < min(Removed, 5); i++)
+    {
+        ok(Entries[i].lpCompletionKey == 10 + i, "Entry %lu: key %lu\n", i, (ULONG)Entries[i].lpCompletionKey);
+        ok(Entries[i].lpOverlapped == (LPOVERLAPPED)(ULONG_PTR)(20 + i), "Entry %lu: overlapped %p\n", i, Entries[i].lpOverlapped);
+        ok(Entries[i].dwNumberOfBytesTransferred == 100 + i, "Entry %lu: bytes %lu\n", i, Entries[i].dwNumberOfBytesTransferred);
+    }
+
+    /* No more than asked for */
+    for (i = 0; i < 3; i++)
+        PostQueuedCompletionStatus(Port, 0, i, NULL);
+
+    ret = pGetQueuedCompletionStatusEx(Port, Entries, 2, &Removed, 0, FALSE);
+    ok(ret && Removed == 2, "ret %d, Removed = %lu\n", ret, Removed);
+    ret = pGetQueuedCompletionStatusEx(Port, Entries, 2, &Removed, 0, FALSE);
+    ok(ret && Removed == 1, "ret %d, Removed = %lu\n", ret, Removed);
+    ok(Entries[0].lpCompletionKey == 2, "Key %lu\n", (ULONG)Entries[0].lpCompletionKey);
+
+    /* Empty port */
+    SetLastError(0xdeadbeef);
+    Removed = 0xdeadbeef;
+    ret = pGetQueuedCompletionStatusEx(Port, Entries, ARRAYSIZE(Entries), &Removed, 10, FALSE);
+    ok(!ret, "GetQueuedCompletionStatusEx succeeded\n");
+    ok(GetLastError() == WAIT_TIMEOUT, "Error %lu\n", GetLastError());
+    ok(Removed == 0, "Removed = %lu\n", Removed);
+
+    /* No room */
+    SetLastError(0xdeadbeef);
+    ret = pGetQueuedCompletionStatusEx(Port, Entries, 0, &Removed, 0, FALSE);
+    ok(!ret, "GetQueuedCompletionStatusEx succeeded\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "Error %lu\n", GetLastError());
+
+    /* An alertable wait runs the APC instead */
+    ApcCount = 0;
+    ok(QueueUserAPC(ApcRoutine, GetCurrentThread(), 0), "QueueUserAPC failed: %lu\n", GetLastError());
+    SetLastError(0xdeadbeef);
+    ret = pGetQueuedCompletionStatusEx(Port, Entries, ARRAYSIZE(Entries), &Removed, 5000, TRUE);
+    ok(!ret, "GetQueuedCompletionStatusEx succeeded\n");
+    ok(GetLastError() == WAIT_IO_COMPLETION, "Error %lu\n", GetLastError());
+    ok(ApcCount == 1, "ApcCount = %lu\n", ApcCount);
+
+    CloseHandle(Port);
+}
+
+static
+VOID
+TestSkipCompletionPort(VOID)
+{
+    static const CHAR PipeName[] = "\\\\.\\pipe\\IoCompletionTest";
+    OVERLAPPED_ENTRY Entries[4];
+    OVERLAPPED WriteOverlapped, ReadOverlapped;
+    CHAR Buffer[16];
+    HANDLE Server, Client, Port;
+    ULONG Removed;
+    DWORD Bytes;
+    BOOL ret;
+
+    Server = CreateNamedPipeA(PipeName, PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+                              PIPE_TYPE_BYTE | PIPE_WAIT, 1, 4096, 4096, 0, NULL);
+    ok(Server != INVALID_HANDLE_VALUE, "CreateNamedPipe failed: %lu\n", GetLastError());
+    if (Server == INVALID_HANDLE_VALUE)
+        return;
+
+    Client = CreateFileA(PipeName, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                         OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+    ok(Client != INVALID_HANDLE_VALUE, "CreateFile failed: %lu\n", GetLastError());
+    if (Client == INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(Server);
+        return;
+    }
+
+    Port = CreateIoCompletionPort(Client, NULL, 42, 0);
+    ok(Port != NULL, "CreateIoCompletionPort failed: %lu\n", GetLastError());
+
+    /* Only the defined modes are accepted */
+    SetLastError(0xdeadbeef);
+    ok(!pSetFileCompletionNotificationModes(Client, 0x80), "SetFileCompletionNotificationModes succeeded\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "Error %lu\n", GetLastError());
+
+    ret = pSetFileCompletionNotificationModes(Client, FILE_SKIP_COMPLETION_PORT_ON_SUCCESS | FILE_SKIP_SET_EVENT_ON_HANDLE);
+    ok(ret, "SetFileCompletionNotificationModes failed: %lu\n", GetLastError());
+
+    /* A write that fits in the pipe buffer succeeds right away and queues nothing */
+    ZeroMemory(&WriteOverlapped, sizeof(WriteOverlapped));
+    ret = WriteFile(Client, "hello", 5, &Bytes, &WriteOverlapped);
+    ok(ret, "WriteFile failed: %lu\n", GetLastError());
+    ok(Bytes == 5, "Bytes = %lu\n", Bytes);
+
+    SetLastError(0xdeadbeef);
+    ret = pGetQueuedCompletionStatusEx(Port, Entries, ARRAYSIZE(Entries), &Removed, 0, FALSE);
+    ok(!ret, "Got %lu packets for a synchronous success\n", Removed);
+    ok(GetLastError() == WAIT_TIMEOUT, "Error %lu\n", GetLastError());
+
+    /* A read that has to wait still gets its packet */
+    ZeroMemory(&ReadOverlapped, sizeof(ReadOverlapped));
+    ret = ReadFile(Client, Buffer, sizeof(Buffer), NULL, &ReadOverlapped);
+    ok(!ret && GetLastError() == ERROR_IO_PENDING, "ReadFile returned %d, error %lu\n", ret, GetLastError());
+
+    ZeroMemory(&WriteOverlapped, sizeof(WriteOverlapped));
+    WriteOverlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ret = WriteFile(Server, "world", 5, NULL, &WriteOverlapped);
+    ok(ret || GetLastError() == ERROR_IO_PENDING, "WriteFile failed: %lu\n", GetLastError());
+
+    ret = pGetQueuedCompletionStatusEx(Port, Entries, ARRAYSIZE(Entries), &Removed, 5000, FALSE);
+    ok(ret, "GetQueuedCompletionStatusEx failed: %lu\n", GetLastError());
+    ok(ret && Removed == 1, "Removed = %lu\n", Removed);
+    if (ret && Removed == 1)
+    {
+        ok(Entries[0].lpCompletionKey == 42, "Key %lu\n", (ULONG)Entries[0].lpCompletionKey);
+        ok(Entries[0].lpOverlapped == &ReadOverlapped, "Overlapped %p\n", Entries[0].lpOverlapped);
+        ok(Entries[0].dwNumberOfBytesTransferred == 5, "Bytes %lu\n", Entries[0].dwNumberOfBytesTransferred);
+        ok(!memcmp(Buffer, "world", 5), "Wrong data\n");
+    }
+
+    /* The handle itself was not signaled for it */
+    ok(WaitForSingleObject(Client, 0) == WAIT_TIMEOUT, "The file handle was signaled\n");
+
+    CloseHandle(WriteOverlapped.hEvent);
+    CloseHandle(Port);
+    CloseHandle(Client);
+    CloseHandle(Server);
+}
+
+START_TEST(IoCompletion)
+{
+    HMODULE hKernel32 = GetModuleHandleW(L"kernel32.dll");
+
+    pGetQueuedCompletionStatusEx = (FN_GetQueuedCompletionStatusEx *)
+        GetProcAddress(hKernel32, "GetQueuedCompletionStatusEx");
+    pSetFileCompletionNotificationModes = (FN_SetFileCompletionNotificationModes *)
+        GetProcAddress(hKernel32, "SetFileCompletionNotificationModes");
+    if (!pGetQueuedCompletionStatusEx || !pSetFileCompletionNotificationModes)
+    {
+        skip("GetQueuedCompletionStatusEx or SetFileCompletionNotificationModes not available\n");
+        return;
+    }
+
+    TestBatchedRemoval();
+    TestSkipCompletionPort();
+}
@@ -0,0 +1,184 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Test for 4K random read throughput on the system disk at different queue depths
+ */
+
+#include "precomp.h"
+
+#include <winioctl.h>
+
+#define READ_SIZE        4096
+#define READ_COUNT       4096
+#define MAX_QUEUE_DEPTH  32
+
+typedef struct _READ_SLOT
+{
+    OVERLAPPED Overlapped;
+    PVOID Buffer;
+} READ_SLOT, *PREAD_SLOT;
+
+static
+BOOL
+IssueRead(
+    _In_ HANDLE Disk,
+    _Inout_ PREAD_SLOT Slot,
+    _In_ ULONGLONG DiskSize,
+    _Inout_ PULONG Seed)
+{
+    ULARGE_INTEGER Offset;
+    DWORD Error;
+
+    /* Pick an aligned block anywhere on the disk */
+    Offset.QuadPart = ((((ULONGLONG)RtlRandom(Seed) << 31) | RtlRandom(Seed)) % (DiskSize / READ_SIZE)) * READ_SIZE;
+    Slot->Overlapped.Offset = Offset.LowPart;
+    Slot->Overlapped.OffsetHigh = Offset.HighPart;
+    ResetEvent(Slot->Overlapped.hEvent);
+
+    if (ReadFile(Disk, Slot->Buffer, READ_SIZE, NULL, &Slot->Overlapped))
+        return TRUE;
+
+    Error = GetLastError();
+    ok(Error == ERROR_IO_PENDING, "ReadFile failed with %lu\n", Error);
+    return (Error == ERROR_IO_PENDING);
+}
+
+static
+VOID
+MeasureRandomReads(
+    _In_ HANDLE Disk,
+    _In_ ULONGLONG DiskSize,
+    _In_ ULONG QueueDepth)
+{
+    READ_SLOT Slots[MAX_QUEUE_DEPTH];
+    HANDLE Events[MAX_QUEUE_DEPTH];
+    LARGE_INTEGER Frequency, Start, End;
+    ULONGLONG Microseconds;
+    ULONG Seed = 0x5eed + QueueDepth;
+    ULONG Issued, Completed, Outstanding, i;
+    DWORD Wait, Transferred;
+
+    ZeroMemory(Slots, sizeof(Slots));
+    for (i = 0; i < QueueDepth; i++)
+    {
+        Slots[i].Overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+        Slots[i].Buffer = VirtualAlloc(NULL, READ_SIZE, MEM_COMMIT, PAGE_READWRITE);
+        Events[i] = Slots[i].Overlapped.hEvent;
+        if (!Slots[i].Overlapped.hEvent || !Slots[i].Buffer)
+        {
+            skip("Out of resources\n");
+            goto Cleanup;
+        }
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    /* Keep QueueDepth reads in flight until READ_COUNT of them have completed */
+    Issued = Completed = Outstanding = 0;
+    for (i = 0; i < QueueDepth; i++)
+    {
+        if (!IssueRead(Disk, &Slots[i], DiskSize, &Seed))
+            goto Drain;
+        Issued++;
+        Outstanding++;
+    }
+
+    while (Completed < READ_COUNT)
+    {
+        Wait = WaitForMultipleObjects(QueueDepth, Events, FALSE, 10000);
+        ok(Wait < WAIT_OBJECT_0 + QueueDepth, "Wait returned %lu\n", Wait);
+        if (Wait >= WAIT_OBJECT_0 + QueueDepth)
+            goto Drain;
+
+        i = Wait - WAIT_OBJECT_0;
+        if (!GetOverlappedResult(Disk, &Slots[i].Overlapped, &Transferred, FALSE) || Transferred != READ_SIZE)
+        {
+            ok(FALSE, "Read failed with %lu, %lu bytes\n", GetLastError(), Transferred);
+            Outstanding--;
+            goto Drain;
+        }
+
+        Completed++;
+        Outstanding--;
+
+        if (Issued < READ_COUNT)
+        {
+            if (!IssueRead(Disk, &Slots[i], DiskSize, &Seed))
+                goto Drain;
+            Issued++;
+            Outstanding++;
+        }
+        else
+        {
+            /* Nothing left to issue, don't wake up on this slot again */
+            ResetEvent(Slots[i].Overlapped.hEvent);
+            if (Outstanding == 0)
+                break;
+        }
+    }
+
+    QueryPerformanceCounter(&End);
+
+    Microseconds = (End.QuadPart - Start.QuadPart) * 1000000ULL / Frequency.QuadPart;
+    if (Microseconds == 0)
+        Microseconds = 1;
+
+    trace("Queue depth %2lu: %lu reads in %I64u us, %I64u IOPS\n",
+          QueueDepth, Completed, Microseconds, (ULONGLONG)Completed * 1000000ULL / Microseconds);
+
+Drain:
+    if (Outstanding != 0)
+    {
+        CancelIo(Disk);
+        for (i = 0; i < QueueDepth; i++)
+            GetOverlappedResult(Disk, &Slots[i].Overlapped, &Transferred, TRUE);
+    }
+
+Cleanup:
+    for (i = 0; i < QueueDepth; i++)
+    {
+        if (Slots[i].Overlapped.hEvent)
+            CloseHandle(Slots[i].Overlapped.hEvent);
+        if (Slots[i].Buffer)
+            VirtualFree(Slots[i].Buffer, 0, MEM_RELEASE);
+    }
+}
+
+START_TEST(RandomReadPerf)
+{
+    static const ULONG QueueDepths[] = { 1, 4, MAX_QUEUE_DEPTH };
+    GET_LENGTH_INFORMATION LengthInfo;
+    HANDLE Disk;
+    DWORD Returned;
+    ULONG i;
+
+    /* Unbuffered, so every read goes down to the disk driver */
+    Disk = CreateFileW(L"\\\\.\\PhysicalDrive0",
+                       GENERIC_READ,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING,
+                       NULL);
+    if (Disk == INVALID_HANDLE_VALUE)
+    {
+        skip("Cannot open the system disk: %lu\n", GetLastError());
+        return;
+    }
+
+    if (!DeviceIoControl(Disk, IOCTL_DISK_GET_LENGTH_INFO, NULL, 0, &LengthInfo, sizeof(LengthInfo), &Returned, NULL) ||
+        LengthInfo.Length.QuadPart < READ_SIZE * 16)
+    {
+        skip("Cannot get the disk size: %lu\n", GetLastError());
+        CloseHandle(Disk);
+        return;
+    }
+
+    for (i = 0; i < RTL_NUMBER_OF(QueueDepths); i++)
+    {
+        MeasureRandomReads(Disk, LengthInfo.Length.QuadPart, QueueDepths[i]);
+    }
+
+    CloseHandle(Disk);
+}
@@ -0,0 +1,484 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests for WaitOnAddress, condition variable wakes and lock contention
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include "precomp.h"
+
+typedef BOOL WINAPI FN_WaitOnAddress(volatile VOID *, PVOID, SIZE_T, DWORD);
+typedef VOID WINAPI FN_WakeByAddress(PVOID);
+typedef VOID WINAPI FN_SRWLockFunc(PRTL_SRWLOCK);
+typedef BOOL WINAPI FN_SleepConditionVariableSRW(PRTL_CONDITION_VARIABLE, PRTL_SRWLOCK, DWORD, ULONG);
+typedef VOID WINAPI FN_WakeConditionVariable(PRTL_CONDITION_VARIABLE);
+
+static FN_WaitOnAddress *pWaitOnAddress;
+static FN_WakeByAddress *pWakeByAddressSingle;
+static FN_WakeByAddress *pWakeByAddressAll;
+static FN_SRWLockFunc *pAcquireSRWLockExclusive;
+static FN_SRWLockFunc *pReleaseSRWLockExclusive;
+static FN_SleepConditionVariableSRW *pSleepConditionVariableSRW;
+static FN_WakeConditionVariable *pWakeConditionVariable;
+static FN_WakeConditionVariable *pWakeAllConditionVariable;
+
+#define WAITER_COUNT        4
+#define BENCH_THREADS       4
+#define BENCH_ITERATIONS    20000
+#define RACE_WAITERS        3
+#define RACE_ITEMS          2000
+
+static volatile LONG g_Value;
+static volatile LONG g_Woken;
+
+static
+DWORD
+WINAPI
+WaiterThread(
+    _In_ PVOID Parameter)
+{
+    LONG Compare = 0;
+
+    UNREFERENCED_PARAMETER(Parameter);
+
+    while (g_Value == Compare)
+    {
+        pWaitOnAddress(&g_Value, &Compare, sizeof(Compare), INFINITE);
+    }
+
+    InterlockedIncrement(&g_Woken);
+    return 0;
+}
+
+static
+VOID
+TestBasic(VOID)
+{
+    ULONGLONG Value64 = 0x1122334455667788ULL, Compare64;
+    UCHAR Value8 = 1, Compare8;
+    LONG Value = 5, Compare;
+    DWORD Start, Error;
+    BOOL Ret;
+
+    /* A value that already changed returns right away */
+    Compare = 4;
+    Ret = pWaitOnAddress(&Value, &Compare, sizeof(Compare), INFINITE);
+    ok(Ret == TRUE, "WaitOnAddress returned %d\n", Ret);
+
+    Compare8 = 2;
+    Ret = pWaitOnAddress(&Value8, &Compare8, sizeof(Compare8), INFINITE);
+    ok(Ret == TRUE, "WaitOnAddress returned %d\n", Ret);
+
+    Compare64 = 0x1122334455667789ULL;
+    Ret = pWaitOnAddress(&Value64, &Compare64, sizeof(Compare64), INFINITE);
+    ok(Ret == TRUE, "WaitOnAddress returned %d\n", Ret);
+
+    /* A matching value waits for the timeout */
+    Compare = 5;
+    Start = GetTickCount();
+    SetLastError(0xdeadbeef);
+    Ret = pWaitOnAddress(&Value, &Compare, sizeof(Compare), 50);
+    Error = GetLastError();
+    ok(Ret == FALSE, "WaitOnAddress returned %d\n", Ret);
+    ok(Error == ERROR_TIMEOUT, "Error = %lu\n", Error);
+    ok(GetTickCount() - Start >= 40, "Returned after %lu ms\n", GetTickCount() - Start);
+
+    Ret = pWaitOnAddress(&Value, &Compare, sizeof(Compare), 0);
+    ok(Ret == FALSE, "WaitOnAddress returned %d\n", Ret);
+
+    /* Invalid sizes */
+    SetLastError(0xdeadbeef);
+    Ret = pWaitOnAddress(&Value, &Compare, 3, 0);
+    Error = GetLastError();
+    ok(Ret == FALSE, "WaitOnAddress returned %d\n", Ret);
+    ok(Error == ERROR_INVALID_PARAMETER, "Error = %lu\n", Error);
+
+    /* Nobody is waiting, nothing happens */
+    pWakeByAddressSingle(&Value);
+    pWakeByAddressAll(&Value);
+}
+
+static
+VOID
+TestWake(VOID)
+{
+    HANDLE Threads[WAITER_COUNT];
+    ULONG i;
+    DWORD Wait;
+
+    g_Value = 0;
+    g_Woken = 0;
+
+    for (i = 0; i < WAITER_COUNT; i++)
+    {
+        Threads[i] = CreateThread(NULL, 0, WaiterThread, NULL, 0, NULL);
+        ok(Threads[i] != NULL, "CreateThread failed with %lu\n", GetLastError());
+        if (!Threads[i])
+        {
+            skip("Not enough threads\n");
+            g_Value = 1;
+            pWakeByAddressAll((PVOID)&g_Value);
+            WaitForMultipleObjects(i, Threads, TRUE, INFINITE);
+            return;
+        }
+    }
+
+    /* Give the threads time to go to sleep, a wake without a change is ignored */
+    Sleep(100);
+    pWakeByAddressSingle((PVOID)&g_Value);
+    Sleep(50);
+    ok(g_Woken == 0, "%ld threads returned\n", g_Woken);
+
+    /* All of them see the new value once woken */
+    g_Value = 1;
+    pWakeByAddressAll((PVOID)&g_Value);
+
+    Wait = WaitForMultipleObjects(WAITER_COUNT, Threads, TRUE, 5000);
+    ok(Wait == WAIT_OBJECT_0, "Wait = %lu\n", Wait);
+    ok(g_Woken == WAITER_COUNT, "%ld threads returned\n", g_Woken);
+
+    for (i = 0; i < WAITER_COUNT; i++)
+        CloseHandle(Threads[i]);
+}
+
+/*
+ * A wake-one that lands on a waiter whose timeout just expired must still
+ * count as a wake for it. One consumer sleeps without a timeout, a few
+ * others time out all the time and only take an item when they were woken.
+ * If one of them lost a wake, the item would sit there with the patient
+ * consumer asleep.
+ */
+
+static RTL_SRWLOCK g_RaceLock;
+static RTL_CONDITION_VARIABLE g_RaceCondVar;
+static ULONG g_RaceItems;
+static volatile BOOL g_RaceDone;
+static HANDLE g_RaceTakenEvent;
+
+static
+DWORD
+WINAPI
+PatientConsumerThread(
+    _In_ PVOID Parameter)
+{
+    UNREFERENCED_PARAMETER(Parameter);
+
+    pAcquireSRWLockExclusive(&g_RaceLock);
+    for (;;)
+    {
+        while (g_RaceItems == 0 && !g_RaceDone)
+            pSleepConditionVariableSRW(&g_RaceCondVar, &g_RaceLock, INFINITE, 0);
+
+        if (g_RaceItems == 0)
+            break;
+
+        g_RaceItems--;
+        SetEvent(g_RaceTakenEvent);
+    }
+    pReleaseSRWLockExclusive(&g_RaceLock);
+
+    return 0;
+}
+
+static
+DWORD
+WINAPI
+ImpatientConsumerThread(
+    _In_ PVOID Parameter)
+{
+    UNREFERENCED_PARAMETER(Parameter);
+
+    pAcquireSRWLockExclusive(&g_RaceLock);
+    while (!g_RaceDone)
+    {
+        if (pSleepConditionVariableSRW(&g_RaceCondVar, &g_RaceLock, 1, 0) &&
+            g_RaceItems != 0)
+        {
+            g_RaceItems--;
+            SetEvent(g_RaceTakenEvent);
+        }
+    }
+    pReleaseSRWLockExclusive(&g_RaceLock);
+
+    return 0;
+}
+
+static
+VOID
+TestConditionVariableTimeoutRace(VOID)
+{
+    HANDLE Threads[RACE_WAITERS + 1];
+    ULONG Count, i;
+    DWORD Wait;
+
+    if (!pSleepConditionVariableSRW || !pWakeConditionVariable || !pWakeAllConditionVariable ||
+        !pAcquireSRWLockExclusive || !pReleaseSRWLockExclusive)
+    {
+        skip("Condition variables are not available\n");
+        return;
+    }
+
+    g_RaceLock.Ptr = NULL;
+    g_RaceCondVar.Ptr = NULL;
+    g_RaceItems = 0;
+    g_RaceDone = FALSE;
+    g_RaceTakenEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    ok(g_RaceTakenEvent != NULL, "CreateEvent failed with %lu\n", GetLastError());
+    if (!g_RaceTakenEvent)
+        return;
+
+    for (Count = 0; Count < ARRAYSIZE(Threads); Count++)
+    {
+        Threads[Count] = CreateThread(NULL, 0,
+                                      Count ? ImpatientConsumerThread : PatientConsumerThread,
+                                      NULL, 0, NULL);
+        ok(Threads[Count] != NULL, "CreateThread failed with %lu\n", GetLastError());
+        if (!Threads[Count])
+            break;
+    }
+
+    for (i = 0; Count > 1 && i < RACE_ITEMS; i++)
+    {
+        pAcquireSRWLockExclusive(&g_RaceLock);
+        g_RaceItems++;
+        pWakeConditionVariable(&g_RaceCondVar);
+        pReleaseSRWLockExclusive(&g_RaceLock);
+
+        /* Somebody always takes it, unless the wake went missing */
+        Wait = WaitForSingleObject(g_RaceTakenEvent, 5000);
+        ok(Wait == WAIT_OBJECT_0, "Item %lu was not taken, wait = %lu\n", i, Wait);
+        if (Wait != WAIT_OBJECT_0)
+            break;
+    }
+
+    pAcquireSRWLockExclusive(&g_RaceLock);
+    g_RaceDone = TRUE;
+    g_RaceItems = 0;
+    pWakeAllConditionVariable(&g_RaceCondVar);
+    pReleaseSRWLockExclusive(&g_RaceLock);
+
+    Wait = WaitForMultipleObjects(Count, Threads, TRUE, 5000);
+    ok(Wait == WAIT_OBJECT_0, "Wait = %lu\n", Wait);
+
+    while (Count--)
+        CloseHandle(Threads[Count]);
+    CloseHandle(g_RaceTakenEvent);
+}
+
+/* Contention benchmark: the same critical section protected in different ways */
+
+typedef enum _LOCK_KIND
+{
+    LockEvent,
+    LockAddress,
+    LockSRW,
+    LockKindMax
+} LOCK_KIND;
+
+static const char *g_LockNames[LockKindMax] = { "event", "WaitOnAddress", "SRW" };
+
+static LOCK_KIND g_LockKind;
+static volatile LONG g_EventLockCount;
+static HANDLE g_EventLockEvent;
+static volatile LONG g_AddressLock;
+static RTL_SRWLOCK g_SrwLock;
+static ULONG g_Counter;
+
+static
+VOID
+AcquireBenchLock(VOID)
+{
+    LONG Contended = 2, State;
+
+    switch (g_LockKind)
+    {
+        case LockEvent:
+            /* The old way, a kernel object round trip for every contended acquire */
+            if (InterlockedIncrement(&g_EventLockCount) != 1)
+                WaitForSingleObject(g_EventLockEvent, INFINITE);
+            break;
+
+        case LockAddress:
+            /* 0 free, 1 owned, 2 owned with waiters */
+            State = InterlockedCompareExchange(&g_AddressLock, 1, 0);
+            if (State != 0)
+            {
+                if (State != 2)
+                    State = InterlockedExchange(&g_AddressLock, 2);
+
+                while (State != 0)
+                {
+                    pWaitOnAddress(&g_AddressLock, &Contended, sizeof(Contended), INFINITE);
+                    State = InterlockedExchange(&g_AddressLock, 2);
+                }
+            }
+            break;
+
+        case LockSRW:
+            pAcquireSRWLockExclusive(&g_SrwLock);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static
+VOID
+ReleaseBenchLock(VOID)
+{
+    switch (g_LockKind)
+    {
+        case LockEvent:
+            if (InterlockedDecrement(&g_EventLockCount) != 0)
+                SetEvent(g_EventLockEvent);
+            break;
+
+        case LockAddress:
+            if (InterlockedExchange(&g_AddressLock, 0) == 2)
+                pWakeByAddressSingle((PVOID)&g_AddressLock);
+            break;
+
+        case LockSRW:
+            pReleaseSRWLockExclusive(&g_SrwLock);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static
+DWORD
+WINAPI
+BenchThread(
+    _In_ PVOID Parameter)
+{
+    ULONG i;
+
+    UNREFERENCED_PARAMETER(Parameter);
+
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        AcquireBenchLock();
+        g_Counter++;
+        ReleaseBenchLock();
+    }
+
+    return 0;
+}
+
+static
+VOID
+TestContention(VOID)
+{
+    HANDLE Threads[BENCH_THREADS];
+    LARGE_INTEGER Frequency, Start, End;
+    ULONG Kind, i;
+
+    g_EventLockEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    ok(g_EventLockEvent != NULL, "CreateEvent failed with %lu\n", GetLastError());
+    if (!g_EventLockEvent)
+        return;
+
+    g_SrwLock.Ptr = NULL;
+    QueryPerformanceFrequency(&Frequency);
+
+    for (Kind = 0; Kind < LockKindMax; Kind++)
+    {
+        if (Kind == LockAddress && (!pWaitOnAddress || !pWakeByAddressSingle))
+            continue;
+        if (Kind == LockSRW && (!pAcquireSRWLockExclusive || !pReleaseSRWLockExclusive))
+            continue;
+
+        g_LockKind = (LOCK_KIND)Kind;
+        g_Counter = 0;
+
+        QueryPerformanceCounter(&Start);
+
+        for (i = 0; i < BENCH_THREADS; i++)
+        {
+            Threads[i] = CreateThread(NULL, 0, BenchThread, NULL, 0, NULL);
+            ok(Threads[i] != NULL, "CreateThread failed with %lu\n", GetLastError());
+            if (!Threads[i])
+                break;
+        }
+
+        WaitForMultipleObjects(i, Threads, TRUE, INFINITE);
+        QueryPerformanceCounter(&End);
+
+        ok(g_Counter == i * BENCH_ITERATIONS, "%s lock: counter = %lu\n", g_LockNames[Kind], g_Counter);
+        trace("%s lock: %lu threads x %u iterations in %I64u ms\n",
+              g_LockNames[Kind], i, BENCH_ITERATIONS,
+              (End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart);
+
+        while (i--)
+            CloseHandle(Threads[i]);
+    }
+
+    CloseHandle(g_EventLockEvent);
+}
+
+static
+FARPROC
+GetSynchProc(
+    _In_ PCSTR Name)
+{
+    /* WaitOnAddress is only in kernel32 on NT6.2+ builds, but kernel32_vista always has it */
+    static const PCWSTR Modules[] = { L"kernel32.dll", L"kernel32_vista.dll", L"api-ms-win-core-synch-l1-2-0.dll" };
+    FARPROC Proc;
+    HMODULE hModule;
+    ULONG i;
+
+    for (i = 0; i < ARRAYSIZE(Modules); i++)
+    {
+        hModule = GetModuleHandleW(Modules[i]);
+        if (!hModule)
+            hModule = LoadLibraryW(Modules[i]);
+        if (!hModule)
+            continue;
+
+        Proc = GetProcAddress(hModule, Name);
+        if (Proc)
+            return Proc;
+    }
+
+    return NULL;
+}
+
+static
+VOID
+InitFunctions(VOID)
+{
+    pWaitOnAddress = (FN_WaitOnAddress *)GetSynchProc("WaitOnAddress");
+    pWakeByAddressSingle = (FN_WakeByAddress *)GetSynchProc("WakeByAddressSingle");
+    pWakeByAddressAll = (FN_WakeByAddress *)GetSynchProc("WakeByAddressAll");
+    pAcquireSRWLockExclusive = (FN_SRWLockFunc *)GetSynchProc("AcquireSRWLockExclusive");
+    pReleaseSRWLockExclusive = (FN_SRWLockFunc *)GetSynchProc("ReleaseSRWLockExclusive");
+    pSleepConditionVariableSRW = (FN_SleepConditionVariableSRW *)GetSynchProc("SleepConditionVariableSRW");
+    pWakeConditionVariable = (FN_WakeConditionVariable *)GetSynchProc("WakeConditionVariable");
+    pWakeAllConditionVariable = (FN_WakeConditionVariable *)GetSynchProc("WakeAllConditionVariable");
+}
+
+START_TEST(WaitOnAddress)
+{
+    InitFunctions();
+
+    /* Condition variables sit on top of RtlWaitOnAddress, whether it is exported or not */
+    TestConditionVariableTimeoutRace();
+
+    if (!pWaitOnAddress || !pWakeByAddressSingle || !pWakeByAddressAll)
+    {
+        skip("WaitOnAddress is not available\n");
+        return;
+    }
+
+    TestBasic();
+    TestWake();
+}
+
+START_TEST(LockContentionPerf)
+{
+    InitFunctions();
+    TestContention();
+}
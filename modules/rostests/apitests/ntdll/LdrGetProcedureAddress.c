@@ -0,0 +1,168 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Test for LdrGetProcedureAddress and process startup timing
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include "precomp.h"
+
+typedef DWORD WINAPI FN_WaitForInputIdle(HANDLE, DWORD);
+
+static FN_WaitForInputIdle *pWaitForInputIdle;
+
+static
+ULONG
+GetMilliseconds(
+    _In_ const LARGE_INTEGER *Start,
+    _In_ const LARGE_INTEGER *End,
+    _In_ const LARGE_INTEGER *Frequency)
+{
+    return (ULONG)((End->QuadPart - Start->QuadPart) * 1000 / Frequency->QuadPart);
+}
+
+static
+VOID
+TestModuleExports(
+    _In_ PCWSTR ModuleName)
+{
+    PIMAGE_EXPORT_DIRECTORY ExportDirectory;
+    LARGE_INTEGER Frequency, Start, End;
+    PVOID ByName, ByOrdinal;
+    ANSI_STRING ProcName;
+    PUSHORT OrdinalTable;
+    PULONG NameTable;
+    NTSTATUS Status;
+    HMODULE Module;
+    ULONG Size, i, Mismatches = 0;
+
+    Module = LoadLibraryW(ModuleName);
+    if (!Module)
+    {
+        skip("%S not available\n", ModuleName);
+        return;
+    }
+
+    ExportDirectory = RtlImageDirectoryEntryToData(Module, TRUE, IMAGE_DIRECTORY_ENTRY_EXPORT, &Size);
+    ok(ExportDirectory != NULL, "%S has no exports\n", ModuleName);
+    if (!ExportDirectory)
+    {
+        FreeLibrary(Module);
+        return;
+    }
+
+    NameTable = (PULONG)((ULONG_PTR)Module + ExportDirectory->AddressOfNames);
+    OrdinalTable = (PUSHORT)((ULONG_PTR)Module + ExportDirectory->AddressOfNameOrdinals);
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    /* Every exported name must resolve to the same address as its ordinal */
+    for (i = 0; i < ExportDirectory->NumberOfNames; i++)
+    {
+        RtlInitAnsiString(&ProcName, (PCSTR)((ULONG_PTR)Module + NameTable[i]));
+
+        ByName = ByOrdinal = NULL;
+        Status = LdrGetProcedureAddress(Module, &ProcName, 0, &ByName);
+        if (!NT_SUCCESS(Status))
+        {
+            /* Forwarders to modules that are not installed */
+            continue;
+        }
+
+        Status = LdrGetProcedureAddress(Module, NULL, ExportDirectory->Base + OrdinalTable[i], &ByOrdinal);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+
+        if (ByName != ByOrdinal && Mismatches++ < 10)
+            ok(0, "%S!%s: %p by name, %p by ordinal\n", ModuleName, ProcName.Buffer, ByName, ByOrdinal);
+    }
+
+    QueryPerformanceCounter(&End);
+
+    ok(Mismatches == 0, "%S: %lu mismatches\n", ModuleName, Mismatches);
+    trace("%S: %lu names looked up in %lu ms\n",
+          ModuleName, ExportDirectory->NumberOfNames, GetMilliseconds(&Start, &End, &Frequency));
+
+    /* Names that are not exported must still fail once the lookups are hashed */
+    RtlInitAnsiString(&ProcName, "ThisFunctionDoesNotExist");
+    ByName = (PVOID)(ULONG_PTR)0xdeadbeef;
+    Status = LdrGetProcedureAddress(Module, &ProcName, 0, &ByName);
+    ok(!NT_SUCCESS(Status), "%S: Status = 0x%lx\n", ModuleName, Status);
+
+    RtlInitAnsiString(&ProcName, "");
+    Status = LdrGetProcedureAddress(Module, &ProcName, 0, &ByName);
+    ok(!NT_SUCCESS(Status), "%S: Status = 0x%lx\n", ModuleName, Status);
+
+    FreeLibrary(Module);
+}
+
+static
+VOID
+TestStartup(
+    _In_ PCWSTR Application)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    PROCESS_INFORMATION ProcessInfo;
+    STARTUPINFOW StartupInfo;
+    WCHAR CommandLine[MAX_PATH];
+    DWORD Wait;
+
+    StringCchCopyW(CommandLine, _countof(CommandLine), Application);
+
+    ZeroMemory(&StartupInfo, sizeof(StartupInfo));
+    StartupInfo.cb = sizeof(StartupInfo);
+    StartupInfo.dwFlags = STARTF_USESHOWWINDOW;
+    StartupInfo.wShowWindow = SW_SHOWMINNOACTIVE;
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    if (!CreateProcessW(NULL, CommandLine, NULL, NULL, FALSE, 0, NULL, NULL, &StartupInfo, &ProcessInfo))
+    {
+        skip("Cannot start %S, error %lu\n", Application, GetLastError());
+        return;
+    }
+
+    /* The process is up once its imports are snapped and it waits for input */
+    Wait = pWaitForInputIdle(ProcessInfo.hProcess, 30000);
+    QueryPerformanceCounter(&End);
+
+    ok(Wait == 0, "WaitForInputIdle for %S returned %lu\n", Application, Wait);
+    if (Wait == 0)
+        trace("%S started in %lu ms\n", Application, GetMilliseconds(&Start, &End, &Frequency));
+
+    TerminateProcess(ProcessInfo.hProcess, 0);
+    WaitForSingleObject(ProcessInfo.hProcess, 5000);
+    CloseHandle(ProcessInfo.hThread);
+    CloseHandle(ProcessInfo.hProcess);
+}
+
+START_TEST(LdrGetProcedureAddress)
+{
+    TestModuleExports(L"kernel32.dll");
+    TestModuleExports(L"user32.dll");
+    TestModuleExports(L"ole32.dll");
+    TestModuleExports(L"shell32.dll");
+    TestModuleExports(L"mshtml.dll");
+}
+
+/* Starts GUI applications and depends on the machine, so it only runs when asked for */
+START_TEST(LdrStartupPerf)
+{
+    HMODULE User32;
+
+    User32 = LoadLibraryW(L"user32.dll");
+    pWaitForInputIdle = (FN_WaitForInputIdle *)GetProcAddress(User32, "WaitForInputIdle");
+    if (!pWaitForInputIdle)
+    {
+        skip("WaitForInputIdle not available\n");
+        return;
+    }
+
+    TestStartup(L"notepad.exe");
+    TestStartup(L"regedit.exe");
+    TestStartup(L"mspaint.exe");
+    TestStartup(L"wordpad.exe");
+
+    FreeLibrary(User32);
+}
@@ -0,0 +1,153 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Test loading static imports on the loader worker threads
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include "precomp.h"
+
+#define IFEO_KEY "SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\Image File Execution Options\\ntdll_apitest.exe"
+
+/* Far below the ten seconds an idle loader worker waits */
+#define CHILD_START_TIMEOUT 9000
+
+static
+const char *
+DbgStrUs(PCUNICODE_STRING String)
+{
+    return wine_dbgstr_wn(String->Buffer, String->Length / sizeof(WCHAR));
+}
+
+static
+VOID
+CheckModuleList(PCSTR When)
+{
+    PLIST_ENTRY ListHead, Entry, Other;
+    PLDR_DATA_TABLE_ENTRY LdrEntry, OtherEntry;
+    ULONG Count = 0;
+
+    ListHead = &NtCurrentPeb()->Ldr->InLoadOrderModuleList;
+    for (Entry = ListHead->Flink; Entry != ListHead; Entry = Entry->Flink)
+    {
+        LdrEntry = CONTAINING_RECORD(Entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks);
+        Count++;
+
+        ok(LdrEntry->DllBase != NULL, "%s: %s has no base\n", When, DbgStrUs(&LdrEntry->BaseDllName));
+        ok(LdrEntry->SizeOfImage != 0, "%s: %s has no size\n", When, DbgStrUs(&LdrEntry->BaseDllName));
+        ok(LdrEntry->FullDllName.Length != 0, "%s: %s has no full name\n", When, DbgStrUs(&LdrEntry->BaseDllName));
+
+        /* Every module is mapped once, whichever thread mapped it */
+        for (Other = Entry->Flink; Other != ListHead; Other = Other->Flink)
+        {
+            OtherEntry = CONTAINING_RECORD(Other, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks);
+            ok(!RtlEqualUnicodeString(&LdrEntry->FullDllName, &OtherEntry->FullDllName, TRUE),
+               "%s: %s is loaded twice\n", When, DbgStrUs(&LdrEntry->FullDllName));
+            ok(LdrEntry->DllBase != OtherEntry->DllBase,
+               "%s: %s and %s share a base\n", When, DbgStrUs(&LdrEntry->BaseDllName), DbgStrUs(&OtherEntry->BaseDllName));
+        }
+    }
+
+    /* The exe, ntdll and its imports */
+    ok(Count >= 5, "%s: only %lu modules\n", When, Count);
+}
+
+static
+VOID
+ChildProcess(VOID)
+{
+    HMODULE Module;
+
+    /* kernel32, msvcrt and advapi32 were imported in parallel */
+    ok(GetModuleHandleW(L"kernel32.dll") != NULL, "kernel32 is not loaded\n");
+    ok(GetModuleHandleW(L"msvcrt.dll") != NULL, "msvcrt is not loaded\n");
+    ok(GetModuleHandleW(L"advapi32.dll") != NULL, "advapi32 is not loaded\n");
+    CheckModuleList("startup");
+
+    /* A DLL with a lot of imports goes through the workers as well */
+    Module = LoadLibraryW(L"shell32.dll");
+    ok(Module != NULL, "LoadLibrary failed with %lu\n", GetLastError());
+    CheckModuleList("shell32");
+
+    if (Module)
+        FreeLibrary(Module);
+}
+
+static
+VOID
+RunChild(PCSTR Description)
+{
+    CHAR CommandLine[MAX_PATH + 64];
+    CHAR ExePath[MAX_PATH];
+    STARTUPINFOA StartupInfo = { sizeof(StartupInfo) };
+    PROCESS_INFORMATION ProcessInfo;
+    DWORD Start, Wait;
+
+    GetModuleFileNameA(NULL, ExePath, ARRAYSIZE(ExePath));
+    StringCbPrintfA(CommandLine, sizeof(CommandLine), "\"%s\" LdrParallelImports child", ExePath);
+
+    Start = GetTickCount();
+    if (!CreateProcessA(NULL, CommandLine, NULL, NULL, FALSE, 0, NULL, NULL, &StartupInfo, &ProcessInfo))
+    {
+        ok(0, "%s: CreateProcess failed with %lu\n", Description, GetLastError());
+        return;
+    }
+
+    /* A loader worker stuck on the wrong keyed event held the loader up for seconds */
+    Wait = WaitForSingleObject(ProcessInfo.hProcess, CHILD_START_TIMEOUT);
+    ok(Wait == WAIT_OBJECT_0, "%s: the child did not finish within %u ms\n", Description, CHILD_START_TIMEOUT);
+    trace("%s: child ran for %lu ms\n", Description, GetTickCount() - Start);
+
+    wait_child_process(ProcessInfo.hProcess);
+
+    CloseHandle(ProcessInfo.hThread);
+    CloseHandle(ProcessInfo.hProcess);
+}
+
+static
+BOOL
+SetMaxLoaderThreads(HKEY Key, DWORD Threads)
+{
+    return RegSetValueExA(Key, "MaxLoaderThreads", 0, REG_DWORD,
+                          (PBYTE)&Threads, sizeof(Threads)) == ERROR_SUCCESS;
+}
+
+START_TEST(LdrParallelImports)
+{
+    SYSTEM_INFO SystemInfo;
+    DWORD Disposition;
+    HKEY Key;
+    char **argv;
+    int argc;
+
+    argc = winetest_get_mainargs(&argv);
+    if (argc >= 3 && !strcmp(argv[2], "child"))
+    {
+        ChildProcess();
+        return;
+    }
+
+    GetSystemInfo(&SystemInfo);
+    if (SystemInfo.dwNumberOfProcessors < 2)
+        trace("Single processor, the loader stays serial\n");
+
+    RunChild("default");
+
+    /* Serial and with more workers than imports, if we may set the option */
+    if (RegCreateKeyExA(HKEY_LOCAL_MACHINE, IFEO_KEY, 0, NULL, 0, KEY_SET_VALUE | DELETE,
+                        NULL, &Key, &Disposition) != ERROR_SUCCESS)
+    {
+        skip("Cannot set image file execution options\n");
+        return;
+    }
+
+    if (SetMaxLoaderThreads(Key, 1))
+        RunChild("serial");
+    if (SetMaxLoaderThreads(Key, 16))
+        RunChild("16 threads");
+
+    RegDeleteValueA(Key, "MaxLoaderThreads");
+    RegCloseKey(Key);
+    if (Disposition == REG_CREATED_NEW_KEY)
+        RegDeleteKeyA(HKEY_LOCAL_MACHINE, IFEO_KEY);
+}
@@ -174,8 +174,93 @@ TestFreeNoAccess(void)
     }
 }
 
+/* A no-access page must stay no-access when its standby page gets repurposed */
+static
+void
+TestNoAccessRepurposed(void)
+{
+    MEMORYSTATUSEX MemoryStatus = { sizeof(MemoryStatus) };
+    PVOID Chunks[512];
+    ULONG ChunkCount, i;
+    SIZE_T ChunkSize, Touched, Size, Offset;
+    PULONG Page;
+    PVOID Mem;
+    NTSTATUS Status;
+    ULONG OldProtection;
+
+    Page = NULL;
+    Size = PAGE_SIZE;
+    Status = NtAllocateVirtualMemory(NtCurrentProcess(), (PVOID*)&Page, 0, &Size, MEM_COMMIT, PAGE_READWRITE);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return;
+
+    /* Dirty it, so it goes through the modified page writer to the standby list */
+    *Page = 0x12345678;
+    Status = NtProtectVirtualMemory(NtCurrentProcess(), (PVOID*)&Page, &Size, PAGE_NOACCESS, &OldProtection);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_hex(OldProtection, PAGE_READWRITE);
+
+    /* Use up more than the physical memory, so standby pages are taken for new ones */
+    GlobalMemoryStatusEx(&MemoryStatus);
+    ChunkSize = 16 * 1024 * 1024;
+    Touched = 0;
+    for (ChunkCount = 0; ChunkCount < RTL_NUMBER_OF(Chunks); ChunkCount++)
+    {
+        if (Touched > MemoryStatus.ullTotalPhys + ChunkSize)
+            break;
+
+        Mem = NULL;
+        Size = ChunkSize;
+        Status = NtAllocateVirtualMemory(NtCurrentProcess(), &Mem, 0, &Size, MEM_COMMIT, PAGE_READWRITE);
+        if (!NT_SUCCESS(Status))
+            break;
+
+        for (Offset = 0; Offset < ChunkSize; Offset += PAGE_SIZE)
+            *((PUCHAR)Mem + Offset) = 1;
+
+        Chunks[ChunkCount] = Mem;
+        Touched += ChunkSize;
+    }
+    trace("Touched %Iu MB of %I64u MB physical memory\n", Touched >> 20, MemoryStatus.ullTotalPhys >> 20);
+
+    for (i = 0; i < ChunkCount; i++)
+    {
+        Size = 0;
+        Status = NtFreeVirtualMemory(NtCurrentProcess(), &Chunks[i], &Size, MEM_RELEASE);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+    }
+
+    /* Whether it is still in transition or back in the page file, it must fault */
+    StartSeh()
+    {
+        ok(*Page == 0, "Test should not go as far as this.\n");
+    } EndSeh(STATUS_ACCESS_VIOLATION);
+
+    StartSeh()
+    {
+        *Page = 0;
+    } EndSeh(STATUS_ACCESS_VIOLATION);
+
+    /* And it still has its data */
+    Size = PAGE_SIZE;
+    Status = NtProtectVirtualMemory(NtCurrentProcess(), (PVOID*)&Page, &Size, PAGE_READONLY, &OldProtection);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_hex(OldProtection, PAGE_NOACCESS);
+
+    StartSeh()
+    {
+        ok_hex(*Page, 0x12345678);
+    } EndSeh(STATUS_SUCCESS);
+
+    Size = 0;
+    Status = NtFreeVirtualMemory(NtCurrentProcess(), (PVOID*)&Page, &Size, MEM_RELEASE);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+}
+
 START_TEST(NtProtectVirtualMemory)
 {
     TestReadWrite();
     TestFreeNoAccess();
+    TestNoAccessRepurposed();
 }
@@ -0,0 +1,275 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Test for the low fragmentation heap and multithreaded allocation throughput
+ */
+
+#include "precomp.h"
+
+#define BENCH_BLOCKS     64
+#define BENCH_ITERATIONS 2000
+#define BENCH_MAX_THREADS 8
+
+typedef struct _BENCH_CONTEXT
+{
+    HANDLE Heap;
+    HANDLE StartEvent;
+    ULONG Seed;
+    ULONG Failures;
+} BENCH_CONTEXT, *PBENCH_CONTEXT;
+
+static
+ULONG
+QueryFrontEndType(
+    _In_ HANDLE Heap)
+{
+    NTSTATUS Status;
+    ULONG Type = 0xdeadbeef;
+
+    Status = RtlQueryHeapInformation(Heap, HeapCompatibilityInformation, &Type, sizeof(Type), NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    return Type;
+}
+
+static
+NTSTATUS
+EnableLfh(
+    _In_ HANDLE Heap)
+{
+    ULONG Type = 2;
+
+    return RtlSetHeapInformation(Heap, HeapCompatibilityInformation, &Type, sizeof(Type));
+}
+
+static
+VOID
+TestLfhBlocks(
+    _In_ HANDLE Heap)
+{
+    PUCHAR Buffers[64];
+    PUCHAR Ptr;
+    SIZE_T Size;
+    ULONG i, j;
+    BOOLEAN Ret;
+
+    for (i = 0; i < RTL_NUMBER_OF(Buffers); i++)
+    {
+        Size = 1 + i * 29;
+        Buffers[i] = RtlAllocateHeap(Heap, HEAP_ZERO_MEMORY, Size);
+        ok(Buffers[i] != NULL, "Allocation of %Iu bytes failed\n", Size);
+        if (!Buffers[i])
+            continue;
+
+        ok(((ULONG_PTR)Buffers[i] & (MEMORY_ALLOCATION_ALIGNMENT - 1)) == 0, "Block %p is misaligned\n", Buffers[i]);
+        ok_size_t(RtlSizeHeap(Heap, 0, Buffers[i]), Size);
+        for (j = 0; j < Size; j++)
+        {
+            if (Buffers[i][j] != 0)
+                break;
+        }
+        ok(j == Size, "Block of %Iu bytes is not zeroed at %lu\n", Size, j);
+        RtlFillMemory(Buffers[i], Size, (UCHAR)i);
+    }
+
+    /* Blocks must not overlap */
+    for (i = 0; i < RTL_NUMBER_OF(Buffers); i++)
+    {
+        if (!Buffers[i])
+            continue;
+
+        Size = 1 + i * 29;
+        for (j = 0; j < Size; j++)
+        {
+            if (Buffers[i][j] != (UCHAR)i)
+                break;
+        }
+        ok(j == Size, "Block %lu was overwritten at %lu\n", i, j);
+    }
+
+    /* Grow a small block in place and out of its bucket */
+    Ptr = RtlReAllocateHeap(Heap, HEAP_ZERO_MEMORY, Buffers[1], 31);
+    ok(Ptr != NULL, "ReAllocation failed\n");
+    if (Ptr)
+    {
+        Buffers[1] = Ptr;
+        ok_size_t(RtlSizeHeap(Heap, 0, Ptr), 31);
+        ok(Ptr[0] == 1 && Ptr[29] == 1 && Ptr[30] == 0, "Unexpected contents %x %x %x\n", Ptr[0], Ptr[29], Ptr[30]);
+    }
+
+    Ptr = RtlReAllocateHeap(Heap, HEAP_ZERO_MEMORY, Buffers[1], 1000);
+    ok(Ptr != NULL, "ReAllocation failed\n");
+    if (Ptr)
+    {
+        Buffers[1] = Ptr;
+        ok_size_t(RtlSizeHeap(Heap, 0, Ptr), 1000);
+        ok(Ptr[0] == 1 && Ptr[29] == 1 && Ptr[30] == 0 && Ptr[999] == 0,
+           "Unexpected contents %x %x %x %x\n", Ptr[0], Ptr[29], Ptr[30], Ptr[999]);
+    }
+
+    /* And shrink it again */
+    Ptr = RtlReAllocateHeap(Heap, 0, Buffers[1], 10);
+    ok(Ptr != NULL, "ReAllocation failed\n");
+    if (Ptr)
+    {
+        Buffers[1] = Ptr;
+        ok_size_t(RtlSizeHeap(Heap, 0, Ptr), 10);
+        ok(Ptr[0] == 1 && Ptr[9] == 1, "Unexpected contents %x %x\n", Ptr[0], Ptr[9]);
+    }
+
+    ok(RtlValidateHeap(Heap, 0, NULL), "Heap is corrupted\n");
+
+    for (i = 0; i < RTL_NUMBER_OF(Buffers); i++)
+    {
+        if (!Buffers[i])
+            continue;
+
+        ok(RtlValidateHeap(Heap, 0, Buffers[i]), "Block %lu is not valid\n", i);
+        Ret = RtlFreeHeap(Heap, 0, Buffers[i]);
+        ok(Ret, "Freeing block %lu failed\n", i);
+    }
+
+    ok(RtlValidateHeap(Heap, 0, NULL), "Heap is corrupted\n");
+}
+
+static
+DWORD
+WINAPI
+BenchThread(
+    _In_ LPVOID Parameter)
+{
+    PBENCH_CONTEXT Context = Parameter;
+    PVOID Blocks[BENCH_BLOCKS] = { 0 };
+    ULONG Seed = Context->Seed;
+    ULONG i, j;
+
+    WaitForSingleObject(Context->StartEvent, INFINITE);
+
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        for (j = 0; j < BENCH_BLOCKS; j++)
+        {
+            /* Replace a random slot, so blocks live for a varying amount of time */
+            ULONG Index = RtlRandom(&Seed) % BENCH_BLOCKS;
+
+            if (Blocks[Index])
+                RtlFreeHeap(Context->Heap, 0, Blocks[Index]);
+
+            Blocks[Index] = RtlAllocateHeap(Context->Heap, 0, 8 + RtlRandom(&Seed) % 504);
+            if (!Blocks[Index])
+                Context->Failures++;
+        }
+    }
+
+    for (j = 0; j < BENCH_BLOCKS; j++)
+    {
+        if (Blocks[j])
+            RtlFreeHeap(Context->Heap, 0, Blocks[j]);
+    }
+
+    return 0;
+}
+
+static
+VOID
+MeasureAllocations(
+    _In_ HANDLE Heap,
+    _In_ ULONG ThreadCount,
+    _In_ PCSTR Description)
+{
+    BENCH_CONTEXT Contexts[BENCH_MAX_THREADS];
+    HANDLE Threads[BENCH_MAX_THREADS];
+    LARGE_INTEGER Frequency, Start, End;
+    ULONGLONG Microseconds, Operations;
+    HANDLE StartEvent;
+    ULONG i, Created;
+
+    StartEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(StartEvent != NULL, "CreateEventW failed with %lu\n", GetLastError());
+    if (!StartEvent)
+        return;
+
+    for (Created = 0; Created < ThreadCount; Created++)
+    {
+        Contexts[Created].Heap = Heap;
+        Contexts[Created].StartEvent = StartEvent;
+        Contexts[Created].Seed = 0x1234 + Created;
+        Contexts[Created].Failures = 0;
+        Threads[Created] = CreateThread(NULL, 0, BenchThread, &Contexts[Created], 0, NULL);
+        ok(Threads[Created] != NULL, "CreateThread failed with %lu\n", GetLastError());
+        if (!Threads[Created])
+            break;
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    SetEvent(StartEvent);
+    WaitForMultipleObjects(Created, Threads, TRUE, INFINITE);
+    QueryPerformanceCounter(&End);
+
+    for (i = 0; i < Created; i++)
+    {
+        ok_ulong(Contexts[i].Failures, 0);
+        CloseHandle(Threads[i]);
+    }
+    CloseHandle(StartEvent);
+
+    Microseconds = (End.QuadPart - Start.QuadPart) * 1000000ULL / Frequency.QuadPart;
+    if (Microseconds == 0)
+        Microseconds = 1;
+    Operations = (ULONGLONG)Created * BENCH_ITERATIONS * BENCH_BLOCKS;
+
+    trace("%lu thread(s) %s: %I64u us, %I64u allocations/ms\n",
+          Created, Description, Microseconds, Operations * 1000ULL / Microseconds);
+}
+
+START_TEST(RtlLowFragmentationHeap)
+{
+    static const ULONG ThreadCounts[] = { 1, 2, 4, BENCH_MAX_THREADS };
+    HANDLE Heap, LfhHeap;
+    NTSTATUS Status;
+    ULONG i;
+
+    /* LFH needs a serialized heap */
+    Heap = RtlCreateHeap(HEAP_GROWABLE | HEAP_NO_SERIALIZE, NULL, 0, 0, NULL, NULL);
+    ok(Heap != NULL, "RtlCreateHeap failed\n");
+    if (Heap)
+    {
+        Status = EnableLfh(Heap);
+        ok(!NT_SUCCESS(Status), "LFH enabled on a HEAP_NO_SERIALIZE heap\n");
+        ok_ulong(QueryFrontEndType(Heap), 0);
+        RtlDestroyHeap(Heap);
+    }
+
+    Heap = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    LfhHeap = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    ok(Heap != NULL && LfhHeap != NULL, "RtlCreateHeap failed\n");
+    if (!Heap || !LfhHeap)
+    {
+        if (Heap) RtlDestroyHeap(Heap);
+        if (LfhHeap) RtlDestroyHeap(LfhHeap);
+        return;
+    }
+
+    ok_ulong(QueryFrontEndType(LfhHeap), 0);
+    Status = EnableLfh(LfhHeap);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_ulong(QueryFrontEndType(LfhHeap), 2);
+
+    /* Enabling it twice is harmless */
+    Status = EnableLfh(LfhHeap);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+
+    TestLfhBlocks(Heap);
+    TestLfhBlocks(LfhHeap);
+
+    for (i = 0; i < RTL_NUMBER_OF(ThreadCounts); i++)
+    {
+        MeasureAllocations(Heap, ThreadCounts[i], "default heap");
+        MeasureAllocations(LfhHeap, ThreadCounts[i], "low fragmentation heap");
+    }
+
+    ok(RtlValidateHeap(LfhHeap, 0, NULL), "Heap is corrupted\n");
+
+    RtlDestroyHeap(Heap);
+    RtlDestroyHeap(LfhHeap);
+}
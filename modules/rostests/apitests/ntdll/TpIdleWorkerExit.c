@@ -0,0 +1,118 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Test posting thread pool work while an idle worker exits
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include "precomp.h"
+
+/* How long an idle worker waits for work before it exits */
+#define WORKER_TIMEOUT  5000
+
+/* Far below the time the blocked worker stays busy */
+#define WORK_TIMEOUT    2000
+
+static NTSTATUS (WINAPI *pTpAllocPool)(TP_POOL **, PVOID);
+static VOID (WINAPI *pTpSetPoolMaxThreads)(TP_POOL *, DWORD);
+static VOID (WINAPI *pTpReleasePool)(TP_POOL *);
+static NTSTATUS (WINAPI *pTpAllocWork)(TP_WORK **, PTP_WORK_CALLBACK, PVOID, TP_CALLBACK_ENVIRON *);
+static VOID (WINAPI *pTpPostWork)(TP_WORK *);
+static VOID (WINAPI *pTpWaitForWork)(TP_WORK *, BOOL);
+static VOID (WINAPI *pTpReleaseWork)(TP_WORK *);
+
+static HANDLE g_ReleaseEvent;
+static HANDLE g_DoneEvent;
+
+static
+VOID
+NTAPI
+BlockingWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work)
+{
+    WaitForSingleObject(g_ReleaseEvent, INFINITE);
+}
+
+static
+VOID
+NTAPI
+QuickWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work)
+{
+    SetEvent(g_DoneEvent);
+}
+
+START_TEST(TpIdleWorkerExit)
+{
+    /* Around the moment the idle worker gives up */
+    static const LONG Offsets[] = { -20, -5, 0, 5, 20 };
+    TP_CALLBACK_ENVIRON Environment;
+    TP_WORK *Blocker, *Quick;
+    TP_POOL *Pool;
+    HMODULE Ntdll;
+    NTSTATUS Status;
+    DWORD Wait;
+    ULONG i;
+
+    Ntdll = GetModuleHandleW(L"ntdll.dll");
+    pTpAllocPool = (PVOID)GetProcAddress(Ntdll, "TpAllocPool");
+    pTpSetPoolMaxThreads = (PVOID)GetProcAddress(Ntdll, "TpSetPoolMaxThreads");
+    pTpReleasePool = (PVOID)GetProcAddress(Ntdll, "TpReleasePool");
+    pTpAllocWork = (PVOID)GetProcAddress(Ntdll, "TpAllocWork");
+    pTpPostWork = (PVOID)GetProcAddress(Ntdll, "TpPostWork");
+    pTpWaitForWork = (PVOID)GetProcAddress(Ntdll, "TpWaitForWork");
+    pTpReleaseWork = (PVOID)GetProcAddress(Ntdll, "TpReleaseWork");
+    if (!pTpAllocPool || !pTpSetPoolMaxThreads || !pTpReleasePool || !pTpAllocWork ||
+        !pTpPostWork || !pTpWaitForWork || !pTpReleaseWork)
+    {
+        skip("Thread pool functions not available\n");
+        return;
+    }
+
+    g_ReleaseEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    g_DoneEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+
+    Status = pTpAllocPool(&Pool, NULL);
+    ok(Status == STATUS_SUCCESS, "TpAllocPool failed with 0x%lx\n", Status);
+    if (!NT_SUCCESS(Status))
+        return;
+
+    /* One worker stays blocked, the other one runs the quick work and goes idle */
+    pTpSetPoolMaxThreads(Pool, 2);
+
+    RtlZeroMemory(&Environment, sizeof(Environment));
+    Environment.Version = 1;
+    Environment.Pool = Pool;
+
+    Status = pTpAllocWork(&Blocker, BlockingWork, NULL, &Environment);
+    ok(Status == STATUS_SUCCESS, "TpAllocWork failed with 0x%lx\n", Status);
+    Status = pTpAllocWork(&Quick, QuickWork, NULL, &Environment);
+    ok(Status == STATUS_SUCCESS, "TpAllocWork failed with 0x%lx\n", Status);
+
+    pTpPostWork(Blocker);
+    pTpPostWork(Quick);
+    Wait = WaitForSingleObject(g_DoneEvent, WORK_TIMEOUT);
+    ok(Wait == WAIT_OBJECT_0, "The first work item did not run\n");
+
+    /*
+     * Post while the idle worker is timing out. The submitter may still count
+     * it as idle and only wake it, so it has to start a replacement on its way
+     * out, or the work waits for the blocked worker.
+     */
+    for (i = 0; i < RTL_NUMBER_OF(Offsets); i++)
+    {
+        Sleep(WORKER_TIMEOUT + Offsets[i]);
+
+        pTpPostWork(Quick);
+        Wait = WaitForSingleObject(g_DoneEvent, WORK_TIMEOUT);
+        ok(Wait == WAIT_OBJECT_0, "Offset %ld: the work item did not run\n", Offsets[i]);
+    }
+
+    SetEvent(g_ReleaseEvent);
+    pTpWaitForWork(Blocker, FALSE);
+    pTpWaitForWork(Quick, FALSE);
+    pTpReleaseWork(Blocker);
+    pTpReleaseWork(Quick);
+    pTpReleasePool(Pool);
+
+    CloseHandle(g_DoneEvent);
+    CloseHandle(g_ReleaseEvent);
+}
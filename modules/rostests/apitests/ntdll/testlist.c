@@ -6,7 +6,10 @@
 extern void func_DllLoadNotification(void);
 extern void func_implicit_tls(void);
 extern void func_LdrEnumResources(void);
+extern void func_LdrGetProcedureAddress(void);
 extern void func_LdrLoadDll(void);
+extern void func_LdrParallelImports(void);
+extern void func_LdrStartupPerf(void);
 extern void func_load_notifications(void);
 extern void func_NtAcceptConnectPort(void);
 extern void func_NtAccessCheck(void);
@@ -87,6 +90,7 @@ extern void func_RtlImageDirectoryEntryToData(void);
 extern void func_RtlImageRvaToVa(void);
 extern void func_RtlIntSafe(void);
 extern void func_RtlIsNameLegalDOS8Dot3(void);
+extern void func_RtlLowFragmentationHeap(void);
 extern void func_RtlMemoryStream(void);
 extern void func_RtlMultipleAllocateHeap(void);
 extern void func_RtlNtPathNameToDosPathName(void);
@@ -105,6 +109,7 @@ extern void func_RtlxUnicodeStringToAnsiSize(void);
 extern void func_RtlxUnicodeStringToOemSize(void);
 extern void func_StackOverflow(void);
 extern void func_TimerResolution(void);
+extern void func_TpIdleWorkerExit(void);
 extern void func_UserModeException(void);
 
 const struct test winetest_testlist[] =
@@ -112,7 +117,10 @@ const struct test winetest_testlist[] =
     { "DllLoadNotification",            func_DllLoadNotification },
     { "implicit_tls",                   func_implicit_tls },
     { "LdrEnumResources",               func_LdrEnumResources },
+    { "LdrGetProcedureAddress",         func_LdrGetProcedureAddress },
     { "LdrLoadDll",                     func_LdrLoadDll },
+    { "LdrParallelImports",             func_LdrParallelImports },
+    { "-LdrStartupPerf",                func_LdrStartupPerf },
     { "load_notifications",             func_load_notifications },
     { "NtAcceptConnectPort",            func_NtAcceptConnectPort },
     { "NtAccessCheck",                  func_NtAccessCheck },
@@ -192,6 +200,7 @@ const struct test winetest_testlist[] =
     { "RtlImageRvaToVa",                func_RtlImageRvaToVa },
     { "RtlIntSafe",                     func_RtlIntSafe },
     { "RtlIsNameLegalDOS8Dot3",         func_RtlIsNameLegalDOS8Dot3 },
+    { "RtlLowFragmentationHeap",        func_RtlLowFragmentationHeap },
     { "RtlMemoryStream",                func_RtlMemoryStream },
     { "RtlMultipleAllocateHeap",        func_RtlMultipleAllocateHeap },
     { "RtlNtPathNameToDosPathName",     func_RtlNtPathNameToDosPathName },
@@ -209,6 +218,7 @@ const struct test winetest_testlist[] =
     { "RtlValidateUnicodeString",       func_RtlValidateUnicodeString },
     { "StackOverflow",                  func_StackOverflow },
     { "TimerResolution",                func_TimerResolution },
+    { "TpIdleWorkerExit",               func_TpIdleWorkerExit },
     { "UserModeException",              func_UserModeException },
 #ifdef _M_IX86
     { "RtlUnwind",                      func_RtlUnwind },
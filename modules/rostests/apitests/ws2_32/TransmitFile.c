@@ -0,0 +1,303 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Tests for the TransmitFile and TransmitPackets extension functions
+ */
+
+#include "ws2_32.h"
+
+#include <mswsock.h>
+
+#define FILE_SIZE   (300 * 1024 + 123)  /* Several reads, not page aligned */
+
+static CHAR Head[] = "HEAD";
+static CHAR Tail[] = "TAIL";
+static UCHAR FileData[FILE_SIZE];
+static UCHAR Received[2 * FILE_SIZE];
+
+static
+BOOL
+CreateConnection(SOCKET *Server, SOCKET *Client)
+{
+    struct sockaddr_in addr;
+    int len = sizeof(addr);
+    SOCKET Listener;
+
+    *Server = *Client = INVALID_SOCKET;
+
+    Listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ok(Listener != INVALID_SOCKET, "socket failed: %d\n", WSAGetLastError());
+    if (Listener == INVALID_SOCKET)
+        return FALSE;
+
+    ZeroMemory(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(Listener, (struct sockaddr *)&addr, sizeof(addr)) ||
+        getsockname(Listener, (struct sockaddr *)&addr, &len) ||
+        listen(Listener, 1))
+    {
+        ok(0, "Listening failed: %d\n", WSAGetLastError());
+        closesocket(Listener);
+        return FALSE;
+    }
+
+    *Client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ok(*Client != INVALID_SOCKET, "socket failed: %d\n", WSAGetLastError());
+    if (*Client != INVALID_SOCKET &&
+        connect(*Client, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+    {
+        *Server = accept(Listener, NULL, NULL);
+    }
+    ok(*Server != INVALID_SOCKET, "Connecting failed: %d\n", WSAGetLastError());
+
+    closesocket(Listener);
+
+    if (*Server == INVALID_SOCKET)
+    {
+        if (*Client != INVALID_SOCKET)
+            closesocket(*Client);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Receives until the other side disconnects */
+static
+ULONG
+ReceiveAll(SOCKET Client)
+{
+    ULONG Total = 0;
+    int ret;
+
+    for (;;)
+    {
+        ret = recv(Client, (char *)Received + Total, sizeof(Received) - Total, 0);
+        if (ret <= 0)
+            break;
+        Total += ret;
+        if (Total == sizeof(Received))
+            break;
+    }
+    ok(ret == 0, "recv returned %d, error %d\n", ret, WSAGetLastError());
+
+    return Total;
+}
+
+static
+DWORD
+WINAPI
+ReceiveThread(PVOID Parameter)
+{
+    return ReceiveAll((SOCKET)Parameter);
+}
+
+static
+HANDLE
+CreateDataFile(PCHAR FileName)
+{
+    HANDLE File;
+    DWORD Written, i;
+    CHAR TempPath[MAX_PATH];
+
+    for (i = 0; i < FILE_SIZE; i++)
+        FileData[i] = (UCHAR)(i * 7 + (i >> 12));
+
+    GetTempPathA(MAX_PATH, TempPath);
+    GetTempFileNameA(TempPath, "tf", 0, FileName);
+
+    File = CreateFileA(FileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                       CREATE_ALWAYS, FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    ok(File != INVALID_HANDLE_VALUE, "CreateFile failed: %lu\n", GetLastError());
+    if (File == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    ok(WriteFile(File, FileData, FILE_SIZE, &Written, NULL) && Written == FILE_SIZE,
+       "WriteFile failed: %lu\n", GetLastError());
+
+    return File;
+}
+
+static
+PVOID
+GetExtension(SOCKET Socket, GUID *Guid)
+{
+    PVOID Function = NULL;
+    DWORD Bytes;
+    int ret;
+
+    ret = WSAIoctl(Socket, SIO_GET_EXTENSION_FUNCTION_POINTER, Guid, sizeof(*Guid),
+                   &Function, sizeof(Function), &Bytes, NULL, NULL);
+    ok(ret == 0, "WSAIoctl failed: %d\n", WSAGetLastError());
+
+    return Function;
+}
+
+static
+VOID
+TestTransmitFile(HANDLE File)
+{
+    GUID TransmitFileGuid = WSAID_TRANSMITFILE;
+    LPFN_TRANSMITFILE pTransmitFile;
+    TRANSMIT_FILE_BUFFERS Buffers;
+    SOCKET Server, Client;
+    OVERLAPPED Overlapped;
+    HANDLE Thread;
+    DWORD Bytes;
+    ULONG Total = 0;
+    BOOL ret;
+
+    if (!CreateConnection(&Server, &Client))
+    {
+        skip("No connection\n");
+        return;
+    }
+
+    pTransmitFile = GetExtension(Server, &TransmitFileGuid);
+    if (!pTransmitFile)
+    {
+        skip("No TransmitFile\n");
+        closesocket(Server);
+        closesocket(Client);
+        return;
+    }
+
+    /* More than the connection buffers, so receive while sending */
+    Thread = CreateThread(NULL, 0, ReceiveThread, (PVOID)Client, 0, NULL);
+    ok(Thread != NULL, "CreateThread failed: %lu\n", GetLastError());
+
+    /* The whole file from the file pointer */
+    SetFilePointer(File, 0, NULL, FILE_BEGIN);
+    Buffers.Head = Head;
+    Buffers.HeadLength = sizeof(Head) - 1;
+    Buffers.Tail = Tail;
+    Buffers.TailLength = sizeof(Tail) - 1;
+
+    ret = pTransmitFile(Server, File, 0, 0, NULL, &Buffers, 0);
+    ok(ret, "TransmitFile failed: %d\n", WSAGetLastError());
+
+    /* Part of the file at an offset, then disconnect */
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Overlapped.Offset = 4097;
+    Overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+
+    ret = pTransmitFile(Server, File, 70000, 1000, &Overlapped, NULL, TF_DISCONNECT);
+    ok(ret || WSAGetLastError() == WSA_IO_PENDING, "TransmitFile failed: %d\n", WSAGetLastError());
+
+    if (Thread)
+    {
+        WaitForSingleObject(Thread, INFINITE);
+        GetExitCodeThread(Thread, &Total);
+        CloseHandle(Thread);
+    }
+    ok(Total == 4 + FILE_SIZE + 4 + 70000, "Received %lu bytes\n", Total);
+    if (Total == 4 + FILE_SIZE + 4 + 70000)
+    {
+        ok(!memcmp(Received, Head, 4), "Wrong head\n");
+        ok(!memcmp(Received + 4, FileData, FILE_SIZE), "Wrong file data\n");
+        ok(!memcmp(Received + 4 + FILE_SIZE, Tail, 4), "Wrong tail\n");
+        ok(!memcmp(Received + 8 + FILE_SIZE, FileData + 4097, 70000), "Wrong file range\n");
+    }
+
+    ret = GetOverlappedResult((HANDLE)Server, &Overlapped, &Bytes, TRUE);
+    ok(ret, "GetOverlappedResult failed: %lu\n", GetLastError());
+    ok(Bytes == 70000, "Bytes = %lu\n", Bytes);
+
+    CloseHandle(Overlapped.hEvent);
+    closesocket(Server);
+    closesocket(Client);
+}
+
+static
+VOID
+TestTransmitPackets(HANDLE File)
+{
+    GUID TransmitPacketsGuid = WSAID_TRANSMITPACKETS;
+    LPFN_TRANSMITPACKETS pTransmitPackets;
+    TRANSMIT_PACKETS_ELEMENT Elements[4];
+    SOCKET Server, Client;
+    ULONG Total;
+    BOOL ret;
+    int sent;
+
+    if (!CreateConnection(&Server, &Client))
+    {
+        skip("No connection\n");
+        return;
+    }
+
+    pTransmitPackets = GetExtension(Server, &TransmitPacketsGuid);
+    if (!pTransmitPackets)
+    {
+        skip("No TransmitPackets\n");
+        closesocket(Server);
+        closesocket(Client);
+        return;
+    }
+
+    ZeroMemory(Elements, sizeof(Elements));
+    Elements[0].dwElFlags = TP_ELEMENT_MEMORY;
+    Elements[0].cLength = sizeof(Head) - 1;
+    Elements[0].pBuffer = Head;
+    Elements[1].dwElFlags = TP_ELEMENT_FILE;
+    Elements[1].cLength = 1000;
+    Elements[1].nFileOffset.QuadPart = FILE_SIZE - 1000;
+    Elements[1].hFile = File;
+    Elements[2].dwElFlags = TP_ELEMENT_MEMORY;
+    Elements[2].cLength = 0;
+    Elements[3].dwElFlags = TP_ELEMENT_FILE;
+    Elements[3].cLength = 5000;     /* Past the end of the file */
+    Elements[3].nFileOffset.QuadPart = FILE_SIZE - 10;
+    Elements[3].hFile = File;
+
+    ret = pTransmitPackets(Server, Elements, ARRAYSIZE(Elements), 0, NULL, 0);
+    ok(ret, "TransmitPackets failed: %d\n", WSAGetLastError());
+
+    /* A send made afterwards comes after the packets */
+    sent = send(Server, Tail, sizeof(Tail) - 1, 0);
+    ok(sent == sizeof(Tail) - 1, "send returned %d\n", sent);
+    shutdown(Server, SD_SEND);
+
+    Total = ReceiveAll(Client);
+    ok(Total == 4 + 1000 + 10 + 4, "Received %lu bytes\n", Total);
+    if (Total == 4 + 1000 + 10 + 4)
+    {
+        ok(!memcmp(Received, Head, 4), "Wrong head\n");
+        ok(!memcmp(Received + 4, FileData + FILE_SIZE - 1000, 1000), "Wrong file data\n");
+        ok(!memcmp(Received + 1004, FileData + FILE_SIZE - 10, 10), "Wrong end of file\n");
+        ok(!memcmp(Received + 1014, Tail, 4), "Wrong tail\n");
+    }
+
+    /* Elements need a type */
+    Elements[0].dwElFlags = 0;
+    ret = pTransmitPackets(Client, Elements, 1, 0, NULL, 0);
+    ok(!ret, "TransmitPackets succeeded\n");
+
+    closesocket(Server);
+    closesocket(Client);
+}
+
+START_TEST(TransmitFile)
+{
+    WSADATA wsaData;
+    CHAR FileName[MAX_PATH];
+    HANDLE File;
+
+    ok(WSAStartup(MAKEWORD(2, 2), &wsaData) == 0, "WSAStartup failed\n");
+
+    File = CreateDataFile(FileName);
+    if (!File)
+    {
+        skip("No file\n");
+        WSACleanup();
+        return;
+    }
+
+    TestTransmitFile(File);
+    TestTransmitPackets(File);
+
+    CloseHandle(File);
+    WSACleanup();
+}
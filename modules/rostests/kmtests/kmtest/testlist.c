@@ -7,6 +7,7 @@
 #include <kmt_test.h>
 
 KMT_TESTFUNC Test_CcCopyRead;
+KMT_TESTFUNC Test_CcCopyReadPerf;
 KMT_TESTFUNC Test_CcCopyWrite;
 KMT_TESTFUNC Test_CcMapData;
 KMT_TESTFUNC Test_CcPinMappedData;
@@ -43,6 +44,7 @@ KMT_TESTFUNC Test_TcpIpConnect;
 const KMT_TEST TestList[] =
 {
     { "-CcCopyRead",                   Test_CcCopyRead },   // TODO: Crashes on TestWHS
+    { "-CcCopyReadPerf",               Test_CcCopyReadPerf }, // Benchmark, not a conformance test
     { "-CcCopyWrite",                  Test_CcCopyWrite },  // TODO: Crashes on TestWHS
     { "-CcMapData",                    Test_CcMapData },
     { "-CcPinMappedData",              Test_CcPinMappedData },
@@ -0,0 +1,101 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Kernel-Mode Test Suite CcCopyRead throughput user-mode part
+ */
+
+#include <kmt_test.h>
+
+#define CHUNK_SIZE (64 * 1024)
+
+static
+VOID
+MeasureReads(
+    _In_ HANDLE Handle,
+    _In_ ULONG SizeInMB,
+    _In_ PVOID Buffer,
+    _In_ BOOLEAN Strided,
+    _In_ PCSTR Description)
+{
+    NTSTATUS Status;
+    IO_STATUS_BLOCK IoStatusBlock;
+    LARGE_INTEGER ByteOffset, Frequency, Start, End;
+    ULONGLONG FileSize = (ULONGLONG)SizeInMB * 1024 * 1024;
+    ULONG Chunks = (ULONG)(FileSize / CHUNK_SIZE);
+    ULONG i, Chunk;
+    ULONGLONG Microseconds;
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < Chunks; i++)
+    {
+        /* 7919 is prime, so this visits every chunk once in a scattered order */
+        Chunk = Strided ? (ULONG)(((ULONGLONG)i * 7919) % Chunks) : i;
+        ByteOffset.QuadPart = (LONGLONG)Chunk * CHUNK_SIZE;
+        Status = NtReadFile(Handle, NULL, NULL, NULL, &IoStatusBlock, Buffer, CHUNK_SIZE, &ByteOffset, NULL);
+        if (!NT_SUCCESS(Status))
+        {
+            ok_eq_hex(Status, STATUS_SUCCESS);
+            return;
+        }
+    }
+    QueryPerformanceCounter(&End);
+
+    Microseconds = (End.QuadPart - Start.QuadPart) * 1000000ULL / Frequency.QuadPart;
+    if (Microseconds == 0)
+        Microseconds = 1;
+
+    trace("%4lu MB %s: %I64u us, %I64u MB/s\n",
+          SizeInMB, Description, Microseconds, (ULONGLONG)SizeInMB * 1000000ULL / Microseconds);
+}
+
+START_TEST(CcCopyReadPerf)
+{
+    static const ULONG Sizes[] = { 1, 4, 16, 64, 256 };
+    HANDLE Handle;
+    NTSTATUS Status;
+    IO_STATUS_BLOCK IoStatusBlock;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    UNICODE_STRING FileName;
+    WCHAR FileNameBuffer[64];
+    PVOID Buffer;
+    DWORD Error;
+    ULONG i;
+
+    Buffer = RtlAllocateHeap(RtlGetProcessHeap(), 0, CHUNK_SIZE);
+    if (!Buffer)
+    {
+        skip(FALSE, "Out of memory\n");
+        return;
+    }
+
+    Error = KmtLoadAndOpenDriver(L"CcCopyReadPerf", FALSE);
+    ok_eq_int(Error, ERROR_SUCCESS);
+    if (Error)
+    {
+        RtlFreeHeap(RtlGetProcessHeap(), 0, Buffer);
+        return;
+    }
+
+    for (i = 0; i < RTL_NUMBER_OF(Sizes); i++)
+    {
+        StringCbPrintfW(FileNameBuffer, sizeof(FileNameBuffer), L"\\Device\\Kmtest-CcCopyReadPerf\\%lu", Sizes[i]);
+        RtlInitUnicodeString(&FileName, FileNameBuffer);
+
+        InitializeObjectAttributes(&ObjectAttributes, &FileName, OBJ_CASE_INSENSITIVE, NULL, NULL);
+        Status = NtOpenFile(&Handle, FILE_ALL_ACCESS, &ObjectAttributes, &IoStatusBlock, 0, FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+        if (!NT_SUCCESS(Status))
+            continue;
+
+        MeasureReads(Handle, Sizes[i], Buffer, FALSE, "cold sequential");
+        MeasureReads(Handle, Sizes[i], Buffer, FALSE, "warm sequential");
+        MeasureReads(Handle, Sizes[i], Buffer, TRUE, "warm strided");
+
+        NtClose(Handle);
+    }
+
+    RtlFreeHeap(RtlGetProcessHeap(), 0, Buffer);
+    KmtCloseDriver();
+    KmtUnloadDriver();
+}
@@ -2474,6 +2474,42 @@ end_test:
     FsRtlUninitializeLargeMcb(&Mcb);
 }
 
+/* Lookups without an index search the tree, they must agree with the indexed walk */
+static VOID FsRtlLargeMcbTestsLookup(VOID)
+{
+    LARGE_MCB Mcb;
+    LONGLONG Vbn, Lbn, SectorCountFromLbn, StartingLbn, SectorCountFromStartingLbn;
+    LONGLONG IdxLbn, IdxSectorCountFromLbn, IdxStartingLbn, IdxSectorCountFromStartingLbn;
+    ULONG i, Index;
+    BOOLEAN Result, IdxResult;
+
+    FsRtlInitializeLargeMcb(&Mcb, PagedPool);
+
+    /* 64 runs of 3 sectors, every fourth one followed by a hole */
+    for (i = 0, Vbn = 0; i < 64; i++)
+    {
+        Result = FsRtlAddLargeMcbEntry(&Mcb, Vbn, 1000 + i * 10, 3);
+        ok(Result == TRUE, "Run %lu: expected TRUE, got FALSE\n", i);
+        Vbn += (i % 4 == 3) ? 5 : 3;
+    }
+
+    for (Vbn = 0; Vbn < 64 * 4 + 8; Vbn++)
+    {
+        Result = FsRtlLookupLargeMcbEntry(&Mcb, Vbn, &Lbn, &SectorCountFromLbn, &StartingLbn, &SectorCountFromStartingLbn, NULL);
+        IdxResult = FsRtlLookupLargeMcbEntry(&Mcb, Vbn, &IdxLbn, &IdxSectorCountFromLbn, &IdxStartingLbn, &IdxSectorCountFromStartingLbn, &Index);
+        ok(Result == IdxResult, "Vbn %I64d: got %d, expected %d\n", Vbn, Result, IdxResult);
+        if (!Result || !IdxResult)
+            continue;
+
+        ok(Lbn == IdxLbn, "Vbn %I64d: Lbn %I64d, expected %I64d\n", Vbn, Lbn, IdxLbn);
+        ok(SectorCountFromLbn == IdxSectorCountFromLbn, "Vbn %I64d: SectorCountFromLbn %I64d, expected %I64d\n", Vbn, SectorCountFromLbn, IdxSectorCountFromLbn);
+        ok(StartingLbn == IdxStartingLbn, "Vbn %I64d: StartingLbn %I64d, expected %I64d\n", Vbn, StartingLbn, IdxStartingLbn);
+        ok(SectorCountFromStartingLbn == IdxSectorCountFromStartingLbn, "Vbn %I64d: SectorCountFromStartingLbn %I64d, expected %I64d\n", Vbn, SectorCountFromStartingLbn, IdxSectorCountFromStartingLbn);
+    }
+
+    FsRtlUninitializeLargeMcb(&Mcb);
+}
+
 START_TEST(FsRtlMcb)
 {
     FsRtlMcbTest();
@@ -2482,4 +2518,5 @@ START_TEST(FsRtlMcb)
     FsRtlLargeMcbTestsFastFat();
     FsRtlLargeMcbTestsFastFat_2();
     FsRtlLargeMcbTestsFastFat_3();
+    FsRtlLargeMcbTestsLookup();
 }
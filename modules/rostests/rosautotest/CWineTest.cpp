@@ -228,8 +228,16 @@ CWineTest::GetNextTestInfo()
             while(GetNextTest())
             {
                 /* If the user specified a test through the command line, check this here */
-                if(!Configuration.GetTest().empty() && Configuration.GetTest() != m_CurrentTest)
+                if(Configuration.GetTest().empty())
+                {
+                    /* Like in kmtest, tests starting with '-' only run when asked for by name */
+                    if(m_CurrentTest[0] == '-')
+                        continue;
+                }
+                else if(Configuration.GetTest() != m_CurrentTest && "-" + Configuration.GetTest() != m_CurrentTest)
+                {
                     continue;
+                }
 
                 {
                     auto_ptr<CTestInfo> TestInfo(new CTestInfo());
@@ -0,0 +1,261 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Unit Tests for the win32k 32bpp AlphaBlend and StretchBlt span kernels
+ */
+
+/* INCLUDES *******************************************************************/
+
+#include "precomp.h"
+
+#include "../../../../win32ss/gdi/dib/dib32bpp_span.c"
+
+/* GLOBALS ********************************************************************/
+
+#define TEST_PIXELS     4099    /* Not a multiple of the SIMD width */
+#define BENCH_PIXELS    (256 * 256)
+#define BENCH_ROUNDS    100
+
+typedef struct _BLEND_KERNEL
+{
+    PCSTR Name;
+    PFN_DIB_32BPP_BlendSpan BlendSpan;
+} BLEND_KERNEL, *PBLEND_KERNEL;
+
+static ULONG RandomSeed = 0x12345678;
+
+static ULONG SrcPixels[BENCH_PIXELS];
+static ULONG DstPixels[BENCH_PIXELS];
+static ULONG Expected[BENCH_PIXELS];
+static ULONG Result[BENCH_PIXELS];
+
+/* HELPERS ********************************************************************/
+
+static ULONG
+Random(VOID)
+{
+    RandomSeed = RandomSeed * 1103515245 + 12345;
+    return (RandomSeed >> 16) | (RandomSeed << 16);
+}
+
+typedef union
+{
+    ULONG ul;
+    struct
+    {
+        UCHAR red;
+        UCHAR green;
+        UCHAR blue;
+        UCHAR alpha;
+    } col;
+} NICEPIXEL32;
+
+static UCHAR
+Clamp8(ULONG val)
+{
+    return (val > 255) ? 255 : (UCHAR)val;
+}
+
+/* The per-pixel code DIB_32BPP_AlphaBlend used, for a 32bpp source */
+static VOID
+ReferenceBlendSpan(PULONG Dst, const ULONG *Src, ULONG Count, UCHAR SourceConstantAlpha, BOOLEAN SourceAlpha)
+{
+    NICEPIXEL32 DstPixel, SrcPixel;
+    UCHAR Alpha;
+
+    while (Count--)
+    {
+        SrcPixel.ul = *Src++;
+        SrcPixel.col.red = (SrcPixel.col.red * SourceConstantAlpha) / 255;
+        SrcPixel.col.green = (SrcPixel.col.green * SourceConstantAlpha) / 255;
+        SrcPixel.col.blue = (SrcPixel.col.blue * SourceConstantAlpha) / 255;
+        SrcPixel.col.alpha = (SrcPixel.col.alpha * SourceConstantAlpha) / 255;
+
+        Alpha = SourceAlpha ? SrcPixel.col.alpha : SourceConstantAlpha;
+
+        DstPixel.ul = *Dst;
+        DstPixel.col.red = Clamp8((DstPixel.col.red * (255 - Alpha)) / 255 + SrcPixel.col.red);
+        DstPixel.col.green = Clamp8((DstPixel.col.green * (255 - Alpha)) / 255 + SrcPixel.col.green);
+        DstPixel.col.blue = Clamp8((DstPixel.col.blue * (255 - Alpha)) / 255 + SrcPixel.col.blue);
+        DstPixel.col.alpha = Clamp8((DstPixel.col.alpha * (255 - Alpha)) / 255 + SrcPixel.col.alpha);
+        *Dst++ = DstPixel.ul;
+    }
+}
+
+static ULONG
+GetKernels(PBLEND_KERNEL Kernels)
+{
+    ULONG Count = 0;
+
+    Kernels[Count].Name = "C";
+    Kernels[Count++].BlendSpan = DIB_32BPP_BlendSpanC;
+#ifdef DIB_HAVE_SSE2
+    if (IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE))
+    {
+        Kernels[Count].Name = "SSE2";
+        Kernels[Count++].BlendSpan = DIB_32BPP_BlendSpanSSE2;
+    }
+    else
+    {
+        skip("SSE2 is not available\n");
+    }
+#endif
+
+    return Count;
+}
+
+static VOID
+CheckBlend(PBLEND_KERNEL Kernel, ULONG Count, UCHAR SourceConstantAlpha, BOOLEAN SourceAlpha)
+{
+    ULONG i;
+
+    RtlCopyMemory(Expected, DstPixels, Count * sizeof(ULONG));
+    ReferenceBlendSpan(Expected, SrcPixels, Count, SourceConstantAlpha, SourceAlpha);
+
+    RtlCopyMemory(Result, DstPixels, Count * sizeof(ULONG));
+    Kernel->BlendSpan(Result, SrcPixels, Count, SourceConstantAlpha, SourceAlpha);
+
+    for (i = 0; i < Count; i++)
+    {
+        if (Result[i] != Expected[i])
+            break;
+    }
+
+    ok(i == Count,
+       "%s, ConstAlpha %u, SourceAlpha %u: pixel %lu (src 0x%08lx dst 0x%08lx) is 0x%08lx, expected 0x%08lx\n",
+       Kernel->Name, SourceConstantAlpha, SourceAlpha, i,
+       SrcPixels[min(i, Count - 1)], DstPixels[min(i, Count - 1)],
+       Result[min(i, Count - 1)], Expected[min(i, Count - 1)]);
+}
+
+static VOID
+BenchmarkBlend(PCSTR Name, PFN_DIB_32BPP_BlendSpan BlendSpan)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    ULONG Round;
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    for (Round = 0; Round < BENCH_ROUNDS; Round++)
+    {
+        RtlCopyMemory(Result, DstPixels, sizeof(Result));
+        BlendSpan(Result, SrcPixels, BENCH_PIXELS, 200, TRUE);
+    }
+
+    QueryPerformanceCounter(&End);
+
+    trace("%-9s %lu x 256x256 pixels in %lu us\n", Name, (ULONG)BENCH_ROUNDS,
+          (ULONG)((End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart));
+}
+
+/* TESTS **********************************************************************/
+
+START_TEST(BlendSpan)
+{
+    static const UCHAR ConstAlphas[] = { 0, 1, 2, 127, 128, 129, 200, 254, 255 };
+    BLEND_KERNEL Kernels[2];
+    ULONG KernelCount, k, c, i, s, d;
+
+    KernelCount = GetKernels(Kernels);
+
+    /* Every source alpha against every destination channel value */
+    for (s = 0; s < 256; s++)
+    {
+        for (d = 0; d < 256; d++)
+        {
+            i = s * 256 + d;
+            SrcPixels[i] = (s << 24) | ((255 - s) << 16) | (d << 8) | s;
+            DstPixels[i] = (d << 24) | (d << 16) | ((s ^ d) << 8) | (255 - d);
+        }
+    }
+
+    for (k = 0; k < KernelCount; k++)
+    {
+        for (c = 0; c < ARRAYSIZE(ConstAlphas); c++)
+        {
+            CheckBlend(&Kernels[k], BENCH_PIXELS, ConstAlphas[c], TRUE);
+            CheckBlend(&Kernels[k], BENCH_PIXELS, ConstAlphas[c], FALSE);
+        }
+    }
+
+    /* Random pixels, with spans of every length up to a few SIMD widths */
+    for (i = 0; i < TEST_PIXELS; i++)
+    {
+        SrcPixels[i] = Random();
+        DstPixels[i] = Random();
+    }
+
+    for (k = 0; k < KernelCount; k++)
+    {
+        for (c = 0; c < 256; c += 17)
+        {
+            CheckBlend(&Kernels[k], TEST_PIXELS, (UCHAR)c, TRUE);
+            CheckBlend(&Kernels[k], TEST_PIXELS, (UCHAR)c, FALSE);
+        }
+
+        for (i = 1; i <= 13; i++)
+            CheckBlend(&Kernels[k], i, 160, TRUE);
+    }
+}
+
+/* How much faster than the reference code the kernels are */
+START_TEST(BlendSpanPerf)
+{
+    BLEND_KERNEL Kernels[2];
+    ULONG KernelCount, k, i;
+
+    KernelCount = GetKernels(Kernels);
+
+    for (i = 0; i < BENCH_PIXELS; i++)
+    {
+        SrcPixels[i] = Random();
+        DstPixels[i] = Random();
+    }
+
+    BenchmarkBlend("Reference", ReferenceBlendSpan);
+    for (k = 0; k < KernelCount; k++)
+        BenchmarkBlend(Kernels[k].Name, Kernels[k].BlendSpan);
+}
+
+static VOID
+CheckStretch(ULONG SrcWidth, ULONG DstWidth, ULONG Start, ULONG Count)
+{
+    static ULONG Src[1000], Dst[1000];
+    ULONG i;
+
+    for (i = 0; i < SrcWidth; i++)
+        Src[i] = i;
+
+    DIB_32BPP_StretchSpan(Dst, Src, Start, Count, DstWidth, SrcWidth);
+
+    for (i = 0; i < Count; i++)
+    {
+        if (Dst[i] != (Start + i) * SrcWidth / DstWidth)
+            break;
+    }
+
+    ok(i == Count, "%lu -> %lu, start %lu: column %lu is %lu\n",
+       SrcWidth, DstWidth, Start, Start + i, Dst[min(i, Count - 1)]);
+}
+
+START_TEST(StretchSpan)
+{
+    static const ULONG Widths[] = { 1, 2, 3, 7, 16, 17, 100, 255, 256, 1000 };
+    ULONG Start, Count, w, v;
+
+    for (w = 0; w < ARRAYSIZE(Widths); w++)
+    {
+        for (v = 0; v < ARRAYSIZE(Widths); v++)
+        {
+            /* A whole row, then the row in the chunks AlphaBlend uses */
+            CheckStretch(Widths[w], Widths[v], 0, Widths[v]);
+
+            for (Start = 0; Start < Widths[v]; Start += Count)
+            {
+                Count = min(Widths[v] - Start, 64);
+                CheckStretch(Widths[w], Widths[v], Start, Count);
+            }
+        }
+    }
+}
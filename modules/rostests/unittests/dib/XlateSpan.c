@@ -0,0 +1,188 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Unit Tests for the win32k XLATEOBJ span functions
+ */
+
+/* INCLUDES *******************************************************************/
+
+#include "precomp.h"
+
+#include <stdlib.h>
+#include <wingdi.h>
+#define _ENGINE_EXPORT_
+#include <winddi.h>
+
+/* WIN32K DEFINITIONS (MOCK) **************************************************/
+
+typedef struct _PALETTE *PPALETTE;
+typedef struct _DC *PDC;
+
+static ULONG NearestIndexCalls;
+
+/* Any function of the color will do, the real one searches the palette */
+static ULONG
+NTAPI
+PALETTE_ulGetNearestPaletteIndex(PPALETTE ppal, ULONG iColor)
+{
+    NearestIndexCalls++;
+    return (iColor * 2654435761u) >> 24;
+}
+
+#include "../../../../win32ss/gdi/eng/xlateobj.h"
+#include "../../../../win32ss/gdi/eng/xlateobj.c"
+
+/* GLOBALS ********************************************************************/
+
+#define TEST_PIXELS     1031    /* Not a multiple of the SIMD width */
+
+typedef struct _XLATE_CASE
+{
+    PCSTR Name;
+    PFN_XLATE pfnXlate;
+} XLATE_CASE;
+
+#define XLATE_CASE(name) { #name, EXLATEOBJ_iXlate##name }
+
+static const XLATE_CASE XlateCases[] =
+{
+    XLATE_CASE(Trivial),
+    XLATE_CASE(ToMono),
+    XLATE_CASE(Table),
+    XLATE_CASE(RGBtoBGR),
+    XLATE_CASE(RGBto555),
+    XLATE_CASE(BGRto555),
+    XLATE_CASE(RGBto565),
+    XLATE_CASE(BGRto565),
+    XLATE_CASE(RGBtoPal),
+    XLATE_CASE(555toRGB),
+    XLATE_CASE(555toBGR),
+    XLATE_CASE(555to565),
+    XLATE_CASE(555toPal),
+    XLATE_CASE(565to555),
+    XLATE_CASE(565toRGB),
+    XLATE_CASE(565toBGR),
+    XLATE_CASE(565toPal),
+    XLATE_CASE(ShiftAndMask),
+    XLATE_CASE(BitfieldsToPal),
+};
+
+static ULONG RandomSeed = 0x12345678;
+
+static ULONG XlateTable[256];
+static ULONG SrcPixels[TEST_PIXELS];
+static ULONG Expected[TEST_PIXELS];
+static ULONG Result[TEST_PIXELS];
+
+/* HELPERS ********************************************************************/
+
+static ULONG
+Random(VOID)
+{
+    RandomSeed = RandomSeed * 1103515245 + 12345;
+    return (RandomSeed >> 16) | (RandomSeed << 16);
+}
+
+static VOID
+InitXlate(PEXLATEOBJ pexlo, PFN_XLATE pfnXlate, ULONG ulRedShift, ULONG ulGreenShift, ULONG ulBlueShift)
+{
+    ULONG i;
+
+    RtlZeroMemory(pexlo, sizeof(*pexlo));
+    pexlo->pfnXlate = pfnXlate;
+    pexlo->pfnXlateSpan = EXLATEOBJ_pfnGetXlateSpan(pfnXlate);
+
+    /* ToMono compares against the first entry, Table looks the colors up */
+    for (i = 0; i < ARRAYSIZE(XlateTable); i++)
+        XlateTable[i] = Random();
+    XlateTable[0] = SrcPixels[0];
+    pexlo->xlo.pulXlate = XlateTable;
+    pexlo->xlo.cEntries = ARRAYSIZE(XlateTable);
+
+    /* For ShiftAndMask, the other translations do not look at them */
+    pexlo->ulRedMask = RGB(0xFF, 0, 0);
+    pexlo->ulGreenMask = RGB(0, 0xFF, 0);
+    pexlo->ulBlueMask = RGB(0, 0, 0xFF);
+    pexlo->ulRedShift = ulRedShift;
+    pexlo->ulGreenShift = ulGreenShift;
+    pexlo->ulBlueShift = ulBlueShift;
+}
+
+static VOID
+CheckSpan(PCSTR Name, PEXLATEOBJ pexlo, ULONG Count, BOOLEAN InPlace)
+{
+    ULONG i;
+
+    for (i = 0; i < Count; i++)
+        Expected[i] = XLATEOBJ_iXlate(&pexlo->xlo, SrcPixels[i]);
+
+    if (InPlace)
+    {
+        RtlCopyMemory(Result, SrcPixels, Count * sizeof(ULONG));
+        pexlo->pfnXlateSpan(pexlo, Result, Result, Count);
+    }
+    else
+    {
+        RtlFillMemory(Result, Count * sizeof(ULONG), 0xCC);
+        pexlo->pfnXlateSpan(pexlo, Result, SrcPixels, Count);
+    }
+
+    for (i = 0; i < Count; i++)
+    {
+        if (Result[i] != Expected[i])
+            break;
+    }
+
+    ok(i == Count, "%s, %lu pixels%s: pixel %lu (0x%08lx) is 0x%08lx, expected 0x%08lx\n",
+       Name, Count, InPlace ? " in place" : "", i,
+       SrcPixels[min(i, Count - 1)], Result[min(i, Count - 1)], Expected[min(i, Count - 1)]);
+}
+
+/* TESTS **********************************************************************/
+
+START_TEST(XlateSpan)
+{
+    EXLATEOBJ exlo;
+    ULONG c, i, Count;
+
+    /* Random colors, small ones for the table, and runs of one color for the palette cache */
+    for (i = 0; i < TEST_PIXELS; i++)
+    {
+        if (i % 7 == 0)
+            SrcPixels[i] = Random() & 0x1FF;
+        else if (i % 5 == 0)
+            SrcPixels[i] = SrcPixels[i - 1];
+        else
+            SrcPixels[i] = Random();
+    }
+
+    /* Some pixels match the mono background color */
+    for (i = 0; i < TEST_PIXELS; i += 3)
+        SrcPixels[i] = SrcPixels[0];
+
+    for (c = 0; c < ARRAYSIZE(XlateCases); c++)
+    {
+        InitXlate(&exlo, XlateCases[c].pfnXlate, 19, 14, 9);
+
+        CheckSpan(XlateCases[c].Name, &exlo, TEST_PIXELS, FALSE);
+        CheckSpan(XlateCases[c].Name, &exlo, TEST_PIXELS, TRUE);
+
+        /* Every length up to a few SIMD widths, for the tails */
+        for (Count = 1; Count <= 13; Count++)
+            CheckSpan(XlateCases[c].Name, &exlo, Count, FALSE);
+    }
+
+    /* Rotations that wrap around, and none at all */
+    InitXlate(&exlo, EXLATEOBJ_iXlateShiftAndMask, 30, 0, 3);
+    CheckSpan("ShiftAndMask", &exlo, TEST_PIXELS, FALSE);
+
+    /* Runs of one color look the palette index up once */
+    for (i = 0; i < TEST_PIXELS; i++)
+        SrcPixels[i] = (i / 100) * 0x010101;
+
+    InitXlate(&exlo, EXLATEOBJ_iXlateRGBtoPal, 0, 0, 0);
+    NearestIndexCalls = 0;
+    exlo.pfnXlateSpan(&exlo, Result, SrcPixels, TEST_PIXELS);
+    ok(NearestIndexCalls == (TEST_PIXELS + 99) / 100, "%lu nearest index lookups\n", NearestIndexCalls);
+    CheckSpan("RGBtoPal", &exlo, TEST_PIXELS, FALSE);
+}
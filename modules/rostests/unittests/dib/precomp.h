@@ -0,0 +1,41 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Precompiled header for dib_unittest
+ */
+
+#pragma once
+
+#include <apitest.h>
+
+#define WIN32_NO_STATUS
+#include <windef.h>
+#include <winbase.h>
+#include <ndk/rtlfuncs.h>
+
+#define UNIT_TEST
+
+/* KERNEL DEFINITIONS (MOCK) **************************************************/
+
+typedef struct _KFLOATING_SAVE
+{
+    ULONG Dummy;
+} KFLOATING_SAVE, *PKFLOATING_SAVE;
+
+#define ExIsProcessorFeaturePresent(Feature)    IsProcessorFeaturePresent(Feature)
+#define KeSaveFloatingPointState(Save)          STATUS_SUCCESS
+#define KeRestoreFloatingPointState(Save)       STATUS_SUCCESS
+
+/* WIN32K DEFINITIONS (MOCK) **************************************************/
+
+/* Must match win32ss/gdi/dib/dib.h */
+typedef VOID (*PFN_DIB_32BPP_BlendSpan)(PULONG,const ULONG*,ULONG,UCHAR,BOOLEAN);
+
+typedef struct _DIB_SPAN_STATE
+{
+    PFN_DIB_32BPP_BlendSpan BlendSpan;
+#if defined(_M_IX86)
+    BOOLEAN FloatSaved;
+    KFLOATING_SAVE FloatSave;
+#endif
+} DIB_SPAN_STATE, *PDIB_SPAN_STATE;
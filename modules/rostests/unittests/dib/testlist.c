@@ -0,0 +1,22 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test list for the win32k DIB span kernels
+ */
+
+#define STANDALONE
+#include <apitest.h>
+
+extern void func_BlendSpan(void);
+extern void func_BlendSpanPerf(void);
+extern void func_StretchSpan(void);
+extern void func_XlateSpan(void);
+
+const struct test winetest_testlist[] =
+{
+    { "BlendSpan", func_BlendSpan },
+    { "-BlendSpanPerf", func_BlendSpanPerf },
+    { "StretchSpan", func_StretchSpan },
+    { "XlateSpan", func_XlateSpan },
+    { 0, 0 }
+};
@@ -0,0 +1,451 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Unit Tests for the NTFS data run lists and compressed reads
+ */
+
+/* INCLUDES *******************************************************************/
+
+#include "precomp.h"
+
+#include "../../../../drivers/filesystems/ntfs/runlist.c"
+
+/* GLOBALS ********************************************************************/
+
+#define TEST_CLUSTER_SIZE   512
+#define TEST_DISK_CLUSTERS  320
+#define TEST_FILE_CLUSTERS  26
+
+/* A fragmented file: backwards runs, a hole, a far run, and two adjacent runs */
+static const UCHAR TestDataRuns[] =
+{
+    0x11, 0x04, 0x0A,               /* 4 clusters at LCN 10 */
+    0x01, 0x03,                     /* 3 sparse clusters */
+    0x11, 0x05, 0xF8,               /* 5 clusters at LCN 2 */
+    0x21, 0x01, 0x2A, 0x01,         /* 1 cluster at LCN 300 */
+    0x21, 0x0B, 0xE8, 0xFE,         /* 11 clusters at LCN 20 */
+    0x11, 0x02, 0x0B,               /* 2 clusters at LCN 31 */
+    0x00
+};
+
+static const LONGLONG TestRuns[][3] =
+{
+    /* Vcn, Lcn, Length */
+    {  0,  10,  4 },
+    {  4,  -1,  3 },
+    {  7,   2,  5 },
+    { 12, 300,  1 },
+    { 13,  20, 11 },
+    { 24,  31,  2 },
+};
+
+static UCHAR TestDisk[TEST_DISK_CLUSTERS * TEST_CLUSTER_SIZE];
+static UCHAR TestFile[TEST_FILE_CLUSTERS * TEST_CLUSTER_SIZE];
+static UCHAR ReadBuffer[sizeof(TestDisk)];
+static ULONG DiskReads;
+static BOOLEAN FailDiskReads;
+
+/* MOCKED FUNCTIONS ***********************************************************/
+
+BOOLEAN
+FsRtlGetNextLargeMcbEntry(
+    _In_ PLARGE_MCB Mcb,
+    _In_ ULONG RunIndex,
+    _Out_ PLONGLONG Vbn,
+    _Out_ PLONGLONG Lbn,
+    _Out_ PLONGLONG SectorCount)
+{
+    if (RunIndex >= Mcb->EntryCount)
+        return FALSE;
+
+    *Vbn = Mcb->Entries[RunIndex][0];
+    *Lbn = Mcb->Entries[RunIndex][1];
+    *SectorCount = Mcb->Entries[RunIndex][2];
+    return TRUE;
+}
+
+NTSTATUS
+NtfsReadDisk(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ LONGLONG StartingOffset,
+    _In_ ULONG Length,
+    _In_ ULONG SectorSize,
+    _Inout_ PUCHAR Buffer,
+    _In_ BOOLEAN Override)
+{
+    ok(SectorSize == TEST_CLUSTER_SIZE, "SectorSize is %lu\n", SectorSize);
+    ok(StartingOffset >= 0 && StartingOffset + Length <= sizeof(TestDisk),
+       "Read of %lu bytes at %I64d is out of the disk\n", Length, StartingOffset);
+
+    DiskReads++;
+    if (FailDiskReads)
+        return STATUS_DEVICE_DATA_ERROR;
+
+    RtlCopyMemory(Buffer, TestDisk + StartingOffset, Length);
+    return STATUS_SUCCESS;
+}
+
+/* FUNCTIONS ******************************************************************/
+
+static
+VOID
+InitializeTestImage(VOID)
+{
+    ULONG i, Cluster;
+    LONGLONG Lcn;
+
+    for (i = 0; i < sizeof(TestDisk); i++)
+        TestDisk[i] = (UCHAR)((i / TEST_CLUSTER_SIZE) * 13 + i % 251);
+
+    /* What the file should read as */
+    for (i = 0; i < RTL_NUMBER_OF(TestRuns); i++)
+    {
+        for (Cluster = 0; Cluster < TestRuns[i][2]; Cluster++)
+        {
+            Lcn = TestRuns[i][1];
+            if (Lcn == -1)
+            {
+                RtlZeroMemory(TestFile + (TestRuns[i][0] + Cluster) * TEST_CLUSTER_SIZE,
+                              TEST_CLUSTER_SIZE);
+            }
+            else
+            {
+                RtlCopyMemory(TestFile + (TestRuns[i][0] + Cluster) * TEST_CLUSTER_SIZE,
+                              TestDisk + (Lcn + Cluster) * TEST_CLUSTER_SIZE,
+                              TEST_CLUSTER_SIZE);
+            }
+        }
+    }
+}
+
+static
+VOID
+CheckRunList(
+    _In_ PNTFS_RUN_LIST RunList)
+{
+    ULONG i;
+
+    ok(RunList->RunCount == RTL_NUMBER_OF(TestRuns), "RunCount is %lu\n", RunList->RunCount);
+    if (RunList->RunCount != RTL_NUMBER_OF(TestRuns))
+        return;
+
+    for (i = 0; i < RunList->RunCount; i++)
+    {
+        ok(RunList->Runs[i].Vcn == (ULONGLONG)TestRuns[i][0],
+           "Run %lu: Vcn is %I64u\n", i, RunList->Runs[i].Vcn);
+        ok(RunList->Runs[i].Lcn == TestRuns[i][1],
+           "Run %lu: Lcn is %I64d\n", i, RunList->Runs[i].Lcn);
+        ok(RunList->Runs[i].Length == (ULONGLONG)TestRuns[i][2],
+           "Run %lu: Length is %I64u\n", i, RunList->Runs[i].Length);
+    }
+}
+
+static
+VOID
+TestLookup(
+    _In_ PNTFS_RUN_LIST RunList)
+{
+    PNTFS_RUN Run;
+    ULONGLONG Vcn;
+    ULONG Expected = 0;
+
+    for (Vcn = 0; Vcn < TEST_FILE_CLUSTERS; Vcn++)
+    {
+        if (Vcn >= (ULONGLONG)(TestRuns[Expected][0] + TestRuns[Expected][2]))
+            Expected++;
+
+        Run = NtfsLookupRun(RunList, Vcn);
+        ok(Run == &RunList->Runs[Expected], "VCN %I64u: got run %p, expected %lu\n", Vcn, Run, Expected);
+    }
+
+    Run = NtfsLookupRun(RunList, TEST_FILE_CLUSTERS);
+    ok(Run == NULL, "Lookup past the end returned %p\n", Run);
+    Run = NtfsLookupRun(RunList, MAXULONGLONG);
+    ok(Run == NULL, "Lookup past the end returned %p\n", Run);
+}
+
+static
+VOID
+TestReads(
+    _In_ PDEVICE_EXTENSION Vcb,
+    _In_ PNTFS_RUN_LIST RunList)
+{
+    static const ULONG Lengths[] = { 1, 300, 512, 1500, 5000, sizeof(TestFile) };
+    ULONG Offset, i, Read, Expected;
+
+    /* A whole read takes one disk request per physically contiguous extent */
+    DiskReads = 0;
+    Read = NtfsReadRunList(Vcb, RunList, 0, (PCHAR)ReadBuffer, sizeof(TestFile));
+    ok(Read == sizeof(TestFile), "Read %lu bytes\n", Read);
+    ok(!memcmp(ReadBuffer, TestFile, sizeof(TestFile)), "Data mismatch\n");
+    ok(DiskReads == 4, "DiskReads is %lu\n", DiskReads);
+
+    /* Unaligned reads, across run boundaries and the hole */
+    for (Offset = 0; Offset < sizeof(TestFile); Offset += 97)
+    {
+        for (i = 0; i < RTL_NUMBER_OF(Lengths); i++)
+        {
+            Expected = min(Lengths[i], sizeof(TestFile) - Offset);
+
+            FillMemory(ReadBuffer, sizeof(ReadBuffer), 0xCC);
+            Read = NtfsReadRunList(Vcb, RunList, Offset, (PCHAR)ReadBuffer, Lengths[i]);
+            ok(Read == Expected, "Offset %lu, length %lu: read %lu bytes\n", Offset, Lengths[i], Read);
+            ok(!memcmp(ReadBuffer, TestFile + Offset, Expected),
+               "Offset %lu, length %lu: data mismatch\n", Offset, Lengths[i]);
+        }
+    }
+
+    /* Nothing to read past the end */
+    Read = NtfsReadRunList(Vcb, RunList, sizeof(TestFile), (PCHAR)ReadBuffer, 1);
+    ok(Read == 0, "Read %lu bytes\n", Read);
+
+    /* A failed disk read stops the read, the hole before it is still returned */
+    FailDiskReads = TRUE;
+    Read = NtfsReadRunList(Vcb, RunList, 0, (PCHAR)ReadBuffer, sizeof(TestFile));
+    ok(Read == 0, "Read %lu bytes\n", Read);
+    Read = NtfsReadRunList(Vcb, RunList, 4 * TEST_CLUSTER_SIZE, (PCHAR)ReadBuffer, 4 * TEST_CLUSTER_SIZE);
+    ok(Read == 3 * TEST_CLUSTER_SIZE, "Read %lu bytes\n", Read);
+    FailDiskReads = FALSE;
+}
+
+START_TEST(RunList)
+{
+    static const LONGLONG McbEntries[][3] =
+    {
+        {  0,  10,  4 },
+        {  4,  -1,  3 },
+        {  7,   2,  5 },
+        { 12, 300,  1 },
+        { 13,  20, 11 },
+        { 24,  31,  2 },
+    };
+    DEVICE_EXTENSION Vcb;
+    LARGE_MCB Mcb;
+    PNTFS_RUN_LIST RunList;
+    NTSTATUS Status;
+
+    InitializeTestImage();
+
+    Vcb.StorageDevice = NULL;
+    Vcb.NtfsInfo.BytesPerSector = TEST_CLUSTER_SIZE;
+    Vcb.NtfsInfo.BytesPerCluster = TEST_CLUSTER_SIZE;
+
+    /* From the mapping pairs */
+    Status = NtfsCreateRunList((PUCHAR)TestDataRuns, &RunList);
+    ok(Status == STATUS_SUCCESS, "Status is 0x%lx\n", Status);
+    if (NT_SUCCESS(Status))
+    {
+        CheckRunList(RunList);
+        TestLookup(RunList);
+        TestReads(&Vcb, RunList);
+        NtfsFreeRunList(RunList);
+    }
+
+    /* From the MCB, as after the attribute was extended */
+    Mcb.EntryCount = RTL_NUMBER_OF(McbEntries);
+    Mcb.Entries = McbEntries;
+    Status = NtfsCreateRunListFromMcb(&Mcb, &RunList);
+    ok(Status == STATUS_SUCCESS, "Status is 0x%lx\n", Status);
+    if (NT_SUCCESS(Status))
+    {
+        CheckRunList(RunList);
+
+        /* The context holds the only reference to a new list */
+        ok(RunList->RefCount == 1, "RefCount is %ld\n", RunList->RefCount);
+        NtfsReferenceRunList(RunList);
+        NtfsDereferenceRunList(RunList);
+        ok(RunList->RefCount == 1, "RefCount is %ld\n", RunList->RefCount);
+        TestReads(&Vcb, RunList);
+        NtfsDereferenceRunList(RunList);
+    }
+
+    /* An empty attribute */
+    Status = NtfsCreateRunList((PUCHAR)&TestDataRuns[sizeof(TestDataRuns) - 1], &RunList);
+    ok(Status == STATUS_SUCCESS, "Status is 0x%lx\n", Status);
+    if (NT_SUCCESS(Status))
+    {
+        ok(RunList->RunCount == 0, "RunCount is %lu\n", RunList->RunCount);
+        ok(NtfsLookupRun(RunList, 0) == NULL, "Found a run in an empty list\n");
+        NtfsFreeRunList(RunList);
+    }
+}
+
+/* A compression unit is 16 clusters, 8 KB, as on a volume with 512 bytes clusters */
+#define TEST_UNIT_SHIFT     4
+#define TEST_UNIT_CLUSTERS  (1 << TEST_UNIT_SHIFT)
+#define TEST_UNIT_SIZE      (TEST_UNIT_CLUSTERS * TEST_CLUSTER_SIZE)
+#define TEST_UNITS          4
+#define TEST_CHUNK_SIZE     4096
+
+static UCHAR TestPlainFile[TEST_UNITS * TEST_UNIT_SIZE];
+
+/*
+ * Compresses the first chunk of a unit, the rest of which is zeroes,
+ * and stores it at the given LCNs. Returns the number of clusters used.
+ */
+static
+ULONG
+StoreCompressedUnit(
+    _In_ PUCHAR Plain,
+    _In_ const LONGLONG *Lcns,
+    _In_ ULONG LcnCount)
+{
+    static UCHAR Compressed[TEST_UNIT_SIZE];
+    ULONG WorkSpaceSize, FragmentWorkSpaceSize, FinalSize, Clusters, i, j;
+    PVOID WorkSpace;
+    NTSTATUS Status;
+
+    Status = RtlGetCompressionWorkSpaceSize(COMPRESSION_FORMAT_LZNT1, &WorkSpaceSize, &FragmentWorkSpaceSize);
+    ok(Status == STATUS_SUCCESS, "Status is 0x%lx\n", Status);
+    WorkSpace = HeapAlloc(GetProcessHeap(), 0, WorkSpaceSize);
+
+    RtlZeroMemory(Compressed, sizeof(Compressed));
+    Status = RtlCompressBuffer(COMPRESSION_FORMAT_LZNT1, Plain, TEST_CHUNK_SIZE,
+                               Compressed, sizeof(Compressed), TEST_CHUNK_SIZE, &FinalSize, WorkSpace);
+    ok(Status == STATUS_SUCCESS, "Status is 0x%lx\n", Status);
+    HeapFree(GetProcessHeap(), 0, WorkSpace);
+
+    Clusters = (FinalSize + TEST_CLUSTER_SIZE - 1) / TEST_CLUSTER_SIZE;
+    ok(Clusters >= LcnCount && Clusters < TEST_UNIT_CLUSTERS, "Unit compressed to %lu clusters\n", Clusters);
+
+    /* One cluster at each LCN, the remaining ones follow the last LCN */
+    for (i = 0; i < Clusters; i++)
+    {
+        j = min(i, LcnCount - 1);
+        RtlCopyMemory(TestDisk + (Lcns[j] + i - j) * TEST_CLUSTER_SIZE,
+                      Compressed + i * TEST_CLUSTER_SIZE,
+                      TEST_CLUSTER_SIZE);
+    }
+
+    return Clusters;
+}
+
+static
+VOID
+TestCompressedRange(
+    _In_ PDEVICE_EXTENSION Vcb,
+    _In_ PNTFS_RUN_LIST RunList,
+    _In_opt_ PNTFS_UNIT_CACHE Cache,
+    _In_ ULONG Offset,
+    _In_ ULONG Length)
+{
+    ULONG Read, Expected;
+
+    Expected = (Offset < sizeof(TestPlainFile)) ? min(Length, sizeof(TestPlainFile) - Offset) : 0;
+
+    FillMemory(ReadBuffer, sizeof(ReadBuffer), 0xCC);
+    Read = NtfsReadCompressedRunList(Vcb, RunList, TEST_UNIT_SHIFT, Cache, Offset, (PCHAR)ReadBuffer, Length);
+    ok(Read == Expected, "Offset %lu, length %lu: read %lu bytes\n", Offset, Length, Read);
+    ok(!memcmp(ReadBuffer, TestPlainFile + Offset, Expected),
+       "Offset %lu, length %lu: data mismatch\n", Offset, Length);
+}
+
+START_TEST(CompressedRead)
+{
+    static const LONGLONG Unit0Lcns[] = { 100 };
+    static const LONGLONG Unit3Lcns[] = { 200, 60 };
+    static const ULONG Lengths[] = { 1, 1000, TEST_UNIT_SIZE, 20000 };
+    static LONGLONG McbEntries[8][3];
+    static UCHAR Zeroes[TEST_UNIT_SIZE];
+    DEVICE_EXTENSION Vcb;
+    LARGE_MCB Mcb;
+    PNTFS_RUN_LIST RunList;
+    NTFS_UNIT_CACHE Cache;
+    ULONG Clusters0, Clusters3, Offset, Read, i;
+    NTSTATUS Status;
+
+    Vcb.StorageDevice = NULL;
+    Vcb.NtfsInfo.BytesPerSector = TEST_CLUSTER_SIZE;
+    Vcb.NtfsInfo.BytesPerCluster = TEST_CLUSTER_SIZE;
+
+    for (i = 0; i < sizeof(TestDisk); i++)
+        TestDisk[i] = (UCHAR)(i * 7);
+
+    /*
+     * Unit 0 is text, unit 1 is a hole, unit 2 is stored as is,
+     * and unit 3 is noise that only fits in several runs.
+     */
+    RtlZeroMemory(TestPlainFile, sizeof(TestPlainFile));
+    for (i = 0; i < TEST_CHUNK_SIZE; i++)
+    {
+        TestPlainFile[i] = "ReactOS NTFS compressed unit "[i % 29];
+        TestPlainFile[3 * TEST_UNIT_SIZE + i] = (UCHAR)((i * 1103515245 + 12345) >> 16);
+    }
+    for (i = 0; i < TEST_UNIT_SIZE; i++)
+        TestPlainFile[2 * TEST_UNIT_SIZE + i] = (UCHAR)((i * 69069 + 1) >> 8);
+    RtlCopyMemory(TestDisk + 150 * TEST_CLUSTER_SIZE, TestPlainFile + 2 * TEST_UNIT_SIZE, TEST_UNIT_SIZE);
+
+    Clusters0 = StoreCompressedUnit(TestPlainFile, Unit0Lcns, RTL_NUMBER_OF(Unit0Lcns));
+    Clusters3 = StoreCompressedUnit(TestPlainFile + 3 * TEST_UNIT_SIZE, Unit3Lcns, RTL_NUMBER_OF(Unit3Lcns));
+
+    /* Compressed data in a fragmented unit 3, holes merged like the MCB does */
+    i = 0;
+    McbEntries[i][0] = 0;  McbEntries[i][1] = 100; McbEntries[i++][2] = Clusters0;
+    McbEntries[i][0] = Clusters0; McbEntries[i][1] = -1; McbEntries[i++][2] = 2 * TEST_UNIT_CLUSTERS - Clusters0;
+    McbEntries[i][0] = 32; McbEntries[i][1] = 150; McbEntries[i++][2] = TEST_UNIT_CLUSTERS;
+    McbEntries[i][0] = 48; McbEntries[i][1] = 200; McbEntries[i++][2] = 1;
+    McbEntries[i][0] = 49; McbEntries[i][1] = 60;  McbEntries[i++][2] = Clusters3 - 1;
+    McbEntries[i][0] = 48 + Clusters3; McbEntries[i][1] = -1; McbEntries[i++][2] = TEST_UNIT_CLUSTERS - Clusters3;
+    Mcb.EntryCount = i;
+    Mcb.Entries = (const LONGLONG (*)[3])McbEntries;
+
+    Status = NtfsCreateRunListFromMcb(&Mcb, &RunList);
+    ok(Status == STATUS_SUCCESS, "Status is 0x%lx\n", Status);
+    if (!NT_SUCCESS(Status))
+        return;
+
+    /* One disk request per unit, or per fragment of it. None for the hole */
+    DiskReads = 0;
+    TestCompressedRange(&Vcb, RunList, NULL, 0, sizeof(TestPlainFile));
+    ok(DiskReads == 4, "DiskReads is %lu\n", DiskReads);
+
+    DiskReads = 0;
+    Read = NtfsReadCompressedRunList(&Vcb, RunList, TEST_UNIT_SHIFT, NULL, TEST_UNIT_SIZE + 100, (PCHAR)ReadBuffer, 5000);
+    ok(Read == 5000, "Read %lu bytes\n", Read);
+    ok(!memcmp(ReadBuffer, Zeroes, Read), "Hole isn't zeroed\n");
+    ok(DiskReads == 0, "DiskReads is %lu\n", DiskReads);
+
+    /* Unaligned reads, with and without the cache */
+    NtfsInitializeUnitCache(&Cache);
+    for (Offset = 0; Offset < sizeof(TestPlainFile); Offset += 777)
+    {
+        for (i = 0; i < RTL_NUMBER_OF(Lengths); i++)
+        {
+            TestCompressedRange(&Vcb, RunList, NULL, Offset, Lengths[i]);
+            TestCompressedRange(&Vcb, RunList, &Cache, Offset, Lengths[i]);
+        }
+    }
+
+    /* A sequential reader decompresses each unit once */
+    NtfsFreeUnitCache(&Cache);
+    DiskReads = 0;
+    for (Offset = 0; Offset < TEST_UNIT_SIZE; Offset += 1024)
+        TestCompressedRange(&Vcb, RunList, &Cache, Offset, 1024);
+    ok(DiskReads == 1, "DiskReads is %lu\n", DiskReads);
+
+    DiskReads = 0;
+    for (Offset = 0; Offset < TEST_UNIT_SIZE; Offset += 1024)
+        TestCompressedRange(&Vcb, RunList, NULL, Offset, 1024);
+    ok(DiskReads == TEST_UNIT_SIZE / 1024, "DiskReads is %lu\n", DiskReads);
+
+    /* Switching units replaces the cached one */
+    TestCompressedRange(&Vcb, RunList, &Cache, 3 * TEST_UNIT_SIZE + 10, 100);
+    TestCompressedRange(&Vcb, RunList, &Cache, 10, 100);
+    TestCompressedRange(&Vcb, RunList, &Cache, 3 * TEST_UNIT_SIZE + 5000, 3000);
+    ok(Cache.Vcn == 48, "Cached unit at VCN %I64u\n", Cache.Vcn);
+
+    /* Past the end */
+    TestCompressedRange(&Vcb, RunList, &Cache, sizeof(TestPlainFile) - 100, 1000);
+    TestCompressedRange(&Vcb, RunList, &Cache, sizeof(TestPlainFile), 1000);
+
+    /* A failed disk read stops the read, the hole before it is still returned */
+    FailDiskReads = TRUE;
+    NtfsFreeUnitCache(&Cache);
+    Read = NtfsReadCompressedRunList(&Vcb, RunList, TEST_UNIT_SHIFT, &Cache, TEST_UNIT_SIZE, (PCHAR)ReadBuffer, 2 * TEST_UNIT_SIZE);
+    ok(Read == TEST_UNIT_SIZE, "Read %lu bytes\n", Read);
+    ok(Cache.Buffer == NULL, "Cache is %p\n", Cache.Buffer);
+    FailDiskReads = FALSE;
+
+    NtfsFreeUnitCache(&Cache);
+    NtfsFreeRunList(RunList);
+}
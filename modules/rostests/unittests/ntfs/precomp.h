@@ -0,0 +1,97 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Precompiled header for ntfs_unittest
+ */
+
+#pragma once
+
+#include <apitest.h>
+
+#define WIN32_NO_STATUS
+#include <ndk/rtlfuncs.h>
+
+typedef PVOID PDEVICE_OBJECT;
+
+#define UNIT_TEST
+
+/* KERNEL DEFINITIONS (MOCK) **************************************************/
+
+#define DPRINT(...)  do { if (0) { trace(__VA_ARGS__); } } while (0)
+#define DPRINT1(...) do { if (0) { trace(__VA_ARGS__); } } while (0)
+
+FORCEINLINE
+PVOID
+ExAllocatePoolWithTag(ULONG PoolType, SIZE_T NumberOfBytes, ULONG Tag)
+{
+    PULONG_PTR Mem = HeapAlloc(GetProcessHeap(), 0, NumberOfBytes + 2 * sizeof(PVOID));
+    if (Mem == NULL)
+        return NULL;
+
+    Mem[0] = NumberOfBytes;
+    Mem[1] = Tag;
+
+    return (PVOID)(Mem + 2);
+}
+
+FORCEINLINE
+VOID
+ExFreePoolWithTag(PVOID MemPtr, ULONG Tag)
+{
+    PULONG_PTR Mem = MemPtr;
+
+    Mem -= 2;
+    ok(Mem[1] == Tag, "Tag is %lx, expected %lx\n", Tag, Mem[1]);
+    HeapFree(GetProcessHeap(), 0, Mem);
+}
+
+typedef struct _FAST_MUTEX
+{
+    LONG Count;
+} FAST_MUTEX, *PFAST_MUTEX;
+
+#define ExInitializeFastMutex(FastMutex)    ((FastMutex)->Count = 1)
+#define ExAcquireFastMutex(FastMutex)       ok(--(FastMutex)->Count == 0, "Recursive acquire\n")
+#define ExReleaseFastMutex(FastMutex)       ok(++(FastMutex)->Count == 1, "Release without acquire\n")
+
+/* The MCB is an array of [Vbn, Lbn, Count] entries, holes included */
+typedef struct _LARGE_MCB
+{
+    ULONG EntryCount;
+    const LONGLONG (*Entries)[3];
+} LARGE_MCB, *PLARGE_MCB;
+
+BOOLEAN
+FsRtlGetNextLargeMcbEntry(
+    _In_ PLARGE_MCB Mcb,
+    _In_ ULONG RunIndex,
+    _Out_ PLONGLONG Vbn,
+    _Out_ PLONGLONG Lbn,
+    _Out_ PLONGLONG SectorCount);
+
+/* NTFS DRIVER DEFINITIONS (MOCK) *********************************************/
+
+#define TAG_NTFS '0ftN'
+
+typedef struct _NTFS_INFO
+{
+    ULONG BytesPerSector;
+    ULONG BytesPerCluster;
+} NTFS_INFO;
+
+typedef struct _DEVICE_EXTENSION
+{
+    PDEVICE_OBJECT StorageDevice;
+    NTFS_INFO NtfsInfo;
+} DEVICE_EXTENSION, *PDEVICE_EXTENSION;
+
+NTSTATUS
+NtfsReadDisk(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ LONGLONG StartingOffset,
+    _In_ ULONG Length,
+    _In_ ULONG SectorSize,
+    _Inout_ PUCHAR Buffer,
+    _In_ BOOLEAN Override);
+
+#include <runlist.h>
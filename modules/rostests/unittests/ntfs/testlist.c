@@ -0,0 +1,18 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test list for the NTFS filesystem driver
+ */
+
+#define STANDALONE
+#include <apitest.h>
+
+extern void func_CompressedRead(void);
+extern void func_RunList(void);
+
+const struct test winetest_testlist[] =
+{
+    { "CompressedRead", func_CompressedRead },
+    { "RunList", func_RunList },
+    { 0, 0 }
+};
@@ -166,7 +166,7 @@ CcPurgeCacheSection (
     LONGLONG EndOffset;
     LIST_ENTRY FreeList;
     KIRQL OldIrql;
-    PLIST_ENTRY ListEntry;
+    ULONG Index;
     PROS_VACB Vacb;
     LONGLONG ViewEnd;
     BOOLEAN Success;
@@ -222,19 +222,19 @@ CcPurgeCacheSection (
 
     OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
     KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
-    ListEntry = SharedCacheMap->CacheMapVacbListHead.Flink;
-    while (ListEntry != &SharedCacheMap->CacheMapVacbListHead)
+
+    /* Skip VACBs outside the range, or only partially in range */
+    Index = CcRosVacbIndex(ROUND_UP(StartOffset, VACB_MAPPING_GRANULARITY));
+    for (; Index < SharedCacheMap->VacbsCount; Index++)
     {
         ULONG Refs;
 
-        Vacb = CONTAINING_RECORD(ListEntry, ROS_VACB, CacheMapVacbListEntry);
-        ListEntry = ListEntry->Flink;
-
-        /* Skip VACBs outside the range, or only partially in range */
-        if (Vacb->FileOffset.QuadPart < StartOffset)
+        Vacb = SharedCacheMap->Vacbs[Index];
+        if (Vacb == NULL)
         {
             continue;
         }
+
         ViewEnd = min(Vacb->FileOffset.QuadPart + VACB_MAPPING_GRANULARITY,
                       SharedCacheMap->SectionSize.QuadPart);
         if (ViewEnd >= EndOffset)
@@ -261,7 +261,7 @@ CcPurgeCacheSection (
         {
             CcRosUnmarkDirtyVacb(Vacb, FALSE);
         }
-        RemoveEntryList(&Vacb->CacheMapVacbListEntry);
+        CcRosUnlinkVacb(Vacb);
         InsertHeadList(&FreeList, &Vacb->CacheMapVacbListEntry);
     }
     KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
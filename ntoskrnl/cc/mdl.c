@@ -28,10 +28,80 @@ CcMdlRead (
     OUT PIO_STATUS_BLOCK IoStatus
     )
 {
+    PROS_VACB Vacb;
+    PROS_SHARED_CACHE_MAP SharedCacheMap = FileObject->SectionObjectPointer->SharedCacheMap;
+    NTSTATUS Status;
+    LONGLONG CurrentOffset = FileOffset->QuadPart;
+    ULONG ReadLength = 0;
+    PMDL Mdl, *FirstMdl, *NextMdl;
+
     CCTRACE(CC_API_DEBUG, "FileObject=%p FileOffset=%I64d Length=%lu\n",
         FileObject, FileOffset->QuadPart, Length);
 
-    UNIMPLEMENTED;
+    ASSERT(SharedCacheMap);
+
+    /* New MDLs are appended to the caller's chain */
+    FirstMdl = MdlChain;
+    while (*FirstMdl)
+        FirstMdl = &(*FirstMdl)->Next;
+    NextMdl = FirstMdl;
+
+    _SEH2_TRY
+    {
+        while (Length > 0)
+        {
+            Status = CcRosGetVacb(SharedCacheMap, CurrentOffset, &Vacb);
+            if (!NT_SUCCESS(Status))
+                ExRaiseStatus(Status);
+
+            _SEH2_TRY
+            {
+                ULONG VacbOffset = CurrentOffset % VACB_MAPPING_GRANULARITY;
+                ULONG VacbLength = min(Length, VACB_MAPPING_GRANULARITY - VacbOffset);
+
+                CcRosEnsureVacbResident(Vacb, TRUE, FALSE, VacbOffset, VacbLength);
+
+                /* One MDL per view, describing the cache pages themselves */
+                Mdl = IoAllocateMdl((PUCHAR)Vacb->BaseAddress + VacbOffset, VacbLength, FALSE, FALSE, NULL);
+                if (!Mdl)
+                    ExRaiseStatus(STATUS_INSUFFICIENT_RESOURCES);
+
+                *NextMdl = Mdl;
+                NextMdl = &Mdl->Next;
+
+                MmProbeAndLockPages(Mdl, KernelMode, IoReadAccess);
+
+                ReadLength += VacbLength;
+                CurrentOffset += VacbLength;
+                Length -= VacbLength;
+            }
+            _SEH2_FINALLY
+            {
+                /* The locked pages stay resident once the view is released */
+                CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE);
+            }
+            _SEH2_END;
+        }
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        Status = _SEH2_GetExceptionCode();
+
+        /* Give back whatever was locked so far */
+        while ((Mdl = *FirstMdl))
+        {
+            *FirstMdl = Mdl->Next;
+            if (Mdl->MdlFlags & MDL_PAGES_LOCKED)
+                MmUnlockPages(Mdl);
+            IoFreeMdl(Mdl);
+        }
+
+        ExRaiseStatus(Status);
+    }
+    _SEH2_END;
+
+    IoStatus->Status = STATUS_SUCCESS;
+    IoStatus->Information = ReadLength;
 }
 
 /*
@@ -291,6 +291,12 @@ CcRosDeleteFileCache (
 #endif
     }
 
+    /* All the VACBs are gone, so is the need for an index */
+    if (SharedCacheMap->Vacbs != SharedCacheMap->InitialVacbs)
+    {
+        ExFreePoolWithTag(SharedCacheMap->Vacbs, TAG_VACB_INDEX);
+    }
+
     /* Release the references we own */
     if(SharedCacheMap->Section)
         ObDereferenceObject(SharedCacheMap->Section);
@@ -536,7 +542,7 @@ retry:
             ASSERT(!current->MappedCount);
             ASSERT(Refs == 1);
 
-            RemoveEntryList(&current->CacheMapVacbListEntry);
+            CcRosUnlinkVacb(current);
             RemoveEntryList(&current->VacbLruListEntry);
             InitializeListHead(&current->VacbLruListEntry);
             InsertHeadList(&FreeList, &current->CacheMapVacbListEntry);
@@ -618,13 +624,12 @@ CcRosReleaseVacb (
     return STATUS_SUCCESS;
 }
 
-/* Returns with VACB Lock Held! */
+/* Returns a referenced VACB, or NULL if there is none mapping FileOffset */
 PROS_VACB
 CcRosLookupVacb (
     PROS_SHARED_CACHE_MAP SharedCacheMap,
     LONGLONG FileOffset)
 {
-    PLIST_ENTRY current_entry;
     PROS_VACB current;
     KIRQL oldIrql;
 
@@ -633,33 +638,22 @@ CcRosLookupVacb (
     DPRINT("CcRosLookupVacb(SharedCacheMap 0x%p, FileOffset %I64u)\n",
            SharedCacheMap, FileOffset);
 
-    oldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
-    KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
+    /* VACBs are only ever unlinked from the index with the CacheMapLock held,
+     * so there is no need for the master lock here */
+    KeAcquireSpinLock(&SharedCacheMap->CacheMapLock, &oldIrql);
 
-    current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
-    while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
+    current = CcRosVacbIndexLookup(SharedCacheMap, FileOffset);
+    if (current != NULL)
     {
-        current = CONTAINING_RECORD(current_entry,
-                                    ROS_VACB,
-                                    CacheMapVacbListEntry);
-        if (IsPointInRange(current->FileOffset.QuadPart,
-                           VACB_MAPPING_GRANULARITY,
-                           FileOffset))
-        {
-            CcRosVacbIncRefCount(current);
-            KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
-            KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
-            return current;
-        }
-        if (current->FileOffset.QuadPart > FileOffset)
-            break;
-        current_entry = current_entry->Flink;
+        ASSERT(IsPointInRange(current->FileOffset.QuadPart,
+                              VACB_MAPPING_GRANULARITY,
+                              FileOffset));
+        CcRosVacbIncRefCount(current);
     }
 
-    KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
-    KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
+    KeReleaseSpinLock(&SharedCacheMap->CacheMapLock, oldIrql);
 
-    return NULL;
+    return current;
 }
 
 VOID
@@ -765,7 +759,7 @@ CcRosFreeOneUnusedVacb(
             ASSERT(Refs == 1);
 
             /* Reset it, this is the one we want to free */
-            RemoveEntryList(&current->CacheMapVacbListEntry);
+            CcRosUnlinkVacb(current);
             InitializeListHead(&current->CacheMapVacbListEntry);
             RemoveEntryList(&current->VacbLruListEntry);
             InitializeListHead(&current->VacbLruListEntry);
@@ -792,6 +786,73 @@ CcRosFreeOneUnusedVacb(
     return TRUE;
 }
 
+static
+NTSTATUS
+CcRosGrowVacbIndex (
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    ULONG Index)
+/*
+ * FUNCTION: Makes sure the VACB index of a shared cache map has a slot for Index
+ */
+{
+    KIRQL oldIrql;
+    ULONG NewCount;
+    PROS_VACB *NewVacbs;
+    PROS_VACB *OldVacbs;
+
+    KeAcquireSpinLock(&SharedCacheMap->CacheMapLock, &oldIrql);
+    NewCount = SharedCacheMap->VacbsCount;
+    KeReleaseSpinLock(&SharedCacheMap->CacheMapLock, oldIrql);
+
+    if (Index < NewCount)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    /* Only grow to what is actually mapped, doubling to amortize the copies */
+    while (NewCount <= Index)
+    {
+        if (NewCount > MAXULONG / 2 / sizeof(PROS_VACB))
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+        NewCount *= 2;
+    }
+
+    NewVacbs = ExAllocatePoolWithTag(NonPagedPool, NewCount * sizeof(PROS_VACB), TAG_VACB_INDEX);
+    if (NewVacbs == NULL)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    KeAcquireSpinLock(&SharedCacheMap->CacheMapLock, &oldIrql);
+    if (SharedCacheMap->VacbsCount < NewCount)
+    {
+        RtlCopyMemory(NewVacbs,
+                      SharedCacheMap->Vacbs,
+                      SharedCacheMap->VacbsCount * sizeof(PROS_VACB));
+        RtlZeroMemory(NewVacbs + SharedCacheMap->VacbsCount,
+                      (NewCount - SharedCacheMap->VacbsCount) * sizeof(PROS_VACB));
+
+        OldVacbs = SharedCacheMap->Vacbs;
+        SharedCacheMap->Vacbs = NewVacbs;
+        SharedCacheMap->VacbsCount = NewCount;
+    }
+    else
+    {
+        /* Someone else was faster */
+        OldVacbs = NewVacbs;
+    }
+    KeReleaseSpinLock(&SharedCacheMap->CacheMapLock, oldIrql);
+
+    if (OldVacbs != SharedCacheMap->InitialVacbs)
+    {
+        ExFreePoolWithTag(OldVacbs, TAG_VACB_INDEX);
+    }
+
+    return STATUS_SUCCESS;
+}
+
 static
 NTSTATUS
 CcRosCreateVacb (
@@ -800,17 +861,24 @@ CcRosCreateVacb (
     PROS_VACB *Vacb)
 {
     PROS_VACB current;
-    PROS_VACB previous;
-    PLIST_ENTRY current_entry;
     NTSTATUS Status;
     KIRQL oldIrql;
     ULONG Refs;
+    ULONG Index;
     SIZE_T ViewSize = VACB_MAPPING_GRANULARITY;
 
     ASSERT(SharedCacheMap);
 
     DPRINT("CcRosCreateVacb()\n");
 
+    /* Make room in the index before we get to the point where we cannot allocate */
+    Index = CcRosVacbIndex(FileOffset);
+    Status = CcRosGrowVacbIndex(SharedCacheMap, Index);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
     current = ExAllocateFromNPagedLookasideList(&VacbLookasideList);
     if (!current)
     {
@@ -866,56 +934,32 @@ CcRosCreateVacb (
      * our newly created VACB and return the existing one.
      */
     KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
-    current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
-    previous = NULL;
-    while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
+    current = SharedCacheMap->Vacbs[Index];
+    if (current != NULL)
     {
-        current = CONTAINING_RECORD(current_entry,
-                                    ROS_VACB,
-                                    CacheMapVacbListEntry);
-        if (IsPointInRange(current->FileOffset.QuadPart,
-                           VACB_MAPPING_GRANULARITY,
-                           FileOffset))
-        {
-            CcRosVacbIncRefCount(current);
-            KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
+        CcRosVacbIncRefCount(current);
+        KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
 #if DBG
-            if (SharedCacheMap->Trace)
-            {
-                DPRINT1("CacheMap 0x%p: deleting newly created VACB 0x%p ( found existing one 0x%p )\n",
-                        SharedCacheMap,
-                        (*Vacb),
-                        current);
-            }
+        if (SharedCacheMap->Trace)
+        {
+            DPRINT1("CacheMap 0x%p: deleting newly created VACB 0x%p ( found existing one 0x%p )\n",
+                    SharedCacheMap,
+                    (*Vacb),
+                    current);
+        }
 #endif
-            KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
+        KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
 
-            Refs = CcRosVacbDecRefCount(*Vacb);
-            ASSERT(Refs == 0);
+        Refs = CcRosVacbDecRefCount(*Vacb);
+        ASSERT(Refs == 0);
 
-            *Vacb = current;
-            return STATUS_SUCCESS;
-        }
-        if (current->FileOffset.QuadPart < FileOffset)
-        {
-            ASSERT(previous == NULL ||
-                   previous->FileOffset.QuadPart < current->FileOffset.QuadPart);
-            previous = current;
-        }
-        if (current->FileOffset.QuadPart > FileOffset)
-            break;
-        current_entry = current_entry->Flink;
+        *Vacb = current;
+        return STATUS_SUCCESS;
     }
     /* There was no existing VACB. */
     current = *Vacb;
-    if (previous)
-    {
-        InsertHeadList(&previous->CacheMapVacbListEntry, &current->CacheMapVacbListEntry);
-    }
-    else
-    {
-        InsertHeadList(&SharedCacheMap->CacheMapVacbListHead, &current->CacheMapVacbListEntry);
-    }
+    SharedCacheMap->Vacbs[Index] = current;
+    InsertTailList(&SharedCacheMap->CacheMapVacbListHead, &current->CacheMapVacbListEntry);
     KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
     InsertTailList(&VacbLruListHead, &current->VacbLruListEntry);
 
@@ -1325,6 +1369,8 @@ CcRosInitializeFileCache (
         InitializeListHead(&SharedCacheMap->PrivateList);
         KeInitializeSpinLock(&SharedCacheMap->CacheMapLock);
         InitializeListHead(&SharedCacheMap->CacheMapVacbListHead);
+        SharedCacheMap->Vacbs = SharedCacheMap->InitialVacbs;
+        SharedCacheMap->VacbsCount = CC_INITIAL_VACBS;
         InitializeListHead(&SharedCacheMap->BcbList);
         KeInitializeGuardedMutex(&SharedCacheMap->FlushCacheLock);
 
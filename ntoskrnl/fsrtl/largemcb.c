@@ -513,9 +513,44 @@ FsRtlLookupBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
     BOOLEAN Result = FALSE;
     ULONG i;
     LONGLONG LastVbn = 0, LastLbn = 0, Count = 0;   // the last values we've found during traversal
+    PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
+    LARGE_MCB_MAPPING_ENTRY NeedleRun;
+    PLARGE_MCB_MAPPING_ENTRY Run;
 
     DPRINT("FsRtlLookupBaseMcbEntry(%p, %I64d, %p, %p, %p, %p, %p)\n", OpaqueMcb, Vbn, Lbn, SectorCountFromLbn, StartingLbn, SectorCountFromStartingLbn, Index);
 
+    /* Search the tree for the run holding Vbn, unless the caller wants its index */
+    if (!Index && Vbn >= 0)
+    {
+        NeedleRun.RunStartVbn.QuadPart = Vbn;
+        NeedleRun.RunEndVbn.QuadPart = Vbn + 1;
+        NeedleRun.StartingLbn.QuadPart = ~0ULL;
+        Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
+        Run = RtlLookupElementGenericTable(&Mcb->Mapping->Table, &NeedleRun);
+        Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
+
+        if (Run)
+        {
+            LastVbn = Run->RunStartVbn.QuadPart;
+            LastLbn = Run->StartingLbn.QuadPart;
+            Count = Run->RunEndVbn.QuadPart - Run->RunStartVbn.QuadPart;
+
+            if (Lbn)
+                *Lbn = LastLbn + (Vbn - LastVbn);
+            if (SectorCountFromLbn)
+                *SectorCountFromLbn = LastVbn + Count - Vbn;
+            if (StartingLbn)
+                *StartingLbn = LastLbn;
+            if (SectorCountFromStartingLbn)
+                *SectorCountFromStartingLbn = Count;
+
+            Result = TRUE;
+            goto quit;
+        }
+
+        /* Vbn is in a hole or past the last run, find out which the slow way */
+    }
+
     for (i = 0; FsRtlGetNextBaseMcbEntry(OpaqueMcb, i, &LastVbn, &LastLbn, &Count); i++)
     {
         // have we reached the target mapping?
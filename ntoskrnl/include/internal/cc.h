@@ -167,6 +167,11 @@ typedef struct _PFSN_PREFETCHER_GLOBALS
     LONG ActivePrefetches;
 } PFSN_PREFETCHER_GLOBALS, *PPFSN_PREFETCHER_GLOBALS;
 
+/* Number of index slots embedded in the shared cache map (small files) */
+#define CC_INITIAL_VACBS 4
+
+typedef struct _ROS_VACB *PROS_VACB;
+
 typedef struct _ROS_SHARED_CACHE_MAP
 {
     CSHORT NodeTypeCode;
@@ -191,6 +196,10 @@ typedef struct _ROS_SHARED_CACHE_MAP
 
     /* ROS specific */
     LIST_ENTRY CacheMapVacbListHead;
+    /* VACB index, one slot per VACB_MAPPING_GRANULARITY. Protected by CacheMapLock */
+    PROS_VACB *Vacbs;
+    ULONG VacbsCount;
+    PROS_VACB InitialVacbs[CC_INITIAL_VACBS];
     BOOLEAN PinAccess;
     KSPIN_LOCK CacheMapLock;
     KGUARDED_MUTEX FlushCacheLock;
@@ -226,7 +235,7 @@ typedef struct _ROS_VACB
     /* Pointer to the shared cache map for the file which this view maps data for. */
     PROS_SHARED_CACHE_MAP SharedCacheMap;
     /* Pointer to the next VACB in a chain. */
-} ROS_VACB, *PROS_VACB;
+} ROS_VACB;
 
 typedef struct _INTERNAL_BCB
 {
@@ -467,6 +476,45 @@ IsPointInRange(
     return DoRangesIntersect(Offset1, Length1, Point, 1);
 }
 
+FORCEINLINE
+ULONG
+CcRosVacbIndex(
+    _In_ LONGLONG FileOffset)
+{
+    return (ULONG)(FileOffset / VACB_MAPPING_GRANULARITY);
+}
+
+/* Caller must hold the CacheMapLock */
+FORCEINLINE
+PROS_VACB
+CcRosVacbIndexLookup(
+    _In_ PROS_SHARED_CACHE_MAP SharedCacheMap,
+    _In_ LONGLONG FileOffset)
+{
+    ULONG Index = CcRosVacbIndex(FileOffset);
+
+    if (Index >= SharedCacheMap->VacbsCount)
+        return NULL;
+
+    return SharedCacheMap->Vacbs[Index];
+}
+
+/* Caller must hold the CacheMapLock */
+FORCEINLINE
+VOID
+CcRosUnlinkVacb(
+    _In_ PROS_VACB Vacb)
+{
+    PROS_SHARED_CACHE_MAP SharedCacheMap = Vacb->SharedCacheMap;
+    ULONG Index = CcRosVacbIndex(Vacb->FileOffset.QuadPart);
+
+    ASSERT(Index < SharedCacheMap->VacbsCount);
+    ASSERT(SharedCacheMap->Vacbs[Index] == Vacb);
+
+    SharedCacheMap->Vacbs[Index] = NULL;
+    RemoveEntryList(&Vacb->CacheMapVacbListEntry);
+}
+
 #define CcBugCheck(A, B, C) KeBugCheckEx(CACHE_MANAGER, BugCheckFileId | ((ULONG)(__LINE__)), A, B, C)
 
 #if DBG
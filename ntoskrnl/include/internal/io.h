@@ -325,6 +325,18 @@ typedef struct _IO_INTERRUPT
     KSPIN_LOCK SpinLock;
 } IO_INTERRUPT, *PIO_INTERRUPT;
 
+//
+// I/O Wrapper around the Kernel Interrupt of a single message
+//
+typedef struct _IO_MESSAGE_INTERRUPT
+{
+    KINTERRUPT Interrupt;
+    PKMESSAGE_SERVICE_ROUTINE MessageServiceRoutine;
+    PVOID ServiceContext;
+    ULONG MessageId;
+    KSPIN_LOCK SpinLock;
+} IO_MESSAGE_INTERRUPT, *PIO_MESSAGE_INTERRUPT;
+
 //
 // I/O Error Log Packet Header
 //
@@ -544,6 +556,12 @@ IopAssignDeviceResources(
     IN PDEVICE_NODE DeviceNode
 );
 
+VOID
+NTAPI
+IopReleaseMessageInterrupts(
+    IN PDEVICE_NODE DeviceNode
+);
+
 NTSTATUS
 NTAPI
 IopFixupResourceListWithRequirements(
@@ -165,3 +165,18 @@ IopValidateOpenPacket(IN POPEN_PACKET OpenPacket)
     /* Good packet */
     return TRUE;
 }
+
+static
+__inline
+BOOLEAN
+IopSkipCompletionPort(IN PFILE_OBJECT FileObject,
+                      IN NTSTATUS Status)
+{
+    /*
+     * With FILE_SKIP_COMPLETION_PORT_ON_SUCCESS, a request that succeeded
+     * without pending returns its status straight to the caller, who then
+     * doesn't expect a packet on the port.
+     */
+    return ((FileObject->Flags & FO_SKIP_COMPLETION_PORT) &&
+            NT_SUCCESS(Status));
+}
@@ -513,6 +513,7 @@ typedef struct _MMPAGING_FILE
     PFILE_OBJECT FileObject;
     UNICODE_STRING PageFileName;
     PRTL_BITMAP Bitmap;
+    ULONG HintSetBit;
     HANDLE FileHandle;
 }
 MMPAGING_FILE, *PMMPAGING_FILE;
@@ -707,14 +708,36 @@ MmInitSystem(IN ULONG Phase,
 
 /* pagefile.c ****************************************************************/
 
+/* Maximum number of pages transferred by a single paging file I/O */
+#define MM_PAGEFILE_CLUSTER_SIZE 16
+
 SWAPENTRY
 NTAPI
 MmAllocSwapPage(VOID);
 
+SWAPENTRY
+NTAPI
+MmAllocSwapPages(ULONG PageCount);
+
+SWAPENTRY
+NTAPI
+MmNextSwapEntry(SWAPENTRY SwapEntry);
+
 VOID
 NTAPI
 MmFreeSwapPage(SWAPENTRY Entry);
 
+VOID
+NTAPI
+MiReleasePageFileSpace(
+    _In_ MMPTE PteContents);
+
+VOID
+NTAPI
+MiMakePageFilePte(
+    _Inout_ PMMPTE NewPte,
+    _In_ SWAPENTRY SwapEntry);
+
 CODE_SEG("INIT")
 VOID
 NTAPI
@@ -731,6 +754,13 @@ MmReadFromSwapPage(
     PFN_NUMBER Page
 );
 
+NTSTATUS
+NTAPI
+MmReadFromSwapPages(
+    _In_ SWAPENTRY SwapEntry,
+    _In_reads_(PageCount) PPFN_NUMBER Pages,
+    _In_ ULONG PageCount);
+
 NTSTATUS
 NTAPI
 MmWriteToSwapPage(
@@ -738,6 +768,13 @@ MmWriteToSwapPage(
     PFN_NUMBER Page
 );
 
+NTSTATUS
+NTAPI
+MmWriteToSwapPages(
+    _In_ SWAPENTRY SwapEntry,
+    _In_reads_(PageCount) PPFN_NUMBER Pages,
+    _In_ ULONG PageCount);
+
 VOID
 NTAPI
 MmShowOutOfSpaceMessagePagingFile(VOID);
@@ -749,6 +786,14 @@ MiReadPageFile(
     _In_ ULONG PageFileIndex,
     _In_ ULONG_PTR PageFileOffset);
 
+NTSTATUS
+NTAPI
+MiReadPageFileCluster(
+    _In_reads_(PageCount) PPFN_NUMBER Pages,
+    _In_ ULONG PageCount,
+    _In_ ULONG PageFileIndex,
+    _In_ ULONG_PTR PageFileOffset);
+
 /* process.c ****************************************************************/
 
 NTSTATUS
@@ -1099,6 +1144,13 @@ MmZeroPageThread(
     VOID
 );
 
+/* modwrite.c ****************************************************************/
+
+CODE_SEG("INIT")
+VOID
+NTAPI
+MiInitModifiedPageWriter(VOID);
+
 /* hypermap.c *****************************************************************/
 PVOID
 NTAPI
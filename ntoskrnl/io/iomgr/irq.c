@@ -193,6 +193,284 @@ IopConnectInterruptExFullySpecific(
     return Status;
 }
 
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+static
+BOOLEAN
+NTAPI
+IopMessageInterruptServiceRoutine(
+    _In_ PKINTERRUPT Interrupt,
+    _In_ PVOID ServiceContext)
+{
+    PIO_MESSAGE_INTERRUPT Message = ServiceContext;
+
+    /* Tell the driver which message fired */
+    return Message->MessageServiceRoutine(Interrupt,
+                                          Message->ServiceContext,
+                                          Message->MessageId);
+}
+#endif
+
+static
+PCM_PARTIAL_RESOURCE_DESCRIPTOR
+IopGetInterruptDescriptor(
+    _In_ PDEVICE_OBJECT PhysicalDeviceObject,
+    _In_ BOOLEAN MessageBased,
+    _In_ ULONG Index)
+{
+    PDEVICE_NODE DeviceNode;
+    PCM_RESOURCE_LIST ResourceList;
+    PCM_FULL_RESOURCE_DESCRIPTOR FullDescriptor;
+    PCM_PARTIAL_RESOURCE_DESCRIPTOR Descriptor;
+    ULONG i, j;
+
+    DeviceNode = IopGetDeviceNode(PhysicalDeviceObject);
+    if (!DeviceNode || !DeviceNode->ResourceListTranslated)
+        return NULL;
+
+    ResourceList = DeviceNode->ResourceListTranslated;
+    FullDescriptor = &ResourceList->List[0];
+    for (i = 0; i < ResourceList->Count; i++)
+    {
+        Descriptor = &FullDescriptor->PartialResourceList.PartialDescriptors[0];
+        for (j = 0; j < FullDescriptor->PartialResourceList.Count; j++)
+        {
+            if (Descriptor->Type == CmResourceTypeInterrupt &&
+                !!(Descriptor->Flags & CM_RESOURCE_INTERRUPT_MESSAGE) == MessageBased)
+            {
+                /* Return the Index-th interrupt of this kind */
+                if (Index == 0)
+                    return Descriptor;
+                Index--;
+            }
+
+            Descriptor = CmiGetNextPartialDescriptor(Descriptor);
+        }
+
+        FullDescriptor = CmiGetNextResourceDescriptor(FullDescriptor);
+    }
+
+    return NULL;
+}
+
+static
+NTSTATUS
+IopConnectInterruptExLineBased(
+    _In_ PDEVICE_OBJECT PhysicalDeviceObject,
+    _Out_ PKINTERRUPT *InterruptObject,
+    _In_ PKSERVICE_ROUTINE ServiceRoutine,
+    _In_ PVOID ServiceContext,
+    _In_opt_ PKSPIN_LOCK SpinLock,
+    _In_opt_ KIRQL SynchronizeIrql,
+    _In_ BOOLEAN FloatingSave)
+{
+    PCM_PARTIAL_RESOURCE_DESCRIPTOR Descriptor;
+    KIRQL Irql;
+
+    PAGED_CODE();
+
+    /* Use the interrupt the PnP manager assigned to the device */
+    Descriptor = IopGetInterruptDescriptor(PhysicalDeviceObject, FALSE, 0);
+    if (!Descriptor)
+    {
+        DPRINT1("No line based interrupt assigned to %p\n", PhysicalDeviceObject);
+        *InterruptObject = NULL;
+        return STATUS_NOT_FOUND;
+    }
+
+    Irql = (KIRQL)Descriptor->u.Interrupt.Level;
+    if (!SpinLock || SynchronizeIrql < Irql)
+        SynchronizeIrql = Irql;
+
+    return IoConnectInterrupt(InterruptObject,
+                              ServiceRoutine,
+                              ServiceContext,
+                              SpinLock,
+                              Descriptor->u.Interrupt.Vector,
+                              Irql,
+                              SynchronizeIrql,
+                              (Descriptor->Flags & CM_RESOURCE_INTERRUPT_LATCHED) ? Latched : LevelSensitive,
+                              Descriptor->ShareDisposition == CmResourceShareShared,
+                              Descriptor->u.Interrupt.Affinity,
+                              FloatingSave);
+}
+
+static
+VOID
+IopDisconnectInterruptExMessageBased(
+    _In_ PIO_INTERRUPT_MESSAGE_INFO MessageTable)
+{
+    ULONG i;
+
+    PAGED_CODE();
+
+    for (i = 0; i < MessageTable->MessageCount; i++)
+    {
+        /* Make sure it was connected */
+        if (MessageTable->MessageInfo[i].InterruptObject)
+            KeDisconnectInterrupt(MessageTable->MessageInfo[i].InterruptObject);
+    }
+
+    ExFreePoolWithTag(MessageTable, TAG_IO_INTERRUPT);
+}
+
+static
+NTSTATUS
+IopConnectInterruptExFallBack(
+    _Inout_ PIO_CONNECT_INTERRUPT_PARAMETERS Parameters)
+{
+    PIO_CONNECT_INTERRUPT_MESSAGE_BASED_PARAMETERS MessageBased = &Parameters->MessageBased;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    /* The device didn't get any message, try its line based interrupt */
+    if (!MessageBased->FallBackServiceRoutine)
+        return STATUS_NOT_FOUND;
+
+    Status = IopConnectInterruptExLineBased(MessageBased->PhysicalDeviceObject,
+                                            MessageBased->ConnectionContext.InterruptObject,
+                                            MessageBased->FallBackServiceRoutine,
+                                            MessageBased->ServiceContext,
+                                            MessageBased->SpinLock,
+                                            MessageBased->SynchronizeIrql,
+                                            MessageBased->FloatingSave);
+
+    /* Let the caller know what it got */
+    if (NT_SUCCESS(Status))
+        Parameters->Version = CONNECT_LINE_BASED;
+
+    return Status;
+}
+
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+static
+NTSTATUS
+IopConnectInterruptExMessageBased(
+    _Inout_ PIO_CONNECT_INTERRUPT_PARAMETERS Parameters)
+{
+    PIO_CONNECT_INTERRUPT_MESSAGE_BASED_PARAMETERS MessageBased = &Parameters->MessageBased;
+    PCM_PARTIAL_RESOURCE_DESCRIPTOR Descriptor;
+    PIO_INTERRUPT_MESSAGE_INFO MessageTable;
+    PIO_INTERRUPT_MESSAGE_INFO_ENTRY Entry;
+    PIO_MESSAGE_INTERRUPT Messages;
+    SIZE_T TableSize;
+    ULONG MessageCount, i;
+    CCHAR Processor;
+    KIRQL UnifiedIrql;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    /* Count the messages and find the highest IRQL */
+    UnifiedIrql = PASSIVE_LEVEL;
+    for (MessageCount = 0; ; MessageCount++)
+    {
+        Descriptor = IopGetInterruptDescriptor(MessageBased->PhysicalDeviceObject, TRUE, MessageCount);
+        if (!Descriptor)
+            break;
+
+        UnifiedIrql = max(UnifiedIrql, (KIRQL)Descriptor->u.MessageInterrupt.Translated.Level);
+    }
+
+    if (MessageCount == 0)
+        return IopConnectInterruptExFallBack(Parameters);
+
+    /* The table is followed by the interrupt objects */
+    TableSize = ALIGN_UP_BY(FIELD_OFFSET(IO_INTERRUPT_MESSAGE_INFO, MessageInfo[MessageCount]),
+                            MEMORY_ALLOCATION_ALIGNMENT);
+    MessageTable = ExAllocatePoolZero(NonPagedPool,
+                                      TableSize + MessageCount * sizeof(IO_MESSAGE_INTERRUPT),
+                                      TAG_IO_INTERRUPT);
+    if (!MessageTable)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    Messages = (PIO_MESSAGE_INTERRUPT)((ULONG_PTR)MessageTable + TableSize);
+    MessageTable->UnifiedIrql = UnifiedIrql;
+    MessageTable->MessageCount = MessageCount;
+
+    for (i = 0; i < MessageCount; i++)
+    {
+        Descriptor = IopGetInterruptDescriptor(MessageBased->PhysicalDeviceObject, TRUE, i);
+        Entry = &MessageTable->MessageInfo[i];
+
+        Entry->Vector = Descriptor->u.MessageInterrupt.Translated.Vector;
+        Entry->Irql = (KIRQL)Descriptor->u.MessageInterrupt.Translated.Level;
+        Entry->TargetProcessorSet = Descriptor->u.MessageInterrupt.Translated.Affinity & KeActiveProcessors;
+        Entry->Mode = Latched;
+        Entry->Polarity = InterruptActiveHigh;
+
+        /* Get what the device has to write to raise this message */
+        Status = HalGetMessageRoutingInfo(Entry->Vector,
+                                          Entry->TargetProcessorSet,
+                                          &Entry->MessageAddress,
+                                          &Entry->MessageData);
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("No routing for message %lu (vector 0x%lx): 0x%lx\n", i, Entry->Vector, Status);
+            goto Cleanup;
+        }
+
+        /* The HAL targets each message at a single processor */
+        for (Processor = 0; Processor < KeNumberProcessors; Processor++)
+        {
+            if (Entry->TargetProcessorSet & ((KAFFINITY)1 << Processor))
+                break;
+        }
+
+        if (Processor == KeNumberProcessors)
+        {
+            Status = STATUS_INVALID_PARAMETER;
+            goto Cleanup;
+        }
+
+        Messages[i].MessageServiceRoutine = MessageBased->MessageServiceRoutine;
+        Messages[i].ServiceContext = MessageBased->ServiceContext;
+        Messages[i].MessageId = i;
+        KeInitializeSpinLock(&Messages[i].SpinLock);
+
+        /* Without a caller lock, each message only synchronizes with itself */
+        KeInitializeInterrupt(&Messages[i].Interrupt,
+                              IopMessageInterruptServiceRoutine,
+                              &Messages[i],
+                              MessageBased->SpinLock ? MessageBased->SpinLock : &Messages[i].SpinLock,
+                              Entry->Vector,
+                              Entry->Irql,
+                              MessageBased->SpinLock ? max(MessageBased->SynchronizeIrql, UnifiedIrql) : Entry->Irql,
+                              Latched,
+                              FALSE,
+                              Processor,
+                              MessageBased->FloatingSave);
+
+        if (!KeConnectInterrupt(&Messages[i].Interrupt))
+        {
+            DPRINT1("Failed to connect message %lu (vector 0x%lx)\n", i, Entry->Vector);
+            Status = STATUS_INVALID_PARAMETER;
+            goto Cleanup;
+        }
+
+        Entry->InterruptObject = &Messages[i].Interrupt;
+    }
+
+    *MessageBased->ConnectionContext.InterruptMessageTable = MessageTable;
+    return STATUS_SUCCESS;
+
+Cleanup:
+    IopDisconnectInterruptExMessageBased(MessageTable);
+    return Status;
+}
+#else
+static
+NTSTATUS
+IopConnectInterruptExMessageBased(
+    _Inout_ PIO_CONNECT_INTERRUPT_PARAMETERS Parameters)
+{
+    PAGED_CODE();
+
+    /* Message descriptors need NTDDI_VISTA, so no device has been given any */
+    return IopConnectInterruptExFallBack(Parameters);
+}
+#endif
+
 NTSTATUS
 NTAPI
 IoConnectInterruptEx(
@@ -208,14 +486,18 @@ IoConnectInterruptEx(
             //TODO: We don't do anything for the group type
             return IopConnectInterruptExFullySpecific(Parameters);
         case CONNECT_MESSAGE_BASED:
-            DPRINT1("FIXME: Message based interrupts are UNIMPLEMENTED\n");
-            break;
+            return IopConnectInterruptExMessageBased(Parameters);
         case CONNECT_LINE_BASED:
-            DPRINT1("FIXME: Line based interrupts are UNIMPLEMENTED\n");
-            break;
+            return IopConnectInterruptExLineBased(Parameters->LineBased.PhysicalDeviceObject,
+                                                  Parameters->LineBased.InterruptObject,
+                                                  Parameters->LineBased.ServiceRoutine,
+                                                  Parameters->LineBased.ServiceContext,
+                                                  Parameters->LineBased.SpinLock,
+                                                  Parameters->LineBased.SynchronizeIrql,
+                                                  Parameters->LineBased.FloatingSave);
     }
 
-    return STATUS_SUCCESS;
+    return STATUS_INVALID_PARAMETER;
 }
 
 VOID
@@ -225,8 +507,12 @@ IoDisconnectInterruptEx(
 {
     PAGED_CODE();
 
-    //FIXME: This eventually will need to handle more cases
-    if (Parameters->ConnectionContext.InterruptObject)
+    if (!Parameters->ConnectionContext.Generic)
+        return;
+
+    if (Parameters->Version == CONNECT_MESSAGE_BASED)
+        IopDisconnectInterruptExMessageBased(Parameters->ConnectionContext.InterruptMessageTable);
+    else
         IoDisconnectInterrupt(Parameters->ConnectionContext.InterruptObject);
 }
 
@@ -1718,6 +1718,9 @@ IopSendRemoveDevice(IN PDEVICE_OBJECT DeviceObject)
     /* Drivers should never fail a IRP_MN_REMOVE_DEVICE request */
     PiIrpSendRemoveCheckVpb(DeviceObject, IRP_MN_REMOVE_DEVICE);
 
+    /* The device is gone, so are its message interrupts */
+    IopReleaseMessageInterrupts(DeviceNode);
+
     /* Start of HACK: update resources stored in registry, so IopDetectResourceConflict works */
     if (DeviceNode->ResourceList)
     {
@@ -2423,6 +2426,8 @@ PiDevNodeStateMachine(
                 if (NT_SUCCESS(status))
                 {
                     PiIrpStopDevice(currentNode);
+                    /* Resources are assigned again on restart */
+                    IopReleaseMessageInterrupts(currentNode);
                     PiSetDevNodeState(currentNode, DeviceNodeStopped);
                 }
                 else
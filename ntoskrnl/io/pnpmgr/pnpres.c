@@ -183,17 +183,64 @@ IopFindDmaResource(
     return FALSE;
 }
 
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+static
+NTSTATUS
+IopGetMessageTranslator(
+    OUT PTRANSLATOR_INTERFACE Translator)
+{
+    ULONG BridgeBusNumber;
+
+    /* Only a HAL that can hand out message vectors provides a PCI translator */
+    if (!HalGetInterruptTranslator)
+        return STATUS_NOT_SUPPORTED;
+
+    return HalGetInterruptTranslator(Internal,
+                                     0,
+                                     PCIBus,
+                                     sizeof(TRANSLATOR_INTERFACE),
+                                     HAL_IRQ_TRANSLATOR_VERSION,
+                                     Translator,
+                                     &BridgeBusNumber);
+}
+#endif
+
 static
 BOOLEAN
 IopFindInterruptResource(
     IN PIO_RESOURCE_DESCRIPTOR IoDesc,
     OUT PCM_PARTIAL_RESOURCE_DESCRIPTOR CmDesc)
 {
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+    TRANSLATOR_INTERFACE Translator;
+#endif
     ULONG Vector;
 
     ASSERT(IoDesc->Type == CmDesc->Type);
     ASSERT(IoDesc->Type == CmResourceTypeInterrupt);
 
+    if (IoDesc->Flags & CM_RESOURCE_INTERRUPT_MESSAGE)
+    {
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+        /* The vector of a message is assigned by the HAL on translation */
+        if (!NT_SUCCESS(IopGetMessageTranslator(&Translator)))
+        {
+            DPRINT1("Message signaled interrupts are not supported by the HAL\n");
+            return FALSE;
+        }
+        Translator.InterfaceDereference(Translator.Context);
+
+        CmDesc->u.MessageInterrupt.Raw.Reserved = 0;
+        CmDesc->u.MessageInterrupt.Raw.MessageCount = 1;
+        CmDesc->u.MessageInterrupt.Raw.Vector = CM_RESOURCE_INTERRUPT_MESSAGE_TOKEN;
+        CmDesc->u.MessageInterrupt.Raw.Affinity = (KAFFINITY)-1;
+        return TRUE;
+#else
+        DPRINT1("Message signaled interrupts need NTDDI_VISTA\n");
+        return FALSE;
+#endif
+    }
+
     for (Vector = IoDesc->u.Interrupt.MinimumVector;
          Vector <= IoDesc->u.Interrupt.MaximumVector;
          Vector++)
@@ -235,6 +282,8 @@ IopFixupResourceListWithRequirements(
     {
         ULONG ii;
 
+        AlternateRequired = FALSE;
+
         /* We need to get back to where we were before processing the last alternative list */
         if (OldCount == 0 && *ResourceList != NULL)
         {
@@ -300,6 +349,13 @@ IopFixupResourceListWithRequirements(
                 switch (IoDesc->Type)
                 {
                     case CmResourceTypeInterrupt:
+                        /* Every message needs its own descriptor */
+                        if ((IoDesc->Flags & CM_RESOURCE_INTERRUPT_MESSAGE) ||
+                            (CmDesc->Flags & CM_RESOURCE_INTERRUPT_MESSAGE))
+                        {
+                            break;
+                        }
+
                         /* Make sure it satisfies our vector range */
                         if (CmDesc->u.Interrupt.Vector >= IoDesc->u.Interrupt.MinimumVector &&
                             CmDesc->u.Interrupt.Vector <= IoDesc->u.Interrupt.MaximumVector)
@@ -466,6 +522,7 @@ IopFixupResourceListWithRequirements(
                 {
                     /* Break out of this loop and try the next list */
                     DPRINT1("Unable to satisfy required resource in list %lu\n", i);
+                    AlternateRequired = TRUE;
                     break;
                 }
                 else if (!FoundResource)
@@ -639,6 +696,13 @@ IopCheckResourceDescriptor(
                 }
                 case CmResourceTypeInterrupt:
                 {
+                    /* Message vectors are handed out by the HAL, they can't conflict */
+                    if ((ResDesc->Flags & CM_RESOURCE_INTERRUPT_MESSAGE) ||
+                        (ResDesc2->Flags & CM_RESOURCE_INTERRUPT_MESSAGE))
+                    {
+                        break;
+                    }
+
                     if (ResDesc->u.Interrupt.Vector == ResDesc2->u.Interrupt.Vector)
                     {
                         if (!Silent)
@@ -964,6 +1028,61 @@ IopUpdateResourceMapForPnPDevice(
     return IopUpdateResourceMap(DeviceNode, L"PnP Manager", L"PnpManager");
 }
 
+VOID
+NTAPI
+IopReleaseMessageInterrupts(
+   IN PDEVICE_NODE DeviceNode)
+{
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+   PCM_PARTIAL_RESOURCE_LIST pPartialResourceList;
+   PCM_PARTIAL_RESOURCE_DESCRIPTOR Descriptor;
+   CM_PARTIAL_RESOURCE_DESCRIPTOR RawDescriptor;
+   PCM_FULL_RESOURCE_DESCRIPTOR FullDescriptor;
+   TRANSLATOR_INTERFACE Translator;
+   ULONG i, j;
+
+   if (!DeviceNode->ResourceListTranslated)
+      return;
+
+   FullDescriptor = &DeviceNode->ResourceListTranslated->List[0];
+   for (i = 0; i < DeviceNode->ResourceListTranslated->Count; i++)
+   {
+      pPartialResourceList = &FullDescriptor->PartialResourceList;
+      FullDescriptor = CmiGetNextResourceDescriptor(FullDescriptor);
+
+      for (j = 0; j < pPartialResourceList->Count; j++)
+      {
+         Descriptor = &pPartialResourceList->PartialDescriptors[j];
+
+         /* Messages that never got a vector, or were already released, still hold the token */
+         if (Descriptor->Type != CmResourceTypeInterrupt ||
+             !(Descriptor->Flags & CM_RESOURCE_INTERRUPT_MESSAGE) ||
+             Descriptor->u.MessageInterrupt.Translated.Vector == CM_RESOURCE_INTERRUPT_MESSAGE_TOKEN)
+         {
+            continue;
+         }
+
+         /* Translating the message back hands its vector to the HAL again */
+         if (NT_SUCCESS(IopGetMessageTranslator(&Translator)))
+         {
+            Translator.TranslateResources(Translator.Context,
+                                          Descriptor,
+                                          TranslateParentToChild,
+                                          0,
+                                          NULL,
+                                          DeviceNode->PhysicalDeviceObject,
+                                          &RawDescriptor);
+            Translator.InterfaceDereference(Translator.Context);
+         }
+
+         Descriptor->u.MessageInterrupt.Translated.Vector = CM_RESOURCE_INTERRUPT_MESSAGE_TOKEN;
+      }
+   }
+#else
+   UNREFERENCED_PARAMETER(DeviceNode);
+#endif
+}
+
 static
 NTSTATUS
 IopTranslateDeviceResources(
@@ -1042,6 +1161,37 @@ IopTranslateDeviceResources(
             case CmResourceTypeInterrupt:
             {
                KIRQL Irql;
+
+               if (DescriptorRaw->Flags & CM_RESOURCE_INTERRUPT_MESSAGE)
+               {
+#if (NTDDI_VERSION >= NTDDI_VISTA)
+                  TRANSLATOR_INTERFACE Translator;
+
+                  /* Let the HAL pick a vector and a target processor for the message */
+                  Status = IopGetMessageTranslator(&Translator);
+                  if (NT_SUCCESS(Status))
+                  {
+                     Status = Translator.TranslateResources(Translator.Context,
+                                                            DescriptorRaw,
+                                                            TranslateChildToParent,
+                                                            0,
+                                                            NULL,
+                                                            DeviceNode->PhysicalDeviceObject,
+                                                            DescriptorTranslated);
+                     Translator.InterfaceDereference(Translator.Context);
+                  }
+
+#else
+                  Status = STATUS_NOT_SUPPORTED;
+#endif
+                  if (!NT_SUCCESS(Status))
+                  {
+                     DPRINT1("Failed to translate message interrupt resource (Status: 0x%lx)\n", Status);
+                     goto cleanup;
+                  }
+                  break;
+               }
+
                DescriptorTranslated->u.Interrupt.Vector = HalGetInterruptVector(
                   DeviceNode->ResourceList->List[i].InterfaceType,
                   DeviceNode->ResourceList->List[i].BusNumber,
@@ -1105,6 +1255,8 @@ cleanup:
    DeviceNode->ResourceList = NULL;
    if (DeviceNode->ResourceListTranslated)
    {
+      /* Give back the messages translated before the failure */
+      IopReleaseMessageInterrupts(DeviceNode);
       ExFreePool(DeviceNode->ResourceListTranslated);
       DeviceNode->ResourceList = NULL;
    }
@@ -283,6 +283,16 @@ KiIdleLoop(VOID)
             KiRetireDpcList(Prcb);
         }
 
+#ifdef CONFIG_SMP
+        /* Check if we should look for ready threads on other processors */
+        if (Prcb->IdleSchedule)
+        {
+            _enable();
+            KiIdleSchedule(Prcb);
+            _disable();
+        }
+#endif
+
         /* Check if a new thread is scheduled for execution */
         if (Prcb->NextThread)
         {
@@ -317,6 +327,11 @@ KiIdleLoop(VOID)
         {
             /* Continue staying idle. Note the HAL returns with interrupts on */
             Prcb->PowerState.IdleFunction(&Prcb->PowerState);
+
+#ifdef CONFIG_SMP
+            /* We got woken up, check again for work queued on busy processors */
+            Prcb->IdleSchedule = TRUE;
+#endif
         }
     }
 }
@@ -233,14 +233,19 @@ KeReadStateQueue(IN PKQUEUE Queue)
 /*
  * @implemented
  */
-PLIST_ENTRY
+ULONG
 NTAPI
-KeRemoveQueue(IN PKQUEUE Queue,
-              IN KPROCESSOR_MODE WaitMode,
-              IN PLARGE_INTEGER Timeout OPTIONAL)
+KeRemoveQueueEx(IN PKQUEUE Queue,
+                IN KPROCESSOR_MODE WaitMode,
+                IN BOOLEAN Alertable,
+                IN PLARGE_INTEGER Timeout OPTIONAL,
+                OUT PLIST_ENTRY *EntryArray,
+                IN ULONG Count)
 {
     PLIST_ENTRY QueueEntry;
     LONG_PTR Status;
+    NTSTATUS WaitStatus;
+    ULONG Removed = 0;
     PKTHREAD Thread = KeGetCurrentThread();
     PKQUEUE PreviousQueue;
     PKWAIT_BLOCK WaitBlock = &Thread->WaitBlock[0];
@@ -252,6 +257,7 @@ KeRemoveQueue(IN PKQUEUE Queue,
     ULONG Hand = 0;
     ASSERT_QUEUE(Queue);
     ASSERT_IRQL_LESS_OR_EQUAL(DISPATCH_LEVEL);
+    ASSERT(Count != 0);
 
     /* Check if the Lock is already held */
     if (Thread->WaitNext)
@@ -327,6 +333,20 @@ KeRemoveQueue(IN PKQUEUE Queue,
             /* Remove the Entry */
             RemoveEntryList(QueueEntry);
             QueueEntry->Flink = NULL;
+            EntryArray[Removed++] = QueueEntry;
+
+            /*
+             * Take whatever else is queued while we hold the lock. This is
+             * still one thread, so it only counts once against the maximum.
+             */
+            while ((Removed < Count) &&
+                   !IsListEmpty(&Queue->EntryListHead))
+            {
+                QueueEntry = RemoveHeadList(&Queue->EntryListHead);
+                QueueEntry->Flink = NULL;
+                Queue->Header.SignalState--;
+                EntryArray[Removed++] = QueueEntry;
+            }
 
             /* Nothing to wait on */
             break;
@@ -344,12 +364,12 @@ KeRemoveQueue(IN PKQUEUE Queue,
             }
             else
             {
-                /* Fail if there's a User APC Pending */
-                if ((WaitMode != KernelMode) &&
-                    (Thread->ApcState.UserApcPending))
+                /* Fail if we were alerted or there's a User APC Pending */
+                WaitStatus = KiCheckAlertability(Thread, Alertable, WaitMode);
+                if (WaitStatus != STATUS_WAIT_0)
                 {
                     /* Return the status and increase the pending threads */
-                    QueueEntry = (PLIST_ENTRY)STATUS_USER_APC;
+                    EntryArray[0] = (PLIST_ENTRY)(ULONG_PTR)WaitStatus;
                     Queue->CurrentCount++;
                     break;
                 }
@@ -362,7 +382,7 @@ KeRemoveQueue(IN PKQUEUE Queue,
                     if ((ULONG64)InterruptTime.QuadPart >= Timer->DueTime.QuadPart)
                     {
                         /* It did, so we don't need to wait */
-                        QueueEntry = (PLIST_ENTRY)STATUS_TIMEOUT;
+                        EntryArray[0] = (PLIST_ENTRY)STATUS_TIMEOUT;
                         Queue->CurrentCount++;
                         break;
                     }
@@ -404,7 +424,14 @@ KeRemoveQueue(IN PKQUEUE Queue,
                 Thread->WaitReason = 0;
 
                 /* Check if we were executing an APC */
-                if (Status != STATUS_KERNEL_APC) return (PLIST_ENTRY)Status;
+                if (Status != STATUS_KERNEL_APC)
+                {
+                    /* We were either given an entry directly, or failed */
+                    EntryArray[0] = (PLIST_ENTRY)Status;
+                    return ((Status == STATUS_TIMEOUT) ||
+                            (Status == STATUS_USER_APC) ||
+                            (Status == STATUS_ALERTED)) ? 0 : 1;
+                }
 
                 /* Check if we had a timeout */
                 if (Timeout)
@@ -427,6 +454,22 @@ KeRemoveQueue(IN PKQUEUE Queue,
     /* Unlock Database and return */
     KiReleaseDispatcherLockFromSynchLevel();
     KiExitDispatcher(Thread->WaitIrql);
+    return Removed;
+}
+
+/*
+ * @implemented
+ */
+PLIST_ENTRY
+NTAPI
+KeRemoveQueue(IN PKQUEUE Queue,
+              IN KPROCESSOR_MODE WaitMode,
+              IN PLARGE_INTEGER Timeout OPTIONAL)
+{
+    PLIST_ENTRY QueueEntry;
+
+    /* If nothing was removed, this gets the wait status instead */
+    KeRemoveQueueEx(Queue, WaitMode, FALSE, Timeout, &QueueEntry, 1);
     return QueueEntry;
 }
 
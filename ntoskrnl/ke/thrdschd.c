@@ -15,9 +15,13 @@
 #ifdef _WIN64
 # define InterlockedOrSetMember(Destination, SetMember) \
     InterlockedOr64((PLONG64)Destination, SetMember);
+# define InterlockedAndSetMember(Destination, SetMember) \
+    InterlockedAnd64((PLONG64)Destination, SetMember);
 #else
 # define InterlockedOrSetMember(Destination, SetMember) \
     InterlockedOr((PLONG)Destination, SetMember);
+# define InterlockedAndSetMember(Destination, SetMember) \
+    InterlockedAnd((PLONG)Destination, SetMember);
 #endif
 
 /* GLOBALS *******************************************************************/
@@ -27,13 +31,129 @@ KAFFINITY KiIdleSMTSummary;
 
 /* FUNCTIONS *****************************************************************/
 
+#ifdef CONFIG_SMP
+//
+// Acquires the PRCB locks of two processors, always in the same order so that
+// two processors stealing from each other cannot deadlock.
+//
+static
+VOID
+KiAcquireTwoPrcbLocks(IN PKPRCB FirstPrcb,
+                      IN PKPRCB SecondPrcb)
+{
+    if (FirstPrcb->Number < SecondPrcb->Number)
+    {
+        KiAcquirePrcbLock(FirstPrcb);
+        KiAcquirePrcbLock(SecondPrcb);
+    }
+    else
+    {
+        KiAcquirePrcbLock(SecondPrcb);
+        KiAcquirePrcbLock(FirstPrcb);
+    }
+}
+
+//
+// Finds and removes the highest priority ready thread of another processor
+// which is allowed to run on the given processor. Both PRCB locks must be held.
+//
+static
+PKTHREAD
+KiStealReadyThread(IN PKPRCB SourcePrcb,
+                   IN PKPRCB Prcb)
+{
+    ULONG PrioritySet;
+    LONG Priority;
+    PLIST_ENTRY ListHead, ListEntry;
+    PKTHREAD Thread;
+
+    /* Walk the ready lists, starting at the highest priority */
+    PrioritySet = SourcePrcb->ReadySummary;
+    while (PrioritySet)
+    {
+        BitScanReverse((PULONG)&Priority, PrioritySet);
+        PrioritySet ^= PRIORITY_MASK(Priority);
+
+        ListHead = &SourcePrcb->DispatcherReadyListHead[Priority];
+        for (ListEntry = ListHead->Flink;
+             ListEntry != ListHead;
+             ListEntry = ListEntry->Flink)
+        {
+            Thread = CONTAINING_RECORD(ListEntry, KTHREAD, WaitListEntry);
+            ASSERT(Thread->State == Ready);
+
+            /* Skip threads that can't run here */
+            if (!(Thread->Affinity & Prcb->SetMember)) continue;
+
+            /* Remove it from the list */
+            if (RemoveEntryList(&Thread->WaitListEntry))
+            {
+                /* The list is empty now, reset the ready summary */
+                SourcePrcb->ReadySummary ^= PRIORITY_MASK(Priority);
+            }
+
+            /* It will now run on this processor */
+            Thread->NextProcessor = Prcb->Number;
+            return Thread;
+        }
+    }
+
+    /* Nothing runnable here */
+    return NULL;
+}
+#endif
+
 PKTHREAD
 FASTCALL
 KiIdleSchedule(IN PKPRCB Prcb)
 {
-    /* FIXME: TODO */
-    ASSERTMSG("SMP: Not yet implemented\n", FALSE);
-    return NULL;
+    PKTHREAD Thread = NULL;
+#ifdef CONFIG_SMP
+    ULONG i, Number;
+    PKPRCB SourcePrcb;
+
+    /* This is called from the idle loop */
+    ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
+    ASSERT(Prcb == KeGetCurrentPrcb());
+
+    /* Clear the request */
+    Prcb->IdleSchedule = FALSE;
+
+    /* Start with our neighbour, so that idle processors don't all hit CPU 0 */
+    for (i = 1; i < (ULONG)KeNumberProcessors; i++)
+    {
+        Number = (Prcb->Number + i) % KeNumberProcessors;
+        SourcePrcb = KiProcessorBlock[Number];
+
+        /* Do a lockless check first, to avoid bouncing locks around for nothing */
+        if (!(SourcePrcb) || !(SourcePrcb->ReadySummary)) continue;
+
+        KiAcquireTwoPrcbLocks(Prcb, SourcePrcb);
+
+        /* Someone might have given us a thread in the meantime */
+        if (Prcb->NextThread)
+        {
+            KiReleasePrcbLock(SourcePrcb);
+            KiReleasePrcbLock(Prcb);
+            break;
+        }
+
+        Thread = KiStealReadyThread(SourcePrcb, Prcb);
+        if (Thread)
+        {
+            /* We're not idle anymore, set it up as our next thread */
+            InterlockedAndSetMember(&KiIdleSummary, ~Prcb->SetMember);
+            Thread->State = Standby;
+            Prcb->NextThread = Thread;
+        }
+
+        KiReleasePrcbLock(SourcePrcb);
+        KiReleasePrcbLock(Prcb);
+        if (Thread) break;
+    }
+#endif
+
+    return Thread;
 }
 
 VOID
@@ -83,6 +203,9 @@ KiDeferredReadyThread(IN PKTHREAD Thread)
     ULONG Processor = 0;
     KPRIORITY OldPriority;
     PKTHREAD NextThread;
+#ifdef CONFIG_SMP
+    KAFFINITY IdleSet;
+#endif
 
     /* Sanity checks */
     ASSERT(Thread->State == DeferredReady);
@@ -228,6 +351,72 @@ KiDeferredReadyThread(IN PKTHREAD Thread)
     OldPriority = Thread->Priority;
     Thread->Preempted = FALSE;
 
+#ifdef CONFIG_SMP
+    /* Check if there is an idle processor this thread can run on */
+    IdleSet = KiIdleSummary & Thread->Affinity;
+    while (IdleSet)
+    {
+        /* Prefer the ideal processor, then the last one, for cache locality */
+        if (IdleSet & AFFINITY_MASK(Thread->IdealProcessor))
+        {
+            Processor = Thread->IdealProcessor;
+        }
+        else if (IdleSet & AFFINITY_MASK(Thread->NextProcessor))
+        {
+            Processor = Thread->NextProcessor;
+        }
+        else
+        {
+            Processor = KeFindNextRightSetAffinity(KeGetCurrentPrcb()->Number,
+                                                   IdleSet);
+        }
+
+        /* Lock it and make sure it's still idle */
+        Prcb = KiProcessorBlock[Processor];
+        KiAcquirePrcbLock(Prcb);
+        if ((KiIdleSummary & Prcb->SetMember) &&
+            !(Prcb->NextThread) &&
+            (Prcb->CurrentThread == Prcb->IdleThread))
+        {
+            /* Clear its idle bit and set this thread as the next one */
+            InterlockedAndSetMember(&KiIdleSummary, ~Prcb->SetMember);
+            Thread->NextProcessor = (UCHAR)Processor;
+            Thread->State = Standby;
+            Prcb->NextThread = Thread;
+
+            /* Unlock the PRCB and wake it up if it's not us */
+            KiReleasePrcbLock(Prcb);
+            if (KeGetCurrentProcessorNumber() != Processor)
+            {
+                KiIpiSend(AFFINITY_MASK(Processor), IPI_DPC);
+            }
+            return;
+        }
+
+        /* It got busy, try another one */
+        KiReleasePrcbLock(Prcb);
+        IdleSet &= ~AFFINITY_MASK(Processor);
+    }
+
+    /* No idle processor, queue it on the ideal processor, or the last one */
+    if (Thread->Affinity & AFFINITY_MASK(Thread->IdealProcessor))
+    {
+        Processor = Thread->IdealProcessor;
+    }
+    else if (Thread->Affinity & AFFINITY_MASK(Thread->NextProcessor))
+    {
+        Processor = Thread->NextProcessor;
+    }
+    else
+    {
+        Processor = KeFindNextRightSetAffinity(Thread->NextProcessor,
+                                               Thread->Affinity & KeActiveProcessors);
+    }
+
+    /* Get the PRCB and lock it */
+    Prcb = KiProcessorBlock[Processor];
+    KiAcquirePrcbLock(Prcb);
+#else
     /* Queue the thread on CPU 0 and get the PRCB and lock it */
     Thread->NextProcessor = 0;
     Prcb = KiProcessorBlock[0];
@@ -245,6 +434,7 @@ KiDeferredReadyThread(IN PKTHREAD Thread)
         KiReleasePrcbLock(Prcb);
         return;
     }
+#endif
 
     /* Set the CPU number */
     Thread->NextProcessor = (UCHAR)Processor;
@@ -336,12 +526,9 @@ KiSelectNextThread(IN PKPRCB Prcb)
         /* Didn't find any, get the current idle thread */
         Thread = Prcb->IdleThread;
 
-        /* Enable idle scheduling */
+        /* Enable idle scheduling, the idle loop will look for work elsewhere */
         InterlockedOrSetMember(&KiIdleSummary, Prcb->SetMember);
         Prcb->IdleSchedule = TRUE;
-
-        /* FIXME: SMT support */
-        ASSERTMSG("SMP: Not yet implemented\n", FALSE);
     }
 
     /* Sanity checks and return the thread */
@@ -387,6 +574,10 @@ KiSwapThread(IN PKTHREAD CurrentThread,
         {
             /* Set the idle summary */
             InterlockedOrSetMember(&KiIdleSummary, Prcb->SetMember);
+#ifdef CONFIG_SMP
+            /* Let the idle loop look for work on other processors */
+            Prcb->IdleSchedule = TRUE;
+#endif
 
             /* Schedule the idle thread */
             NextThread = Prcb->IdleThread;
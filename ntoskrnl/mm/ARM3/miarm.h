@@ -616,6 +616,7 @@ extern ULONG MmMaximumNonPagedPoolPercent;
 extern ULONG MmLargeStackSize;
 extern PMMCOLOR_TABLES MmFreePagesByColor[FreePageList + 1];
 extern MMPFNLIST MmStandbyPageListByPriority[8];
+extern MMPFNLIST MmModifiedPageListByColor[1];
 extern ULONG MmProductType;
 extern MM_SYSTEMSIZE MmSystemSize;
 extern PKEVENT MiLowMemoryEvent;
@@ -646,6 +647,8 @@ extern PFN_NUMBER MmSystemPageDirectory[PPE_PER_PAGE];
 extern PMMPTE MmSharedUserDataPte;
 extern LIST_ENTRY MmProcessList;
 extern KEVENT MmZeroingPageEvent;
+extern KEVENT MmModifiedPageWriterEvent;
+extern PFN_NUMBER MmModifiedPageMaximum;
 extern ULONG MmSystemPageColor;
 extern ULONG MmProcessColorSeed;
 extern PMMWSL MmWorkingSetList;
@@ -1590,6 +1593,28 @@ MI_PFN_ELEMENT(IN PFN_NUMBER Pfn)
     return &MmPfnDatabase[Pfn];
 };
 
+//
+// Gives back the page file copy of a private page, once it is stale or deleted
+//
+FORCEINLINE
+VOID
+MiReleasePfnPageFileSpace(IN PMMPFN Pfn1)
+{
+    /* PFN lock must be held */
+    MI_ASSERT_PFN_LOCK_HELD();
+
+    /* Only private pages are written to the page file */
+    if ((Pfn1->u3.e1.PrototypePte == 0) &&
+        (Pfn1->OriginalPte.u.Soft.Prototype == 0) &&
+        (Pfn1->OriginalPte.u.Soft.Transition == 0) &&
+        (Pfn1->OriginalPte.u.Soft.PageFileHigh != 0))
+    {
+        MiReleasePageFileSpace(Pfn1->OriginalPte);
+        Pfn1->OriginalPte.u.Soft.PageFileLow = 0;
+        Pfn1->OriginalPte.u.Soft.PageFileHigh = 0;
+    }
+}
+
 //
 // Drops a locked page without dereferencing it
 //
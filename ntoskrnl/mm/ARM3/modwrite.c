@@ -0,0 +1,215 @@
+/*
+ * PROJECT:     ReactOS Kernel
+ * LICENSE:     BSD-3-Clause (https://spdx.org/licenses/BSD-3-Clause)
+ * PURPOSE:     Modified page writer
+ */
+
+/* INCLUDES *******************************************************************/
+
+#include <ntoskrnl.h>
+#define NDEBUG
+#include <debug.h>
+
+#define MODULE_INVOLVED_IN_ARM3
+#include <mm/ARM3/miarm.h>
+
+/* GLOBALS ********************************************************************/
+
+KEVENT MmModifiedPageWriterEvent;
+
+/* Number of modified pages that wakes up the writer, 0 until it runs */
+PFN_NUMBER MmModifiedPageMaximum;
+
+/* PRIVATE FUNCTIONS **********************************************************/
+
+static
+ULONG
+MiWriteModifiedPageCluster(VOID)
+{
+    PFN_NUMBER Pages[MM_PAGEFILE_CLUSTER_SIZE];
+    SWAPENTRY Entries[MM_PAGEFILE_CLUSTER_SIZE];
+    PFN_NUMBER PageFrameIndex, NextPage;
+    SWAPENTRY SwapEntry;
+    ULONG Count, Written, i;
+    NTSTATUS Status;
+    PMMPFN Pfn1;
+    KIRQL OldIrql;
+
+    /* Pull a cluster of private pages off the modified list */
+    Count = 0;
+    OldIrql = MiAcquirePfnLock();
+    PageFrameIndex = MmModifiedPageListByColor[0].Flink;
+    while ((PageFrameIndex != LIST_HEAD) && (Count < MM_PAGEFILE_CLUSTER_SIZE))
+    {
+        Pfn1 = MI_PFN_ELEMENT(PageFrameIndex);
+        NextPage = Pfn1->u1.Flink;
+
+        /* Shared pages are not written out yet */
+        if (Pfn1->u3.e1.PrototypePte == 0)
+        {
+            ASSERT(Pfn1->u3.e1.Modified == 1);
+            ASSERT(Pfn1->OriginalPte.u.Soft.PageFileHigh == 0);
+            MiUnlinkPageFromList(Pfn1);
+
+            /* Hold it during the write. Faults on it will wait for us */
+            Pfn1->u3.e2.ReferenceCount++;
+            Pfn1->u3.e1.WriteInProgress = 1;
+            Pfn1->u3.e1.Modified = 0;
+
+            Pages[Count++] = PageFrameIndex;
+        }
+
+        PageFrameIndex = NextPage;
+    }
+    MiReleasePfnLock(OldIrql);
+
+    if (Count == 0) return 0;
+
+    /* Adjacent page file slots let the whole cluster go out in one write */
+    SwapEntry = MmAllocSwapPages(Count);
+    if (SwapEntry != 0)
+    {
+        Status = MmWriteToSwapPages(SwapEntry, Pages, Count);
+        for (i = 0; i < Count; i++)
+        {
+            Entries[i] = SwapEntry;
+            if (!NT_SUCCESS(Status))
+            {
+                MmFreeSwapPage(SwapEntry);
+                Entries[i] = 0;
+            }
+            SwapEntry = MmNextSwapEntry(SwapEntry);
+        }
+    }
+    else
+    {
+        /* No such run in the page file, write the pages one by one */
+        for (i = 0; i < Count; i++)
+        {
+            Entries[i] = MmAllocSwapPages(1);
+            if (Entries[i] == 0)
+            {
+                MmShowOutOfSpaceMessagePagingFile();
+                continue;
+            }
+
+            Status = MmWriteToSwapPage(Entries[i], Pages[i]);
+            if (!NT_SUCCESS(Status))
+            {
+                MmFreeSwapPage(Entries[i]);
+                Entries[i] = 0;
+            }
+        }
+    }
+
+    /* Now put the pages back where they belong */
+    Written = 0;
+    OldIrql = MiAcquirePfnLock();
+    for (i = 0; i < Count; i++)
+    {
+        Pfn1 = MI_PFN_ELEMENT(Pages[i]);
+        ASSERT(Pfn1->u3.e1.WriteInProgress == 1);
+        Pfn1->u3.e1.WriteInProgress = 0;
+
+        if (Entries[i] == 0)
+        {
+            /* It didn't make it to the disk, keep it on the modified list */
+            DPRINT1("Failed to write out page 0x%lx\n", Pages[i]);
+            Pfn1->u3.e1.Modified = 1;
+        }
+        else if (MI_IS_PFN_DELETED(Pfn1))
+        {
+            /* It was freed while we were writing it */
+            MmFreeSwapPage(Entries[i]);
+        }
+        else
+        {
+            /* From now on the page can be read back from the page file */
+            MiMakePageFilePte(&Pfn1->OriginalPte, Entries[i]);
+            Written++;
+        }
+
+        /* Wake up whoever faulted on it in the meantime */
+        if (Pfn1->u1.Event)
+        {
+            KeSetEvent(Pfn1->u1.Event, IO_NO_INCREMENT, FALSE);
+            Pfn1->u1.Event = NULL;
+        }
+
+        /* Drop our reference. Clean pages go to the standby list */
+        MiDecrementReferenceCount(Pfn1, Pages[i]);
+    }
+    MiReleasePfnLock(OldIrql);
+
+    return Written;
+}
+
+static
+VOID
+NTAPI
+MiModifiedPageWriter(
+    _In_ PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    /* Same priority as the balancer, freeing memory shouldn't wait */
+    KeSetPriorityThread(KeGetCurrentThread(), LOW_REALTIME_PRIORITY + 1);
+
+    for (;;)
+    {
+        KeWaitForSingleObject(&MmModifiedPageWriterEvent,
+                              WrFreePage,
+                              KernelMode,
+                              FALSE,
+                              NULL);
+
+        /* There is nowhere to write to yet */
+        if (MmNumberOfPagingFiles == 0) continue;
+
+        /* Write down to half the threshold, or as much as we can if memory is low */
+        while (MmModifiedPageListHead.Total != 0)
+        {
+            if ((MmAvailablePages >= MmMinimumFreePages) &&
+                (MmModifiedPageListHead.Total < (MmModifiedPageMaximum / 2)))
+            {
+                break;
+            }
+
+            /* Stop if nothing could be written out */
+            if (MiWriteModifiedPageCluster() == 0) break;
+        }
+    }
+}
+
+/* PUBLIC FUNCTIONS ***********************************************************/
+
+CODE_SEG("INIT")
+VOID
+NTAPI
+MiInitModifiedPageWriter(VOID)
+{
+    HANDLE ThreadHandle;
+    NTSTATUS Status;
+
+    KeInitializeEvent(&MmModifiedPageWriterEvent, SynchronizationEvent, FALSE);
+
+    Status = PsCreateSystemThread(&ThreadHandle,
+                                  THREAD_ALL_ACCESS,
+                                  NULL,
+                                  NULL,
+                                  NULL,
+                                  MiModifiedPageWriter,
+                                  NULL);
+    if (!NT_SUCCESS(Status))
+    {
+        KeBugCheck(MEMORY_MANAGEMENT);
+    }
+    ZwClose(ThreadHandle);
+
+    /* Start writing once 1/64th of the memory is waiting on the modified list */
+    MmModifiedPageMaximum = MmNumberOfPhysicalPages / 64;
+    MmModifiedPageMaximum = max(MmModifiedPageMaximum, 64);
+    MmModifiedPageMaximum = min(MmModifiedPageMaximum, 1024);
+}
+
+/* EOF */
@@ -1009,8 +1009,20 @@ MiResolveTransitionFault(IN BOOLEAN StoreInstruction,
     /* ARM3 doesn't support this path */
     ASSERT(OldIrql != MM_NOIRQL);
 
-    /* Capture the PTE and make sure it's in transition format */
+    /* Capture the PTE */
     TempPte = *PointerPte;
+
+    /* The page could have been repurposed before we got the PFN lock */
+    if ((TempPte.u.Soft.Valid == 0) &&
+        (TempPte.u.Soft.Prototype == 0) &&
+        (TempPte.u.Soft.Transition == 0))
+    {
+        /* Let the faulting instruction run again, it will take a hard fault */
+        DPRINT("Transition PTE 0x%p was repurposed\n", PointerPte);
+        return STATUS_SUCCESS;
+    }
+
+    /* Make sure it's in transition format */
     ASSERT((TempPte.u.Soft.Valid == 0) &&
            (TempPte.u.Soft.Prototype == 0) &&
            (TempPte.u.Soft.Transition == 1));
@@ -1026,15 +1038,17 @@ MiResolveTransitionFault(IN BOOLEAN StoreInstruction,
     /* This is from ARM3 -- Windows normally handles this here */
     ASSERT(Pfn1->u4.InPageError == 0);
 
-    /* See if we should wait before terminating the fault */
-    if ((Pfn1->u3.e1.ReadInProgress == 1)
-            || ((Pfn1->u3.e1.WriteInProgress == 1) && StoreInstruction))
+    /*
+     * See if we should wait before terminating the fault. Pages being written
+     * out by the modified page writer are off any list, so wait for it too.
+     */
+    if ((Pfn1->u3.e1.ReadInProgress == 1) || (Pfn1->u3.e1.WriteInProgress == 1))
     {
-        DPRINT1("The page is currently in a page transition !\n");
+        DPRINT("The page is currently in a page transition !\n");
         *InPageBlock = &Pfn1->u1.Event;
         if (PointerPte == Pfn1->PteAddress)
         {
-            DPRINT1("And this if for this particular PTE.\n");
+            DPRINT("And this if for this particular PTE.\n");
             /* The PTE will be made valid by the thread serving the fault */
             return STATUS_SUCCESS; // FIXME: Maybe something more descriptive
         }
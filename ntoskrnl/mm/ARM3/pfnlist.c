@@ -108,7 +108,11 @@ MiDecrementAvailablePages(
     MmAvailablePages--;
     if (MmAvailablePages < MmMinimumFreePages)
     {
-        /* FIXME: Should wake up the MPW and working set manager, if we had one */
+        /* Dirty pages can only be reused once they have been written out */
+        if (MmModifiedPageMaximum && MmModifiedPageListHead.Total)
+        {
+            KeSetEvent(&MmModifiedPageWriterEvent, IO_NO_INCREMENT, FALSE);
+        }
 
         DPRINT1("Running low on pages: %lu remaining\n", MmAvailablePages);
 
@@ -286,12 +290,17 @@ MiUnlinkPageFromList(IN PMMPFN Pfn)
         /* Get the exact list */
         ListHead = &MmStandbyPageListByPriority[Pfn->u4.Priority];
 
-        /* Decrement number of available pages */
-        MiDecrementAvailablePages();
-
-        /* Decrease transition page counter */
-        ASSERT(Pfn->u3.e1.PrototypePte == 1); /* Only supported ARM3 case */
-        MmTransitionSharedPages--;
+        /* Shared pages were not counted as available, they can't be repurposed */
+        if (Pfn->u3.e1.PrototypePte)
+        {
+            /* Decrease transition page counter */
+            MmTransitionSharedPages--;
+        }
+        else
+        {
+            /* Decrement number of available pages */
+            MiDecrementAvailablePages();
+        }
     }
     else if (ListHead == &MmModifiedPageListHead)
     {
@@ -347,8 +356,10 @@ MiUnlinkPageFromList(IN PMMPFN Pfn)
         ListHead->Flink = OldFlink;
     }
 
-    /* ReactOS Hack */
-    Pfn->OriginalPte.u.Long = 0;
+    /*
+     * Keep the original PTE: a soft fault makes the page active again and it
+     * still describes where the page lives when it gets trimmed next time.
+     */
 
     /* We are not on a list anymore */
     Pfn->u1.Flink = Pfn->u2.Blink = 0;
@@ -472,6 +483,109 @@ MiRemovePageByColor(IN PFN_NUMBER PageIndex,
     return PageIndex;
 }
 
+static
+VOID
+MiRestoreTransitionPte(IN PMMPFN Pfn1)
+{
+    PMMPTE PointerPte;
+    MMPTE TempPte;
+    PVOID PageTable;
+    PFN_NUMBER PteFrame;
+    KIRQL OldIrql;
+    PEPROCESS Process = PsGetCurrentProcess();
+
+    /* Make sure the PFN lock is held */
+    MI_ASSERT_PFN_LOCK_HELD();
+
+    /* The PTE may belong to any process, so go through its page table page */
+    PteFrame = Pfn1->u4.PteFrame;
+    PageTable = MiMapPageInHyperSpace(Process, PteFrame, &OldIrql);
+    PointerPte = (PMMPTE)((ULONG_PTR)PageTable + BYTE_OFFSET(Pfn1->PteAddress));
+
+    /* It must still be in transition, and pointing to us */
+    ASSERT(PointerPte->u.Hard.Valid == 0);
+    ASSERT(PointerPte->u.Soft.Prototype == 0);
+    ASSERT(PointerPte->u.Soft.Transition == 1);
+    ASSERT(PFN_FROM_PTE(PointerPte) == MiGetPfnEntryIndex(Pfn1));
+
+    /*
+     * Clean pages can always be found again where the original PTE tells, but
+     * NtProtectVirtualMemory only changed the protection of the transition PTE.
+     */
+    ASSERT(Pfn1->u3.e1.Modified == 0);
+    TempPte = Pfn1->OriginalPte;
+    TempPte.u.Soft.Protection = PointerPte->u.Trans.Protection;
+    MI_WRITE_INVALID_PTE(PointerPte, TempPte);
+
+    MiUnmapPageInHyperSpace(Process, PageTable, OldIrql);
+
+    /* The page table doesn't reference this page anymore */
+    MiDecrementShareCount(MI_PFN_ELEMENT(PteFrame), PteFrame);
+}
+
+static
+PFN_NUMBER
+MiRemoveStandbyPage(VOID)
+{
+    ULONG Priority;
+    PFN_NUMBER PageIndex;
+    USHORT OldColor, OldCache;
+    PMMPFN Pfn1;
+
+    /* Make sure the PFN lock is held */
+    MI_ASSERT_PFN_LOCK_HELD();
+
+    /* Take the oldest page of the lowest priority first */
+    for (Priority = 0; Priority < RTL_NUMBER_OF(MmStandbyPageListByPriority); Priority++)
+    {
+        ASSERT_LIST_INVARIANT(&MmStandbyPageListByPriority[Priority]);
+        for (PageIndex = MmStandbyPageListByPriority[Priority].Flink;
+             PageIndex != LIST_HEAD;
+             PageIndex = Pfn1->u1.Flink)
+        {
+            Pfn1 = MI_PFN_ELEMENT(PageIndex);
+
+            /* Shared pages are not repurposed yet */
+            if (Pfn1->u3.e1.PrototypePte) continue;
+
+            /* Nobody is using it, remove it from the list */
+            ASSERT(Pfn1->u3.e2.ReferenceCount == 0);
+            ASSERT(Pfn1->u2.ShareCount == 0);
+            MiUnlinkPageFromList(Pfn1);
+
+            /* Whoever owned it will have to fault it back in */
+            MiRestoreTransitionPte(Pfn1);
+
+            /* Zero flags but restore color and cache */
+            OldColor = Pfn1->u3.e1.PageColor;
+            OldCache = Pfn1->u3.e1.CacheAttribute;
+            Pfn1->u3.e2.ShortFlags = 0;
+            Pfn1->u3.e1.PageColor = OldColor;
+            Pfn1->u3.e1.CacheAttribute = OldCache;
+            Pfn1->OriginalPte.u.Long = 0;
+
+#if MI_TRACE_PFNS
+            Pfn1->PfnUsage = MI_PFN_CURRENT_USAGE;
+            memcpy(Pfn1->ProcessName, MI_PFN_CURRENT_PROCESS_NAME, 16);
+            Pfn1->CallSite = _ReturnAddress();
+            MI_PFN_CURRENT_USAGE = MI_USAGE_NOT_SET;
+            MI_SET_PROCESS2("Not Set");
+#endif
+            return PageIndex;
+        }
+    }
+
+    /*
+     * Shared standby pages are not counted in MmAvailablePages, so the callers
+     * checked that a private one is left. Handing out PFN 0 would be worse.
+     */
+    KeBugCheckEx(PFN_LIST_CORRUPT,
+                 0x8D,
+                 MmAvailablePages,
+                 MmTransitionSharedPages,
+                 0);
+}
+
 PFN_NUMBER
 NTAPI
 MiRemoveAnyPage(IN ULONG Color)
@@ -505,11 +619,11 @@ MiRemoveAnyPage(IN ULONG Color)
                 ASSERT_LIST_INVARIANT(&MmZeroedPageListHead);
                 PageIndex = MmZeroedPageListHead.Flink;
                 Color = PageIndex & MmSecondaryColorMask;
-                ASSERT(PageIndex != LIST_HEAD);
                 if (PageIndex == LIST_HEAD)
                 {
-                    /* FIXME: Should check the standby list */
+                    /* Repurpose a page from the standby list */
                     ASSERT(MmZeroedPageListHead.Total == 0);
+                    return MiRemoveStandbyPage();
                 }
             }
         }
@@ -569,11 +683,13 @@ MiRemoveZeroPage(IN ULONG Color)
                 ASSERT_LIST_INVARIANT(&MmFreePageListHead);
                 PageIndex = MmFreePageListHead.Flink;
                 Color = PageIndex & MmSecondaryColorMask;
-                ASSERT(PageIndex != LIST_HEAD);
                 if (PageIndex == LIST_HEAD)
                 {
-                    /* FIXME: Should check the standby list */
-                    ASSERT(MmZeroedPageListHead.Total == 0);
+                    /* Repurpose a page from the standby list, and zero it */
+                    ASSERT(MmFreePageListHead.Total == 0);
+                    PageIndex = MiRemoveStandbyPage();
+                    MiZeroPhysicalPage(PageIndex);
+                    return PageIndex;
                 }
             }
         }
@@ -735,12 +851,8 @@ MiInsertStandbyListAtFront(IN PFN_NUMBER PageFrameIndex)
     Pfn1 = MI_PFN_ELEMENT(PageFrameIndex);
     ASSERT(Pfn1->u4.MustBeCached == 0);
     ASSERT(Pfn1->u3.e2.ReferenceCount == 0);
-    ASSERT(Pfn1->u3.e1.PrototypePte == 1);
     ASSERT(Pfn1->u3.e1.Rom != 1);
 
-    /* One more transition page on a list */
-    MmTransitionSharedPages++;
-
     /* Get the standby page list and increment its count */
     ListHead = &MmStandbyPageListByPriority [Pfn1->u4.Priority];
     ASSERT_LIST_INVARIANT(ListHead);
@@ -770,8 +882,16 @@ MiInsertStandbyListAtFront(IN PFN_NUMBER PageFrameIndex)
     /* Move the page onto its new location */
     Pfn1->u3.e1.PageLocation = StandbyPageList;
 
-    /* Increment number of available pages */
-    MiIncrementAvailablePages();
+    if (Pfn1->u3.e1.PrototypePte)
+    {
+        /* One more transition page on a list */
+        MmTransitionSharedPages++;
+    }
+    else
+    {
+        /* Private standby pages can be repurposed, so they are available */
+        MiIncrementAvailablePages();
+    }
 }
 
 VOID
@@ -895,9 +1015,22 @@ MiInsertPageInList(IN PMMPFNLIST ListHead,
     /* Move the page onto its new location */
     Pfn1->u3.e1.PageLocation = ListName;
 
-    /* For zero/free pages, we also have to handle the colored lists */
-    if (ListName <= StandbyPageList)
+    if (ListName == StandbyPageList)
+    {
+        if (Pfn1->u3.e1.PrototypePte)
+        {
+            /* One more transition page on a list */
+            MmTransitionSharedPages++;
+        }
+        else
+        {
+            /* Private standby pages can be repurposed at any time, so they are available */
+            MiIncrementAvailablePages();
+        }
+    }
+    else if (ListName <= FreePageList)
     {
+        /* For zero/free pages, we also have to handle the colored lists */
         /* Increment number of available pages */
         MiIncrementAvailablePages();
 
@@ -946,9 +1079,11 @@ MiInsertPageInList(IN PMMPFNLIST ListHead,
     }
     else if (ListName == ModifiedPageList)
     {
-        /* In ARM3, page must be destined for page file, and not yet written out */
+        /* In ARM3, page must be destined for page file */
         ASSERT(Pfn1->OriginalPte.u.Soft.Prototype == 0);
-        ASSERT(Pfn1->OriginalPte.u.Soft.PageFileHigh == 0);
+
+        /* If it was written out before, that copy is stale now */
+        MiReleasePfnPageFileSpace(Pfn1);
 
         /* One more transition page */
         MmTransitionSharedPages++;
@@ -956,7 +1091,12 @@ MiInsertPageInList(IN PMMPFNLIST ListHead,
         /* Increment the number of per-process modified pages */
         PsGetCurrentProcess()->ModifiedPageCount++;
 
-        /* FIXME: Wake up modified page writer if there are not enough free pages */
+        /* Wake up the modified page writer if enough pages piled up */
+        if (MmModifiedPageMaximum &&
+            (MmModifiedPageListHead.Total >= MmModifiedPageMaximum))
+        {
+            KeSetEvent(&MmModifiedPageWriterEvent, IO_NO_INCREMENT, FALSE);
+        }
     }
     else if (ListName == ModifiedNoWritePageList)
     {
@@ -1290,9 +1430,9 @@ MiDecrementReferenceCount(IN PMMPFN Pfn1,
     }
     else
     {
-        /* Otherwise, insert this page into the standby list */
+        /* Otherwise, insert this page at the end of the standby list */
         ASSERT(Pfn1->u3.e1.RemovalRequested == 0);
-        MiInsertStandbyListAtFront(PageFrameIndex);
+        MiInsertPageInList(&MmStandbyPageListHead, PageFrameIndex);
     }
 }
 
@@ -391,9 +391,16 @@ MiDeletePte(IN PMMPTE PointerPte,
     /* See if the PTE is valid */
     if (TempPte.u.Hard.Valid == 0)
     {
-        /* Prototype and paged out PTEs not supported yet */
+        /* Prototype PTEs not supported yet */
         ASSERT(TempPte.u.Soft.Prototype == 0);
-        ASSERT((TempPte.u.Soft.PageFileHigh == 0) || (TempPte.u.Soft.Transition == 1));
+
+        if ((TempPte.u.Soft.Transition == 0) && (TempPte.u.Soft.PageFileHigh != 0))
+        {
+            /* The page was written out and repurposed, give back its page file slot */
+            MiReleasePageFileSpace(TempPte);
+            MI_ERASE_PTE(PointerPte);
+            return;
+        }
 
         if (TempPte.u.Soft.Transition)
         {
@@ -415,6 +422,9 @@ MiDeletePte(IN PMMPTE PointerPte,
             /* In case of shared page, the prototype PTE must be in transition, not the process one */
             ASSERT(Pfn1->u3.e1.PrototypePte == 0);
 
+            /* Its page file copy isn't needed anymore */
+            MiReleasePfnPageFileSpace(Pfn1);
+
             /* Delete the PFN */
             MI_SET_PFN_DELETED(Pfn1);
 
@@ -513,6 +523,9 @@ MiDeletePte(IN PMMPTE PointerPte,
         /* Drop the reference on the page table. */
         MiDecrementShareCount(MiGetPfnEntry(Pfn1->u4.PteFrame), Pfn1->u4.PteFrame);
 
+        /* Its page file copy isn't needed anymore */
+        MiReleasePfnPageFileSpace(Pfn1);
+
         /* Mark the PFN for deletion and dereference what should be the last ref */
         MI_SET_PFN_DELETED(Pfn1);
         MiDecrementShareCount(Pfn1, PageFrameIndex);
@@ -2211,6 +2224,7 @@ MiProtectVirtualMemory(IN PEPROCESS Process,
     PMMPFN Pfn1;
     ULONG ProtectionMask, OldProtect;
     BOOLEAN Committed;
+    KIRQL OldIrql;
     NTSTATUS Status = STATUS_SUCCESS;
     PETHREAD Thread = PsGetCurrentThread();
     TABLE_SEARCH_RESULT Result;
@@ -2411,7 +2425,7 @@ MiProtectVirtualMemory(IN PEPROCESS Process,
                 if ((NewAccessProtection & PAGE_NOACCESS) ||
                     (NewAccessProtection & PAGE_GUARD))
                 {
-                    KIRQL OldIrql = MiAcquirePfnLock();
+                    OldIrql = MiAcquirePfnLock();
 
                     /* Mark the PTE as transition and change its protection */
                     PteContents.u.Hard.Valid = 0;
@@ -2445,12 +2459,17 @@ MiProtectVirtualMemory(IN PEPROCESS Process,
             {
                 /* We don't support these cases yet */
                 ASSERT(PteContents.u.Soft.Prototype == 0);
-                //ASSERT(PteContents.u.Soft.Transition == 0);
 
-                /* The PTE is already demand-zero, just update the protection mask */
+                /* Transition PTEs can be repurposed under the PFN lock, don't race with it */
+                OldIrql = MiAcquirePfnLock();
+                PteContents = *PointerPte;
+
+                /* The PTE is demand-zero, paged out or in transition, just update the protection mask */
                 PteContents.u.Soft.Protection = ProtectionMask;
                 MI_WRITE_INVALID_PTE(PointerPte, PteContents);
                 ASSERT(PointerPte->u.Long != 0);
+
+                MiReleasePfnLock(OldIrql);
             }
 
             /* Move to the next PTE */
@@ -2605,6 +2624,7 @@ MiProcessValidPteList(IN PMMPTE *ValidPteList,
         // itself
         //
         MiDecrementShareCount(Pfn2, Pfn1->u4.PteFrame);
+        MiReleasePfnPageFileSpace(Pfn1);
         MI_SET_PFN_DELETED(Pfn1);
         MiDecrementShareCount(Pfn1, PageFrameIndex);
 
@@ -2635,6 +2655,7 @@ MiDecommitPages(IN PVOID StartingAddress,
     PMMPTE ValidPteList[256];
     ULONG PteCount = 0;
     PMMPFN Pfn1;
+    KIRQL OldIrql;
     MMPTE PteContents;
     PETHREAD CurrentThread = PsGetCurrentThread();
 
@@ -2726,16 +2747,29 @@ MiDecommitPages(IN PVOID StartingAddress,
                 else
                 {
                     //
-                    // We do not support any of these other scenarios at the moment
+                    // We do not support prototype PTEs at the moment
                     //
                     ASSERT(PteContents.u.Soft.Prototype == 0);
-                    ASSERT(PteContents.u.Soft.Transition == 0);
-                    ASSERT(PteContents.u.Soft.PageFileHigh == 0);
 
                     //
-                    // So the only other possibility is that it is still a demand
-                    // zero PTE, in which case we undo the accounting we did
-                    // earlier and simply make the page decommitted.
+                    // The page may have been trimmed, and even written out to
+                    // the page file. Let the PFN code give all of that back.
+                    //
+                    if ((PteContents.u.Soft.Transition == 1) ||
+                        (PteContents.u.Soft.PageFileHigh != 0))
+                    {
+                        OldIrql = MiAcquirePfnLock();
+                        MiDeletePte(PointerPte,
+                                    MiPteToAddress(PointerPte),
+                                    Process,
+                                    NULL);
+                        MiReleasePfnLock(OldIrql);
+                    }
+
+                    //
+                    // Otherwise it is still a demand zero PTE, in which case we
+                    // undo the accounting we did earlier and simply make the
+                    // page decommitted.
                     //
                     //Process->NumberOfPrivatePages++;
                     MI_WRITE_INVALID_PTE(PointerPte, MmDecommittedPte);
@@ -5135,7 +5169,6 @@ NtAllocateVirtualMemory(IN HANDLE ProcessHandle,
             if (PointerPte->u.Soft.Valid == 0)
             {
                 ASSERT(PointerPte->u.Soft.Prototype == 0);
-                ASSERT((PointerPte->u.Soft.PageFileHigh == 0) || (PointerPte->u.Soft.Transition == 1));
             }
 
             //
@@ -281,6 +281,9 @@ MmInitSystem(IN ULONG Phase,
      */
     MiInitBalancerThread();
 
+    /* Start writing dirty pages out to the page file */
+    MiInitModifiedPageWriter();
+
     /* Initialize the balance set manager */
     MmInitBsmThread();
 
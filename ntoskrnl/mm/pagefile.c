@@ -59,6 +59,9 @@ PMMPAGING_FILE MmPagingFile[MAX_PAGING_FILES];
 /* Lock for examining the list of paging files */
 KGUARDED_MUTEX MmPageFileCreationLock;
 
+/* Lock for the slot bitmaps, so that slots can be released at DISPATCH_LEVEL */
+static KSPIN_LOCK MiPageFileSlotLock;
+
 /* Number of paging files */
 ULONG MmNumberOfPagingFiles;
 
@@ -142,9 +145,27 @@ MmShowOutOfSpaceMessagePagingFile(VOID)
     }
 }
 
+SWAPENTRY
+NTAPI
+MmNextSwapEntry(SWAPENTRY SwapEntry)
+{
+    /* The swap entry of the page file slot right after this one */
+    return ENTRY_FROM_FILE_OFFSET(FILE_FROM_ENTRY(SwapEntry), OFFSET_FROM_ENTRY(SwapEntry) + 1);
+}
+
 NTSTATUS
 NTAPI
 MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
+{
+    return MmWriteToSwapPages(SwapEntry, &Page, 1);
+}
+
+NTSTATUS
+NTAPI
+MmWriteToSwapPages(
+    _In_ SWAPENTRY SwapEntry,
+    _In_reads_(PageCount) PPFN_NUMBER Pages,
+    _In_ ULONG PageCount)
 {
     ULONG i;
     ULONG_PTR offset;
@@ -152,10 +173,10 @@ MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
     IO_STATUS_BLOCK Iosb;
     NTSTATUS Status;
     KEVENT Event;
-    UCHAR MdlBase[sizeof(MDL) + sizeof(PFN_NUMBER)];
+    UCHAR MdlBase[sizeof(MDL) + MM_PAGEFILE_CLUSTER_SIZE * sizeof(PFN_NUMBER)];
     PMDL Mdl = (PMDL)MdlBase;
 
-    DPRINT("MmWriteToSwapPage\n");
+    DPRINT("MmWriteToSwapPages(%lu)\n", PageCount);
 
     if (SwapEntry == 0)
     {
@@ -163,6 +184,8 @@ MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
         return(STATUS_UNSUCCESSFUL);
     }
 
+    ASSERT((PageCount > 0) && (PageCount <= MM_PAGEFILE_CLUSTER_SIZE));
+
     i = FILE_FROM_ENTRY(SwapEntry);
     offset = OFFSET_FROM_ENTRY(SwapEntry) - 1;
 
@@ -173,8 +196,9 @@ MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
         KeBugCheck(MEMORY_MANAGEMENT);
     }
 
-    MmInitializeMdl(Mdl, NULL, PAGE_SIZE);
-    MmBuildMdlFromPages(Mdl, &Page);
+    /* The whole run goes to the disk in a single paging IRP */
+    MmInitializeMdl(Mdl, NULL, PageCount << PAGE_SHIFT);
+    MmBuildMdlFromPages(Mdl, Pages);
     Mdl->MdlFlags |= MDL_PAGES_LOCKED;
 
     file_offset.QuadPart = offset * PAGE_SIZE;
@@ -206,22 +230,48 @@ MmReadFromSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
     return MiReadPageFile(Page, FILE_FROM_ENTRY(SwapEntry), OFFSET_FROM_ENTRY(SwapEntry));
 }
 
+NTSTATUS
+NTAPI
+MmReadFromSwapPages(
+    _In_ SWAPENTRY SwapEntry,
+    _In_reads_(PageCount) PPFN_NUMBER Pages,
+    _In_ ULONG PageCount)
+{
+    return MiReadPageFileCluster(Pages,
+                                 PageCount,
+                                 FILE_FROM_ENTRY(SwapEntry),
+                                 OFFSET_FROM_ENTRY(SwapEntry));
+}
+
 NTSTATUS
 NTAPI
 MiReadPageFile(
     _In_ PFN_NUMBER Page,
     _In_ ULONG PageFileIndex,
     _In_ ULONG_PTR PageFileOffset)
+{
+    return MiReadPageFileCluster(&Page, 1, PageFileIndex, PageFileOffset);
+}
+
+NTSTATUS
+NTAPI
+MiReadPageFileCluster(
+    _In_reads_(PageCount) PPFN_NUMBER Pages,
+    _In_ ULONG PageCount,
+    _In_ ULONG PageFileIndex,
+    _In_ ULONG_PTR PageFileOffset)
 {
     LARGE_INTEGER file_offset;
     IO_STATUS_BLOCK Iosb;
     NTSTATUS Status;
     KEVENT Event;
-    UCHAR MdlBase[sizeof(MDL) + sizeof(PFN_NUMBER)];
+    UCHAR MdlBase[sizeof(MDL) + MM_PAGEFILE_CLUSTER_SIZE * sizeof(PFN_NUMBER)];
     PMDL Mdl = (PMDL)MdlBase;
     PMMPAGING_FILE PagingFile;
 
-    DPRINT("MiReadSwapFile\n");
+    DPRINT("MiReadPageFileCluster(%lu)\n", PageCount);
+
+    ASSERT((PageCount > 0) && (PageCount <= MM_PAGEFILE_CLUSTER_SIZE));
 
     if (PageFileOffset == 0)
     {
@@ -242,8 +292,8 @@ MiReadPageFile(
         KeBugCheck(MEMORY_MANAGEMENT);
     }
 
-    MmInitializeMdl(Mdl, NULL, PAGE_SIZE);
-    MmBuildMdlFromPages(Mdl, &Page);
+    MmInitializeMdl(Mdl, NULL, PageCount << PAGE_SHIFT);
+    MmBuildMdlFromPages(Mdl, Pages);
     Mdl->MdlFlags |= MDL_PAGES_LOCKED | MDL_IO_PAGE_READ;
 
     file_offset.QuadPart = PageFileOffset * PAGE_SIZE;
@@ -274,6 +324,7 @@ MmInitPagingFile(VOID)
     ULONG i;
 
     KeInitializeGuardedMutex(&MmPageFileCreationLock);
+    KeInitializeSpinLock(&MiPageFileSlotLock);
 
     MiFreeSwapPages = 0;
     MiUsedSwapPages = 0;
@@ -293,11 +344,12 @@ MmFreeSwapPage(SWAPENTRY Entry)
     ULONG i;
     ULONG_PTR off;
     PMMPAGING_FILE PagingFile;
+    KIRQL OldIrql;
 
     i = FILE_FROM_ENTRY(Entry);
     off = OFFSET_FROM_ENTRY(Entry) - 1;
 
-    KeAcquireGuardedMutex(&MmPageFileCreationLock);
+    KeAcquireSpinLock(&MiPageFileSlotLock, &OldIrql);
 
     PagingFile = MmPagingFile[i];
     if (PagingFile == NULL)
@@ -305,7 +357,7 @@ MmFreeSwapPage(SWAPENTRY Entry)
         KeBugCheck(MEMORY_MANAGEMENT);
     }
 
-    RtlClearBit(PagingFile->Bitmap, off >> 5);
+    RtlClearBit(PagingFile->Bitmap, (ULONG)off);
 
     PagingFile->FreeSpace++;
     PagingFile->CurrentUsage--;
@@ -314,50 +366,108 @@ MmFreeSwapPage(SWAPENTRY Entry)
     MiUsedSwapPages--;
     UpdateTotalCommittedPages(-1);
 
-    KeReleaseGuardedMutex(&MmPageFileCreationLock);
+    KeReleaseSpinLock(&MiPageFileSlotLock, OldIrql);
+}
+
+VOID
+NTAPI
+MiReleasePageFileSpace(
+    _In_ MMPTE PteContents)
+{
+    /* ARM3 page file PTEs hold the same file/offset pair as swap entries */
+    ASSERT(PteContents.u.Soft.Valid == 0);
+    ASSERT(PteContents.u.Soft.Prototype == 0);
+    ASSERT(PteContents.u.Soft.Transition == 0);
+    ASSERT(PteContents.u.Soft.PageFileHigh != 0);
+
+    MmFreeSwapPage(ENTRY_FROM_FILE_OFFSET(PteContents.u.Soft.PageFileLow,
+                                          PteContents.u.Soft.PageFileHigh));
+}
+
+VOID
+NTAPI
+MiMakePageFilePte(
+    _Inout_ PMMPTE NewPte,
+    _In_ SWAPENTRY SwapEntry)
+{
+    /* Keep the protection, point the PTE to the page file slot */
+    NewPte->u.Soft.Valid = 0;
+    NewPte->u.Soft.Prototype = 0;
+    NewPte->u.Soft.Transition = 0;
+    NewPte->u.Soft.PageFileLow = FILE_FROM_ENTRY(SwapEntry);
+    NewPte->u.Soft.PageFileHigh = OFFSET_FROM_ENTRY(SwapEntry);
 }
 
 SWAPENTRY
 NTAPI
 MmAllocSwapPage(VOID)
+{
+    return MmAllocSwapPages(1);
+}
+
+SWAPENTRY
+NTAPI
+MmAllocSwapPages(ULONG PageCount)
+/*
+ * FUNCTION: Allocates a run of PageCount contiguous page file slots.
+ * RETURNS: The swap entry of the first slot, the following ones are obtained
+ *          with MmNextSwapEntry. 0 if there is no such run.
+ */
 {
     ULONG i;
     ULONG off;
     SWAPENTRY entry;
+    PMMPAGING_FILE PagingFile;
+    KIRQL OldIrql;
 
-    KeAcquireGuardedMutex(&MmPageFileCreationLock);
+    ASSERT((PageCount > 0) && (PageCount <= MM_PAGEFILE_CLUSTER_SIZE));
+
+    KeAcquireSpinLock(&MiPageFileSlotLock, &OldIrql);
 
-    if (MiFreeSwapPages == 0)
+    if (MiFreeSwapPages < PageCount)
     {
-        KeReleaseGuardedMutex(&MmPageFileCreationLock);
+        KeReleaseSpinLock(&MiPageFileSlotLock, OldIrql);
         return(0);
     }
 
     for (i = 0; i < MAX_PAGING_FILES; i++)
     {
-        if (MmPagingFile[i] != NULL &&
-                MmPagingFile[i]->FreeSpace >= 1)
+        PagingFile = MmPagingFile[i];
+        if (PagingFile != NULL &&
+                PagingFile->FreeSpace >= PageCount)
         {
-            off = RtlFindClearBitsAndSet(MmPagingFile[i]->Bitmap, 1, 0);
+            /* Start after the last allocation, so that consecutive page outs
+             * end up next to each other and can be read back in one go */
+            off = RtlFindClearBitsAndSet(PagingFile->Bitmap, PageCount, PagingFile->HintSetBit);
             if (off == 0xFFFFFFFF)
             {
-                KeBugCheck(MEMORY_MANAGEMENT);
-                KeReleaseGuardedMutex(&MmPageFileCreationLock);
-                return(STATUS_UNSUCCESSFUL);
+                /* Only a single page is guaranteed to be found */
+                if (PageCount == 1)
+                {
+                    KeBugCheck(MEMORY_MANAGEMENT);
+                }
+                continue;
             }
-            MiUsedSwapPages++;
-            MiFreeSwapPages--;
-            UpdateTotalCommittedPages(1);
+            PagingFile->HintSetBit = off + PageCount;
+            PagingFile->FreeSpace -= PageCount;
+            PagingFile->CurrentUsage += PageCount;
 
-            KeReleaseGuardedMutex(&MmPageFileCreationLock);
+            MiUsedSwapPages += PageCount;
+            MiFreeSwapPages -= PageCount;
+            UpdateTotalCommittedPages(PageCount);
+
+            KeReleaseSpinLock(&MiPageFileSlotLock, OldIrql);
 
             entry = ENTRY_FROM_FILE_OFFSET(i, off + 1);
             return(entry);
         }
     }
 
-    KeReleaseGuardedMutex(&MmPageFileCreationLock);
-    KeBugCheck(MEMORY_MANAGEMENT);
+    KeReleaseSpinLock(&MiPageFileSlotLock, OldIrql);
+    if (PageCount == 1)
+    {
+        KeBugCheck(MEMORY_MANAGEMENT);
+    }
     return(0);
 }
 
@@ -385,6 +495,7 @@ NtCreatePagingFile(
     PACL Dacl;
     PWSTR Buffer;
     DEVICE_TYPE DeviceType;
+    KIRQL OldIrql;
 
     PAGED_CODE();
 
@@ -771,6 +882,7 @@ EarlyQuit:
      */
     PagingFile->FreeSpace = PagingFile->Size - 1;
     PagingFile->CurrentUsage = 0;
+    PagingFile->HintSetBit = 0;
     PagingFile->PageFileName = PageFileName;
     ASSERT(PagingFile->Size == PagingFile->FreeSpace + PagingFile->CurrentUsage + 1);
 
@@ -794,11 +906,13 @@ EarlyQuit:
 
     /* Insert the new paging file information into the list */
     KeAcquireGuardedMutex(&MmPageFileCreationLock);
+    KeAcquireSpinLock(&MiPageFileSlotLock, &OldIrql);
     /* Ensure the corresponding slot is empty yet */
     ASSERT(MmPagingFile[MmNumberOfPagingFiles] == NULL);
     MmPagingFile[MmNumberOfPagingFiles] = PagingFile;
     MmNumberOfPagingFiles++;
     MiFreeSwapPages = MiFreeSwapPages + PagingFile->FreeSpace;
+    KeReleaseSpinLock(&MiPageFileSlotLock, OldIrql);
     KeReleaseGuardedMutex(&MmPageFileCreationLock);
 
     MmSwapSpaceMessage = FALSE;
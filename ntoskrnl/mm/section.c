@@ -1549,6 +1549,7 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
     PMM_REGION Region;
     BOOLEAN HasSwapEntry;
     PVOID PAddress;
+    PVOID RegionBase;
     PEPROCESS Process = MmGetAddressSpaceOwner(AddressSpace);
     SWAPENTRY SwapEntry;
 
@@ -1584,7 +1585,7 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
     Segment = MemoryArea->SectionData.Segment;
     Region = MmFindRegion((PVOID)MA_GetStartingAddress(MemoryArea),
                           &MemoryArea->SectionData.RegionListHead,
-                          Address, NULL);
+                          Address, &RegionBase);
     ASSERT(Region != NULL);
 
     /* Check for a NOACCESS mapping */
@@ -1615,6 +1616,11 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
     if (HasSwapEntry)
     {
         SWAPENTRY DummyEntry;
+        SWAPENTRY NextEntry;
+        PFN_NUMBER Pages[MM_PAGEFILE_CLUSTER_SIZE];
+        ULONG PageCount, i;
+        ULONG_PTR ClusterEnd;
+        PVOID NextAddress;
 
         MmGetPageFileMapping(Process, Address, &SwapEntry);
         if (SwapEntry == MM_WAIT_ENTRY)
@@ -1647,43 +1653,90 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
         /* Tell everyone else we are serving the fault. */
         MmCreatePageFileMapping(Process, Address, MM_WAIT_ENTRY);
 
+        /*
+         * Pages swapped out one after the other usually sit next to each other
+         * in the page file. Bring in the following ones with the same read,
+         * as long as we don't have to wait for memory to do so.
+         */
+        Pages[0] = Page;
+        PageCount = 1;
+        if (Process)
+        {
+            ClusterEnd = min(MA_GetEndingAddress(MemoryArea),
+                             (ULONG_PTR)RegionBase + Region->Length);
+            NextEntry = SwapEntry;
+            while (PageCount < MM_PAGEFILE_CLUSTER_SIZE)
+            {
+                NextAddress = (PVOID)((ULONG_PTR)PAddress + PageCount * PAGE_SIZE);
+                if ((ULONG_PTR)NextAddress >= ClusterEnd ||
+                    !MmIsPageSwapEntry(Process, NextAddress))
+                {
+                    break;
+                }
+
+                NextEntry = MmNextSwapEntry(NextEntry);
+                MmGetPageFileMapping(Process, NextAddress, &DummyEntry);
+                if (DummyEntry != NextEntry)
+                {
+                    break;
+                }
+
+                if (!NT_SUCCESS(MmRequestPageMemoryConsumer(MC_USER, FALSE, &Pages[PageCount])))
+                {
+                    break;
+                }
+
+                MmDeletePageFileMapping(Process, NextAddress, &DummyEntry);
+                MmCreatePageFileMapping(Process, NextAddress, MM_WAIT_ENTRY);
+                PageCount++;
+            }
+        }
+
         MmUnlockAddressSpace(AddressSpace);
 
-        Status = MmReadFromSwapPage(SwapEntry, Page);
+        Status = MmReadFromSwapPages(SwapEntry, Pages, PageCount);
         if (!NT_SUCCESS(Status))
         {
-            DPRINT1("MmReadFromSwapPage failed, status = %x\n", Status);
+            DPRINT1("MmReadFromSwapPages failed, status = %x\n", Status);
             KeBugCheck(MEMORY_MANAGEMENT);
         }
 
         MmLockAddressSpace(AddressSpace);
-        MmDeletePageFileMapping(Process, PAddress, &DummyEntry);
-        ASSERT(DummyEntry == MM_WAIT_ENTRY);
 
-        Status = MmCreateVirtualMapping(Process,
-                                        PAddress,
-                                        Region->Protect,
-                                        Page);
-        if (!NT_SUCCESS(Status))
+        for (i = 0; i < PageCount; i++)
         {
-            DPRINT("MmCreateVirtualMapping failed, not out of memory\n");
-            KeBugCheck(MEMORY_MANAGEMENT);
-            return Status;
-        }
+            NextAddress = (PVOID)((ULONG_PTR)PAddress + i * PAGE_SIZE);
 
-        /*
-         * Store the swap entry for later use.
-         */
-        MmSetSavedSwapEntryPage(Page, SwapEntry);
+            MmDeletePageFileMapping(Process, NextAddress, &DummyEntry);
+            ASSERT(DummyEntry == MM_WAIT_ENTRY);
+
+            Status = MmCreateVirtualMapping(Process,
+                                            NextAddress,
+                                            Region->Protect,
+                                            Pages[i]);
+            if (!NT_SUCCESS(Status))
+            {
+                DPRINT("MmCreateVirtualMapping failed, not out of memory\n");
+                KeBugCheck(MEMORY_MANAGEMENT);
+                return Status;
+            }
+
+            /*
+             * Store the swap entry for later use.
+             */
+            MmSetSavedSwapEntryPage(Pages[i], SwapEntry);
+            SwapEntry = MmNextSwapEntry(SwapEntry);
+
+            /*
+             * Add the page to the process's working set
+             */
+            if (Process) MmInsertRmap(Pages[i], Process, NextAddress);
+        }
 
-        /*
-         * Add the page to the process's working set
-         */
-        if (Process) MmInsertRmap(Page, Process, Address);
         /*
          * Finish the operation
          */
-        DPRINT("Address 0x%p\n", Address);
+        DPRINT("Address 0x%p, %lu pages read\n", Address, PageCount);
         return STATUS_SUCCESS;
     }
 
@@ -170,6 +170,16 @@ HalEndSystemInterrupt(
 );
 #endif
 
+NTHALAPI
+NTSTATUS
+NTAPI
+HalGetMessageRoutingInfo(
+    _In_ ULONG Vector,
+    _In_ KAFFINITY Affinity,
+    _Out_ PPHYSICAL_ADDRESS MessageAddress,
+    _Out_ PULONG MessageData
+);
+
 #ifdef _ARM_ // FIXME: ndk/arm? armddk.h?
 ULONG
 HalGetInterruptSource(
@@ -19,6 +19,31 @@ InitializeCriticalSectionEx(
     _In_ DWORD dwSpinCount,
     _In_ DWORD Flags);
 
+#if (_WIN32_WINNT >= 0x0602)
+
+WINBASEAPI
+BOOL
+WINAPI
+WaitOnAddress(
+    _In_reads_bytes_(AddressSize) volatile VOID *Address,
+    _In_reads_bytes_(AddressSize) PVOID CompareAddress,
+    _In_ SIZE_T AddressSize,
+    _In_opt_ DWORD dwMilliseconds);
+
+WINBASEAPI
+VOID
+WINAPI
+WakeByAddressSingle(
+    _In_ PVOID Address);
+
+WINBASEAPI
+VOID
+WINAPI
+WakeByAddressAll(
+    _In_ PVOID Address);
+
+#endif /* _WIN32_WINNT >= 0x0602 */
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -137,6 +137,40 @@ typedef struct _AFD_DISCONNECT_INFO {
     LARGE_INTEGER			Timeout;
 } AFD_DISCONNECT_INFO, *PAFD_DISCONNECT_INFO;
 
+typedef struct _AFD_TRANSMIT_FILE_INFO {
+    LARGE_INTEGER			Offset;
+    ULONG				Length;
+    ULONG				SendSize;
+    HANDLE				FileHandle;
+    PVOID				Head;
+    ULONG				HeadLength;
+    PVOID				Tail;
+    ULONG				TailLength;
+    ULONG				Flags;
+    ULONG				AfdFlags;
+} AFD_TRANSMIT_FILE_INFO, *PAFD_TRANSMIT_FILE_INFO;
+
+/* Laid out like TRANSMIT_PACKETS_ELEMENT */
+typedef struct _AFD_TRANSMIT_ELEMENT {
+    ULONG				Flags;
+    ULONG				Length;
+    union {
+        struct {
+            LARGE_INTEGER		FileOffset;
+            HANDLE			FileHandle;
+        };
+        PVOID				Buffer;
+    };
+} AFD_TRANSMIT_ELEMENT, *PAFD_TRANSMIT_ELEMENT;
+
+typedef struct _AFD_TRANSMIT_PACKETS_INFO {
+    PAFD_TRANSMIT_ELEMENT		ElementArray;
+    ULONG				ElementCount;
+    ULONG				SendSize;
+    ULONG				Flags;
+    ULONG				AfdFlags;
+} AFD_TRANSMIT_PACKETS_INFO, *PAFD_TRANSMIT_PACKETS_INFO;
+
 typedef struct _AFD_VALIDATE_GROUP_DATA
 {
     LONG GroupId;
@@ -219,6 +253,18 @@ typedef struct _AFD_TDI_HANDLE_DATA
 #define AFD_OVERLAPPED			0x2L
 #define AFD_IMMEDIATE                   0x4L
 
+/* AFD Transmit Flags, the TF_ values of TransmitFile */
+#define AFD_TF_DISCONNECT		0x01L
+#define AFD_TF_REUSE_SOCKET		0x02L
+
+/* AFD Transmit Element Flags, the TP_ELEMENT_ values of TransmitPackets */
+#define AFD_TP_ELEMENT_MEMORY		0x01L
+#define AFD_TP_ELEMENT_FILE		0x02L
+#define AFD_TP_ELEMENT_EOP		0x04L
+
+/* Transmit offset meaning the current position of the file */
+#define AFD_TRANSMIT_CURRENT_OFFSET	(-1LL)
+
 /* IOCTL Generation */
 #define FSCTL_AFD_BASE                  FILE_DEVICE_NETWORK
 #define _AFD_CONTROL_CODE(Operation,Method) \
@@ -259,6 +305,8 @@ typedef struct _AFD_TDI_HANDLE_DATA
 #define AFD_EVENT_SELECT		33
 #define AFD_ENUM_NETWORK_EVENTS         34
 #define AFD_DEFER_ACCEPT		35
+#define AFD_TRANSMIT_FILE		36
+#define AFD_TRANSMIT_PACKETS		37
 #define AFD_GET_PENDING_CONNECT_DATA	41
 #define AFD_VALIDATE_GROUP		42
 
@@ -336,6 +384,10 @@ typedef struct _AFD_TDI_HANDLE_DATA
   _AFD_CONTROL_CODE(AFD_ENUM_NETWORK_EVENTS, METHOD_NEITHER)
 #define IOCTL_AFD_VALIDATE_GROUP \
   _AFD_CONTROL_CODE(AFD_VALIDATE_GROUP, METHOD_NEITHER)
+#define IOCTL_AFD_TRANSMIT_FILE \
+  _AFD_CONTROL_CODE(AFD_TRANSMIT_FILE, METHOD_NEITHER)
+#define IOCTL_AFD_TRANSMIT_PACKETS \
+  _AFD_CONTROL_CODE(AFD_TRANSMIT_PACKETS, METHOD_NEITHER)
 
 typedef struct _AFD_SOCKET_INFORMATION {
     BOOL CommandChannel;
@@ -439,6 +439,9 @@ CmpRepairParentKey(
         return ParentRepaired;
     }
 
+    /* The subkey list is about to change, drop its lookup index */
+    CmpInvalidateSubKeyIndex(Hive, KeyNode->SubKeyLists[Stable]);
+
     /* Obtain the index as well since we got the parent node */
     KeyIndex = (PCM_KEY_INDEX)HvGetCell(Hive, KeyNode->SubKeyLists[Stable]);
     if (!KeyIndex)
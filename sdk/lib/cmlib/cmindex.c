@@ -678,6 +678,541 @@ CmpFindSubKeyByHash(IN PHHIVE Hive,
     return HCELL_NIL;
 }
 
+/*
+ * Keys with many subkeys get an in-memory hash index of their subkey list,
+ * built on the first lookup and kept up to date as subkeys are added and
+ * removed. Each hive keeps a small direct-mapped cache of such indexes,
+ * keyed by the cell of the subkey list.
+ *
+ * Lookups in the kernel may run concurrently, but never concurrently with a
+ * change to the subkeys of the same key, since the key control block of the
+ * parent is locked by both. Whoever uses an index takes it out of its cache
+ * slot, leaving a busy marker behind, and puts it back once done; anyone
+ * hitting a busy slot simply falls back to the regular search. An index of
+ * another key found in a slot is always evicted, so a key changing while its
+ * index is held by someone else never gets a stale index back.
+ */
+#define CMP_SUBKEY_INDEX_CACHE_SIZE 64
+#define CMP_SUBKEY_INDEX_BUSY       ((PCM_SUBKEY_INDEX)1)
+
+typedef struct _CM_SUBKEY_INDEX_ENTRY
+{
+    HCELL_INDEX Cell;
+    ULONG HashKey;
+} CM_SUBKEY_INDEX_ENTRY, *PCM_SUBKEY_INDEX_ENTRY;
+
+typedef struct _CM_SUBKEY_INDEX
+{
+    HCELL_INDEX ListCell;
+    ULONG SubKeyCount;
+    ULONG TableMask;
+    CM_SUBKEY_INDEX_ENTRY Table[ANYSIZE_ARRAY];
+} CM_SUBKEY_INDEX, *PCM_SUBKEY_INDEX;
+
+typedef struct _CM_SUBKEY_INDEX_CACHE
+{
+    PCM_SUBKEY_INDEX Slots[CMP_SUBKEY_INDEX_CACHE_SIZE];
+} CM_SUBKEY_INDEX_CACHE, *PCM_SUBKEY_INDEX_CACHE;
+
+/* Keys with fewer subkeys than this are searched through their index directly */
+ULONG CmpSubKeyIndexThreshold = 128;
+
+static
+ULONG
+CmpSubKeyIndexSlot(IN HCELL_INDEX ListCell)
+{
+    /* Cells are 8-byte aligned, scramble the rest */
+    return ((ListCell >> 3) * 2654435761U) >> (32 - 6);
+}
+C_ASSERT(CMP_SUBKEY_INDEX_CACHE_SIZE == (1 << 6));
+
+static
+ULONG
+CmpSubKeyIndexTableSize(IN ULONG SubKeyCount)
+{
+    ULONG TableSize = 16;
+
+    /* Keep the table at most half full */
+    while (TableSize < SubKeyCount * 2) TableSize *= 2;
+    return TableSize;
+}
+
+static
+PCM_SUBKEY_INDEX
+CmpAllocateSubKeyIndex(IN PHHIVE Hive,
+                       IN HCELL_INDEX ListCell,
+                       IN ULONG SubKeyCount)
+{
+    PCM_SUBKEY_INDEX SubKeyIndex;
+    ULONG TableSize, i;
+
+    TableSize = CmpSubKeyIndexTableSize(SubKeyCount);
+    SubKeyIndex = Hive->Allocate(FIELD_OFFSET(CM_SUBKEY_INDEX, Table[TableSize]), TRUE, TAG_CM);
+    if (!SubKeyIndex) return NULL;
+
+    SubKeyIndex->ListCell = ListCell;
+    SubKeyIndex->SubKeyCount = SubKeyCount;
+    SubKeyIndex->TableMask = TableSize - 1;
+    for (i = 0; i < TableSize; i++)
+    {
+        SubKeyIndex->Table[i].Cell = HCELL_NIL;
+    }
+
+    return SubKeyIndex;
+}
+
+static
+VOID
+CmpInsertSubKeyIndexEntry(IN PCM_SUBKEY_INDEX SubKeyIndex,
+                          IN HCELL_INDEX Cell,
+                          IN ULONG HashKey)
+{
+    ULONG Slot;
+
+    /* Linear probing, the table is never more than half full */
+    Slot = HashKey & SubKeyIndex->TableMask;
+    while (SubKeyIndex->Table[Slot].Cell != HCELL_NIL)
+    {
+        Slot = (Slot + 1) & SubKeyIndex->TableMask;
+    }
+
+    SubKeyIndex->Table[Slot].Cell = Cell;
+    SubKeyIndex->Table[Slot].HashKey = HashKey;
+}
+
+static
+BOOLEAN
+CmpDeleteSubKeyIndexEntry(IN PCM_SUBKEY_INDEX SubKeyIndex,
+                          IN HCELL_INDEX Cell,
+                          IN ULONG HashKey)
+{
+    ULONG Mask = SubKeyIndex->TableMask;
+    ULONG Hole, Slot, Home;
+
+    /* Find the entry */
+    for (Hole = HashKey & Mask;
+         SubKeyIndex->Table[Hole].Cell != Cell;
+         Hole = (Hole + 1) & Mask)
+    {
+        if (SubKeyIndex->Table[Hole].Cell == HCELL_NIL) return FALSE;
+    }
+
+    /* Move back the entries of the run which can't be found past the hole anymore */
+    for (Slot = (Hole + 1) & Mask;
+         SubKeyIndex->Table[Slot].Cell != HCELL_NIL;
+         Slot = (Slot + 1) & Mask)
+    {
+        Home = SubKeyIndex->Table[Slot].HashKey & Mask;
+        if (((Slot - Home) & Mask) >= ((Slot - Hole) & Mask))
+        {
+            SubKeyIndex->Table[Hole] = SubKeyIndex->Table[Slot];
+            Hole = Slot;
+        }
+    }
+
+    SubKeyIndex->Table[Hole].Cell = HCELL_NIL;
+    return TRUE;
+}
+
+static
+ULONG
+CmpComputeKeyNodeHashKey(IN PHHIVE Hive,
+                         IN HCELL_INDEX Cell,
+                         OUT PBOOLEAN Success)
+{
+    PCM_KEY_NODE Node;
+    PUCHAR CompressedName;
+    ULONG Hash = 0, i;
+    WCHAR Char;
+
+    Node = (PCM_KEY_NODE)HvGetCell(Hive, Cell);
+    if (!Node)
+    {
+        *Success = FALSE;
+        return 0;
+    }
+
+    /* Same as CmpComputeHashKey, without building a string first */
+    if (Node->Flags & KEY_COMP_NAME)
+    {
+        CompressedName = (PUCHAR)Node->Name;
+        for (i = 0; i < Node->NameLength; i++)
+        {
+            Char = (WCHAR)CompressedName[i];
+            Hash = Hash * 37 + ((Char >= L'a') ? RtlUpcaseUnicodeChar(Char) : Char);
+        }
+    }
+    else
+    {
+        for (i = 0; i < Node->NameLength / sizeof(WCHAR); i++)
+        {
+            Char = Node->Name[i];
+            Hash = Hash * 37 + ((Char >= L'a') ? RtlUpcaseUnicodeChar(Char) : Char);
+        }
+    }
+
+    HvReleaseCell(Hive, Cell);
+    *Success = TRUE;
+    return Hash;
+}
+
+static
+BOOLEAN
+CmpAddLeafToSubKeyIndex(IN PHHIVE Hive,
+                        IN PCM_SUBKEY_INDEX SubKeyIndex,
+                        IN PCM_KEY_INDEX Leaf,
+                        IN OUT PULONG Added)
+{
+    PCM_KEY_FAST_INDEX FastIndex = (PCM_KEY_FAST_INDEX)Leaf;
+    HCELL_INDEX Cell;
+    ULONG HashKey, i;
+    BOOLEAN Success = TRUE;
+
+    if ((Leaf->Signature != CM_KEY_INDEX_LEAF) &&
+        (Leaf->Signature != CM_KEY_FAST_LEAF) &&
+        (Leaf->Signature != CM_KEY_HASH_LEAF))
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < Leaf->Count; i++)
+    {
+        /* Don't overflow the table on a corrupted count */
+        if (*Added >= SubKeyIndex->SubKeyCount) return FALSE;
+
+        /* Hash leaves already know the hash of each name */
+        if (Leaf->Signature == CM_KEY_HASH_LEAF)
+        {
+            Cell = FastIndex->List[i].Cell;
+            HashKey = FastIndex->List[i].HashKey;
+        }
+        else
+        {
+            Cell = (Leaf->Signature == CM_KEY_FAST_LEAF) ? FastIndex->List[i].Cell : Leaf->List[i];
+            HashKey = CmpComputeKeyNodeHashKey(Hive, Cell, &Success);
+            if (!Success) return FALSE;
+        }
+
+        CmpInsertSubKeyIndexEntry(SubKeyIndex, Cell, HashKey);
+        (*Added)++;
+    }
+
+    return TRUE;
+}
+
+static
+PCM_SUBKEY_INDEX
+CmpBuildSubKeyIndex(IN PHHIVE Hive,
+                    IN HCELL_INDEX ListCell,
+                    IN ULONG SubKeyCount)
+{
+    PCM_SUBKEY_INDEX SubKeyIndex;
+    PCM_KEY_INDEX IndexRoot, Leaf;
+    ULONG Added = 0, i;
+    BOOLEAN Success = TRUE;
+
+    SubKeyIndex = CmpAllocateSubKeyIndex(Hive, ListCell, SubKeyCount);
+    if (!SubKeyIndex) return NULL;
+
+    IndexRoot = (PCM_KEY_INDEX)HvGetCell(Hive, ListCell);
+    if (!IndexRoot)
+    {
+        Hive->Free(SubKeyIndex, 0);
+        return NULL;
+    }
+
+    if (IndexRoot->Signature == CM_KEY_INDEX_ROOT)
+    {
+        for (i = 0; Success && (i < IndexRoot->Count); i++)
+        {
+            Leaf = (PCM_KEY_INDEX)HvGetCell(Hive, IndexRoot->List[i]);
+            if (!Leaf)
+            {
+                Success = FALSE;
+                break;
+            }
+
+            Success = CmpAddLeafToSubKeyIndex(Hive, SubKeyIndex, Leaf, &Added);
+            HvReleaseCell(Hive, IndexRoot->List[i]);
+        }
+    }
+    else
+    {
+        Success = CmpAddLeafToSubKeyIndex(Hive, SubKeyIndex, IndexRoot, &Added);
+    }
+
+    HvReleaseCell(Hive, ListCell);
+
+    /* Let the regular search deal with anything inconsistent */
+    if (!Success || (Added != SubKeyCount))
+    {
+        DPRINT1("Could not index subkey list 0x%x (%lu of %lu subkeys)\n", ListCell, Added, SubKeyCount);
+        Hive->Free(SubKeyIndex, 0);
+        return NULL;
+    }
+
+    return SubKeyIndex;
+}
+
+static
+HCELL_INDEX
+CmpSearchSubKeyIndex(IN PHHIVE Hive,
+                     IN PCM_SUBKEY_INDEX SubKeyIndex,
+                     IN PCUNICODE_STRING SearchName)
+{
+    ULONG HashKey, Slot;
+
+    HashKey = CmpComputeHashKey(0, SearchName, FALSE);
+
+    for (Slot = HashKey & SubKeyIndex->TableMask;
+         SubKeyIndex->Table[Slot].Cell != HCELL_NIL;
+         Slot = (Slot + 1) & SubKeyIndex->TableMask)
+    {
+        if ((SubKeyIndex->Table[Slot].HashKey == HashKey) &&
+            !CmpDoCompareKeyName(Hive, SearchName, SubKeyIndex->Table[Slot].Cell))
+        {
+            return SubKeyIndex->Table[Slot].Cell;
+        }
+    }
+
+    return HCELL_NIL;
+}
+
+static
+BOOLEAN
+CmpFindSubKeyInIndexCache(IN PHHIVE Hive,
+                          IN HCELL_INDEX ListCell,
+                          IN ULONG SubKeyCount,
+                          IN PCUNICODE_STRING SearchName,
+                          OUT PHCELL_INDEX SubKey)
+{
+    PCM_SUBKEY_INDEX_CACHE Cache;
+    PCM_SUBKEY_INDEX SubKeyIndex;
+    PCM_SUBKEY_INDEX *Slot;
+
+    /* Allocate the cache on first use */
+    Cache = Hive->SubKeyIndexCache;
+    if (!Cache)
+    {
+        Cache = Hive->Allocate(sizeof(*Cache), TRUE, TAG_CM);
+        if (!Cache) return FALSE;
+        RtlZeroMemory(Cache, sizeof(*Cache));
+
+        if (InterlockedCompareExchangePointer((PVOID*)&Hive->SubKeyIndexCache, Cache, NULL))
+        {
+            /* Someone beat us to it */
+            Hive->Free(Cache, 0);
+            Cache = Hive->SubKeyIndexCache;
+        }
+    }
+
+    /* Take the index out of its slot while we use it */
+    Slot = &Cache->Slots[CmpSubKeyIndexSlot(ListCell)];
+    SubKeyIndex = InterlockedExchangePointer((PVOID*)Slot, CMP_SUBKEY_INDEX_BUSY);
+    if (SubKeyIndex == CMP_SUBKEY_INDEX_BUSY) return FALSE;
+
+    /* Evict whatever else was cached there, or a stale index of this key */
+    if (SubKeyIndex &&
+        ((SubKeyIndex->ListCell != ListCell) || (SubKeyIndex->SubKeyCount != SubKeyCount)))
+    {
+        Hive->Free(SubKeyIndex, 0);
+        SubKeyIndex = NULL;
+    }
+
+    if (!SubKeyIndex)
+    {
+        SubKeyIndex = CmpBuildSubKeyIndex(Hive, ListCell, SubKeyCount);
+        if (!SubKeyIndex)
+        {
+            InterlockedExchangePointer((PVOID*)Slot, NULL);
+            return FALSE;
+        }
+    }
+
+    *SubKey = CmpSearchSubKeyIndex(Hive, SubKeyIndex, SearchName);
+
+    /* Put it back */
+    InterlockedExchangePointer((PVOID*)Slot, SubKeyIndex);
+    return TRUE;
+}
+
+static
+PCM_SUBKEY_INDEX
+CmpTakeSubKeyIndex(IN PHHIVE Hive,
+                   IN HCELL_INDEX ListCell,
+                   IN ULONG SubKeyCount)
+{
+    PCM_SUBKEY_INDEX_CACHE Cache = Hive->SubKeyIndexCache;
+    PCM_SUBKEY_INDEX SubKeyIndex;
+    PCM_SUBKEY_INDEX *Slot;
+
+    if (!Cache || (ListCell == HCELL_NIL)) return NULL;
+
+    /* A busy slot means that our index, if any, is going away anyway */
+    Slot = &Cache->Slots[CmpSubKeyIndexSlot(ListCell)];
+    SubKeyIndex = InterlockedExchangePointer((PVOID*)Slot, CMP_SUBKEY_INDEX_BUSY);
+    if (SubKeyIndex == CMP_SUBKEY_INDEX_BUSY) return NULL;
+
+    /* Leave the slot empty until we know where the index goes */
+    InterlockedExchangePointer((PVOID*)Slot, NULL);
+
+    if (SubKeyIndex &&
+        ((SubKeyIndex->ListCell != ListCell) || (SubKeyIndex->SubKeyCount != SubKeyCount)))
+    {
+        Hive->Free(SubKeyIndex, 0);
+        SubKeyIndex = NULL;
+    }
+
+    return SubKeyIndex;
+}
+
+static
+VOID
+CmpPutSubKeyIndex(IN PHHIVE Hive,
+                  IN PCM_SUBKEY_INDEX SubKeyIndex)
+{
+    PCM_SUBKEY_INDEX_CACHE Cache = Hive->SubKeyIndexCache;
+    PCM_SUBKEY_INDEX OldIndex;
+    PCM_SUBKEY_INDEX *Slot;
+
+    Slot = &Cache->Slots[CmpSubKeyIndexSlot(SubKeyIndex->ListCell)];
+    for (;;)
+    {
+        /* Don't steal a slot from someone using it */
+        OldIndex = *Slot;
+        if (OldIndex == CMP_SUBKEY_INDEX_BUSY)
+        {
+            Hive->Free(SubKeyIndex, 0);
+            return;
+        }
+
+        if (InterlockedCompareExchangePointer((PVOID*)Slot, SubKeyIndex, OldIndex) == OldIndex)
+        {
+            if (OldIndex) Hive->Free(OldIndex, 0);
+            return;
+        }
+    }
+}
+
+static
+VOID
+CmpAddToSubKeyIndex(IN PHHIVE Hive,
+                    IN HCELL_INDEX OldListCell,
+                    IN HCELL_INDEX NewListCell,
+                    IN ULONG SubKeyCount,
+                    IN HCELL_INDEX Cell,
+                    IN PCUNICODE_STRING Name)
+{
+    PCM_SUBKEY_INDEX SubKeyIndex, NewIndex;
+    ULONG i;
+
+    /* Nothing to do unless the key had an index */
+    SubKeyIndex = CmpTakeSubKeyIndex(Hive, OldListCell, SubKeyCount - 1);
+    if (!SubKeyIndex) return;
+
+    /* Grow the table if it got too full */
+    if (CmpSubKeyIndexTableSize(SubKeyCount) > SubKeyIndex->TableMask + 1)
+    {
+        NewIndex = CmpAllocateSubKeyIndex(Hive, NewListCell, SubKeyCount);
+        if (NewIndex)
+        {
+            for (i = 0; i <= SubKeyIndex->TableMask; i++)
+            {
+                if (SubKeyIndex->Table[i].Cell == HCELL_NIL) continue;
+                CmpInsertSubKeyIndexEntry(NewIndex,
+                                          SubKeyIndex->Table[i].Cell,
+                                          SubKeyIndex->Table[i].HashKey);
+            }
+        }
+
+        Hive->Free(SubKeyIndex, 0);
+        SubKeyIndex = NewIndex;
+        if (!SubKeyIndex) return;
+    }
+
+    CmpInsertSubKeyIndexEntry(SubKeyIndex, Cell, CmpComputeHashKey(0, Name, FALSE));
+    SubKeyIndex->ListCell = NewListCell;
+    SubKeyIndex->SubKeyCount = SubKeyCount;
+    CmpPutSubKeyIndex(Hive, SubKeyIndex);
+}
+
+static
+VOID
+CmpRemoveFromSubKeyIndex(IN PHHIVE Hive,
+                         IN HCELL_INDEX OldListCell,
+                         IN HCELL_INDEX NewListCell,
+                         IN ULONG SubKeyCount,
+                         IN HCELL_INDEX Cell,
+                         IN PCUNICODE_STRING Name)
+{
+    PCM_SUBKEY_INDEX SubKeyIndex;
+
+    /* Nothing to do unless the key had an index */
+    SubKeyIndex = CmpTakeSubKeyIndex(Hive, OldListCell, SubKeyCount + 1);
+    if (!SubKeyIndex) return;
+
+    /* Drop the index with the last subkey, or if it doesn't know it */
+    if ((NewListCell == HCELL_NIL) ||
+        !CmpDeleteSubKeyIndexEntry(SubKeyIndex, Cell, CmpComputeHashKey(0, Name, FALSE)))
+    {
+        Hive->Free(SubKeyIndex, 0);
+        return;
+    }
+
+    SubKeyIndex->ListCell = NewListCell;
+    SubKeyIndex->SubKeyCount = SubKeyCount;
+    CmpPutSubKeyIndex(Hive, SubKeyIndex);
+}
+
+VOID
+NTAPI
+CmpInvalidateSubKeyIndex(IN PHHIVE Hive,
+                         IN HCELL_INDEX ListCell)
+{
+    PCM_SUBKEY_INDEX_CACHE Cache = Hive->SubKeyIndexCache;
+    PCM_SUBKEY_INDEX SubKeyIndex;
+    PCM_SUBKEY_INDEX *Slot;
+
+    if (!Cache || (ListCell == HCELL_NIL)) return;
+
+    /*
+     * A busy slot is used by someone working on another key. If they took
+     * our index out, they will notice the mismatch and free it by themselves.
+     */
+    Slot = &Cache->Slots[CmpSubKeyIndexSlot(ListCell)];
+    SubKeyIndex = *Slot;
+    if (!SubKeyIndex ||
+        (SubKeyIndex == CMP_SUBKEY_INDEX_BUSY) ||
+        (SubKeyIndex->ListCell != ListCell))
+    {
+        return;
+    }
+
+    if (InterlockedCompareExchangePointer((PVOID*)Slot, NULL, SubKeyIndex) == SubKeyIndex)
+    {
+        Hive->Free(SubKeyIndex, 0);
+    }
+}
+
+VOID
+NTAPI
+CmpDestroySubKeyIndexCache(IN PHHIVE Hive)
+{
+    PCM_SUBKEY_INDEX_CACHE Cache = Hive->SubKeyIndexCache;
+    ULONG i;
+
+    if (!Cache) return;
+
+    for (i = 0; i < CMP_SUBKEY_INDEX_CACHE_SIZE; i++)
+    {
+        ASSERT(Cache->Slots[i] != CMP_SUBKEY_INDEX_BUSY);
+        if (Cache->Slots[i]) Hive->Free(Cache->Slots[i], 0);
+    }
+
+    Hive->Free(Cache, 0);
+    Hive->SubKeyIndexCache = NULL;
+}
+
 HCELL_INDEX
 NTAPI
 CmpFindSubKeyByName(IN PHHIVE Hive,
@@ -695,6 +1230,18 @@ CmpFindSubKeyByName(IN PHHIVE Hive,
         /* Make sure the parent node has subkeys */
         if (Parent->SubKeyCounts[i])
         {
+            /* Large keys are looked up through their hash index */
+            if ((Parent->SubKeyCounts[i] >= CmpSubKeyIndexThreshold) &&
+                CmpFindSubKeyInIndexCache(Hive,
+                                          Parent->SubKeyLists[i],
+                                          Parent->SubKeyCounts[i],
+                                          SearchName,
+                                          &SubKey))
+            {
+                if (SubKey != HCELL_NIL) return SubKey;
+                continue;
+            }
+
             /* Get the Index */
             IndexRoot = (PCM_KEY_INDEX)HvGetCell(Hive, Parent->SubKeyLists[i]);
             if (!IndexRoot) return HCELL_NIL;
@@ -1471,6 +2018,7 @@ CmpAddSubKey(IN PHHIVE Hive,
     PCM_KEY_FAST_INDEX OldIndex;
     UNICODE_STRING Name;
     HCELL_INDEX IndexCell = HCELL_NIL, CellToRelease = HCELL_NIL, LeafCell;
+    HCELL_INDEX OldListCell;
     PHCELL_INDEX RootPointer = NULL;
     ULONG Type, i;
     BOOLEAN IsCompressed;
@@ -1533,6 +2081,7 @@ CmpAddSubKey(IN PHHIVE Hive,
 
     /* Find out the type of the cell, and check if this is the first subkey */
     Type = HvGetCellType(Child);
+    OldListCell = KeyNode->SubKeyCounts[Type] ? KeyNode->SubKeyLists[Type] : HCELL_NIL;
     if (!KeyNode->SubKeyCounts[Type])
     {
         /* Allocate a fast leaf */
@@ -1679,6 +2228,14 @@ CmpAddSubKey(IN PHHIVE Hive,
         KeyNode->SubKeyLists[Type] = LeafCell;
     }
 
+    /* Keep the lookup index in sync */
+    CmpAddToSubKeyIndex(Hive,
+                        OldListCell,
+                        KeyNode->SubKeyLists[Type],
+                        KeyNode->SubKeyCounts[Type],
+                        Child,
+                        &Name);
+
     /* If the name was compressed, free our copy */
     if (IsCompressed) Hive->Free(Name.Buffer, 0);
 
@@ -1699,7 +2256,7 @@ CmpRemoveSubKey(IN PHHIVE Hive,
     UNICODE_STRING SearchName;
     BOOLEAN IsCompressed;
     WCHAR Buffer[50];
-    HCELL_INDEX RootCell = HCELL_NIL, LeafCell, ChildCell;
+    HCELL_INDEX RootCell = HCELL_NIL, LeafCell, ChildCell, OldListCell;
     PCM_KEY_INDEX Root = NULL, Leaf;
     PCM_KEY_FAST_INDEX Child;
     ULONG Storage, RootIndex = INVALID_INDEX, LeafIndex;
@@ -1767,6 +2324,7 @@ CmpRemoveSubKey(IN PHHIVE Hive,
     //ASSERT(HvIsCellAllocated(Hive, Node->SubKeyLists[Storage]));
 
     /* Get the leaf cell now */
+    OldListCell = Node->SubKeyLists[Storage];
     LeafCell = Node->SubKeyLists[Storage];
     Leaf = (PCM_KEY_INDEX)HvGetCell(Hive, LeafCell);
     if (!Leaf) goto Exit;
@@ -1856,6 +2414,14 @@ CmpRemoveSubKey(IN PHHIVE Hive,
         }
     }
 
+    /* Keep the lookup index in sync */
+    CmpRemoveFromSubKeyIndex(Hive,
+                             OldListCell,
+                             Node->SubKeyLists[Storage],
+                             Node->SubKeyCounts[Storage],
+                             ChildCell,
+                             &SearchName);
+
     /* If we got here, now we're done */
     Result = TRUE;
 
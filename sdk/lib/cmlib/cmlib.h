@@ -139,6 +139,28 @@
     #define PWORK_QUEUE_ITEM PVOID
     #define EX_PUSH_LOCK PULONG_PTR
 
+    // The host tools are single-threaded
+    static __inline PVOID
+    InterlockedExchangePointer(
+        IN OUT PVOID volatile *Target,
+        IN PVOID Value)
+    {
+        PVOID Old = *Target;
+        *Target = Value;
+        return Old;
+    }
+
+    static __inline PVOID
+    InterlockedCompareExchangePointer(
+        IN OUT PVOID volatile *Destination,
+        IN PVOID Exchange,
+        IN PVOID Comparand)
+    {
+        PVOID Old = *Destination;
+        if (Old == Comparand) *Destination = Exchange;
+        return Old;
+    }
+
     // Definitions copied from <ntifs.h>
     // We only want to include host headers, so we define them manually
 
@@ -375,6 +397,7 @@ typedef struct _HV_TRACK_CELL_REF
 } HV_TRACK_CELL_REF, *PHV_TRACK_CELL_REF;
 
 extern ULONG CmlibTraceLevel;
+extern ULONG CmpSubKeyIndexThreshold;
 
 //
 // Hack since big keys are not yet supported
@@ -724,6 +747,19 @@ CmpMarkIndexDirty(
     HCELL_INDEX TargetKey
 );
 
+VOID
+NTAPI
+CmpInvalidateSubKeyIndex(
+    IN PHHIVE Hive,
+    IN HCELL_INDEX ListCell
+);
+
+VOID
+NTAPI
+CmpDestroySubKeyIndexCache(
+    IN PHHIVE Hive
+);
+
 
 //
 // Name Functions
@@ -355,6 +355,9 @@ typedef struct _HHIVE
     ULONG StorageTypeCount;
     ULONG Version;
     DUAL Storage[HTYPE_COUNT];
+
+    /* ReactOS-specific: lookup indexes of keys with many subkeys, see cmindex.c */
+    struct _CM_SUBKEY_INDEX_CACHE *SubKeyIndexCache;
 } HHIVE, *PHHIVE;
 
 #define IsFreeCell(Cell)    ((Cell)->Size >= 0)
@@ -1512,6 +1512,9 @@ CMAPI
 HvFree(
     _In_ PHHIVE RegistryHive)
 {
+    /* Release the subkey lookup indexes */
+    CmpDestroySubKeyIndexCache(RegistryHive);
+
     if (!RegistryHive->ReadOnly)
     {
         /* Release hive bitmap */
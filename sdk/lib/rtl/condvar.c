@@ -30,17 +30,12 @@ typedef struct _COND_VAR_WAIT_ENTRY
     /* ListEntry must have an alignment of at least 32-bits, since we
        want COND_VAR_ADDRESS_MASK to cover all of the address. */
     LIST_ENTRY ListEntry;
-    PVOID WaitKey;
     BOOLEAN ListRemovalHandled;
 } COND_VAR_WAIT_ENTRY, * PCOND_VAR_WAIT_ENTRY;
 
 #define CONTAINING_COND_VAR_WAIT_ENTRY(address, field) \
     CONTAINING_RECORD(address, COND_VAR_WAIT_ENTRY, field)
 
-/* GLOBALS *******************************************************************/
-
-static HANDLE CondVarKeyedEventHandle = NULL;
-
 /* INTERNAL FUNCTIONS ********************************************************/
 
 FORCEINLINE
@@ -265,11 +260,8 @@ InternalWake(IN OUT PRTL_CONDITION_VARIABLE ConditionVariable,
     PCOND_VAR_WAIT_ENTRY CONST HeadEntry = InternalLockCondVar(ConditionVariable, NULL, NULL);
     PCOND_VAR_WAIT_ENTRY Entry;
     PCOND_VAR_WAIT_ENTRY NextEntry;
-    LARGE_INTEGER Timeout;
     PCOND_VAR_WAIT_ENTRY RemoveOnUnlockEntry;
 
-    ASSERT(CondVarKeyedEventHandle != NULL);
-
     if (HeadEntry == NULL)
     {
         /* There is noone there to wake up. In this case do nothing
@@ -277,7 +269,6 @@ InternalWake(IN OUT PRTL_CONDITION_VARIABLE ConditionVariable,
         return;
     }
 
-    Timeout.QuadPart = 0;
     RemoveOnUnlockEntry = NULL;
 
     /* Release sleeping threads. We will iterate from the last entry on
@@ -287,12 +278,14 @@ InternalWake(IN OUT PRTL_CONDITION_VARIABLE ConditionVariable,
          Entry != NULL;
          Entry = NextEntry)
     {
-        NTSTATUS Status;
-
         if (HeadEntry == Entry)
         {
-            /* After the current entry we've iterated through the
-               entire list in backward direction. Then exit.*/
+            /* This is the list head. We can't remove it as easily as
+               other entries and will pass it to the unlock routine
+               later, which also signals it. After the current entry
+               we've iterated through the entire list in backward
+               direction. */
+            RemoveOnUnlockEntry = HeadEntry;
             NextEntry = NULL;
         }
         else
@@ -300,53 +293,29 @@ InternalWake(IN OUT PRTL_CONDITION_VARIABLE ConditionVariable,
             /* Store away the next reference right now, since we may
                not touch Entry anymore at the end of the block. */
             NextEntry = CONTAINING_COND_VAR_WAIT_ENTRY(Entry->ListEntry.Blink, ListEntry);
-        }
-
-        /* Wake the thread associated with this event. We will
-           immediately return if we failed (zero timeout). */
-        Status = NtReleaseKeyedEvent(CondVarKeyedEventHandle,
-                                     &Entry->WaitKey,
-                                     FALSE,
-                                     &Timeout);
-
-        if (!NT_SUCCESS(Status))
-        {
-            /* We failed to wake a thread. We'll keep trying. */
-            ASSERT(STATUS_INVALID_HANDLE != Status);
-            continue;
-        }
 
-        /* We've woken a thread and will make sure this thread
-           is removed from the list. */
-        if (HeadEntry == Entry)
-        {
-            /* This is the list head. We can't remove it as easily as
-               other entries and will pass it to the unlock routine
-               later (we will exit the loop after this round anyway). */
-            RemoveOnUnlockEntry = HeadEntry;
-        }
-        else
-        {
             /* We can remove the entry right away. */
             RemoveEntryList(&Entry->ListEntry);
 
-            /* Now tell the woken thread that removal from the list was
-               already taken care of here so that this thread can resume
-               its normal operation more quickly. We may not touch
-               Entry after signaling this, since it may lie in invalid
-               memory from there on. */
+            /* Now tell the thread that it was removed from the list,
+               which is what it is waiting for. We may not touch Entry
+               after signaling this, since it may lie in invalid memory
+               from there on. Waking only needs its address. */
             *InternalGetListRemovalHandledFlag(Entry) = TRUE;
+            RtlWakeAddressSingle(InternalGetListRemovalHandledFlag(Entry));
         }
 
         if (!ReleaseAll)
         {
-            /* We've successfully woken one thread as the caller
-               demanded. */
+            /* We've signaled one thread as the caller demanded. */
             break;
         }
     }
 
     InternalUnlockCondVar(ConditionVariable, RemoveOnUnlockEntry);
+
+    if (RemoveOnUnlockEntry != NULL)
+        RtlWakeAddressSingle(InternalGetListRemovalHandledFlag(RemoveOnUnlockEntry));
 }
 
 VOID
@@ -375,11 +344,23 @@ InternalSleep(IN OUT PRTL_CONDITION_VARIABLE ConditionVariable,
        held again on return. */
 
     COND_VAR_WAIT_ENTRY OwnEntry;
+    BOOLEAN NotRemoved = FALSE;
+    BOOLEAN SelfRemoved = FALSE;
+    LARGE_INTEGER Deadline;
+    PLARGE_INTEGER WaitTimeOut = (PLARGE_INTEGER)TimeOut;
     NTSTATUS Status;
 
-    ASSERT(CondVarKeyedEventHandle != NULL);
     ASSERT((CriticalSection == NULL) != (SRWLock == NULL));
 
+    /* We may wake up several times before a waker takes OwnEntry off the
+       list, so turn a relative timeout into a deadline once. */
+    if (TimeOut != NULL && TimeOut->QuadPart < 0)
+    {
+        NtQuerySystemTime(&Deadline);
+        Deadline.QuadPart -= TimeOut->QuadPart;
+        WaitTimeOut = &Deadline;
+    }
+
     RtlZeroMemory(&OwnEntry, sizeof(OwnEntry));
 
     /* Put OwnEntry on the list. */
@@ -404,13 +385,18 @@ InternalSleep(IN OUT PRTL_CONDITION_VARIABLE ConditionVariable,
         RtlLeaveCriticalSection(CriticalSection);
     }
 
-    /* Now sleep using the caller provided timeout. */
-    Status = NtWaitForKeyedEvent(CondVarKeyedEventHandle,
-                                 &OwnEntry.WaitKey,
-                                 FALSE,
-                                 (PLARGE_INTEGER)TimeOut);
-
-    ASSERT(STATUS_INVALID_HANDLE != Status);
+    /* Now sleep using the caller provided timeout, until a waker
+       takes OwnEntry off the list. */
+    Status = STATUS_SUCCESS;
+    while (!*(volatile BOOLEAN *)InternalGetListRemovalHandledFlag(&OwnEntry))
+    {
+        Status = RtlWaitOnAddress(InternalGetListRemovalHandledFlag(&OwnEntry),
+                                  &NotRemoved,
+                                  sizeof(NotRemoved),
+                                  WaitTimeOut);
+        if (Status != STATUS_SUCCESS)
+            break;
+    }
 
     if (!*InternalGetListRemovalHandledFlag(&OwnEntry))
     {
@@ -423,12 +409,17 @@ InternalSleep(IN OUT PRTL_CONDITION_VARIABLE ConditionVariable,
         {
             /* Unlock and potentially remove OwnEntry. Self-removal is
                usually only necessary when a timeout occurred. */
+            SelfRemoved = !OwnEntry.ListRemovalHandled;
             InternalUnlockCondVar(ConditionVariable,
-                                  !OwnEntry.ListRemovalHandled ?
-                                  &OwnEntry : NULL);
+                                  SelfRemoved ? &OwnEntry : NULL);
         }
     }
 
+    /* If a waker took OwnEntry off the list, even after our wait timed
+       out, the wake was spent on us. Report it, or a wake-one is lost. */
+    if (!SelfRemoved)
+        Status = STATUS_SUCCESS;
+
 #ifdef _DEBUG
     /* Clear OwnEntry to aid in detecting bugs. */
     RtlZeroMemory(&OwnEntry, sizeof(OwnEntry));
@@ -451,27 +442,10 @@ InternalSleep(IN OUT PRTL_CONDITION_VARIABLE ConditionVariable,
         RtlEnterCriticalSection(CriticalSection);
     }
 
-    /* Return whatever NtWaitForKeyedEvent returned. */
+    /* Return whatever RtlWaitOnAddress returned, unless we were woken. */
     return Status;
 }
 
-VOID
-NTAPI
-RtlpInitializeKeyedEvent(VOID)
-{
-    ASSERT(CondVarKeyedEventHandle == NULL);
-    NtCreateKeyedEvent(&CondVarKeyedEventHandle, EVENT_ALL_ACCESS, NULL, 0);
-}
-
-VOID
-NTAPI
-RtlpCloseKeyedEvent(VOID)
-{
-    ASSERT(CondVarKeyedEventHandle != NULL);
-    NtClose(CondVarKeyedEventHandle);
-    CondVarKeyedEventHandle = NULL;
-}
-
 /* EXPORTED FUNCTIONS ********************************************************/
 
 VOID
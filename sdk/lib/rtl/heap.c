@@ -2125,6 +2125,17 @@ RtlAllocateHeap(IN PVOID HeapPtr,
 
     Index = AllocationSize >> HEAP_ENTRY_SHIFT;
 
+    /* Plain small blocks are served by the low fragmentation heap, if enabled */
+    if (Heap->FrontEndHeapType == HEAP_FRONT_END_LFH &&
+        EntryFlags == HEAP_ENTRY_BUSY &&
+        Index <= HEAP_LFH_MAX_BLOCK_SIZE)
+    {
+        PVOID Ptr = RtlpLfhAllocate(Heap, Flags, Size, Index);
+
+        /* Otherwise fall back to the back end */
+        if (Ptr) return Ptr;
+    }
+
     /* Acquire the lock if necessary */
     if (!(Flags & HEAP_NO_SERIALIZE))
     {
@@ -2317,7 +2328,8 @@ BOOLEAN NTAPI RtlFreeHeap(
         /* Check this entry, fail if it's invalid */
         if (!(HeapEntry->Flags & HEAP_ENTRY_BUSY) ||
             (((ULONG_PTR)Ptr & 0x7) != 0) ||
-            (HeapEntry->SegmentOffset >= HEAP_SEGMENTS))
+            ((HeapEntry->SegmentOffset >= HEAP_SEGMENTS) &&
+             (HeapEntry->SegmentOffset != HEAP_LFH_SEGMENT_OFFSET)))
         {
             /* This is an invalid block */
             DPRINT1("HEAP: Trying to free an invalid address %p!\n", Ptr);
@@ -2334,6 +2346,10 @@ BOOLEAN NTAPI RtlFreeHeap(
     }
     _SEH2_END;
 
+    /* Blocks of the low fragmentation heap go back to their subsegment without locking */
+    if (HeapEntry->SegmentOffset == HEAP_LFH_SEGMENT_OFFSET)
+        return RtlpLfhFree(Heap, HeapEntry);
+
     /* Lock if necessary */
     if (!(Flags & HEAP_NO_SERIALIZE))
     {
@@ -2725,6 +2741,10 @@ RtlReAllocateHeap(HANDLE HeapPtr,
         return NULL;
     }
 
+    /* Blocks of the low fragmentation heap can't grow into their neighbours */
+    if ((((PHEAP_ENTRY)Ptr)-1)->SegmentOffset == HEAP_LFH_SEGMENT_OFFSET)
+        return RtlpLfhReAllocate(Heap, Flags, Ptr, Size);
+
     /* Calculate allocation size and index */
     if (Size)
         AllocationSize = Size;
@@ -3298,6 +3318,13 @@ RtlpValidateHeapEntry(
     if ((ULONG_PTR)HeapEntry & (HEAP_ENTRY_SIZE - 1)) goto invalid_entry;
     if (!(HeapEntry->Flags & HEAP_ENTRY_BUSY)) goto invalid_entry;
 
+    /* Blocks of the low fragmentation heap live inside a busy back end block */
+    if (HeapEntry->SegmentOffset == HEAP_LFH_SEGMENT_OFFSET)
+    {
+        if (!RtlpLfhValidateEntry(Heap, HeapEntry)) goto invalid_entry;
+        return TRUE;
+    }
+
     BigAllocation = HeapEntry->Flags & HEAP_ENTRY_VIRTUAL_ALLOC;
     Segment = Heap->Segments[HeapEntry->SegmentOffset];
 
@@ -4080,13 +4107,12 @@ RtlSetHeapInformation(IN HANDLE HeapHandle OPTIONAL,
         }
 
         /* Check for a special magic value for enabling LFH */
-        if (*(PULONG)HeapInformation != 2)
+        if (*(PULONG)HeapInformation != HEAP_FRONT_END_LFH || !HeapHandle)
         {
             return STATUS_UNSUCCESSFUL;
         }
 
-        DPRINT1("RtlSetHeapInformation() needs to enable LFH\n");
-        return STATUS_SUCCESS;
+        return RtlpLfhEnable((PHEAP)HeapHandle);
     }
 
     return STATUS_SUCCESS;
@@ -54,6 +54,17 @@
 /* Segment flags */
 #define HEAP_USER_ALLOCATED    0x1
 
+/* Front end heap types, as reported through HeapCompatibilityInformation */
+#define HEAP_FRONT_END_NONE    0
+#define HEAP_FRONT_END_LFH     2
+
+/* Blocks owned by the low fragmentation heap use this instead of a segment index */
+#define HEAP_LFH_SEGMENT_OFFSET 0xFF
+C_ASSERT(HEAP_LFH_SEGMENT_OFFSET >= HEAP_SEGMENTS);
+
+/* Largest block served by the low fragmentation heap, in units and including the header */
+#define HEAP_LFH_MAX_BLOCK_SIZE 256
+
 /* A handy inline to distinguis normal heap, special "debug heap" and special "page heap" */
 FORCEINLINE BOOLEAN
 RtlpHeapIsSpecial(ULONG Flags)
@@ -338,6 +349,22 @@ RtlpValidateHeapEntry(PHEAP Heap, PHEAP_ENTRY HeapEntry);
 BOOLEAN NTAPI
 RtlpValidateHeapHeaders(PHEAP Heap, BOOLEAN Recalculate);
 
+/* heaplfh.c */
+NTSTATUS NTAPI
+RtlpLfhEnable(PHEAP Heap);
+
+PVOID NTAPI
+RtlpLfhAllocate(PHEAP Heap, ULONG Flags, SIZE_T Size, SIZE_T Index);
+
+BOOLEAN NTAPI
+RtlpLfhFree(PHEAP Heap, PHEAP_ENTRY HeapEntry);
+
+PVOID NTAPI
+RtlpLfhReAllocate(PHEAP Heap, ULONG Flags, PVOID Ptr, SIZE_T Size);
+
+BOOLEAN NTAPI
+RtlpLfhValidateEntry(PHEAP Heap, PHEAP_ENTRY HeapEntry);
+
 /* heapdbg.c */
 NTSYSAPI
 HANDLE NTAPI
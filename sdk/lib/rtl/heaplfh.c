@@ -0,0 +1,495 @@
+/*
+ * PROJECT:     ReactOS system libraries
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     RTL low fragmentation front end heap
+ */
+
+/*
+ * Small blocks are carved out of "subsegments": single back end allocations
+ * holding a run of equally sized blocks. Each size bucket keeps one active
+ * subsegment per slot, and threads are spread over the slots, so that threads
+ * allocating the same size mostly work on different subsegments. Allocating
+ * and freeing a block only touches the subsegment free list, which is a lock
+ * free stack of block indexes guarded by a sequence number. The heap lock is
+ * only taken when a slot runs dry and needs another subsegment.
+ *
+ * Subsegments are never given back to the back end before the heap is
+ * destroyed: a thread may still hold a stale active subsegment pointer, and
+ * keeping the memory around is what makes the lock free paths safe.
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <rtl.h>
+#include <heap.h>
+
+#define NDEBUG
+#include <debug.h>
+
+/* TYPES **********************************************************************/
+
+#define HEAP_LFH_SIGNATURE            'HfLR'
+#define HEAP_LFH_SUBSEGMENT_SIGNATURE 'SfLR'
+
+/* 32 buckets of 1 unit, then 16 buckets each of 2, 4 and 8 units */
+#define HEAP_LFH_BUCKETS 80
+
+/* Number of active subsegments per bucket, must be a power of two */
+#define HEAP_LFH_SLOTS 8
+
+/* Amount of block memory a subsegment aims for */
+#define HEAP_LFH_SUBSEGMENT_BYTES (16 * 1024)
+#define HEAP_LFH_MIN_BLOCKS       16
+#define HEAP_LFH_MAX_BLOCKS       1024
+
+typedef union _HEAP_LFH_FREE_STATE
+{
+    struct
+    {
+        USHORT FreeIndex;
+        USHORT Depth;
+        ULONG Sequence;
+    };
+    LONGLONG Value;
+} HEAP_LFH_FREE_STATE, *PHEAP_LFH_FREE_STATE;
+
+typedef struct _HEAP_LFH_SUBSEGMENT
+{
+    /* Must stay first, so that it is 8-byte aligned */
+    volatile HEAP_LFH_FREE_STATE FreeState;
+    ULONG Signature;
+    USHORT BucketIndex;
+    USHORT BlockUnits;
+    USHORT BlockCount;
+    BOOLEAN Active;
+    struct _HEAP_LFH *Lfh;
+    LIST_ENTRY ListEntry;
+} HEAP_LFH_SUBSEGMENT, *PHEAP_LFH_SUBSEGMENT;
+
+#define HEAP_LFH_FIRST_BLOCK_OFFSET ROUND_UP(sizeof(HEAP_LFH_SUBSEGMENT), HEAP_ENTRY_SIZE)
+
+typedef struct _HEAP_LFH_BUCKET
+{
+    USHORT BlockUnits;
+    LIST_ENTRY SubsegmentList;
+    PHEAP_LFH_SUBSEGMENT volatile ActiveSubsegment[HEAP_LFH_SLOTS];
+} HEAP_LFH_BUCKET, *PHEAP_LFH_BUCKET;
+
+typedef struct _HEAP_LFH
+{
+    ULONG Signature;
+    PHEAP Heap;
+    HEAP_LFH_BUCKET Buckets[HEAP_LFH_BUCKETS];
+} HEAP_LFH, *PHEAP_LFH;
+
+/* FUNCTIONS *****************************************************************/
+
+static
+ULONG
+RtlpLfhBucketIndex(SIZE_T Units)
+{
+    ASSERT(Units > 0 && Units <= HEAP_LFH_MAX_BLOCK_SIZE);
+
+    if (Units <= 32) return (ULONG)Units - 1;
+    if (Units <= 64) return 32 + (ULONG)(Units - 33) / 2;
+    if (Units <= 128) return 48 + (ULONG)(Units - 65) / 4;
+    return 64 + (ULONG)(Units - 129) / 8;
+}
+
+static
+USHORT
+RtlpLfhBucketUnits(ULONG BucketIndex)
+{
+    if (BucketIndex < 32) return (USHORT)(BucketIndex + 1);
+    if (BucketIndex < 48) return (USHORT)(34 + (BucketIndex - 32) * 2);
+    if (BucketIndex < 64) return (USHORT)(68 + (BucketIndex - 48) * 4);
+    return (USHORT)(136 + (BucketIndex - 64) * 8);
+}
+
+FORCEINLINE
+ULONG
+RtlpLfhGetSlot(VOID)
+{
+    /* Thread ids are multiples of 4 */
+    return ((ULONG)(ULONG_PTR)NtCurrentTeb()->ClientId.UniqueThread >> 2) & (HEAP_LFH_SLOTS - 1);
+}
+
+FORCEINLINE
+PHEAP_ENTRY
+RtlpLfhGetBlock(PHEAP_LFH_SUBSEGMENT Subsegment, ULONG BlockIndex)
+{
+    return (PHEAP_ENTRY)((PCHAR)Subsegment + HEAP_LFH_FIRST_BLOCK_OFFSET +
+                         ((SIZE_T)BlockIndex * Subsegment->BlockUnits << HEAP_ENTRY_SHIFT));
+}
+
+static
+PHEAP_LFH_SUBSEGMENT
+RtlpLfhGetSubsegment(PHEAP Heap, PHEAP_ENTRY HeapEntry)
+{
+    PHEAP_LFH_SUBSEGMENT Subsegment;
+
+    if (Heap->FrontEndHeapType != HEAP_FRONT_END_LFH)
+        return NULL;
+
+    /* The block header gives its index and size, which lead back to the subsegment */
+    _SEH2_TRY
+    {
+        Subsegment = (PHEAP_LFH_SUBSEGMENT)((PCHAR)HeapEntry - HEAP_LFH_FIRST_BLOCK_OFFSET -
+                                            ((SIZE_T)HeapEntry->PreviousSize * HeapEntry->Size << HEAP_ENTRY_SHIFT));
+
+        if (Subsegment->Signature != HEAP_LFH_SUBSEGMENT_SIGNATURE ||
+            Subsegment->Lfh != Heap->FrontEndHeap ||
+            Subsegment->BlockUnits != HeapEntry->Size ||
+            HeapEntry->PreviousSize >= Subsegment->BlockCount)
+        {
+            Subsegment = NULL;
+        }
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        Subsegment = NULL;
+    }
+    _SEH2_END;
+
+    return Subsegment;
+}
+
+static
+PHEAP_ENTRY
+RtlpLfhPopBlock(PHEAP_LFH_SUBSEGMENT Subsegment)
+{
+    HEAP_LFH_FREE_STATE OldState, NewState;
+    PHEAP_ENTRY Block;
+    LONGLONG Compare;
+
+    OldState.Value = Subsegment->FreeState.Value;
+
+    do
+    {
+        if (!OldState.Depth)
+            return NULL;
+
+        /* The block may be handed out concurrently, in which case the sequence tells */
+        Block = RtlpLfhGetBlock(Subsegment, OldState.FreeIndex);
+
+        NewState.FreeIndex = *(volatile USHORT *)(Block + 1);
+        NewState.Depth = OldState.Depth - 1;
+        NewState.Sequence = OldState.Sequence + 1;
+
+        Compare = OldState.Value;
+        OldState.Value = InterlockedCompareExchange64(&Subsegment->FreeState.Value,
+                                                      NewState.Value,
+                                                      Compare);
+    }
+    while (OldState.Value != Compare);
+
+    return Block;
+}
+
+static
+VOID
+RtlpLfhPushBlock(PHEAP_LFH_SUBSEGMENT Subsegment, PHEAP_ENTRY Block)
+{
+    HEAP_LFH_FREE_STATE OldState, NewState;
+    LONGLONG Compare;
+
+    OldState.Value = Subsegment->FreeState.Value;
+
+    do
+    {
+        /* Free blocks keep the index of the next free block in their data */
+        *(volatile USHORT *)(Block + 1) = OldState.FreeIndex;
+
+        NewState.FreeIndex = Block->PreviousSize;
+        NewState.Depth = OldState.Depth + 1;
+        NewState.Sequence = OldState.Sequence + 1;
+
+        Compare = OldState.Value;
+        OldState.Value = InterlockedCompareExchange64(&Subsegment->FreeState.Value,
+                                                      NewState.Value,
+                                                      Compare);
+    }
+    while (OldState.Value != Compare);
+}
+
+static
+PHEAP_LFH_SUBSEGMENT
+RtlpLfhCreateSubsegment(PHEAP Heap, PHEAP_LFH Lfh, ULONG BucketIndex)
+{
+    PHEAP_LFH_BUCKET Bucket = &Lfh->Buckets[BucketIndex];
+    PHEAP_LFH_SUBSEGMENT Subsegment;
+    PHEAP_ENTRY Block;
+    ULONG BlockCount, i;
+    SIZE_T BlockSize;
+
+    BlockSize = (SIZE_T)Bucket->BlockUnits << HEAP_ENTRY_SHIFT;
+    BlockCount = (ULONG)(HEAP_LFH_SUBSEGMENT_BYTES / BlockSize);
+    BlockCount = max(BlockCount, HEAP_LFH_MIN_BLOCKS);
+    BlockCount = min(BlockCount, HEAP_LFH_MAX_BLOCKS);
+
+    /* The heap lock is held, and the size is too large to come back here */
+    Subsegment = RtlAllocateHeap(Heap,
+                                 HEAP_NO_SERIALIZE,
+                                 HEAP_LFH_FIRST_BLOCK_OFFSET + BlockCount * BlockSize);
+    if (!Subsegment)
+        return NULL;
+
+    Subsegment->Signature = HEAP_LFH_SUBSEGMENT_SIGNATURE;
+    Subsegment->BucketIndex = (USHORT)BucketIndex;
+    Subsegment->BlockUnits = Bucket->BlockUnits;
+    Subsegment->BlockCount = (USHORT)BlockCount;
+    Subsegment->Active = FALSE;
+    Subsegment->Lfh = Lfh;
+
+    /* Chain all blocks in address order */
+    for (i = 0; i < BlockCount; i++)
+    {
+        Block = RtlpLfhGetBlock(Subsegment, i);
+        RtlZeroMemory(Block, sizeof(HEAP_ENTRY));
+        Block->Size = Subsegment->BlockUnits;
+        Block->PreviousSize = (USHORT)i;
+        Block->SegmentOffset = HEAP_LFH_SEGMENT_OFFSET;
+        *(PUSHORT)(Block + 1) = (USHORT)(i + 1);
+    }
+
+    Subsegment->FreeState.FreeIndex = 0;
+    Subsegment->FreeState.Depth = (USHORT)BlockCount;
+    Subsegment->FreeState.Sequence = 0;
+
+    InsertTailList(&Bucket->SubsegmentList, &Subsegment->ListEntry);
+
+    return Subsegment;
+}
+
+static
+PHEAP_LFH_SUBSEGMENT
+RtlpLfhRefillSlot(PHEAP Heap, PHEAP_LFH Lfh, ULONG BucketIndex, ULONG Slot)
+{
+    PHEAP_LFH_BUCKET Bucket = &Lfh->Buckets[BucketIndex];
+    PHEAP_LFH_SUBSEGMENT Subsegment, Candidate = NULL;
+    PLIST_ENTRY Current;
+
+    RtlEnterHeapLock(Heap->LockVariable, TRUE);
+
+    /* Another thread sharing this slot may have refilled it meanwhile */
+    Subsegment = Bucket->ActiveSubsegment[Slot];
+    if (Subsegment && Subsegment->FreeState.Depth)
+    {
+        RtlLeaveHeapLock(Heap->LockVariable);
+        return Subsegment;
+    }
+
+    /* Look for the subsegment with the most free blocks that no slot is using */
+    for (Current = Bucket->SubsegmentList.Flink;
+         Current != &Bucket->SubsegmentList;
+         Current = Current->Flink)
+    {
+        Subsegment = CONTAINING_RECORD(Current, HEAP_LFH_SUBSEGMENT, ListEntry);
+        if (Subsegment->Active)
+            continue;
+
+        if (!Candidate || Subsegment->FreeState.Depth > Candidate->FreeState.Depth)
+        {
+            Candidate = Subsegment;
+            if (Candidate->FreeState.Depth == Candidate->BlockCount)
+                break;
+        }
+    }
+
+    /* Nearly full subsegments would only bring us back here soon, start a new one */
+    if (!Candidate || Candidate->FreeState.Depth < max(Candidate->BlockCount / 8, 1))
+    {
+        Candidate = RtlpLfhCreateSubsegment(Heap, Lfh, BucketIndex);
+        if (!Candidate)
+        {
+            RtlLeaveHeapLock(Heap->LockVariable);
+            return NULL;
+        }
+    }
+
+    /* Retire the old active subsegment, its blocks come back through frees */
+    Subsegment = Bucket->ActiveSubsegment[Slot];
+    if (Subsegment)
+        Subsegment->Active = FALSE;
+
+    Candidate->Active = TRUE;
+    InterlockedExchangePointer((PVOID volatile *)&Bucket->ActiveSubsegment[Slot], Candidate);
+
+    RtlLeaveHeapLock(Heap->LockVariable);
+
+    return Candidate;
+}
+
+NTSTATUS
+NTAPI
+RtlpLfhEnable(PHEAP Heap)
+{
+    PHEAP_LFH Lfh;
+    ULONG i;
+
+    /* The front end needs the heap lock for refills, and must not hide debug features */
+    if (RtlpGetMode() != UserMode ||
+        (Heap->Flags & (HEAP_NO_SERIALIZE |
+                        HEAP_CREATE_ALIGN_16 |
+                        HEAP_TAIL_CHECKING_ENABLED |
+                        HEAP_FREE_CHECKING_ENABLED)) ||
+        RtlpHeapIsSpecial(Heap->Flags | Heap->ForceFlags) ||
+        Heap->PseudoTagEntries)
+    {
+        DPRINT1("HEAP: Low fragmentation heap is not supported for heap %p (flags %lx)\n", Heap, Heap->Flags);
+        return STATUS_UNSUCCESSFUL;
+    }
+
+    RtlEnterHeapLock(Heap->LockVariable, TRUE);
+
+    if (Heap->FrontEndHeapType == HEAP_FRONT_END_LFH)
+    {
+        RtlLeaveHeapLock(Heap->LockVariable);
+        return STATUS_SUCCESS;
+    }
+
+    Lfh = RtlAllocateHeap(Heap, HEAP_NO_SERIALIZE | HEAP_ZERO_MEMORY, sizeof(HEAP_LFH));
+    if (!Lfh)
+    {
+        RtlLeaveHeapLock(Heap->LockVariable);
+        return STATUS_NO_MEMORY;
+    }
+
+    Lfh->Signature = HEAP_LFH_SIGNATURE;
+    Lfh->Heap = Heap;
+    for (i = 0; i < HEAP_LFH_BUCKETS; i++)
+    {
+        Lfh->Buckets[i].BlockUnits = RtlpLfhBucketUnits(i);
+        InitializeListHead(&Lfh->Buckets[i].SubsegmentList);
+    }
+    ASSERT(Lfh->Buckets[HEAP_LFH_BUCKETS - 1].BlockUnits == HEAP_LFH_MAX_BLOCK_SIZE);
+
+    /* Publish the front end before advertising it */
+    InterlockedExchangePointer(&Heap->FrontEndHeap, Lfh);
+    Heap->FrontEndHeapType = HEAP_FRONT_END_LFH;
+
+    RtlLeaveHeapLock(Heap->LockVariable);
+
+    DPRINT("HEAP: Low fragmentation heap enabled for heap %p\n", Heap);
+    return STATUS_SUCCESS;
+}
+
+PVOID
+NTAPI
+RtlpLfhAllocate(PHEAP Heap, ULONG Flags, SIZE_T Size, SIZE_T Index)
+{
+    PHEAP_LFH Lfh = Heap->FrontEndHeap;
+    PHEAP_LFH_SUBSEGMENT Subsegment;
+    PHEAP_ENTRY Block;
+    ULONG BucketIndex, Slot;
+
+    BucketIndex = RtlpLfhBucketIndex(Index);
+    Slot = RtlpLfhGetSlot();
+
+    for (;;)
+    {
+        Subsegment = Lfh->Buckets[BucketIndex].ActiveSubsegment[Slot];
+        if (Subsegment)
+        {
+            Block = RtlpLfhPopBlock(Subsegment);
+            if (Block)
+                break;
+        }
+
+        /* Out of memory, let the back end deal with it */
+        if (!RtlpLfhRefillSlot(Heap, Lfh, BucketIndex, Slot))
+            return NULL;
+    }
+
+    Block->Flags = HEAP_ENTRY_BUSY;
+    Block->UnusedBytes = (UCHAR)(((SIZE_T)Block->Size << HEAP_ENTRY_SHIFT) - Size);
+
+    if (Flags & HEAP_ZERO_MEMORY)
+        RtlZeroMemory(Block + 1, Size);
+
+    return Block + 1;
+}
+
+BOOLEAN
+NTAPI
+RtlpLfhFree(PHEAP Heap, PHEAP_ENTRY HeapEntry)
+{
+    PHEAP_LFH_SUBSEGMENT Subsegment;
+
+    Subsegment = RtlpLfhGetSubsegment(Heap, HeapEntry);
+    if (!Subsegment)
+    {
+        DPRINT1("HEAP: Trying to free an invalid address %p!\n", HeapEntry + 1);
+        RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
+        return FALSE;
+    }
+
+    HeapEntry->Flags = 0;
+    HeapEntry->UnusedBytes = 0;
+    RtlpLfhPushBlock(Subsegment, HeapEntry);
+
+    return TRUE;
+}
+
+PVOID
+NTAPI
+RtlpLfhReAllocate(PHEAP Heap, ULONG Flags, PVOID Ptr, SIZE_T Size)
+{
+    PHEAP_ENTRY HeapEntry = (PHEAP_ENTRY)Ptr - 1;
+    PHEAP_LFH_SUBSEGMENT Subsegment;
+    SIZE_T OldSize, Index;
+    PVOID NewPtr;
+
+    Subsegment = RtlpLfhGetSubsegment(Heap, HeapEntry);
+    if (!Subsegment || !(HeapEntry->Flags & HEAP_ENTRY_BUSY))
+    {
+        RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
+        return NULL;
+    }
+
+    OldSize = ((SIZE_T)HeapEntry->Size << HEAP_ENTRY_SHIFT) - HeapEntry->UnusedBytes;
+
+    /* Stay in this block as long as the new size falls into the same bucket */
+    Index = ((Size ? Size : 1) + Heap->AlignRound) & Heap->AlignMask;
+    Index >>= HEAP_ENTRY_SHIFT;
+    if (Index <= HEAP_LFH_MAX_BLOCK_SIZE &&
+        RtlpLfhBucketIndex(Index) == Subsegment->BucketIndex)
+    {
+        if ((Flags & HEAP_ZERO_MEMORY) && Size > OldSize)
+            RtlZeroMemory((PCHAR)Ptr + OldSize, Size - OldSize);
+
+        HeapEntry->UnusedBytes = (UCHAR)(((SIZE_T)HeapEntry->Size << HEAP_ENTRY_SHIFT) - Size);
+        return Ptr;
+    }
+
+    if (Flags & HEAP_REALLOC_IN_PLACE_ONLY)
+    {
+        RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_NO_MEMORY);
+        return NULL;
+    }
+
+    /* Move it, possibly to another bucket or to the back end */
+    NewPtr = RtlAllocateHeap(Heap, Flags & ~HEAP_ZERO_MEMORY, Size);
+    if (!NewPtr)
+        return NULL;
+
+    RtlCopyMemory(NewPtr, Ptr, min(OldSize, Size));
+    if ((Flags & HEAP_ZERO_MEMORY) && Size > OldSize)
+        RtlZeroMemory((PCHAR)NewPtr + OldSize, Size - OldSize);
+
+    RtlpLfhFree(Heap, HeapEntry);
+
+    return NewPtr;
+}
+
+BOOLEAN
+NTAPI
+RtlpLfhValidateEntry(PHEAP Heap, PHEAP_ENTRY HeapEntry)
+{
+    if (!(HeapEntry->Flags & HEAP_ENTRY_BUSY))
+        return FALSE;
+
+    return RtlpLfhGetSubsegment(Heap, HeapEntry) != NULL;
+}
+
+/* EOF */
@@ -46,6 +46,9 @@
                              RTL_SRWLOCK_SHARED | RTL_SRWLOCK_CONTENTION_LOCK)
 #define RTL_SRWLOCK_BITS    4
 
+/* Most waits are short, so spin for a while before going to sleep */
+#define RTL_SRWLOCK_SPIN_COUNT  1024
+
 typedef struct _RTLP_SRWLOCK_SHARED_WAKE
 {
     LONG Wake;
@@ -80,6 +83,47 @@ typedef struct _RTLP_SRWLOCK_WAITBLOCK
 } volatile RTLP_SRWLOCK_WAITBLOCK, *PRTLP_SRWLOCK_WAITBLOCK;
 
 
+static VOID
+RtlpSignalWake(IN OUT volatile LONG *Wake)
+{
+    (void)InterlockedOr((PLONG)Wake,
+                        TRUE);
+
+    /* The waiter may be gone already, but waking only uses the address */
+    RtlWakeAddressSingle((PVOID)Wake);
+}
+
+
+static VOID
+RtlpWaitForWake(IN volatile LONG *Wake,
+                IN OUT PULONG SpinCount)
+{
+    LONG NotWoken = 0;
+
+    if (*SpinCount != 0)
+    {
+        (*SpinCount)--;
+        YieldProcessor();
+    }
+    else
+    {
+        /* Stop burning CPU time, sleep until the releasing thread sets Wake */
+        RtlWaitOnAddress(Wake,
+                         &NotWoken,
+                         sizeof(NotWoken),
+                         NULL);
+    }
+}
+
+
+static ULONG
+RtlpGetSpinCount(VOID)
+{
+    /* Spinning is pointless when the owner can't run meanwhile */
+    return (NtCurrentPeb()->NumberOfProcessors > 1) ? RTL_SRWLOCK_SPIN_COUNT : 0;
+}
+
+
 static VOID
 NTAPI
 RtlpReleaseWaitBlockLockExclusive(IN OUT PRTL_SRWLOCK SRWLock,
@@ -127,8 +171,7 @@ RtlpReleaseWaitBlockLockExclusive(IN OUT PRTL_SRWLOCK SRWLock,
 
     if (FirstWaitBlock->Exclusive)
     {
-        (void)InterlockedOr(&FirstWaitBlock->Wake,
-                            TRUE);
+        RtlpSignalWake(&FirstWaitBlock->Wake);
     }
     else
     {
@@ -141,8 +184,7 @@ RtlpReleaseWaitBlockLockExclusive(IN OUT PRTL_SRWLOCK SRWLock,
         {
             NextWake = WakeChain->Next;
 
-            (void)InterlockedOr((PLONG)&WakeChain->Wake,
-                                TRUE);
+            RtlpSignalWake(&WakeChain->Wake);
 
             WakeChain = NextWake;
         } while (WakeChain != NULL);
@@ -180,8 +222,7 @@ RtlpReleaseWaitBlockLockLastShared(IN OUT PRTL_SRWLOCK SRWLock,
 
     (void)InterlockedExchangePointer(&SRWLock->Ptr, (PVOID)NewValue);
 
-    (void)InterlockedOr(&FirstWaitBlock->Wake,
-                        TRUE);
+    RtlpSignalWake(&FirstWaitBlock->Wake);
 }
 
 
@@ -233,6 +274,7 @@ RtlpAcquireSRWLockExclusiveWait(IN OUT PRTL_SRWLOCK SRWLock,
                                 IN PRTLP_SRWLOCK_WAITBLOCK WaitBlock)
 {
     LONG_PTR CurrentValue;
+    ULONG SpinCount = RtlpGetSpinCount();
 
     while (1)
     {
@@ -257,7 +299,8 @@ RtlpAcquireSRWLockExclusiveWait(IN OUT PRTL_SRWLOCK SRWLock,
             }
         }
 
-        YieldProcessor();
+        RtlpWaitForWake(&WaitBlock->Wake,
+                        &SpinCount);
     }
 }
 
@@ -268,11 +311,14 @@ RtlpAcquireSRWLockSharedWait(IN OUT PRTL_SRWLOCK SRWLock,
                              IN OUT PRTLP_SRWLOCK_WAITBLOCK FirstWait  OPTIONAL,
                              IN OUT PRTLP_SRWLOCK_SHARED_WAKE WakeChain)
 {
+    ULONG SpinCount = RtlpGetSpinCount();
+
     if (FirstWait != NULL)
     {
         while (WakeChain->Wake == 0)
         {
-            YieldProcessor();
+            RtlpWaitForWake(&WakeChain->Wake,
+                            &SpinCount);
         }
     }
     else
@@ -306,7 +352,8 @@ RtlpAcquireSRWLockSharedWait(IN OUT PRTL_SRWLOCK SRWLock,
                 }
             }
 
-            YieldProcessor();
+            RtlpWaitForWake(&WakeChain->Wake,
+                            &SpinCount);
         }
     }
 }
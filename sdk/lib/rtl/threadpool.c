@@ -142,8 +142,22 @@ struct timer_queue
  */
 
 #define THREADPOOL_WORKER_TIMEOUT 5000
+#ifdef __REACTOS__
+#define THREADPOOL_MAX_SHARDS 16
+#define THREADPOOL_IO_POLL_MAX 16
+#endif
 #define MAXIMUM_WAITQUEUE_OBJECTS (MAXIMUM_WAIT_OBJECTS - 1)
 
+#ifdef __REACTOS__
+/* one work queue of a threadpool, with its own lock */
+struct threadpool_shard
+{
+    CRITICAL_SECTION        cs;
+    /* Pools of work items, locked via .cs, order matches TP_CALLBACK_PRIORITY - high, normal, low. */
+    struct list             pools[3];
+};
+#endif
+
 /* internal threadpool representation */
 struct threadpool
 {
@@ -151,14 +165,32 @@ struct threadpool
     LONG                    objcount;
     BOOL                    shutdown;
     CRITICAL_SECTION        cs;
+#ifdef __REACTOS__
+    /* Simple callbacks without a cleanup group, queued without taking a lock
+     * and moved to a shard by the first worker that sees them. */
+    SLIST_HEADER            injected;
+    /* Work queues. Every object is queued on its own shard, workers look at
+     * their home shard first and steal from the others when it is empty. */
+    struct threadpool_shard shards[THREADPOOL_MAX_SHARDS];
+    unsigned int            num_shards;
+    LONG                    next_shard;
+    /* Incremented whenever work is queued, idle workers wait on it. */
+    volatile LONG           work_seq;
+#else
     /* Pools of work items, locked via .cs, order matches TP_CALLBACK_PRIORITY - high, normal, low. */
     struct list             pools[3];
     RTL_CONDITION_VARIABLE  update_event;
+#endif
     /* information about worker threads, locked via .cs */
     int                     max_workers;
     int                     min_workers;
     int                     num_workers;
+#ifdef __REACTOS__
+    /* queued and running callbacks, updated with interlocked operations */
+    LONG                    num_busy_workers;
+#else
     int                     num_busy_workers;
+#endif
     HANDLE                  compl_port;
     TP_POOL_STACK_INFORMATION stack_info;
 };
@@ -197,7 +229,12 @@ struct threadpool_object
     /* information about the group, locked via .group->cs */
     struct list             group_entry;
     BOOL                    is_group_member;
+#ifdef __REACTOS__
+    /* information about the pool, locked via .shard->cs */
+    struct threadpool_shard *shard;
+#else
     /* information about the pool, locked via .pool->cs */
+#endif
     struct list             pool_entry;
     RTL_CONDITION_VARIABLE  finished_event;
     RTL_CONDITION_VARIABLE  group_finished_event;
@@ -211,6 +248,10 @@ struct threadpool_object
         struct
         {
             PTP_SIMPLE_CALLBACK callback;
+#ifdef __REACTOS__
+            /* entry in .pool->injected until a worker moves it to a shard */
+            SLIST_ENTRY     inject_entry;
+#endif
         } simple;
         struct
         {
@@ -244,7 +285,11 @@ struct threadpool_object
         struct
         {
             PTP_IO_CALLBACK callback;
+#ifdef __REACTOS__
+            /* locked via .shard->cs */
+#else
             /* locked via .pool->cs */
+#endif
             unsigned int    pending_count, skipped_count, completion_count, completion_max;
             BOOL            shutting_down;
             struct io_completion *completions;
@@ -1377,9 +1422,15 @@ static void CALLBACK waitqueue_thread_proc( void *param )
                 {
                     InterlockedIncrement( &wait->refcount );
                     wait->num_pending_callbacks++;
+#ifdef __REACTOS__
+                    RtlEnterCriticalSection( &wait->shard->cs );
+                    tp_object_execute( wait, TRUE );
+                    RtlLeaveCriticalSection( &wait->shard->cs );
+#else
                     RtlEnterCriticalSection( &wait->pool->cs );
                     tp_object_execute( wait, TRUE );
                     RtlLeaveCriticalSection( &wait->pool->cs );
+#endif
                     tp_object_release( wait );
                 }
                 else tp_object_submit( wait, FALSE );
@@ -1434,9 +1485,15 @@ static void CALLBACK waitqueue_thread_proc( void *param )
                     {
                         wait->u.wait.signaled++;
                         wait->num_pending_callbacks++;
+#ifdef __REACTOS__
+                        RtlEnterCriticalSection( &wait->shard->cs );
+                        tp_object_execute( wait, TRUE );
+                        RtlLeaveCriticalSection( &wait->shard->cs );
+#else
                         RtlEnterCriticalSection( &wait->pool->cs );
                         tp_object_execute( wait, TRUE );
                         RtlLeaveCriticalSection( &wait->pool->cs );
+#endif
                     }
                     else tp_object_submit( wait, TRUE );
                 }
@@ -1612,21 +1669,130 @@ static void tp_waitqueue_unlock( struct threadpool_object *wait )
     RtlLeaveCriticalSection( &waitqueue.cs );
 }
 
+#ifdef __REACTOS__
+/***********************************************************************
+ *           tp_ioqueue_dispatch    (internal)
+ *
+ * Hands an I/O completion packet to its object, ioqueue.cs has to be
+ * held.
+ */
+static void tp_ioqueue_dispatch( struct threadpool_object *io, ULONG_PTR value, const IO_STATUS_BLOCK *iosb )
+{
+    struct io_completion *completion;
+    BOOL destroy = FALSE;
+
+    TRACE( "io %p, iosb.Status %#lx.\n", io, iosb->Status );
+
+    if (io->shutdown || io->u.io.shutting_down)
+    {
+        RtlEnterCriticalSection( &io->shard->cs );
+        if (!io->u.io.pending_count)
+        {
+            if (io->u.io.skipped_count)
+                --io->u.io.skipped_count;
+
+            if (io->u.io.skipped_count)
+            {
+                RtlLeaveCriticalSection( &io->shard->cs );
+                return;
+            }
+
+            destroy = TRUE;
+        }
+        RtlLeaveCriticalSection( &io->shard->cs );
+    }
+
+    if (destroy)
+    {
+        --ioqueue.objcount;
+        TRACE( "Releasing io %p.\n", io );
+        io->shutdown = TRUE;
+        tp_object_release( io );
+        return;
+    }
+
+    RtlEnterCriticalSection( &io->shard->cs );
+
+    TRACE( "pending_count %u.\n", io->u.io.pending_count );
+
+    if (io->u.io.pending_count)
+    {
+        --io->u.io.pending_count;
+        if (!array_reserve((void **)&io->u.io.completions, &io->u.io.completion_max,
+                io->u.io.completion_count + 1, sizeof(*io->u.io.completions)))
+        {
+            ERR( "Failed to allocate memory.\n" );
+            RtlLeaveCriticalSection( &io->shard->cs );
+            return;
+        }
+
+        completion = &io->u.io.completions[io->u.io.completion_count++];
+        completion->iosb = *iosb;
+        completion->cvalue = value;
+
+        tp_object_submit( io, FALSE );
+    }
+    RtlLeaveCriticalSection( &io->shard->cs );
+}
+
+/***********************************************************************
+ *           tp_ioqueue_poll    (internal)
+ *
+ * Lets a worker thread that ran out of work pick up completion packets
+ * that are already queued, so that under load I/O callbacks are run by
+ * the workers without a round trip through the I/O completion thread.
+ * Returns TRUE if at least one packet was dispatched.
+ */
+static BOOL tp_ioqueue_poll( void )
+{
+    LARGE_INTEGER timeout = {.QuadPart = 0};
+    IO_STATUS_BLOCK iosb;
+    PVOID key, value;
+    unsigned int count;
+
+    if (!ioqueue.objcount || !ioqueue.port)
+        return FALSE;
+
+    for (count = 0; count < THREADPOOL_IO_POLL_MAX; count++)
+    {
+        if (NtRemoveIoCompletion( ioqueue.port, &key, &value, &iosb, &timeout ) != STATUS_SUCCESS)
+            break;
+
+        if (!key)
+        {
+            /* Wakeup for the I/O completion thread, give it back. */
+            NtSetIoCompletion( ioqueue.port, 0, 0, STATUS_SUCCESS, 0 );
+            break;
+        }
+
+        RtlEnterCriticalSection( &ioqueue.cs );
+        tp_ioqueue_dispatch( (struct threadpool_object *)key, (ULONG_PTR)value, &iosb );
+        RtlLeaveCriticalSection( &ioqueue.cs );
+    }
+
+    return count != 0;
+}
+#endif
+
 #ifdef __REACTOS__
 ULONG NTAPI ioqueue_thread_proc(PVOID param )
 #else
 static void CALLBACK ioqueue_thread_proc( void *param )
 #endif
 {
+#ifndef __REACTOS__
     struct io_completion *completion;
     struct threadpool_object *io;
+#endif
     IO_STATUS_BLOCK iosb;
 #ifdef __REACTOS__
     PVOID key, value;
 #else
     ULONG_PTR key, value;
 #endif
+#ifndef __REACTOS__
     BOOL destroy, skip;
+#endif
     NTSTATUS status;
 
     TRACE( "starting I/O completion thread\n" );
@@ -1641,6 +1807,10 @@ static void CALLBACK ioqueue_thread_proc( void *param )
             ERR("NtRemoveIoCompletion failed, status %#lx.\n", status);
         RtlEnterCriticalSection( &ioqueue.cs );
 
+#ifdef __REACTOS__
+        if (key)
+            tp_ioqueue_dispatch( (struct threadpool_object *)key, (ULONG_PTR)value, &iosb );
+#else
         destroy = skip = FALSE;
         io = (struct threadpool_object *)key;
 
@@ -1689,16 +1859,13 @@ static void CALLBACK ioqueue_thread_proc( void *param )
 
                 completion = &io->u.io.completions[io->u.io.completion_count++];
                 completion->iosb = iosb;
-#ifdef __REACTOS__
-                completion->cvalue = (ULONG_PTR)value;
-#else
                 completion->cvalue = value;
-#endif
 
                 tp_object_submit( io, FALSE );
             }
             RtlLeaveCriticalSection( &io->pool->cs );
         }
+#endif
 
         if (!ioqueue.objcount)
         {
@@ -1790,7 +1957,11 @@ static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
     IMAGE_NT_HEADERS *nt = RtlImageNtHeader( NtCurrentTeb()->Peb->ImageBaseAddress );
 #endif
     struct threadpool *pool;
+#ifdef __REACTOS__
+    unsigned int i, j;
+#else
     unsigned int i;
+#endif
 
     pool = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*pool) );
     if (!pool)
@@ -1808,9 +1979,31 @@ static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
     pool->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": threadpool.cs");
 #endif
 
+#ifdef __REACTOS__
+    RtlInitializeSListHead( &pool->injected );
+
+    /* One queue per processor, so that submissions from different threads
+     * and the workers picking them up rarely meet on the same lock. */
+    pool->num_shards = min( NtCurrentPeb()->NumberOfProcessors, THREADPOOL_MAX_SHARDS );
+    if (!pool->num_shards)
+        pool->num_shards = 1;
+
+    for (i = 0; i < pool->num_shards; ++i)
+    {
+        struct threadpool_shard *shard = &pool->shards[i];
+
+        RtlInitializeCriticalSection( &shard->cs );
+
+        for (j = 0; j < ARRAY_SIZE(shard->pools); ++j)
+            list_init( &shard->pools[j] );
+    }
+    pool->next_shard              = 0;
+    pool->work_seq                = 0;
+#else
     for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
         list_init( &pool->pools[i] );
     RtlInitializeConditionVariable( &pool->update_event );
+#endif
 
     pool->max_workers             = 500;
     pool->min_workers             = 0;
@@ -1837,7 +2030,12 @@ static void tp_threadpool_shutdown( struct threadpool *pool )
     assert( pool != default_threadpool );
 
     pool->shutdown = TRUE;
+#ifdef __REACTOS__
+    InterlockedIncrement( &pool->work_seq );
+    RtlWakeAddressAll( (void *)&pool->work_seq );
+#else
     RtlWakeAllConditionVariable( &pool->update_event );
+#endif
 }
 
 /***********************************************************************
@@ -1847,7 +2045,11 @@ static void tp_threadpool_shutdown( struct threadpool *pool )
  */
 static BOOL tp_threadpool_release( struct threadpool *pool )
 {
+#ifdef __REACTOS__
+    unsigned int i, j;
+#else
     unsigned int i;
+#endif
 
     if (InterlockedDecrement( &pool->refcount ))
         return FALSE;
@@ -1856,8 +2058,20 @@ static BOOL tp_threadpool_release( struct threadpool *pool )
 
     assert( pool->shutdown );
     assert( !pool->objcount );
+#ifdef __REACTOS__
+    assert( !RtlFirstEntrySList( &pool->injected ) );
+    for (i = 0; i < pool->num_shards; ++i)
+    {
+        struct threadpool_shard *shard = &pool->shards[i];
+
+        for (j = 0; j < ARRAY_SIZE(shard->pools); ++j)
+            assert( list_empty( &shard->pools[j] ) );
+        RtlDeleteCriticalSection( &shard->cs );
+    }
+#else
     for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
         assert( list_empty( &pool->pools[i] ) );
+#endif
 #ifndef __REACTOS__
     pool->cs.DebugInfo->Spare[0] = 0;
 #endif
@@ -2035,6 +2249,9 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
     object->shutdown                = FALSE;
 
     object->pool                    = pool;
+#ifdef __REACTOS__
+    object->shard                   = &pool->shards[(ULONG)InterlockedIncrement( &pool->next_shard ) % pool->num_shards];
+#endif
     object->group                   = NULL;
     object->userdata                = userdata;
     object->group_cancel_callback   = NULL;
@@ -2070,7 +2287,11 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
             TP_CALLBACK_ENVIRON_V3 *environment_v3 = (TP_CALLBACK_ENVIRON_V3 *)environment;
 
             object->priority = environment_v3->CallbackPriority;
+#ifdef __REACTOS__
+            assert( object->priority < ARRAY_SIZE(pool->shards[0].pools) );
+#else
             assert( object->priority < ARRAY_SIZE(pool->pools) );
+#endif
         }
 #endif
         if (environment->ActivationContext)
@@ -2109,10 +2330,60 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
 
 static void tp_object_prio_queue( struct threadpool_object *object )
 {
+#ifdef __REACTOS__
+    InterlockedIncrement( &object->pool->num_busy_workers );
+    list_add_tail( &object->shard->pools[object->priority], &object->pool_entry );
+#else
     ++object->pool->num_busy_workers;
     list_add_tail( &object->pool->pools[object->priority], &object->pool_entry );
+#endif
+}
+
+#ifdef __REACTOS__
+/***********************************************************************
+ *           tp_threadpool_grow    (internal)
+ *
+ * Starts a new worker thread if there is more queued and running work
+ * than worker threads. The queued work is already counted as busy here.
+ * The unlocked check keeps the common case, enough workers, away from
+ * the pool lock.
+ */
+static NTSTATUS tp_threadpool_grow( struct threadpool *pool )
+{
+    NTSTATUS status = STATUS_UNSUCCESSFUL;
+
+    if (pool->num_busy_workers > pool->num_workers &&
+        pool->num_workers < pool->max_workers)
+    {
+        RtlEnterCriticalSection( &pool->cs );
+        if (pool->num_busy_workers > pool->num_workers &&
+            pool->num_workers < pool->max_workers)
+            status = tp_new_worker_thread( pool );
+        RtlLeaveCriticalSection( &pool->cs );
+    }
+
+    return status;
 }
 
+/***********************************************************************
+ *           tp_threadpool_signal    (internal)
+ *
+ * Makes sure newly queued work is picked up, either by a new worker
+ * thread or by waking up an idle one.
+ */
+static void tp_threadpool_signal( struct threadpool *pool )
+{
+    /* Bump the sequence before counting the workers. An idle worker
+     * leaving the pool does it the other way around, so either we see
+     * it gone or it sees the new work (see threadpool_worker_proc). */
+    InterlockedIncrement( &pool->work_seq );
+
+    /* No new thread started - wake up one existing thread. */
+    if (tp_threadpool_grow( pool ) != STATUS_SUCCESS)
+        RtlWakeAddressSingle( (void *)&pool->work_seq );
+}
+#endif
+
 /***********************************************************************
  *           tp_object_submit    (internal)
  *
@@ -2121,6 +2392,40 @@ static void tp_object_prio_queue( struct threadpool_object *object )
  */
 static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 {
+#ifdef __REACTOS__
+    struct threadpool *pool = object->pool;
+
+    assert( !object->shutdown );
+    assert( !pool->shutdown );
+
+    if (object->type == TP_OBJECT_TYPE_SIMPLE && !object->group)
+    {
+        /* Simple callbacks outside of a cleanup group can neither be
+         * cancelled nor waited for, and nobody else knows about them yet,
+         * so they are queued without taking a lock. */
+        InterlockedIncrement( &object->refcount );
+        object->num_pending_callbacks++;
+        InterlockedIncrement( &pool->num_busy_workers );
+        RtlInterlockedPushEntrySList( &pool->injected, &object->u.simple.inject_entry );
+    }
+    else
+    {
+        RtlEnterCriticalSection( &object->shard->cs );
+
+        /* Queue work item and increment refcount. */
+        InterlockedIncrement( &object->refcount );
+        if (!object->num_pending_callbacks++)
+            tp_object_prio_queue( object );
+
+        /* Count how often the object was signaled. */
+        if (object->type == TP_OBJECT_TYPE_WAIT && signaled)
+            object->u.wait.signaled++;
+
+        RtlLeaveCriticalSection( &object->shard->cs );
+    }
+
+    tp_threadpool_signal( pool );
+#else
     struct threadpool *pool = object->pool;
     NTSTATUS status = STATUS_UNSUCCESSFUL;
 
@@ -2151,6 +2456,7 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
     }
 
     RtlLeaveCriticalSection( &pool->cs );
+#endif
 }
 
 /***********************************************************************
@@ -2160,10 +2466,18 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
  */
 static void tp_object_cancel( struct threadpool_object *object )
 {
+#ifdef __REACTOS__
+    struct threadpool_shard *shard = object->shard;
+#else
     struct threadpool *pool = object->pool;
+#endif
     LONG pending_callbacks = 0;
 
+#ifdef __REACTOS__
+    RtlEnterCriticalSection( &shard->cs );
+#else
     RtlEnterCriticalSection( &pool->cs );
+#endif
     if (object->num_pending_callbacks)
     {
         pending_callbacks = object->num_pending_callbacks;
@@ -2178,7 +2492,11 @@ static void tp_object_cancel( struct threadpool_object *object )
         object->u.io.skipped_count += object->u.io.pending_count;
         object->u.io.pending_count = 0;
     }
+#ifdef __REACTOS__
+    RtlLeaveCriticalSection( &shard->cs );
+#else
     RtlLeaveCriticalSection( &pool->cs );
+#endif
 
     while (pending_callbacks--)
         tp_object_release( object );
@@ -2205,6 +2523,19 @@ static BOOL object_is_finished( struct threadpool_object *object, BOOL group )
  */
 static void tp_object_wait( struct threadpool_object *object, BOOL group_wait )
 {
+#ifdef __REACTOS__
+    struct threadpool_shard *shard = object->shard;
+
+    RtlEnterCriticalSection( &shard->cs );
+    while (!object_is_finished( object, group_wait ))
+    {
+        if (group_wait)
+            RtlSleepConditionVariableCS( &object->group_finished_event, &shard->cs, NULL );
+        else
+            RtlSleepConditionVariableCS( &object->finished_event, &shard->cs, NULL );
+    }
+    RtlLeaveCriticalSection( &shard->cs );
+#else
     struct threadpool *pool = object->pool;
 
     RtlEnterCriticalSection( &pool->cs );
@@ -2216,6 +2547,7 @@ static void tp_object_wait( struct threadpool_object *object, BOOL group_wait )
             RtlSleepConditionVariableCS( &object->finished_event, &pool->cs, NULL );
     }
     RtlLeaveCriticalSection( &pool->cs );
+#endif
 }
 
 static void tp_ioqueue_unlock( struct threadpool_object *io )
@@ -2292,6 +2624,121 @@ static BOOL tp_object_release( struct threadpool_object *object )
     return TRUE;
 }
 
+#ifdef __REACTOS__
+static struct list *threadpool_get_next_item( const struct threadpool_shard *shard )
+{
+    struct list *ptr;
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(shard->pools); ++i)
+    {
+        if ((ptr = list_head( &shard->pools[i] )))
+            break;
+    }
+
+    return ptr;
+}
+
+/***********************************************************************
+ *           tp_threadpool_has_work    (internal)
+ *
+ * Checks without locking whether any work is queued.
+ */
+static BOOL tp_threadpool_has_work( struct threadpool *pool )
+{
+    unsigned int i;
+
+    if (RtlFirstEntrySList( &pool->injected ))
+        return TRUE;
+
+    for (i = 0; i < pool->num_shards; ++i)
+    {
+        if (threadpool_get_next_item( &pool->shards[i] ))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/***********************************************************************
+ *           tp_threadpool_drain_injected    (internal)
+ *
+ * Moves the simple callbacks queued without a lock to the given shard.
+ */
+static void tp_threadpool_drain_injected( struct threadpool *pool, struct threadpool_shard *shard )
+{
+    struct threadpool_object *object;
+    SLIST_ENTRY *entry, *next, *head = NULL;
+
+    if (!RtlFirstEntrySList( &pool->injected ))
+        return;
+
+    /* The list is LIFO, reverse it to keep the submission order. */
+    entry = RtlInterlockedFlushSList( &pool->injected );
+    while (entry)
+    {
+        next = entry->Next;
+        entry->Next = head;
+        head = entry;
+        entry = next;
+    }
+
+    RtlEnterCriticalSection( &shard->cs );
+    for (entry = head; entry; entry = next)
+    {
+        next = entry->Next;
+        object = CONTAINING_RECORD( entry, struct threadpool_object, u.simple.inject_entry );
+        object->shard = shard;
+        list_add_tail( &shard->pools[object->priority], &object->pool_entry );
+    }
+    RtlLeaveCriticalSection( &shard->cs );
+}
+
+/***********************************************************************
+ *           tp_threadpool_get_next_object    (internal)
+ *
+ * Dequeues the next work item for a worker thread. The worker looks at
+ * its home shard first and steals from the other shards when that one
+ * is empty. The object is returned with object->shard->cs held.
+ */
+static struct threadpool_object *tp_threadpool_get_next_object( struct threadpool *pool,
+                                                                struct threadpool_shard *home )
+{
+    unsigned int i, start = home - pool->shards;
+    struct threadpool_object *object;
+    struct threadpool_shard *shard;
+    struct list *ptr;
+
+    tp_threadpool_drain_injected( pool, home );
+
+    for (i = 0; i < pool->num_shards; ++i)
+    {
+        shard = &pool->shards[(start + i) % pool->num_shards];
+
+        /* Skip empty shards without taking their lock. */
+        if (!threadpool_get_next_item( shard ))
+            continue;
+
+        RtlEnterCriticalSection( &shard->cs );
+        if ((ptr = threadpool_get_next_item( shard )))
+        {
+            object = LIST_ENTRY( ptr, struct threadpool_object, pool_entry );
+            assert( object->num_pending_callbacks > 0 );
+
+            /* If further pending callbacks are queued, move the work item to
+             * the end of the pool list. Otherwise remove it from the pool. */
+            list_remove( &object->pool_entry );
+            if (object->num_pending_callbacks > 1)
+                tp_object_prio_queue( object );
+
+            return object;
+        }
+        RtlLeaveCriticalSection( &shard->cs );
+    }
+
+    return NULL;
+}
+#else
 static struct list *threadpool_get_next_item( const struct threadpool *pool )
 {
     struct list *ptr;
@@ -2305,19 +2752,33 @@ static struct list *threadpool_get_next_item( const struct threadpool *pool )
 
     return ptr;
 }
+#endif
 
+#ifdef __REACTOS__
+/***********************************************************************
+ *           tp_object_execute    (internal)
+ *
+ * Executes a threadpool object callback, object->shard->cs has to be
+ * held.
+ */
+#else
 /***********************************************************************
  *           tp_object_execute    (internal)
  *
  * Executes a threadpool object callback, object->pool->cs has to be
  * held.
  */
+#endif
 static void tp_object_execute( struct threadpool_object *object, BOOL wait_thread )
 {
     TP_CALLBACK_INSTANCE *callback_instance;
     struct threadpool_instance instance;
     struct io_completion completion;
+#ifdef __REACTOS__
+    struct threadpool_shard *shard = object->shard;
+#else
     struct threadpool *pool = object->pool;
+#endif
     TP_WAIT_RESULT wait_result = 0;
     NTSTATUS status;
 
@@ -2338,7 +2799,11 @@ static void tp_object_execute( struct threadpool_object *object, BOOL wait_threa
     /* Leave critical section and do the actual callback. */
     object->num_associated_callbacks++;
     object->num_running_callbacks++;
+#ifdef __REACTOS__
+    RtlLeaveCriticalSection( &shard->cs );
+#else
     RtlLeaveCriticalSection( &pool->cs );
+#endif
     if (wait_thread) RtlLeaveCriticalSection( &waitqueue.cs );
 
     /* Initialize threadpool instance struct. */
@@ -2444,7 +2909,11 @@ static void tp_object_execute( struct threadpool_object *object, BOOL wait_threa
 
 skip_cleanup:
     if (wait_thread) RtlEnterCriticalSection( &waitqueue.cs );
+#ifdef __REACTOS__
+    RtlEnterCriticalSection( &shard->cs );
+#else
     RtlEnterCriticalSection( &pool->cs );
+#endif
 
     /* Simple callbacks are automatically shutdown after execution. */
     if (object->type == TP_OBJECT_TYPE_SIMPLE)
@@ -2474,6 +2943,73 @@ ULONG NTAPI threadpool_worker_proc(PVOID param )
 static void CALLBACK threadpool_worker_proc( void *param )
 #endif
 {
+#ifdef __REACTOS__
+    struct threadpool *pool = param;
+    struct threadpool_object *object;
+    struct threadpool_shard *home;
+    LARGE_INTEGER timeout;
+    LONG seq;
+
+    TRACE( "starting worker thread for pool %p\n", pool );
+    set_thread_name(L"wine_threadpool_worker");
+
+    home = &pool->shards[(ULONG)InterlockedIncrement( &pool->next_shard ) % pool->num_shards];
+
+    for (;;)
+    {
+        /* Anything queued after this point changes the sequence, so the
+         * wait below returns right away instead of missing it. */
+        seq = pool->work_seq;
+
+        if ((object = tp_threadpool_get_next_object( pool, home )))
+        {
+            tp_object_execute( object, FALSE );
+            RtlLeaveCriticalSection( &object->shard->cs );
+
+            assert(pool->num_busy_workers);
+            InterlockedDecrement( &pool->num_busy_workers );
+
+            tp_object_release( object );
+            continue;
+        }
+
+        /* Run I/O completions that are already queued on this thread. */
+        if (tp_ioqueue_poll())
+            continue;
+
+        /* Shutdown worker thread if requested. */
+        if (pool->shutdown)
+        {
+            RtlEnterCriticalSection( &pool->cs );
+            break;
+        }
+
+        /* Wait for new tasks or until the timeout expires. A thread only terminates
+         * when no new tasks are available, and the number of threads can be
+         * decreased without violating the min_workers limit. An exception is when
+         * min_workers == 0, then objcount is used to detect if the last thread
+         * can be terminated. */
+        timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
+        if (RtlWaitOnAddress( &pool->work_seq, &seq, sizeof(seq), &timeout ) == STATUS_TIMEOUT)
+        {
+            RtlEnterCriticalSection( &pool->cs );
+            if (!tp_threadpool_has_work( pool ) && (pool->num_workers > max( pool->min_workers, 1 ) ||
+                (!pool->min_workers && !pool->objcount)))
+            {
+                break;
+            }
+            RtlLeaveCriticalSection( &pool->cs );
+        }
+    }
+    pool->num_workers--;
+    RtlLeaveCriticalSection( &pool->cs );
+
+    /* Work queued while we decided to exit was queued under the shard lock,
+     * and its submitter may have counted us as an idle worker and only sent
+     * a wakeup nobody waits for anymore. Hand it to a new thread then. */
+    if (!pool->shutdown && InterlockedCompareExchange( &pool->work_seq, seq, seq ) != seq)
+        tp_threadpool_grow( pool );
+#else
     struct threadpool *pool = param;
     LARGE_INTEGER timeout;
     struct list *ptr;
@@ -2522,6 +3058,7 @@ static void CALLBACK threadpool_worker_proc( void *param )
     }
     pool->num_workers--;
     RtlLeaveCriticalSection( &pool->cs );
+#endif
 
     TRACE( "terminating worker thread for pool %p\n", pool );
     tp_threadpool_release( pool );
@@ -2724,7 +3261,11 @@ void WINAPI TpCancelAsyncIoOperation( TP_IO *io )
 
     TRACE( "%p\n", io );
 
+#ifdef __REACTOS__
+    RtlEnterCriticalSection( &this->shard->cs );
+#else
     RtlEnterCriticalSection( &this->pool->cs );
+#endif
 
     TRACE("pending_count %u.\n", this->u.io.pending_count);
 
@@ -2734,7 +3275,11 @@ void WINAPI TpCancelAsyncIoOperation( TP_IO *io )
     if (object_is_finished( this, FALSE ))
         RtlWakeAllConditionVariable( &this->finished_event );
 
+#ifdef __REACTOS__
+    RtlLeaveCriticalSection( &this->shard->cs );
+#else
     RtlLeaveCriticalSection( &this->pool->cs );
+#endif
 }
 
 /***********************************************************************
@@ -2854,7 +3399,11 @@ VOID WINAPI TpDisassociateCallback( TP_CALLBACK_INSTANCE *instance )
 {
     struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
     struct threadpool_object *object = this->object;
+#ifdef __REACTOS__
+    struct threadpool_shard *shard;
+#else
     struct threadpool *pool;
+#endif
 
     TRACE( "%p\n", instance );
 
@@ -2867,14 +3416,23 @@ VOID WINAPI TpDisassociateCallback( TP_CALLBACK_INSTANCE *instance )
     if (!this->associated)
         return;
 
+#ifdef __REACTOS__
+    shard = object->shard;
+    RtlEnterCriticalSection( &shard->cs );
+#else
     pool = object->pool;
     RtlEnterCriticalSection( &pool->cs );
+#endif
 
     object->num_associated_callbacks--;
     if (object_is_finished( object, FALSE ))
         RtlWakeAllConditionVariable( &object->finished_event );
 
+#ifdef __REACTOS__
+    RtlLeaveCriticalSection( &shard->cs );
+#else
     RtlLeaveCriticalSection( &pool->cs );
+#endif
     this->associated = FALSE;
 }
 
@@ -2998,10 +3556,18 @@ void WINAPI TpReleaseIoCompletion( TP_IO *io )
 
     TRACE( "%p\n", io );
 
+#ifdef __REACTOS__
+    RtlEnterCriticalSection( &this->shard->cs );
+#else
     RtlEnterCriticalSection( &this->pool->cs );
+#endif
     this->u.io.shutting_down = TRUE;
     can_destroy = !this->u.io.pending_count && !this->u.io.skipped_count;
+#ifdef __REACTOS__
+    RtlLeaveCriticalSection( &this->shard->cs );
+#else
     RtlLeaveCriticalSection( &this->pool->cs );
+#endif
 
     if (can_destroy)
     {
@@ -3279,11 +3845,19 @@ void WINAPI TpStartAsyncIoOperation( TP_IO *io )
 
     TRACE( "%p\n", io );
 
+#ifdef __REACTOS__
+    RtlEnterCriticalSection( &this->shard->cs );
+#else
     RtlEnterCriticalSection( &this->pool->cs );
+#endif
 
     this->u.io.pending_count++;
 
+#ifdef __REACTOS__
+    RtlLeaveCriticalSection( &this->shard->cs );
+#else
     RtlLeaveCriticalSection( &this->pool->cs );
+#endif
 }
 
 /***********************************************************************
@@ -3475,11 +4049,19 @@ NTSTATUS WINAPI RtlDeregisterWaitEx( HANDLE handle, HANDLE event )
         object->completed_event = event;
     }
 
+#ifdef __REACTOS__
+    RtlEnterCriticalSection( &object->shard->cs );
+#else
     RtlEnterCriticalSection( &object->pool->cs );
+#endif
     if (object->num_pending_callbacks + object->num_running_callbacks
         + object->num_associated_callbacks) status = STATUS_PENDING;
     else status = STATUS_SUCCESS;
+#ifdef __REACTOS__
+    RtlLeaveCriticalSection( &object->shard->cs );
+#else
     RtlLeaveCriticalSection( &object->pool->cs );
+#endif
 
     TpReleaseWait( (TP_WAIT *)object );
     return status;
@@ -0,0 +1,289 @@
+/*
+ * PROJECT:     ReactOS system libraries
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Address based waiting (WaitOnAddress)
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+/*
+ * Waiters are kept in a small hash table of wait buckets, keyed by the
+ * address they wait on, and sleep on a keyed event with their wait block as
+ * the key. The bucket lock is only held while the lists are updated, never
+ * while sleeping or releasing. Waking an address nobody waits on costs a
+ * memory barrier and a read, which is what lets the SRW locks and condition
+ * variables use it on every release.
+ */
+
+/* INCLUDES ******************************************************************/
+
+#include <rtl_vista.h>
+
+#define NDEBUG
+#include <debug.h>
+
+/* INTERNAL TYPES ************************************************************/
+
+#define RTLP_WAIT_BUCKET_SHIFT  7
+#define RTLP_WAIT_BUCKET_COUNT  (1 << RTLP_WAIT_BUCKET_SHIFT)
+
+typedef struct _RTLP_ADDRESS_WAIT_BLOCK
+{
+    LIST_ENTRY ListEntry;
+    volatile VOID *Address;
+
+    /* Set under the bucket lock by the waker that took the block off the
+       list. From then on, the waker owes the waiter a keyed event release. */
+    BOOLEAN Signaled;
+    struct _RTLP_ADDRESS_WAIT_BLOCK *NextWake;
+} RTLP_ADDRESS_WAIT_BLOCK, *PRTLP_ADDRESS_WAIT_BLOCK;
+
+typedef struct DECLSPEC_CACHEALIGN _RTLP_ADDRESS_WAIT_BUCKET
+{
+    volatile LONG Lock;
+
+    /* Number of blocks on the list, readable without the lock */
+    volatile LONG WaitCount;
+
+    /* Lazily initialized under the lock */
+    LIST_ENTRY WaitList;
+} RTLP_ADDRESS_WAIT_BUCKET, *PRTLP_ADDRESS_WAIT_BUCKET;
+
+/* GLOBALS *******************************************************************/
+
+static RTLP_ADDRESS_WAIT_BUCKET RtlpAddressWaitBuckets[RTLP_WAIT_BUCKET_COUNT];
+
+/* Created once, before any thread can wait, and never switched while somebody
+   waits: a waiter and its waker must use the same keyed event. If creating it
+   fails, the process-wide keyed event (NULL) is used for good. */
+static HANDLE RtlpWaitOnAddressKeyedEvent = NULL;
+
+/* INTERNAL FUNCTIONS ********************************************************/
+
+FORCEINLINE
+PRTLP_ADDRESS_WAIT_BUCKET
+RtlpGetAddressWaitBucket(
+    _In_ volatile VOID *Address)
+{
+    ULONG Hash;
+
+    /* Fibonacci hashing, so that neighbouring addresses spread out */
+    Hash = (ULONG)((ULONG_PTR)Address >> 2) * 0x9E3779B1UL;
+    return &RtlpAddressWaitBuckets[Hash >> (32 - RTLP_WAIT_BUCKET_SHIFT)];
+}
+
+FORCEINLINE
+VOID
+RtlpAcquireAddressWaitBucket(
+    _Inout_ PRTLP_ADDRESS_WAIT_BUCKET Bucket)
+{
+    while (InterlockedExchange(&Bucket->Lock, 1) != 0)
+    {
+        while (Bucket->Lock != 0)
+        {
+            YieldProcessor();
+        }
+    }
+
+    if (Bucket->WaitList.Flink == NULL)
+        InitializeListHead(&Bucket->WaitList);
+}
+
+FORCEINLINE
+VOID
+RtlpReleaseAddressWaitBucket(
+    _Inout_ PRTLP_ADDRESS_WAIT_BUCKET Bucket)
+{
+    InterlockedExchange(&Bucket->Lock, 0);
+}
+
+static
+BOOLEAN
+RtlpAddressValueMatches(
+    _In_ volatile VOID *Address,
+    _In_ PVOID CompareAddress,
+    _In_ SIZE_T AddressSize)
+{
+    switch (AddressSize)
+    {
+        case 1:
+            return *(volatile UCHAR *)Address == *(PUCHAR)CompareAddress;
+        case 2:
+            return *(volatile USHORT *)Address == *(PUSHORT)CompareAddress;
+        case 4:
+            return *(volatile ULONG *)Address == *(PULONG)CompareAddress;
+        default:
+            ASSERT(AddressSize == 8);
+            return *(volatile ULONGLONG *)Address == *(PULONGLONG)CompareAddress;
+    }
+}
+
+static
+VOID
+RtlpWakeAddress(
+    _In_ PVOID Address,
+    _In_ BOOLEAN WakeAll)
+{
+    PRTLP_ADDRESS_WAIT_BUCKET Bucket;
+    PRTLP_ADDRESS_WAIT_BLOCK WaitBlock, WakeList, *WakeTail;
+    PLIST_ENTRY ListEntry;
+
+    Bucket = RtlpGetAddressWaitBucket(Address);
+
+    /* Pairs with the interlocked increment in RtlWaitOnAddress: either the
+       waiter sees the caller's new value, or we see the waiter. */
+    MemoryBarrier();
+    if (Bucket->WaitCount == 0)
+        return;
+
+    WakeList = NULL;
+    WakeTail = &WakeList;
+
+    RtlpAcquireAddressWaitBucket(Bucket);
+
+    ListEntry = Bucket->WaitList.Flink;
+    while (ListEntry != &Bucket->WaitList)
+    {
+        WaitBlock = CONTAINING_RECORD(ListEntry, RTLP_ADDRESS_WAIT_BLOCK, ListEntry);
+        ListEntry = ListEntry->Flink;
+
+        if (WaitBlock->Address != Address)
+            continue;
+
+        RemoveEntryList(&WaitBlock->ListEntry);
+        InterlockedDecrement(&Bucket->WaitCount);
+        WaitBlock->Signaled = TRUE;
+
+        /* Wake in FIFO order */
+        WaitBlock->NextWake = NULL;
+        *WakeTail = WaitBlock;
+        WakeTail = &WaitBlock->NextWake;
+
+        if (!WakeAll)
+            break;
+    }
+
+    RtlpReleaseAddressWaitBucket(Bucket);
+
+    while (WakeList != NULL)
+    {
+        /* The block lives on the waiter's stack and goes away once released */
+        WaitBlock = WakeList;
+        WakeList = WaitBlock->NextWake;
+
+        NtReleaseKeyedEvent(RtlpWaitOnAddressKeyedEvent, WaitBlock, FALSE, NULL);
+    }
+}
+
+VOID
+NTAPI
+RtlpInitializeKeyedEvent(VOID)
+{
+    HANDLE KeyedEvent;
+#if DBG
+    ULONG i;
+
+    /* Nobody may be waiting yet, or they would never see a release */
+    for (i = 0; i < RTLP_WAIT_BUCKET_COUNT; i++)
+        ASSERT(RtlpAddressWaitBuckets[i].WaitCount == 0);
+#endif
+
+    ASSERT(RtlpWaitOnAddressKeyedEvent == NULL);
+
+    if (NT_SUCCESS(NtCreateKeyedEvent(&KeyedEvent, EVENT_ALL_ACCESS, NULL, 0)))
+        RtlpWaitOnAddressKeyedEvent = KeyedEvent;
+}
+
+VOID
+NTAPI
+RtlpCloseKeyedEvent(VOID)
+{
+    if (RtlpWaitOnAddressKeyedEvent == NULL)
+        return;
+
+    NtClose(RtlpWaitOnAddressKeyedEvent);
+    RtlpWaitOnAddressKeyedEvent = NULL;
+}
+
+/* EXPORTED FUNCTIONS ********************************************************/
+
+NTSTATUS
+NTAPI
+RtlWaitOnAddress(
+    _In_ volatile VOID *Address,
+    _In_ PVOID CompareAddress,
+    _In_ SIZE_T AddressSize,
+    _In_opt_ PLARGE_INTEGER Timeout)
+{
+    PRTLP_ADDRESS_WAIT_BUCKET Bucket;
+    RTLP_ADDRESS_WAIT_BLOCK WaitBlock;
+    NTSTATUS Status;
+
+    if ((AddressSize != 1 && AddressSize != 2 && AddressSize != 4 && AddressSize != 8) ||
+        ((ULONG_PTR)Address & (AddressSize - 1)) != 0)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    WaitBlock.Address = Address;
+    WaitBlock.Signaled = FALSE;
+
+    Bucket = RtlpGetAddressWaitBucket(Address);
+    RtlpAcquireAddressWaitBucket(Bucket);
+
+    /* Publish ourselves before looking at the value, see RtlpWakeAddress */
+    InterlockedIncrement(&Bucket->WaitCount);
+    InsertTailList(&Bucket->WaitList, &WaitBlock.ListEntry);
+
+    if (!RtlpAddressValueMatches(Address, CompareAddress, AddressSize))
+    {
+        /* The value already changed, no need to sleep */
+        RemoveEntryList(&WaitBlock.ListEntry);
+        InterlockedDecrement(&Bucket->WaitCount);
+        RtlpReleaseAddressWaitBucket(Bucket);
+        return STATUS_SUCCESS;
+    }
+
+    RtlpReleaseAddressWaitBucket(Bucket);
+
+    Status = NtWaitForKeyedEvent(RtlpWaitOnAddressKeyedEvent, &WaitBlock, FALSE, Timeout);
+    if (Status != STATUS_SUCCESS)
+    {
+        RtlpAcquireAddressWaitBucket(Bucket);
+
+        if (!WaitBlock.Signaled)
+        {
+            /* Nobody is going to wake us, leave */
+            RemoveEntryList(&WaitBlock.ListEntry);
+            InterlockedDecrement(&Bucket->WaitCount);
+            RtlpReleaseAddressWaitBucket(Bucket);
+            return Status;
+        }
+
+        RtlpReleaseAddressWaitBucket(Bucket);
+
+        /* We raced with a waker that is about to release us. Its release
+           blocks until it finds us, so wait for it. */
+        Status = NtWaitForKeyedEvent(RtlpWaitOnAddressKeyedEvent, &WaitBlock, FALSE, NULL);
+        ASSERT(Status == STATUS_SUCCESS);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+NTAPI
+RtlWakeAddressSingle(
+    _In_ PVOID Address)
+{
+    RtlpWakeAddress(Address, FALSE);
+}
+
+VOID
+NTAPI
+RtlWakeAddressAll(
+    _In_ PVOID Address)
+{
+    RtlpWakeAddress(Address, TRUE);
+}
+
+/* EOF */
@@ -0,0 +1,272 @@
+/*
+ * PROJECT:     ReactOS cabinet manager
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     CCFDATACompressor class implementation
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+/*
+ * Data blocks are handed to the codec in three steps. PrepareBlock and
+ * FinishBlock run on the thread that submits and retires the blocks, in
+ * block order, so that codecs which carry state from one block to the next
+ * (LZX) can do so there. Only CompressBlock runs on the worker threads.
+ * Blocks are always retired in the order they were submitted, which keeps
+ * the cabinet identical no matter how many threads are used.
+ */
+
+#include <new>
+#include "CCFDATACompressor.h"
+
+#if !defined(CAB_READ_ONLY)
+
+/**
+* @name CCFDATACompressor class
+* @implemented
+*
+* Default constructor
+*
+* @param ThreadCount
+* Number of worker threads, 0 to use one per processor
+*/
+CCFDATACompressor::CCFDATACompressor(ULONG ThreadCount)
+{
+    if (ThreadCount == 0)
+        ThreadCount = std::thread::hardware_concurrency();
+    if (ThreadCount == 0)
+        ThreadCount = 1;
+    if (ThreadCount > CAB_MAX_THREADS)
+        ThreadCount = CAB_MAX_THREADS;
+
+    this->ThreadCount = ThreadCount;
+    Stopping = false;
+}
+
+/**
+* @name CCFDATACompressor class
+* @implemented
+*
+* Default destructor
+*/
+CCFDATACompressor::~CCFDATACompressor()
+{
+    PCFDATA_JOB Job;
+
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        Stopping = true;
+    }
+    WorkAvailable.notify_all();
+
+    for (std::thread& Worker : Workers)
+        Worker.join();
+
+    /* Let the codec free whatever it attached to blocks nobody retired */
+    while ((Job = GetCompletedJob(true)) != NULL)
+        ReleaseJob(Job);
+
+    for (PCFDATA_JOB FreeJob : FreeJobs)
+        delete FreeJob;
+}
+
+/**
+* @name CCFDATACompressor::GetThreadCount
+* @implemented
+*
+* Returns the number of threads blocks are compressed on
+*/
+ULONG CCFDATACompressor::GetThreadCount()
+{
+    return ThreadCount;
+}
+
+/**
+* @name CCFDATACompressor::IsFull
+* @implemented
+*
+* Returns true if no more blocks should be submitted before the oldest one is retired
+*/
+bool CCFDATACompressor::IsFull()
+{
+    std::lock_guard<std::mutex> Guard(Lock);
+    return PendingJobs.size() >= 2 * ThreadCount;
+}
+
+/**
+* @name CCFDATACompressor::Submit
+* @implemented
+*
+* Queues a data block for compression
+*
+* @param Codec
+* Codec to compress the block with
+*
+* @param Buffer
+* Uncompressed data, copied before returning
+*
+* @param Length
+* Number of bytes in Buffer, at most CAB_BLOCKSIZE
+*
+* @return
+* Status of operation
+*/
+ULONG CCFDATACompressor::Submit(CCABCodec* Codec, void* Buffer, ULONG Length)
+{
+    PCFDATA_JOB Job;
+
+    ASSERT(Length <= CAB_BLOCKSIZE);
+
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        if (!FreeJobs.empty())
+        {
+            Job = FreeJobs.back();
+            FreeJobs.pop_back();
+        }
+        else
+        {
+            Job = NULL;
+        }
+    }
+
+    if (!Job)
+    {
+        Job = new (std::nothrow) CFDATA_JOB;
+        if (!Job)
+        {
+            DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
+            return CAB_STATUS_NOMEMORY;
+        }
+    }
+
+    memcpy(Job->Block.Input, Buffer, Length);
+    Job->Block.InputLength  = Length;
+    Job->Block.OutputLength = 0;
+    Job->Block.Context      = NULL;
+    Job->Codec              = Codec;
+
+    /* Errors are reported when the block is retired */
+    Job->Block.Status = Codec->PrepareBlock(&Job->Block);
+
+    if (ThreadCount <= 1 || Job->Block.Status != CS_SUCCESS)
+    {
+        if (Job->Block.Status == CS_SUCCESS)
+            Job->Block.Status = Codec->CompressBlock(&Job->Block);
+
+        Job->Done = true;
+
+        std::lock_guard<std::mutex> Guard(Lock);
+        PendingJobs.push_back(Job);
+        return CAB_STATUS_SUCCESS;
+    }
+
+    Job->Done = false;
+
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+
+        /* Start the workers the first time there is work for them */
+        if (Workers.empty())
+        {
+            for (ULONG i = 0; i < ThreadCount; i++)
+                Workers.emplace_back(&CCFDATACompressor::WorkerThread, this);
+        }
+
+        PendingJobs.push_back(Job);
+        WorkQueue.push_back(Job);
+    }
+    WorkAvailable.notify_one();
+
+    return CAB_STATUS_SUCCESS;
+}
+
+/**
+* @name CCFDATACompressor::GetCompletedJob
+* @implemented
+*
+* Returns the oldest submitted block once it is compressed
+*
+* @param Wait
+* true to wait for the block if it is still being compressed
+*
+* @return
+* The job, to be passed to ReleaseJob, or NULL if there is none (yet).
+* Block.Status is the codec status.
+*/
+PCFDATA_JOB CCFDATACompressor::GetCompletedJob(bool Wait)
+{
+    PCFDATA_JOB Job;
+    ULONG Status;
+
+    {
+        std::unique_lock<std::mutex> Guard(Lock);
+
+        if (PendingJobs.empty())
+            return NULL;
+
+        Job = PendingJobs.front();
+        if (!Job->Done)
+        {
+            if (!Wait)
+                return NULL;
+
+            JobDone.wait(Guard, [Job] { return Job->Done; });
+        }
+
+        PendingJobs.pop_front();
+    }
+
+    Status = Job->Codec->FinishBlock(&Job->Block);
+    if (Job->Block.Status == CS_SUCCESS)
+        Job->Block.Status = Status;
+
+    return Job;
+}
+
+/**
+* @name CCFDATACompressor::ReleaseJob
+* @implemented
+*
+* Returns a job obtained from GetCompletedJob for reuse
+*/
+void CCFDATACompressor::ReleaseJob(PCFDATA_JOB Job)
+{
+    std::lock_guard<std::mutex> Guard(Lock);
+    FreeJobs.push_back(Job);
+}
+
+/**
+* @name CCFDATACompressor::WorkerThread
+* @implemented
+*
+* Compresses queued blocks until the compressor is destroyed
+*/
+void CCFDATACompressor::WorkerThread()
+{
+    PCFDATA_JOB Job;
+    ULONG Status;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> Guard(Lock);
+
+            WorkAvailable.wait(Guard, [this] { return Stopping || !WorkQueue.empty(); });
+            if (WorkQueue.empty())
+                return;
+
+            Job = WorkQueue.front();
+            WorkQueue.pop_front();
+        }
+
+        Status = Job->Codec->CompressBlock(&Job->Block);
+
+        {
+            std::lock_guard<std::mutex> Guard(Lock);
+            Job->Block.Status = Status;
+            Job->Done = true;
+        }
+        JobDone.notify_all();
+    }
+}
+
+#endif /* CAB_READ_ONLY */
@@ -0,0 +1,52 @@
+/*
+ * PROJECT:     ReactOS cabinet manager
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     CCFDATACompressor class, compresses data blocks on worker threads
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#pragma once
+
+#include "cabinet.h"
+
+#ifndef CAB_READ_ONLY
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef struct _CFDATA_JOB
+{
+    CAB_CODEC_BLOCK Block;
+    CCABCodec*      Codec = nullptr;
+    bool            Done = false;
+} CFDATA_JOB, *PCFDATA_JOB;
+
+class CCFDATACompressor
+{
+public:
+    /* Default constructor */
+    CCFDATACompressor(ULONG ThreadCount);
+    /* Default destructor */
+    virtual ~CCFDATACompressor();
+    ULONG GetThreadCount();
+    ULONG Submit(CCABCodec* Codec, void* Buffer, ULONG Length);
+    PCFDATA_JOB GetCompletedJob(bool Wait);
+    void ReleaseJob(PCFDATA_JOB Job);
+    bool IsFull();
+private:
+    void WorkerThread();
+    ULONG ThreadCount;
+    std::vector<std::thread> Workers;
+    std::mutex Lock;
+    std::condition_variable WorkAvailable;
+    std::condition_variable JobDone;
+    std::deque<PCFDATA_JOB> PendingJobs;    // All submitted jobs, in block order
+    std::deque<PCFDATA_JOB> WorkQueue;      // Jobs no worker has picked up yet
+    std::vector<PCFDATA_JOB> FreeJobs;
+    bool Stopping;
+};
+
+#endif /* CAB_READ_ONLY */
@@ -23,10 +23,13 @@
 # include <sys/stat.h>
 # include <sys/types.h>
 #endif
+#include <chrono>
 #include "cabinet.h"
 #include "CCFDATAStorage.h"
+#include "CCFDATACompressor.h"
 #include "raw.h"
 #include "mszip.h"
+#include "lzx.h"
 
 #ifndef CAB_READ_ONLY
 
@@ -63,6 +66,17 @@ void DumpBuffer(void* Buffer, ULONG Size)
 #endif /* DBG */
 #endif
 
+static ULONG GetMilliseconds()
+/*
+ * FUNCTION: Returns a time stamp for measuring how long something takes
+ * RETURNS:
+ *     Milliseconds since an arbitrary point in time
+ */
+{
+    return (ULONG)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 #endif /* CAB_READ_ONLY */
 
 
@@ -92,6 +106,8 @@ CCabinet::CCabinet()
     MaxDiskSize  = 0;
     BlockIsSplit = false;
     ScratchFile  = NULL;
+    Compressor   = NULL;
+    ThreadCount  = 0;
 
     FolderUncompSize = 0;
     BytesLeftInBlock = 0;
@@ -296,6 +312,8 @@ bool CCabinet::SetCompressionCodec(const char* CodecName)
         SelectCodec(CAB_CODEC_RAW);
     else if( !strcasecmp(CodecName, "mszip") )
         SelectCodec(CAB_CODEC_MSZIP);
+    else if( !strcasecmp(CodecName, "lzx") )
+        SelectCodec(CAB_CODEC_LZX);
     else
     {
         printf("ERROR: Invalid codec specified!\n");
@@ -1041,6 +1059,10 @@ void CCabinet::SelectCodec(LONG Id)
             Codec = new CMSZipCodec();
             break;
 
+        case CAB_CODEC_LZX:
+            Codec = new CLZXCodec();
+            break;
+
         default:
             return;
     }
@@ -1065,8 +1087,9 @@ ULONG CCabinet::NewCabinet()
 
     CurrentDiskNumber = 0;
 
-    OutputBuffer = malloc(CAB_BLOCKSIZE + 12); // This should be enough
-    InputBuffer  = malloc(CAB_BLOCKSIZE + 12); // This should be enough
+    /* InputBuffer also holds compressed blocks in CommitDataBlocks */
+    OutputBuffer = malloc(CAB_MAX_COMPSIZE);
+    InputBuffer  = malloc(CAB_MAX_COMPSIZE);
     if ((!OutputBuffer) || (!InputBuffer))
     {
         DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
@@ -1074,6 +1097,14 @@ ULONG CCabinet::NewCabinet()
     }
     CurrentIBuffer     = InputBuffer;
     CurrentIBufferSize = 0;
+    CurrentOBufferSize = 0;
+
+    Compressor = new CCFDATACompressor(ThreadCount);
+    if (!Compressor)
+    {
+        DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
+        return CAB_STATUS_NOMEMORY;
+    }
 
     CABHeader.Signature     = CAB_SIGNATURE;
     CABHeader.Reserved1     = 0;            // Not used
@@ -1156,8 +1187,18 @@ ULONG CCabinet::NewFolder()
  *     Status of operation
  */
 {
+    ULONG Status;
+
     DPRINT(MAX_TRACE, ("Creating new folder.\n"));
 
+    /* Blocks still being compressed belong to the current folder */
+    Status = RetireDataBlocks(true);
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
+    if (CurrentFolderNode)
+        FinishFolder();
+
     CurrentFolderNode = NewFolderNode();
     if (!CurrentFolderNode)
     {
@@ -1174,10 +1215,20 @@ ULONG CCabinet::NewFolder()
             CurrentFolderNode->Folder.CompressionType = CAB_COMP_MSZIP;
             break;
 
+        case CAB_CODEC_LZX:
+            CurrentFolderNode->Folder.CompressionType = LZX_COMPRESSION_TYPE;
+            break;
+
         default:
             return CAB_STATUS_UNSUPPCOMP;
     }
 
+    /* Each folder is a separate compressed stream */
+    Codec->Reset();
+    FolderStartTime = GetMilliseconds();
+    FolderBytesIn   = 0;
+    FolderBytesOut  = 0;
+
     /* FIXME: This won't work if no files are added to the new folder */
 
     DiskSize += sizeof(CFFOLDER);
@@ -1384,6 +1435,14 @@ ULONG CCabinet::WriteDisk(ULONG MoreDisks)
             }
         } while (CreateNewDisk);
     }
+
+    Status = RetireDataBlocks(true);
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
+    if (!MoreDisks)
+        FinishFolder();
+
     CommitDisk(MoreDisks);
 
     return CAB_STATUS_SUCCESS;
@@ -1401,6 +1460,10 @@ ULONG CCabinet::CommitDisk(ULONG MoreDisks)
 {
     ULONG Status;
 
+    Status = RetireDataBlocks(true);
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
     OnCabinetName(CurrentDiskNumber, CabinetName);
 
     /* Create file, fail if it already exists */
@@ -1483,6 +1546,12 @@ ULONG CCabinet::CloseCabinet()
 {
     ULONG Status;
 
+    if (Compressor)
+    {
+        delete Compressor;
+        Compressor = NULL;
+    }
+
     DestroyFileNodes();
 
     DestroyFolderNodes();
@@ -1727,6 +1796,17 @@ void CCabinet::SetMaxDiskSize(ULONG Size)
     MaxDiskSize = Size;
 }
 
+
+void CCabinet::SetThreadCount(ULONG Count)
+/*
+ * FUNCTION: Sets the number of threads used to compress data blocks
+ * ARGUMENTS:
+ *     Count = Number of threads (0 means one per processor)
+ */
+{
+    ThreadCount = Count;
+}
+
 #endif /* CAB_READ_ONLY */
 
 
@@ -1803,6 +1883,19 @@ bool CCabinet::OnDiskLabel(ULONG Number, char* Label)
 }
 
 
+void CCabinet::OnFolderCompressed(ULONG Number, ULONG UncompSize, ULONG CompSize, ULONG Milliseconds)
+/*
+ * FUNCTION: Called when all data of a folder is compressed
+ * ARGUMENTS:
+ *     Number       = Zero-based folder number in the current disk
+ *     UncompSize   = Uncompressed size of folder data
+ *     CompSize     = Compressed size of folder data
+ *     Milliseconds = Time spent compressing the folder
+ */
+{
+}
+
+
 bool CCabinet::OnCabinetName(ULONG Number, char* Name)
 /*
  * FUNCTION: Called when a cabinet needs a name
@@ -2756,23 +2849,91 @@ ULONG CCabinet::WriteDataBlock()
  */
 {
     ULONG Status;
-    ULONG BytesWritten;
-    PCFDATA_NODE DataNode;
 
-    if (!BlockIsSplit)
+    if (BlockIsSplit)
     {
-        Status = Codec->Compress(OutputBuffer,
-            InputBuffer,
-            CurrentIBufferSize,
-            &TotalCompSize);
+        /* Write the part that did not fit on the previous disk */
+        return WriteCompressedBlock();
+    }
 
-        DPRINT(MAX_TRACE, ("Block compressed. CurrentIBufferSize (%u)  TotalCompSize(%u).\n",
-            (UINT)CurrentIBufferSize, (UINT)TotalCompSize));
+    Status = Compressor->Submit(Codec, InputBuffer, CurrentIBufferSize);
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
 
-        CurrentOBuffer     = OutputBuffer;
-        CurrentOBufferSize = TotalCompSize;
+    CurrentIBufferSize = 0;
+    CurrentIBuffer     = InputBuffer;
+
+    /* Whether a block is split depends on its compressed size, so with a
+       limited disk size each block is written before the next one is read */
+    return RetireDataBlocks(MaxDiskSize > 0);
+}
+
+
+ULONG CCabinet::RetireDataBlocks(bool Wait)
+/*
+ * FUNCTION: Writes compressed data blocks to the scratch file, in the order
+ *           they were read
+ * ARGUMENTS:
+ *     Wait = true to wait for all blocks, false to only write the ones that
+ *            are done (or to wait for the oldest if too many are pending)
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    PCFDATA_JOB Job;
+    ULONG Status;
+
+    if (!Compressor)
+        return CAB_STATUS_SUCCESS;
+
+    while ((Job = Compressor->GetCompletedJob(Wait || Compressor->IsFull())) != NULL)
+    {
+        Status = Job->Block.Status;
+        if (Status != CS_SUCCESS)
+        {
+            DPRINT(MIN_TRACE, ("Cannot compress block (%u).\n", (UINT)Status));
+            Compressor->ReleaseJob(Job);
+            return (Status == CS_NOMEMORY) ? CAB_STATUS_NOMEMORY : CAB_STATUS_FAILURE;
+        }
+
+        DPRINT(MAX_TRACE, ("Block compressed. UncompSize (%u)  TotalCompSize(%u).\n",
+            (UINT)Job->Block.InputLength, (UINT)Job->Block.OutputLength));
+
+        memcpy(OutputBuffer, Job->Block.Output, Job->Block.OutputLength);
+        TotalCompSize            = Job->Block.OutputLength;
+        CurrentOBuffer           = OutputBuffer;
+        CurrentOBufferSize       = TotalCompSize;
+        CurrentOBufferUncompSize = Job->Block.InputLength;
+
+        FolderBytesIn  += Job->Block.InputLength;
+        FolderBytesOut += Job->Block.OutputLength;
+
+        Compressor->ReleaseJob(Job);
+
+        Status = WriteCompressedBlock();
+        if (Status != CAB_STATUS_SUCCESS)
+            return Status;
+
+        /* The rest goes to the next disk, nothing else is pending then */
+        if (BlockIsSplit)
+            break;
     }
 
+    return CAB_STATUS_SUCCESS;
+}
+
+
+ULONG CCabinet::WriteCompressedBlock()
+/*
+ * FUNCTION: Writes the compressed block in the output buffer to the scratch file
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    ULONG Status;
+    ULONG BytesWritten;
+    PCFDATA_NODE DataNode;
+
     DataNode = NewDataNode(CurrentFolderNode);
     if (!DataNode)
     {
@@ -2797,7 +2958,7 @@ ULONG CCabinet::WriteDataBlock()
     else
     {
         DataNode->Data.CompSize   = (USHORT)CurrentOBufferSize;
-        DataNode->Data.UncompSize = (USHORT)CurrentIBufferSize;
+        DataNode->Data.UncompSize = (USHORT)CurrentOBufferUncompSize;
     }
 
     DataNode->Data.Checksum = 0;
@@ -2826,15 +2987,25 @@ ULONG CCabinet::WriteDataBlock()
 
     LastBlockStart += DataNode->Data.UncompSize;
 
-    if (!BlockIsSplit)
-    {
-        CurrentIBufferSize = 0;
-        CurrentIBuffer     = InputBuffer;
-    }
-
     return CAB_STATUS_SUCCESS;
 }
 
+
+void CCabinet::FinishFolder()
+/*
+ * FUNCTION: Reports how long compressing the current folder took
+ */
+{
+    if (FolderBytesIn == 0)
+        return;
+
+    OnFolderCompressed(NextFolderNumber - 1, FolderBytesIn, FolderBytesOut,
+        GetMilliseconds() - FolderStartTime);
+
+    FolderBytesIn  = 0;
+    FolderBytesOut = 0;
+}
+
 #if !defined(_WIN32)
 
 void CCabinet::ConvertDateAndTime(time_t* Time,
@@ -113,6 +113,8 @@ extern ULONG DebugTraceLevel;
 #define CAB_SIGNATURE        0x4643534D // "MSCF"
 #define CAB_VERSION          0x0103
 #define CAB_BLOCKSIZE        32768
+#define CAB_MAX_COMPSIZE     (CAB_BLOCKSIZE + 6144) // Largest CFDATA a codec may produce
+#define CAB_MAX_THREADS      32
 
 #define CAB_COMP_MASK        0x00FF
 #define CAB_COMP_NONE        0x0000
@@ -272,6 +274,17 @@ typedef struct _CAB_SEARCH
 
 /* Codecs */
 
+/* A data block on its way through a codec, see CCABCodec::PrepareBlock */
+typedef struct _CAB_CODEC_BLOCK
+{
+    unsigned char   Input[CAB_BLOCKSIZE];
+    unsigned char   Output[CAB_MAX_COMPSIZE];
+    ULONG           InputLength = 0;
+    ULONG           OutputLength = 0;
+    ULONG           Status = 0;
+    void*           Context = nullptr;  // Codec private data
+} CAB_CODEC_BLOCK, *PCAB_CODEC_BLOCK;
+
 class CCABCodec
 {
 public:
@@ -289,6 +302,17 @@ public:
                              void* InputBuffer,
                              ULONG InputLength,
                              PULONG OutputLength) = 0;
+    /* Starts a new compressed stream, called for every new folder */
+    virtual void Reset() {};
+    /* Block-parallel compression. PrepareBlock and FinishBlock are called in
+       block order, CompressBlock may run on any thread at the same time as
+       other blocks. By default blocks are independent of each other */
+    virtual ULONG PrepareBlock(PCAB_CODEC_BLOCK Block) { return 0; };
+    virtual ULONG CompressBlock(PCAB_CODEC_BLOCK Block)
+    {
+        return Compress(Block->Output, Block->Input, Block->InputLength, &Block->OutputLength);
+    };
+    virtual ULONG FinishBlock(PCAB_CODEC_BLOCK Block) { return 0; };
 };
 
 
@@ -382,6 +406,8 @@ public:
     ULONG AddFile(const std::string& FileName, const std::string& TargetFolder);
     /* Sets the maximum size of the current disk */
     void SetMaxDiskSize(ULONG Size);
+    /* Sets the number of threads used for compression (0 means one per processor) */
+    void SetThreadCount(ULONG Count);
 #endif /* CAB_READ_ONLY */
 
     /* Default event handlers */
@@ -401,6 +427,8 @@ public:
     virtual bool OnCabinetName(ULONG Number, char* Name);
     /* Handler called when a disk needs a label */
     virtual bool OnDiskLabel(ULONG Number, char* Label);
+    /* Handler called when all data of a folder is compressed */
+    virtual void OnFolderCompressed(ULONG Number, ULONG UncompSize, ULONG CompSize, ULONG Milliseconds);
 #endif /* CAB_READ_ONLY */
 private:
     PCFFOLDER_NODE LocateFolderNode(ULONG Index);
@@ -427,6 +455,9 @@ private:
     ULONG WriteFileEntries();
     ULONG CommitDataBlocks(PCFFOLDER_NODE FolderNode);
     ULONG WriteDataBlock();
+    ULONG WriteCompressedBlock();
+    ULONG RetireDataBlocks(bool Wait);
+    void FinishFolder();
     ULONG GetAttributesOnFile(PCFFILE_NODE File);
     ULONG SetAttributesOnFile(char* FileName, USHORT FileAttributes);
     ULONG GetFileTimes(FILE* FileHandle, PCFFILE_NODE File);
@@ -472,6 +503,7 @@ private:
     ULONG TotalCompSize;        // Total size of current CFDATA block
     void* CurrentOBuffer;               // Current offset in output buffer
     ULONG CurrentOBufferSize;   // Bytes left in output buffer
+    ULONG CurrentOBufferUncompSize; // Uncompressed size of block in output buffer
     ULONG BytesLeftInCabinet;
     bool RestartSearch;
     ULONG LastFileOffset;       // Uncompressed offset of last extracted file
@@ -484,6 +516,11 @@ private:
     bool CreateNewFolder;
 
     class CCFDATAStorage *ScratchFile;
+    class CCFDATACompressor *Compressor;
+    ULONG ThreadCount;
+    ULONG FolderStartTime;      // Time the current folder was started (ms)
+    ULONG FolderBytesIn;        // Uncompressed bytes written to the current folder
+    ULONG FolderBytesOut;       // Compressed bytes written to the current folder
     FILE* SourceFile;
     bool ContinueFile;
     ULONG TotalBytesLeft;
@@ -192,8 +192,8 @@ void CCABManager::Usage()
 {
     printf("ReactOS Cabinet Manager\n\n");
     printf("CABMAN [-D | -E] [-A] [-L dir] cabinet [filename ...]\n");
-    printf("CABMAN [-M mode] -C dirfile [-I] [-RC file] [-P dir]\n");
-    printf("CABMAN [-M mode] -S cabinet filename [-F folder] [filename] [...]\n");
+    printf("CABMAN [-M mode] [-T threads] -C dirfile [-I] [-RC file] [-P dir]\n");
+    printf("CABMAN [-M mode] [-T threads] -S cabinet filename [-F folder] [filename] [...]\n");
     printf("  cabinet   Cabinet file.\n");
     printf("  filename  Name of the file to add to or extract from the cabinet.\n");
     printf("            Wild cards and multiple filenames\n");
@@ -213,11 +213,14 @@ void CCABManager::Usage()
     printf("  -M mode   Specify the compression method to use:\n");
     printf("               raw    - No compression\n");
     printf("               mszip  - MsZip compression (default)\n");
+    printf("               lzx    - LZX compression (smaller, not supported by\n");
+    printf("                        the text-mode setup)\n");
     printf("  -N        Don't create the .inf file, only the cabinet.\n");
     printf("  -RC       Specify file to put in cabinet reserved area\n");
     printf("            (size must be less than 64KB).\n");
     printf("  -S        Create simple cabinet.\n");
     printf("  -P dir    Files in the .dff are relative to this directory.\n");
+    printf("  -T n      Compress on n threads (default is one per processor).\n");
     printf("  -V        Verbose mode (prints more messages).\n");
 }
 
@@ -361,6 +364,18 @@ bool CCABManager::ParseCmdline(int argc, char* argv[])
 
                     break;
 
+                case 't':
+                case 'T':
+                    if (argv[i][2] == 0)
+                    {
+                        i++;
+                        SetThreadCount(strtoul(&argv[i][0], NULL, 10));
+                    }
+                    else
+                        SetThreadCount(strtoul(&argv[i][2], NULL, 10));
+
+                    break;
+
                 case 'V':
                     Verbose = true;
                     break;
@@ -670,6 +685,22 @@ void CCABManager::OnAdd(PCFFILE File,
     }
 }
 
+void CCABManager::OnFolderCompressed(ULONG Number, ULONG UncompSize, ULONG CompSize, ULONG Milliseconds)
+/*
+ * FUNCTION: Called when all data of a folder is compressed
+ * ARGUMENTS:
+ *     Number       = Zero-based folder number in the current disk
+ *     UncompSize   = Uncompressed size of folder data
+ *     CompSize     = Compressed size of folder data
+ *     Milliseconds = Time spent compressing the folder
+ */
+{
+    /* Always shown, so that build logs can be compared */
+    printf("Folder %u: %u bytes compressed to %u bytes (%u%%) in %u ms\n",
+        (UINT)Number, (UINT)UncompSize, (UINT)CompSize,
+        (UINT)((ULONGLONG)CompSize * 100 / UncompSize), (UINT)Milliseconds);
+}
+
 void CCABManager::OnVerboseMessage(const char* Message)
 {
     if (Verbose)
@@ -37,6 +37,7 @@ private:
     virtual void OnExtract(PCFFILE File, const char* FileName) override;
     virtual void OnDiskChange(const char* CabinetName, const char* DiskLabel) override;
     virtual void OnAdd(PCFFILE Entry, const char* FileName) override;
+    virtual void OnFolderCompressed(ULONG Number, ULONG UncompSize, ULONG CompSize, ULONG Milliseconds) override;
     virtual void OnVerboseMessage(const char* Message) override;
 
     /* Configuration */
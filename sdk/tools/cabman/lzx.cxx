@@ -0,0 +1,892 @@
+/*
+ * PROJECT:     ReactOS cabinet manager
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     CAB codec for LZX compressed data
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+/*
+ * Every CFDATA block is one LZX frame holding one block, either verbatim or,
+ * if that does not pay off, uncompressed. Matches may reach back into
+ * earlier frames of the folder, so the work is split in three steps:
+ *
+ * - PrepareBlock (in block order) applies the E8 call translation, appends
+ *   the frame to the history ring and links it into the hash chains.
+ * - CompressBlock (any thread) walks the chains to find the matches. It only
+ *   reads history that is complete and that later frames cannot overwrite
+ *   yet, see LZX_RING_SIZE.
+ * - FinishBlock (in block order) turns the matches into repeated offsets,
+ *   builds the Huffman trees, which are delta coded against the previous
+ *   block, and writes the bits.
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <new>
+#include "lzx.h"
+
+
+/* Bit output, LZX stores bits MSB first in little endian 16-bit words */
+
+typedef struct _LZX_BITWRITER
+{
+    unsigned char*  Buffer;
+    ULONG           Size;
+    ULONG           Position;
+    ULONGLONG       Bits;
+    ULONG           BitCount;   // Bits not yet written out, less than 16
+    bool            Overflow;
+} LZX_BITWRITER, *PLZX_BITWRITER;
+
+static void LzxInitWriter(PLZX_BITWRITER Writer, void* Buffer, ULONG Size)
+{
+    Writer->Buffer   = (unsigned char*)Buffer;
+    Writer->Size     = Size;
+    Writer->Position = 0;
+    Writer->Bits     = 0;
+    Writer->BitCount = 0;
+    Writer->Overflow = false;
+}
+
+static void LzxPutBits(PLZX_BITWRITER Writer, ULONG Value, ULONG Count)
+{
+    Writer->Bits = (Writer->Bits << Count) | (Value & ((1UL << Count) - 1));
+    Writer->BitCount += Count;
+
+    while (Writer->BitCount >= 16)
+    {
+        USHORT Word = (USHORT)(Writer->Bits >> (Writer->BitCount - 16));
+
+        Writer->BitCount -= 16;
+        if (Writer->Position + 2 > Writer->Size)
+        {
+            Writer->Overflow = true;
+            continue;
+        }
+        Writer->Buffer[Writer->Position++] = (unsigned char)Word;
+        Writer->Buffer[Writer->Position++] = (unsigned char)(Word >> 8);
+    }
+}
+
+static void LzxAlignWriter(PLZX_BITWRITER Writer)
+{
+    if (Writer->BitCount > 0)
+        LzxPutBits(Writer, 0, 16 - Writer->BitCount);
+}
+
+static void LzxPutBytes(PLZX_BITWRITER Writer, const void* Data, ULONG Length)
+{
+    ASSERT(Writer->BitCount == 0);
+
+    if (Writer->Position + Length > Writer->Size)
+    {
+        Writer->Overflow = true;
+        return;
+    }
+    memcpy(Writer->Buffer + Writer->Position, Data, Length);
+    Writer->Position += Length;
+}
+
+
+/* Huffman trees */
+
+static void LzxMakeLengths(const ULONG* Frequencies, ULONG Count, ULONG MaxLength, UCHAR* Lengths)
+/*
+ * FUNCTION: Computes length limited Huffman code lengths
+ * ARGUMENTS:
+ *     Frequencies = Symbol frequencies, at least two of them must be non-zero
+ *     Count       = Number of symbols
+ *     MaxLength   = Longest code allowed
+ *     Lengths     = Address of buffer to place code lengths
+ */
+{
+    std::vector<ULONG> Weights(Frequencies, Frequencies + Count);
+    std::vector<ULONG> Symbols;
+    std::vector<ULONG> NodeWeights;
+    std::vector<ULONG> Parents;
+    std::vector<ULONG> Depths;
+    ULONG Leaves, Leaf, Node, Next, Pick[2], i, j;
+    bool TooLong;
+
+    for (i = 0; i < Count; i++)
+    {
+        if (Weights[i] != 0)
+            Symbols.push_back(i);
+    }
+    Leaves = (ULONG)Symbols.size();
+    ASSERT(Leaves >= 2);
+
+    for (;;)
+    {
+        /* Sort by weight, ties by symbol, so that the result is always the same */
+        std::sort(Symbols.begin(), Symbols.end(), [&Weights](ULONG A, ULONG B)
+        {
+            return (Weights[A] != Weights[B]) ? (Weights[A] < Weights[B]) : (A < B);
+        });
+
+        /* Leaves are 0..Leaves-1, internal nodes are created in weight order after them */
+        NodeWeights.assign(2 * Leaves - 1, 0);
+        Parents.assign(2 * Leaves - 1, 0);
+        for (i = 0; i < Leaves; i++)
+            NodeWeights[i] = Weights[Symbols[i]];
+
+        Leaf = 0;
+        Node = Leaves;
+        for (Next = Leaves; Next < 2 * Leaves - 1; Next++)
+        {
+            for (j = 0; j < 2; j++)
+            {
+                if (Leaf < Leaves && (Node >= Next || NodeWeights[Leaf] <= NodeWeights[Node]))
+                    Pick[j] = Leaf++;
+                else
+                    Pick[j] = Node++;
+            }
+            NodeWeights[Next] = NodeWeights[Pick[0]] + NodeWeights[Pick[1]];
+            Parents[Pick[0]] = Next;
+            Parents[Pick[1]] = Next;
+        }
+
+        /* Parents always come after their children */
+        Depths.assign(2 * Leaves - 1, 0);
+        TooLong = false;
+        for (i = 2 * Leaves - 2; i-- > 0;)
+        {
+            Depths[i] = Depths[Parents[i]] + 1;
+            if (i < Leaves && Depths[i] > MaxLength)
+                TooLong = true;
+        }
+
+        if (!TooLong)
+            break;
+
+        /* Flatten the distribution and try again */
+        for (i = 0; i < Leaves; i++)
+            Weights[Symbols[i]] = (Weights[Symbols[i]] >> 1) | 1;
+    }
+
+    memset(Lengths, 0, Count);
+    for (i = 0; i < Leaves; i++)
+        Lengths[Symbols[i]] = (UCHAR)Depths[i];
+}
+
+static void LzxMakeTree(ULONG* Frequencies, ULONG Count, ULONG MaxLength, UCHAR* Lengths)
+/*
+ * FUNCTION: Computes code lengths for a tree, making sure it can be decoded
+ */
+{
+    ULONG Used = 0, i;
+
+    for (i = 0; i < Count; i++)
+    {
+        if (Frequencies[i] != 0)
+            Used++;
+    }
+
+    /* Decoders reject trees with a single code, so use at least two */
+    for (i = 0; i < Count && Used < 2; i++)
+    {
+        if (Frequencies[i] == 0)
+        {
+            Frequencies[i] = 1;
+            Used++;
+        }
+    }
+
+    LzxMakeLengths(Frequencies, Count, MaxLength, Lengths);
+}
+
+static void LzxMakeCodes(const UCHAR* Lengths, ULONG Count, USHORT* Codes)
+/*
+ * FUNCTION: Assigns canonical codes, shorter codes and lower symbols first
+ */
+{
+    ULONG LengthCount[LZX_MAX_CODE_LENGTH + 1] = { 0 };
+    ULONG NextCode[LZX_MAX_CODE_LENGTH + 1];
+    ULONG Code = 0, Bits, i;
+
+    for (i = 0; i < Count; i++)
+        LengthCount[Lengths[i]]++;
+    LengthCount[0] = 0;
+
+    for (Bits = 1; Bits <= LZX_MAX_CODE_LENGTH; Bits++)
+    {
+        Code = (Code + LengthCount[Bits - 1]) << 1;
+        NextCode[Bits] = Code;
+    }
+
+    for (i = 0; i < Count; i++)
+    {
+        if (Lengths[i] != 0)
+            Codes[i] = (USHORT)NextCode[Lengths[i]]++;
+    }
+}
+
+static void LzxWriteLengths(PLZX_BITWRITER Writer,
+                            const UCHAR* Previous,
+                            const UCHAR* Lengths,
+                            ULONG First,
+                            ULONG Last)
+/*
+ * FUNCTION: Writes the code lengths of a range of symbols through a pretree
+ * ARGUMENTS:
+ *     Previous = Code lengths of the previous block, the new ones are coded as deltas
+ *     Lengths  = Code lengths of this block
+ *     First    = First symbol of the range
+ *     Last     = Symbol following the range
+ */
+{
+    ULONG Frequencies[LZX_PRETREE_NUM_ELEMENTS] = { 0 };
+    UCHAR PretreeLengths[LZX_PRETREE_NUM_ELEMENTS];
+    USHORT PretreeCodes[LZX_PRETREE_NUM_ELEMENTS];
+    std::vector<USHORT> Symbols;    // Pretree symbol in the low byte, its extra bits above
+    ULONG Run, Symbol, i;
+
+    for (i = First; i < Last;)
+    {
+        if (Lengths[i] == 0)
+        {
+            for (Run = 1; i + Run < Last && Lengths[i + Run] == 0 && Run < 20 + 31; Run++);
+
+            /* 18: 20 to 51 zeroes, 17: 4 to 19 zeroes */
+            if (Run >= 20)
+            {
+                Symbols.push_back((USHORT)(18 | ((Run - 20) << 8)));
+                Frequencies[18]++;
+                i += Run;
+                continue;
+            }
+            if (Run >= 4)
+            {
+                Symbols.push_back((USHORT)(17 | ((Run - 4) << 8)));
+                Frequencies[17]++;
+                i += Run;
+                continue;
+            }
+        }
+
+        Symbol = (Previous[i] + 17 - Lengths[i]) % 17;
+        Symbols.push_back((USHORT)Symbol);
+        Frequencies[Symbol]++;
+        i++;
+    }
+
+    LzxMakeTree(Frequencies, LZX_PRETREE_NUM_ELEMENTS, LZX_MAX_PRETREE_LENGTH, PretreeLengths);
+    LzxMakeCodes(PretreeLengths, LZX_PRETREE_NUM_ELEMENTS, PretreeCodes);
+
+    for (i = 0; i < LZX_PRETREE_NUM_ELEMENTS; i++)
+        LzxPutBits(Writer, PretreeLengths[i], 4);
+
+    for (USHORT Item : Symbols)
+    {
+        Symbol = Item & 0xFF;
+        LzxPutBits(Writer, PretreeCodes[Symbol], PretreeLengths[Symbol]);
+
+        if (Symbol == 17)
+            LzxPutBits(Writer, Item >> 8, 4);
+        else if (Symbol == 18)
+            LzxPutBits(Writer, Item >> 8, 5);
+    }
+}
+
+
+/* Tokens found by CompressBlock: a literal byte, or a match */
+
+#define LZX_TOKEN_MATCH             0x80000000
+#define LZX_MATCH_TOKEN(Length, Distance) \
+    (LZX_TOKEN_MATCH | (((Length) - LZX_MIN_MATCH) << LZX_WINDOW_BITS) | (Distance))
+#define LZX_TOKEN_LENGTH(Token)     ((((Token) & ~LZX_TOKEN_MATCH) >> LZX_WINDOW_BITS) + LZX_MIN_MATCH)
+#define LZX_TOKEN_DISTANCE(Token)   ((Token) & (LZX_WINDOW_SIZE - 1))
+
+C_ASSERT(LZX_MAX_MATCH - LZX_MIN_MATCH < (1 << (31 - LZX_WINDOW_BITS)));
+
+typedef struct _LZX_BLOCK
+{
+    ULONG               Position;   // Stream offset of the frame
+    std::vector<ULONG>  Tokens;
+} LZX_BLOCK, *PLZX_BLOCK;
+
+#define LZX_HASH(p) \
+    ((ULONG)((((ULONG)(p)[0] << 16) | ((ULONG)(p)[1] << 8) | (p)[2]) * 0x9E3779B1) >> (32 - LZX_HASH_BITS))
+
+
+/* CLZXCodec */
+
+CLZXCodec::CLZXCodec()
+/*
+ * FUNCTION: Default constructor
+ */
+{
+    ULONG Bits = 0, i;
+
+    /* Extra bits are 0, 0, 0, 0, 1, 1, 2, 2, ... up to 17 */
+    for (i = 0; i < LZX_NUM_POSITION_SLOTS; i++)
+    {
+        ExtraBits[i] = (UCHAR)Bits;
+        if ((i & 1) && i >= 3 && Bits < 17)
+            Bits++;
+    }
+
+    PositionBase[0] = 0;
+    for (i = 0; i < LZX_NUM_POSITION_SLOTS; i++)
+        PositionBase[i + 1] = PositionBase[i] + (1 << ExtraBits[i]);
+
+    Window.resize(LZX_RING_SIZE + LZX_MAX_MATCH);
+    Head.resize(LZX_HASH_SIZE);
+    Prev.resize(LZX_RING_SIZE);
+
+    Reset();
+}
+
+
+CLZXCodec::~CLZXCodec()
+/*
+ * FUNCTION: Default destructor
+ */
+{
+}
+
+
+void CLZXCodec::Reset()
+/*
+ * FUNCTION: Starts a new LZX stream
+ */
+{
+    std::fill(Head.begin(), Head.end(), LZX_NIL);
+    StreamPosition = 0;
+    HashedPosition = 0;
+    PreparedFrames = 0;
+
+    HeaderWritten = false;
+    Repeat[0] = Repeat[1] = Repeat[2] = 1;
+    memset(MainLengths, 0, sizeof(MainLengths));
+    memset(LengthLengths, 0, sizeof(LengthLengths));
+}
+
+
+void CLZXCodec::TranslateE8(unsigned char* Data, ULONG Length, ULONG Position)
+/*
+ * FUNCTION: Turns relative x86 call targets into absolute ones, which the
+ *           decoder undoes after decompressing the frame
+ * ARGUMENTS:
+ *     Data     = Pointer to frame data
+ *     Length   = Length of frame, more than 10 bytes
+ *     Position = Stream offset of frame
+ */
+{
+    LONG Current, Relative, Absolute;
+    ULONG i;
+
+    for (i = 0; i < Length - 10;)
+    {
+        if (Data[i] != 0xE8)
+        {
+            i++;
+            continue;
+        }
+
+        Current  = (LONG)(Position + i);
+        Relative = (LONG)(Data[i + 1] | (Data[i + 2] << 8) | (Data[i + 3] << 16) | ((ULONG)Data[i + 4] << 24));
+
+        if (Relative >= -Current && Relative < LZX_E8_FILESIZE)
+        {
+            if (Relative < LZX_E8_FILESIZE - Current)
+                Absolute = Relative + Current;
+            else
+                Absolute = Relative - LZX_E8_FILESIZE;
+
+            Data[i + 1] = (unsigned char)Absolute;
+            Data[i + 2] = (unsigned char)(Absolute >> 8);
+            Data[i + 3] = (unsigned char)(Absolute >> 16);
+            Data[i + 4] = (unsigned char)(Absolute >> 24);
+        }
+
+        i += 5;
+    }
+}
+
+
+ULONG CLZXCodec::PrepareBlock(PCAB_CODEC_BLOCK Block)
+/*
+ * FUNCTION: Adds a frame to the stream history
+ * ARGUMENTS:
+ *     Block = Pointer to block, the input is translated in place
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    PLZX_BLOCK Context;
+    ULONG Offset, Length, Index, Chunk;
+
+    Context = new (std::nothrow) LZX_BLOCK;
+    if (!Context)
+        return CS_NOMEMORY;
+
+    /* Has to match what the decoder does, frame by frame */
+    if (PreparedFrames < LZX_E8_MAX_FRAMES && Block->InputLength > 10)
+        TranslateE8(Block->Input, Block->InputLength, StreamPosition);
+    PreparedFrames++;
+
+    for (Offset = 0; Offset < Block->InputLength; Offset += Chunk)
+    {
+        Index  = (StreamPosition + Offset) & LZX_RING_MASK;
+        Length = Block->InputLength - Offset;
+        Chunk  = std::min(Length, (ULONG)LZX_RING_SIZE - Index);
+
+        memcpy(&Window[Index], Block->Input + Offset, Chunk);
+
+        /* Mirror the start of the ring so that matches can run past its end */
+        if (Index < LZX_MAX_MATCH)
+            memcpy(&Window[LZX_RING_SIZE + Index], Block->Input + Offset, std::min(Chunk, (ULONG)LZX_MAX_MATCH - Index));
+    }
+
+    Context->Position = StreamPosition;
+    StreamPosition += Block->InputLength;
+
+    /* A position is hashed as soon as its first three bytes are known */
+    for (; HashedPosition + 2 < StreamPosition; HashedPosition++)
+    {
+        Index = HashedPosition & LZX_RING_MASK;
+        ULONG Hash = LZX_HASH(&Window[Index]);
+
+        Prev[Index] = Head[Hash];
+        Head[Hash]  = HashedPosition;
+    }
+
+    Block->Context = Context;
+
+    return CS_SUCCESS;
+}
+
+
+ULONG CLZXCodec::FindMatch(ULONG Position, ULONG End, const ULONG* Repeat, PULONG Distance)
+/*
+ * FUNCTION: Finds the longest match at a position
+ * ARGUMENTS:
+ *     Position = Stream offset to find a match for
+ *     End      = Stream offset of the end of the frame, matches stop there
+ *     Repeat   = Last three match distances in this frame, 0 if not known
+ *     Distance = Address of buffer to place match distance
+ * RETURNS:
+ *     Length of match, 0 if there is none worth coding
+ */
+{
+    const unsigned char* Current;
+    const unsigned char* Candidate;
+    ULONG MaxLength, BestLength, RepeatLength, RepeatDistance, Length;
+    ULONG Match, Next, Chain, i;
+
+    MaxLength = std::min(End - Position, (ULONG)LZX_MAX_MATCH);
+    if (MaxLength < LZX_MIN_MATCH)
+        return 0;
+
+    Current = &Window[Position & LZX_RING_MASK];
+
+    /* Repeated distances are cheapest to code */
+    RepeatLength = 0;
+    RepeatDistance = 0;
+    for (i = 0; i < 3; i++)
+    {
+        if (Repeat[i] == 0 || Repeat[i] > Position)
+            continue;
+
+        Candidate = &Window[(Position - Repeat[i]) & LZX_RING_MASK];
+        for (Length = 0; Length < MaxLength && Candidate[Length] == Current[Length]; Length++);
+
+        if (Length > RepeatLength)
+        {
+            RepeatLength = Length;
+            RepeatDistance = Repeat[i];
+        }
+    }
+
+    BestLength = 0;
+    if (MaxLength >= 3 && RepeatLength < LZX_NICE_MATCH)
+    {
+        Match = Prev[Position & LZX_RING_MASK];
+        for (Chain = LZX_MAX_CHAIN; Match != LZX_NIL && Chain > 0; Chain--)
+        {
+            if (Position - Match > LZX_MAX_DISTANCE)
+                break;
+
+            Candidate = &Window[Match & LZX_RING_MASK];
+            if (Candidate[BestLength] == Current[BestLength] && Candidate[0] == Current[0])
+            {
+                for (Length = 0; Length < MaxLength && Candidate[Length] == Current[Length]; Length++);
+
+                if (Length > BestLength)
+                {
+                    BestLength = Length;
+                    *Distance = Position - Match;
+                    if (Length >= LZX_NICE_MATCH || Length == MaxLength)
+                        break;
+                }
+            }
+
+            Next = Prev[Match & LZX_RING_MASK];
+            if (Next >= Match)
+                break;
+            Match = Next;
+        }
+
+        if (BestLength == 3 && *Distance > LZX_TOO_FAR)
+            BestLength = 0;
+    }
+
+    if (RepeatLength >= LZX_MIN_MATCH && RepeatLength + 1 >= BestLength)
+    {
+        *Distance = RepeatDistance;
+        return RepeatLength;
+    }
+
+    return (BestLength >= 3) ? BestLength : 0;
+}
+
+
+ULONG CLZXCodec::CompressBlock(PCAB_CODEC_BLOCK Block)
+/*
+ * FUNCTION: Finds the matches in a frame, may run on any thread
+ * ARGUMENTS:
+ *     Block = Pointer to block prepared by PrepareBlock
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    PLZX_BLOCK Context = (PLZX_BLOCK)Block->Context;
+    ULONG LocalRepeat[3] = { 0, 0, 0 };
+    ULONG Position, End, Length, Distance, NextLength, NextDistance;
+
+    Position = Context->Position;
+    End = Position + Block->InputLength;
+    Context->Tokens.reserve(Block->InputLength / 2);
+
+    while (Position < End)
+    {
+        Length = FindMatch(Position, End, LocalRepeat, &Distance);
+        if (Length == 0)
+        {
+            Context->Tokens.push_back(Block->Input[Position - Context->Position]);
+            Position++;
+            continue;
+        }
+
+        /* Lazy evaluation, a literal now may allow a longer match next */
+        while (Length < LZX_LAZY_MATCH && Position + 1 < End)
+        {
+            NextLength = FindMatch(Position + 1, End, LocalRepeat, &NextDistance);
+            if (NextLength <= Length)
+                break;
+
+            Context->Tokens.push_back(Block->Input[Position - Context->Position]);
+            Position++;
+            Length = NextLength;
+            Distance = NextDistance;
+        }
+
+        Context->Tokens.push_back(LZX_MATCH_TOKEN(Length, Distance));
+        Position += Length;
+
+        /* Track the repeated distances the way FinishBlock will */
+        if (Distance == LocalRepeat[1])
+            std::swap(LocalRepeat[0], LocalRepeat[1]);
+        else if (Distance == LocalRepeat[2])
+            std::swap(LocalRepeat[0], LocalRepeat[2]);
+        else if (Distance != LocalRepeat[0])
+        {
+            LocalRepeat[2] = LocalRepeat[1];
+            LocalRepeat[1] = LocalRepeat[0];
+            LocalRepeat[0] = Distance;
+        }
+    }
+
+    return CS_SUCCESS;
+}
+
+
+ULONG CLZXCodec::GetPositionSlot(ULONG FormattedOffset)
+/*
+ * FUNCTION: Returns the position slot for an offset
+ */
+{
+    return (ULONG)(std::upper_bound(PositionBase, PositionBase + LZX_NUM_POSITION_SLOTS, FormattedOffset) - PositionBase) - 1;
+}
+
+
+bool CLZXCodec::WriteVerbatimBlock(PCAB_CODEC_BLOCK Block, const std::vector<ULONG>& Tokens, ULONG MaxLength)
+/*
+ * FUNCTION: Codes a frame as a verbatim block
+ * ARGUMENTS:
+ *     Block     = Pointer to block to place the output in
+ *     Tokens    = Literals and matches of the frame
+ *     MaxLength = Size the block must stay below
+ * RETURNS:
+ *     true if the block is small enough. The stream state is only updated if it is
+ */
+{
+    ULONG MainFrequencies[LZX_MAINTREE_NUM_ELEMENTS] = { 0 };
+    ULONG LengthFrequencies[LZX_NUM_SECONDARY_LENGTHS] = { 0 };
+    UCHAR NewMainLengths[LZX_MAINTREE_NUM_ELEMENTS];
+    UCHAR NewLengthLengths[LZX_NUM_SECONDARY_LENGTHS];
+    USHORT MainCodes[LZX_MAINTREE_NUM_ELEMENTS];
+    USHORT LengthCodes[LZX_NUM_SECONDARY_LENGTHS];
+    ULONG NewRepeat[3] = { Repeat[0], Repeat[1], Repeat[2] };
+    std::vector<ULONG> Symbols;     // Main element, length footer + 1 and offset slot per token
+    LZX_BITWRITER Writer;
+    ULONG Length, Distance, Slot, Header, Footer, Main, i;
+
+    Symbols.reserve(Tokens.size());
+
+    for (ULONG Token : Tokens)
+    {
+        if (!(Token & LZX_TOKEN_MATCH))
+        {
+            MainFrequencies[Token]++;
+            Symbols.push_back(Token);
+            continue;
+        }
+
+        Length   = LZX_TOKEN_LENGTH(Token);
+        Distance = LZX_TOKEN_DISTANCE(Token);
+
+        if (Distance == NewRepeat[0])
+        {
+            Slot = 0;
+        }
+        else if (Distance == NewRepeat[1])
+        {
+            Slot = 1;
+            std::swap(NewRepeat[0], NewRepeat[1]);
+        }
+        else if (Distance == NewRepeat[2])
+        {
+            Slot = 2;
+            std::swap(NewRepeat[0], NewRepeat[2]);
+        }
+        else
+        {
+            Slot = GetPositionSlot(Distance + 2);
+            NewRepeat[2] = NewRepeat[1];
+            NewRepeat[1] = NewRepeat[0];
+            NewRepeat[0] = Distance;
+        }
+
+        Header = std::min(Length - LZX_MIN_MATCH, (ULONG)LZX_NUM_PRIMARY_LENGTHS);
+        Main = LZX_NUM_CHARS + (Slot << 3) + Header;
+        MainFrequencies[Main]++;
+
+        Footer = 0;
+        if (Header == LZX_NUM_PRIMARY_LENGTHS)
+        {
+            Footer = Length - LZX_MIN_MATCH - LZX_NUM_PRIMARY_LENGTHS;
+            LengthFrequencies[Footer]++;
+            Footer++;
+        }
+
+        /* Main element in 10 bits, the length footer in 8, slot in 6 */
+        Symbols.push_back(Main | (Footer << 10) | (Slot << 18) | LZX_TOKEN_MATCH);
+        Symbols.push_back(Distance);
+    }
+
+    /* Makes the decoder start E8 translation with the first frame */
+    if (MainFrequencies[0xE8] == 0)
+        MainFrequencies[0xE8] = 1;
+
+    LzxMakeTree(MainFrequencies, LZX_MAINTREE_NUM_ELEMENTS, LZX_MAX_CODE_LENGTH, NewMainLengths);
+    LzxMakeTree(LengthFrequencies, LZX_NUM_SECONDARY_LENGTHS, LZX_MAX_CODE_LENGTH, NewLengthLengths);
+    LzxMakeCodes(NewMainLengths, LZX_MAINTREE_NUM_ELEMENTS, MainCodes);
+    LzxMakeCodes(NewLengthLengths, LZX_NUM_SECONDARY_LENGTHS, LengthCodes);
+
+    LzxInitWriter(&Writer, Block->Output, std::min(MaxLength - 1, (ULONG)CAB_MAX_COMPSIZE));
+
+    if (!HeaderWritten)
+    {
+        LzxPutBits(&Writer, 1, 1);
+        LzxPutBits(&Writer, LZX_E8_FILESIZE >> 16, 16);
+        LzxPutBits(&Writer, LZX_E8_FILESIZE & 0xFFFF, 16);
+    }
+
+    LzxPutBits(&Writer, LZX_BLOCKTYPE_VERBATIM, 3);
+    LzxPutBits(&Writer, Block->InputLength >> 8, 16);
+    LzxPutBits(&Writer, Block->InputLength & 0xFF, 8);
+
+    LzxWriteLengths(&Writer, MainLengths, NewMainLengths, 0, LZX_NUM_CHARS);
+    LzxWriteLengths(&Writer, MainLengths, NewMainLengths, LZX_NUM_CHARS, LZX_MAINTREE_NUM_ELEMENTS);
+    LzxWriteLengths(&Writer, LengthLengths, NewLengthLengths, 0, LZX_NUM_SECONDARY_LENGTHS);
+
+    for (i = 0; i < Symbols.size() && !Writer.Overflow; i++)
+    {
+        if (!(Symbols[i] & LZX_TOKEN_MATCH))
+        {
+            LzxPutBits(&Writer, MainCodes[Symbols[i]], NewMainLengths[Symbols[i]]);
+            continue;
+        }
+
+        Main     = Symbols[i] & 0x3FF;
+        Footer   = (Symbols[i] >> 10) & 0xFF;
+        Slot     = (Symbols[i] >> 18) & 0x3F;
+        Distance = Symbols[++i];
+
+        LzxPutBits(&Writer, MainCodes[Main], NewMainLengths[Main]);
+        if (Footer != 0)
+            LzxPutBits(&Writer, LengthCodes[Footer - 1], NewLengthLengths[Footer - 1]);
+        if (Slot >= 3 && ExtraBits[Slot] != 0)
+            LzxPutBits(&Writer, Distance + 2 - PositionBase[Slot], ExtraBits[Slot]);
+    }
+
+    /* Every CFDATA block starts on a 16-bit boundary */
+    LzxAlignWriter(&Writer);
+
+    if (Writer.Overflow)
+        return false;
+
+    Block->OutputLength = Writer.Position;
+
+    memcpy(Repeat, NewRepeat, sizeof(Repeat));
+    memcpy(MainLengths, NewMainLengths, sizeof(MainLengths));
+    memcpy(LengthLengths, NewLengthLengths, sizeof(LengthLengths));
+
+    return true;
+}
+
+
+void CLZXCodec::WriteUncompressedBlock(PCAB_CODEC_BLOCK Block)
+/*
+ * FUNCTION: Stores a frame as an uncompressed block
+ * ARGUMENTS:
+ *     Block = Pointer to block to place the output in
+ */
+{
+    LZX_BITWRITER Writer;
+    UCHAR RepeatBytes[12];
+    UCHAR Pad = 0;
+    ULONG i;
+
+    LzxInitWriter(&Writer, Block->Output, CAB_MAX_COMPSIZE);
+
+    if (!HeaderWritten)
+    {
+        LzxPutBits(&Writer, 1, 1);
+        LzxPutBits(&Writer, LZX_E8_FILESIZE >> 16, 16);
+        LzxPutBits(&Writer, LZX_E8_FILESIZE & 0xFFFF, 16);
+    }
+
+    LzxPutBits(&Writer, LZX_BLOCKTYPE_UNCOMPRESSED, 3);
+    LzxPutBits(&Writer, Block->InputLength >> 8, 16);
+    LzxPutBits(&Writer, Block->InputLength & 0xFF, 8);
+
+    /* 1 to 16 bits of padding, never none */
+    if (Writer.BitCount == 0)
+        LzxPutBits(&Writer, 0, 16);
+    LzxAlignWriter(&Writer);
+
+    for (i = 0; i < 3; i++)
+    {
+        RepeatBytes[i * 4]     = (UCHAR)Repeat[i];
+        RepeatBytes[i * 4 + 1] = (UCHAR)(Repeat[i] >> 8);
+        RepeatBytes[i * 4 + 2] = (UCHAR)(Repeat[i] >> 16);
+        RepeatBytes[i * 4 + 3] = (UCHAR)(Repeat[i] >> 24);
+    }
+
+    LzxPutBytes(&Writer, RepeatBytes, sizeof(RepeatBytes));
+    LzxPutBytes(&Writer, Block->Input, Block->InputLength);
+    if (Block->InputLength & 1)
+        LzxPutBytes(&Writer, &Pad, 1);
+
+    ASSERT(!Writer.Overflow);
+
+    Block->OutputLength = Writer.Position;
+}
+
+
+ULONG CLZXCodec::FinishBlock(PCAB_CODEC_BLOCK Block)
+/*
+ * FUNCTION: Writes the compressed frame
+ * ARGUMENTS:
+ *     Block = Pointer to block compressed by CompressBlock
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    PLZX_BLOCK Context = (PLZX_BLOCK)Block->Context;
+    ULONG UncompressedSize;
+
+    Block->Context = NULL;
+
+    if (Block->Status != CS_SUCCESS)
+    {
+        delete Context;
+        return CS_SUCCESS;
+    }
+
+    /* Header and block header padded to 16 bits, the offsets, the data */
+    UncompressedSize = (HeaderWritten ? 4 : 8) + 12 + Block->InputLength + (Block->InputLength & 1);
+
+    if (!WriteVerbatimBlock(Block, Context->Tokens, UncompressedSize))
+        WriteUncompressedBlock(Block);
+
+    HeaderWritten = true;
+
+    delete Context;
+
+    return CS_SUCCESS;
+}
+
+
+ULONG CLZXCodec::Compress(void* OutputBuffer,
+                          void* InputBuffer,
+                          ULONG InputLength,
+                          PULONG OutputLength)
+/*
+ * FUNCTION: Compresses data in a buffer
+ * ARGUMENTS:
+ *     OutputBuffer   = Pointer to buffer to place compressed data, CAB_MAX_COMPSIZE bytes
+ *     InputBuffer    = Pointer to buffer with data to be compressed
+ *     InputLength    = Length of input buffer
+ *     OutputLength   = Address of buffer to place size of compressed data
+ */
+{
+    PCAB_CODEC_BLOCK Block;
+    ULONG Status;
+
+    Block = new (std::nothrow) CAB_CODEC_BLOCK;
+    if (!Block)
+        return CS_NOMEMORY;
+
+    memcpy(Block->Input, InputBuffer, InputLength);
+    Block->InputLength = InputLength;
+
+    Block->Status = PrepareBlock(Block);
+    if (Block->Status == CS_SUCCESS)
+        Block->Status = CompressBlock(Block);
+    FinishBlock(Block);
+
+    Status = Block->Status;
+    if (Status == CS_SUCCESS)
+    {
+        memcpy(OutputBuffer, Block->Output, Block->OutputLength);
+        *OutputLength = Block->OutputLength;
+    }
+
+    delete Block;
+
+    return Status;
+}
+
+
+ULONG CLZXCodec::Uncompress(void* OutputBuffer,
+                            void* InputBuffer,
+                            ULONG InputLength,
+                            PULONG OutputLength)
+/*
+ * FUNCTION: Uncompresses data in a buffer
+ * ARGUMENTS:
+ *     OutputBuffer = Pointer to buffer to place uncompressed data
+ *     InputBuffer  = Pointer to buffer with data to be uncompressed
+ *     InputLength  = Length of input buffer
+ *     OutputLength = Address of buffer to place size of uncompressed data
+ */
+{
+    DPRINT(MIN_TRACE, ("LZX decompression is not supported.\n"));
+    return CS_BADSTREAM;
+}
+
+/* EOF */
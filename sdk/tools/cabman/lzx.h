@@ -0,0 +1,97 @@
+/*
+ * PROJECT:     ReactOS cabinet manager
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     CAB codec for LZX compressed data
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#pragma once
+
+#include "cabinet.h"
+#include <vector>
+
+/* Format constants */
+#define LZX_WINDOW_BITS             21
+#define LZX_WINDOW_SIZE             (1 << LZX_WINDOW_BITS)
+#define LZX_COMPRESSION_TYPE        (CAB_COMP_LZX | (LZX_WINDOW_BITS << 8))
+
+#define LZX_MIN_MATCH               2
+#define LZX_MAX_MATCH               257
+#define LZX_MAX_DISTANCE            (LZX_WINDOW_SIZE - 3)
+#define LZX_NUM_CHARS               256
+#define LZX_NUM_PRIMARY_LENGTHS     7
+#define LZX_NUM_SECONDARY_LENGTHS   249
+#define LZX_PRETREE_NUM_ELEMENTS    20
+#define LZX_NUM_POSITION_SLOTS      50      // For a 2 MB window
+#define LZX_MAINTREE_NUM_ELEMENTS   (LZX_NUM_CHARS + LZX_NUM_POSITION_SLOTS * 8)
+#define LZX_MAX_CODE_LENGTH         16
+#define LZX_MAX_PRETREE_LENGTH      15
+
+#define LZX_BLOCKTYPE_VERBATIM      1
+#define LZX_BLOCKTYPE_UNCOMPRESSED  3
+
+#define LZX_E8_FILESIZE             12000000
+#define LZX_E8_MAX_FRAMES           32768
+
+/* Match finder. The history ring must hold the window plus every block
+   that may be prepared while an older one is still being searched */
+#define LZX_RING_BITS               23
+#define LZX_RING_SIZE               (1 << LZX_RING_BITS)
+#define LZX_RING_MASK               (LZX_RING_SIZE - 1)
+#define LZX_HASH_BITS               20
+#define LZX_HASH_SIZE               (1 << LZX_HASH_BITS)
+#define LZX_NIL                     0xFFFFFFFF
+#define LZX_MAX_CHAIN               128
+#define LZX_NICE_MATCH              128
+#define LZX_LAZY_MATCH              32
+#define LZX_TOO_FAR                 8192    // Three byte matches further back are not worth it
+
+C_ASSERT(LZX_RING_SIZE >= LZX_WINDOW_SIZE + 2 * 2 * CAB_MAX_THREADS * CAB_BLOCKSIZE);
+
+
+/* Classes */
+
+class CLZXCodec : public CCABCodec
+{
+public:
+    /* Default constructor */
+    CLZXCodec();
+    /* Default destructor */
+    virtual ~CLZXCodec();
+    /* Compresses a data block */
+    virtual ULONG Compress(void* OutputBuffer,
+                           void* InputBuffer,
+                           ULONG InputLength,
+                           PULONG OutputLength) override;
+    /* Uncompresses a data block */
+    virtual ULONG Uncompress(void* OutputBuffer,
+                             void* InputBuffer,
+                             ULONG InputLength,
+                             PULONG OutputLength) override;
+    virtual void Reset() override;
+    virtual ULONG PrepareBlock(PCAB_CODEC_BLOCK Block) override;
+    virtual ULONG CompressBlock(PCAB_CODEC_BLOCK Block) override;
+    virtual ULONG FinishBlock(PCAB_CODEC_BLOCK Block) override;
+private:
+    void TranslateE8(unsigned char* Data, ULONG Length, ULONG Position);
+    ULONG FindMatch(ULONG Position, ULONG End, const ULONG* Repeat, PULONG Distance);
+    ULONG GetPositionSlot(ULONG FormattedOffset);
+    bool WriteVerbatimBlock(PCAB_CODEC_BLOCK Block, const std::vector<ULONG>& Tokens, ULONG MaxLength);
+    void WriteUncompressedBlock(PCAB_CODEC_BLOCK Block);
+    ULONG PositionBase[LZX_NUM_POSITION_SLOTS + 1];
+    UCHAR ExtraBits[LZX_NUM_POSITION_SLOTS];
+    /* Stream state, owned by PrepareBlock */
+    std::vector<unsigned char> Window;  // Stream history, with the start mirrored at the end
+    std::vector<ULONG> Head;
+    std::vector<ULONG> Prev;
+    ULONG StreamPosition;
+    ULONG HashedPosition;
+    ULONG PreparedFrames;
+    /* Stream state, owned by FinishBlock */
+    bool HeaderWritten;
+    ULONG Repeat[3];
+    UCHAR MainLengths[LZX_MAINTREE_NUM_ELEMENTS];
+    UCHAR LengthLengths[LZX_NUM_SECONDARY_LENGTHS];
+};
+
+/* EOF */
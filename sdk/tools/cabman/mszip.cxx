@@ -66,45 +66,52 @@ ULONG CMSZipCodec::Compress(void* OutputBuffer,
  */
 {
     PUSHORT Magic;
+    z_stream Stream;
+    int Result;
 
     DPRINT(MAX_TRACE, ("InputLength (%u).\n", (UINT)InputLength));
 
     Magic  = (PUSHORT)OutputBuffer;
     *Magic = MSZIP_MAGIC;
 
-    ZStream.next_in   = (unsigned char*)InputBuffer;
-    ZStream.avail_in  = InputLength;
-    ZStream.next_out  = ((unsigned char *)OutputBuffer + 2);
-    ZStream.avail_out = CAB_BLOCKSIZE + 12;
+    /* Use a stream of our own, blocks are compressed on several threads at once */
+    Stream.zalloc    = MSZipAlloc;
+    Stream.zfree     = MSZipFree;
+    Stream.opaque    = (voidpf)0;
+    Stream.next_in   = (unsigned char*)InputBuffer;
+    Stream.avail_in  = InputLength;
+    Stream.next_out  = ((unsigned char *)OutputBuffer + 2);
+    Stream.avail_out = CAB_BLOCKSIZE + 12;
 
     /* WindowBits is passed < 0 to tell that there is no zlib header */
-    Status = deflateInit2(&ZStream,
+    Result = deflateInit2(&Stream,
                           Z_DEFAULT_COMPRESSION,
                           Z_DEFLATED,
                           -MAX_WBITS,
                           8, /* memLevel */
                           Z_DEFAULT_STRATEGY);
-    if (Status != Z_OK)
+    if (Result != Z_OK)
     {
-        DPRINT(MIN_TRACE, ("deflateInit() returned (%d).\n", Status));
+        DPRINT(MIN_TRACE, ("deflateInit() returned (%d).\n", Result));
         return CS_NOMEMORY;
     }
 
-    Status = deflate(&ZStream, Z_FINISH);
-    if ((Status != Z_OK) && (Status != Z_STREAM_END))
+    Result = deflate(&Stream, Z_FINISH);
+    if ((Result != Z_OK) && (Result != Z_STREAM_END))
     {
-        DPRINT(MIN_TRACE, ("deflate() returned (%d) (%s).\n", Status, ZStream.msg));
-        if (Status == Z_MEM_ERROR)
+        DPRINT(MIN_TRACE, ("deflate() returned (%d) (%s).\n", Result, Stream.msg));
+        deflateEnd(&Stream);
+        if (Result == Z_MEM_ERROR)
             return CS_NOMEMORY;
         return CS_BADSTREAM;
     }
 
-    *OutputLength = ZStream.total_out + 2;
+    *OutputLength = Stream.total_out + 2;
 
-    Status = deflateEnd(&ZStream);
-    if (Status != Z_OK)
+    Result = deflateEnd(&Stream);
+    if (Result != Z_OK)
     {
-        DPRINT(MIN_TRACE, ("deflateEnd() returned (%d).\n", Status));
+        DPRINT(MIN_TRACE, ("deflateEnd() returned (%d).\n", Result));
         return CS_BADSTREAM;
     }
 
@@ -0,0 +1,252 @@
+/*
+ * PROJECT:     ReactOS hive maker
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Subkey lookup benchmark on existing binary hives
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <time.h>
+
+#define NDEBUG
+#include "mkhive.h"
+
+/* Only keys with at least this many subkeys are worth measuring */
+#define BENCH_MIN_SUBKEYS 16
+#define BENCH_PASSES      10
+
+typedef struct _BENCH_LOOKUP
+{
+    HCELL_INDEX Parent;
+    HCELL_INDEX SubKey;
+    UNICODE_STRING Name;
+} BENCH_LOOKUP, *PBENCH_LOOKUP;
+
+typedef struct _BENCH_LIST
+{
+    PBENCH_LOOKUP Lookups;
+    ULONG Count;
+    ULONG MaxCount;
+    ULONG Keys;
+} BENCH_LIST, *PBENCH_LIST;
+
+/* FUNCTIONS ****************************************************************/
+
+static BOOL
+AddLookup(
+    IN OUT PBENCH_LIST List,
+    IN HCELL_INDEX Parent,
+    IN HCELL_INDEX SubKey,
+    IN PCM_KEY_NODE SubKeyNode)
+{
+    PBENCH_LOOKUP Lookup, NewLookups;
+    USHORT Length;
+
+    if (List->Count == List->MaxCount)
+    {
+        List->MaxCount = List->MaxCount ? List->MaxCount * 2 : 1024;
+        NewLookups = realloc(List->Lookups, List->MaxCount * sizeof(BENCH_LOOKUP));
+        if (!NewLookups)
+            return FALSE;
+        List->Lookups = NewLookups;
+    }
+
+    if (SubKeyNode->Flags & KEY_COMP_NAME)
+        Length = CmpCompressedNameSize(SubKeyNode->Name, SubKeyNode->NameLength);
+    else
+        Length = SubKeyNode->NameLength;
+
+    Lookup = &List->Lookups[List->Count];
+    Lookup->Parent = Parent;
+    Lookup->SubKey = SubKey;
+    Lookup->Name.Length = Length;
+    Lookup->Name.MaximumLength = Length;
+    Lookup->Name.Buffer = malloc(Length ? Length : sizeof(WCHAR));
+    if (!Lookup->Name.Buffer)
+        return FALSE;
+
+    if (SubKeyNode->Flags & KEY_COMP_NAME)
+        CmpCopyCompressedName(Lookup->Name.Buffer, Length, SubKeyNode->Name, SubKeyNode->NameLength);
+    else
+        RtlCopyMemory(Lookup->Name.Buffer, SubKeyNode->Name, Length);
+
+    List->Count++;
+    return TRUE;
+}
+
+static BOOL
+CollectLookups(
+    IN PHHIVE Hive,
+    IN HCELL_INDEX Cell,
+    IN ULONG Depth,
+    IN OUT PBENCH_LIST List)
+{
+    PCM_KEY_NODE Node, SubKeyNode;
+    HCELL_INDEX SubKeyCell;
+    BOOL Success = TRUE;
+    ULONG i;
+
+    /* Don't get lost in a corrupted hive */
+    if (Depth > 512)
+        return TRUE;
+
+    Node = (PCM_KEY_NODE)HvGetCell(Hive, Cell);
+    if (!Node)
+        return FALSE;
+
+    if (Node->SubKeyCounts[Stable] >= BENCH_MIN_SUBKEYS)
+        List->Keys++;
+
+    for (i = 0; Success && i < Node->SubKeyCounts[Stable]; i++)
+    {
+        SubKeyCell = CmpFindSubKeyByNumber(Hive, Node, i);
+        if (SubKeyCell == HCELL_NIL)
+        {
+            Success = FALSE;
+            break;
+        }
+
+        /* Remember how to look the subkey up again by its name */
+        if (Node->SubKeyCounts[Stable] >= BENCH_MIN_SUBKEYS)
+        {
+            SubKeyNode = (PCM_KEY_NODE)HvGetCell(Hive, SubKeyCell);
+            if (!SubKeyNode)
+            {
+                Success = FALSE;
+                break;
+            }
+
+            Success = AddLookup(List, Cell, SubKeyCell, SubKeyNode);
+            HvReleaseCell(Hive, SubKeyCell);
+        }
+
+        if (Success)
+            Success = CollectLookups(Hive, SubKeyCell, Depth + 1, List);
+    }
+
+    HvReleaseCell(Hive, Cell);
+    return Success;
+}
+
+static BOOL
+BenchmarkPass(
+    IN PHHIVE Hive,
+    IN PBENCH_LIST List,
+    IN ULONG Threshold,
+    IN PCSTR Description)
+{
+    PBENCH_LOOKUP Lookup;
+    PCM_KEY_NODE Node;
+    clock_t Start, End;
+    ULONG Pass, i, Mismatches = 0;
+
+    CmpSubKeyIndexThreshold = Threshold;
+
+    Start = clock();
+    for (Pass = 0; Pass < BENCH_PASSES; Pass++)
+    {
+        for (i = 0; i < List->Count; i++)
+        {
+            Lookup = &List->Lookups[i];
+            Node = (PCM_KEY_NODE)HvGetCell(Hive, Lookup->Parent);
+            if (CmpFindSubKeyByName(Hive, Node, &Lookup->Name) != Lookup->SubKey)
+                Mismatches++;
+            HvReleaseCell(Hive, Lookup->Parent);
+        }
+    }
+    End = clock();
+
+    printf("  %-16s %lu lookups, %lu mismatches, %.1f ms\n",
+           Description,
+           List->Count * BENCH_PASSES,
+           Mismatches,
+           (double)(End - Start) * 1000.0 / CLOCKS_PER_SEC);
+
+    return (Mismatches == 0);
+}
+
+BOOL
+BenchmarkHive(
+    IN PCSTR FileName)
+{
+    NTSTATUS Status;
+    HHIVE Hive;
+    FILE *File;
+    PVOID HiveData;
+    long Size;
+    BENCH_LIST List = { 0 };
+    ULONG OldThreshold = CmpSubKeyIndexThreshold;
+    BOOL Success = FALSE;
+    ULONG i;
+
+    File = fopen(FileName, "rb");
+    if (!File)
+    {
+        fprintf(stderr, "Could not open %s\n", FileName);
+        return FALSE;
+    }
+
+    fseek(File, 0, SEEK_END);
+    Size = ftell(File);
+    fseek(File, 0, SEEK_SET);
+
+    HiveData = (Size > 0) ? malloc(Size) : NULL;
+    if (!HiveData || fread(HiveData, 1, Size, File) != (size_t)Size)
+    {
+        fprintf(stderr, "Could not read %s\n", FileName);
+        free(HiveData);
+        fclose(File);
+        return FALSE;
+    }
+    fclose(File);
+
+    /* Map the whole file as a flat read-only hive */
+    RtlZeroMemory(&Hive, sizeof(Hive));
+    Status = HvInitialize(&Hive,
+                          HINIT_FLAT,
+                          0,
+                          HFILE_TYPE_PRIMARY,
+                          HiveData,
+                          CmpAllocate,
+                          CmpFree,
+                          NULL,
+                          NULL,
+                          NULL,
+                          NULL,
+                          1,
+                          NULL);
+    if (!NT_SUCCESS(Status))
+    {
+        fprintf(stderr, "%s is not a valid hive (Status 0x%08lx)\n", FileName, Status);
+        free(HiveData);
+        return FALSE;
+    }
+
+    if (!CollectLookups(&Hive, Hive.BaseBlock->RootCell, 0, &List))
+    {
+        fprintf(stderr, "Could not enumerate the keys of %s\n", FileName);
+    }
+    else
+    {
+        printf("Benchmarking subkey lookups in %s: %lu keys with at least %d subkeys, %d passes\n",
+               FileName, List.Keys, BENCH_MIN_SUBKEYS, BENCH_PASSES);
+
+        /* Compare the plain search of the index cells against the hash index */
+        Success = BenchmarkPass(&Hive, &List, MAXULONG, "binary search:") &&
+                  BenchmarkPass(&Hive, &List, OldThreshold, "hash index:");
+    }
+
+    for (i = 0; i < List.Count; i++)
+    {
+        free(List.Lookups[i].Name.Buffer);
+    }
+    free(List.Lookups);
+
+    CmpSubKeyIndexThreshold = OldThreshold;
+    HvFree(&Hive);
+    free(HiveData);
+
+    return Success;
+}
+
+/* EOF */
@@ -0,0 +1,13 @@
+/*
+ * PROJECT:     ReactOS hive maker
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Subkey lookup benchmark on existing binary hives
+ */
+
+#pragma once
+
+BOOL
+BenchmarkHive(
+    IN PCSTR FileName);
+
+/* EOF */
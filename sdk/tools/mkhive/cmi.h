@@ -28,6 +28,19 @@
 
 #define VERIFY_KEY_CELL(key)
 
+PVOID
+NTAPI
+CmpAllocate(
+    IN SIZE_T Size,
+    IN BOOLEAN Paged,
+    IN ULONG Tag);
+
+VOID
+NTAPI
+CmpFree(
+    IN PVOID Ptr,
+    IN ULONG Quota);
+
 NTSTATUS
 CmiInitializeHive(
     IN OUT PCMHIVE Hive,
@@ -54,12 +54,14 @@
 
 void usage(void)
 {
-    printf("Usage: mkhive [-?] -h:hive1[,hiveN...] [-u] -d:<dstdir> <inffiles>\n\n"
+    printf("Usage: mkhive [-?] -h:hive1[,hiveN...] [-u] -d:<dstdir> <inffiles>\n"
+           "       mkhive -b:<hivefile>\n\n"
            "  -h:hiveN  - Comma-separated list of hives to create. Possible values are:\n"
            "              SETUPREG, SYSTEM, SOFTWARE, DEFAULT, SAM, SECURITY, BCD.\n"
            "  -u        - Generate file names in uppercase (default: lowercase) (TEMPORARY FLAG!).\n"
            "  -d:dstdir - The binary hive files are created in this directory.\n"
            "  inffiles  - List of INF files with full path.\n"
+           "  -b:hive   - Benchmarks subkey lookups in an existing binary hive file.\n"
            "  -?        - Displays this help screen.\n");
 }
 
@@ -101,6 +103,13 @@ int main(int argc, char *argv[])
     CHAR DestPath[PATH_MAX] = "";
     CHAR FileName[PATH_MAX];
 
+    /* Benchmark mode only takes the hive to measure */
+    if (argc == 2 && argv[1][0] == '-' && argv[1][1] == 'b' &&
+        (argv[1][2] == ':' || argv[1][2] == '='))
+    {
+        return BenchmarkHive(argv[1] + 3) ? 0 : -1;
+    }
+
     if (argc < 4)
     {
         usage();
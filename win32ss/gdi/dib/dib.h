@@ -123,6 +123,25 @@ BOOLEAN DIB_32BPP_TransparentBlt(SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,XLATEOBJ*,ULONG
 BOOLEAN DIB_32BPP_ColorFill(SURFOBJ*, RECTL*, ULONG);
 BOOLEAN DIB_32BPP_AlphaBlend(SURFOBJ*, SURFOBJ*, RECTL*, RECTL*, CLIPOBJ*, XLATEOBJ*, BLENDOBJ*);
 
+typedef VOID (*PFN_DIB_32BPP_BlendSpan)(PULONG,const ULONG*,ULONG,UCHAR,BOOLEAN);
+
+typedef struct _DIB_SPAN_STATE
+{
+  PFN_DIB_32BPP_BlendSpan BlendSpan;
+#if defined(_M_IX86)
+  BOOLEAN FloatSaved;
+  KFLOATING_SAVE FloatSave;
+#endif
+} DIB_SPAN_STATE, *PDIB_SPAN_STATE;
+
+VOID DIB_32BPP_BlendSpanC(PULONG,const ULONG*,ULONG,UCHAR,BOOLEAN);
+#if defined(_M_IX86) || defined(_M_AMD64)
+VOID DIB_32BPP_BlendSpanSSE2(PULONG,const ULONG*,ULONG,UCHAR,BOOLEAN);
+#endif
+VOID DIB_32BPP_BeginSpans(PDIB_SPAN_STATE,ULONG);
+VOID DIB_32BPP_EndSpans(PDIB_SPAN_STATE);
+VOID DIB_32BPP_StretchSpan(PULONG,const ULONG*,ULONG,ULONG,ULONG,ULONG);
+
 BOOLEAN DIB_XXBPP_StretchBlt(SURFOBJ*,SURFOBJ*,SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,POINTL*,BRUSHOBJ*,POINTL*,XLATEOBJ*,ROP4);
 BOOLEAN DIB_XXBPP_FloodFillSolid(SURFOBJ*, BRUSHOBJ*, RECTL*, POINTL*, ULONG, UINT);
 BOOLEAN DIB_XXBPP_AlphaBlend(SURFOBJ*, SURFOBJ*, RECTL*, RECTL*, CLIPOBJ*, XLATEOBJ*, BLENDOBJ*);
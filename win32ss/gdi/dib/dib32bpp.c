@@ -50,6 +50,87 @@ DIB_32BPP_VLine(SURFOBJ *SurfObj, LONG x, LONG y1, LONG y2, ULONG c)
   }
 }
 
+/* Pixels translated at once by DIB_32BPP_BitBltSrcCopyXlate */
+#define XLATE_CHUNK 64
+
+/*
+ * Copies and translates whole rows with the span function of the XLATEOBJ,
+ * for unflipped blits between different surfaces. Returns FALSE if the
+ * source format is not handled here.
+ */
+static BOOLEAN
+DIB_32BPP_BitBltSrcCopyXlate(PBLTINFO BltInfo, LONG DestWidth, LONG DestHeight)
+{
+  PFN_XLATE_SPAN pfnXlateSpan;
+  PEXLATEOBJ pexlo = (PEXLATEOBJ)BltInfo->XlateSourceToDest;
+  ULONG Chunk[XLATE_CHUNK];
+  PBYTE SourceLine, DestLine, SourceBits;
+  PULONG Dest32;
+  LONG Row, Col, Count, i;
+  ULONG BytesPerPixel;
+
+  switch (BltInfo->SourceSurface->iBitmapFormat)
+  {
+  case BMF_8BPP:  BytesPerPixel = 1; break;
+  case BMF_16BPP: BytesPerPixel = 2; break;
+  case BMF_24BPP: BytesPerPixel = 3; break;
+  case BMF_32BPP: BytesPerPixel = 4; break;
+  default: return FALSE;
+  }
+
+  pfnXlateSpan = XLATEOBJ_pfnXlateSpan(BltInfo->XlateSourceToDest);
+
+  SourceLine = (PBYTE)BltInfo->SourceSurface->pvScan0
+    + (BltInfo->SourcePoint.y * BltInfo->SourceSurface->lDelta)
+    + BytesPerPixel * BltInfo->SourcePoint.x;
+  DestLine = (PBYTE)BltInfo->DestSurface->pvScan0
+    + (BltInfo->DestRect.top * BltInfo->DestSurface->lDelta)
+    + 4 * BltInfo->DestRect.left;
+
+  for (Row = 0; Row < DestHeight; Row++)
+  {
+    Dest32 = (PULONG)DestLine;
+
+    if (BytesPerPixel == 4)
+    {
+      pfnXlateSpan(pexlo, Dest32, (PULONG)SourceLine, DestWidth);
+    }
+    else
+    {
+      /* Widen the source pixels to ULONGs, then translate them into the row */
+      SourceBits = SourceLine;
+      for (Col = 0; Col < DestWidth; Col += Count)
+      {
+        Count = min(DestWidth - Col, XLATE_CHUNK);
+
+        switch (BytesPerPixel)
+        {
+        case 1:
+          for (i = 0; i < Count; i++)
+            Chunk[i] = SourceBits[i];
+          break;
+        case 2:
+          for (i = 0; i < Count; i++)
+            Chunk[i] = ((PUSHORT)SourceBits)[i];
+          break;
+        case 3:
+          for (i = 0; i < Count; i++)
+            Chunk[i] = SourceBits[3 * i] | (SourceBits[3 * i + 1] << 8) | (SourceBits[3 * i + 2] << 16);
+          break;
+        }
+
+        pfnXlateSpan(pexlo, Dest32 + Col, Chunk, Count);
+        SourceBits += Count * BytesPerPixel;
+      }
+    }
+
+    SourceLine += BltInfo->SourceSurface->lDelta;
+    DestLine += BltInfo->DestSurface->lDelta;
+  }
+
+  return TRUE;
+}
+
 BOOLEAN
 DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
 {
@@ -104,6 +185,16 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
   DestWidth = BltInfo->DestRect.right - BltInfo->DestRect.left;
   DestHeight = BltInfo->DestRect.bottom - BltInfo->DestRect.top;
 
+  /* Translate whole rows at once when not flipping and not copying within a surface */
+  if (BltInfo->XlateSourceToDest != NULL &&
+      (BltInfo->XlateSourceToDest->flXlate & XO_TRIVIAL) == 0 &&
+      !bTopToBottom && !bLeftToRight &&
+      BltInfo->SourceSurface->pvScan0 != BltInfo->DestSurface->pvScan0 &&
+      DIB_32BPP_BitBltSrcCopyXlate(BltInfo, DestWidth, DestHeight))
+  {
+    return TRUE;
+  }
+
   DestBits = (PBYTE)BltInfo->DestSurface->pvScan0
     + (BltInfo->DestRect.top * BltInfo->DestSurface->lDelta)
     + 4 * BltInfo->DestRect.left;
@@ -743,32 +834,22 @@ DIB_32BPP_TransparentBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf,
   return TRUE;
 }
 
-typedef union {
-  ULONG ul;
-  struct {
-    UCHAR red;
-    UCHAR green;
-    UCHAR blue;
-    UCHAR alpha;
-  } col;
-} NICEPIXEL32;
-
-static __inline UCHAR
-Clamp8(ULONG val)
-{
-  return (val > 255) ? 255 : (UCHAR)val;
-}
+/* Pixels gathered on the stack per call of the blend kernel */
+#define ALPHABLEND_CHUNK 64
 
 BOOLEAN
 DIB_32BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
                      RECTL* SourceRect, CLIPOBJ* ClipRegion,
                      XLATEOBJ* ColorTranslation, BLENDOBJ* BlendObj)
 {
-  INT Rows, Cols, SrcX, SrcY;
-  register PULONG Dst;
+  INT Row, Col, Count, i, SrcX, SrcY;
+  INT DstWidth, DstHeight, SrcWidth, SrcHeight;
+  PULONG Dst, SrcRow;
+  ULONG Chunk[ALPHABLEND_CHUNK];
   BLENDFUNCTION BlendFunc;
-  register NICEPIXEL32 DstPixel, SrcPixel;
-  UCHAR Alpha, SrcBpp;
+  BOOLEAN SourceAlpha, Direct;
+  UCHAR SrcBpp;
+  DIB_SPAN_STATE Spans;
 
   DPRINT("DIB_32BPP_AlphaBlend: SourceRect: (%d,%d)-(%d,%d), DestRect: (%d,%d)-(%d,%d)\n",
     SourceRect->left, SourceRect->top, SourceRect->right, SourceRect->bottom,
@@ -797,42 +878,63 @@ DIB_32BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
     return FALSE;
   }
 
-  Dst = (PULONG)((ULONG_PTR)Dest->pvScan0 + (DestRect->top * Dest->lDelta) +
-    (DestRect->left << 2));
+  DstWidth = DestRect->right - DestRect->left;
+  DstHeight = DestRect->bottom - DestRect->top;
+  SrcWidth = SourceRect->right - SourceRect->left;
+  SrcHeight = SourceRect->bottom - SourceRect->top;
+  if (DstWidth <= 0 || DstHeight <= 0)
+    return TRUE;
+
   SrcBpp = BitsPerFormat(Source->iBitmapFormat);
+  SourceAlpha = (BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0;
+
+  /* Untranslated 32bpp sources are blended straight from the source bits */
+  Direct = (SrcBpp == 32 && SrcWidth > 0 &&
+            (!ColorTranslation || (ColorTranslation->flXlate & XO_TRIVIAL)));
+
+  DIB_32BPP_BeginSpans(&Spans, DstWidth * DstHeight);
 
-  Rows = 0;
-   SrcY = SourceRect->top;
-   while (++Rows <= DestRect->bottom - DestRect->top)
+  for (Row = 0; Row < DstHeight; Row++)
   {
-    Cols = 0;
-    SrcX = SourceRect->left;
-    while (++Cols <= DestRect->right - DestRect->left)
+    SrcY = SourceRect->top + (Row * SrcHeight) / DstHeight;
+    Dst = (PULONG)((ULONG_PTR)Dest->pvScan0 + ((DestRect->top + Row) * Dest->lDelta) +
+                   (DestRect->left << 2));
+
+    if (Direct && SrcWidth == DstWidth)
     {
-      SrcPixel.ul = DIB_GetSource(Source, SrcX, SrcY, ColorTranslation);
-      SrcPixel.col.red = (SrcPixel.col.red * BlendFunc.SourceConstantAlpha) / 255;
-      SrcPixel.col.green = (SrcPixel.col.green * BlendFunc.SourceConstantAlpha)  / 255;
-      SrcPixel.col.blue = (SrcPixel.col.blue * BlendFunc.SourceConstantAlpha) / 255;
-      SrcPixel.col.alpha = (32 == SrcBpp) ?
-                        (SrcPixel.col.alpha * BlendFunc.SourceConstantAlpha) / 255 :
-                        BlendFunc.SourceConstantAlpha ;
-
-      Alpha = ((BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0) ?
-           SrcPixel.col.alpha : BlendFunc.SourceConstantAlpha ;
-
-      DstPixel.ul = *Dst;
-      DstPixel.col.red = Clamp8((DstPixel.col.red * (255 - Alpha)) / 255 + SrcPixel.col.red) ;
-      DstPixel.col.green = Clamp8((DstPixel.col.green * (255 - Alpha)) / 255 + SrcPixel.col.green) ;
-      DstPixel.col.blue = Clamp8((DstPixel.col.blue * (255 - Alpha)) / 255 + SrcPixel.col.blue) ;
-      DstPixel.col.alpha = Clamp8((DstPixel.col.alpha * (255 - Alpha)) / 255 + SrcPixel.col.alpha) ;
-      *Dst++ = DstPixel.ul;
-      SrcX = SourceRect->left + (Cols*(SourceRect->right - SourceRect->left))/(DestRect->right - DestRect->left);
+      SrcRow = (PULONG)((ULONG_PTR)Source->pvScan0 + (SrcY * Source->lDelta)) + SourceRect->left;
+      Spans.BlendSpan(Dst, SrcRow, DstWidth, BlendFunc.SourceConstantAlpha, SourceAlpha);
+      continue;
+    }
+
+    for (Col = 0; Col < DstWidth; Col += Count)
+    {
+      Count = min(DstWidth - Col, ALPHABLEND_CHUNK);
+
+      if (Direct)
+      {
+        SrcRow = (PULONG)((ULONG_PTR)Source->pvScan0 + (SrcY * Source->lDelta)) + SourceRect->left;
+        DIB_32BPP_StretchSpan(Chunk, SrcRow, Col, Count, DstWidth, SrcWidth);
+      }
+      else
+      {
+        for (i = 0; i < Count; i++)
+        {
+          SrcX = SourceRect->left + ((Col + i) * SrcWidth) / DstWidth;
+          Chunk[i] = DIB_GetSource(Source, SrcX, SrcY, ColorTranslation);
+
+          /* Only 32bpp sources have an alpha channel, the others are opaque */
+          if (SrcBpp != 32)
+            Chunk[i] |= 0xFF000000;
+        }
+      }
+
+      Spans.BlendSpan(Dst + Col, Chunk, Count, BlendFunc.SourceConstantAlpha, SourceAlpha);
     }
-    Dst = (PULONG)((ULONG_PTR)Dest->pvScan0 + ((DestRect->top + Rows) * Dest->lDelta) +
-                (DestRect->left << 2));
-    SrcY = SourceRect->top + (Rows*(SourceRect->bottom - SourceRect->top))/(DestRect->bottom - DestRect->top);
   }
 
+  DIB_32BPP_EndSpans(&Spans);
+
   return TRUE;
 }
 
@@ -0,0 +1,226 @@
+/*
+ * PROJECT:     ReactOS Win32k subsystem
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Span kernels for 32bpp AlphaBlend and StretchBlt
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+/*
+ * The blend kernels produce exactly what the per-pixel AlphaBlend code
+ * always did: every channel is computed as
+ *
+ *   min(255, Dst * (255 - Alpha) / 255 + Src * SourceConstantAlpha / 255)
+ *
+ * with truncating divisions. x / 255 is computed as (x + 1 + (x >> 8)) >> 8,
+ * which is exact for 0 <= x <= 255 * 255 and fits in 16 bits, so the SSE2
+ * kernel can work on eight channels at once and the C one on two.
+ */
+
+#ifndef UNIT_TEST
+
+#include <win32k.h>
+
+#define NDEBUG
+#include <debug.h>
+
+#endif /* UNIT_TEST */
+
+#if defined(_M_IX86) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define DIB_HAVE_SSE2
+#endif
+
+/* Below this many pixels saving the FPU state costs more than SSE2 saves */
+#define DIB_SSE2_MIN_PIXELS 1024
+
+#define DIV255(x) (((x) + 1 + ((x) >> 8)) >> 8)
+
+/* The same on two 16-bit lanes of a ULONG, and the clamp of each lane to 255 */
+#define DIV255X2(x)     ((((x) + 0x00010001 + (((x) >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF)
+#define CLAMP255X2(x)   (((x) | (((x) & 0x01000100) >> 8) * 0xFF) & 0x00FF00FF)
+
+VOID
+DIB_32BPP_BlendSpanC(
+    _Inout_updates_(Count) PULONG Dst,
+    _In_reads_(Count) const ULONG *Src,
+    _In_ ULONG Count,
+    _In_ UCHAR SourceConstantAlpha,
+    _In_ BOOLEAN SourceAlpha)
+{
+    ULONG SrcRB, SrcAG, DstRB, DstAG, Alpha;
+
+    while (Count--)
+    {
+        /* Blue and red in one ULONG, green and alpha in the other */
+        SrcRB = DIV255X2((*Src & 0x00FF00FF) * SourceConstantAlpha);
+        SrcAG = DIV255X2(((*Src >> 8) & 0x00FF00FF) * SourceConstantAlpha);
+        Src++;
+
+        Alpha = SourceAlpha ? (SrcAG >> 16) : SourceConstantAlpha;
+
+        DstRB = DIV255X2((*Dst & 0x00FF00FF) * (255 - Alpha)) + SrcRB;
+        DstAG = DIV255X2(((*Dst >> 8) & 0x00FF00FF) * (255 - Alpha)) + SrcAG;
+
+        *Dst++ = CLAMP255X2(DstRB) | (CLAMP255X2(DstAG) << 8);
+    }
+}
+
+#ifdef DIB_HAVE_SSE2
+
+static __inline __m128i __ATTRIBUTE_SSE2__
+Div255Epu16(__m128i Value)
+{
+    __m128i High = _mm_srli_epi16(Value, 8);
+
+    Value = _mm_add_epi16(Value, _mm_set1_epi16(1));
+    return _mm_srli_epi16(_mm_add_epi16(Value, High), 8);
+}
+
+/* Blends two pixels that are unpacked to 16 bits per channel */
+static __inline __m128i __ATTRIBUTE_SSE2__
+BlendEpu16(__m128i Src, __m128i Dst, __m128i ConstAlpha, BOOLEAN SourceAlpha)
+{
+    __m128i Alpha;
+
+    Src = Div255Epu16(_mm_mullo_epi16(Src, ConstAlpha));
+
+    if (SourceAlpha)
+        Alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(Src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    else
+        Alpha = ConstAlpha;
+
+    Alpha = _mm_sub_epi16(_mm_set1_epi16(255), Alpha);
+    Dst = Div255Epu16(_mm_mullo_epi16(Dst, Alpha));
+
+    /* packus clamps the sum to 255 */
+    return _mm_add_epi16(Dst, Src);
+}
+
+VOID
+__ATTRIBUTE_SSE2__
+DIB_32BPP_BlendSpanSSE2(
+    _Inout_updates_(Count) PULONG Dst,
+    _In_reads_(Count) const ULONG *Src,
+    _In_ ULONG Count,
+    _In_ UCHAR SourceConstantAlpha,
+    _In_ BOOLEAN SourceAlpha)
+{
+    __m128i Zero = _mm_setzero_si128();
+    __m128i ConstAlpha = _mm_set1_epi16(SourceConstantAlpha);
+    __m128i SrcPixels, DstPixels, Low, High;
+
+    for (; Count >= 4; Count -= 4, Src += 4, Dst += 4)
+    {
+        SrcPixels = _mm_loadu_si128((const __m128i *)Src);
+        DstPixels = _mm_loadu_si128((const __m128i *)Dst);
+
+        Low = BlendEpu16(_mm_unpacklo_epi8(SrcPixels, Zero),
+                         _mm_unpacklo_epi8(DstPixels, Zero),
+                         ConstAlpha, SourceAlpha);
+        High = BlendEpu16(_mm_unpackhi_epi8(SrcPixels, Zero),
+                          _mm_unpackhi_epi8(DstPixels, Zero),
+                          ConstAlpha, SourceAlpha);
+
+        _mm_storeu_si128((__m128i *)Dst, _mm_packus_epi16(Low, High));
+    }
+
+    for (; Count > 0; Count--, Src++, Dst++)
+    {
+        Low = BlendEpu16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(*Src), Zero),
+                         _mm_unpacklo_epi8(_mm_cvtsi32_si128(*Dst), Zero),
+                         ConstAlpha, SourceAlpha);
+
+        *Dst = _mm_cvtsi128_si32(_mm_packus_epi16(Low, Zero));
+    }
+}
+
+#endif /* DIB_HAVE_SSE2 */
+
+/*
+ * Picks the blend kernel for a blit of PixelCount pixels. Must be paired
+ * with DIB_32BPP_EndSpans, which restores the FPU state on x86.
+ */
+VOID
+DIB_32BPP_BeginSpans(
+    _Out_ PDIB_SPAN_STATE State,
+    _In_ ULONG PixelCount)
+{
+    State->BlendSpan = DIB_32BPP_BlendSpanC;
+
+#if defined(_M_AMD64)
+    /* SSE2 is always there, and the XMM registers are volatile */
+    UNREFERENCED_PARAMETER(PixelCount);
+    State->BlendSpan = DIB_32BPP_BlendSpanSSE2;
+#elif defined(_M_IX86)
+    State->FloatSaved = FALSE;
+    if (PixelCount >= DIB_SSE2_MIN_PIXELS &&
+        ExIsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) &&
+        NT_SUCCESS(KeSaveFloatingPointState(&State->FloatSave)))
+    {
+        State->FloatSaved = TRUE;
+        State->BlendSpan = DIB_32BPP_BlendSpanSSE2;
+    }
+#else
+    UNREFERENCED_PARAMETER(PixelCount);
+#endif
+}
+
+VOID
+DIB_32BPP_EndSpans(
+    _Inout_ PDIB_SPAN_STATE State)
+{
+#if defined(_M_IX86)
+    if (State->FloatSaved)
+    {
+        KeRestoreFloatingPointState(&State->FloatSave);
+        State->FloatSaved = FALSE;
+    }
+#else
+    UNREFERENCED_PARAMETER(State);
+#endif
+}
+
+/*
+ * Nearest-neighbour resampling of Count pixels of a row, starting at column
+ * Start: Dst[i] = Src[(Start + i) * SrcWidth / DstWidth], the same columns
+ * the per-pixel code picks, without a division per pixel.
+ */
+VOID
+DIB_32BPP_StretchSpan(
+    _Out_writes_(Count) PULONG Dst,
+    _In_ const ULONG *Src,
+    _In_ ULONG Start,
+    _In_ ULONG Count,
+    _In_ ULONG DstWidth,
+    _In_ ULONG SrcWidth)
+{
+    ULONGLONG Position;
+    ULONG Step, Fraction, Error, Index, i;
+
+    if (SrcWidth == DstWidth)
+    {
+        RtlCopyMemory(Dst, Src + Start, Count * sizeof(ULONG));
+        return;
+    }
+
+    Position = (ULONGLONG)Start * SrcWidth;
+    Index = (ULONG)(Position / DstWidth);
+    Error = (ULONG)(Position % DstWidth);
+    Step = SrcWidth / DstWidth;
+    Fraction = SrcWidth % DstWidth;
+
+    for (i = 0; i < Count; i++)
+    {
+        Dst[i] = Src[Index];
+
+        Index += Step;
+        Error += Fraction;
+        if (Error >= DstWidth)
+        {
+            Error -= DstWidth;
+            Index++;
+        }
+    }
+}
+
+/* EOF */
@@ -14,6 +14,38 @@
 #define NDEBUG
 #include <debug.h>
 
+/* Nearest-neighbour SRCCOPY between two 32bpp surfaces that need no translation */
+static VOID
+DIB_32BPP_StretchBltSrcCopy(SURFOBJ *DestSurf, SURFOBJ *SourceSurf,
+                            RECTL *DestRect, RECTL *SourceRect)
+{
+  LONG DesY, sy, LastSy = -1;
+  LONG DstHeight = DestRect->bottom - DestRect->top;
+  LONG DstWidth = DestRect->right - DestRect->left;
+  LONG SrcHeight = SourceRect->bottom - SourceRect->top;
+  LONG SrcWidth = SourceRect->right - SourceRect->left;
+  PULONG DstRow, SrcRow, LastRow = NULL;
+
+  for (DesY = DestRect->top; DesY < DestRect->bottom; DesY++)
+  {
+    sy = SourceRect->top + (DesY - DestRect->top) * SrcHeight / DstHeight;
+    DstRow = (PULONG)((ULONG_PTR)DestSurf->pvScan0 + DesY * DestSurf->lDelta) + DestRect->left;
+
+    if (sy == LastSy)
+    {
+      /* Stretching vertically repeats a source row, copy it from the row done before */
+      RtlCopyMemory(DstRow, LastRow, DstWidth * sizeof(ULONG));
+      continue;
+    }
+
+    SrcRow = (PULONG)((ULONG_PTR)SourceSurf->pvScan0 + sy * SourceSurf->lDelta) + SourceRect->left;
+    DIB_32BPP_StretchSpan(DstRow, SrcRow, 0, DstWidth, DstWidth, SrcWidth);
+
+    LastRow = DstRow;
+    LastSy = sy;
+  }
+}
+
 BOOLEAN DIB_XXBPP_StretchBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf, SURFOBJ *MaskSurf,
                             SURFOBJ *PatternSurface,
                             RECTL *DestRect, RECTL *SourceRect,
@@ -99,6 +131,25 @@ BOOLEAN DIB_XXBPP_StretchBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf, SURFOBJ *Ma
 
   /* FIXME: MaskOrigin? */
 
+  /*
+   * The common case: a plain copy between two 32bpp bitmaps, with the whole
+   * source rectangle inside the source bitmap so that no pixel is skipped
+   */
+  if (ROP == ROP4_SRCCOPY && !MaskSurf &&
+      DestSurf->iBitmapFormat == BMF_32BPP &&
+      SourceSurf->iBitmapFormat == BMF_32BPP &&
+      SourceSurf->pvScan0 != DestSurf->pvScan0 &&
+      (!ColorTranslation || (ColorTranslation->flXlate & XO_TRIVIAL)) &&
+      !bLeftToRight && !bTopToBottom &&
+      DstWidth > 0 && DstHeight > 0 && SrcWidth > 0 && SrcHeight > 0 &&
+      SourceRect->left >= 0 && SourceRect->top >= 0 &&
+      SourceRect->right <= SourceSurf->sizlBitmap.cx &&
+      SourceRect->bottom <= SourceCy)
+  {
+    DIB_32BPP_StretchBltSrcCopy(DestSurf, SourceSurf, DestRect, SourceRect);
+    return TRUE;
+  }
+
   switch(DestSurf->iBitmapFormat)
   {
   case BMF_1BPP: xxBPPMask = 0x1; break;
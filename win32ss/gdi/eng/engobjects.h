@@ -134,6 +134,8 @@ typedef struct _SHARED_FACE {
   PSHARED_MEM   Memory;
   SHARED_FACE_CACHE EnglishUS;
   SHARED_FACE_CACHE UserLanguage;
+  LIST_ENTRY    GlyphCacheListHead; /* FONT_CACHE_ENTRY.FaceEntry, LRU order */
+  SIZE_T        GlyphCacheSize;
 } SHARED_FACE, *PSHARED_FACE;
 
 typedef struct _FONTGDI {
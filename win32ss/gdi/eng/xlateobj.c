@@ -6,11 +6,19 @@
  * PROGRAMER:        Timo Kreuzer (timo.kreuzer@reactos.org)
  */
 
+#ifndef UNIT_TEST
+
 #include <win32k.h>
 
 #define NDEBUG
 #include <debug.h>
 
+#endif /* UNIT_TEST */
+
+#if defined(_M_AMD64)
+#include <emmintrin.h>
+#endif
+
 _Post_satisfies_(return==iColor)
 _Function_class_(FN_XLATE)
 ULONG
@@ -19,11 +27,22 @@ EXLATEOBJ_iXlateTrivial(
     _In_ PEXLATEOBJ pexlo,
     _In_ ULONG iColor);
 
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanTrivial(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels);
+
 /** Globals *******************************************************************/
 
-EXLATEOBJ gexloTrivial = {{0, XO_TRIVIAL, 0, 0, 0, 0}, EXLATEOBJ_iXlateTrivial};
+EXLATEOBJ gexloTrivial = {{0, XO_TRIVIAL, 0, 0, 0, 0}, EXLATEOBJ_iXlateTrivial, EXLATEOBJ_vXlateSpanTrivial};
 
+#ifndef UNIT_TEST
 static ULONG giUniqueXlate = 0;
+#endif
 
 static const BYTE gajXlate5to8[32] =
 {  0,  8, 16, 25, 33, 41, 49, 58, 66, 74, 82, 90, 99,107,115,123,
@@ -350,6 +369,421 @@ EXLATEOBJ_iXlateBitfieldsToPal(PEXLATEOBJ pexlo, ULONG iColor)
     return PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
 }
 
+/** Span xlate functions ******************************************************/
+
+/*
+ * The span functions translate whole rows with the iXlate functions above
+ * called directly, which saves an indirect call per pixel. The conversions
+ * that only shift and mask also have SSE2 versions on amd64, where the XMM
+ * registers can be used without saving the FPU state first.
+ */
+
+#define DEFINE_XLATE_SPAN(name) \
+_Function_class_(FN_XLATE_SPAN) \
+VOID \
+FASTCALL \
+EXLATEOBJ_vXlateSpan##name( \
+    _In_ PEXLATEOBJ pexlo, \
+    _Out_writes_(cPixels) PULONG pulDst, \
+    _In_reads_(cPixels) const ULONG *pulSrc, \
+    _In_ ULONG cPixels) \
+{ \
+    while (cPixels--) \
+        *pulDst++ = EXLATEOBJ_iXlate##name(pexlo, *pulSrc++); \
+}
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanTrivial(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    if (pulDst != pulSrc)
+        RtlMoveMemory(pulDst, pulSrc, cPixels * sizeof(ULONG));
+}
+
+/* For the translations without a span version of their own */
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanGeneric(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    PFN_XLATE pfnXlate = pexlo->pfnXlate;
+
+    while (cPixels--)
+        *pulDst++ = pfnXlate(pexlo, *pulSrc++);
+}
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanTable(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    PULONG pulXlate = pexlo->xlo.pulXlate;
+    ULONG cEntries = pexlo->xlo.cEntries;
+    ULONG iColor;
+
+    while (cPixels--)
+    {
+        iColor = *pulSrc++;
+        *pulDst++ = (iColor < cEntries) ? pulXlate[iColor] : 0;
+    }
+}
+
+/*
+ * Looking up the nearest palette index is expensive, and rows tend to have
+ * runs of the same color, so remember the last color that was looked up.
+ */
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanToPal(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    PFN_XLATE pfnXlate = pexlo->pfnXlate;
+    ULONG iColor, iLastColor, iLastIndex;
+
+    if (cPixels == 0)
+        return;
+
+    iLastColor = *pulSrc;
+    iLastIndex = pfnXlate(pexlo, iLastColor);
+
+    while (cPixels--)
+    {
+        iColor = *pulSrc++;
+        if (iColor != iLastColor)
+        {
+            iLastColor = iColor;
+            iLastIndex = pfnXlate(pexlo, iColor);
+        }
+        *pulDst++ = iLastIndex;
+    }
+}
+
+DEFINE_XLATE_SPAN(555toRGB)
+DEFINE_XLATE_SPAN(555toBGR)
+DEFINE_XLATE_SPAN(565toRGB)
+DEFINE_XLATE_SPAN(565toBGR)
+
+#if defined(_M_AMD64)
+
+/*
+ * Each of these does exactly what the iXlate function of the same name does,
+ * on four colors at once, and leaves the rest of the span to it.
+ */
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanToMono(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    __m128i xmmBack = _mm_set1_epi32(pexlo->xlo.pulXlate[0]);
+    __m128i xmmOne = _mm_set1_epi32(1);
+    __m128i xmmColor;
+
+    for (; cPixels >= 4; cPixels -= 4, pulSrc += 4, pulDst += 4)
+    {
+        xmmColor = _mm_loadu_si128((const __m128i *)pulSrc);
+        xmmColor = _mm_and_si128(_mm_cmpeq_epi32(xmmColor, xmmBack), xmmOne);
+        _mm_storeu_si128((__m128i *)pulDst, xmmColor);
+    }
+
+    while (cPixels--)
+        *pulDst++ = EXLATEOBJ_iXlateToMono(pexlo, *pulSrc++);
+}
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanRGBtoBGR(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    __m128i xmmColor, xmmRedBlue, xmmNewColor;
+
+    for (; cPixels >= 4; cPixels -= 4, pulSrc += 4, pulDst += 4)
+    {
+        xmmColor = _mm_loadu_si128((const __m128i *)pulSrc);
+        xmmNewColor = _mm_and_si128(xmmColor, _mm_set1_epi32((int)0xff00ff00));
+        xmmRedBlue = _mm_and_si128(xmmColor, _mm_set1_epi32(0x00ff00ff));
+        xmmNewColor = _mm_or_si128(xmmNewColor, _mm_srli_epi32(xmmRedBlue, 16));
+        xmmNewColor = _mm_or_si128(xmmNewColor, _mm_slli_epi32(xmmRedBlue, 16));
+        _mm_storeu_si128((__m128i *)pulDst, xmmNewColor);
+    }
+
+    while (cPixels--)
+        *pulDst++ = EXLATEOBJ_iXlateRGBtoBGR(pexlo, *pulSrc++);
+}
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanRGBto555(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    __m128i xmmColor, xmmNewColor;
+
+    for (; cPixels >= 4; cPixels -= 4, pulSrc += 4, pulDst += 4)
+    {
+        xmmColor = _mm_slli_epi32(_mm_loadu_si128((const __m128i *)pulSrc), 7);
+        xmmNewColor = _mm_and_si128(xmmColor, _mm_set1_epi32(0x7C00));
+        xmmColor = _mm_srli_epi32(xmmColor, 13);
+        xmmNewColor = _mm_or_si128(xmmNewColor, _mm_and_si128(xmmColor, _mm_set1_epi32(0x3E0)));
+        xmmColor = _mm_srli_epi32(xmmColor, 13);
+        xmmNewColor = _mm_or_si128(xmmNewColor, _mm_and_si128(xmmColor, _mm_set1_epi32(0x1F)));
+        _mm_storeu_si128((__m128i *)pulDst, xmmNewColor);
+    }
+
+    while (cPixels--)
+        *pulDst++ = EXLATEOBJ_iXlateRGBto555(pexlo, *pulSrc++);
+}
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanBGRto555(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    __m128i xmmColor, xmmNewColor;
+
+    for (; cPixels >= 4; cPixels -= 4, pulSrc += 4, pulDst += 4)
+    {
+        xmmColor = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)pulSrc), 3);
+        xmmNewColor = _mm_and_si128(xmmColor, _mm_set1_epi32(0x1F));
+        xmmColor = _mm_srli_epi32(xmmColor, 3);
+        xmmNewColor = _mm_or_si128(xmmNewColor, _mm_and_si128(xmmColor, _mm_set1_epi32(0x3E0)));
+        xmmColor = _mm_srli_epi32(xmmColor, 3);
+        xmmNewColor = _mm_or_si128(xmmNewColor, _mm_and_si128(xmmColor, _mm_set1_epi32(0x7C00)));
+        _mm_storeu_si128((__m128i *)pulDst, xmmNewColor);
+    }
+
+    while (cPixels--)
+        *pulDst++ = EXLATEOBJ_iXlateBGRto555(pexlo, *pulSrc++);
+}
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanRGBto565(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    __m128i xmmColor, xmmNewColor;
+
+    for (; cPixels >= 4; cPixels -= 4, pulSrc += 4, pulDst += 4)
+    {
+        xmmColor = _mm_slli_epi32(_mm_loadu_si128((const __m128i *)pulSrc), 8);
+        xmmNewColor = _mm_and_si128(xmmColor, _mm_set1_epi32(0xF800));
+        xmmColor = _mm_srli_epi32(xmmColor, 13);
+        xmmNewColor = _mm_or_si128(xmmNewColor, _mm_and_si128(xmmColor, _mm_set1_epi32(0x7E0)));
+        xmmColor = _mm_srli_epi32(xmmColor, 14);
+        xmmNewColor = _mm_or_si128(xmmNewColor, _mm_and_si128(xmmColor, _mm_set1_epi32(0x1F)));
+        _mm_storeu_si128((__m128i *)pulDst, xmmNewColor);
+    }
+
+    while (cPixels--)
+        *pulDst++ = EXLATEOBJ_iXlateRGBto565(pexlo, *pulSrc++);
+}
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanBGRto565(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    __m128i xmmColor, xmmNewColor;
+
+    for (; cPixels >= 4; cPixels -= 4, pulSrc += 4, pulDst += 4)
+    {
+        xmmColor = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)pulSrc), 3);
+        xmmNewColor = _mm_and_si128(xmmColor, _mm_set1_epi32(0x1F));
+        xmmColor = _mm_srli_epi32(xmmColor, 2);
+        xmmNewColor = _mm_or_si128(xmmNewColor, _mm_and_si128(xmmColor, _mm_set1_epi32(0x7E0)));
+        xmmColor = _mm_srli_epi32(xmmColor, 3);
+        xmmNewColor = _mm_or_si128(xmmNewColor, _mm_and_si128(xmmColor, _mm_set1_epi32(0xF800)));
+        _mm_storeu_si128((__m128i *)pulDst, xmmNewColor);
+    }
+
+    while (cPixels--)
+        *pulDst++ = EXLATEOBJ_iXlateBGRto565(pexlo, *pulSrc++);
+}
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpan555to565(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    __m128i xmmColor, xmmNewColor;
+
+    for (; cPixels >= 4; cPixels -= 4, pulSrc += 4, pulDst += 4)
+    {
+        xmmColor = _mm_loadu_si128((const __m128i *)pulSrc);
+        xmmNewColor = _mm_and_si128(xmmColor, _mm_set1_epi32(0x1f));
+        xmmColor = _mm_slli_epi32(xmmColor, 1);
+        xmmNewColor = _mm_or_si128(xmmNewColor, _mm_and_si128(xmmColor, _mm_set1_epi32(0xFFC0)));
+        xmmColor = _mm_srli_epi32(xmmColor, 5);
+        xmmNewColor = _mm_or_si128(xmmNewColor, _mm_and_si128(xmmColor, _mm_set1_epi32(0x20)));
+        _mm_storeu_si128((__m128i *)pulDst, xmmNewColor);
+    }
+
+    while (cPixels--)
+        *pulDst++ = EXLATEOBJ_iXlate555to565(pexlo, *pulSrc++);
+}
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpan565to555(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    __m128i xmmColor, xmmNewColor;
+
+    for (; cPixels >= 4; cPixels -= 4, pulSrc += 4, pulDst += 4)
+    {
+        xmmColor = _mm_loadu_si128((const __m128i *)pulSrc);
+        xmmNewColor = _mm_and_si128(xmmColor, _mm_set1_epi32(0x1f));
+        xmmColor = _mm_srli_epi32(xmmColor, 1);
+        xmmNewColor = _mm_or_si128(xmmNewColor, _mm_and_si128(xmmColor, _mm_set1_epi32(0x7FE0)));
+        _mm_storeu_si128((__m128i *)pulDst, xmmNewColor);
+    }
+
+    while (cPixels--)
+        *pulDst++ = EXLATEOBJ_iXlate565to555(pexlo, *pulSrc++);
+}
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanShiftAndMask(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    __m128i xmmRedMask = _mm_set1_epi32(pexlo->ulRedMask);
+    __m128i xmmGreenMask = _mm_set1_epi32(pexlo->ulGreenMask);
+    __m128i xmmBlueMask = _mm_set1_epi32(pexlo->ulBlueMask);
+    __m128i xmmRedLeft, xmmRedRight, xmmGreenLeft, xmmGreenRight, xmmBlueLeft, xmmBlueRight;
+    __m128i xmmColor, xmmNewColor;
+
+    /* A rotate is a shift each way, shifting by 32 gives 0 */
+    xmmRedLeft = _mm_cvtsi32_si128(pexlo->ulRedShift & 31);
+    xmmRedRight = _mm_cvtsi32_si128(32 - (pexlo->ulRedShift & 31));
+    xmmGreenLeft = _mm_cvtsi32_si128(pexlo->ulGreenShift & 31);
+    xmmGreenRight = _mm_cvtsi32_si128(32 - (pexlo->ulGreenShift & 31));
+    xmmBlueLeft = _mm_cvtsi32_si128(pexlo->ulBlueShift & 31);
+    xmmBlueRight = _mm_cvtsi32_si128(32 - (pexlo->ulBlueShift & 31));
+
+    for (; cPixels >= 4; cPixels -= 4, pulSrc += 4, pulDst += 4)
+    {
+        xmmColor = _mm_loadu_si128((const __m128i *)pulSrc);
+
+        xmmNewColor = _mm_and_si128(_mm_or_si128(_mm_sll_epi32(xmmColor, xmmRedLeft),
+                                                 _mm_srl_epi32(xmmColor, xmmRedRight)),
+                                    xmmRedMask);
+        xmmNewColor = _mm_or_si128(xmmNewColor,
+                                   _mm_and_si128(_mm_or_si128(_mm_sll_epi32(xmmColor, xmmGreenLeft),
+                                                              _mm_srl_epi32(xmmColor, xmmGreenRight)),
+                                                 xmmGreenMask));
+        xmmNewColor = _mm_or_si128(xmmNewColor,
+                                   _mm_and_si128(_mm_or_si128(_mm_sll_epi32(xmmColor, xmmBlueLeft),
+                                                              _mm_srl_epi32(xmmColor, xmmBlueRight)),
+                                                 xmmBlueMask));
+
+        _mm_storeu_si128((__m128i *)pulDst, xmmNewColor);
+    }
+
+    while (cPixels--)
+        *pulDst++ = EXLATEOBJ_iXlateShiftAndMask(pexlo, *pulSrc++);
+}
+
+#else /* _M_AMD64 */
+
+DEFINE_XLATE_SPAN(ToMono)
+DEFINE_XLATE_SPAN(RGBtoBGR)
+DEFINE_XLATE_SPAN(RGBto555)
+DEFINE_XLATE_SPAN(BGRto555)
+DEFINE_XLATE_SPAN(RGBto565)
+DEFINE_XLATE_SPAN(BGRto565)
+DEFINE_XLATE_SPAN(555to565)
+DEFINE_XLATE_SPAN(565to555)
+DEFINE_XLATE_SPAN(ShiftAndMask)
+
+#endif /* _M_AMD64 */
+
+static
+PFN_XLATE_SPAN
+EXLATEOBJ_pfnGetXlateSpan(
+    _In_ PFN_XLATE pfnXlate)
+{
+    if (pfnXlate == EXLATEOBJ_iXlateTrivial) return EXLATEOBJ_vXlateSpanTrivial;
+    if (pfnXlate == EXLATEOBJ_iXlateToMono) return EXLATEOBJ_vXlateSpanToMono;
+    if (pfnXlate == EXLATEOBJ_iXlateTable) return EXLATEOBJ_vXlateSpanTable;
+    if (pfnXlate == EXLATEOBJ_iXlateRGBtoBGR) return EXLATEOBJ_vXlateSpanRGBtoBGR;
+    if (pfnXlate == EXLATEOBJ_iXlateRGBto555) return EXLATEOBJ_vXlateSpanRGBto555;
+    if (pfnXlate == EXLATEOBJ_iXlateBGRto555) return EXLATEOBJ_vXlateSpanBGRto555;
+    if (pfnXlate == EXLATEOBJ_iXlateRGBto565) return EXLATEOBJ_vXlateSpanRGBto565;
+    if (pfnXlate == EXLATEOBJ_iXlateBGRto565) return EXLATEOBJ_vXlateSpanBGRto565;
+    if (pfnXlate == EXLATEOBJ_iXlate555toRGB) return EXLATEOBJ_vXlateSpan555toRGB;
+    if (pfnXlate == EXLATEOBJ_iXlate555toBGR) return EXLATEOBJ_vXlateSpan555toBGR;
+    if (pfnXlate == EXLATEOBJ_iXlate555to565) return EXLATEOBJ_vXlateSpan555to565;
+    if (pfnXlate == EXLATEOBJ_iXlate565to555) return EXLATEOBJ_vXlateSpan565to555;
+    if (pfnXlate == EXLATEOBJ_iXlate565toRGB) return EXLATEOBJ_vXlateSpan565toRGB;
+    if (pfnXlate == EXLATEOBJ_iXlate565toBGR) return EXLATEOBJ_vXlateSpan565toBGR;
+    if (pfnXlate == EXLATEOBJ_iXlateShiftAndMask) return EXLATEOBJ_vXlateSpanShiftAndMask;
+
+    if (pfnXlate == EXLATEOBJ_iXlateRGBtoPal ||
+        pfnXlate == EXLATEOBJ_iXlate555toPal ||
+        pfnXlate == EXLATEOBJ_iXlate565toPal ||
+        pfnXlate == EXLATEOBJ_iXlateBitfieldsToPal)
+    {
+        return EXLATEOBJ_vXlateSpanToPal;
+    }
+
+    return EXLATEOBJ_vXlateSpanGeneric;
+}
+
+
+#ifndef UNIT_TEST
 
 /** Private Functions *********************************************************/
 
@@ -374,6 +808,7 @@ EXLATEOBJ_vInitialize(
     pexlo->xlo.flXlate = 0;
     pexlo->xlo.pulXlate = pexlo->aulXlate;
     pexlo->pfnXlate = EXLATEOBJ_iXlateTrivial;
+    pexlo->pfnXlateSpan = EXLATEOBJ_vXlateSpanTrivial;
     pexlo->hColorTransform = NULL;
     pexlo->ppalSrc = ppalSrc;
     pexlo->ppalDst = ppalDst;
@@ -604,6 +1039,9 @@ EXLATEOBJ_vInitialize(
         pexlo->xlo.flXlate = XO_TRIVIAL;
     else
         pexlo->xlo.flXlate &= ~XO_TRIVIAL;
+
+    /* Get the matching span function */
+    pexlo->pfnXlateSpan = EXLATEOBJ_pfnGetXlateSpan(pexlo->pfnXlate);
 }
 
 VOID
@@ -656,6 +1094,8 @@ EXLATEOBJ_vCleanup(
     pexlo->xlo.pulXlate = pexlo->aulXlate;
 }
 
+#endif /* UNIT_TEST */
+
 /** Public DDI Functions ******************************************************/
 
 #undef XLATEOBJ_iXlate
@@ -674,6 +1114,8 @@ XLATEOBJ_iXlate(
     return pexlo->pfnXlate(pexlo, iColor);
 }
 
+#ifndef UNIT_TEST
+
 ULONG
 NTAPI
 XLATEOBJ_cGetPalette(
@@ -770,4 +1212,6 @@ XLATEOBJ_piVector(
     return NULL;
 }
 
+#endif /* UNIT_TEST */
+
 /* EOF */
@@ -16,11 +16,22 @@ ULONG
     _In_ struct _EXLATEOBJ *pexlo,
     _In_ ULONG iColor);
 
+/* Translates cPixels colors at once, pulDst may be the same as pulSrc */
+_Function_class_(FN_XLATE_SPAN)
+typedef
+VOID
+(FASTCALL *PFN_XLATE_SPAN)(
+    _In_ struct _EXLATEOBJ *pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels);
+
 typedef struct _EXLATEOBJ
 {
     XLATEOBJ xlo;
 
     PFN_XLATE pfnXlate;
+    PFN_XLATE_SPAN pfnXlateSpan;
 
     PPALETTE ppalSrc;
     PPALETTE ppalDst;
@@ -54,6 +65,15 @@ XLATEOBJ_pfnXlate(
     return ((PEXLATEOBJ)pxlo)->pfnXlate;
 }
 
+_Notnull_
+FORCEINLINE
+PFN_XLATE_SPAN
+XLATEOBJ_pfnXlateSpan(
+    _In_ XLATEOBJ *pxlo)
+{
+    return ((PEXLATEOBJ)pxlo)->pfnXlateSpan;
+}
+
 VOID
 NTAPI
 EXLATEOBJ_vInitialize(
@@ -54,8 +54,11 @@ typedef struct _FONT_CACHE_HASHED
 
 typedef struct _FONT_CACHE_ENTRY
 {
-    LIST_ENTRY ListEntry;
+    LIST_ENTRY ListEntry;       /* Global LRU list, most recently used first */
+    LIST_ENTRY HashEntry;       /* Hash bucket chain */
+    LIST_ENTRY FaceEntry;       /* LRU list of the owning SHARED_FACE */
     FT_BitmapGlyph BitmapGlyph;
+    SIZE_T Size;                /* Bytes charged against the cache budget */
     DWORD dwHash;
     FONT_CACHE_HASHED Hashed;
 } FONT_CACHE_ENTRY, *PFONT_CACHE_ENTRY;
@@ -63,6 +66,19 @@ typedef struct _FONT_CACHE_ENTRY
 C_ASSERT(FIELD_OFFSET(FONT_CACHE_ENTRY, Hashed) % sizeof(DWORD) == 0); /* for hashing */
 C_ASSERT(sizeof(FONT_CACHE_HASHED) % sizeof(DWORD) == 0); /* for hashing */
 
+typedef struct _FONT_CACHE_STATS
+{
+    ULONGLONG Lookups;
+    ULONGLONG Hits;
+    ULONGLONG Misses;
+    ULONGLONG Evictions;        /* Evicted to keep the cache within MaxSize */
+    ULONGLONG FaceEvictions;    /* Evicted to keep a face within its share */
+    ULONG Entries;
+    SIZE_T Size;
+    SIZE_T PeakSize;
+    SIZE_T MaxSize;
+} FONT_CACHE_STATS, *PFONT_CACHE_STATS;
+
 /*
  * FONTSUBST_... --- constants for font substitutes
  */
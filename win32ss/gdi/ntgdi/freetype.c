@@ -389,10 +389,20 @@ do { \
     ExReleaseFastMutexUnsafeAndLeaveCriticalRegion(g_FreeTypeLock); \
 } while(0)
 
-#define MAX_FONT_CACHE 256
+/*
+ * The glyph cache is a hash table of rendered glyphs keyed by FONT_CACHE_HASHED.
+ * Entries are also kept on a global LRU list and on an LRU list of their face.
+ * The cache is bounded by the memory used by the bitmaps rather than by
+ * the entry count, and a single face may only use part of it, so that
+ * one large document font cannot flush the glyphs of the UI fonts.
+ */
+#define FONT_CACHE_HASH_SIZE    4096 /* Must be a power of 2 */
+#define FONT_CACHE_MAX_SIZE     (8 * 1024 * 1024)
+#define FONT_CACHE_MAX_FACE_SIZE (FONT_CACHE_MAX_SIZE / 2)
 
 static RTL_STATIC_LIST_HEAD(g_FontCacheListHead);
-static UINT g_FontCacheNumEntries;
+static LIST_ENTRY g_FontCacheHashTable[FONT_CACHE_HASH_SIZE];
+static FONT_CACHE_STATS g_FontCacheStats;
 
 static PWCHAR g_ElfScripts[32] =   /* These are in the order of the fsCsb[0] bits */
 {
@@ -582,6 +592,11 @@ SharedFace_Create(FT_Face Face, PSHARED_MEM Memory)
         Ptr->Memory = Memory;
         SharedFaceCache_Init(&Ptr->EnglishUS);
         SharedFaceCache_Init(&Ptr->UserLanguage);
+        InitializeListHead(&Ptr->GlyphCacheListHead);
+        Ptr->GlyphCacheSize = 0;
+
+        /* The glyph cache finds the owner of a face through this */
+        Face->generic.data = Ptr;
 
         SharedMem_AddRef(Memory);
         DPRINT("Creating SharedFace for %s\n", Face->family_name ? Face->family_name : "<NULL>");
@@ -616,35 +631,39 @@ SharedFace_AddRef(PSHARED_FACE Ptr)
 static void
 RemoveCachedEntry(PFONT_CACHE_ENTRY Entry)
 {
+    PSHARED_FACE SharedFace = Entry->Hashed.Face->generic.data;
+
     ASSERT_FREETYPE_LOCK_HELD();
 
     FT_Done_Glyph((FT_Glyph)Entry->BitmapGlyph);
     RemoveEntryList(&Entry->ListEntry);
+    RemoveEntryList(&Entry->HashEntry);
+    RemoveEntryList(&Entry->FaceEntry);
+
+    ASSERT(SharedFace->GlyphCacheSize >= Entry->Size);
+    ASSERT(g_FontCacheStats.Size >= Entry->Size);
+    SharedFace->GlyphCacheSize -= Entry->Size;
+    g_FontCacheStats.Size -= Entry->Size;
+    g_FontCacheStats.Entries--;
+
     ExFreePoolWithTag(Entry, TAG_FONT);
-    g_FontCacheNumEntries--;
-    ASSERT(g_FontCacheNumEntries <= MAX_FONT_CACHE);
 }
 
 static void
-RemoveCacheEntries(FT_Face Face)
+RemoveCacheEntries(PSHARED_FACE SharedFace)
 {
-    PLIST_ENTRY CurrentEntry, NextEntry;
     PFONT_CACHE_ENTRY FontEntry;
 
     ASSERT_FREETYPE_LOCK_HELD();
 
-    for (CurrentEntry = g_FontCacheListHead.Flink;
-         CurrentEntry != &g_FontCacheListHead;
-         CurrentEntry = NextEntry)
+    while (!IsListEmpty(&SharedFace->GlyphCacheListHead))
     {
-        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, ListEntry);
-        NextEntry = CurrentEntry->Flink;
-
-        if (FontEntry->Hashed.Face == Face)
-        {
-            RemoveCachedEntry(FontEntry);
-        }
+        FontEntry = CONTAINING_RECORD(SharedFace->GlyphCacheListHead.Flink,
+                                      FONT_CACHE_ENTRY, FaceEntry);
+        RemoveCachedEntry(FontEntry);
     }
+
+    ASSERT(SharedFace->GlyphCacheSize == 0);
 }
 
 static void SharedMem_Release(PSHARED_MEM Ptr)
@@ -687,7 +706,7 @@ SharedFace_Release(PSHARED_FACE Ptr)
     if (Ptr->RefCount == 0)
     {
         DPRINT("Releasing SharedFace for %s\n", Ptr->Face->family_name ? Ptr->Face->family_name : "<NULL>");
-        RemoveCacheEntries(Ptr->Face);
+        RemoveCacheEntries(Ptr);
         FT_Done_Face(Ptr->Face);
         SharedMem_Release(Ptr->Memory);
         SharedFaceCache_Release(&Ptr->EnglishUS);
@@ -1021,8 +1040,14 @@ BOOL FASTCALL
 InitFontSupport(VOID)
 {
     ULONG ulError;
+    ULONG i;
 
-    g_FontCacheNumEntries = 0;
+    for (i = 0; i < FONT_CACHE_HASH_SIZE; ++i)
+    {
+        InitializeListHead(&g_FontCacheHashTable[i]);
+    }
+    RtlZeroMemory(&g_FontCacheStats, sizeof(g_FontCacheStats));
+    g_FontCacheStats.MaxSize = FONT_CACHE_MAX_SIZE;
 
     g_FreeTypeLock = ExAllocatePoolWithTag(NonPagedPool, sizeof(FAST_MUTEX), TAG_INTERNAL_SYNC);
     if (g_FreeTypeLock == NULL)
@@ -1074,8 +1099,7 @@ FreeFontSupport(VOID)
     pHead = &g_FontCacheListHead;
     while (!IsListEmpty(pHead))
     {
-        pEntry = RemoveHeadList(pHead);
-        pFontCache = CONTAINING_RECORD(pEntry, FONT_CACHE_ENTRY, ListEntry);
+        pFontCache = CONTAINING_RECORD(pHead->Flink, FONT_CACHE_ENTRY, ListEntry);
         RemoveCachedEntry(pFontCache);
     }
 
@@ -3789,17 +3813,21 @@ IntGetHash(IN LPCVOID pv, IN DWORD cdw)
 static FT_BitmapGlyph
 IntFindGlyphCache(IN const FONT_CACHE_ENTRY *pCache)
 {
-    PLIST_ENTRY CurrentEntry;
+    PLIST_ENTRY CurrentEntry, BucketHead;
     PFONT_CACHE_ENTRY FontEntry;
+    PSHARED_FACE SharedFace;
     DWORD dwHash = pCache->dwHash;
 
     ASSERT_FREETYPE_LOCK_HELD();
 
-    for (CurrentEntry = g_FontCacheListHead.Flink;
-         CurrentEntry != &g_FontCacheListHead;
+    g_FontCacheStats.Lookups++;
+
+    BucketHead = &g_FontCacheHashTable[dwHash & (FONT_CACHE_HASH_SIZE - 1)];
+    for (CurrentEntry = BucketHead->Flink;
+         CurrentEntry != BucketHead;
          CurrentEntry = CurrentEntry->Flink)
     {
-        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, ListEntry);
+        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, HashEntry);
         if (FontEntry->dwHash == dwHash &&
             FontEntry->Hashed.GlyphIndex == pCache->Hashed.GlyphIndex &&
             FontEntry->Hashed.Face == pCache->Hashed.Face &&
@@ -3813,16 +3841,57 @@ IntFindGlyphCache(IN const FONT_CACHE_ENTRY *pCache)
         }
     }
 
-    if (CurrentEntry == &g_FontCacheListHead)
+    if (CurrentEntry == BucketHead)
     {
+        g_FontCacheStats.Misses++;
         return NULL;
     }
 
-    RemoveEntryList(CurrentEntry);
-    InsertHeadList(&g_FontCacheListHead, CurrentEntry);
+    g_FontCacheStats.Hits++;
+
+    /* Make it the most recently used entry, globally and for its face */
+    SharedFace = FontEntry->Hashed.Face->generic.data;
+    RemoveEntryList(&FontEntry->ListEntry);
+    InsertHeadList(&g_FontCacheListHead, &FontEntry->ListEntry);
+    RemoveEntryList(&FontEntry->FaceEntry);
+    InsertHeadList(&SharedFace->GlyphCacheListHead, &FontEntry->FaceEntry);
+
     return FontEntry->BitmapGlyph;
 }
 
+static VOID
+IntTrimGlyphCache(
+    IN PSHARED_FACE SharedFace,
+    IN PFONT_CACHE_ENTRY NewEntry)
+{
+    PFONT_CACHE_ENTRY OldEntry;
+
+    ASSERT_FREETYPE_LOCK_HELD();
+
+    /* Keep the face within its share, evicting its own least recently used glyphs */
+    while (SharedFace->GlyphCacheSize > FONT_CACHE_MAX_FACE_SIZE)
+    {
+        OldEntry = CONTAINING_RECORD(SharedFace->GlyphCacheListHead.Blink,
+                                     FONT_CACHE_ENTRY, FaceEntry);
+        if (OldEntry == NewEntry)
+            break;
+
+        RemoveCachedEntry(OldEntry);
+        g_FontCacheStats.FaceEvictions++;
+    }
+
+    /* Then keep the whole cache within the budget */
+    while (g_FontCacheStats.Size > FONT_CACHE_MAX_SIZE)
+    {
+        OldEntry = CONTAINING_RECORD(g_FontCacheListHead.Blink, FONT_CACHE_ENTRY, ListEntry);
+        if (OldEntry == NewEntry)
+            break;
+
+        RemoveCachedEntry(OldEntry);
+        g_FontCacheStats.Evictions++;
+    }
+}
+
 static FT_BitmapGlyph
 IntGetBitmapGlyphWithCache(
     IN OUT PFONT_CACHE_ENTRY Cache,
@@ -3831,11 +3900,15 @@ IntGetBitmapGlyphWithCache(
     FT_Glyph GlyphCopy;
     INT error;
     PFONT_CACHE_ENTRY NewEntry;
+    PSHARED_FACE SharedFace;
     FT_Bitmap AlignedBitmap;
     FT_BitmapGlyph BitmapGlyph;
 
     ASSERT_FREETYPE_LOCK_HELD();
 
+    SharedFace = Cache->Hashed.Face->generic.data;
+    ASSERT(SharedFace != NULL);
+
     error = FT_Get_Glyph(GlyphSlot, &GlyphCopy);
     if (error)
     {
@@ -3877,17 +3950,41 @@ IntGetBitmapGlyphWithCache(
     NewEntry->BitmapGlyph = BitmapGlyph;
     NewEntry->dwHash = Cache->dwHash;
     NewEntry->Hashed = Cache->Hashed;
+    NewEntry->Size = sizeof(FONT_CACHE_ENTRY) + sizeof(FT_BitmapGlyphRec) +
+                     (SIZE_T)abs(AlignedBitmap.pitch) * AlignedBitmap.rows;
 
     InsertHeadList(&g_FontCacheListHead, &NewEntry->ListEntry);
-    if (++g_FontCacheNumEntries > MAX_FONT_CACHE)
-    {
-        NewEntry = CONTAINING_RECORD(g_FontCacheListHead.Blink, FONT_CACHE_ENTRY, ListEntry);
-        RemoveCachedEntry(NewEntry);
-    }
+    InsertHeadList(&g_FontCacheHashTable[NewEntry->dwHash & (FONT_CACHE_HASH_SIZE - 1)],
+                   &NewEntry->HashEntry);
+    InsertHeadList(&SharedFace->GlyphCacheListHead, &NewEntry->FaceEntry);
+    SharedFace->GlyphCacheSize += NewEntry->Size;
+    g_FontCacheStats.Size += NewEntry->Size;
+    g_FontCacheStats.Entries++;
+    if (g_FontCacheStats.Size > g_FontCacheStats.PeakSize)
+        g_FontCacheStats.PeakSize = g_FontCacheStats.Size;
+
+    IntTrimGlyphCache(SharedFace, NewEntry);
 
     return BitmapGlyph;
 }
 
+/* Called from the debugger, so it does not take the FreeType lock */
+VOID
+FASTCALL
+IntDumpGlyphCacheStats(VOID)
+{
+    ULONGLONG Lookups = g_FontCacheStats.Lookups;
+    ULONG HitRate = Lookups ? (ULONG)(g_FontCacheStats.Hits * 100 / Lookups) : 0;
+
+    DbgPrint("Glyph cache: %lu entries, %Iu of %Iu bytes (peak %Iu)\n",
+             g_FontCacheStats.Entries, g_FontCacheStats.Size,
+             g_FontCacheStats.MaxSize, g_FontCacheStats.PeakSize);
+    DbgPrint("Lookups: %I64u, hits: %I64u (%lu%%), misses: %I64u\n",
+             Lookups, g_FontCacheStats.Hits, HitRate, g_FontCacheStats.Misses);
+    DbgPrint("Evictions: %I64u over budget, %I64u over face share\n",
+             g_FontCacheStats.Evictions, g_FontCacheStats.FaceEvictions);
+}
+
 
 static unsigned int get_native_glyph_outline(FT_Outline *outline, unsigned int buflen, char *buf)
 {
@@ -69,6 +69,7 @@ KdbCommand_Gdi_help(VOID)
              "- handle <handle> - Displays information about a handle\n"
              "- entry <entry> - Displays an ENTRY, <entry> can be a pointer or index\n"
              "- baseobject <object> - Displays a BASEOBJECT\n"
+             "- glyphcache - Displays the glyph cache statistics\n"
 #if DBG_ENABLE_EVENT_LOGGING
              "- eventlist <object> - Displays the eventlist for an object\n"
 #endif
@@ -347,6 +348,10 @@ DbgGdiKdbgCliCallback(
     {
         KdbCommand_Gdi_baseobject(argv[1]);
     }
+    else if (_stricmp(argv[0], "!gdi.glyphcache") == 0)
+    {
+        IntDumpGlyphCacheStats();
+    }
 #if DBG_ENABLE_EVENT_LOGGING
     else if (_stricmp(argv[0], "!gdi.eventlist") == 0)
     {